@@ -8,12 +8,15 @@
  *   3. MLP forward: batch=64, 784->128->ReLU->10, 100 iters
  *   4. MLP training step: forward + MSE loss + backward + SGD step
  *   5. Conv2d forward: batch=8, 3x32x32 -> 16x30x30
+ *   6. Raw SGEMM on medium shapes: CML packed path (cml_blas_sgemm) vs. the
+ *      loaded BLAS called directly (OpenBLAS ILP64 when available)
  *
  * Set CML_BACKEND=opencl to benchmark OpenCL GPU path.
  * Set CML_BACKEND=metal to benchmark Metal GPU path (macOS).
  */
 #define _POSIX_C_SOURCE 199309L
 #include "cml.h"
+#include "backend/blas.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -267,6 +270,57 @@ static double bench_conv2d(void) {
     return median(times, 5);
 }
 
+/* Medium GEMM shapes that route to the packed kernel: conv im2col (few rows,
+ * wide N), MLP layers, and a square mid-size block. */
+typedef struct {
+    const char* name;
+    int M, N, K;
+} SgemmShape;
+
+static const SgemmShape g_sgemm_shapes[] = {
+    {"im2col_16x7200x27", 16, 7200, 27},
+    {"mlp_64x128x784", 64, 128, 784},
+    {"mlp_256x512x784", 256, 512, 784},
+    {"square_384", 384, 384, 384},
+};
+#define NUM_SGEMM_SHAPES ((int)(sizeof(g_sgemm_shapes) / sizeof(g_sgemm_shapes[0])))
+
+/* reference = true calls the loaded library directly, bypassing CML's
+ * dispatch; returns a negative value when no reference entry point exists. */
+static double bench_sgemm(CMLBlasContext* ctx, const SgemmShape* s, bool reference) {
+    if (reference && !ctx->ilp64_sgemm && !ctx->cblas_sgemm)
+        return -1.0;
+
+    float* a = malloc(sizeof(float) * s->M * s->K);
+    float* b = malloc(sizeof(float) * s->K * s->N);
+    float* c = malloc(sizeof(float) * s->M * s->N);
+    fill_random(a, s->M * s->K);
+    fill_random(b, s->K * s->N);
+
+    int iters = 20;
+    double times[5];
+    for (int r = -1; r < 5; r++) {
+        double t0 = now();
+        for (int i = 0; i < iters; i++) {
+            if (!reference)
+                cml_blas_sgemm(ctx, a, b, c, s->M, s->N, s->K, 1.0f, 0.0f);
+            else if (ctx->is_ilp64 && ctx->ilp64_sgemm)
+                ctx->ilp64_sgemm(CML_BLAS_ROW_MAJOR, CML_BLAS_NO_TRANS, CML_BLAS_NO_TRANS,
+                                 s->M, s->N, s->K, 1.0f, a, s->K, b, s->N, 0.0f, c, s->N);
+            else
+                ctx->cblas_sgemm(CML_BLAS_ROW_MAJOR, CML_BLAS_NO_TRANS, CML_BLAS_NO_TRANS,
+                                 s->M, s->N, s->K, 1.0f, a, s->K, b, s->N, 0.0f, c, s->N);
+        }
+        if (r >= 0) /* r == -1 is warmup */
+            times[r] = (now() - t0) / iters * 1e3;
+    }
+
+    free(a);
+    free(b);
+    free(c);
+    return median(times, 5);
+}
+
 int main(void) {
     const char* backend = getenv("CML_BACKEND");
     if (backend && strcmp(backend, "metal") == 0) {
@@ -293,6 +347,13 @@ int main(void) {
     double mlp_train  = bench_mlp_train();
     double conv2d_fwd = bench_conv2d();
 
+    CMLBlasContext* blas = cml_blas_get_context();
+    double sgemm_cml[NUM_SGEMM_SHAPES], sgemm_ref[NUM_SGEMM_SHAPES];
+    for (int i = 0; i < NUM_SGEMM_SHAPES; i++) {
+        sgemm_cml[i] = blas ? bench_sgemm(blas, &g_sgemm_shapes[i], false) : -1.0;
+        sgemm_ref[i] = blas ? bench_sgemm(blas, &g_sgemm_shapes[i], true) : -1.0;
+    }
+
     printf("{\n");
     printf("  \"gemm_512\": %.3f,\n", gemm_512);
     printf("  \"gemm_1024\": %.3f,\n", gemm_1024);
@@ -302,7 +363,20 @@ int main(void) {
     printf("  \"fused_2048\": %.3f,\n", fused_2048);
     printf("  \"mlp_forward\": %.3f,\n", mlp_fwd);
     printf("  \"mlp_train_step\": %.3f,\n", mlp_train);
-    printf("  \"conv2d_forward\": %.3f\n", conv2d_fwd);
+    printf("  \"conv2d_forward\": %.3f,\n", conv2d_fwd);
+    printf("  \"sgemm_reference_lib\": \"%s%s\",\n", cml_blas_get_library_name(blas),
+           blas && blas->is_ilp64 ? " (ILP64)" : "");
+    for (int i = 0; i < NUM_SGEMM_SHAPES; i++) {
+        const char* sep = (i + 1 < NUM_SGEMM_SHAPES) ? "," : "";
+        if (sgemm_cml[i] >= 0.0)
+            printf("  \"sgemm_%s_cml\": %.3f,\n", g_sgemm_shapes[i].name, sgemm_cml[i]);
+        else
+            printf("  \"sgemm_%s_cml\": null,\n", g_sgemm_shapes[i].name);
+        if (sgemm_ref[i] >= 0.0)
+            printf("  \"sgemm_%s_blas\": %.3f%s\n", g_sgemm_shapes[i].name, sgemm_ref[i], sep);
+        else
+            printf("  \"sgemm_%s_blas\": null%s\n", g_sgemm_shapes[i].name, sep);
+    }
     printf("}\n");
 
     cml_cleanup();
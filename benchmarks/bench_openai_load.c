@@ -0,0 +1,258 @@
+/**
+ * Load generator for the OpenAI-compatible server.
+ *
+ * Opens N keep-alive connections to a running instance and issues requests
+ * back to back on each, then reports throughput and latency percentiles.
+ * Streaming requests also report time to first token.
+ *
+ *   bench_openai_load [-h host] [-p port] [-c connections] [-n requests]
+ *                     [-t max_tokens] [-s] [--health]
+ *
+ * --health hits GET /health instead, which measures the HTTP layer alone.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RESP_BUF_SIZE (1024 * 1024)
+
+typedef struct {
+    const char* host;
+    int port;
+    int connections;
+    int requests;
+    int max_tokens;
+    bool stream;
+    bool health;
+} BenchConfig;
+
+typedef struct {
+    const BenchConfig* cfg;
+    atomic_int* next;
+    double* latency_ms;   /* Indexed by request number */
+    double* ttft_ms;
+    long* tokens;
+    atomic_int* failures;
+} Worker;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+}
+
+static int connect_server(const BenchConfig* cfg) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)cfg->port);
+    if (inet_pton(AF_INET, cfg->host, &addr.sin_addr) != 1 ||
+        connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    int flag = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    return fd;
+}
+
+static int send_all(int fd, const char* buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+        if (n <= 0) return -1;
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* Reads one response; records when the first streamed token arrived */
+static int read_response(int fd, char* buf, double* first_token_ms) {
+    size_t total = 0;
+    *first_token_ms = 0.0;
+    while (total < RESP_BUF_SIZE - 1) {
+        ssize_t n = recv(fd, buf + total, RESP_BUF_SIZE - 1 - total, 0);
+        if (n <= 0) return -1;
+        total += (size_t)n;
+        buf[total] = '\0';
+
+        char* body = strstr(buf, "\r\n\r\n");
+        if (!body) continue;
+        body += 4;
+        if (*first_token_ms == 0.0 && strstr(body, "\"delta\":{\"content\""))
+            *first_token_ms = now_ms();
+
+        const char* cl = strstr(buf, "Content-Length: ");
+        if (cl && cl < body) {
+            if (total - (size_t)(body - buf) >= strtoul(cl + 16, NULL, 10)) return 0;
+        } else if (strstr(body, "\r\n0\r\n\r\n")) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static long count_tokens(const char* resp, bool stream) {
+    if (!stream) {
+        const char* u = strstr(resp, "\"completion_tokens\":");
+        return u ? strtol(u + 20, NULL, 10) : 0;
+    }
+    long n = 0;
+    for (const char* p = resp; (p = strstr(p, "\"delta\":{\"content\"")); p++)
+        n++;
+    return n;
+}
+
+static void* worker_main(void* arg) {
+    Worker* w = (Worker*)arg;
+    const BenchConfig* cfg = w->cfg;
+    char* resp = (char*)malloc(RESP_BUF_SIZE);
+    char req[1024];
+    int req_len;
+
+    if (cfg->health) {
+        req_len = snprintf(req, sizeof(req), "GET /health HTTP/1.1\r\nHost: %s\r\n\r\n",
+                           cfg->host);
+    } else {
+        char body[512];
+        int body_len = snprintf(body, sizeof(body),
+                                "{\"messages\":[{\"role\":\"user\",\"content\":"
+                                "\"Write a short poem about the sea.\"}],"
+                                "\"max_tokens\":%d,\"stream\":%s}",
+                                cfg->max_tokens, cfg->stream ? "true" : "false");
+        req_len = snprintf(req, sizeof(req),
+                           "POST /v1/chat/completions HTTP/1.1\r\nHost: %s\r\n"
+                           "Content-Type: application/json\r\nContent-Length: %d\r\n\r\n%s",
+                           cfg->host, body_len, body);
+    }
+
+    int fd = -1;
+    for (;;) {
+        int i = atomic_fetch_add(w->next, 1);
+        if (i >= cfg->requests) break;
+
+        if (fd < 0 && (fd = connect_server(cfg)) < 0) {
+            atomic_fetch_add(w->failures, 1);
+            continue;
+        }
+
+        double first = 0.0, start = now_ms();
+        if (!resp || send_all(fd, req, (size_t)req_len) != 0 ||
+            read_response(fd, resp, &first) != 0 || !strstr(resp, " 200 ")) {
+            atomic_fetch_add(w->failures, 1);
+            close(fd);
+            fd = -1;
+            continue;
+        }
+        w->latency_ms[i] = now_ms() - start;
+        w->ttft_ms[i] = first > 0.0 ? first - start : 0.0;
+        w->tokens[i] = cfg->health ? 0 : count_tokens(resp, cfg->stream);
+        if (strstr(resp, "Connection: close")) {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    if (fd >= 0) close(fd);
+    free(resp);
+    return NULL;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void print_percentiles(const char* name, double* v, int n) {
+    if (n == 0) return;
+    qsort(v, (size_t)n, sizeof(double), cmp_double);
+    printf("  %-14s p50 %8.2f  p90 %8.2f  p99 %8.2f  max %8.2f ms\n", name,
+           v[(n - 1) / 2], v[(int)((n - 1) * 0.90)], v[(int)((n - 1) * 0.99)], v[n - 1]);
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr, "usage: %s [-h host] [-p port] [-c connections] [-n requests] "
+                    "[-t max_tokens] [-s] [--health]\n", prog);
+}
+
+int main(int argc, char** argv) {
+    BenchConfig cfg = {
+        .host = "127.0.0.1", .port = 8080, .connections = 16,
+        .requests = 256, .max_tokens = 32, .stream = false, .health = false
+    };
+    for (int i = 1; i < argc; i++) {
+        bool has_val = i + 1 < argc;
+        if (strcmp(argv[i], "-h") == 0 && has_val) cfg.host = argv[++i];
+        else if (strcmp(argv[i], "-p") == 0 && has_val) cfg.port = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-c") == 0 && has_val) cfg.connections = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-n") == 0 && has_val) cfg.requests = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-t") == 0 && has_val) cfg.max_tokens = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-s") == 0) cfg.stream = true;
+        else if (strcmp(argv[i], "--health") == 0) cfg.health = true;
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (cfg.connections <= 0 || cfg.requests <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    printf("=== OpenAI server load: %s:%d, %d connections, %d requests, %s ===\n\n",
+           cfg.host, cfg.port, cfg.connections, cfg.requests,
+           cfg.health ? "GET /health" : (cfg.stream ? "streaming" : "non-streaming"));
+
+    atomic_int next = 0, failures = 0;
+    double* latency = (double*)calloc((size_t)cfg.requests, sizeof(double));
+    double* ttft = (double*)calloc((size_t)cfg.requests, sizeof(double));
+    long* tokens = (long*)calloc((size_t)cfg.requests, sizeof(long));
+    pthread_t* threads = (pthread_t*)malloc((size_t)cfg.connections * sizeof(pthread_t));
+    if (!latency || !ttft || !tokens || !threads) {
+        fprintf(stderr, "allocation failed\n");
+        return 1;
+    }
+    Worker w = {&cfg, &next, latency, ttft, tokens, &failures};
+
+    double start = now_ms();
+    for (int i = 0; i < cfg.connections; i++)
+        pthread_create(&threads[i], NULL, worker_main, &w);
+    for (int i = 0; i < cfg.connections; i++)
+        pthread_join(threads[i], NULL);
+    double elapsed_s = (now_ms() - start) / 1e3;
+
+    /* Compact successful samples */
+    int ok = 0, with_ttft = 0;
+    long total_tokens = 0;
+    for (int i = 0; i < cfg.requests; i++) {
+        if (latency[i] <= 0.0) continue;
+        total_tokens += tokens[i];
+        if (ttft[i] > 0.0) ttft[with_ttft++] = ttft[i];
+        latency[ok++] = latency[i];
+    }
+
+    printf("  completed      %d (%d failed) in %.2f s\n", ok, atomic_load(&failures), elapsed_s);
+    printf("  throughput     %.1f req/s", ok / elapsed_s);
+    if (total_tokens > 0) printf(", %.1f tok/s", total_tokens / elapsed_s);
+    printf("\n");
+    print_percentiles("latency", latency, ok);
+    print_percentiles("first token", ttft, with_ttft);
+
+    free(latency);
+    free(ttft);
+    free(tokens);
+    free(threads);
+    return atomic_load(&failures) > 0 ? 1 : 0;
+}
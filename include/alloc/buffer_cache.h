@@ -0,0 +1,53 @@
+#ifndef CML_ALLOC_BUFFER_CACHE_H
+#define CML_ALLOC_BUFFER_CACHE_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Reuse cache for tensor output buffers.
+ *
+ * Requests are rounded to quarter-power-of-two size classes (64 B .. 64 MB).
+ * Each thread keeps a small magazine per class in front of a locked central
+ * pool, so concurrent graphs rarely touch the lock. Total cached bytes are
+ * capped by CML_BUFFER_CACHE_MB (default 1024). With CML_BUFFER_CACHE_ARENA_MB
+ * set, buffers of 1 MB and up are carved exactly from a TLSF arena instead.
+ */
+
+typedef struct CMLBufferCacheStats {
+    size_t hits;            /* Served from a magazine or the central pool */
+    size_t misses;          /* Fell through to malloc */
+    size_t magazine_hits;   /* Subset of hits that never took the lock */
+    size_t evictions;       /* Frees dropped because of the byte cap */
+    size_t arena_allocs;    /* Large buffers carved from the TLSF arena */
+    size_t bytes_cached;    /* Bytes currently parked in the cache */
+    size_t bytes_allocated; /* Bytes obtained from malloc over the lifetime */
+    size_t bytes_limit;     /* Current cap on bytes_cached */
+} CMLBufferCacheStats;
+
+/* Uses cached buffers when available, otherwise allocates new memory. */
+void* cml_buffer_cache_alloc(size_t size);
+
+/* Returns buffer to cache for future reuse. If cache is full, frees memory.
+   size must be the size passed to cml_buffer_cache_alloc. */
+void cml_buffer_cache_free(void* ptr, size_t size);
+
+/* Cap on bytes held by the cache; 0 disables caching. Excess is released. */
+void cml_buffer_cache_set_limit(size_t bytes);
+
+void cml_buffer_cache_get_stats(CMLBufferCacheStats* stats);
+
+void cml_print_buffer_cache_stats(void);
+
+/* Releases the central pool and the calling thread's magazines. Other
+   threads hand theirs back when they exit. */
+void cml_cleanup_buffer_cache(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CML_ALLOC_BUFFER_CACHE_H */
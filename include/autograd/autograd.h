@@ -122,6 +122,16 @@ typedef void (*ModuleBackwardHook)(struct Module* module, struct Tensor* grad);
 
 int tensor_register_backward_hook(struct Tensor* t, TensorBackwardHook hook);
 void tensor_remove_hooks(struct Tensor* t);
+
+/* Fires once per backward pass, as soon as t's gradient is final (after the
+ * last node that contributes to it), while the rest of backward still runs.
+ * Also fires when no node produced a gradient for t, so t->grad may be NULL. */
+typedef void (*TensorGradReadyHook)(struct Tensor* t, void* ctx);
+int tensor_register_grad_ready_hook(struct Tensor* t, TensorGradReadyHook hook, void* ctx);
+void tensor_remove_grad_ready_hook(struct Tensor* t, TensorGradReadyHook hook, void* ctx);
+bool tensor_has_backward_hooks(const struct Tensor* t);
+/* Runs t's backward and grad-ready hooks; called by the backward executor */
+void tensor_run_backward_hooks(struct Tensor* t);
 int module_register_backward_hook(struct Module* module, ModuleBackwardHook hook);
 void tensor_accumulate_grad(struct Tensor* tensor, struct Tensor* new_grad);
 struct Tensor* tensor_get_grad(struct Tensor* tensor);
@@ -3,6 +3,7 @@
 
 #include "tensor/tensor.h"
 #include <stdbool.h>
+#include <stddef.h>
 
 struct Module;
 typedef struct Module Module;
@@ -31,6 +32,51 @@ typedef struct CheckpointConfig {
 Tensor* checkpoint_forward(Module* module, Tensor* input);
 void sequential_apply_checkpointing(Sequential* seq, int every_n);
 
+/*
+ * Memory-budgeted checkpointing for Sequential models.
+ *
+ * Every layer is a segment whose input is always kept. The planner profiles
+ * one forward per segment on a sample input: IR buffer sizes and lifetimes
+ * go through the memory planner, FLOPs through the scheduler's cost model.
+ * It then marks segments whose activations are dropped after forward and
+ * rebuilt during backward, keeping the predicted peak under the budget with
+ * as little recompute as it can find.
+ */
+typedef struct CheckpointSegment {
+    size_t input_bytes; // Segment input, kept as the checkpoint
+    size_t saved_bytes; // IR buffers the segment holds for backward
+    size_t work_bytes;  // Lifetime-planned peak of those buffers (gradient working set)
+    size_t flops;       // Forward cost, paid again when recomputed
+    bool recompute;     // Drop activations after forward, rebuild in backward
+} CheckpointSegment;
+
+typedef struct CheckpointPlan {
+    Sequential* model;
+    CheckpointSegment* segments;
+    int num_segments;
+    size_t budget_bytes;    // 0 = no budget, keep everything
+    size_t predicted_peak;  // Activation bytes at the worst point of a step
+    size_t total_flops;     // Forward FLOPs of the whole model
+    size_t recompute_flops; // Extra FLOPs per step spent recomputing
+    bool fits;              // predicted_peak <= budget_bytes
+    size_t actual_peak;     // Measured by the last checkpoint_train_step
+} CheckpointPlan;
+
+typedef Tensor* (*CheckpointLossFn)(Tensor* output, Tensor* target, void* ctx);
+
+/* Profiles seq on sample_input (which should have the training batch shape)
+ * and plans for budget_bytes */
+CheckpointPlan* checkpoint_plan_create(Sequential* seq, Tensor* sample_input,
+                                       size_t budget_bytes);
+/* Re-plans from the existing profile; returns -1 if the budget cannot be met */
+int checkpoint_plan_set_budget(CheckpointPlan* plan, size_t budget_bytes);
+/* Forward, loss and backward following the plan; parameter gradients
+ * accumulate as with a plain backward */
+int checkpoint_train_step(CheckpointPlan* plan, Tensor* input, Tensor* target,
+                          CheckpointLossFn loss_fn, void* loss_ctx, float* loss_out);
+void checkpoint_plan_print(const CheckpointPlan* plan);
+void checkpoint_plan_free(CheckpointPlan* plan);
+
 #ifdef __cplusplus
 }
 #endif
@@ -57,13 +57,6 @@ typedef struct CMLBlasContext {
     void (*fn_set_threads)(int);
     int max_threads;
     int cur_threads;
-
-    /* Reusable pack scratch buffers — allocated lazily, grown as needed.
-     * Eliminates per-call aligned_alloc/free in the packed GEMM hot path. */
-    float*  pack_a_buf;
-    size_t  pack_a_size;
-    float*  pack_b_buf;
-    size_t  pack_b_size;
 } CMLBlasContext;
 
 bool cml_blas_available(void);
@@ -73,7 +66,10 @@ void cml_blas_free(CMLBlasContext* ctx);
 /* Lazy initialized singleton */
 CMLBlasContext* cml_blas_get_context(void);
 
-/* C = alpha * A @ B + beta * C */
+/* C = alpha * A @ B + beta * C
+ * Medium shapes run on the built-in packed kernel, split across the global
+ * thread pool by problem size (cap with CML_GEMM_THREADS). Pack scratch is
+ * per thread, so concurrent calls are safe. */
 int cml_blas_sgemm(CMLBlasContext* ctx, const float* A, const float* B, float* C, int M, int N,
                    int K, float alpha, float beta);
 
@@ -18,18 +18,40 @@ typedef struct {
     size_t total_size;
 } Task;
 
+typedef struct ThreadPoolConfig {
+    size_t num_threads;       /* Total parallelism incl. the calling thread (0 = online CPUs) */
+    bool pin_threads;         /* Pin worker i to CPU i+1 (Linux only) */
+    unsigned spin_iterations; /* Idle steal attempts before parking (0 = default) */
+} ThreadPoolConfig;
+
 /* @param num_threads Number of threads (0 for auto-detect) */
 ThreadPool* threadpool_create(size_t num_threads);
+ThreadPool* threadpool_create_ex(const ThreadPoolConfig* config);
 void threadpool_destroy(ThreadPool* pool);
 int threadpool_submit(ThreadPool* pool, Task* task);
 void threadpool_wait(ThreadPool* pool);
 size_t threadpool_get_num_threads(ThreadPool* pool);
+
+/* Per-thread cap on how many threads a parallel_for started from the calling
+ * thread may occupy (0 = whole pool). Used to split the pool between inter-op
+ * and intra-op parallelism. Returns the previous cap. */
+size_t threadpool_set_thread_budget(size_t max_threads);
+/* Threads a parallel_for issued from the calling thread would use on pool */
+size_t threadpool_get_thread_budget(ThreadPool* pool);
+/* Created on first use; honours CML_NUM_THREADS and CML_THREAD_PIN=1 */
 ThreadPool* threadpool_get_global(void);
 void threadpool_set_global(ThreadPool* pool);
 
-/* @param pool Thread pool (NULL for global) */
+/* @param pool Thread pool (NULL for global)
+ * Safe to call from inside a running task: the waiting thread keeps executing
+ * queued work instead of blocking. */
 void threadpool_parallel_for(ThreadPool* pool, TaskFunc func, void* data, size_t n);
 
+/* @param grain Minimum elements per chunk (0 = ~4 chunks per thread). Ranges
+ *              of at most one grain run inline on the caller. */
+void threadpool_parallel_for_grain(ThreadPool* pool, TaskFunc func, void* data, size_t n,
+                                   size_t grain);
+
 #ifdef __cplusplus
 }
 #endif
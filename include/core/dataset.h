@@ -72,6 +72,7 @@ typedef struct DataLoader {
     void* worker_threads;   // pthread_t* array for workers
     void* worker_contexts;  // WorkerContext* array
     int num_active_workers; // Number of active worker threads
+    void* batch_pool;       // BatchPool* of recycled full-size batches
 } DataLoader;
 
 typedef struct Batch {
@@ -81,6 +82,7 @@ typedef struct Batch {
     int batch_index; // Batch index
     int epoch;       // Current epoch
     void* user_data; // User-defined data
+    void* pool;      // Owning BatchPool (internal), NULL if not recycled
 } Batch;
 
 Dataset* dataset_create(void);
@@ -3,6 +3,7 @@
 
 #include "tensor/tensor.h"
 #include "nn.h"
+#include "core/weight_file.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -41,13 +42,20 @@ typedef enum {
 } GGUFTensorType;
 
 typedef struct GGUFContext GGUFContext;
+struct CMLQuantWeight;
 
 GGUFContext* gguf_open_read(const char* filepath);
+/* With opts->use_mmap, gguf_read_tensor returns unquantized tensors that point
+ * into the mapped file (owns_data = false); they stay valid until gguf_close. */
+GGUFContext* gguf_open_read_ex(const char* filepath, const CMLWeightLoadOptions* opts);
 GGUFContext* gguf_open_write(const char* filepath);
 void gguf_close(GGUFContext* ctx);
 int gguf_get_num_tensors(GGUFContext* ctx);
 const char* gguf_get_tensor_name(GGUFContext* ctx, int index);
 Tensor* gguf_read_tensor(GGUFContext* ctx, const char* name);
+/* Raw blocks of a 2-D tensor with a quantized matmul kernel, or NULL (absent,
+ * other type). Borrows from the mapping in mmap mode, like gguf_read_tensor. */
+struct CMLQuantWeight* gguf_read_quant_weight(GGUFContext* ctx, const char* name);
 int gguf_write_tensor(GGUFContext* ctx, const char* name, Tensor* tensor);
 int module_save_gguf(Module* module, const char* filepath);
 int module_load_gguf(Module* module, const char* filepath);
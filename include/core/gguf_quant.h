@@ -61,6 +61,40 @@ size_t gguf_quant_type_size(GGUFTensorType type);
 /* numel must be multiple of block size */
 int gguf_dequantize(GGUFTensorType type, const void* src, float* dst, size_t numel);
 
+float gguf_fp16_to_fp32(uint16_t h);
+
+/*
+ * Weight matrix kept in its GGUF block encoding for the quantized matmul
+ * kernels. Layout follows the file: ne[0] (cols) is the input dimension and
+ * each of the ne[1] rows (output features) is cols / block_size blocks.
+ */
+typedef struct CMLQuantWeight {
+    GGUFTensorType type;
+    int rows;
+    int cols;
+    size_t row_bytes;
+    const uint8_t* blocks;
+    void* owned; /* Private storage when not borrowing (e.g. from a mapping) */
+} CMLQuantWeight;
+
+/* Q4_0, Q4_K and Q8_0 have matmul kernels; other types are dequantized */
+bool cml_quant_matmul_supported(GGUFTensorType type);
+
+/* Borrows blocks if non-NULL, otherwise allocates rows * row_bytes to fill */
+CMLQuantWeight* cml_quant_weight_create(GGUFTensorType type, int rows, int cols,
+                                        const void* blocks);
+void cml_quant_weight_free(CMLQuantWeight* w);
+
+/*
+ * y[m, rows] = x[m, cols] @ W^T. Activations are quantized to int8 in blocks
+ * of 32 and the weight blocks are unpacked inside the integer dot product,
+ * so W is streamed from memory at its quantized size.
+ */
+int cml_quant_matmul(const CMLQuantWeight* w, const float* x, float* y, int m);
+
+/* Tensor wrapper: x [..., cols] -> [..., rows] */
+Tensor* cml_quant_linear(Tensor* x, const CMLQuantWeight* w);
+
 #ifdef __cplusplus
 }
 #endif
@@ -3,6 +3,7 @@
 
 #include "tensor/tensor.h"
 #include "nn.h"
+#include "core/weight_file.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -11,6 +12,10 @@ extern "C" {
 typedef struct SafeTensorsContext SafeTensorsContext;
 
 SafeTensorsContext* safetensors_open_read(const char* filepath);
+/* With opts->use_mmap, safetensors_read_tensor returns tensors that point into
+ * the mapped file (owns_data = false); they stay valid until safetensors_close. */
+SafeTensorsContext* safetensors_open_read_ex(const char* filepath,
+                                             const CMLWeightLoadOptions* opts);
 SafeTensorsContext* safetensors_open_write(const char* filepath);
 void safetensors_close(SafeTensorsContext* ctx);
 int safetensors_get_num_tensors(SafeTensorsContext* ctx);
@@ -0,0 +1,59 @@
+#ifndef CML_CORE_WEIGHT_FILE_H
+#define CML_CORE_WEIGHT_FILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Shared plumbing for the GGUF and safetensors readers: a read-only file
+ * mapping and a name -> tensor index hash. */
+
+typedef enum {
+    CML_MAP_ADVICE_NORMAL = 0,
+    CML_MAP_ADVICE_SEQUENTIAL, /* Weights streamed once front to back */
+    CML_MAP_ADVICE_RANDOM,     /* Layers touched out of order */
+    CML_MAP_ADVICE_WILLNEED,   /* Start reading ahead now */
+} CMLMapAdvice;
+
+typedef struct CMLWeightLoadOptions {
+    bool use_mmap;       /* Tensors alias the mapping (owns_data = false) */
+    bool prefetch;       /* Ask the kernel to read the data section ahead */
+    CMLMapAdvice advice; /* Access pattern hint for the data section */
+} CMLWeightLoadOptions;
+
+/* Private copy-on-write mapping: reads share the page cache with every
+ * other process mapping the file, writes stay local. */
+typedef struct CMLMappedFile {
+    uint8_t* base;
+    size_t size;
+} CMLMappedFile;
+
+/* NULL when mapping is unsupported on this platform or fails */
+CMLMappedFile* cml_mapped_file_open(const char* path);
+void cml_mapped_file_close(CMLMappedFile* map);
+void cml_mapped_file_advise(CMLMappedFile* map, size_t offset, size_t length,
+                            CMLMapAdvice advice);
+
+/* Open-addressed index over caller-owned name strings */
+typedef struct CMLNameIndex {
+    const char** keys;
+    int* values;
+    size_t mask;
+} CMLNameIndex;
+
+int cml_name_index_init(CMLNameIndex* index, size_t expected);
+void cml_name_index_free(CMLNameIndex* index);
+/* Keeps the first value for duplicate names, like the linear scan it replaces */
+int cml_name_index_insert(CMLNameIndex* index, const char* name, int value);
+/* Returns -1 if absent */
+int cml_name_index_find(const CMLNameIndex* index, const char* name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CML_CORE_WEIGHT_FILE_H
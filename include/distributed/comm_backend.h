@@ -16,6 +16,11 @@ DistCommOps* cml_dist_create_mpi_backend(void);
 
 DistCommOps* cml_dist_create_gloo_backend(void);
 
+/* Ranks on this host that Gloo reaches through shared memory (including
+ * this one); 1 when every peer is over TCP. Set CML_SHM_TRANSPORT=0 to
+ * disable the shared-memory path. */
+int cml_dist_gloo_local_size(void);
+
 void cml_dist_free_backend(DistCommOps* ops);
 
 /* Tries NCCL first, then MPI, then Gloo. */
@@ -13,7 +13,9 @@ typedef struct {
     size_t bucket_size_bytes;    /* Gradient bucket size (default: 25MB) */
     bool broadcast_buffers;      /* Broadcast non-parameter buffers */
     bool find_unused_parameters; /* Find and skip unused params */
-    int gradient_as_bucket_view; /* Use gradient views (memory efficient) */
+    int gradient_as_bucket_view; /* Gradients live in bucket memory (no pack/unpack copies) */
+    int zero_stage;              /* With cml_ddp_shard_optimizer: 1 shards optimizer state,
+                                  * 2 also frees gradients after reduce-scatter; 0 = off */
 } DDPConfig;
 
 typedef struct CMLDataParallel {
@@ -32,6 +34,31 @@ typedef struct CMLDataParallel {
     int num_params;             /* Number of parameters */
     int* param_to_bucket;       /* Map param index -> bucket index */
 
+    /* Overlap with backward: buckets fill in reverse parameter order as
+     * gradients become final and are reduced asynchronously meanwhile. */
+    Tensor** bucket_tensors;    /* 1-D tensors over the bucket buffers */
+    size_t* param_offsets;      /* Param index -> offset inside its bucket */
+    int* bucket_pending;        /* Params not yet ready in this pass */
+    bool* param_ready;          /* Param reported ready in this pass */
+    DistWork** bucket_work;     /* In-flight allreduce per bucket */
+    int next_launch;            /* Buckets launch strictly in index order */
+    bool require_sync;          /* false while accumulating gradients locally */
+    void* hook_refs;            /* Per-param hook context */
+
+    /* ZeRO: rank r owns chunk r of every bucket, each bucket padded to
+     * world_size chunks of shard_sizes[b] floats */
+    size_t* shard_sizes;        /* Chunk length per bucket (zero_stage > 0) */
+    Optimizer* optimizer;       /* Sharded optimizer (hyperparameters only), or NULL */
+    int shard_rule;             /* CMLFlatRule of the sharded update */
+    int* param_group;           /* Param index -> optimizer group, -1 if not optimized */
+    size_t* shard_offsets;      /* Bucket -> offset into the shard arrays */
+    size_t shard_numel;         /* Owned floats over all buckets */
+    float* shard_grads;         /* Reduced gradients of the owned chunks */
+    float* shard_state[3];      /* exp_avg, exp_avg_sq, max_exp_avg_sq of the owned chunks */
+    Tensor** shard_grad_views;  /* Per bucket, over shard_grads */
+    float** param_buckets;      /* Parameters live here (the tensors are views) */
+    Tensor** gather_views;      /* [bucket * world_size + rank] chunks of param_buckets */
+
     bool initialized;
 } CMLDataParallel;
 
@@ -43,9 +70,27 @@ CMLDataParallel* cml_ddp_create(Module* module, const DDPConfig* config);
 Tensor* cml_ddp_forward(CMLDataParallel* ddp, Tensor* input);
 
 /* Bucketed all-reduce of gradients, averaged by world_size.
- * Call after tensor_backward() and before optimizer_step(). */
+ * Call after tensor_backward() and before optimizer_step(). Buckets whose
+ * gradients were all final during backward are already in flight; this
+ * launches the rest and waits for everything. */
 int cml_ddp_sync_gradients(CMLDataParallel* ddp);
 
+/* With false, backward passes only accumulate locally (no bucket launches);
+ * set back to true before the last micro-batch's backward. */
+void cml_ddp_set_require_sync(CMLDataParallel* ddp, bool require_sync);
+
+/* ZeRO (config.zero_stage > 0): this rank keeps Adam/AdamW state for only
+ * its 1/world_size of the flattened parameters, and cml_ddp_step replaces
+ * cml_ddp_sync_gradients + optimizer_step: gradients are reduce-scattered,
+ * each rank updates its shard, and the parameters are allgathered. The
+ * optimizer supplies hyperparameters, clipping and grad scaling; its own
+ * state is never allocated. Parameters become views into DDP buffers until
+ * cml_ddp_free. Parameter gradients stay local (unreduced), and with stage
+ * 2 they are freed by the step. */
+int cml_ddp_shard_optimizer(CMLDataParallel* ddp, Optimizer* optimizer);
+
+int cml_ddp_step(CMLDataParallel* ddp);
+
 /* Does NOT free the underlying module. */
 void cml_ddp_free(CMLDataParallel* ddp);
 
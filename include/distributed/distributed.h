@@ -78,6 +78,10 @@ int cml_dist_broadcast(Tensor* tensor, int src_rank);
 
 int cml_dist_allgather(Tensor** output, Tensor* input);
 
+/* output receives this rank's ceil(numel / world_size) chunk of the
+ * reduced input */
+int cml_dist_reduce_scatter(Tensor* output, Tensor* input, DistReduceOp op);
+
 int cml_dist_barrier(void);
 
 DistWork* cml_dist_allreduce_async(Tensor* tensor, DistReduceOp op);
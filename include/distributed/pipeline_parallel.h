@@ -15,12 +15,47 @@ typedef struct PipelineStage {
     int stage_id;           /* Stage index */
 } PipelineStage;
 
+typedef enum {
+    PIPELINE_SCHEDULE_GPIPE = 0,   /* All forwards, then all backwards */
+    PIPELINE_SCHEDULE_1F1B,        /* Warm-up forwards, then one forward / one backward */
+    PIPELINE_SCHEDULE_INTERLEAVED, /* 1F1B over several stages (model chunks) per worker */
+} PipelineSchedule;
+
 typedef struct {
     int num_micro_batches;  /* Number of micro-batches (default: 4) */
     int num_stages;         /* Number of pipeline stages */
-    bool interleaved;       /* Use interleaved schedule (1F1B) */
+    bool interleaved;       /* Same as schedule = PIPELINE_SCHEDULE_INTERLEAVED */
+    PipelineSchedule schedule; /* Used by cml_pipeline_train_step */
+    int num_workers;        /* Pipeline ranks; stage s runs on worker s % num_workers.
+                             * 0 = the default group's world size when it has
+                             * several ranks, else num_stages (num_stages / 2 when
+                             * interleaved) */
 } PipelineConfig;
 
+typedef enum {
+    PIPELINE_OP_FORWARD = 0,
+    PIPELINE_OP_BACKWARD,
+} PipelineOpType;
+
+typedef struct {
+    PipelineOpType type;
+    int stage;
+    int micro_batch;
+} PipelineOp;
+
+/* Timing of the last cml_pipeline_train_step. With one rank per worker
+ * these are this rank's measurements; when every worker runs in this
+ * process they come from replaying the measured op times on a timeline
+ * with one lane per worker, i.e. what the pipelined run would take. */
+typedef struct {
+    double step_ms;               /* Wall time (or timeline length) of the step */
+    double compute_ms;            /* Forward/backward time per worker */
+    double bubble_ms;             /* step_ms - compute_ms: idle, waiting on neighbours */
+    double bubble_fraction;       /* bubble_ms / step_ms */
+    double ideal_bubble_fraction; /* The schedule's bubble with equal stage costs */
+    int peak_in_flight;           /* Most micro-batches holding activations on a worker */
+} PipelineStats;
+
 typedef struct CMLPipelineParallel {
     PipelineStage* stages;       /* Array of stages */
     int num_stages;              /* Number of stages */
@@ -30,8 +65,18 @@ typedef struct CMLPipelineParallel {
     /* Micro-batch buffers */
     Tensor*** micro_batch_outputs; /* [stage][micro_batch] */
     int num_micro_batches;
+
+    /* Scheduled training (cml_pipeline_train_step) */
+    PipelineSchedule schedule;
+    int num_workers;
+    int worker;                  /* This rank's worker, or -1 when all run here */
+    PipelineStats stats;
 } CMLPipelineParallel;
 
+/* Loss of one micro-batch; the mean over its rows keeps the step's
+ * gradient equal to that of the whole batch */
+typedef Tensor* (*PipelineLossFn)(Tensor* output, Tensor* target, void* ctx);
+
 CMLPipelineParallel* cml_pipeline_create(PipelineStage* stages, int num_stages,
                                           const PipelineConfig* config);
 
@@ -39,6 +84,32 @@ Tensor* cml_pipeline_forward(CMLPipelineParallel* pipeline, Tensor* input);
 
 int cml_pipeline_backward(CMLPipelineParallel* pipeline, Tensor* grad_output);
 
+/*
+ * Forward and backward of every micro-batch under the configured schedule,
+ * accumulating parameter gradients (the mean of the micro-batch losses).
+ * Each stage input and output lives only from its forward to its backward,
+ * so 1F1B keeps at most num_workers - worker micro-batches in flight.
+ *
+ * With a default group of num_workers ranks each rank runs its own worker:
+ * activations and gradients go to the neighbouring ranks through the
+ * backend's send/recv on background threads, overlapping with compute.
+ * input is only read on the rank holding stage 0 and target on the one
+ * holding the last stage; stage modules of other ranks may be NULL.
+ * Otherwise all workers run here, in schedule order.
+ *
+ * loss_out (optional) receives the mean loss where the last stage runs.
+ */
+int cml_pipeline_train_step(CMLPipelineParallel* pipeline, Tensor* input, Tensor* target,
+                            PipelineLossFn loss_fn, void* loss_ctx, float* loss_out);
+
+/* The op sequence of one worker; returns the op count, or -1 if the
+ * arguments are invalid or max_ops is too small */
+int cml_pipeline_build_schedule(PipelineSchedule schedule, int num_stages, int num_workers,
+                                int num_micro_batches, int worker, PipelineOp* ops,
+                                int max_ops);
+
+int cml_pipeline_get_stats(const CMLPipelineParallel* pipeline, PipelineStats* stats);
+
 void cml_pipeline_free(CMLPipelineParallel* pipeline);
 
 #ifdef __cplusplus
@@ -11,6 +11,45 @@ extern "C" {
 int cml_ring_allreduce(float* data, size_t count, int world_size, int rank,
                        DistReduceOp op, DistCommOps* ops, void* ctx);
 
+/*
+ * The two halves of the ring on their own. data holds world_size chunks of
+ * ceil(count / world_size) floats (the last may be short); after the
+ * reduce-scatter chunk `rank` holds the reduction (averaged for AVG) and
+ * the rest is scratch, and the all-gather fills every chunk from its owner.
+ */
+int cml_ring_reduce_scatter(float* data, size_t count, int world_size, int rank,
+                            DistReduceOp op, DistCommOps* ops, void* ctx);
+int cml_ring_allgather(float* data, size_t count, int world_size, int rank, DistCommOps* ops,
+                       void* ctx);
+
+/*
+ * Group variants: ranks[0..n) are the members' global ranks (as passed to
+ * ops->send/recv) and index is this process's position among them. A NULL
+ * ranks array means global ranks 0..n-1.
+ */
+int cml_ring_allreduce_group(float* data, size_t count, const int* ranks, int n, int index,
+                             DistReduceOp op, DistCommOps* ops, void* ctx);
+
+/* Reduce onto ranks[0]; AVG is treated as SUM (no scaling) */
+int cml_tree_reduce(float* data, size_t count, const int* ranks, int n, int index,
+                    DistReduceOp op, DistCommOps* ops, void* ctx);
+
+/* Broadcast from ranks[0] */
+int cml_tree_broadcast(float* data, size_t count, const int* ranks, int n, int index,
+                       DistCommOps* ops, void* ctx);
+
+/* Reduce within the node onto its leader (local_ranks[0]), allreduce across
+ * the node leaders, then broadcast back within the node. */
+int cml_hierarchical_allreduce(float* data, size_t count, const int* local_ranks,
+                               int local_size, int local_index, const int* leader_ranks,
+                               int num_nodes, int node_index, int world_size, DistReduceOp op,
+                               DistCommOps* ops, void* ctx);
+
+/* The collectives keep receive scratch and the pipelined ring's transfer
+ * threads per ctx between calls; this stops and frees them once the
+ * communicator behind ctx is torn down. */
+void cml_ring_release(void* ctx);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,47 @@
+#ifndef CML_SHM_TRANSPORT_H
+#define CML_SHM_TRANSPORT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Intra-node transport over one POSIX shared-memory segment.
+ *
+ * The segment holds a lock-free single-producer/single-consumer byte ring
+ * for every ordered pair of local ranks, so each direction between two
+ * processes is an independent stream: send copies into the ring, recv
+ * copies out, and neither goes through the kernel. Messages larger than a
+ * ring simply stream through it.
+ */
+
+#define CML_SHM_DEFAULT_RING_BYTES (1u << 20)
+
+typedef struct CMLShmTransport CMLShmTransport;
+
+/* Local rank 0 creates the segment (ring_bytes per ordered pair, rounded
+ * up to a power of two; 0 picks the default) and the others attach to the
+ * same name once it exists. */
+CMLShmTransport* cml_shm_open(const char* name, int local_rank, int local_size,
+                              size_t ring_bytes);
+
+/* Removes the segment's name so nothing outlives the job; the mapping
+ * lives on until the last rank frees it. Only the creator's call does
+ * anything, and it must wait until every rank has attached. */
+void cml_shm_unlink(CMLShmTransport* shm);
+
+void cml_shm_free(CMLShmTransport* shm);
+
+/* Both block until len bytes have moved, and fail with -1 if the peer has
+ * freed its end or its process has exited while they wait. */
+int cml_shm_send(CMLShmTransport* shm, int dst_local, const void* buf, size_t len);
+int cml_shm_recv(CMLShmTransport* shm, int src_local, void* buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CML_SHM_TRANSPORT_H */
@@ -26,6 +26,12 @@ typedef struct Conv2d {
 Conv2d* nn_conv2d(int in_channels, int out_channels, int kernel_size, int stride, int padding,
                   int dilation, bool use_bias, DType dtype, DeviceType device);
 
+/* groups must divide both channel counts; groups == in_channels == out_channels
+ * is a depthwise convolution */
+Conv2d* nn_conv2d_grouped(int in_channels, int out_channels, int kernel_size, int stride,
+                          int padding, int dilation, int groups, bool use_bias, DType dtype,
+                          DeviceType device);
+
 #ifdef __cplusplus
 }
 #endif
@@ -40,6 +40,16 @@ typedef struct CMLLLaMALayer {
     Tensor* up_proj;      /* [hidden_size, intermediate_size] */
     Tensor* down_proj;    /* [intermediate_size, hidden_size] */
 
+    /* Quantized projections, used in place of the tensors above when the GGUF
+     * file stores them as Q4_0/Q4_K/Q8_0 blocks */
+    struct CMLQuantWeight* q_proj_quant;
+    struct CMLQuantWeight* k_proj_quant;
+    struct CMLQuantWeight* v_proj_quant;
+    struct CMLQuantWeight* o_proj_quant;
+    struct CMLQuantWeight* gate_proj_quant;
+    struct CMLQuantWeight* up_proj_quant;
+    struct CMLQuantWeight* down_proj_quant;
+
     /* Layer norms */
     Tensor* input_layernorm;   /* RMSNorm weight [hidden_size] */
     Tensor* post_attn_layernorm; /* RMSNorm weight [hidden_size] */
@@ -55,6 +65,7 @@ typedef struct CMLLLaMAModel {
     Tensor* embed_tokens;  /* [vocab_size, hidden_size] */
     Tensor* norm;          /* Final RMSNorm weight [hidden_size] */
     Tensor* lm_head;       /* [hidden_size, vocab_size] (may share embed_tokens) */
+    struct CMLQuantWeight* lm_head_quant; /* Block-quantized lm_head, if any */
 
     /* Layers */
     CMLLLaMALayer** layers;
@@ -63,6 +74,9 @@ typedef struct CMLLLaMAModel {
     /* Tokenizer */
     CMLTokenizer* tokenizer;
 
+    /* Open GGUF file when weights alias its mapping (closed by cml_llama_free) */
+    struct GGUFContext* weights_file;
+
     /* State */
     bool weights_loaded;
     int current_seq_len;   /* Current position in generation */
@@ -96,6 +110,20 @@ Tensor* cml_llama_forward(CMLLLaMAModel* model, const int* token_ids, int seq_le
 Tensor* cml_llama_layer_forward(CMLLLaMAModel* model, CMLLLaMALayer* layer,
                                  Tensor* hidden, int start_pos);
 
+struct CMLPagedKVCache;
+
+/*
+ * Forward pass for several sequences at once over paged KV caches, one cache
+ * per layer (continuous batching). tokens packs num_tokens[i] new tokens of
+ * each sequence back to back; sequence i continues at the current length of
+ * layer_seq_ids[l][i] in layer_caches[l] and its K/V are appended there. All
+ * tokens share each layer's projections. Writes the logits of every
+ * sequence's last token to logits [num_seqs, vocab_size]. Returns 0 or -1.
+ */
+int cml_llama_forward_paged(CMLLLaMAModel* model, struct CMLPagedKVCache* const* layer_caches,
+                            const int* const* layer_seq_ids, const int* tokens,
+                            const int* num_tokens, int num_seqs, float* logits);
+
 CMLGenerationResult* cml_llama_generate(CMLLLaMAModel* model, const char* prompt,
                                           const CMLGenerationConfig* config);
 void cml_generation_result_free(CMLGenerationResult* result);
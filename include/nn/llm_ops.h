@@ -93,15 +93,28 @@ typedef struct CMLMoEConfig {
     int top_k;             /* Number of experts to route to */
     int input_dim;         /* Input dimension */
     int hidden_dim;        /* Expert hidden dimension */
-    float capacity_factor; /* Load balancing capacity factor */
+    float capacity_factor; /* Per-expert cap: ceil(factor * tokens * top_k / num_experts), 0 = none */
     bool normalize_weights;/* Normalize gating weights to sum to 1 */
 } CMLMoEConfig;
 
+/* Routing statistics of the last forward pass */
+typedef struct CMLMoEStats {
+    int num_tokens;
+    int num_routed;        /* Token-expert assignments that were computed */
+    int num_dropped;       /* Assignments over capacity */
+    int capacity;          /* Per-expert token limit (0 = unlimited) */
+    int max_load;          /* Tokens on the busiest expert */
+    int min_load;          /* Tokens on the idlest expert */
+    float imbalance;       /* max_load / mean load, 1 = perfectly balanced */
+} CMLMoEStats;
+
 typedef struct CMLMoELayer {
     CMLMoEConfig config;
     Tensor* gate_weight;           /* [input_dim, num_experts] - gating network */
     Tensor** expert_w1;            /* [num_experts] x [input_dim, hidden_dim] */
     Tensor** expert_w2;            /* [num_experts] x [hidden_dim, input_dim] */
+    int* expert_load;              /* [num_experts] tokens per expert, last forward */
+    CMLMoEStats stats;
     int ref_count;
 } CMLMoELayer;
 
@@ -110,11 +123,19 @@ CMLMoELayer* cml_moe_create(const CMLMoEConfig* config);
 void cml_moe_free(CMLMoELayer* moe);
 
 /** MoE forward pass
+ * Tokens are grouped by expert into contiguous buffers, each expert runs
+ * two GEMMs over its slice, experts run in parallel on the thread pool and
+ * the results are combined with the top-k weights in one pass.
  * input: [batch, seq_len, input_dim]
  * Returns: [batch, seq_len, input_dim]
  */
 Tensor* cml_moe_forward(CMLMoELayer* moe, Tensor* input);
 
+/** Routing statistics of the last forward pass
+ * expert_load (optional): [num_experts] tokens each expert processed
+ */
+int cml_moe_get_stats(const CMLMoELayer* moe, CMLMoEStats* stats, int* expert_load);
+
 /** Get expert routing (for debugging/analysis)
  * Returns gating weights: [batch * seq_len, num_experts]
  */
@@ -132,6 +153,7 @@ typedef struct CMLTokenizer {
     int num_merges;
     int* token_to_id;      /* Hash-based token to ID lookup (internal) */
     int hash_size;
+    void* bpe;             /* Byte map and pair -> rank table (internal) */
     /* Special tokens */
     int bos_token_id;
     int eos_token_id;
@@ -144,14 +166,33 @@ CMLTokenizer* cml_tokenizer_create(char** vocab, int vocab_size,
 
 void cml_tokenizer_free(CMLTokenizer* tok);
 
+/** Byte-level BPE encode
+ * The text is split into words (a run of letters, digits or punctuation with
+ * at most one leading space, or a run of whitespace) and merges never cross a
+ * word boundary. Within a word the lowest-ranked adjacent pair is merged
+ * first, leftmost on ties. Merge rules whose result is not in the vocab are
+ * ignored. Returns a malloc'd array, or NULL for empty text.
+ */
 int* cml_tokenizer_encode(CMLTokenizer* tok, const char* text, int* num_tokens);
 
+/** Encode num_texts prompts across the thread pool
+ * tokens[i] receives a malloc'd array (NULL for empty text), owned by the
+ * caller, and num_tokens[i] its length. Returns 0, or -1 if any prompt
+ * failed, in which case nothing is left allocated and every tokens[i] is NULL.
+ */
+int cml_tokenizer_encode_batch(CMLTokenizer* tok, const char* const* texts, int num_texts,
+                               int** tokens, int* num_tokens);
+
 char* cml_tokenizer_decode(CMLTokenizer* tok, const int* tokens, int num_tokens);
 
 void cml_tokenizer_set_special(CMLTokenizer* tok, int bos, int eos, int pad, int unk);
 
 int cml_tokenizer_vocab_size(const CMLTokenizer* tok);
 
+/* Frees the word caches of every thread that has encoded, pool workers
+ * included. No tokenizer may be encoding at the time. */
+void cml_tokenizer_cleanup(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -8,15 +8,24 @@
 extern "C" {
 #endif
 
+/*
+ * Single-threaded epoll server: connections are non-blocking and keep-alive,
+ * and chat completions are handed to a continuous-batching engine so that
+ * concurrent requests share forward passes. Streamed responses are written
+ * as SSE events over chunked transfer encoding as tokens come out.
+ */
 typedef struct CMLOpenAIServer {
     int port;
     int listen_fd;
-    bool running;
+    int wake_fd;          /* eventfd that interrupts the loop on stop */
+    volatile bool running;
     void* model;
     void* tokenizer;
     int max_tokens;
     float temperature;
     float top_p;
+    int max_batch_size;   /* Generations sharing a forward pass (default 8) */
+    int kv_cache_tokens;  /* Paged KV capacity over all sequences (default 4096) */
     char model_name[128];
     char model_path[512];
 } CMLOpenAIServer;
@@ -73,9 +73,30 @@ void cml_paged_cache_free_sequence(CMLPagedKVCache* cache, int seq_id);
 int cml_paged_cache_append(CMLPagedKVCache* cache, int seq_id,
                             const float* key, const float* value);
 
+/* Single sequence: Q is [1, seq_len, num_heads*head_dim] */
 Tensor* cml_paged_gqa_forward(CMLPagedKVCache* cache, int seq_id,
                                Tensor* Q, const CMLGQAConfig* config);
 
+/*
+ * Attention for several sequences at once (continuous batching). Q packs the
+ * new query rows of every sequence back to back: q_lens[i] rows for
+ * seq_ids[i], num_heads*head_dim floats per row, in any shape whose last dim
+ * is num_heads*head_dim (e.g. [num_seqs, 1, H*D] for decode or
+ * [total_tokens, H*D] for ragged prefill). The queries of a sequence are its
+ * last q_lens[i] cached positions. Output has the shape of Q.
+ *
+ * Blocks are streamed with an online softmax (no [seq_q, kv_len] score
+ * buffer) and (sequence, kv-head) pairs run in parallel on the thread pool.
+ */
+Tensor* cml_paged_gqa_forward_batch(CMLPagedKVCache* cache, const int* seq_ids,
+                                     const int* q_lens, int num_seqs, Tensor* Q,
+                                     const CMLGQAConfig* config);
+
+/* Raw form of the above on contiguous float32 rows; returns 0 or -1 */
+int cml_paged_attention_batch(CMLPagedKVCache* cache, const int* seq_ids, const int* q_lens,
+                              int num_seqs, const float* q, float* out,
+                              const CMLGQAConfig* config);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,8 +1,14 @@
 /*
  * Continuous batching / serving scheduler for LLM inference.
  * Handles request queuing, batch admission, and lifecycle tracking.
- * The actual forward pass / token generation is NOT done here; this is
- * purely the scheduling and bookkeeping layer.
+ *
+ * Without a forward function the context is only the bookkeeping layer:
+ * cml_serving_step admits requests and the caller drives generation. With
+ * one (cml_serving_set_forward) each step is a full iteration: a token
+ * budget is split between decode tokens and chunked prefill, requests are
+ * admitted only while the paged KV pool can hold their prompt, running
+ * sequences are preempted (swap or recompute) when the pool runs out, and
+ * the model is called once on the mixed batch.
  */
 
 #ifndef CML_NN_SERVING_H
@@ -10,6 +16,7 @@
 
 #include "tensor/tensor.h"
 #include "nn/llm_ops.h"
+#include <stdbool.h>
 #include <stddef.h>
 
 #ifdef __cplusplus
@@ -20,6 +27,7 @@ typedef struct CMLPagedKVCache CMLPagedKVCache;
 
 #define CML_SERVING_MAX_BATCH 64
 #define CML_SERVING_MAX_QUEUE 1024
+#define CML_SERVING_LATENCY_WINDOW 4096 /* Samples kept for percentiles */
 
 typedef enum {
     CML_SEQ_STATUS_QUEUED = 0,
@@ -27,8 +35,14 @@ typedef enum {
     CML_SEQ_STATUS_DECODING,
     CML_SEQ_STATUS_FINISHED,
     CML_SEQ_STATUS_ERROR,
+    CML_SEQ_STATUS_SWAPPED,  /* Preempted, KV copied out of the block pool */
 } CMLSequenceStatus;
 
+typedef enum {
+    CML_PREEMPT_RECOMPUTE = 0, /* Drop the KV and prefill prompt+output again */
+    CML_PREEMPT_SWAP,          /* Copy the KV out and restore it later */
+} CMLPreemptMode;
+
 typedef struct CMLSequenceRequest {
     int request_id;
     int* prompt_tokens;
@@ -45,9 +59,17 @@ typedef struct CMLSequenceRequest {
     int gen_capacity;
     int current_pos;         /* Position in generation */
 
+    /* Scheduler state (forward-loop mode) */
+    int num_computed;        /* Tokens whose K/V are in the paged cache */
+    int prefill_target;      /* Tokens to prefill before decoding */
+    int num_preemptions;
+    float* swap_keys;        /* [num_computed, kv_heads * head_dim] while swapped */
+    float* swap_values;
+
     /* Timing */
     double submit_time_ms;
     double first_token_time_ms;
+    double last_token_time_ms;
     double finish_time_ms;
 } CMLSequenceRequest;
 
@@ -59,6 +81,19 @@ typedef struct CMLServingStats {
     double avg_time_to_first_token_ms;
     double avg_tokens_per_second;
     double total_time_ms;
+
+    /* Forward-loop mode */
+    size_t num_steps;
+    size_t prefill_tokens;
+    size_t decode_tokens;
+    size_t num_preemptions;
+    size_t num_swaps;
+    /* Over the last CML_SERVING_LATENCY_WINDOW samples */
+    double p50_time_to_first_token_ms;
+    double p99_time_to_first_token_ms;
+    double avg_inter_token_latency_ms;
+    double p50_inter_token_latency_ms;
+    double p99_inter_token_latency_ms;
 } CMLServingStats;
 
 typedef struct CMLServingConfig {
@@ -68,8 +103,35 @@ typedef struct CMLServingConfig {
     int max_new_tokens_default;
     float temperature_default;
     float top_p_default;
+
+    /* Forward-loop mode */
+    int max_batch_tokens;    /* Token budget per step (decode + prefill) */
+    int prefill_chunk_size;  /* Max prompt tokens per sequence per step */
+    int eos_token_id;        /* Finishes a request when sampled (-1: none) */
+    CMLPreemptMode preempt_mode;
 } CMLServingConfig;
 
+/* Work for one sequence in a step: a prefill chunk or a single decode token */
+typedef struct CMLServingBatchEntry {
+    int request_id;
+    int paged_seq_id;        /* Sequence in the paged KV cache (-1 without one) */
+    const int* tokens;
+    int num_tokens;
+    int start_pos;           /* Position of tokens[0] in the sequence */
+    bool wants_token;        /* Sample the next token after the last position */
+    float temperature;
+    float top_p;
+} CMLServingBatchEntry;
+
+/*
+ * Runs the model on one mixed batch. It must append the K/V of every fed
+ * token to entries[i].paged_seq_id and write next_tokens[i] for each entry
+ * with wants_token. Returns 0 on success.
+ */
+typedef int (*CMLServingForwardFn)(void* user_data, CMLPagedKVCache* cache,
+                                   const CMLServingBatchEntry* entries, int num_entries,
+                                   int* next_tokens);
+
 typedef struct CMLServingContext {
     CMLServingConfig config;
 
@@ -87,6 +149,26 @@ typedef struct CMLServingContext {
     /* Paged KV cache (not owned, set externally) */
     CMLPagedKVCache* kv_cache;
 
+    /* Forward loop */
+    CMLServingForwardFn forward;
+    void* forward_user_data;
+    CMLSequenceRequest** swapped;     /* Preempted by swap, FIFO */
+    int num_swapped;
+    CMLSequenceRequest** finished;    /* Done, awaiting cml_serving_finish_request */
+    int num_finished;
+    int finished_capacity;
+    CMLServingBatchEntry* entries;    /* Per-step scratch */
+    CMLSequenceRequest** entry_reqs;
+    int* entry_tokens;
+    int* next_tokens;
+
+    /* Latency samples (rings of CML_SERVING_LATENCY_WINDOW) */
+    double* ttft_samples;
+    double* itl_samples;
+    size_t num_ttft_samples;
+    size_t num_itl_samples;
+    double itl_total_ms;
+
     /* Stats */
     CMLServingStats stats;
     int next_request_id;
@@ -106,6 +188,14 @@ void cml_serving_set_kv_cache(CMLServingContext* ctx, CMLPagedKVCache* cache);
 int cml_serving_submit(CMLServingContext* ctx, const int* prompt_tokens,
                        int num_tokens, int max_new_tokens);
 
+/* Per-request sampling parameters (defaults come from the config) */
+int cml_serving_set_sampling(CMLServingContext* ctx, int request_id,
+                             float temperature, float top_p);
+
+/* Hands the forward pass to the context; NULL returns to bookkeeping mode */
+void cml_serving_set_forward(CMLServingContext* ctx, CMLServingForwardFn forward,
+                             void* user_data);
+
 /* Run one scheduling iteration. Returns number of active sequences. */
 int cml_serving_step(CMLServingContext* ctx);
 
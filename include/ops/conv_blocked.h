@@ -0,0 +1,99 @@
+/*
+ * Channel-blocked direct convolution.
+ *
+ * Activations are reordered to nChw8c (nChw16c with AVX-512): channels are
+ * split into blocks of CML_CONV_BLOCK, stored innermost, so one vector holds
+ * the same pixel of a whole channel block. Weights are packed to OIhw-i-o
+ * blocks, once per (tensor, version) when the caller names the tensor. The
+ * microkernel accumulates a tile of output pixels for two output-channel
+ * blocks in registers, straight from the blocked input, so there is no
+ * im2col buffer: scratch is the blocked input (with its padding halo), the
+ * blocked output and the packed weights.
+ *
+ * A graph run can keep a blocked output for the node that reads it next: the
+ * producer stores it under (its node, the run's epoch), optionally without
+ * writing NCHW at all, a ReLU rectifies it in place and passes it on, and the
+ * consuming convolution reads it without the NCHW -> blocked reorder. Nothing
+ * outlives cml_conv_blocked_graph_end for the epoch.
+ */
+
+#ifndef CML_OPS_CONV_BLOCKED_H
+#define CML_OPS_CONV_BLOCKED_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__AVX512F__)
+#define CML_CONV_BLOCK 16
+#else
+#define CML_CONV_BLOCK 8
+#endif
+
+typedef struct {
+    int batch, in_channels, in_h, in_w;
+    int out_channels, out_h, out_w;
+    int kernel_h, kernel_w;
+    int stride_h, stride_w;
+    int pad_h, pad_w;
+    int dilation_h, dilation_w;
+} ConvBlockedShape;
+
+/* Whether the blocked path should run this convolution. CML_CONV_LAYOUT=nchw
+ * turns it off, CML_CONV_LAYOUT=blocked takes every ungrouped convolution. */
+bool cml_conv_blocked_applicable(const ConvBlockedShape* s, int groups);
+
+/* Where a convolution in a planned chain takes its input and leaves its
+ * output. Keys name graph nodes; epoch is from cml_conv_blocked_graph_begin. */
+typedef struct {
+    const void* in_key;      /* Producer whose kept output is the input, or NULL */
+    const void* out_key;     /* Keep the blocked output for this node, or NULL */
+    uint64_t epoch;
+    bool skip_output;        /* With out_key: leave the NCHW output unwritten */
+    const void* weight_key;  /* Pack weights once per (weight_key, weight_version) */
+    uint64_t weight_version; /* 0 = untracked: pack per call */
+} ConvBlockedIO;
+
+/*
+ * input:  [batch, in_channels, in_h, in_w]
+ * weight: [out_channels, in_channels, kernel_h, kernel_w]
+ * bias:   [out_channels] or NULL
+ * output: [batch, out_channels, out_h, out_w]
+ */
+int cml_conv2d_blocked(const float* input, const float* weight, const float* bias,
+                       float* output, const ConvBlockedShape* s);
+
+/* As cml_conv2d_blocked, with io (or NULL) linking it to its neighbours. The
+ * input may be NULL when io->in_key has a kept output. Returns 0 when output
+ * was written, 1 when the result is only kept for io->out_key, -1 on failure
+ * (the kept input, if any, is still there). */
+int cml_conv2d_blocked_ex(const float* input, const float* weight, const float* bias,
+                          float* output, const ConvBlockedShape* s, const ConvBlockedIO* io);
+
+/* ReLU of the output kept for io->in_key, rectified in place and kept for
+ * io->out_key instead (dropped if NULL). out (numel floats, NCHW) is written
+ * unless io->skip_output. Returns 1 when only kept, 0 when out was written,
+ * -1 when nothing is kept for io->in_key. */
+int cml_conv_blocked_relu(const ConvBlockedIO* io, float* out, size_t numel);
+
+/* Writes the output kept for key to out (NCHW) and keeps it */
+int cml_conv_blocked_materialize(const void* key, uint64_t epoch, float* out, size_t numel);
+
+/* Brackets a graph run: the epoch keys that run's kept outputs, and ending it
+ * drops whatever no consumer took */
+uint64_t cml_conv_blocked_graph_begin(void);
+void cml_conv_blocked_graph_end(uint64_t epoch);
+
+/* Frees the calling thread's scratch, free kept-output buffers and unpinned
+ * packed weights */
+void cml_conv_blocked_cleanup(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CML_OPS_CONV_BLOCKED_H */
@@ -0,0 +1,74 @@
+/*
+ * Depthwise and pointwise convolution kernels.
+ *
+ * Depthwise (groups == in_channels == out_channels) runs one NCHW plane at a
+ * time. The plane is copied once into zero-padded scratch with its columns
+ * split by stride phase, so every kernel tap is a contiguous multiply-add
+ * along an output row, for any stride or dilation. Rows are accumulated in
+ * vector registers; 3x3, 5x5 and 7x7 get fully unrolled tap loops. Planes
+ * are spread over the thread pool as N x C tasks, and the backward pass
+ * uses the same layout, one task per channel.
+ *
+ * Pointwise (1x1, stride 1, no padding, ungrouped) is one GEMM per image
+ * straight on the NCHW data, with no im2col copy, forward and backward.
+ *
+ * A depthwise convolution feeding a pointwise one directly can run as one
+ * pass: the depthwise result is produced a band of rows at a time and
+ * multiplied by the pointwise weights while the band is still in cache.
+ *
+ * Shapes use ConvBlockedShape. CML_CONV_SEPARABLE=0 turns these paths off.
+ */
+
+#ifndef CML_OPS_CONV_SEPARABLE_H
+#define CML_OPS_CONV_SEPARABLE_H
+
+#include "ops/conv_blocked.h"
+#include "backend/blas.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool cml_conv_depthwise_applicable(const ConvBlockedShape* s, int groups);
+bool cml_conv_pointwise_applicable(const ConvBlockedShape* s, int groups);
+
+/*
+ * input:  [batch, channels, in_h, in_w]
+ * weight: [channels, 1, kernel_h, kernel_w]
+ * bias:   [channels] or NULL
+ * output: [batch, channels, out_h, out_w]
+ */
+int cml_conv2d_depthwise(const float* input, const float* weight, const float* bias,
+                         float* output, const ConvBlockedShape* s);
+
+/* Accumulates into grad_input and grad_weight; either may be NULL */
+int cml_conv2d_depthwise_backward(const float* input, const float* weight,
+                                  const float* grad_output, float* grad_input,
+                                  float* grad_weight, const ConvBlockedShape* s);
+
+/* weight: [out_channels, in_channels, 1, 1] */
+int cml_conv2d_pointwise(CMLBlasContext* blas, const float* input, const float* weight,
+                         const float* bias, float* output, const ConvBlockedShape* s);
+
+/* Accumulates into grad_input and grad_weight; either may be NULL */
+int cml_conv2d_pointwise_backward(CMLBlasContext* blas, const float* input,
+                                  const float* weight, const float* grad_output,
+                                  float* grad_input, float* grad_weight,
+                                  const ConvBlockedShape* s);
+
+/* Depthwise conv dw followed by a pointwise conv to pw_channels outputs.
+ * Both outputs are written. */
+int cml_conv2d_depthwise_pointwise(CMLBlasContext* blas, const float* input,
+                                   const float* dw_weight, const float* dw_bias,
+                                   float* dw_output, const ConvBlockedShape* dw,
+                                   const float* pw_weight, const float* pw_bias,
+                                   float* pw_output, int pw_channels);
+
+/* Frees the calling thread's scratch */
+void cml_conv_separable_cleanup(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CML_OPS_CONV_SEPARABLE_H */
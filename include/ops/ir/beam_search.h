@@ -2,6 +2,8 @@
  * BEAM search kernel optimization.
  * Parametric kernel tuning: try N launch configs (block size, unroll,
  * vectorization width) and pick fastest. Enable via CML_BEAM=N env var.
+ * On CPU the candidates are compiled and timed on real buffers; results are
+ * keyed by kernel hash and CPU model so a shared cache file stays valid.
  */
 
 #ifndef CML_OPS_IR_BEAM_SEARCH_H
@@ -29,6 +31,8 @@ typedef struct {
     size_t grid[3];
     size_t block[3];
     size_t shared_mem;
+    int loop_order;   /* CPU: 0 = contiguous span per thread, 1 = interleaved tiles */
+    int num_threads;  /* CPU: threads used (0 = whole pool) */
 } CMLBeamConfig;
 
 typedef struct {
@@ -44,6 +48,7 @@ typedef struct {
 
     struct {
         uint64_t hash;
+        uint64_t cpu_id;  /* cml_beam_cpu_id() of the host that measured it */
         CMLBeamConfig config;
         double time_us;
         bool occupied;
@@ -58,10 +63,27 @@ CMLBeamSearchCtx* cml_beam_search_create(void);
 void cml_beam_search_free(CMLBeamSearchCtx* ctx);
 bool cml_beam_search_enabled(void);
 
+/* Returns the cached config for kernel_hash, else a heuristic pick for
+ * total_elements. Heuristic picks are not cached; use
+ * cml_beam_search_tune_cpu to measure and store a config. */
 int cml_beam_search_tune(CMLBeamSearchCtx* ctx, uint64_t kernel_hash,
                          size_t total_elements, int ndim, const int* shape,
                          CMLBeamConfig* best_out);
 
+struct CMLLinearProgram;
+
+/* Measured CPU tuning of a fused elementwise program over n elements.
+ * Builds every (vec_width, unroll) code variant in one shared object, times
+ * each with warmup and median-of-timing_runs, keeps the beam_width fastest
+ * and sweeps tile size, thread count and loop order over those. */
+int cml_beam_search_tune_cpu(CMLBeamSearchCtx* ctx, uint64_t kernel_hash,
+                             const struct CMLLinearProgram* prog, size_t n,
+                             CMLBeamConfig* best_out);
+
+/* "model name, N cpus" of this host, and its hash */
+const char* cml_beam_cpu_model(void);
+uint64_t cml_beam_cpu_id(void);
+
 /* Returns 0 if found (best_out populated), -1 if not cached */
 int cml_beam_search_lookup(CMLBeamSearchCtx* ctx, uint64_t kernel_hash,
                            CMLBeamConfig* best_out);
@@ -83,9 +105,13 @@ int cml_beam_search_tune_hw(CMLBeamSearchCtx* ctx, uint64_t kernel_hash,
                              CMLBeamTimingFn timing_fn, void* user_data,
                              CMLBeamConfig* best_out);
 
+/* Entries from every CPU are kept, so one file can serve a whole fleet */
 int cml_beam_cache_save(CMLBeamSearchCtx* ctx, const char* path);
 int cml_beam_cache_load(CMLBeamSearchCtx* ctx, const char* path);
 
+/* $CML_CACHE_DIR/beam.cache, else ~/.cache/cml/beam.cache */
+int cml_beam_cache_default_path(char* out, size_t size);
+
 double cml_beam_cuda_timing_fn(const CMLBeamVariant* variant, void* user_data);
 
 struct LinearProgram;
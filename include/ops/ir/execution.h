@@ -2,6 +2,7 @@
 #define CML_OPS_IR_EXECUTION_H
 
 #include "ops/ir/ir.h"
+#include "alloc/buffer_cache.h"
 #include <stddef.h>
 
 #ifdef __cplusplus
@@ -15,6 +16,11 @@ int cml_ir_execute_cpu(CMLGraph_t ir);
    are not available or fail. */
 int cpu_execute_ir(CMLGraph_t ir);
 
+/* Run independent nodes of a graph concurrently on the global thread pool.
+   Defaults to CML_PARALLEL_EXEC=1; pass -1 to go back to the env setting.
+   CML_INTEROP_THREADS sets how many nodes may run at once. */
+void cml_ir_set_parallel_exec(int enabled);
+
 /** Clear cpu_execute_ir fast-path state; call when the IR graph is reset. */
 void cml_cpu_execute_cache_reset(void);
 
@@ -24,23 +30,39 @@ int cml_ir_execute_up_to(CMLGraph_t ir, struct IRNode* target_node);
 void cml_print_exec_stats(void);
 void cml_reset_exec_stats(void);
 
-/* Uses cached buffers when available, otherwise allocates new memory.
-   Buffers are allocated in power-of-2 size buckets for efficient reuse. */
-void* cml_buffer_cache_alloc(size_t size);
-
-/* Returns buffer to cache for future reuse. If cache is full, frees memory. */
-void cml_buffer_cache_free(void* ptr, size_t size);
+/* Memory seen by CPU backward sweeps. Peaks count the activations and
+ * gradients a graph holds, growing as gradients are created and shrinking
+ * as eager freeing (cml_ir_set_eager_free) releases them. */
+typedef struct CMLBackwardStats {
+    size_t passes;
+    size_t activations_freed;
+    size_t activation_bytes_freed;
+    size_t grads_freed;
+    size_t grad_bytes_freed;
+    size_t peak_bytes;      /* Largest over all passes */
+    size_t last_peak_bytes; /* Most recent pass */
+} CMLBackwardStats;
 
-void cml_print_buffer_cache_stats(void);
-void cml_cleanup_buffer_cache(void);
+void cml_get_backward_stats(CMLBackwardStats* stats);
+void cml_reset_backward_stats(void);
 
 /* On first call: records kernel launch sequence.
    On subsequent calls with same graph structure: replays without re-scheduling. */
 int cml_ir_execute_traced(CMLGraph_t ir);
 
-/* Fused CPU scheduler entrypoint. */
+/* Fused CPU scheduler entrypoint. Runs of elementwise nodes are compiled to
+ * one native loop each; intermediates only those runs consume are never
+ * written to memory (their nodes are left is_elided). */
 int cml_ir_execute_fusion(CMLGraph_t ir);
 
+/* Clears is_elided on target and the elided nodes it depends on, marking
+ * them used, so the next execution materializes target's output. Also undoes
+ * the CPU executor's eliding of outputs kept only in blocked conv layout. */
+void cml_ir_fusion_unelide(struct IRNode* target);
+
+/* Kernel cache behind cml_ir_execute_fusion (created on first use) */
+struct CMLRuntimeCompiler* cml_ir_fusion_compiler(void);
+
 #ifdef __cplusplus
 }
 #endif
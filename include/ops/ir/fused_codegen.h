@@ -29,6 +29,8 @@ typedef struct CMLLinearOp {
     int num_srcs;
     Tensor* tensor;
     bool is_eliminated;
+    bool is_scalar; /* LOAD of a one-element tensor, broadcast over the loop */
+    float imm;      /* Constant value of a FILL compute */
 } CMLLinearOp;
 
 typedef struct CMLLinearProgram {
@@ -58,6 +60,8 @@ typedef struct CMLFusedKernel {
 } CMLFusedKernel;
 
 CMLLinearProgram* cml_linearize_group(const CMLFusionGroup* group);
+/* Whether the C backend emits real code for uop (others become 0.0f) */
+bool cml_fused_c_supports(UOpType uop);
 void cml_linear_program_free(CMLLinearProgram* prog);
 void cml_linear_program_print(const CMLLinearProgram* prog);
 
@@ -68,6 +72,10 @@ CMLFusedKernel* cml_fused_codegen_group(const CMLFusionGroup* group,
                                           CMLFusedBackend backend);
 void cml_fused_kernel_free(CMLFusedKernel* kernel);
 void cml_fused_kernel_print(const CMLFusedKernel* kernel);
+/* C source for prog as a function called name, strip-mined by vec_width and
+ * unrolled by unroll (1 and 1 give the plain loop used by the C backend). */
+char* cml_fused_codegen_c_variant(const CMLLinearProgram* prog, const char* name,
+                                  int vec_width, int unroll);
 char* cml_ptx_gen_fused_kernel(const CMLLinearProgram* prog, size_t work_size);
 uint32_t* cml_spirv_gen_fused_kernel(const CMLLinearProgram* prog,
                                       size_t work_size, int* out_num_words);
@@ -75,6 +75,7 @@ struct IRNode {
     void* execution_result;
 
     bool is_used;              // For dead code elimination
+    bool is_elided;            // Fused away; output recomputed only on demand
     bool is_fused;             // For operation fusion
     FusionType fusion_type;
     FusedKernel* fused_kernel;
@@ -82,6 +83,9 @@ struct IRNode {
     struct IRNode** users;
     int users_capacity;
     int chain_id;              // ID for chained callables
+    struct IRNode* fused_into; // Depthwise conv computing this pointwise conv too (planned per run)
+    struct IRNode* blocked_consumer; // Next node, reading this output in blocked layout (planned per run)
+    uint64_t blocked_epoch;          // Run the blocked output is kept for
 };
 
 void cml_ir_free_node_params(struct IRNode* node);
@@ -108,6 +112,8 @@ struct CMLGraph {
     int tensor_refs_capacity;
 
     bool is_decomposed;
+    bool private_buffers; // Bypass the execution-plan buffer cache
+    bool eager_free;      // Release activations and non-leaf grads during backward
 
     CMLInternTable* intern_table;
 };
@@ -27,6 +27,19 @@ CMLGraph_t cml_ir_new(IRTarget target);
 void cml_ir_free(CMLGraph_t ir);
 int cml_ir_add_uop(CMLGraph_t ir, UOpType type, Tensor** inputs, int num_inputs, void* params);
 struct IRNode* cml_ir_get_tail(CMLGraph_t ir);
+
+/* Same-shaped graphs normally execute into shared, cached buffers, which
+ * assumes only one of them is alive at a time. A graph that must keep its
+ * activations while another of the same shape runs (pipeline micro-batches
+ * awaiting backward) allocates its own instead. */
+void cml_ir_set_private_buffers(CMLGraph_t ir, bool enabled);
+
+/* Lets backward release each activation once its last backward consumer has
+ * run and each non-leaf gradient once it has been propagated, instead of
+ * holding both until the graph is freed. Only the root's value and gradient
+ * survive, so it suits graphs nobody reads after backward. New graphs take
+ * the default from CML_EAGER_FREE=1; retain_graph backward passes never free. */
+void cml_ir_set_eager_free(CMLGraph_t ir, bool enabled);
 const char* uop_type_to_string(UOpType type);
 
 /* @param output_file Output file path (NULL = return string) */
@@ -19,6 +19,13 @@ extern "C" {
 
 #define CML_COMPILED_CACHE_SIZE 256
 
+/* How a native kernel's index range is split across the thread pool */
+typedef struct {
+    size_t tile;      /* Elements per call into the kernel (0 = default grain) */
+    int num_threads;  /* Calls in flight at once (0 = whole pool, 1 = caller only) */
+    bool interleaved; /* Task t runs tiles t, t+T, ... instead of one contiguous span */
+} CMLNativeLaunch;
+
 typedef struct CMLCompiledKernel {
     uint64_t hash;
     CMLFusedBackend backend;
@@ -34,6 +41,22 @@ typedef struct CMLCompiledKernel {
     CMLLinearOp* ops;
     int num_ops;
     int num_vregs;
+
+    /* C backend built to native code (see cml_runtime_compile_native) */
+    void* native_handle;
+    void* native_fn;
+    bool native_failed;
+
+    /* Set by cml_runtime_tune_native; defaults are vec 1, unroll 1 */
+    int vec_width;
+    int unroll;
+    CMLNativeLaunch launch;
+    bool tuned;
+
+    /* Callers that use the entry outside their own lock pin it; pinned
+     * entries are never evicted or cleared */
+    int pins;
+    bool building;  /* One caller is building native code for it */
 } CMLCompiledKernel;
 
 typedef struct CMLRuntimeCompiler {
@@ -65,6 +88,28 @@ int cml_runtime_execute_compiled(const CMLCompiledKernel* kernel,
                                   Tensor** inputs, int num_inputs,
                                   Tensor** outputs, int num_outputs);
 
+/* Builds a C-backend kernel with the system compiler ($CML_CC, default cc)
+ * and loads it. Returns 0 once native_fn is callable; a failed build is
+ * remembered so callers fall back without retrying. */
+int cml_runtime_compile_native(CMLCompiledKernel* kernel);
+
+/* Compiles C source into a shared object and dlopens it. Returns the handle
+ * (release with dlclose), or NULL if the compiler is missing or fails. */
+void* cml_runtime_build_native(const char* source);
+
+/* Rebuilds kernel with the given strip width and unroll if they differ from
+ * the current build, and launches it with launch from then on. */
+int cml_runtime_tune_native(CMLCompiledKernel* kernel, int vec_width, int unroll,
+                            const CMLNativeLaunch* launch);
+
+/* Runs a native kernel over n elements on the global thread pool. bufs holds
+ * one pointer per LOAD/STORE of the kernel's program, in program order. */
+int cml_runtime_launch_native(const CMLCompiledKernel* kernel, float* const* bufs, size_t n);
+
+/* Same for a bare fused_kernel-shaped function; launch may be NULL. */
+int cml_runtime_launch_native_fn(void* fn, float* const* bufs, size_t n,
+                                 const CMLNativeLaunch* launch);
+
 /* fusion schedule -> linearize groups -> fused codegen -> execute */
 int cml_runtime_execute_graph(CMLRuntimeCompiler* rc, CMLGraph_t ir);
 
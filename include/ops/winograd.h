@@ -8,6 +8,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -28,6 +29,9 @@ typedef struct {
 bool winograd_applicable(int kernel_h, int kernel_w, int stride_h, int stride_w,
                          int dilation_h, int dilation_w);
 
+/* False when CML_WINOGRAD=0 */
+bool winograd_enabled(void);
+
 WinogradConfig winograd_select_variant(int height, int width);
 
 /*
@@ -48,6 +52,41 @@ int winograd_conv2d(const float* input, const float* weight, const float* bias,
                     int height, int width, int padding_h, int padding_w,
                     int groups, const WinogradConfig* config);
 
+/*
+ * Batched-GEMM Winograd for 3x3, stride 1, dilation 1. Tiles are transformed
+ * a chunk at a time and each of the tile_size^2 points is one GEMM of
+ * [out/groups, in/groups] x [in/groups, tiles], spread over the thread pool.
+ *
+ * transformed: weights from winograd_transform_weight_gemm or
+ *              winograd_weight_cached, or NULL to transform weight here
+ */
+int winograd_conv2d_gemm(const float* input, const float* weight, const float* transformed,
+                         const float* bias, float* output, int batch, int in_channels,
+                         int out_channels, int height, int width, int padding_h, int padding_w,
+                         int groups, const WinogradConfig* config);
+
+/* Weights packed for winograd_conv2d_gemm */
+size_t winograd_gemm_weight_size(int out_channels, int in_channels_per_group, int groups,
+                                 const WinogradConfig* config);
+int winograd_transform_weight_gemm(const float* weight, int out_channels,
+                                   int in_channels_per_group, int groups,
+                                   const WinogradConfig* config, float* transformed);
+
+/*
+ * Transformed weights cached per (key, version), e.g. a weight tensor and its
+ * version stamp, so frozen weights are transformed once. A different version
+ * rebuilds the entry. Returns NULL when key is NULL, version is 0 or every
+ * entry is in use. A non-NULL result is pinned: it stays valid, whatever
+ * other threads look up, until it is passed to winograd_weight_release.
+ */
+const float* winograd_weight_cached(const void* key, uint64_t version, const float* weight,
+                                    int out_channels, int in_channels_per_group, int groups,
+                                    const WinogradConfig* config);
+void winograd_weight_release(const float* transformed);
+
+/* Frees the weight cache and the calling thread's scratch */
+void winograd_cleanup(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -10,6 +10,7 @@ extern "C" {
 
 struct Optimizer;
 struct ParameterGroup;
+struct GradScaler;
 
 typedef void (*StepFn)(struct Optimizer* optimizer);
 typedef void (*ZeroGradFn)(struct Optimizer* optimizer);
@@ -51,6 +52,10 @@ typedef struct Optimizer {
     const char* description; // Optimizer description
 
     void* training_metrics; // TrainingMetrics* (void* to avoid circular dependency)
+
+    bool use_flat;                  // Step through a flat multi-tensor arena
+    void* flat_arena;               // CMLFlatArena* while use_flat is set
+    struct GradScaler* grad_scaler; // Unscale and inf/nan check folded into the step
 } Optimizer;
 
 int optimizer_init(Optimizer* optimizer, const char* name, StepFn step, ZeroGradFn zero_grad);
@@ -68,6 +73,11 @@ ParameterGroup* optimizer_get_param_group(Optimizer* optimizer, int index);
 
 void optimizer_step(Optimizer* optimizer);
 
+/* Marks every parameter as rewritten, so caches keyed by tensor version
+ * (e.g. Winograd weight transforms) drop their copies; optimizer_step does
+ * this itself, callers that update parameters another way must. */
+void optimizer_bump_param_versions(Optimizer* optimizer);
+
 void optimizer_set_metrics(Optimizer* optimizer, void* metrics);
 
 void optimizer_zero_grad(Optimizer* optimizer);
@@ -88,6 +98,18 @@ void optimizer_set_grad_clip_norm(Optimizer* optimizer, float norm);
 
 void optimizer_set_amsgrad(Optimizer* optimizer, bool amsgrad);
 
+/* Packs parameters, gradients and state into flat arenas and runs Adam, AdamW
+ * and LAMB steps as one threaded multi-tensor sweep. The parameter tensors
+ * become views into the arena until the optimizer is freed or flat mode is
+ * turned off, so free the optimizer before the model. Returns -1 for other
+ * optimizers or tensors that cannot be packed (non-float32, device memory). */
+int optimizer_set_flat(Optimizer* optimizer, bool enable);
+
+/* Unscales gradients by 1/scale_factor inside the step and skips the update
+ * (setting scaler->found_inf) on inf/nan; do not also call grad_scaler_unscale.
+ * Pass NULL to detach. */
+void optimizer_set_grad_scaler(Optimizer* optimizer, struct GradScaler* scaler);
+
 const char* optimizer_get_name(Optimizer* optimizer);
 
 int optimizer_get_total_parameters(Optimizer* optimizer);
@@ -0,0 +1,89 @@
+#ifndef CML_OPTIM_MULTI_TENSOR_H
+#define CML_OPTIM_MULTI_TENSOR_H
+
+#include "tensor/tensor.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Flat multi-tensor optimizer state.
+ *
+ * Parameters, gradients and per-parameter optimizer state are packed into
+ * one contiguous arena each, in parameter order, with every tensor starting
+ * on a 64-byte boundary. The original tensors keep working: their data
+ * pointers are redirected into the arena (owns_data = false), so forward,
+ * backward and zero_grad read and write the packed copies in place.
+ *
+ * A step is one threaded pass over the gradients (global norm and inf/nan
+ * check, only when clipping or unscaling) followed by one threaded update
+ * sweep over the arena. Runs of adjacent parameters in the same group are
+ * updated as single ranges, so a thousand biases cost one kernel call.
+ */
+
+#define CML_FLAT_MAX_STATE 3
+
+typedef enum {
+    CML_FLAT_ADAM,  /* L2 decay folded into the gradient, as uop_adam_step */
+    CML_FLAT_ADAMW, /* Decoupled weight decay */
+    CML_FLAT_LAMB,  /* Per-tensor trust ratio */
+} CMLFlatRule;
+
+typedef struct {
+    Tensor* param;
+    Tensor* state[CML_FLAT_MAX_STATE]; /* exp_avg, exp_avg_sq, max_exp_avg_sq or NULL */
+    int group;
+} CMLFlatEntry;
+
+typedef struct {
+    float lr;
+    float beta1;
+    float beta2;
+    float eps;
+    float weight_decay;
+    int step; /* 1-based step being taken */
+} CMLFlatHyper;
+
+typedef struct {
+    float grad_scale;   /* Multiplies every gradient (1 / loss scale); 0 = 1 */
+    float clip_norm;    /* Global L2 clip on the unscaled gradients; 0 = off */
+    bool amsgrad;
+    bool found_inf;     /* Out: a gradient was inf/nan; nothing was updated */
+    float grad_norm;    /* Out: global norm when it was computed */
+} CMLFlatStepArgs;
+
+typedef struct CMLFlatArena CMLFlatArena;
+
+/* Packs entries (at most CML_FLAT_MAX_STATE state tensors each, all float32
+ * on the CPU and shaped like their parameter). Returns NULL and leaves the
+ * tensors untouched if any of them cannot be packed. */
+CMLFlatArena* cml_flat_arena_create(const CMLFlatEntry* entries, int num_entries, int num_state);
+
+/* Gives every packed tensor its own buffer again, then frees the arena */
+void cml_flat_arena_free(CMLFlatArena* arena);
+
+int cml_flat_arena_num_entries(const CMLFlatArena* arena);
+int cml_flat_arena_num_state(const CMLFlatArena* arena);
+
+/* One optimizer step; hyper is indexed by entry group. Parameters without a
+ * gradient are left alone, and a tensor whose data was replaced since the
+ * last step is copied back into the arena first. */
+int cml_flat_arena_step(CMLFlatArena* arena, CMLFlatRule rule, const CMLFlatHyper* hyper,
+                        CMLFlatStepArgs* args);
+
+/* The Adam or AdamW update of one contiguous range whose state the caller
+ * holds itself, such as a ZeRO shard; grad_scale multiplies the gradients
+ * (0 = 1) and max_exp_avg_sq is NULL without AMSGrad. LAMB needs whole-tensor
+ * norms and is rejected. */
+int cml_flat_update_range(CMLFlatRule rule, const CMLFlatHyper* hyper, float grad_scale,
+                          float* params, const float* grads, float* exp_avg, float* exp_avg_sq,
+                          float* max_exp_avg_sq, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CML_OPTIM_MULTI_TENSOR_H */
@@ -59,6 +59,7 @@ typedef struct Tensor {
     void* data;       // NULL until executed (lazy!)
     bool owns_data;        // Does this tensor own its data?
     bool from_buffer_cache; // Data was allocated via cml_buffer_cache_alloc
+    uint64_t version;       // Unique stamp of the current contents; 0 = untracked
 
     bool requires_grad;
     struct Tensor* grad; // Gradient tensor (also lazy!)
@@ -116,6 +117,10 @@ void tensor_set_float(Tensor* t, size_t idx, float value);
 void* tensor_data_ptr(Tensor* t); /* Triggers lazy execution if needed */
 size_t tensor_compute_offset(Tensor* t, int* indices);
 int tensor_ensure_executed(Tensor* t);
+/* Must follow any direct write to a tensor's ->data (a copy, a load, an
+ * in-place update): caches keyed by (tensor, version), such as transformed
+ * or packed conv weights, otherwise keep serving the old contents */
+void tensor_bump_version(Tensor* t);
 CMLGraph_t tensor_get_ir_context(Tensor* t);
 bool tensor_is_scalar(Tensor* t);
 bool tensor_is_contiguous(Tensor* t);
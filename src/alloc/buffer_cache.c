@@ -0,0 +1,400 @@
+/*
+ * Buffer cache for tensor outputs.
+ *
+ * Size classes split every power of two into four steps (2^p * 1.25, 1.5,
+ * 1.75, 2), so a request wastes under 25% instead of up to 50%. Free buffers
+ * are linked through their own first word; no bookkeeping nodes are
+ * allocated on the free path.
+ *
+ * Each thread owns one magazine per class holding a handful of buffers
+ * (fewer for big classes, none above MAGAZINE_BYTES). Alloc/free hit the
+ * magazine without locking; an empty magazine refills from the central pool
+ * and a full one flushes half of itself back, both under one mutex.
+ * Magazines are returned to the central pool when their thread exits.
+ *
+ * bytes_cached counts buffers parked anywhere in the cache and is held under
+ * the configured limit by dropping frees that would exceed it.
+ *
+ * With an arena configured, buffers from ARENA_MIN_SIZE up are carved from a
+ * TLSF pool with exact sizes; arena exhaustion falls back to size classes.
+ * Cleanup releases the pool once nothing is carved from it, and the next
+ * large allocation reserves it again.
+ */
+
+#include "alloc/buffer_cache.h"
+#include "alloc/tlsf_alloc.h"
+#include "core/logging.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CLASS_MIN_SHIFT 6  /* Smallest class: 64 bytes */
+#define CLASS_MAX_SHIFT 26 /* Largest class: 64 MB */
+#define CLASS_STEPS 4      /* Classes per power of two */
+#define NUM_CLASSES ((CLASS_MAX_SHIFT - CLASS_MIN_SHIFT) * CLASS_STEPS + 1)
+
+#define MAGAZINE_SLOTS 8
+#define MAGAZINE_BYTES ((size_t)2 << 20) /* Per class, per thread */
+
+#define DEFAULT_LIMIT_MB 1024
+#define ARENA_MIN_SIZE ((size_t)1 << 20)
+
+typedef struct {
+    void* slots[MAGAZINE_SLOTS];
+    int count;
+} Magazine;
+
+typedef struct {
+    Magazine mags[NUM_CLASSES];
+} ThreadCache;
+
+typedef struct {
+    void* head; /* Intrusive list through each buffer's first word */
+    size_t count;
+} CentralList;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static CentralList g_central[NUM_CLASSES];
+
+static CMLTLSFAllocator* g_arena = NULL; /* Under g_arena_lock */
+static pthread_mutex_t g_arena_lock = PTHREAD_MUTEX_INITIALIZER;
+static atomic_size_t g_arena_bytes  = 0; /* Configured size, 0 for none */
+/* Pool bounds, so frees can test membership without the lock */
+static atomic_uintptr_t g_arena_lo = 0;
+static atomic_uintptr_t g_arena_hi = 0;
+
+static atomic_size_t g_bytes_cached    = 0;
+static atomic_size_t g_bytes_limit     = 0;
+static atomic_size_t g_hits            = 0;
+static atomic_size_t g_misses          = 0;
+static atomic_size_t g_magazine_hits   = 0;
+static atomic_size_t g_evictions       = 0;
+static atomic_size_t g_arena_allocs    = 0;
+static atomic_size_t g_bytes_allocated = 0;
+
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_tc_key;
+static bool g_tc_key_ok = false;
+static _Thread_local ThreadCache* tl_cache = NULL;
+
+static void thread_cache_release(void* arg);
+
+static void cache_init_once(void) {
+    const char* env = getenv("CML_BUFFER_CACHE_MB");
+    long mb         = env ? atol(env) : DEFAULT_LIMIT_MB;
+    if (mb < 0)
+        mb = DEFAULT_LIMIT_MB;
+    atomic_store(&g_bytes_limit, (size_t)mb << 20);
+
+    const char* arena_env = getenv("CML_BUFFER_CACHE_ARENA_MB");
+    long arena_mb         = arena_env ? atol(arena_env) : 0;
+    if (arena_mb > 0)
+        atomic_store(&g_arena_bytes, (size_t)arena_mb << 20);
+
+    g_tc_key_ok = pthread_key_create(&g_tc_key, thread_cache_release) == 0;
+}
+
+static inline void cache_init(void) { pthread_once(&g_once, cache_init_once); }
+
+static int size_class(size_t size) {
+    if (size <= ((size_t)1 << CLASS_MIN_SHIFT))
+        return 0;
+    if (size > ((size_t)1 << CLASS_MAX_SHIFT))
+        return -1;
+
+    int p       = 63 - __builtin_clzll((unsigned long long)(size - 1)); /* 2^p < size <= 2^(p+1) */
+    size_t base = (size_t)1 << p;
+    size_t step = base / CLASS_STEPS;
+    int sub     = (int)((size - base + step - 1) / step); /* 1 .. CLASS_STEPS */
+    return (p - CLASS_MIN_SHIFT) * CLASS_STEPS + sub;
+}
+
+static size_t class_size(int idx) {
+    if (idx == 0)
+        return (size_t)1 << CLASS_MIN_SHIFT;
+    int p = CLASS_MIN_SHIFT + (idx - 1) / CLASS_STEPS;
+    int sub = (idx - 1) % CLASS_STEPS + 1;
+    return ((size_t)1 << p) + (size_t)sub * (((size_t)1 << p) / CLASS_STEPS);
+}
+
+static int magazine_capacity(int idx) {
+    size_t n = MAGAZINE_BYTES / class_size(idx);
+    return n > MAGAZINE_SLOTS ? MAGAZINE_SLOTS : (int)n;
+}
+
+static ThreadCache* thread_cache(void) {
+    if (tl_cache || !g_tc_key_ok)
+        return tl_cache;
+    tl_cache = calloc(1, sizeof(ThreadCache));
+    if (tl_cache)
+        pthread_setspecific(g_tc_key, tl_cache);
+    return tl_cache;
+}
+
+/* Caller holds g_lock */
+static void central_push(int idx, void* ptr) {
+    *(void**)ptr        = g_central[idx].head;
+    g_central[idx].head = ptr;
+    g_central[idx].count++;
+}
+
+/* Caller holds g_lock */
+static void* central_pop(int idx) {
+    void* ptr = g_central[idx].head;
+    if (ptr) {
+        g_central[idx].head = *(void**)ptr;
+        g_central[idx].count--;
+    }
+    return ptr;
+}
+
+static void magazine_drain(Magazine* mag, int idx) {
+    if (mag->count == 0)
+        return;
+    pthread_mutex_lock(&g_lock);
+    while (mag->count > 0)
+        central_push(idx, mag->slots[--mag->count]);
+    pthread_mutex_unlock(&g_lock);
+}
+
+static void thread_cache_release(void* arg) {
+    ThreadCache* tc = arg;
+    if (!tc)
+        return;
+    for (int i = 0; i < NUM_CLASSES; i++)
+        magazine_drain(&tc->mags[i], i);
+    free(tc);
+    tl_cache = NULL;
+}
+
+static bool in_arena(const void* ptr) {
+    uintptr_t p  = (uintptr_t)ptr;
+    uintptr_t lo = atomic_load_explicit(&g_arena_lo, memory_order_acquire);
+    return lo && p >= lo && p < atomic_load_explicit(&g_arena_hi, memory_order_acquire);
+}
+
+/* Reserves the pool on first use (again after a cleanup); g_arena_lock held */
+static bool arena_open(void) {
+    if (g_arena)
+        return true;
+    size_t bytes = atomic_load(&g_arena_bytes);
+    g_arena      = cml_tlsf_create(bytes);
+    if (!g_arena) {
+        LOG_WARNING("Buffer cache: could not reserve %zu MB TLSF arena", bytes >> 20);
+        atomic_store(&g_arena_bytes, 0);
+        return false;
+    }
+    atomic_store_explicit(&g_arena_hi, (uintptr_t)g_arena->pool + g_arena->pool_size,
+                          memory_order_release);
+    atomic_store_explicit(&g_arena_lo, (uintptr_t)g_arena->pool, memory_order_release);
+    return true;
+}
+
+/* Gives the pool back when no block is carved from it; g_arena_lock held */
+static void arena_close(void) {
+    size_t allocs, frees;
+    if (!g_arena)
+        return;
+    cml_tlsf_stats(g_arena, NULL, NULL, &allocs, &frees);
+    if (allocs != frees)
+        return;
+    atomic_store_explicit(&g_arena_lo, 0, memory_order_release);
+    atomic_store_explicit(&g_arena_hi, 0, memory_order_release);
+    cml_tlsf_destroy(g_arena);
+    g_arena = NULL;
+}
+
+static void* arena_alloc(size_t size) {
+    pthread_mutex_lock(&g_arena_lock);
+    void* ptr = arena_open() ? cml_tlsf_alloc(g_arena, size) : NULL;
+    pthread_mutex_unlock(&g_arena_lock);
+    if (ptr)
+        atomic_fetch_add_explicit(&g_arena_allocs, 1, memory_order_relaxed);
+    return ptr;
+}
+
+void* cml_buffer_cache_alloc(size_t size) {
+    if (size == 0)
+        return NULL;
+
+    cache_init();
+
+    if (size >= ARENA_MIN_SIZE && atomic_load_explicit(&g_arena_bytes, memory_order_relaxed)) {
+        void* ptr = arena_alloc(size);
+        if (ptr)
+            return ptr;
+    }
+
+    int idx = size_class(size);
+    if (idx < 0) {
+        atomic_fetch_add_explicit(&g_misses, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&g_bytes_allocated, size, memory_order_relaxed);
+        return malloc(size);
+    }
+
+    size_t csize    = class_size(idx);
+    ThreadCache* tc = thread_cache();
+    Magazine* mag   = tc ? &tc->mags[idx] : NULL;
+
+    if (mag && mag->count > 0) {
+        atomic_fetch_add_explicit(&g_hits, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&g_magazine_hits, 1, memory_order_relaxed);
+        atomic_fetch_sub_explicit(&g_bytes_cached, csize, memory_order_relaxed);
+        /* Don't zero — callers that need zeroing (e.g. reduce ops) do it themselves.
+         * Most ops (matmul, add, relu, conv) write every output element. */
+        return mag->slots[--mag->count];
+    }
+
+    /* Refill: one buffer for the caller plus up to half a magazine */
+    int refill = mag ? magazine_capacity(idx) / 2 : 0;
+    pthread_mutex_lock(&g_lock);
+    void* ptr = central_pop(idx);
+    while (ptr && refill-- > 0 && g_central[idx].head)
+        mag->slots[mag->count++] = central_pop(idx);
+    pthread_mutex_unlock(&g_lock);
+
+    if (ptr) {
+        atomic_fetch_add_explicit(&g_hits, 1, memory_order_relaxed);
+        atomic_fetch_sub_explicit(&g_bytes_cached, csize, memory_order_relaxed);
+        return ptr;
+    }
+
+    atomic_fetch_add_explicit(&g_misses, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&g_bytes_allocated, csize, memory_order_relaxed);
+    return malloc(csize);
+}
+
+void cml_buffer_cache_free(void* ptr, size_t size) {
+    if (!ptr)
+        return;
+
+    cache_init();
+
+    if (in_arena(ptr)) {
+        pthread_mutex_lock(&g_arena_lock);
+        cml_tlsf_free(g_arena, ptr);
+        pthread_mutex_unlock(&g_arena_lock);
+        return;
+    }
+
+    int idx = size_class(size);
+    if (idx < 0) {
+        free(ptr);
+        return;
+    }
+
+    size_t csize = class_size(idx);
+    size_t limit = atomic_load_explicit(&g_bytes_limit, memory_order_relaxed);
+    if (atomic_fetch_add_explicit(&g_bytes_cached, csize, memory_order_relaxed) + csize > limit) {
+        atomic_fetch_sub_explicit(&g_bytes_cached, csize, memory_order_relaxed);
+        atomic_fetch_add_explicit(&g_evictions, 1, memory_order_relaxed);
+        free(ptr);
+        return;
+    }
+
+    ThreadCache* tc = thread_cache();
+    int cap         = magazine_capacity(idx);
+    if (tc && cap > 0) {
+        Magazine* mag = &tc->mags[idx];
+        if (mag->count < cap) {
+            mag->slots[mag->count++] = ptr;
+            return;
+        }
+        /* Full: flush the older half along with this buffer */
+        pthread_mutex_lock(&g_lock);
+        int keep = cap / 2;
+        for (int i = 0; i < mag->count - keep; i++)
+            central_push(idx, mag->slots[i]);
+        for (int i = 0; i < keep; i++)
+            mag->slots[i] = mag->slots[mag->count - keep + i];
+        mag->count = keep;
+        central_push(idx, ptr);
+        pthread_mutex_unlock(&g_lock);
+        return;
+    }
+
+    pthread_mutex_lock(&g_lock);
+    central_push(idx, ptr);
+    pthread_mutex_unlock(&g_lock);
+}
+
+/* Frees central buffers, largest classes first, until bytes_cached <= target.
+ * Magazines are left alone: only their owning threads may touch them. */
+static void central_trim(size_t target) {
+    pthread_mutex_lock(&g_lock);
+    for (int idx = NUM_CLASSES - 1; idx >= 0; idx--) {
+        size_t csize = class_size(idx);
+        while (atomic_load_explicit(&g_bytes_cached, memory_order_relaxed) > target) {
+            void* ptr = central_pop(idx);
+            if (!ptr)
+                break;
+            atomic_fetch_sub_explicit(&g_bytes_cached, csize, memory_order_relaxed);
+            free(ptr);
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+}
+
+void cml_buffer_cache_set_limit(size_t bytes) {
+    cache_init();
+    atomic_store(&g_bytes_limit, bytes);
+    central_trim(bytes);
+}
+
+void cml_buffer_cache_get_stats(CMLBufferCacheStats* stats) {
+    if (!stats)
+        return;
+    cache_init();
+    stats->hits            = atomic_load(&g_hits);
+    stats->misses          = atomic_load(&g_misses);
+    stats->magazine_hits   = atomic_load(&g_magazine_hits);
+    stats->evictions       = atomic_load(&g_evictions);
+    stats->arena_allocs    = atomic_load(&g_arena_allocs);
+    stats->bytes_cached    = atomic_load(&g_bytes_cached);
+    stats->bytes_allocated = atomic_load(&g_bytes_allocated);
+    stats->bytes_limit     = atomic_load(&g_bytes_limit);
+}
+
+void cml_cleanup_buffer_cache(void) {
+    cache_init();
+
+    ThreadCache* tc = tl_cache;
+    if (tc) {
+        for (int i = 0; i < NUM_CLASSES; i++)
+            magazine_drain(&tc->mags[i], i);
+    }
+    central_trim(0);
+
+    pthread_mutex_lock(&g_arena_lock);
+    arena_close();
+    pthread_mutex_unlock(&g_arena_lock);
+}
+
+void cml_print_buffer_cache_stats(void) {
+    CMLBufferCacheStats s;
+    cml_buffer_cache_get_stats(&s);
+
+    size_t total_requests = s.hits + s.misses;
+    float hit_rate        = total_requests > 0 ? (100.0f * s.hits / total_requests) : 0;
+
+    size_t central_buffers = 0;
+    pthread_mutex_lock(&g_lock);
+    for (int i = 0; i < NUM_CLASSES; i++)
+        central_buffers += g_central[i].count;
+    pthread_mutex_unlock(&g_lock);
+
+    printf("Buffer Cache Stats:\n");
+    printf("  Cache hits:    %zu (%zu lock-free)\n", s.hits, s.magazine_hits);
+    printf("  Cache misses:  %zu\n", s.misses);
+    printf("  Hit rate:      %.1f%%\n", hit_rate);
+    printf("  Cached now:    %.2f KB (%zu buffers in central pool)\n", s.bytes_cached / 1024.0f,
+           central_buffers);
+    printf("  Limit:         %.2f KB, %zu evictions\n", s.bytes_limit / 1024.0f, s.evictions);
+    printf("  Total alloc:   %.2f KB\n", s.bytes_allocated / 1024.0f);
+    if (s.arena_allocs > 0)
+        printf("  Arena allocs:  %zu\n", s.arena_allocs);
+}
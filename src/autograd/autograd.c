@@ -138,6 +138,9 @@ void tensor_retain_grad(Tensor* t) {
 typedef struct {
     TensorBackwardHook hooks[MAX_HOOKS];
     int num_hooks;
+    TensorGradReadyHook ready[MAX_HOOKS];
+    void* ready_ctx[MAX_HOOKS];
+    int num_ready;
 } TensorHookList;
 
 static TensorHookList* get_tensor_hooks(Tensor* t) {
@@ -163,6 +166,62 @@ int tensor_register_backward_hook(Tensor* t, TensorBackwardHook hook) {
     return 0;
 }
 
+int tensor_register_grad_ready_hook(Tensor* t, TensorGradReadyHook hook, void* ctx) {
+    if (!t || !hook) {
+        LOG_ERROR("Invalid arguments to tensor_register_grad_ready_hook");
+        return -1;
+    }
+
+    TensorHookList* hooks = get_tensor_hooks(t);
+    if (!hooks)
+        return -1;
+    if (hooks->num_ready >= MAX_HOOKS) {
+        LOG_ERROR("Maximum number of hooks (%d) reached", MAX_HOOKS);
+        return -1;
+    }
+
+    hooks->ready[hooks->num_ready]     = hook;
+    hooks->ready_ctx[hooks->num_ready] = ctx;
+    hooks->num_ready++;
+    return 0;
+}
+
+void tensor_remove_grad_ready_hook(Tensor* t, TensorGradReadyHook hook, void* ctx) {
+    if (!t || !t->user_data)
+        return;
+
+    TensorHookList* hooks = (TensorHookList*)t->user_data;
+    int kept              = 0;
+    for (int i = 0; i < hooks->num_ready; i++) {
+        if (hooks->ready[i] == hook && hooks->ready_ctx[i] == ctx)
+            continue;
+        hooks->ready[kept]     = hooks->ready[i];
+        hooks->ready_ctx[kept] = hooks->ready_ctx[i];
+        kept++;
+    }
+    hooks->num_ready = kept;
+}
+
+bool tensor_has_backward_hooks(const Tensor* t) {
+    if (!t || !t->user_data)
+        return false;
+    const TensorHookList* hooks = (const TensorHookList*)t->user_data;
+    return hooks->num_hooks > 0 || hooks->num_ready > 0;
+}
+
+void tensor_run_backward_hooks(Tensor* t) {
+    if (!t || !t->user_data)
+        return;
+
+    TensorHookList* hooks = (TensorHookList*)t->user_data;
+    if (t->grad) {
+        for (int i = 0; i < hooks->num_hooks; i++)
+            hooks->hooks[i](t->grad);
+    }
+    for (int i = 0; i < hooks->num_ready; i++)
+        hooks->ready[i](t, hooks->ready_ctx[i]);
+}
+
 void tensor_remove_hooks(Tensor* t) {
     if (!t || !t->user_data) {
         return;
@@ -170,6 +229,7 @@ void tensor_remove_hooks(Tensor* t) {
 
     TensorHookList* hooks = (TensorHookList*)t->user_data;
     hooks->num_hooks      = 0;
+    hooks->num_ready      = 0;
 }
 
 int module_register_backward_hook(struct Module* module, ModuleBackwardHook hook) {
@@ -235,7 +295,6 @@ void tensor_accumulate_grad(Tensor* tensor, Tensor* new_grad) {
 Tensor* tensor_get_grad(Tensor* tensor) { return tensor ? tensor->grad : NULL; }
 
 void tensor_backward(Tensor* tensor, Tensor* gradient, bool retain_graph, bool create_graph) {
-    (void)retain_graph;
     (void)create_graph;
 
     if (!tensor) {
@@ -313,7 +372,14 @@ void tensor_backward(Tensor* tensor, Tensor* gradient, bool retain_graph, bool c
         return;
     }
 
-    if (cml_ir_execute_backward(tensor->ir_context) != 0) {
+    /* A retained graph may be run backward again, so it keeps everything */
+    CMLGraph_t ctx  = tensor->ir_context;
+    bool eager_free = ctx->eager_free;
+    if (retain_graph)
+        ctx->eager_free = false;
+    int ret = cml_ir_execute_backward(ctx);
+    ctx->eager_free = eager_free;
+    if (ret != 0) {
         LOG_ERROR("Failed to execute backward pass");
         return;
     }
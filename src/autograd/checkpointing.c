@@ -4,9 +4,12 @@
 #include "nn/layers/sequential.h"
 #include "ops/ir/ir.h"
 #include "ops/ir/internal.h"
+#include "ops/ir/memory_planner.h"
+#include "ops/ir/schedule.h"
 #include "ops/uops.h"
 #include "autograd/forward_ops.h"
 #include "core/logging.h"
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -343,3 +346,380 @@ void autograd_checkpointing_cleanup(void) {
         checkpointed_capacity = 0;
     }
 }
+
+typedef struct CheckpointSlot {
+    CMLGraph_t graph;
+    Tensor* input;
+    Tensor* output;
+    Tensor* loss;
+} CheckpointSlot;
+
+static size_t tensor_bytes(const Tensor* t) {
+    return t && t->data ? t->numel * cml_dtype_size(t->dtype) : 0;
+}
+
+/* Bytes the graph's nodes own right now, optionally with their gradients */
+static size_t graph_live_bytes(CMLGraph_t graph, bool grads) {
+    size_t bytes = 0;
+    for (struct IRNode* node = graph ? graph->head : NULL; node; node = node->next) {
+        if (!node->output)
+            continue;
+        if (node->output->owns_data)
+            bytes += tensor_bytes(node->output);
+        if (grads)
+            bytes += tensor_bytes(node->output->grad);
+    }
+    return bytes;
+}
+
+static void slot_release(CheckpointSlot* slot) {
+    if (slot->loss)
+        tensor_free(slot->loss);
+    if (slot->output)
+        tensor_free(slot->output);
+    if (slot->graph)
+        cml_ir_free(slot->graph);
+    slot->graph  = NULL;
+    slot->output = NULL;
+    slot->loss   = NULL;
+}
+
+/* Runs one segment in a graph of its own so it can be freed independently */
+static int segment_forward(Sequential* seq, int index, CheckpointSlot* slot, Tensor* target,
+                           CheckpointLossFn loss_fn, void* loss_ctx) {
+    CMLGraph_t prev = cml_ir_get_or_create_context();
+    slot->graph     = cml_ir_new(IR_TARGET_C);
+    if (!slot->graph)
+        return -1;
+    cml_ir_set_private_buffers(slot->graph, true);
+    cml_ir_set_eager_free(slot->graph, true);
+    cml_ir_set_global_context(slot->graph);
+
+    slot->output = module_forward(sequential_get(seq, index), slot->input);
+    if (slot->output && loss_fn)
+        slot->loss = loss_fn(slot->output, target, loss_ctx);
+    Tensor* root = loss_fn ? slot->loss : slot->output;
+    int ret      = root && tensor_ensure_executed(root) == 0 ? 0 : -1;
+
+    cml_ir_set_global_context(prev);
+    if (ret != 0)
+        LOG_ERROR("Checkpointing: forward of segment %d failed", index);
+    return ret;
+}
+
+/* Detached copy of a segment output, the next segment's checkpoint */
+static Tensor* segment_checkpoint(Tensor* t, bool requires_grad) {
+    float* data = t ? (float*)tensor_data_ptr(t) : NULL;
+    if (!data)
+        return NULL;
+    TensorConfig cfg = {.dtype = DTYPE_FLOAT32, .device = DEVICE_CPU,
+                        .has_dtype = true, .has_device = true};
+    Tensor* copy = tensor_from_data(data, t->shape, t->ndim, &cfg);
+    if (copy)
+        copy->requires_grad = requires_grad;
+    return copy;
+}
+
+/* Sizes, lifetimes and FLOPs of the segment's freshly executed graph */
+static int segment_profile(CheckpointSlot* slot, CheckpointSegment* seg) {
+    int n = 0;
+    for (struct IRNode* node = slot->graph->head; node; node = node->next)
+        n++;
+
+    struct IRNode** nodes = calloc((size_t)n + 1, sizeof(struct IRNode*));
+    size_t* sizes         = calloc((size_t)n + 1, sizeof(size_t));
+    int* first_use        = calloc((size_t)n + 1, sizeof(int));
+    int* last_use         = calloc((size_t)n + 1, sizeof(int));
+    int ret               = nodes && sizes && first_use && last_use ? 0 : -1;
+
+    int i = 0;
+    for (struct IRNode* node = slot->graph->head; ret == 0 && node; node = node->next, i++) {
+        nodes[i]     = node;
+        sizes[i]     = node->output ? node->output->numel * cml_dtype_size(node->output->dtype)
+                                    : 0;
+        first_use[i] = i;
+        last_use[i]  = node->output == slot->output ? n - 1 : i;
+        for (int j = 0; j < node->num_inputs; j++)
+            for (int p = 0; node->inputs && p < i; p++)
+                if (nodes[p]->output && nodes[p]->output == node->inputs[j] && last_use[p] < i)
+                    last_use[p] = i;
+        seg->saved_bytes += sizes[i];
+    }
+
+    if (ret == 0 && n > 0) {
+        CMLMemoryPlan* mem = cml_memory_plan_create(n, sizes, first_use, last_use);
+        CMLSchedule* sched = cml_schedule_create(slot->graph, NULL);
+        if (mem && sched) {
+            seg->work_bytes = mem->peak_memory;
+            seg->flops      = sched->total_flops;
+        } else {
+            ret = -1;
+        }
+        cml_memory_plan_free(mem);
+        cml_schedule_free(sched);
+    }
+    free(nodes);
+    free(sizes);
+    free(first_use);
+    free(last_use);
+    return ret;
+}
+
+/* Peak over the step: at segment i's backward everything before it is still
+ * held, plus its own inputs, activations and gradients */
+static size_t plan_predict(const CheckpointPlan* plan, int* peak_at) {
+    size_t held = 0, peak = 0;
+    *peak_at    = 0;
+    for (int i = 0; i < plan->num_segments; i++) {
+        const CheckpointSegment* seg = &plan->segments[i];
+        size_t at = held + seg->input_bytes + seg->saved_bytes + seg->work_bytes;
+        if (at > peak) {
+            peak     = at;
+            *peak_at = i;
+        }
+        held += seg->input_bytes + (seg->recompute ? 0 : seg->saved_bytes);
+    }
+    return peak;
+}
+
+int checkpoint_plan_set_budget(CheckpointPlan* plan, size_t budget_bytes) {
+    if (!plan)
+        return -1;
+    plan->budget_bytes = budget_bytes;
+    for (int i = 0; i < plan->num_segments; i++)
+        plan->segments[i].recompute = false;
+
+    /* Only segments before the peak lower it; drop the one freeing the most
+     * bytes per recomputed FLOP until the budget holds */
+    int at;
+    size_t peak = plan_predict(plan, &at);
+    while (budget_bytes > 0 && peak > budget_bytes) {
+        int best          = -1;
+        double best_ratio = 0.0;
+        for (int j = 0; j < at; j++) {
+            const CheckpointSegment* seg = &plan->segments[j];
+            if (seg->recompute || seg->saved_bytes == 0)
+                continue;
+            double ratio = (double)seg->saved_bytes / (double)(seg->flops + 1);
+            if (best < 0 || ratio > best_ratio) {
+                best       = j;
+                best_ratio = ratio;
+            }
+        }
+        if (best < 0)
+            break;
+        plan->segments[best].recompute = true;
+        peak = plan_predict(plan, &at);
+    }
+
+    /* Greedy picks can be made redundant by later ones: keep any dropped
+     * segment, most expensive first, whose activations still fit */
+    bool changed = peak <= budget_bytes;
+    while (changed) {
+        changed  = false;
+        int undo = -1;
+        for (int j = 0; j < plan->num_segments; j++) {
+            if (!plan->segments[j].recompute)
+                continue;
+            plan->segments[j].recompute = false;
+            bool still_fits = plan_predict(plan, &at) <= budget_bytes;
+            plan->segments[j].recompute = true;
+            if (still_fits && (undo < 0 || plan->segments[j].flops > plan->segments[undo].flops))
+                undo = j;
+        }
+        if (undo >= 0) {
+            plan->segments[undo].recompute = false;
+            changed                        = true;
+        }
+    }
+
+    peak                  = plan_predict(plan, &at);
+    plan->predicted_peak  = peak;
+    plan->fits            = budget_bytes == 0 || peak <= budget_bytes;
+    plan->recompute_flops = 0;
+    for (int i = 0; i < plan->num_segments; i++)
+        if (plan->segments[i].recompute)
+            plan->recompute_flops += plan->segments[i].flops;
+
+    if (!plan->fits) {
+        LOG_WARNING("Checkpointing: predicted peak %zu bytes exceeds the %zu-byte budget "
+                    "even with every earlier segment recomputed",
+                    peak, budget_bytes);
+        return -1;
+    }
+    LOG_DEBUG("Checkpointing: predicted peak %zu bytes, recompute %zu of %zu FLOPs", peak,
+              plan->recompute_flops, plan->total_flops);
+    return 0;
+}
+
+CheckpointPlan* checkpoint_plan_create(Sequential* seq, Tensor* sample_input,
+                                       size_t budget_bytes) {
+    int n = seq ? sequential_get_length(seq) : 0;
+    /* Segments run in graphs of their own, so pending input ops must land first */
+    if (n <= 0 || !sample_input || tensor_ensure_executed(sample_input) != 0) {
+        LOG_ERROR("Checkpointing: planner needs a non-empty Sequential and a sample input");
+        return NULL;
+    }
+
+    CheckpointPlan* plan = calloc(1, sizeof(CheckpointPlan));
+    if (!plan)
+        return NULL;
+    plan->model        = seq;
+    plan->num_segments = n;
+    plan->segments     = calloc((size_t)n, sizeof(CheckpointSegment));
+    if (!plan->segments) {
+        free(plan);
+        return NULL;
+    }
+
+    CheckpointSlot slot = {.input = sample_input};
+    int ret             = 0;
+    for (int i = 0; ret == 0 && i < n; i++) {
+        CheckpointSegment* seg = &plan->segments[i];
+        seg->input_bytes       = tensor_bytes(slot.input);
+        ret = segment_forward(seq, i, &slot, NULL, NULL, NULL);
+        if (ret == 0)
+            ret = segment_profile(&slot, seg);
+        plan->total_flops += seg->flops;
+
+        Tensor* next = ret == 0 && i + 1 < n ? segment_checkpoint(slot.output, false) : NULL;
+        if (ret == 0 && i + 1 < n && !next)
+            ret = -1;
+        slot_release(&slot);
+        if (slot.input != sample_input)
+            tensor_free(slot.input);
+        slot.input = next;
+    }
+    if (slot.input && slot.input != sample_input)
+        tensor_free(slot.input);
+    if (ret != 0) {
+        LOG_ERROR("Checkpointing: profiling the model failed");
+        checkpoint_plan_free(plan);
+        return NULL;
+    }
+
+    checkpoint_plan_set_budget(plan, budget_bytes);
+    return plan;
+}
+
+/* What the step holds now: inputs and graphs of segments 0..upto, with the
+ * gradients of the one in backward */
+static size_t step_live_bytes(const CheckpointSlot* slots, int upto, int in_backward) {
+    size_t bytes = 0;
+    for (int i = 0; i <= upto; i++) {
+        bytes += tensor_bytes(slots[i].input);
+        bytes += graph_live_bytes(slots[i].graph, i == in_backward);
+        if (i == in_backward && slots[i].input)
+            bytes += tensor_bytes(slots[i].input->grad);
+    }
+    return bytes;
+}
+
+int checkpoint_train_step(CheckpointPlan* plan, Tensor* input, Tensor* target,
+                          CheckpointLossFn loss_fn, void* loss_ctx, float* loss_out) {
+    if (!plan || !input || !target || !loss_fn || tensor_ensure_executed(input) != 0 ||
+        tensor_ensure_executed(target) != 0)
+        return -1;
+    int n = plan->num_segments;
+    CheckpointSlot* slots = calloc((size_t)n, sizeof(CheckpointSlot));
+    if (!slots)
+        return -1;
+
+    size_t peak    = 0;
+    int ret        = 0;
+    slots[0].input = input;
+    for (int i = 0; ret == 0 && i < n; i++) {
+        bool last = i == n - 1;
+        ret = segment_forward(plan->model, i, &slots[i], target, last ? loss_fn : NULL,
+                              loss_ctx);
+        if (ret != 0)
+            break;
+        size_t live = step_live_bytes(slots, i, -1);
+        peak        = live > peak ? live : peak;
+        if (!last) {
+            slots[i + 1].input = segment_checkpoint(slots[i].output, true);
+            if (!slots[i + 1].input)
+                ret = -1;
+        }
+        if (!last && plan->segments[i].recompute)
+            slot_release(&slots[i]);
+    }
+    if (ret == 0 && loss_out)
+        *loss_out = tensor_get_float(slots[n - 1].loss, 0);
+
+    Tensor* grad = NULL;
+    for (int i = n - 1; ret == 0 && i >= 0; i--) {
+        CheckpointSlot* slot = &slots[i];
+        if (!slot->graph)
+            ret = segment_forward(plan->model, i, slot, NULL, NULL, NULL);
+        if (ret != 0)
+            break;
+
+        CMLGraph_t prev = cml_ir_get_or_create_context();
+        cml_ir_set_global_context(slot->graph);
+        tensor_backward(slot->loss ? slot->loss : slot->output, grad, false, false);
+        cml_ir_set_global_context(prev);
+        size_t live = step_live_bytes(slots, i, i);
+        peak        = live > peak ? live : peak;
+
+        if (grad)
+            tensor_free(grad);
+        grad = NULL;
+        if (i > 0) {
+            grad = slot->input->grad ? segment_checkpoint(slot->input->grad, false) : NULL;
+            if (!grad) {
+                LOG_ERROR("Checkpointing: segment %d produced no input gradient", i);
+                ret = -1;
+            }
+        }
+        slot_release(slot);
+        if (i > 0) {
+            tensor_free(slot->input);
+            slot->input = NULL;
+        }
+    }
+    if (grad)
+        tensor_free(grad);
+
+    for (int i = 0; i < n; i++) {
+        slot_release(&slots[i]);
+        if (i > 0 && slots[i].input)
+            tensor_free(slots[i].input);
+    }
+    free(slots);
+
+    if (ret == 0) {
+        plan->actual_peak = peak;
+        LOG_DEBUG("Checkpointing step: peak %zu bytes (predicted %zu)", peak,
+                  plan->predicted_peak);
+    }
+    return ret;
+}
+
+void checkpoint_plan_print(const CheckpointPlan* plan) {
+    if (!plan)
+        return;
+    printf("Checkpoint plan (%d segments):\n", plan->num_segments);
+    for (int i = 0; i < plan->num_segments; i++) {
+        const CheckpointSegment* seg = &plan->segments[i];
+        printf("  [%2d] %-9s saved %10zu  work %10zu  flops %12zu\n", i,
+               seg->recompute ? "recompute" : "keep", seg->saved_bytes, seg->work_bytes,
+               seg->flops);
+    }
+    if (plan->budget_bytes)
+        printf("  Budget:         %zu bytes%s\n", plan->budget_bytes,
+               plan->fits ? "" : " (not met)");
+    else
+        printf("  Budget:         none\n");
+    printf("  Predicted peak: %zu bytes\n", plan->predicted_peak);
+    if (plan->actual_peak)
+        printf("  Actual peak:    %zu bytes\n", plan->actual_peak);
+    printf("  Recompute:      %zu of %zu FLOPs\n", plan->recompute_flops, plan->total_flops);
+}
+
+void checkpoint_plan_free(CheckpointPlan* plan) {
+    if (!plan)
+        return;
+    free(plan->segments);
+    free(plan);
+}
@@ -1,4 +1,5 @@
 #include "backend/blas.h"
+#include "backend/threadpool.h"
 #include "core/logging.h"
 
 #include <stdlib.h>
@@ -266,8 +267,6 @@ void cml_blas_free(CMLBlasContext* ctx) {
     }
     blas_unlock();
 
-    free(ctx->pack_a_buf);
-    free(ctx->pack_b_buf);
     free(ctx);
 }
 
@@ -453,6 +452,49 @@ static void sgemm_ukr_edge(float* C, int ldc,
             C[r * ldc + c] = buf[r * PACKED_NR + c];
 }
 
+/* Pack the NR-wide panels [jr_begin, jr_end) of the (KC_cur × NC_cur) B strip
+ * starting at (pc, jc). Panel p lands at b_pack + p * KC_cur * NR. */
+static void packed_pack_B_strip(const float* B, float* b_pack, int N, int pc, int jc,
+                                int KC_cur, int NC_cur, int jr_begin, int jr_end) {
+    for (int jr = jr_begin; jr < jr_end; jr += PACKED_NR) {
+        int NR_cur = ((jr + PACKED_NR) > NC_cur) ? (NC_cur - jr) : PACKED_NR;
+        pack_B_panel(B + pc * N + jc + jr,
+                     b_pack + (jr / PACKED_NR) * KC_cur * PACKED_NR,
+                     KC_cur, NR_cur, N);
+    }
+}
+
+/* Pack the (MC_cur × KC_cur) A block at (ic, pc) into a_pack, then sweep the
+ * micro-kernel over output columns [jr_begin, jr_end) of the packed B strip. */
+static void packed_macro_kernel(const float* A, float* C, const float* b_pack, float* a_pack,
+                                int N, int K, int ic, int pc, int jc,
+                                int MC_cur, int KC_cur, int NC_cur, int jr_begin, int jr_end,
+                                float alpha, float beta) {
+    for (int ir = 0; ir < MC_cur; ir += PACKED_MR) {
+        int MR_cur = ((ir + PACKED_MR) > MC_cur) ? (MC_cur - ir) : PACKED_MR;
+        pack_A_panel(A + (ic + ir) * K + pc,
+                     a_pack + (ir / PACKED_MR) * KC_cur * PACKED_MR,
+                     MR_cur, KC_cur, K);
+    }
+
+    for (int jr = jr_begin; jr < jr_end; jr += PACKED_NR) {
+        int NR_cur = ((jr + PACKED_NR) > NC_cur) ? (NC_cur - jr) : PACKED_NR;
+        const float* B_panel = b_pack + (jr / PACKED_NR) * KC_cur * PACKED_NR;
+
+        for (int ir = 0; ir < MC_cur; ir += PACKED_MR) {
+            int MR_cur = ((ir + PACKED_MR) > MC_cur) ? (MC_cur - ir) : PACKED_MR;
+            const float* A_panel = a_pack + (ir / PACKED_MR) * KC_cur * PACKED_MR;
+            float* C_tile = C + (ic + ir) * N + (jc + jr);
+
+            if (MR_cur == PACKED_MR && NR_cur == PACKED_NR)
+                sgemm_ukr_6x16(C_tile, N, A_panel, B_panel, KC_cur, alpha, beta);
+            else
+                sgemm_ukr_edge(C_tile, N, A_panel, B_panel,
+                               MR_cur, NR_cur, KC_cur, alpha, beta);
+        }
+    }
+}
+
 /* Three-level tiled GEMM: C = alpha*A*B + beta*C.
  * a_pack: ≥ PACKED_MC * PACKED_KC floats (aligned to 32 bytes).
  * b_pack: ≥ ceil(N/NR)*NR * PACKED_KC floats (aligned to 32 bytes).
@@ -467,45 +509,227 @@ static void sgemm_packed_avx(const float* A, const float* B, float* C,
             int KC_cur = ((pc + PACKED_KC) > K) ? (K - pc) : PACKED_KC;
             float use_beta = (pc == 0) ? beta : 1.0f;
 
-            /* Pack B strip (KC_cur × NC_cur) into NR-wide panels */
-            for (int jr = 0; jr < NC_cur; jr += PACKED_NR) {
-                int NR_cur = ((jr + PACKED_NR) > NC_cur) ? (NC_cur - jr) : PACKED_NR;
-                pack_B_panel(B + pc * N + jc + jr,
-                             b_pack + (jr / PACKED_NR) * KC_cur * PACKED_NR,
-                             KC_cur, NR_cur, N);
-            }
+            packed_pack_B_strip(B, b_pack, N, pc, jc, KC_cur, NC_cur, 0, NC_cur);
 
             for (int ic = 0; ic < M; ic += PACKED_MC) {
                 int MC_cur = ((ic + PACKED_MC) > M) ? (M - ic) : PACKED_MC;
+                packed_macro_kernel(A, C, b_pack, a_pack, N, K, ic, pc, jc,
+                                    MC_cur, KC_cur, NC_cur, 0, NC_cur, alpha, use_beta);
+            }
+        }
+    }
+}
 
-                /* Pack A strip (MC_cur × KC_cur) into MR-wide panels */
-                for (int ir = 0; ir < MC_cur; ir += PACKED_MR) {
-                    int MR_cur = ((ir + PACKED_MR) > MC_cur) ? (MC_cur - ir) : PACKED_MR;
-                    pack_A_panel(A + (ic + ir) * K + pc,
-                                 a_pack + (ir / PACKED_MR) * KC_cur * PACKED_MR,
-                                 MR_cur, KC_cur, K);
-                }
+/* ── Per-thread pack scratch ─────────────────────────────────────────────────
+ * Each thread that packs (the caller for B strips, every pool worker for A
+ * blocks) keeps its own grow-only buffers, so concurrent cml_blas_sgemm calls
+ * never share scratch and steady state does no allocation. The B buffer stays
+ * in use while the caller waits on the pool, and a waiting caller may pick up
+ * a queued task that starts another GEMM; b_busy sends that nested call to a
+ * private allocation instead. */
+typedef struct {
+    float* a;
+    size_t a_size;
+    float* b;
+    size_t b_size;
+    bool b_busy;
+} PackScratch;
+
+static pthread_key_t g_pack_key;
+static pthread_once_t g_pack_key_once = PTHREAD_ONCE_INIT;
+
+static void pack_scratch_destroy(void* p) {
+    PackScratch* s = (PackScratch*)p;
+    if (!s)
+        return;
+    free(s->a);
+    free(s->b);
+    free(s);
+}
 
-                /* Micro-kernel sweep over the MC × NC output tile */
-                for (int jr = 0; jr < NC_cur; jr += PACKED_NR) {
-                    int NR_cur = ((jr + PACKED_NR) > NC_cur) ? (NC_cur - jr) : PACKED_NR;
-                    const float* B_panel = b_pack + (jr / PACKED_NR) * KC_cur * PACKED_NR;
-
-                    for (int ir = 0; ir < MC_cur; ir += PACKED_MR) {
-                        int MR_cur = ((ir + PACKED_MR) > MC_cur) ? (MC_cur - ir) : PACKED_MR;
-                        const float* A_panel = a_pack + (ir / PACKED_MR) * KC_cur * PACKED_MR;
-                        float* C_tile = C + (ic + ir) * N + (jc + jr);
-
-                        if (MR_cur == PACKED_MR && NR_cur == PACKED_NR)
-                            sgemm_ukr_6x16(C_tile, N, A_panel, B_panel, KC_cur, alpha, use_beta);
-                        else
-                            sgemm_ukr_edge(C_tile, N, A_panel, B_panel,
-                                           MR_cur, NR_cur, KC_cur, alpha, use_beta);
-                    }
-                }
-            }
+static void pack_key_create(void) { pthread_key_create(&g_pack_key, pack_scratch_destroy); }
+
+static float* pack_scratch_reserve(float** buf, size_t* size, size_t need) {
+    if (*size < need) {
+        free(*buf);
+        *buf  = (float*)aligned_alloc(32, need);
+        *size = *buf ? need : 0;
+    }
+    return *buf;
+}
+
+static PackScratch* pack_scratch_get(void) {
+    pthread_once(&g_pack_key_once, pack_key_create);
+    PackScratch* s = (PackScratch*)pthread_getspecific(g_pack_key);
+    if (!s) {
+        s = calloc(1, sizeof(PackScratch));
+        if (s)
+            pthread_setspecific(g_pack_key, s);
+    }
+    return s;
+}
+
+static float* pack_scratch_a(void) {
+    PackScratch* s = pack_scratch_get();
+    return s ? pack_scratch_reserve(&s->a, &s->a_size,
+                                    (size_t)PACKED_MC * PACKED_KC * sizeof(float))
+             : NULL;
+}
+
+/* B pack buffer for one GEMM: the thread's scratch, or a private allocation
+ * when an outer GEMM on this thread still holds it. */
+static float* pack_b_acquire(PackScratch* s, int N, bool* owned) {
+    int nc_alloc = ((N + PACKED_NR - 1) / PACKED_NR) * PACKED_NR;
+    if (nc_alloc > PACKED_NC) nc_alloc = PACKED_NC;
+    size_t bytes = (size_t)nc_alloc * PACKED_KC * sizeof(float);
+
+    *owned = s->b_busy;
+    if (*owned)
+        return (float*)aligned_alloc(32, bytes);
+    float* b = pack_scratch_reserve(&s->b, &s->b_size, bytes);
+    if (b)
+        s->b_busy = true;
+    return b;
+}
+
+static void pack_b_release(PackScratch* s, float* b, bool owned) {
+    if (owned)
+        free(b);
+    else
+        s->b_busy = false;
+}
+
+/* ── Multi-threaded packed GEMM ──────────────────────────────────────────────
+ * For every (jc, pc) step the B strip is packed once into the caller's
+ * scratch, split by NR panels across the pool. The MC × NC output tile grid
+ * is then split into (ic block, jr range) work items; each worker packs its
+ * own A block into its thread-local panel and runs the micro-kernel over its
+ * column range. Each threadpool_parallel_for doubles as the barrier between
+ * packing B and consuming it. */
+typedef struct {
+    const float* A;
+    const float* B;
+    float* C;
+    int N, K;
+    float alpha, beta;
+    float* b_pack;
+    int jc, pc, NC_cur, KC_cur;
+    int M;
+    int nthreads;
+    int ic_blocks;  /* ceil(M / MC) */
+    int jr_groups;  /* column ranges each ic block is split into */
+    int panels;     /* ceil(NC_cur / NR) */
+    atomic_bool failed; /* a worker could not get A scratch */
+} PackedGemmJob;
+
+static void packed_pack_B_task(void* data, size_t start, size_t end) {
+    PackedGemmJob* job = (PackedGemmJob*)data;
+    for (size_t t = start; t < end; t++) {
+        int p0 = (int)((long long)t * job->panels / job->nthreads);
+        int p1 = (int)((long long)(t + 1) * job->panels / job->nthreads);
+        if (p0 >= p1)
+            continue;
+        int jr_end = p1 * PACKED_NR > job->NC_cur ? job->NC_cur : p1 * PACKED_NR;
+        packed_pack_B_strip(job->B, job->b_pack, job->N, job->pc, job->jc,
+                            job->KC_cur, job->NC_cur, p0 * PACKED_NR, jr_end);
+    }
+}
+
+static void packed_compute_task(void* data, size_t start, size_t end) {
+    PackedGemmJob* job = (PackedGemmJob*)data;
+    int items          = job->ic_blocks * job->jr_groups;
+    float use_beta     = (job->pc == 0) ? job->beta : 1.0f;
+
+    float* a_pack = pack_scratch_a();
+    if (!a_pack) {
+        atomic_store(&job->failed, true);
+        return;
+    }
+
+    for (size_t t = start; t < end; t++) {
+        for (int item = (int)t; item < items; item += job->nthreads) {
+            int icb = item / job->jr_groups;
+            int g   = item % job->jr_groups;
+            int p0  = (int)((long long)g * job->panels / job->jr_groups);
+            int p1  = (int)((long long)(g + 1) * job->panels / job->jr_groups);
+            if (p0 >= p1)
+                continue;
+
+            int ic     = icb * PACKED_MC;
+            int MC_cur = ((ic + PACKED_MC) > job->M) ? (job->M - ic) : PACKED_MC;
+            int jr_end = p1 * PACKED_NR > job->NC_cur ? job->NC_cur : p1 * PACKED_NR;
+            packed_macro_kernel(job->A, job->C, job->b_pack, a_pack, job->N, job->K,
+                                ic, job->pc, job->jc, MC_cur, job->KC_cur, job->NC_cur,
+                                p0 * PACKED_NR, jr_end, job->alpha, use_beta);
+        }
+    }
+}
+
+/* Returns 1 if the caller's scratch is unavailable (nothing written, caller
+ * may fall back), -1 if a worker ran out of memory mid-way (C is undefined),
+ * 0 on success. */
+static int sgemm_packed_avx_mt(ThreadPool* pool, int nthreads,
+                               const float* A, const float* B, float* C,
+                               int M, int N, int K, float alpha, float beta) {
+    PackScratch* scratch = pack_scratch_get();
+    if (!scratch || !pack_scratch_a())
+        return 1;
+
+    bool own_b;
+    float* b_pack = pack_b_acquire(scratch, N, &own_b);
+    if (!b_pack)
+        return 1;
+
+    PackedGemmJob job = {
+        .A = A, .B = B, .C = C, .N = N, .K = K, .alpha = alpha, .beta = beta,
+        .b_pack = b_pack, .M = M, .nthreads = nthreads,
+        .ic_blocks = (M + PACKED_MC - 1) / PACKED_MC,
+    };
+
+    for (int jc = 0; jc < N; jc += PACKED_NC) {
+        job.jc     = jc;
+        job.NC_cur = ((jc + PACKED_NC) > N) ? (N - jc) : PACKED_NC;
+        job.panels = (job.NC_cur + PACKED_NR - 1) / PACKED_NR;
+
+        /* Enough column ranges per ic block to give every thread work, but
+         * never narrower than one NR panel. */
+        job.jr_groups = (nthreads + job.ic_blocks - 1) / job.ic_blocks;
+        if (job.jr_groups > job.panels) job.jr_groups = job.panels;
+        if (job.jr_groups < 1) job.jr_groups = 1;
+
+        for (int pc = 0; pc < K; pc += PACKED_KC) {
+            job.pc     = pc;
+            job.KC_cur = ((pc + PACKED_KC) > K) ? (K - pc) : PACKED_KC;
+
+            threadpool_parallel_for_grain(pool, packed_pack_B_task, &job, (size_t)nthreads, 1);
+            threadpool_parallel_for_grain(pool, packed_compute_task, &job, (size_t)nthreads, 1);
         }
     }
+
+    pack_b_release(scratch, b_pack, own_b);
+    return atomic_load(&job.failed) ? -1 : 0;
+}
+
+/* Minimum M·N·K per thread before the packed path fans out. One 6×16 tile
+ * sweep of this size runs for tens of microseconds, comfortably above the
+ * pool's dispatch cost; below it extra threads only add barrier time. */
+#define PACKED_FLOPS_PER_THREAD (1LL * 1024 * 1024)
+
+/* Thread count for the packed path, following blas_set_threads_for_size:
+ * scale with problem size, capped by CML_GEMM_THREADS and the caller's thread
+ * budget (the whole pool unless an inter-op executor narrowed it). */
+static int packed_threads_for_size(ThreadPool* pool, long long flops) {
+    static int env_cap = -1;
+    if (env_cap < 0) {
+        const char* env = getenv("CML_GEMM_THREADS");
+        env_cap = (env && atoi(env) > 0) ? atoi(env) : 0;
+    }
+
+    long long n = flops / PACKED_FLOPS_PER_THREAD;
+    long long cap = pool ? (long long)threadpool_get_thread_budget(pool) : 1;
+    if (env_cap > 0 && env_cap < cap) cap = env_cap;
+    if (n > cap) n = cap;
+    return n < 1 ? 1 : (int)n;
 }
 
 /* Threshold above which scipy_openblas64 beats the packed kernel.
@@ -559,32 +783,32 @@ int cml_blas_sgemm(CMLBlasContext* ctx, const float* A, const float* B, float* C
             return 0;
         }
 #ifdef __FMA__
-        /* Medium-matrix path: packed 6×16 kernel.
-         * For ILP64: only use when both flops are small AND N fits in one NC-panel
-         * (N > PACKED_NC means ILP64's multi-threading beats the single-threaded
-         * packed kernel even at small flops — e.g. im2col GEMM M=16, N=7200, K=27).
+        /* Medium-matrix path: packed 6×16 kernel, multi-threaded on the
+         * global pool once the problem is large enough to amortise dispatch.
+         * For ILP64: only use when flops are small AND either N fits in one
+         * NC-panel or we fan out across threads (N > PACKED_NC single-threaded
+         * loses to ILP64's threading — e.g. im2col GEMM M=16, N=7200, K=27).
          * Without ILP64: always use packed (far better than LP64 OpenBLAS-OpenMP). */
-        bool use_packed = !ctx->is_ilp64 ||
-                          (flops < MEDIUM_GEMM_THRESHOLD && N <= PACKED_NC);
+        ThreadPool* pool = threadpool_get_global();
+        int nthreads     = packed_threads_for_size(pool, flops);
+        bool use_packed  = !ctx->is_ilp64 ||
+                           (flops < MEDIUM_GEMM_THRESHOLD && (N <= PACKED_NC || nthreads > 1));
         if (use_packed) {
-            int nc_alloc = ((N + PACKED_NR - 1) / PACKED_NR) * PACKED_NR;
-            if (nc_alloc > PACKED_NC) nc_alloc = PACKED_NC;
-            size_t need_a = (size_t)PACKED_MC * PACKED_KC * sizeof(float);
-            size_t need_b = (size_t)nc_alloc * PACKED_KC * sizeof(float);
-            /* Grow context-resident buffers lazily — amortises alloc across calls */
-            if (ctx->pack_a_size < need_a) {
-                free(ctx->pack_a_buf);
-                ctx->pack_a_buf  = (float*)aligned_alloc(32, need_a);
-                ctx->pack_a_size = ctx->pack_a_buf ? need_a : 0;
-            }
-            if (ctx->pack_b_size < need_b) {
-                free(ctx->pack_b_buf);
-                ctx->pack_b_buf  = (float*)aligned_alloc(32, need_b);
-                ctx->pack_b_size = ctx->pack_b_buf ? need_b : 0;
+            if (nthreads > 1) {
+                int rc = sgemm_packed_avx_mt(pool, nthreads, A, B, C, M, N, K, alpha, beta);
+                if (rc <= 0) {
+                    if (rc < 0)
+                        LOG_ERROR("Packed GEMM: out of memory for pack scratch");
+                    return rc;
+                }
             }
-            if (ctx->pack_a_buf && ctx->pack_b_buf) {
-                sgemm_packed_avx(A, B, C, M, N, K, alpha, beta,
-                                 ctx->pack_a_buf, ctx->pack_b_buf);
+            PackScratch* scratch = pack_scratch_get();
+            float* a_pack        = pack_scratch_a();
+            bool own_b           = false;
+            float* b_pack        = (scratch && a_pack) ? pack_b_acquire(scratch, N, &own_b) : NULL;
+            if (b_pack) {
+                sgemm_packed_avx(A, B, C, M, N, K, alpha, beta, a_pack, b_pack);
+                pack_b_release(scratch, b_pack, own_b);
                 return 0;
             }
         }
@@ -1,42 +1,109 @@
 #define _POSIX_C_SOURCE 200809L
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
 #ifdef __APPLE__
 #define _DARWIN_C_SOURCE
 #endif
 #include "backend/threadpool.h"
 #include "core/logging.h"
 #include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <time.h>
 
-typedef struct TaskNode {
-    Task task;
-    struct TaskNode* next;
-    volatile int completed_chunks; // Atomic counter for completed chunks
-    int total_chunks;
-    bool completed;
-} TaskNode;
+/*
+ * Work-stealing thread pool.
+ *
+ * Every worker owns a fixed-size Chase-Lev deque: the owner pushes and pops
+ * at the bottom without locks, idle workers steal from the top with a CAS.
+ * Threads that are not workers of the pool (the main thread, other pools'
+ * workers) hand work in through a small mutex-protected injector list.
+ *
+ * threadpool_parallel_for splits [0, n) into grain-sized chunks claimed from
+ * an atomic counter. The caller pushes one helper item per extra thread,
+ * works on chunks itself, and while waiting for stragglers keeps running
+ * other queued items — so a chunk that calls parallel_for again never
+ * blocks a worker the outer loop is waiting on.
+ *
+ * Idle workers spin over steal attempts for a short while, then park on a
+ * condition variable keyed by a work epoch so a push is never missed.
+ */
+
+#define DEQUE_CAPACITY 256 /* Power of two; a full deque runs the item inline */
+#define DEQUE_MASK (DEQUE_CAPACITY - 1)
+#define DEFAULT_SPIN_ITERATIONS 2048
+#define CHUNKS_PER_THREAD 4 /* Default grain: ~4 chunks per thread for balance */
+#define MAX_STACK_HELPERS 32
+
+typedef struct WorkItem WorkItem;
+struct WorkItem {
+    void (*run)(WorkItem* item);
+    WorkItem* next; /* Injector list link */
+};
+
+typedef struct {
+    _Atomic(int64_t) top;
+    _Atomic(int64_t) bottom;
+    _Atomic(WorkItem*) buf[DEQUE_CAPACITY];
+} WorkDeque;
 
 typedef struct {
-    Task task;
     pthread_t thread;
-    bool active;
-    bool completed;
     size_t id;
     ThreadPool* pool;
+    uint32_t rng;
+    WorkDeque deque;
 } Worker;
 
 struct ThreadPool {
     Worker* workers;
-    size_t num_threads;
-    pthread_mutex_t mutex;
-    pthread_cond_t cond;
-    pthread_cond_t task_cond; // Condition for task availability
-    TaskNode* task_queue_head;
-    TaskNode* task_queue_tail;
-    size_t queue_size;
-    size_t active_tasks;
-    bool shutdown;
+    size_t num_workers; /* Spawned threads; the calling thread is the extra one */
+    size_t num_threads; /* num_workers + 1 */
+    unsigned spin_iterations;
+    bool pinned;
+
+    /* Injector for work coming from threads outside the pool */
+    pthread_mutex_t inject_lock;
+    WorkItem* inject_head;
+    WorkItem* inject_tail;
+    atomic_size_t inject_count;
+
+    /* Parking */
+    pthread_mutex_t park_lock;
+    pthread_cond_t park_cond;
+    atomic_uint_fast64_t epoch;
+    atomic_size_t sleepers;
+    atomic_bool shutdown;
+
+    /* threadpool_submit bookkeeping */
+    atomic_size_t outstanding;
+    pthread_mutex_t wait_lock;
+    pthread_cond_t wait_cond;
+};
+
+typedef struct ForJob ForJob;
+
+typedef struct {
+    WorkItem item;
+    ForJob* job;
+} ForHelper;
+
+struct ForJob {
+    TaskFunc func;
+    void* data;
+    size_t n;
+    size_t grain;
+    size_t num_chunks;
+    atomic_size_t next_chunk;
+    atomic_size_t done_chunks;
+    atomic_size_t helpers_pending;
+    ThreadPool* pool;
+    bool detached; /* threadpool_submit: freed by the last helper */
+    ForHelper* helpers;
 };
 
 static pthread_mutex_t g_pool_lock;
@@ -51,126 +118,415 @@ static inline void pool_unlock(void) {
 
 static ThreadPool* g_global_pool = NULL;
 
+/* Worker record of the pool thread running on this thread, if any */
+static _Thread_local Worker* tl_worker = NULL;
+/* Victim selection for threads outside any pool */
+static _Thread_local uint32_t tl_rng = 0x2545F491u;
+/* Cap on threads a parallel_for started from this thread may use (0 = none) */
+static _Thread_local size_t tl_budget = 0;
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/* ── Chase-Lev deque (Lê et al., "Correct and Efficient Work-Stealing for
+ *    Weak Memory Models", fixed capacity) ─────────────────────────────────── */
+
+static bool deque_push(WorkDeque* d, WorkItem* item) {
+    int64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    int64_t t = atomic_load_explicit(&d->top, memory_order_acquire);
+    if (b - t >= DEQUE_CAPACITY) {
+        return false;
+    }
+    atomic_store_explicit(&d->buf[b & DEQUE_MASK], item, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    return true;
+}
+
+static WorkItem* deque_pop(WorkDeque* d) {
+    int64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t t = atomic_load_explicit(&d->top, memory_order_relaxed);
+
+    if (t > b) {
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    WorkItem* item = atomic_load_explicit(&d->buf[b & DEQUE_MASK], memory_order_relaxed);
+    if (t == b) {
+        // Last item: race against thieves for it
+        if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst,
+                                                     memory_order_relaxed)) {
+            item = NULL;
+        }
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    }
+    return item;
+}
+
+static WorkItem* deque_steal(WorkDeque* d) {
+    int64_t t = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+    if (t >= b) {
+        return NULL;
+    }
+    WorkItem* item = atomic_load_explicit(&d->buf[t & DEQUE_MASK], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst,
+                                                 memory_order_relaxed)) {
+        return NULL;
+    }
+    return item;
+}
+
+/* ── Injector and wakeups ────────────────────────────────────────────────── */
+
+static void inject_push(ThreadPool* pool, WorkItem* item) {
+    item->next = NULL;
+    pthread_mutex_lock(&pool->inject_lock);
+    if (pool->inject_tail) {
+        pool->inject_tail->next = item;
+    } else {
+        pool->inject_head = item;
+    }
+    pool->inject_tail = item;
+    atomic_fetch_add_explicit(&pool->inject_count, 1, memory_order_release);
+    pthread_mutex_unlock(&pool->inject_lock);
+}
+
+static WorkItem* inject_pop(ThreadPool* pool) {
+    if (atomic_load_explicit(&pool->inject_count, memory_order_acquire) == 0) {
+        return NULL;
+    }
+    pthread_mutex_lock(&pool->inject_lock);
+    WorkItem* item = pool->inject_head;
+    if (item) {
+        pool->inject_head = item->next;
+        if (!pool->inject_head) {
+            pool->inject_tail = NULL;
+        }
+        atomic_fetch_sub_explicit(&pool->inject_count, 1, memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&pool->inject_lock);
+    return item;
+}
+
+static void notify_workers(ThreadPool* pool) {
+    atomic_fetch_add_explicit(&pool->epoch, 1, memory_order_seq_cst);
+    if (atomic_load_explicit(&pool->sleepers, memory_order_seq_cst) > 0) {
+        pthread_mutex_lock(&pool->park_lock);
+        pthread_cond_broadcast(&pool->park_cond);
+        pthread_mutex_unlock(&pool->park_lock);
+    }
+}
+
+/* Queue an item from the current thread: own deque for workers of this pool,
+ * injector otherwise. */
+static bool enqueue_item(ThreadPool* pool, WorkItem* item) {
+    if (tl_worker && tl_worker->pool == pool) {
+        return deque_push(&tl_worker->deque, item);
+    }
+    inject_push(pool, item);
+    return true;
+}
+
+static inline uint32_t xorshift32(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+/* Find one runnable item: own deque first, then a sweep over the other
+ * workers starting at a random victim, then the injector. */
+static WorkItem* find_work(ThreadPool* pool, Worker* self) {
+    WorkItem* item;
+    if (self) {
+        item = deque_pop(&self->deque);
+        if (item) {
+            return item;
+        }
+    }
+
+    size_t n = pool->num_workers;
+    if (n > 0) {
+        size_t start = xorshift32(self ? &self->rng : &tl_rng) % n;
+        for (size_t i = 0; i < n; i++) {
+            Worker* victim = &pool->workers[(start + i) % n];
+            if (victim == self) {
+                continue;
+            }
+            item = deque_steal(&victim->deque);
+            if (item) {
+                return item;
+            }
+        }
+    }
+
+    return inject_pop(pool);
+}
+
+/* Run one queued item if there is one. Used by waiting callers so that
+ * nested parallel_for and submit/wait keep making progress. */
+static bool help_once(ThreadPool* pool) {
+    Worker* self   = (tl_worker && tl_worker->pool == pool) ? tl_worker : NULL;
+    WorkItem* item = find_work(pool, self);
+    if (!item) {
+        return false;
+    }
+    item->run(item);
+    return true;
+}
+
+static void backoff(unsigned* spins) {
+    if (++*spins < 64) {
+        cpu_relax();
+    } else {
+        sched_yield();
+    }
+}
+
+/* ── Workers ─────────────────────────────────────────────────────────────── */
+
+static void pin_to_cpu(pthread_t thread, size_t cpu) {
+#ifdef __linux__
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpu < 1) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET((int)(cpu % (size_t)ncpu), &set);
+    if (pthread_setaffinity_np(thread, sizeof(set), &set) != 0) {
+        LOG_WARNING("Failed to pin thread pool worker to CPU %zu", cpu);
+    }
+#else
+    (void)thread;
+    (void)cpu;
+#endif
+}
+
 static void* worker_thread(void* arg) {
     Worker* worker   = (Worker*)arg;
     ThreadPool* pool = worker->pool;
-
-    while (1) {
-        pthread_mutex_lock(&pool->mutex);
-
-        while (!pool->shutdown && pool->task_queue_head == NULL) {
-            pthread_cond_wait(&pool->task_cond, &pool->mutex);
+    tl_worker        = worker;
+
+    // Wait for threadpool_create_ex to settle the worker count
+    pthread_mutex_lock(&pool->park_lock);
+    pthread_mutex_unlock(&pool->park_lock);
+
+    unsigned spins = 0;
+    while (!atomic_load_explicit(&pool->shutdown, memory_order_acquire)) {
+        WorkItem* item = find_work(pool, worker);
+        if (item) {
+            item->run(item);
+            spins = 0;
+            continue;
         }
 
-        if (pool->shutdown) {
-            pthread_mutex_unlock(&pool->mutex);
-            break;
+        if (++spins < pool->spin_iterations) {
+            cpu_relax();
+            continue;
         }
 
-        // Get current task (all workers work on same task)
-        TaskNode* task_node = pool->task_queue_head;
-        if (task_node && !task_node->completed) {
-            Task task = task_node->task;
-            pool->active_tasks++;
-            pthread_mutex_unlock(&pool->mutex);
-
-            size_t chunk_size = task.total_size / pool->num_threads;
-            size_t start      = worker->id * chunk_size;
-            size_t end =
-                (worker->id == pool->num_threads - 1) ? task.total_size : start + chunk_size;
-
-            task.func(task.data, start, end);
-
-            pthread_mutex_lock(&pool->mutex);
-            task_node->completed_chunks++;
-            pool->active_tasks--;
-
-            // If all chunks completed, mark task as done and notify waiters
-            if (task_node->completed_chunks >= task_node->total_chunks) {
-                task_node->completed = true;
-                pool->task_queue_head = task_node->next;
-                if (!pool->task_queue_head) {
-                    pool->task_queue_tail = NULL;
-                }
-                pool->queue_size--;
-                free(task_node);
-                pthread_cond_broadcast(&pool->cond);
+        // Park: announce ourselves, then re-check for work against the
+        // epoch so a push racing with us is not lost.
+        atomic_fetch_add_explicit(&pool->sleepers, 1, memory_order_seq_cst);
+        uint_fast64_t seen = atomic_load_explicit(&pool->epoch, memory_order_seq_cst);
+        item               = find_work(pool, worker);
+        if (!item) {
+            pthread_mutex_lock(&pool->park_lock);
+            while (atomic_load_explicit(&pool->epoch, memory_order_seq_cst) == seen &&
+                   !atomic_load_explicit(&pool->shutdown, memory_order_acquire)) {
+                pthread_cond_wait(&pool->park_cond, &pool->park_lock);
             }
-            pthread_mutex_unlock(&pool->mutex);
-        } else {
-            pthread_mutex_unlock(&pool->mutex);
+            pthread_mutex_unlock(&pool->park_lock);
+        }
+        atomic_fetch_sub_explicit(&pool->sleepers, 1, memory_order_seq_cst);
+        if (item) {
+            item->run(item);
         }
+        spins = 0;
     }
 
     return NULL;
 }
 
-ThreadPool* threadpool_create(size_t num_threads) {
-    if (num_threads == 0) {
-        num_threads = (size_t)sysconf(_SC_NPROCESSORS_ONLN);
-        if (num_threads == 0) {
-            num_threads = 1;
+/* ── Parallel-for jobs ───────────────────────────────────────────────────── */
+
+static void for_job_work(ForJob* job) {
+    while (1) {
+        size_t c = atomic_fetch_add_explicit(&job->next_chunk, 1, memory_order_relaxed);
+        if (c >= job->num_chunks) {
+            break;
+        }
+        size_t start = c * job->grain;
+        size_t end   = start + job->grain < job->n ? start + job->grain : job->n;
+        job->func(job->data, start, end);
+        atomic_fetch_add_explicit(&job->done_chunks, 1, memory_order_release);
+    }
+}
+
+static void for_job_finish_detached(ForJob* job) {
+    ThreadPool* pool = job->pool;
+    free(job->helpers);
+    free(job);
+    if (atomic_fetch_sub_explicit(&pool->outstanding, 1, memory_order_acq_rel) == 1) {
+        pthread_mutex_lock(&pool->wait_lock);
+        pthread_cond_broadcast(&pool->wait_cond);
+        pthread_mutex_unlock(&pool->wait_lock);
+    }
+}
+
+static void run_for_helper(WorkItem* item) {
+    ForJob* job = ((ForHelper*)item)->job;
+    for_job_work(job);
+    // Last touch of job memory: the owner may return (or free) right after.
+    bool detached = job->detached;
+    if (atomic_fetch_sub_explicit(&job->helpers_pending, 1, memory_order_acq_rel) == 1 &&
+        detached) {
+        for_job_finish_detached(job);
+    }
+}
+
+static size_t default_grain(ThreadPool* pool, size_t n) {
+    size_t chunks = threadpool_get_thread_budget(pool) * CHUNKS_PER_THREAD;
+    size_t grain  = (n + chunks - 1) / chunks;
+    return grain ? grain : 1;
+}
+
+/* Push helpers for job; returns how many were actually queued. */
+static size_t spawn_helpers(ThreadPool* pool, ForJob* job, size_t count) {
+    size_t queued = 0;
+    for (size_t i = 0; i < count; i++) {
+        job->helpers[i].item.run = run_for_helper;
+        job->helpers[i].job      = job;
+        if (!enqueue_item(pool, &job->helpers[i].item)) {
+            break;
         }
+        queued++;
     }
+    if (queued > 0) {
+        notify_workers(pool);
+    }
+    return queued;
+}
 
-    ThreadPool* pool = malloc(sizeof(ThreadPool));
+/* ── Public API ──────────────────────────────────────────────────────────── */
+
+ThreadPool* threadpool_create_ex(const ThreadPoolConfig* config) {
+    size_t num_threads = config ? config->num_threads : 0;
+    if (num_threads == 0) {
+        long ncpu   = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = ncpu > 0 ? (size_t)ncpu : 1;
+    }
+
+    ThreadPool* pool = calloc(1, sizeof(ThreadPool));
     if (!pool) {
         LOG_ERROR("Failed to allocate thread pool");
         return NULL;
     }
 
-    pool->num_threads = num_threads;
-    pool->workers     = calloc(num_threads, sizeof(Worker));
-    if (!pool->workers) {
-        free(pool);
-        return NULL;
+    pool->num_threads     = num_threads;
+    pool->num_workers     = num_threads - 1;
+    pool->spin_iterations = (config && config->spin_iterations) ? config->spin_iterations
+                                                                : DEFAULT_SPIN_ITERATIONS;
+    pool->pinned          = config && config->pin_threads;
+
+    if (pool->num_workers > 0) {
+        // Deques hold atomics; keep them off each other's cache lines.
+        size_t bytes  = ((pool->num_workers * sizeof(Worker) + 63) / 64) * 64;
+        pool->workers = aligned_alloc(64, bytes);
+        if (!pool->workers) {
+            free(pool);
+            return NULL;
+        }
     }
 
-    pthread_mutex_init(&pool->mutex, NULL);
-    pthread_cond_init(&pool->cond, NULL);
-    pthread_cond_init(&pool->task_cond, NULL);
-    pool->task_queue_head = NULL;
-    pool->task_queue_tail = NULL;
-    pool->queue_size      = 0;
-    pool->active_tasks    = 0;
-    pool->shutdown        = false;
+    pthread_mutex_init(&pool->inject_lock, NULL);
+    pthread_mutex_init(&pool->park_lock, NULL);
+    pthread_cond_init(&pool->park_cond, NULL);
+    pthread_mutex_init(&pool->wait_lock, NULL);
+    pthread_cond_init(&pool->wait_cond, NULL);
+    atomic_init(&pool->inject_count, 0);
+    atomic_init(&pool->epoch, 0);
+    atomic_init(&pool->sleepers, 0);
+    atomic_init(&pool->shutdown, false);
+    atomic_init(&pool->outstanding, 0);
+
+    for (size_t i = 0; i < pool->num_workers; i++) {
+        Worker* w = &pool->workers[i];
+        w->pool   = pool;
+        w->id     = i;
+        w->rng    = (uint32_t)(0x9E3779B9u * (i + 1));
+        atomic_init(&w->deque.top, 0);
+        atomic_init(&w->deque.bottom, 0);
+        for (size_t j = 0; j < DEQUE_CAPACITY; j++) {
+            atomic_init(&w->deque.buf[j], NULL);
+        }
+    }
 
-    for (size_t i = 0; i < num_threads; i++) {
-        pool->workers[i].pool      = pool;
-        pool->workers[i].id        = i;
-        pool->workers[i].active    = false;
-        pool->workers[i].completed = false;
-        pthread_create(&pool->workers[i].thread, NULL, worker_thread, &pool->workers[i]);
+    // Workers wait on park_lock before their first look at num_workers, so
+    // shrinking the pool after a failed pthread_create is not a race.
+    pthread_mutex_lock(&pool->park_lock);
+    size_t started = 0;
+    for (; started < pool->num_workers; started++) {
+        Worker* w = &pool->workers[started];
+        int rc    = pthread_create(&w->thread, NULL, worker_thread, w);
+        if (rc != 0) {
+            LOG_WARNING("Failed to start thread pool worker %zu of %zu (error %d)", started + 1,
+                        pool->num_workers, rc);
+            break;
+        }
+        if (pool->pinned) {
+            // CPU 0 is left to the calling thread
+            pin_to_cpu(w->thread, started + 1);
+        }
     }
+    pool->num_workers = started;
+    pool->num_threads = started + 1;
+    pthread_mutex_unlock(&pool->park_lock);
 
-    LOG_DEBUG("Created thread pool with %zu threads", num_threads);
+    LOG_DEBUG("Created thread pool with %zu threads (%zu workers%s)", pool->num_threads,
+              pool->num_workers, pool->pinned ? ", pinned" : "");
     return pool;
 }
 
+ThreadPool* threadpool_create(size_t num_threads) {
+    ThreadPoolConfig config = {.num_threads = num_threads};
+    return threadpool_create_ex(&config);
+}
+
 void threadpool_destroy(ThreadPool* pool) {
     if (!pool) {
         return;
     }
 
-    pthread_mutex_lock(&pool->mutex);
-    pool->shutdown = true;
-    pthread_cond_broadcast(&pool->cond);
-    pthread_mutex_unlock(&pool->mutex);
+    threadpool_wait(pool);
 
-    for (size_t i = 0; i < pool->num_threads; i++) {
-        pthread_join(pool->workers[i].thread, NULL);
-    }
+    atomic_store_explicit(&pool->shutdown, true, memory_order_release);
+    pthread_mutex_lock(&pool->park_lock);
+    atomic_fetch_add_explicit(&pool->epoch, 1, memory_order_seq_cst);
+    pthread_cond_broadcast(&pool->park_cond);
+    pthread_mutex_unlock(&pool->park_lock);
 
-    TaskNode* node = pool->task_queue_head;
-    while (node) {
-        TaskNode* next = node->next;
-        free(node);
-        node = next;
+    for (size_t i = 0; i < pool->num_workers; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
     }
 
-    pthread_mutex_destroy(&pool->mutex);
-    pthread_cond_destroy(&pool->cond);
-    pthread_cond_destroy(&pool->task_cond);
+    pthread_mutex_destroy(&pool->inject_lock);
+    pthread_mutex_destroy(&pool->park_lock);
+    pthread_cond_destroy(&pool->park_cond);
+    pthread_mutex_destroy(&pool->wait_lock);
+    pthread_cond_destroy(&pool->wait_cond);
     free(pool->workers);
     free(pool);
 }
@@ -180,30 +536,48 @@ int threadpool_submit(ThreadPool* pool, Task* task) {
         return -1;
     }
 
-    TaskNode* task_node = malloc(sizeof(TaskNode));
-    if (!task_node) {
+    if (pool->num_workers == 0 || task->total_size == 0) {
+        if (task->total_size > 0) {
+            task->func(task->data, 0, task->total_size);
+        }
+        return 0;
+    }
+
+    size_t chunks = task->total_size < pool->num_threads ? task->total_size : pool->num_threads;
+    ForJob* job   = calloc(1, sizeof(ForJob));
+    ForHelper* helpers = job ? calloc(chunks, sizeof(ForHelper)) : NULL;
+    if (!job || !helpers) {
         LOG_ERROR("Failed to allocate task node");
+        free(job);
         return -1;
     }
 
-    task_node->task             = *task;
-    task_node->next             = NULL;
-    task_node->completed_chunks = 0;
-    task_node->total_chunks     = (int)pool->num_threads;
-    task_node->completed        = false;
-
-    pthread_mutex_lock(&pool->mutex);
-
-    if (pool->task_queue_tail) {
-        pool->task_queue_tail->next = task_node;
-    } else {
-        pool->task_queue_head = task_node;
+    size_t grain      = (task->total_size + chunks - 1) / chunks;
+    size_t num_chunks = (task->total_size + grain - 1) / grain;
+    job->func         = task->func;
+    job->data         = task->data;
+    job->n            = task->total_size;
+    job->grain        = grain;
+    job->num_chunks   = num_chunks;
+    job->pool         = pool;
+    job->detached     = true;
+    job->helpers      = helpers;
+    atomic_init(&job->next_chunk, 0);
+    atomic_init(&job->done_chunks, 0);
+    atomic_init(&job->helpers_pending, num_chunks);
+
+    atomic_fetch_add_explicit(&pool->outstanding, 1, memory_order_relaxed);
+    size_t queued = spawn_helpers(pool, job, num_chunks);
+    if (queued < num_chunks) {
+        // Deque full: do the remaining share here, then drop the unqueued
+        // helpers from the count (possibly finishing the job).
+        for_job_work(job);
+        size_t missing = num_chunks - queued;
+        if (atomic_fetch_sub_explicit(&job->helpers_pending, missing, memory_order_acq_rel) ==
+            missing) {
+            for_job_finish_detached(job);
+        }
     }
-    pool->task_queue_tail = task_node;
-    pool->queue_size++;
-
-    pthread_cond_broadcast(&pool->task_cond);
-    pthread_mutex_unlock(&pool->mutex);
 
     return 0;
 }
@@ -213,17 +587,60 @@ void threadpool_wait(ThreadPool* pool) {
         return;
     }
 
-    pthread_mutex_lock(&pool->mutex);
-
-    while (pool->queue_size > 0 || pool->active_tasks > 0) {
-        pthread_cond_wait(&pool->cond, &pool->mutex);
+    unsigned spins = 0;
+    while (atomic_load_explicit(&pool->outstanding, memory_order_acquire) > 0) {
+        if (help_once(pool)) {
+            spins = 0;
+            continue;
+        }
+        if (spins < pool->spin_iterations) {
+            backoff(&spins);
+            continue;
+        }
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += 1000000;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+        pthread_mutex_lock(&pool->wait_lock);
+        if (atomic_load_explicit(&pool->outstanding, memory_order_acquire) > 0) {
+            pthread_cond_timedwait(&pool->wait_cond, &pool->wait_lock, &ts);
+        }
+        pthread_mutex_unlock(&pool->wait_lock);
     }
-
-    pthread_mutex_unlock(&pool->mutex);
 }
 
 size_t threadpool_get_num_threads(ThreadPool* pool) { return pool ? pool->num_threads : 0; }
 
+size_t threadpool_set_thread_budget(size_t max_threads) {
+    size_t prev = tl_budget;
+    tl_budget   = max_threads;
+    return prev;
+}
+
+size_t threadpool_get_thread_budget(ThreadPool* pool) {
+    if (!pool) {
+        return 0;
+    }
+    if (tl_budget > 0 && tl_budget < pool->num_threads) {
+        return tl_budget;
+    }
+    return pool->num_threads;
+}
+
+static ThreadPool* create_global_pool(void) {
+    ThreadPoolConfig config = {0};
+    const char* env_threads = getenv("CML_NUM_THREADS");
+    if (env_threads && atoi(env_threads) > 0) {
+        config.num_threads = (size_t)atoi(env_threads);
+    }
+    const char* env_pin = getenv("CML_THREAD_PIN");
+    config.pin_threads  = env_pin && env_pin[0] == '1';
+    return threadpool_create_ex(&config);
+}
+
 ThreadPool* threadpool_get_global(void) {
     if (!g_pool_lock_initialized) {
         pthread_mutex_init(&g_pool_lock, NULL);
@@ -231,7 +648,7 @@ ThreadPool* threadpool_get_global(void) {
     }
     pool_lock();
     if (!g_global_pool) {
-        g_global_pool = threadpool_create(0);
+        g_global_pool = create_global_pool();
     }
     ThreadPool* result = g_global_pool;
     pool_unlock();
@@ -251,38 +668,80 @@ void threadpool_set_global(ThreadPool* pool) {
     pool_unlock();
 }
 
-void threadpool_parallel_for(ThreadPool* pool, TaskFunc func, void* data, size_t n) {
+void threadpool_parallel_for_grain(ThreadPool* pool, TaskFunc func, void* data, size_t n,
+                                   size_t grain) {
     if (!pool) {
         pool = threadpool_get_global();
     }
+    if (n == 0) {
+        return;
+    }
+    if (!pool || pool->num_workers == 0) {
+        func(data, 0, n);
+        return;
+    }
 
-    if (pool->num_threads == 1 || n < 1000) {
+    if (grain == 0) {
+        grain = default_grain(pool, n);
+    }
+    size_t num_chunks = (n + grain - 1) / grain;
+    if (num_chunks <= 1) {
         func(data, 0, n);
         return;
     }
 
-    for (size_t i = 0; i < pool->num_threads; i++) {
-        Task task               = {.func = func, .data = data, .total_size = n};
-        pool->workers[i].task   = task;
-        pool->workers[i].active = true;
+    size_t budget      = threadpool_get_thread_budget(pool);
+    size_t num_helpers = (num_chunks < budget ? num_chunks : budget) - 1;
+    ForHelper stack_helpers[MAX_STACK_HELPERS];
+    ForHelper* helpers = stack_helpers;
+    if (num_helpers > MAX_STACK_HELPERS) {
+        helpers = malloc(num_helpers * sizeof(ForHelper));
+        if (!helpers) {
+            func(data, 0, n);
+            return;
+        }
     }
 
-    pthread_cond_broadcast(&pool->cond);
+    ForJob job = {
+        .func       = func,
+        .data       = data,
+        .n          = n,
+        .grain      = grain,
+        .num_chunks = num_chunks,
+        .pool       = pool,
+        .detached   = false,
+        .helpers    = helpers,
+    };
+    atomic_init(&job.next_chunk, 0);
+    atomic_init(&job.done_chunks, 0);
+    atomic_init(&job.helpers_pending, num_helpers);
+
+    size_t queued = spawn_helpers(pool, &job, num_helpers);
+    if (queued < num_helpers) {
+        atomic_fetch_sub_explicit(&job.helpers_pending, num_helpers - queued,
+                                  memory_order_relaxed);
+    }
 
-    pthread_mutex_lock(&pool->mutex);
-    bool all_completed = false;
-    while (!all_completed) {
-        all_completed = true;
-        for (size_t i = 0; i < pool->num_threads; i++) {
-            if (pool->workers[i].active && !pool->workers[i].completed) {
-                all_completed = false;
-                break;
-            }
-        }
+    for_job_work(&job);
 
-        if (!all_completed) {
-            pthread_cond_wait(&pool->cond, &pool->mutex);
+    // Wait for in-flight chunks and for every queued helper to retire (they
+    // point into this frame). Run other work meanwhile: this is what lets a
+    // nested parallel_for inside a chunk make progress.
+    unsigned spins = 0;
+    while (atomic_load_explicit(&job.done_chunks, memory_order_acquire) < num_chunks ||
+           atomic_load_explicit(&job.helpers_pending, memory_order_acquire) > 0) {
+        if (help_once(pool)) {
+            spins = 0;
+        } else {
+            backoff(&spins);
         }
     }
-    pthread_mutex_unlock(&pool->mutex);
+
+    if (helpers != stack_helpers) {
+        free(helpers);
+    }
+}
+
+void threadpool_parallel_for(ThreadPool* pool, TaskFunc func, void* data, size_t n) {
+    threadpool_parallel_for_grain(pool, func, data, n, 0);
 }
@@ -104,6 +104,12 @@ void cleanup_clear_all(CleanupContext* ctx) {
     if (!ctx)
         return;
 
+    /* The optimizer may hold views into the model's parameters */
+    if (ctx->optimizer) {
+        optimizer_free(ctx->optimizer);
+        ctx->optimizer = NULL;
+    }
+
     if (ctx->model) {
         module_free(ctx->model);
         ctx->model = NULL;
@@ -114,11 +120,6 @@ void cleanup_clear_all(CleanupContext* ctx) {
         ctx->params = NULL;
     }
 
-    if (ctx->optimizer) {
-        optimizer_free(ctx->optimizer);
-        ctx->optimizer = NULL;
-    }
-
     for (size_t i = 0; i < ctx->num_tensors; i++) {
         if (ctx->tensors[i]) {
             tensor_free(ctx->tensors[i]);
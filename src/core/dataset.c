@@ -16,16 +16,32 @@
 #include <unistd.h>
 #include <time.h>
 
+/* Full-size batches are recycled: batch_free hands them back here instead
+ * of freeing their tensors, so a steady-state epoch allocates nothing. The
+ * pool outlives its loader while batches are still out. */
+typedef struct BatchPool {
+    pthread_mutex_t mutex;
+    Batch** free_batches;
+    int num_free;
+    int free_capacity;
+    int outstanding; /* Pool batches handed out (or being filled) */
+    bool closed;     /* Loader freed; release batches as they come back */
+} BatchPool;
+
+/* Batches are produced out of order by the workers but consumed strictly in
+ * index order: batch i lands in slots[i % capacity], and workers may only
+ * claim indices less than capacity ahead of the consumer. */
 typedef struct PrefetchQueue {
-    Batch** batches;
-    int* batch_indices;
+    Batch** slots;
+    bool* ready;
     int capacity;
-    int size;
-    int front;
-    int rear;
+    int next_to_load;    /* Shared counter workers claim batch indices from */
+    int next_to_consume; /* Index the consumer waits for next */
+    int active_loads;    /* Claimed but not yet delivered */
     pthread_mutex_t mutex;
-    pthread_cond_t not_empty;
-    pthread_cond_t not_full;
+    pthread_cond_t not_empty; /* A slot became ready */
+    pthread_cond_t not_full;  /* The window moved, or a new epoch started */
+    pthread_cond_t idle;      /* active_loads dropped to zero */
     bool shutdown;
 } PrefetchQueue;
 
@@ -36,121 +52,212 @@ typedef struct WorkerContext {
     ThreadPool* thread_pool;
 } WorkerContext;
 
+static void batch_release_tensors(Batch* batch) {
+    if (batch->X)
+        tensor_free(batch->X);
+    if (batch->y)
+        tensor_free(batch->y);
+    free(batch);
+}
+
+static BatchPool* batch_pool_create(void) {
+    BatchPool* pool = calloc(1, sizeof(BatchPool));
+    if (!pool)
+        return NULL;
+    pthread_mutex_init(&pool->mutex, NULL);
+    return pool;
+}
+
+static void batch_pool_destroy(BatchPool* pool) {
+    for (int i = 0; i < pool->num_free; i++)
+        batch_release_tensors(pool->free_batches[i]);
+    free(pool->free_batches);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+}
+
+/* Drops the loader's reference; the last returned batch frees the pool */
+static void batch_pool_close(BatchPool* pool) {
+    if (!pool)
+        return;
+    pthread_mutex_lock(&pool->mutex);
+    pool->closed   = true;
+    bool unused    = pool->outstanding == 0;
+    pthread_mutex_unlock(&pool->mutex);
+    if (unused)
+        batch_pool_destroy(pool);
+}
+
+static void batch_pool_release(BatchPool* pool, Batch* batch) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->outstanding--;
+    bool keep = !pool->closed;
+    if (keep && pool->num_free == pool->free_capacity) {
+        int cap        = pool->free_capacity ? pool->free_capacity * 2 : 8;
+        Batch** grown  = realloc(pool->free_batches, (size_t)cap * sizeof(Batch*));
+        if (grown) {
+            pool->free_batches  = grown;
+            pool->free_capacity = cap;
+        } else {
+            keep = false;
+        }
+    }
+    if (keep)
+        pool->free_batches[pool->num_free++] = batch;
+    bool last = pool->closed && pool->outstanding == 0;
+    pthread_mutex_unlock(&pool->mutex);
+
+    if (!keep)
+        batch_release_tensors(batch);
+    if (last)
+        batch_pool_destroy(pool);
+}
+
+static Batch* batch_alloc(DataLoader* loader, int rows) {
+    Batch* batch = malloc(sizeof(Batch));
+    if (!batch)
+        return NULL;
+    int batch_X_shape[] = {rows, loader->dataset->input_size};
+    int batch_y_shape[] = {rows, loader->dataset->output_size};
+
+    TensorConfig config = {.dtype      = loader->dataset->dtype,
+                           .device     = loader->dataset->device,
+                           .has_dtype  = true,
+                           .has_device = true};
+    batch->X            = tensor_empty(batch_X_shape, 2, &config);
+    batch->y            = tensor_empty(batch_y_shape, 2, &config);
+    batch->pool         = NULL;
+
+    if (!batch->X || !batch->y) {
+        batch_release_tensors(batch);
+        return NULL;
+    }
+    return batch;
+}
+
+/* A full-size batch, recycled when possible */
+static Batch* batch_pool_acquire(DataLoader* loader) {
+    BatchPool* pool = (BatchPool*)loader->batch_pool;
+    Batch* batch    = NULL;
+    if (!pool)
+        return batch_alloc(loader, loader->batch_size);
+
+    pthread_mutex_lock(&pool->mutex);
+    if (pool->num_free > 0)
+        batch = pool->free_batches[--pool->num_free];
+    pool->outstanding++;
+    pthread_mutex_unlock(&pool->mutex);
+
+    if (!batch) {
+        batch = batch_alloc(loader, loader->batch_size);
+        if (!batch) {
+            pthread_mutex_lock(&pool->mutex);
+            pool->outstanding--;
+            pthread_mutex_unlock(&pool->mutex);
+            return NULL;
+        }
+        batch->pool = pool;
+    }
+    return batch;
+}
+
+/* Copies rows src[indices[i]] to dst[i], one memcpy per run of consecutive
+ * indices (the whole batch when unshuffled) */
+static void gather_rows(float* dst, const float* src, const int* indices, int n, int width) {
+    size_t row_bytes = (size_t)width * sizeof(float);
+    for (int i = 0; i < n;) {
+        int run = 1;
+        while (i + run < n && indices[i + run] == indices[i] + run)
+            run++;
+        memcpy(dst + (size_t)i * width, src + (size_t)indices[i] * width, row_bytes * run);
+        i += run;
+    }
+}
+
 static PrefetchQueue* prefetch_queue_create(int capacity) {
-    PrefetchQueue* queue = malloc(sizeof(PrefetchQueue));
+    PrefetchQueue* queue = calloc(1, sizeof(PrefetchQueue));
     if (!queue)
         return NULL;
 
-    queue->batches       = calloc((size_t)capacity, sizeof(Batch*));
-    queue->batch_indices = calloc((size_t)capacity, sizeof(int));
-    if (!queue->batches || !queue->batch_indices) {
-        if (queue->batches)
-            free(queue->batches);
-        if (queue->batch_indices)
-            free(queue->batch_indices);
+    queue->slots = calloc((size_t)capacity, sizeof(Batch*));
+    queue->ready = calloc((size_t)capacity, sizeof(bool));
+    if (!queue->slots || !queue->ready) {
+        free(queue->slots);
+        free(queue->ready);
         free(queue);
         return NULL;
     }
-
     queue->capacity = capacity;
-    queue->size     = 0;
-    queue->front    = 0;
-    queue->rear     = 0;
-    queue->shutdown = false;
 
     pthread_mutex_init(&queue->mutex, NULL);
     pthread_cond_init(&queue->not_empty, NULL);
     pthread_cond_init(&queue->not_full, NULL);
+    pthread_cond_init(&queue->idle, NULL);
 
     return queue;
 }
 
-static void prefetch_queue_free(PrefetchQueue* queue) {
-    if (!queue)
-        return;
-
+/* Wakes every worker and the consumer so they can exit */
+static void prefetch_queue_shutdown(PrefetchQueue* queue) {
     pthread_mutex_lock(&queue->mutex);
     queue->shutdown = true;
     pthread_cond_broadcast(&queue->not_empty);
     pthread_cond_broadcast(&queue->not_full);
     pthread_mutex_unlock(&queue->mutex);
+}
 
-    while (queue->size > 0) {
-        Batch* batch = queue->batches[queue->front];
-        if (batch) {
-            if (batch->X)
-                tensor_free(batch->X);
-            if (batch->y)
-                tensor_free(batch->y);
-            free(batch);
-        }
-        queue->front = (queue->front + 1) % queue->capacity;
-        queue->size--;
+/* Returns undelivered batches; caller holds the lock with no loads active */
+static void prefetch_queue_drain(PrefetchQueue* queue) {
+    for (int i = 0; i < queue->capacity; i++) {
+        if (queue->ready[i] && queue->slots[i])
+            batch_free(queue->slots[i]);
+        queue->slots[i] = NULL;
+        queue->ready[i] = false;
     }
+}
 
+/* Workers must have been joined */
+static void prefetch_queue_free(PrefetchQueue* queue) {
+    if (!queue)
+        return;
+
+    prefetch_queue_drain(queue);
     pthread_mutex_destroy(&queue->mutex);
     pthread_cond_destroy(&queue->not_empty);
     pthread_cond_destroy(&queue->not_full);
+    pthread_cond_destroy(&queue->idle);
 
-    if (queue->batches)
-        free(queue->batches);
-    if (queue->batch_indices)
-        free(queue->batch_indices);
+    free(queue->slots);
+    free(queue->ready);
     free(queue);
 }
 
-static int prefetch_queue_enqueue(PrefetchQueue* queue, Batch* batch, int batch_idx) {
-    if (!queue || !batch)
-        return -1;
-
+/* Blocks until batch next_to_consume is ready. Returns false on shutdown;
+ * *batch may be NULL if loading it failed. */
+static bool prefetch_queue_dequeue(PrefetchQueue* queue, Batch** batch, int* batch_idx) {
     pthread_mutex_lock(&queue->mutex);
 
-    while (queue->size >= queue->capacity && !queue->shutdown) {
-        pthread_cond_wait(&queue->not_full, &queue->mutex);
-    }
-
-    if (queue->shutdown) {
-        pthread_mutex_unlock(&queue->mutex);
-        return -1;
-    }
-
-    queue->batches[queue->rear]       = batch;
-    queue->batch_indices[queue->rear] = batch_idx;
-    queue->rear                       = (queue->rear + 1) % queue->capacity;
-    queue->size++;
-
-    pthread_cond_signal(&queue->not_empty);
-    pthread_mutex_unlock(&queue->mutex);
-
-    return 0;
-}
-
-static Batch* prefetch_queue_dequeue(PrefetchQueue* queue, int* batch_idx) {
-    if (!queue)
-        return NULL;
-
-    pthread_mutex_lock(&queue->mutex);
-
-    while (queue->size == 0 && !queue->shutdown) {
+    int idx  = queue->next_to_consume;
+    int slot = idx % queue->capacity;
+    while (!queue->ready[slot] && !queue->shutdown) {
         pthread_cond_wait(&queue->not_empty, &queue->mutex);
     }
 
-    if (queue->shutdown && queue->size == 0) {
+    if (!queue->ready[slot]) {
         pthread_mutex_unlock(&queue->mutex);
-        return NULL;
+        return false;
     }
 
-    Batch* batch = queue->batches[queue->front];
-    if (batch_idx) {
-        *batch_idx = queue->batch_indices[queue->front];
-    }
-    queue->front = (queue->front + 1) % queue->capacity;
-    queue->size--;
+    *batch               = queue->slots[slot];
+    *batch_idx           = idx;
+    queue->slots[slot]   = NULL;
+    queue->ready[slot]   = false;
+    queue->next_to_consume++;
 
-    pthread_cond_signal(&queue->not_full);
+    pthread_cond_broadcast(&queue->not_full);
     pthread_mutex_unlock(&queue->mutex);
 
-    return batch;
+    return true;
 }
 
 static Batch* load_batch_at_index(DataLoader* loader, int batch_idx) {
@@ -169,27 +276,12 @@ static Batch* load_batch_at_index(DataLoader* loader, int batch_idx) {
 
     int actual_batch_size = end_idx - start_idx;
 
-    Batch* batch = malloc(sizeof(Batch));
+    /* Only the short tail batch gets a one-off allocation */
+    Batch* batch = (actual_batch_size == loader->batch_size)
+                       ? batch_pool_acquire(loader)
+                       : batch_alloc(loader, actual_batch_size);
     if (!batch)
         return NULL;
-    int batch_X_shape[] = {actual_batch_size, loader->dataset->input_size};
-    int batch_y_shape[] = {actual_batch_size, loader->dataset->output_size};
-
-    TensorConfig config = {.dtype      = loader->dataset->dtype,
-                           .device     = loader->dataset->device,
-                           .has_dtype  = true,
-                           .has_device = true};
-    batch->X            = tensor_empty(batch_X_shape, 2, &config);
-    batch->y            = tensor_empty(batch_y_shape, 2, &config);
-
-    if (!batch->X || !batch->y) {
-        if (batch->X)
-            tensor_free(batch->X);
-        if (batch->y)
-            tensor_free(batch->y);
-        free(batch);
-        return NULL;
-    }
 
     float* X_data    = (float*)tensor_data_ptr(batch->X);
     float* y_data    = (float*)tensor_data_ptr(batch->y);
@@ -197,15 +289,9 @@ static Batch* load_batch_at_index(DataLoader* loader, int batch_idx) {
     float* dataset_y = (float*)tensor_data_ptr(loader->dataset->y);
 
     if (X_data && y_data && dataset_X && dataset_y) {
-        for (int i = 0; i < actual_batch_size; i++) {
-            int sample_idx = loader->shuffled_indices[start_idx + i];
-            memcpy(X_data + i * loader->dataset->input_size,
-                   dataset_X + sample_idx * loader->dataset->input_size,
-                   (size_t)loader->dataset->input_size * sizeof(float));
-            memcpy(y_data + i * loader->dataset->output_size,
-                   dataset_y + sample_idx * loader->dataset->output_size,
-                   (size_t)loader->dataset->output_size * sizeof(float));
-        }
+        const int* indices = loader->shuffled_indices + start_idx;
+        gather_rows(X_data, dataset_X, indices, actual_batch_size, loader->dataset->input_size);
+        gather_rows(y_data, dataset_y, indices, actual_batch_size, loader->dataset->output_size);
     }
     batch->batch_size  = actual_batch_size;
     batch->batch_index = batch_idx;
@@ -214,32 +300,38 @@ static Batch* load_batch_at_index(DataLoader* loader, int batch_idx) {
 
     return batch;
 }
+
 static void* worker_prefetch_batches(void* arg) {
     WorkerContext* ctx   = (WorkerContext*)arg;
     DataLoader* loader   = ctx->loader;
     PrefetchQueue* queue = ctx->queue;
 
-    int prefetch_count = loader->prefetch_factor;
-    int next_batch     = 0;
-
-    while (!queue->shutdown) {
-        for (int i = 0; i < prefetch_count; i++) {
-            int batch_idx = next_batch++;
-            if (batch_idx >= loader->total_batches) {
-                break; // No more batches
-            }
-
-            Batch* batch = load_batch_at_index(loader, batch_idx);
-            if (batch) {
-                prefetch_queue_enqueue(queue, batch, batch_idx);
-            }
+    pthread_mutex_lock(&queue->mutex);
+    for (;;) {
+        /* Backpressure: stay within capacity of the consumer */
+        while (!queue->shutdown &&
+               (queue->next_to_load >= loader->total_batches ||
+                queue->next_to_load >= queue->next_to_consume + queue->capacity)) {
+            pthread_cond_wait(&queue->not_full, &queue->mutex);
         }
-        if (next_batch >= loader->total_batches) {
+        if (queue->shutdown)
             break;
-        }
-        struct timespec ts = {0, 1000000}; // 1ms
-        nanosleep(&ts, NULL);
+
+        int batch_idx = queue->next_to_load++;
+        queue->active_loads++;
+        pthread_mutex_unlock(&queue->mutex);
+
+        Batch* batch = load_batch_at_index(loader, batch_idx);
+
+        pthread_mutex_lock(&queue->mutex);
+        int slot           = batch_idx % queue->capacity;
+        queue->slots[slot] = batch;
+        queue->ready[slot] = true;
+        if (--queue->active_loads == 0)
+            pthread_cond_broadcast(&queue->idle);
+        pthread_cond_broadcast(&queue->not_empty);
     }
+    pthread_mutex_unlock(&queue->mutex);
 
     return NULL;
 }
@@ -1105,15 +1197,21 @@ DataLoader* dataloader_create(Dataset* dataset, int batch_size, bool shuffle) {
     loader->current_epoch = 0;
     loader->user_data     = NULL;
 
+    loader->prefetch_queue     = NULL;
+    loader->worker_threads     = NULL;
+    loader->worker_contexts    = NULL;
+    loader->num_active_workers = 0;
+    loader->batch_pool         = batch_pool_create();
+
     return loader;
 }
 
 void dataloader_free(DataLoader* loader) {
     if (!loader)
         return;
-    if (loader->num_workers > 0 && loader->prefetch_queue) {
+    if (loader->prefetch_queue) {
         PrefetchQueue* queue = (PrefetchQueue*)loader->prefetch_queue;
-        prefetch_queue_free(queue);
+        prefetch_queue_shutdown(queue);
         if (loader->worker_threads) {
             pthread_t* threads = (pthread_t*)loader->worker_threads;
             for (int i = 0; i < loader->num_active_workers; i++) {
@@ -1125,7 +1223,9 @@ void dataloader_free(DataLoader* loader) {
         if (loader->worker_contexts) {
             free(loader->worker_contexts);
         }
+        prefetch_queue_free(queue);
     }
+    batch_pool_close((BatchPool*)loader->batch_pool);
 
     if (loader->shuffled_indices) {
         free(loader->shuffled_indices);
@@ -1137,12 +1237,7 @@ void dataloader_free(DataLoader* loader) {
     free(loader);
 }
 
-int dataloader_reset(DataLoader* loader) {
-    if (!loader)
-        return -1;
-
-    loader->current_batch = 0;
-    loader->current_epoch++;
+static void dataloader_reshuffle(DataLoader* loader) {
     if (loader->shuffle && loader->dataset) {
         dataset_shuffle(loader->dataset, (unsigned int)time(NULL));
         if (loader->dataset->indices) {
@@ -1150,6 +1245,34 @@ int dataloader_reset(DataLoader* loader) {
                    (size_t)loader->dataset->num_samples * sizeof(int));
         }
     }
+}
+
+int dataloader_reset(DataLoader* loader) {
+    if (!loader)
+        return -1;
+
+    PrefetchQueue* queue = (PrefetchQueue*)loader->prefetch_queue;
+    if (!queue) {
+        loader->current_batch = 0;
+        loader->current_epoch++;
+        dataloader_reshuffle(loader);
+        return 0;
+    }
+
+    /* Workers read shuffled_indices while loading, so let in-flight loads
+     * land before reshuffling, then restart the window at batch 0 */
+    pthread_mutex_lock(&queue->mutex);
+    while (queue->active_loads > 0) {
+        pthread_cond_wait(&queue->idle, &queue->mutex);
+    }
+    prefetch_queue_drain(queue);
+    queue->next_to_load    = 0;
+    queue->next_to_consume = 0;
+    loader->current_batch  = 0;
+    loader->current_epoch++;
+    dataloader_reshuffle(loader);
+    pthread_cond_broadcast(&queue->not_full);
+    pthread_mutex_unlock(&queue->mutex);
 
     return 0;
 }
@@ -1161,35 +1284,32 @@ Batch* dataloader_next_batch(DataLoader* loader) {
     if (loader->current_batch >= loader->total_batches) {
         return NULL; // No more batches
     }
-    if (loader->num_workers > 0 && loader->prefetch_queue) {
+
+    Batch* batch = NULL;
+    if (loader->prefetch_queue) {
         PrefetchQueue* queue = (PrefetchQueue*)loader->prefetch_queue;
         int batch_idx;
-        Batch* batch = prefetch_queue_dequeue(queue, &batch_idx);
-
-        if (batch) {
-            loader->current_batch = batch_idx + 1;
-            return batch;
-        }
+        if (!prefetch_queue_dequeue(queue, &batch, &batch_idx))
+            return NULL;
+        loader->current_batch = batch_idx;
     }
-    int start_idx = loader->current_batch * loader->batch_size;
-    int end_idx   = start_idx + loader->batch_size;
-    if (end_idx > loader->dataset->num_samples) {
-        if (loader->drop_last) {
-            return NULL; // Drop incomplete batch
-        }
-        end_idx = loader->dataset->num_samples;
+
+    /* A worker that failed to load leaves a NULL slot; retry inline */
+    if (!batch)
+        batch = load_batch_at_index(loader, loader->current_batch);
+    if (!batch) {
+        /* Dropped tail batch (or allocation failure) ends the epoch */
+        loader->current_batch = loader->total_batches;
+        return NULL;
     }
 
-    Batch* batch = load_batch_at_index(loader, loader->current_batch);
-    if (batch) {
-        if (loader->on_batch_start) {
-            loader->on_batch_start(batch);
-        }
+    if (loader->on_batch_start) {
+        loader->on_batch_start(batch);
+    }
 
-        loader->current_batch++;
-        if (loader->on_batch_end) {
-            loader->on_batch_end(batch);
-        }
+    loader->current_batch++;
+    if (loader->on_batch_end) {
+        loader->on_batch_end(batch);
     }
 
     return batch;
@@ -1217,12 +1337,11 @@ void batch_free(Batch* batch) {
     if (!batch)
         return;
 
-    if (batch->X)
-        tensor_free(batch->X);
-    if (batch->y)
-        tensor_free(batch->y);
-
-    free(batch);
+    if (batch->pool) {
+        batch_pool_release((BatchPool*)batch->pool, batch);
+        return;
+    }
+    batch_release_tensors(batch);
 }
 
 Tensor* batch_get_input(Batch* batch) {
@@ -1281,11 +1400,6 @@ DataLoader* dataloader_create_with_workers(Dataset* dataset, int batch_size, boo
         return NULL;
     }
 
-    loader->prefetch_queue     = NULL;
-    loader->worker_threads     = NULL;
-    loader->worker_contexts    = NULL;
-    loader->num_active_workers = 0;
-
     if (num_workers > 0) {
         loader->num_workers = num_workers;
         int queue_capacity   = loader->prefetch_factor * num_workers;
@@ -1320,12 +1434,24 @@ DataLoader* dataloader_create_with_workers(Dataset* dataset, int batch_size, boo
             contexts[i].worker_id   = i;
             contexts[i].thread_pool = NULL;
 
-            if (pthread_create(&threads[i], NULL, worker_prefetch_batches, &contexts[i]) != 0) {
+            if (pthread_create(&threads[loader->num_active_workers], NULL,
+                               worker_prefetch_batches, &contexts[i]) != 0) {
                 LOG_WARNING("Failed to create worker thread %d", i);
             } else {
                 loader->num_active_workers++;
             }
         }
+
+        if (loader->num_active_workers == 0) {
+            LOG_WARNING("No worker threads started, falling back to single-threaded");
+            free(threads);
+            free(contexts);
+            prefetch_queue_free(queue);
+            loader->worker_threads  = NULL;
+            loader->worker_contexts = NULL;
+            loader->prefetch_queue  = NULL;
+            loader->num_workers     = 0;
+        }
     } else {
         loader->num_workers = 0;
         /* single-threaded fallback */
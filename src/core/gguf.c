@@ -2,12 +2,14 @@
 #include "core/gguf_quant.h"
 #include "core/serialization.h"
 #include "core/logging.h"
+#include "core/weight_file.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #define GGUF_VERSION 3
 #define MAX_TENSORS 4096
+#define GGUF_DEFAULT_ALIGNMENT 32
 
 typedef struct GGUFTensorInfo {
     char* name;
@@ -26,6 +28,9 @@ struct GGUFContext {
     int num_metadata;
     GGUFTensorInfo* tensors;
     uint64_t data_offset;  // Start of tensor data section
+    uint32_t alignment;    // general.alignment (default 32)
+    CMLNameIndex index;    // Tensor name -> position in tensors
+    CMLMappedFile* map;    // Set in mmap mode; tensors alias into it
     // Write buffer
     int write_count;
     uint8_t* write_data;
@@ -103,6 +108,10 @@ static void skip_gguf_value(FILE* f, uint32_t type) {
 }
 
 GGUFContext* gguf_open_read(const char* filepath) {
+    return gguf_open_read_ex(filepath, NULL);
+}
+
+GGUFContext* gguf_open_read_ex(const char* filepath, const CMLWeightLoadOptions* opts) {
     FILE* f = fopen(filepath, "rb");
     if (!f) {
         LOG_ERROR("gguf_open_read: cannot open %s", filepath);
@@ -130,13 +139,20 @@ GGUFContext* gguf_open_read(const char* filepath) {
     ctx->is_write = false;
     ctx->num_tensors = (int)num_tensors;
     ctx->num_metadata = (int)num_metadata;
+    ctx->alignment = GGUF_DEFAULT_ALIGNMENT;
 
     for (uint64_t i = 0; i < num_metadata; i++) {
         char* key = read_gguf_string(f);
-        free(key);
         uint32_t val_type;
-        if (fread(&val_type, 4, 1, f) != 1) break;
-        skip_gguf_value(f, val_type);
+        if (fread(&val_type, 4, 1, f) != 1) { free(key); break; }
+        if (key && val_type == GGUF_TYPE_UINT32 && strcmp(key, "general.alignment") == 0) {
+            uint32_t align;
+            if (fread(&align, 4, 1, f) == 1 && align > 0 && (align & (align - 1)) == 0)
+                ctx->alignment = align;
+        } else {
+            skip_gguf_value(f, val_type);
+        }
+        free(key);
     }
 
     ctx->tensors = calloc(num_tensors, sizeof(GGUFTensorInfo));
@@ -170,11 +186,29 @@ GGUFContext* gguf_open_read(const char* filepath) {
         }
     }
 
-    // Align to 32 bytes for tensor data
+    // Tensor data starts at the next general.alignment boundary
     long pos = ftell(f);
-    long aligned = (pos + 31) & ~31L;
+    long mask = (long)ctx->alignment - 1;
+    long aligned = (pos + mask) & ~mask;
     ctx->data_offset = (uint64_t)aligned;
 
+    if (cml_name_index_init(&ctx->index, num_tensors) != 0) { gguf_close(ctx); return NULL; }
+    for (uint64_t i = 0; i < num_tensors; i++)
+        cml_name_index_insert(&ctx->index, ctx->tensors[i].name, (int)i);
+
+    if (opts && opts->use_mmap) {
+        ctx->map = cml_mapped_file_open(filepath);
+        if (ctx->map) {
+            size_t data_len = ctx->map->size > ctx->data_offset
+                                  ? ctx->map->size - (size_t)ctx->data_offset : 0;
+            if (opts->advice != CML_MAP_ADVICE_NORMAL)
+                cml_mapped_file_advise(ctx->map, (size_t)ctx->data_offset, data_len, opts->advice);
+            if (opts->prefetch)
+                cml_mapped_file_advise(ctx->map, (size_t)ctx->data_offset, data_len,
+                                       CML_MAP_ADVICE_WILLNEED);
+        }
+    }
+
     return ctx;
 }
 
@@ -229,6 +263,8 @@ void gguf_close(GGUFContext* ctx) {
     }
 
     if (ctx->file) fclose(ctx->file);
+    cml_mapped_file_close(ctx->map);
+    cml_name_index_free(&ctx->index);
     if (ctx->tensors) {
         for (int i = 0; i < ctx->num_tensors || i < ctx->write_count; i++) {
             free(ctx->tensors[i].name);
@@ -249,15 +285,17 @@ const char* gguf_get_tensor_name(GGUFContext* ctx, int index) {
     return ctx->tensors[index].name;
 }
 
+/* Pointer to a tensor's bytes inside the mapping, or NULL if it runs past EOF */
+static const uint8_t* gguf_mapped_data(GGUFContext* ctx, const GGUFTensorInfo* info) {
+    uint64_t start = ctx->data_offset + info->offset;
+    if (start > ctx->map->size || info->data_size > ctx->map->size - start) return NULL;
+    return ctx->map->base + start;
+}
+
 Tensor* gguf_read_tensor(GGUFContext* ctx, const char* name) {
     if (!ctx || !name || ctx->is_write) return NULL;
 
-    int idx = -1;
-    for (int i = 0; i < ctx->num_tensors; i++) {
-        if (ctx->tensors[i].name && strcmp(ctx->tensors[i].name, name) == 0) {
-            idx = i; break;
-        }
-    }
+    int idx = cml_name_index_find(&ctx->index, name);
     if (idx < 0) return NULL;
 
     GGUFTensorInfo* info = &ctx->tensors[idx];
@@ -268,15 +306,24 @@ Tensor* gguf_read_tensor(GGUFContext* ctx, const char* name) {
     size_t numel = 1;
     for (int d = 0; d < info->ndim; d++) numel *= (size_t)info->shape[d];
 
+    const uint8_t* mapped = ctx->map ? gguf_mapped_data(ctx, info) : NULL;
+    if (ctx->map && !mapped) {
+        LOG_ERROR("gguf_read_tensor: '%s' extends past end of file", name);
+        return NULL;
+    }
+
     if (gguf_type_is_quantized(info->type)) {
         /* Quantized: read raw block data, dequantize to float32 */
-        void* raw = malloc(info->data_size);
-        if (!raw) return NULL;
-
-        fseek(ctx->file, (long)(ctx->data_offset + info->offset), SEEK_SET);
-        if (fread(raw, 1, info->data_size, ctx->file) != info->data_size) {
-            free(raw);
-            return NULL;
+        void* raw = NULL;
+        if (!mapped) {
+            raw = malloc(info->data_size);
+            if (!raw) return NULL;
+
+            fseek(ctx->file, (long)(ctx->data_offset + info->offset), SEEK_SET);
+            if (fread(raw, 1, info->data_size, ctx->file) != info->data_size) {
+                free(raw);
+                return NULL;
+            }
         }
 
         TensorConfig config = {.dtype = DTYPE_FLOAT32, .device = DEVICE_CPU,
@@ -285,7 +332,8 @@ Tensor* gguf_read_tensor(GGUFContext* ctx, const char* name) {
         if (!t) { free(raw); return NULL; }
         tensor_ensure_executed(t);
 
-        if (gguf_dequantize(info->type, raw, (float*)t->data, numel) != 0) {
+        if (gguf_dequantize(info->type, mapped ? (const void*)mapped : raw, (float*)t->data,
+                            numel) != 0) {
             free(raw);
             tensor_free(t);
             return NULL;
@@ -294,13 +342,24 @@ Tensor* gguf_read_tensor(GGUFContext* ctx, const char* name) {
         return t;
     }
 
-    /* Non-quantized: read directly */
     DType dtype = gguf_type_to_dtype(info->type);
     TensorConfig config = {.dtype = dtype, .device = DEVICE_CPU, .has_dtype = true, .has_device = true};
+
+    /* Zero-copy: alias the mapping. Valid until gguf_close(). */
+    if (mapped && info->ndim > 0 && ((uintptr_t)mapped % cml_dtype_size(dtype)) == 0) {
+        Tensor* t = tensor_from_blob((void*)mapped, shape, info->ndim, &config);
+        if (t) return t;
+    }
+
     Tensor* t = tensor_empty(shape, info->ndim, &config);
     if (!t) return NULL;
     tensor_ensure_executed(t);
 
+    if (mapped) {
+        memcpy(t->data, mapped, info->data_size);
+        return t;
+    }
+
     fseek(ctx->file, (long)(ctx->data_offset + info->offset), SEEK_SET);
     if (fread(t->data, 1, info->data_size, ctx->file) != info->data_size) {
         tensor_free(t);
@@ -309,6 +368,43 @@ Tensor* gguf_read_tensor(GGUFContext* ctx, const char* name) {
     return t;
 }
 
+CMLQuantWeight* gguf_read_quant_weight(GGUFContext* ctx, const char* name) {
+    if (!ctx || !name || ctx->is_write) return NULL;
+
+    int idx = cml_name_index_find(&ctx->index, name);
+    if (idx < 0) return NULL;
+
+    GGUFTensorInfo* info = &ctx->tensors[idx];
+    if (info->ndim != 2 || !cml_quant_matmul_supported(info->type)) return NULL;
+
+    int cols = (int)info->shape[0];
+    int rows = (int)info->shape[1];
+    int block_size = gguf_quant_block_size(info->type);
+    if (cols % block_size != 0 ||
+        (size_t)rows * (size_t)(cols / block_size) * gguf_quant_type_size(info->type) !=
+            info->data_size)
+        return NULL;
+
+    if (ctx->map) {
+        const uint8_t* mapped = gguf_mapped_data(ctx, info);
+        if (!mapped) {
+            LOG_ERROR("gguf_read_quant_weight: '%s' extends past end of file", name);
+            return NULL;
+        }
+        return cml_quant_weight_create(info->type, rows, cols, mapped);
+    }
+
+    CMLQuantWeight* w = cml_quant_weight_create(info->type, rows, cols, NULL);
+    if (!w) return NULL;
+
+    fseek(ctx->file, (long)(ctx->data_offset + info->offset), SEEK_SET);
+    if (fread(w->owned, 1, info->data_size, ctx->file) != info->data_size) {
+        cml_quant_weight_free(w);
+        return NULL;
+    }
+    return w;
+}
+
 int gguf_write_tensor(GGUFContext* ctx, const char* name, Tensor* tensor) {
     if (!ctx || !name || !tensor || !ctx->is_write) return -1;
     if (ctx->write_count >= MAX_TENSORS) return -1;
@@ -362,7 +458,9 @@ int module_save_gguf(Module* module, const char* filepath) {
 int module_load_gguf(Module* module, const char* filepath) {
     if (!module || !filepath) return -1;
 
-    GGUFContext* ctx = gguf_open_read(filepath);
+    /* Copy straight out of the mapping: no staging buffer per tensor */
+    CMLWeightLoadOptions opts = {.use_mmap = true, .advice = CML_MAP_ADVICE_SEQUENTIAL};
+    GGUFContext* ctx = gguf_open_read_ex(filepath, &opts);
     if (!ctx) return -1;
 
     NamedParameter* named_params = NULL;
@@ -379,6 +477,7 @@ int module_load_gguf(Module* module, const char* filepath) {
             tensor_ensure_executed(target);
             if (target->data && loaded->data && target->numel == loaded->numel) {
                 memcpy(target->data, loaded->data, target->numel * cml_dtype_size(target->dtype));
+                tensor_bump_version(target);
             }
             tensor_free(loaded);
         }
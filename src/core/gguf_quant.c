@@ -310,6 +310,8 @@ static void dequantize_q6_k(const void *src, float *dst, size_t num_blocks) {
     }
 }
 
+float gguf_fp16_to_fp32(uint16_t h) { return fp16_to_fp32(h); }
+
 bool gguf_type_is_quantized(GGUFTensorType type) {
     switch ((int)type) {
         case GGUF_TENSOR_TYPE_Q4_0:
@@ -0,0 +1,317 @@
+#include "core/gguf_quant.h"
+#include "backend/threadpool.h"
+#include "core/logging.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define CML_QUANT_AVX2 1
+#endif
+
+/* Activations are quantized per 32 values, which lines up with Q4_0/Q8_0
+ * blocks and with the 32-element sub-blocks of Q4_K. */
+#define QK_ACT 32
+
+typedef struct {
+    float d;            /* scale */
+    int sum;            /* sum of qs, for the Q4_K min term */
+    int8_t qs[QK_ACT];
+} BlockQ8Act;
+
+static inline float half_to_float(uint16_t h) {
+#if defined(CML_QUANT_AVX2) && defined(__F16C__)
+    return _cvtsh_ss(h);
+#else
+    return gguf_fp16_to_fp32(h);
+#endif
+}
+
+bool cml_quant_matmul_supported(GGUFTensorType type) {
+    return type == GGUF_TENSOR_Q4_0 || type == GGUF_TENSOR_Q4_K || type == GGUF_TENSOR_Q8_0;
+}
+
+CMLQuantWeight* cml_quant_weight_create(GGUFTensorType type, int rows, int cols,
+                                        const void* blocks) {
+    if (!cml_quant_matmul_supported(type) || rows <= 0 || cols <= 0) return NULL;
+
+    int block_size = gguf_quant_block_size(type);
+    if (cols % block_size != 0) {
+        LOG_ERROR("cml_quant_weight_create: %d columns is not a multiple of %d", cols,
+                  block_size);
+        return NULL;
+    }
+
+    CMLQuantWeight* w = calloc(1, sizeof(CMLQuantWeight));
+    if (!w) return NULL;
+
+    w->type      = type;
+    w->rows      = rows;
+    w->cols      = cols;
+    w->row_bytes = (size_t)(cols / block_size) * gguf_quant_type_size(type);
+
+    if (blocks) {
+        w->blocks = blocks;
+    } else {
+        w->owned = malloc(w->row_bytes * (size_t)rows);
+        if (!w->owned) {
+            free(w);
+            return NULL;
+        }
+        w->blocks = w->owned;
+    }
+    return w;
+}
+
+void cml_quant_weight_free(CMLQuantWeight* w) {
+    if (!w) return;
+    free(w->owned);
+    free(w);
+}
+
+static void quantize_row_act(const float* x, BlockQ8Act* out, int n) {
+    for (int b = 0; b < n / QK_ACT; b++) {
+        const float* xb = x + b * QK_ACT;
+        float amax = 0.0f;
+        for (int j = 0; j < QK_ACT; j++) {
+            float v = fabsf(xb[j]);
+            if (v > amax) amax = v;
+        }
+
+        const float d  = amax / 127.0f;
+        const float id = d > 0.0f ? 1.0f / d : 0.0f;
+        int sum = 0;
+        for (int j = 0; j < QK_ACT; j++) {
+            int q = (int)nearbyintf(xb[j] * id);
+            out[b].qs[j] = (int8_t)q;
+            sum += q;
+        }
+        out[b].d   = d;
+        out[b].sum = sum;
+    }
+}
+
+/* Q4_K sub-block scales and mins, 6 bits each (see dequantize_q4_k) */
+static inline void q4_k_scales(const uint8_t* raw, uint8_t* sc, uint8_t* mn) {
+    for (int i = 0; i < 4; i++) {
+        sc[i] = raw[i] & 0x3Fu;
+        mn[i] = raw[i + 4] & 0x3Fu;
+    }
+    for (int i = 4; i < 8; i++) {
+        const int j = i - 4;
+        sc[i] = (uint8_t)((raw[j + 8] & 0x0Fu) | ((raw[j] >> 6) << 4));
+        mn[i] = (uint8_t)((raw[j + 8] >> 4) | ((raw[j + 4] >> 6) << 4));
+    }
+}
+
+#ifdef CML_QUANT_AVX2
+
+static inline float hsum_ps(__m256 v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+}
+
+/* 16 packed bytes -> 32 nibbles: low nibbles first, then high, as stored */
+static inline __m256i unpack_nibbles(const uint8_t* qs) {
+    const __m128i raw = _mm_loadu_si128((const __m128i*)qs);
+    const __m256i both = _mm256_set_m128i(_mm_srli_epi16(raw, 4), raw);
+    return _mm256_and_si256(both, _mm256_set1_epi8(0x0F));
+}
+
+/* Eight int32 partial sums of u8 x s8 products */
+static inline __m256i dot_u8_s8(__m256i u, __m256i s) {
+    return _mm256_madd_epi16(_mm256_maddubs_epi16(u, s), _mm256_set1_epi16(1));
+}
+
+/* maddubs wants one unsigned operand: move x's sign onto y */
+static inline __m256i dot_s8_s8(__m256i x, __m256i y) {
+    return dot_u8_s8(_mm256_sign_epi8(x, x), _mm256_sign_epi8(y, x));
+}
+
+static float vec_dot_q4_0(const void* row, const BlockQ8Act* a, int cols) {
+    const BlockQ4_0* w = row;
+    __m256 acc = _mm256_setzero_ps();
+    for (int b = 0; b < cols / QK4_0; b++) {
+        const __m256i wq = _mm256_sub_epi8(unpack_nibbles(w[b].qs), _mm256_set1_epi8(8));
+        const __m256i aq = _mm256_loadu_si256((const __m256i*)a[b].qs);
+        const __m256 d   = _mm256_set1_ps(half_to_float(w[b].d) * a[b].d);
+        acc = _mm256_fmadd_ps(d, _mm256_cvtepi32_ps(dot_s8_s8(wq, aq)), acc);
+    }
+    return hsum_ps(acc);
+}
+
+static float vec_dot_q8_0(const void* row, const BlockQ8Act* a, int cols) {
+    const BlockQ8_0* w = row;
+    __m256 acc = _mm256_setzero_ps();
+    for (int b = 0; b < cols / QK8_0; b++) {
+        const __m256i wq = _mm256_loadu_si256((const __m256i*)w[b].qs);
+        const __m256i aq = _mm256_loadu_si256((const __m256i*)a[b].qs);
+        const __m256 d   = _mm256_set1_ps(half_to_float(w[b].d) * a[b].d);
+        acc = _mm256_fmadd_ps(d, _mm256_cvtepi32_ps(dot_s8_s8(wq, aq)), acc);
+    }
+    return hsum_ps(acc);
+}
+
+static float vec_dot_q4_k(const void* row, const BlockQ8Act* a, int cols) {
+    const BlockQ4_K* w = row;
+    __m256 acc     = _mm256_setzero_ps();
+    float min_term = 0.0f;
+    for (int b = 0; b < cols / QK_K; b++) {
+        const float d    = half_to_float(w[b].d);
+        const float dmin = half_to_float(w[b].dmin);
+        uint8_t sc[8], mn[8];
+        q4_k_scales(w[b].scales, sc, mn);
+
+        const BlockQ8Act* ab = a + b * 8;
+        for (int i = 0; i < 8; i++) {
+            const __m256i wq = unpack_nibbles(w[b].qs + i * 16);
+            const __m256i aq = _mm256_loadu_si256((const __m256i*)ab[i].qs);
+            const __m256 s   = _mm256_set1_ps(d * (float)sc[i] * ab[i].d);
+            acc = _mm256_fmadd_ps(s, _mm256_cvtepi32_ps(dot_u8_s8(wq, aq)), acc);
+            min_term += dmin * (float)mn[i] * ab[i].d * (float)ab[i].sum;
+        }
+    }
+    return hsum_ps(acc) - min_term;
+}
+
+#else
+
+static float vec_dot_q4_0(const void* row, const BlockQ8Act* a, int cols) {
+    const BlockQ4_0* w = row;
+    float sum = 0.0f;
+    for (int b = 0; b < cols / QK4_0; b++) {
+        int isum = 0;
+        for (int j = 0; j < QK4_0 / 2; j++) {
+            isum += ((w[b].qs[j] & 0x0F) - 8) * a[b].qs[j];
+            isum += ((w[b].qs[j] >> 4) - 8) * a[b].qs[j + QK4_0 / 2];
+        }
+        sum += half_to_float(w[b].d) * a[b].d * (float)isum;
+    }
+    return sum;
+}
+
+static float vec_dot_q8_0(const void* row, const BlockQ8Act* a, int cols) {
+    const BlockQ8_0* w = row;
+    float sum = 0.0f;
+    for (int b = 0; b < cols / QK8_0; b++) {
+        int isum = 0;
+        for (int j = 0; j < QK8_0; j++)
+            isum += w[b].qs[j] * a[b].qs[j];
+        sum += half_to_float(w[b].d) * a[b].d * (float)isum;
+    }
+    return sum;
+}
+
+static float vec_dot_q4_k(const void* row, const BlockQ8Act* a, int cols) {
+    const BlockQ4_K* w = row;
+    float sum = 0.0f;
+    for (int b = 0; b < cols / QK_K; b++) {
+        const float d    = half_to_float(w[b].d);
+        const float dmin = half_to_float(w[b].dmin);
+        uint8_t sc[8], mn[8];
+        q4_k_scales(w[b].scales, sc, mn);
+
+        const BlockQ8Act* ab = a + b * 8;
+        for (int i = 0; i < 8; i++) {
+            const uint8_t* q = w[b].qs + i * 16;
+            int isum = 0;
+            for (int k = 0; k < 16; k++) {
+                isum += (q[k] & 0x0F) * ab[i].qs[k];
+                isum += (q[k] >> 4) * ab[i].qs[k + 16];
+            }
+            sum += d * (float)sc[i] * ab[i].d * (float)isum;
+            sum -= dmin * (float)mn[i] * ab[i].d * (float)ab[i].sum;
+        }
+    }
+    return sum;
+}
+
+#endif /* CML_QUANT_AVX2 */
+
+typedef float (*QuantDotFn)(const void* row, const BlockQ8Act* a, int cols);
+
+typedef struct {
+    const CMLQuantWeight* w;
+    QuantDotFn dot;
+    const BlockQ8Act* act;
+    float* y;
+    int m;
+} QuantMatmulTask;
+
+/* Rows outer, tokens inner: each weight row is pulled from memory once per
+ * call and stays in L1 for the rest of the batch. */
+static void quant_matmul_rows(void* data, size_t start, size_t end) {
+    const QuantMatmulTask* t = data;
+    const int rows           = t->w->rows;
+    const int act_per_row    = t->w->cols / QK_ACT;
+    for (size_t r = start; r < end; r++) {
+        const uint8_t* row = t->w->blocks + r * t->w->row_bytes;
+        for (int i = 0; i < t->m; i++)
+            t->y[(size_t)i * rows + r] = t->dot(row, t->act + (size_t)i * act_per_row, t->w->cols);
+    }
+}
+
+int cml_quant_matmul(const CMLQuantWeight* w, const float* x, float* y, int m) {
+    if (!w || !x || !y || m <= 0) return -1;
+
+    QuantDotFn dot;
+    switch (w->type) {
+        case GGUF_TENSOR_Q4_0: dot = vec_dot_q4_0; break;
+        case GGUF_TENSOR_Q4_K: dot = vec_dot_q4_k; break;
+        case GGUF_TENSOR_Q8_0: dot = vec_dot_q8_0; break;
+        default: return -1;
+    }
+
+    const int act_per_row = w->cols / QK_ACT;
+    BlockQ8Act* act = malloc((size_t)m * (size_t)act_per_row * sizeof(BlockQ8Act));
+    if (!act) return -1;
+    for (int i = 0; i < m; i++)
+        quantize_row_act(x + (size_t)i * w->cols, act + (size_t)i * act_per_row, w->cols);
+
+    /* ~64K MACs per chunk keeps scheduling overhead small on short rows */
+    size_t work  = (size_t)w->cols * (size_t)m;
+    size_t grain = work >= 65536 ? 1 : 65536 / work;
+
+    QuantMatmulTask task = {.w = w, .dot = dot, .act = act, .y = y, .m = m};
+    threadpool_parallel_for_grain(NULL, quant_matmul_rows, &task, (size_t)w->rows, grain);
+
+    free(act);
+    return 0;
+}
+
+Tensor* cml_quant_linear(Tensor* x, const CMLQuantWeight* w) {
+    if (!x || !w) return NULL;
+    if (x->dtype != DTYPE_FLOAT32) {
+        LOG_ERROR("cml_quant_linear: expected float32 activations");
+        return NULL;
+    }
+    if (x->ndim < 1 || x->shape[x->ndim - 1] != w->cols) {
+        LOG_ERROR("cml_quant_linear: input width %d does not match weight columns %d",
+                  x->ndim > 0 ? x->shape[x->ndim - 1] : 0, w->cols);
+        return NULL;
+    }
+
+    Tensor* xc = tensor_is_contiguous(x) ? x : tensor_contiguous(x);
+    if (!xc) return NULL;
+    const float* xd = (const float*)tensor_data_ptr(xc);
+
+    int shape[8];
+    for (int d = 0; d < x->ndim; d++) shape[d] = x->shape[d];
+    shape[x->ndim - 1] = w->rows;
+
+    TensorConfig config = {.dtype = DTYPE_FLOAT32, .device = DEVICE_CPU,
+                           .has_dtype = true, .has_device = true};
+    Tensor* out = tensor_empty(shape, x->ndim, &config);
+    if (out) tensor_ensure_executed(out);
+
+    int m = (int)(x->numel / (size_t)w->cols);
+    if (!xd || !out || !out->data || cml_quant_matmul(w, xd, (float*)out->data, m) != 0) {
+        if (out) tensor_free(out);
+        out = NULL;
+    }
+    if (xc != x) tensor_free(xc);
+    return out;
+}
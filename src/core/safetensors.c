@@ -4,6 +4,7 @@
 #include "core/safetensors.h"
 #include "core/serialization.h"
 #include "core/logging.h"
+#include "core/weight_file.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -26,6 +27,8 @@ struct SafeTensorsContext {
     int num_tensors;
     SafeTensorInfo* tensors;
     uint64_t header_size;
+    CMLNameIndex index;  // Tensor name -> position in tensors
+    CMLMappedFile* map;  // Set in mmap mode; tensors alias into it
     // Write buffer
     int write_count;
     uint8_t* write_data;
@@ -112,6 +115,11 @@ static char* parse_int(char* p, int64_t* out) {
 }
 
 SafeTensorsContext* safetensors_open_read(const char* filepath) {
+    return safetensors_open_read_ex(filepath, NULL);
+}
+
+SafeTensorsContext* safetensors_open_read_ex(const char* filepath,
+                                             const CMLWeightLoadOptions* opts) {
     FILE* f = fopen(filepath, "rb");
     if (!f) {
         LOG_ERROR("safetensors_open_read: cannot open %s", filepath);
@@ -224,6 +232,26 @@ SafeTensorsContext* safetensors_open_read(const char* filepath) {
     }
 
     free(header);
+
+    if (cml_name_index_init(&ctx->index, (size_t)ctx->num_tensors) != 0) {
+        safetensors_close(ctx);
+        return NULL;
+    }
+    for (int i = 0; i < ctx->num_tensors; i++)
+        cml_name_index_insert(&ctx->index, ctx->tensors[i].name, i);
+
+    if (opts && opts->use_mmap) {
+        ctx->map = cml_mapped_file_open(filepath);
+        if (ctx->map) {
+            size_t data_start = 8 + (size_t)header_size;
+            size_t data_len = ctx->map->size > data_start ? ctx->map->size - data_start : 0;
+            if (opts->advice != CML_MAP_ADVICE_NORMAL)
+                cml_mapped_file_advise(ctx->map, data_start, data_len, opts->advice);
+            if (opts->prefetch)
+                cml_mapped_file_advise(ctx->map, data_start, data_len, CML_MAP_ADVICE_WILLNEED);
+        }
+    }
+
     return ctx;
 }
 
@@ -282,6 +310,8 @@ void safetensors_close(SafeTensorsContext* ctx) {
     }
 
     if (ctx->file) fclose(ctx->file);
+    cml_mapped_file_close(ctx->map);
+    cml_name_index_free(&ctx->index);
     if (ctx->tensors) {
         int count = ctx->is_write ? ctx->write_count : ctx->num_tensors;
         for (int i = 0; i < count; i++) {
@@ -307,12 +337,7 @@ const char* safetensors_get_tensor_name(SafeTensorsContext* ctx, int index) {
 Tensor* safetensors_read_tensor(SafeTensorsContext* ctx, const char* name) {
     if (!ctx || !name || ctx->is_write) return NULL;
 
-    int idx = -1;
-    for (int i = 0; i < ctx->num_tensors; i++) {
-        if (ctx->tensors[i].name && strcmp(ctx->tensors[i].name, name) == 0) {
-            idx = i; break;
-        }
-    }
+    int idx = cml_name_index_find(&ctx->index, name);
     if (idx < 0) return NULL;
 
     SafeTensorInfo* info = &ctx->tensors[idx];
@@ -320,10 +345,36 @@ Tensor* safetensors_read_tensor(SafeTensorsContext* ctx, const char* name) {
     size_t data_size = info->data_end - info->data_start;
 
     TensorConfig config = {.dtype = dtype, .device = DEVICE_CPU, .has_dtype = true, .has_device = true};
+
+    const uint8_t* mapped = NULL;
+    if (ctx->map) {
+        size_t start = 8 + (size_t)ctx->header_size + info->data_start;
+        if (info->data_end < info->data_start || start > ctx->map->size ||
+            data_size > ctx->map->size - start) {
+            LOG_ERROR("safetensors_read_tensor: '%s' extends past end of file", name);
+            return NULL;
+        }
+        mapped = ctx->map->base + start;
+        /* Zero-copy: alias the mapping. Valid until safetensors_close(). The
+         * header length is arbitrary, so misaligned tensors are copied. */
+        size_t bytes = tensor_numel(info->shape, info->ndim) * cml_dtype_size(dtype);
+        if (info->ndim > 0 && data_size >= bytes &&
+            ((uintptr_t)mapped % cml_dtype_size(dtype)) == 0) {
+            Tensor* t = tensor_from_blob((void*)mapped, info->shape, info->ndim, &config);
+            if (t) return t;
+        }
+    }
+
     Tensor* t = tensor_empty(info->shape, info->ndim, &config);
     if (!t) return NULL;
     tensor_ensure_executed(t);
 
+    if (mapped) {
+        size_t bytes = t->numel * cml_dtype_size(dtype);
+        memcpy(t->data, mapped, data_size < bytes ? data_size : bytes);
+        return t;
+    }
+
     long data_offset = 8 + (long)ctx->header_size + (long)info->data_start;
     fseek(ctx->file, data_offset, SEEK_SET);
     if (fread(t->data, 1, data_size, ctx->file) != data_size) {
@@ -386,7 +437,9 @@ int module_save_safetensors(Module* module, const char* filepath) {
 int module_load_safetensors(Module* module, const char* filepath) {
     if (!module || !filepath) return -1;
 
-    SafeTensorsContext* ctx = safetensors_open_read(filepath);
+    /* Copy straight out of the mapping: no staging buffer per tensor */
+    CMLWeightLoadOptions opts = {.use_mmap = true, .advice = CML_MAP_ADVICE_SEQUENTIAL};
+    SafeTensorsContext* ctx = safetensors_open_read_ex(filepath, &opts);
     if (!ctx) return -1;
 
     NamedParameter* named_params = NULL;
@@ -403,6 +456,7 @@ int module_load_safetensors(Module* module, const char* filepath) {
             tensor_ensure_executed(target);
             if (target->data && loaded->data && target->numel == loaded->numel) {
                 memcpy(target->data, loaded->data, target->numel * cml_dtype_size(target->dtype));
+                tensor_bump_version(target);
             }
             tensor_free(loaded);
         }
@@ -309,6 +309,7 @@ int module_load_stream(Module* module, FILE* file) {
                         free(cpu_buffer);
                     }
                 }
+                tensor_bump_version(target_param->tensor);
             } else {
                 LOG_WARNING("Shape or dtype mismatch for parameter %s, skipping",
                             name ? name : "unknown");
@@ -520,6 +520,7 @@ int cml_train(Module* model, DataLoader* train_loader, Optimizer* optimizer,
                 }
             }
             optimizer->step(optimizer);
+            optimizer_bump_param_versions(optimizer);
             if (use_progress_bar && num_batches % 10 == 0) {
                 float progress = 100.0f *
                                  (float)(epoch * train_loader->total_batches + batch->batch_index) /
@@ -725,6 +726,7 @@ int cml_train_with_validation(Module* model, DataLoader* train_loader, DataLoade
                 }
             }
             optimizer->step(optimizer);
+            optimizer_bump_param_versions(optimizer);
             if (callbacks.on_batch_end) {
                 callbacks.on_batch_end(epoch, batch->batch_index, loss_value, callbacks.user_data);
             }
@@ -0,0 +1,143 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+#ifdef __APPLE__
+#define _DARWIN_C_SOURCE
+#endif
+#include "core/weight_file.h"
+#include "core/logging.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CML_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+CMLMappedFile* cml_mapped_file_open(const char* path) {
+#ifdef CML_HAS_MMAP
+    if (!path) return NULL;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd); /* The mapping keeps the file alive */
+    if (base == MAP_FAILED) {
+        LOG_WARNING("mmap of %s failed, falling back to buffered reads", path);
+        return NULL;
+    }
+
+    CMLMappedFile* map = malloc(sizeof(CMLMappedFile));
+    if (!map) {
+        munmap(base, (size_t)st.st_size);
+        return NULL;
+    }
+    map->base = base;
+    map->size = (size_t)st.st_size;
+    return map;
+#else
+    (void)path;
+    return NULL;
+#endif
+}
+
+void cml_mapped_file_close(CMLMappedFile* map) {
+    if (!map) return;
+#ifdef CML_HAS_MMAP
+    munmap(map->base, map->size);
+#endif
+    free(map);
+}
+
+void cml_mapped_file_advise(CMLMappedFile* map, size_t offset, size_t length,
+                            CMLMapAdvice advice) {
+#ifdef CML_HAS_MMAP
+    if (!map || offset >= map->size) return;
+    if (length > map->size - offset) length = map->size - offset;
+
+    /* madvise wants a page-aligned start */
+    size_t page  = (size_t)sysconf(_SC_PAGESIZE);
+    size_t start = offset & ~(page - 1);
+    length += offset - start;
+
+    int flag = MADV_NORMAL;
+    switch (advice) {
+        case CML_MAP_ADVICE_SEQUENTIAL: flag = MADV_SEQUENTIAL; break;
+        case CML_MAP_ADVICE_RANDOM:     flag = MADV_RANDOM; break;
+        case CML_MAP_ADVICE_WILLNEED:   flag = MADV_WILLNEED; break;
+        default: break;
+    }
+    if (madvise(map->base + start, length, flag) != 0)
+        LOG_DEBUG("madvise(%d) on weight mapping failed", flag);
+#else
+    (void)map; (void)offset; (void)length; (void)advice;
+#endif
+}
+
+static uint64_t name_hash(const char* s) {
+    uint64_t h = 1469598103934665603ULL; /* FNV-1a */
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+int cml_name_index_init(CMLNameIndex* index, size_t expected) {
+    if (!index) return -1;
+    size_t cap = 16;
+    while (cap < expected * 2) cap <<= 1;
+
+    index->keys   = calloc(cap, sizeof(const char*));
+    index->values = malloc(cap * sizeof(int));
+    index->mask   = cap - 1;
+    if (!index->keys || !index->values) {
+        cml_name_index_free(index);
+        return -1;
+    }
+    return 0;
+}
+
+void cml_name_index_free(CMLNameIndex* index) {
+    if (!index) return;
+    free(index->keys);
+    free(index->values);
+    index->keys   = NULL;
+    index->values = NULL;
+    index->mask   = 0;
+}
+
+int cml_name_index_insert(CMLNameIndex* index, const char* name, int value) {
+    if (!index || !index->keys || !name) return -1;
+    size_t slot = (size_t)name_hash(name) & index->mask;
+    for (size_t probe = 0; probe <= index->mask; probe++) {
+        if (!index->keys[slot]) {
+            index->keys[slot]   = name;
+            index->values[slot] = value;
+            return 0;
+        }
+        if (strcmp(index->keys[slot], name) == 0) return 0;
+        slot = (slot + 1) & index->mask;
+    }
+    return -1; /* Full: sized for at most half occupancy, so not expected */
+}
+
+int cml_name_index_find(const CMLNameIndex* index, const char* name) {
+    if (!index || !index->keys || !name) return -1;
+    size_t slot = (size_t)name_hash(name) & index->mask;
+    while (index->keys[slot]) {
+        if (strcmp(index->keys[slot], name) == 0) return index->values[slot];
+        slot = (slot + 1) & index->mask;
+    }
+    return -1;
+}
@@ -1,21 +1,199 @@
 #include "distributed/data_parallel.h"
 #include "distributed/distributed.h"
+#include "autograd/autograd.h"
+#include "autograd/amp.h"
+#include "optim/multi_tensor.h"
 #include "core/logging.h"
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
 #define DEFAULT_BUCKET_SIZE (25 * 1024 * 1024) /* 25MB in bytes */
 
+typedef struct {
+    CMLDataParallel* ddp;
+    int index;
+} DDPHookRef;
+
 DDPConfig cml_ddp_default_config(void) {
     DDPConfig config = {
         .bucket_size_bytes = DEFAULT_BUCKET_SIZE,
         .broadcast_buffers = true,
         .find_unused_parameters = false,
-        .gradient_as_bucket_view = 0
+        .gradient_as_bucket_view = 1,
+        .zero_stage = 0
     };
     return config;
 }
 
+static float* ddp_param_slot(CMLDataParallel* ddp, int i) {
+    float* bucket = ddp->buckets[ddp->param_to_bucket[i]];
+    return bucket ? bucket + ddp->param_offsets[i] : NULL;
+}
+
+static bool ddp_has_tensor(const CMLDataParallel* ddp, int i) {
+    return ddp->all_params[i] && ddp->all_params[i]->tensor;
+}
+
+/* Sharded buckets are padded to world_size equal chunks */
+static size_t ddp_bucket_len(const CMLDataParallel* ddp, int b) {
+    return ddp->shard_sizes ? ddp->shard_sizes[b] * (size_t)ddp->group->world_size
+                            : ddp->bucket_sizes[b];
+}
+
+static int ddp_alloc_bucket(CMLDataParallel* ddp, int b) {
+    if (ddp->buckets[b] || ddp->bucket_sizes[b] == 0)
+        return 0;
+    size_t len      = ddp_bucket_len(ddp, b);
+    ddp->buckets[b] = calloc(len, sizeof(float));
+    if (!ddp->buckets[b]) {
+        LOG_ERROR("DDP: failed to allocate bucket %d", b);
+        return -1;
+    }
+    TensorConfig cfg = {.dtype = DTYPE_FLOAT32, .device = DEVICE_CPU,
+                        .has_dtype = true, .has_device = true};
+    int shape[1] = {(int)len};
+    ddp->bucket_tensors[b] = tensor_from_blob(ddp->buckets[b], shape, 1, &cfg);
+    return 0;
+}
+
+static void ddp_drop_bucket(CMLDataParallel* ddp, int b) {
+    tensor_free(ddp->bucket_tensors[b]);
+    free(ddp->buckets[b]);
+    ddp->bucket_tensors[b] = NULL;
+    ddp->buckets[b]        = NULL;
+}
+
+/* Points the parameter's gradient at its bucket slot, keeping its values
+ * (a missing gradient reads as zero) */
+static void ddp_install_view(CMLDataParallel* ddp, int i) {
+    Tensor* t   = ddp->all_params[i]->tensor;
+    float* slot = ddp_param_slot(ddp, i);
+    if (!slot || t->dtype != DTYPE_FLOAT32)
+        return;
+
+    Tensor* old = t->grad;
+    if (old && old->data == slot)
+        return;
+    /* Lazy gradients (module_zero_grad's fill) are realized first */
+    const float* src = old && old->numel == t->numel && old->dtype == DTYPE_FLOAT32
+                           ? (const float*)tensor_data_ptr(old)
+                           : NULL;
+    if (src)
+        memcpy(slot, src, t->numel * sizeof(float));
+    else
+        memset(slot, 0, t->numel * sizeof(float));
+
+    TensorConfig cfg = {.dtype = DTYPE_FLOAT32, .device = DEVICE_CPU,
+                        .has_dtype = true, .has_device = true};
+    Tensor* view = tensor_from_blob(slot, t->shape, t->ndim, &cfg);
+    if (!view)
+        return;
+    if (old)
+        tensor_free(old);
+    t->grad = view;
+}
+
+/* Gives a bucket-view gradient its own storage before the bucket goes away */
+static void ddp_release_view(CMLDataParallel* ddp, int i) {
+    Tensor* g   = ddp->all_params[i]->tensor->grad;
+    float* slot = ddp_param_slot(ddp, i);
+    if (!g || !slot || g->data != slot)
+        return;
+    float* own = malloc(g->numel * sizeof(float));
+    if (own)
+        memcpy(own, slot, g->numel * sizeof(float));
+    g->data      = own;
+    g->owns_data = own != NULL;
+}
+
+static bool ddp_uses_views(const CMLDataParallel* ddp) {
+    return ddp->group->world_size > 1 && ddp->config.gradient_as_bucket_view;
+}
+
+/* module_zero_grad and friends replace a parameter's gradient with fresh
+ * storage; point it back at its bucket slot before the next backward */
+static void ddp_restore_views(CMLDataParallel* ddp) {
+    if (!ddp_uses_views(ddp))
+        return;
+    for (int i = 0; i < ddp->num_params; i++)
+        if (ddp_has_tensor(ddp, i))
+            ddp_install_view(ddp, i);
+}
+
+/* Gradients that are not bucket views are copied in (and become views again
+ * when the config asks for them); missing ones count as zero */
+static void ddp_pack_param(CMLDataParallel* ddp, int i) {
+    if (ddp_alloc_bucket(ddp, ddp->param_to_bucket[i]) != 0)
+        return; /* Stage 2 buckets come back on first use */
+    float* slot = ddp_param_slot(ddp, i);
+    Tensor* t   = ddp->all_params[i]->tensor;
+    if (!slot)
+        return;
+    Tensor* g = t->grad;
+    if (g && g->data == slot)
+        return;
+    if (g && g->data && ddp_uses_views(ddp))
+        ddp_install_view(ddp, i);
+    else if (g && g->data)
+        memcpy(slot, g->data, t->numel * sizeof(float));
+    else
+        memset(slot, 0, t->numel * sizeof(float));
+}
+
+static void ddp_launch_bucket(CMLDataParallel* ddp, int b) {
+    /* Sharded buckets are reduce-scattered by cml_ddp_step */
+    if (!ddp->bucket_tensors[b] || ddp->optimizer)
+        return;
+    ddp->bucket_work[b] = cml_dist_allreduce_async(ddp->bucket_tensors[b], DIST_REDUCE_AVG);
+    if (!ddp->bucket_work[b]) {
+        LOG_WARNING("DDP: async allreduce unavailable for bucket %d, reducing inline", b);
+        cml_dist_allreduce(ddp->bucket_tensors[b], DIST_REDUCE_AVG);
+    }
+}
+
+/* Every rank launches buckets in the same (index) order */
+static void ddp_launch_ready(CMLDataParallel* ddp) {
+    while (ddp->next_launch < ddp->num_buckets && ddp->bucket_ready[ddp->next_launch]) {
+        ddp_launch_bucket(ddp, ddp->next_launch);
+        ddp->next_launch++;
+    }
+}
+
+static void ddp_mark_ready(CMLDataParallel* ddp, int i) {
+    if (ddp->param_ready[i])
+        return;
+    ddp->param_ready[i] = true;
+    ddp_pack_param(ddp, i);
+
+    int b = ddp->param_to_bucket[i];
+    if (--ddp->bucket_pending[b] == 0) {
+        ddp->bucket_ready[b] = true;
+        ddp_launch_ready(ddp);
+    }
+}
+
+static void ddp_grad_ready(Tensor* t, void* ctx) {
+    (void)t;
+    DDPHookRef* ref = (DDPHookRef*)ctx;
+    if (ref->ddp->require_sync)
+        ddp_mark_ready(ref->ddp, ref->index);
+}
+
+static void ddp_reset_pass(CMLDataParallel* ddp) {
+    for (int b = 0; b < ddp->num_buckets; b++)
+        ddp->bucket_pending[b] = 0;
+    for (int i = 0; i < ddp->num_params; i++) {
+        ddp->param_ready[i] = false;
+        if (ddp_has_tensor(ddp, i))
+            ddp->bucket_pending[ddp->param_to_bucket[i]]++;
+    }
+    for (int b = 0; b < ddp->num_buckets; b++)
+        ddp->bucket_ready[b] = ddp->bucket_pending[b] == 0;
+    ddp->next_launch = 0;
+    ddp_restore_views(ddp);
+}
+
 CMLDataParallel* cml_ddp_create(Module* module, const DDPConfig* config) {
     if (!module) {
         LOG_ERROR("NULL module for DDP");
@@ -34,6 +212,9 @@ CMLDataParallel* cml_ddp_create(Module* module, const DDPConfig* config) {
     ddp->module = module;
     ddp->group = cml_dist_get_default_group();
     ddp->config = config ? *config : cml_ddp_default_config();
+    ddp->require_sync = true;
+    if (ddp->config.zero_stage >= 2)
+        ddp->config.gradient_as_bucket_view = 0; /* The buckets do not persist */
 
     /* Collect all parameters */
     int result = module_collect_parameters(module, &ddp->all_params,
@@ -54,6 +235,8 @@ CMLDataParallel* cml_ddp_create(Module* module, const DDPConfig* config) {
 
     /* Setup gradient buckets */
     size_t bucket_size_floats = ddp->config.bucket_size_bytes / sizeof(float);
+    if (bucket_size_floats == 0)
+        bucket_size_floats = 1;
     size_t total_params_size = 0;
 
     for (int i = 0; i < ddp->num_params; i++) {
@@ -69,21 +252,31 @@ CMLDataParallel* cml_ddp_create(Module* module, const DDPConfig* config) {
     ddp->bucket_sizes = calloc(ddp->num_buckets, sizeof(size_t));
     ddp->bucket_ready = calloc(ddp->num_buckets, sizeof(bool));
     ddp->param_to_bucket = calloc(ddp->num_params, sizeof(int));
-
-    if (!ddp->buckets || !ddp->bucket_sizes || !ddp->bucket_ready || !ddp->param_to_bucket) {
+    ddp->bucket_tensors = calloc(ddp->num_buckets, sizeof(Tensor*));
+    ddp->param_offsets = calloc(ddp->num_params, sizeof(size_t));
+    ddp->bucket_pending = calloc(ddp->num_buckets, sizeof(int));
+    ddp->param_ready = calloc(ddp->num_params, sizeof(bool));
+    ddp->bucket_work = calloc(ddp->num_buckets, sizeof(DistWork*));
+    ddp->hook_refs = calloc(ddp->num_params, sizeof(DDPHookRef));
+
+    if (!ddp->buckets || !ddp->bucket_sizes || !ddp->bucket_ready || !ddp->param_to_bucket ||
+        !ddp->bucket_tensors || !ddp->param_offsets || !ddp->bucket_pending ||
+        !ddp->param_ready || !ddp->bucket_work || !ddp->hook_refs) {
         cml_ddp_free(ddp);
         return NULL;
     }
 
-    /* Assign parameters to buckets */
+    /* Assign parameters to buckets in reverse order, the order backward
+     * finishes their gradients in, so early buckets fill first. */
     size_t current_size = 0;
     int current_bucket = 0;
 
-    for (int i = 0; i < ddp->num_params; i++) {
+    for (int i = ddp->num_params - 1; i >= 0; i--) {
         ddp->param_to_bucket[i] = current_bucket;
 
         if (ddp->all_params[i] && ddp->all_params[i]->tensor) {
             size_t param_size = ddp->all_params[i]->tensor->numel;
+            ddp->param_offsets[i] = ddp->bucket_sizes[current_bucket];
             ddp->bucket_sizes[current_bucket] += param_size;
             current_size += param_size;
 
@@ -94,15 +287,38 @@ CMLDataParallel* cml_ddp_create(Module* module, const DDPConfig* config) {
         }
     }
 
+    /* Parameters larger than a bucket leave trailing buckets unused */
+    while (ddp->num_buckets > 1 && ddp->bucket_sizes[ddp->num_buckets - 1] == 0)
+        ddp->num_buckets--;
+
+    if (ddp->config.zero_stage > 0) {
+        size_t W         = (size_t)ddp->group->world_size;
+        ddp->shard_sizes = calloc(ddp->num_buckets, sizeof(size_t));
+        if (!ddp->shard_sizes) {
+            cml_ddp_free(ddp);
+            return NULL;
+        }
+        for (int b = 0; b < ddp->num_buckets; b++)
+            ddp->shard_sizes[b] = (ddp->bucket_sizes[b] + W - 1) / W;
+    }
+
     /* Allocate bucket buffers */
-    for (int b = 0; b < ddp->num_buckets; b++) {
-        if (ddp->bucket_sizes[b] > 0) {
-            ddp->buckets[b] = calloc(ddp->bucket_sizes[b], sizeof(float));
-            if (!ddp->buckets[b]) {
-                LOG_ERROR("DDP: failed to allocate bucket %d", b);
-            }
+    for (int b = 0; b < ddp->num_buckets; b++)
+        ddp_alloc_bucket(ddp, b);
+
+    /* Reduce from backward: every rank reports gradients through hooks */
+    if (ddp->group->world_size > 1) {
+        DDPHookRef* refs = (DDPHookRef*)ddp->hook_refs;
+        for (int i = 0; i < ddp->num_params; i++) {
+            if (!ddp_has_tensor(ddp, i))
+                continue;
+            if (ddp->config.gradient_as_bucket_view)
+                ddp_install_view(ddp, i);
+            refs[i] = (DDPHookRef){ddp, i};
+            tensor_register_grad_ready_hook(ddp->all_params[i]->tensor, ddp_grad_ready, &refs[i]);
         }
     }
+    ddp_reset_pass(ddp);
 
     ddp->initialized = true;
 
@@ -116,6 +332,8 @@ Tensor* cml_ddp_forward(CMLDataParallel* ddp, Tensor* input) {
     if (!ddp || !ddp->module || !input)
         return NULL;
 
+    if (ddp->initialized)
+        ddp_restore_views(ddp);
     return module_forward(ddp->module, input);
 }
 
@@ -125,88 +343,386 @@ int cml_ddp_sync_gradients(CMLDataParallel* ddp) {
         return -1;
     }
 
+    if (ddp->optimizer) {
+        LOG_ERROR("DDP: a sharded optimizer synchronizes in cml_ddp_step");
+        return -1;
+    }
+
     int world_size = ddp->group->world_size;
     if (world_size <= 1) {
         /* No need to sync in single-process mode */
         return 0;
     }
 
-    LOG_DEBUG("DDP: syncing gradients across %d processes", world_size);
+    LOG_DEBUG("DDP: syncing gradients across %d processes (%d/%d buckets in flight)",
+              world_size, ddp->next_launch, ddp->num_buckets);
+
+    /* Anything backward did not report (unused parameters, no hooks) */
+    for (int i = 0; i < ddp->num_params; i++) {
+        if (ddp_has_tensor(ddp, i))
+            ddp_mark_ready(ddp, i);
+    }
+    ddp_launch_ready(ddp);
 
-    /* Process each bucket */
+    int ret = 0;
     for (int b = 0; b < ddp->num_buckets; b++) {
-        if (ddp->bucket_sizes[b] == 0)
+        if (!ddp->bucket_work[b])
             continue;
+        if (cml_dist_wait(ddp->bucket_work[b]) != 0) {
+            LOG_ERROR("DDP: allreduce failed for bucket %d", b);
+            ret = -1;
+        }
+        cml_dist_work_free(ddp->bucket_work[b]);
+        ddp->bucket_work[b] = NULL;
+    }
 
-        /* Pack gradients into bucket */
-        size_t offset = 0;
-        for (int i = 0; i < ddp->num_params; i++) {
-            if (ddp->param_to_bucket[i] != b)
-                continue;
+    /* Views already hold the averaged values; copy the rest back */
+    for (int i = 0; i < ddp->num_params; i++) {
+        if (!ddp_has_tensor(ddp, i))
+            continue;
+        Tensor* g   = ddp->all_params[i]->tensor->grad;
+        float* slot = ddp_param_slot(ddp, i);
+        if (g && g->data && slot && g->data != slot)
+            memcpy(g->data, slot, g->numel * sizeof(float));
+    }
 
-            Parameter* p = ddp->all_params[i];
-            if (!p || !p->tensor || !p->tensor->grad || !p->tensor->grad->data)
-                continue;
+    ddp_reset_pass(ddp);
+    LOG_DEBUG("DDP: gradient sync complete");
+    return ret;
+}
 
-            float* grad_data = (float*)p->tensor->grad->data;
-            size_t numel = p->tensor->numel;
+void cml_ddp_set_require_sync(CMLDataParallel* ddp, bool require_sync) {
+    if (ddp)
+        ddp->require_sync = require_sync;
+}
 
-            if (ddp->buckets[b]) {
-                memcpy(ddp->buckets[b] + offset, grad_data, numel * sizeof(float));
-            }
-            offset += numel;
+/* ── ZeRO ─────────────────────────────────────────────────────────────── */
+
+/* Owned element range of bucket b, in bucket coordinates */
+static void ddp_shard_range(const CMLDataParallel* ddp, int b, size_t* lo, size_t* hi) {
+    size_t start = (size_t)ddp->group->rank * ddp->shard_sizes[b];
+    size_t end   = start + ddp->shard_sizes[b];
+    *lo = start < ddp->bucket_sizes[b] ? start : ddp->bucket_sizes[b];
+    *hi = end < ddp->bucket_sizes[b] ? end : ddp->bucket_sizes[b];
+}
+
+static bool ddp_packable(Tensor* t) {
+    return t->dtype == DTYPE_FLOAT32 && !t->buffer_handle && t->is_contiguous &&
+           t->storage_offset == 0 && (t->device == DEVICE_CPU || t->device == DEVICE_AUTO) &&
+           tensor_data_ptr(t) != NULL;
+}
+
+/* Gives the parameters their own storage back and drops the shards */
+static void ddp_unshard(CMLDataParallel* ddp) {
+    if (!ddp->optimizer)
+        return;
+    int W = ddp->group->world_size;
+    for (int i = 0; i < ddp->num_params; i++) {
+        if (!ddp_has_tensor(ddp, i) || !ddp->param_buckets[ddp->param_to_bucket[i]])
+            continue;
+        Tensor* t   = ddp->all_params[i]->tensor;
+        float* slot = ddp->param_buckets[ddp->param_to_bucket[i]] + ddp->param_offsets[i];
+        if (t->data != slot)
+            continue;
+        float* own = malloc((t->numel ? t->numel : 1) * sizeof(float));
+        if (own)
+            memcpy(own, slot, t->numel * sizeof(float));
+        else
+            LOG_ERROR("DDP: out of memory unsharding a %zu-element parameter", t->numel);
+        t->data      = own;
+        t->owns_data = own != NULL;
+    }
+    for (int b = 0; b < ddp->num_buckets; b++) {
+        if (ddp->shard_grad_views)
+            tensor_free(ddp->shard_grad_views[b]);
+        for (int q = 0; ddp->gather_views && q < W; q++)
+            tensor_free(ddp->gather_views[b * W + q]);
+        if (ddp->param_buckets)
+            free(ddp->param_buckets[b]);
+    }
+    free(ddp->shard_grad_views);
+    free(ddp->gather_views);
+    free(ddp->param_buckets);
+    free(ddp->shard_offsets);
+    free(ddp->shard_grads);
+    for (int k = 0; k < 3; k++)
+        free(ddp->shard_state[k]);
+    free(ddp->param_group);
+    ddp->shard_grad_views = NULL;
+    ddp->gather_views     = NULL;
+    ddp->param_buckets    = NULL;
+    ddp->shard_offsets    = NULL;
+    ddp->shard_grads      = NULL;
+    memset(ddp->shard_state, 0, sizeof(ddp->shard_state));
+    ddp->param_group = NULL;
+    ddp->optimizer   = NULL;
+}
+
+int cml_ddp_shard_optimizer(CMLDataParallel* ddp, Optimizer* optimizer) {
+    if (!ddp || !ddp->initialized || !optimizer)
+        return -1;
+    if (!ddp->shard_sizes) {
+        LOG_ERROR("DDP: sharding needs config.zero_stage > 0");
+        return -1;
+    }
+    if (ddp->optimizer) {
+        LOG_ERROR("DDP: an optimizer is already sharded");
+        return -1;
+    }
+    CMLFlatRule rule;
+    if (strcmp(optimizer->name, "Adam") == 0) {
+        rule = CML_FLAT_ADAM;
+    } else if (strcmp(optimizer->name, "AdamW") == 0) {
+        rule = CML_FLAT_ADAMW;
+    } else {
+        LOG_ERROR("DDP: sharded step supports Adam and AdamW, not %s", optimizer->name);
+        return -1;
+    }
+    if (optimizer->use_flat) {
+        LOG_ERROR("DDP: turn off the optimizer's flat mode before sharding it");
+        return -1;
+    }
+    for (int i = 0; i < ddp->num_params; i++) {
+        if (ddp_has_tensor(ddp, i) && !ddp_packable(ddp->all_params[i]->tensor)) {
+            LOG_ERROR("DDP: parameter %d cannot be sharded (not contiguous float32 on CPU)", i);
+            return -1;
         }
+    }
+
+    int W  = ddp->group->world_size;
+    int nb = ddp->num_buckets;
+    ddp->optimizer        = optimizer; /* From here on ddp_unshard cleans up */
+    ddp->shard_rule       = (int)rule;
+    ddp->param_group      = malloc((size_t)ddp->num_params * sizeof(int));
+    ddp->shard_offsets    = calloc((size_t)nb, sizeof(size_t));
+    ddp->shard_grad_views = calloc((size_t)nb, sizeof(Tensor*));
+    ddp->gather_views     = calloc((size_t)nb * (size_t)W, sizeof(Tensor*));
+    ddp->param_buckets    = calloc((size_t)nb, sizeof(float*));
+    if (!ddp->param_group || !ddp->shard_offsets || !ddp->shard_grad_views ||
+        !ddp->gather_views || !ddp->param_buckets)
+        goto fail;
 
-        /* All-reduce the bucket */
-        if (ddp->buckets[b] && offset > 0) {
-            /* Create a temporary tensor for the bucket */
-            int shape[1] = {(int)offset};
-            Tensor bucket_tensor = {
-                .data = ddp->buckets[b],
-                .shape = shape,
-                .ndim = 1,
-                .numel = offset,
-                .dtype = DTYPE_FLOAT32,
-                .device = DEVICE_CPU,
-                .owns_data = false
-            };
-
-            cml_dist_allreduce(&bucket_tensor, DIST_REDUCE_SUM);
-
-            /* Average by world_size */
-            float scale = 1.0f / (float)world_size;
-            for (size_t j = 0; j < offset; j++)
-                ddp->buckets[b][j] *= scale;
+    for (int i = 0; i < ddp->num_params; i++) {
+        ddp->param_group[i] = -1;
+        for (int g = 0; g < optimizer->num_param_groups && ddp->param_group[i] < 0; g++) {
+            ParameterGroup* grp = &optimizer->param_groups[g];
+            for (int k = 0; k < grp->num_parameters; k++)
+                if (grp->parameters[k] == ddp->all_params[i])
+                    ddp->param_group[i] = g;
         }
+    }
 
-        /* Unpack gradients from bucket */
-        offset = 0;
-        for (int i = 0; i < ddp->num_params; i++) {
-            if (ddp->param_to_bucket[i] != b)
-                continue;
+    ddp->shard_numel = 0;
+    for (int b = 0; b < nb; b++) {
+        ddp->shard_offsets[b] = ddp->shard_numel;
+        ddp->shard_numel += ddp->shard_sizes[b];
+    }
+    size_t total     = ddp->shard_numel ? ddp->shard_numel : 1;
+    ddp->shard_grads = calloc(total, sizeof(float));
+    for (int k = 0; k < (optimizer->amsgrad ? 3 : 2); k++)
+        if (!(ddp->shard_state[k] = calloc(total, sizeof(float))))
+            goto fail;
+    if (!ddp->shard_grads)
+        goto fail;
+
+    TensorConfig cfg = {.dtype = DTYPE_FLOAT32, .device = DEVICE_CPU,
+                        .has_dtype = true, .has_device = true};
+    for (int b = 0; b < nb; b++) {
+        if (ddp->bucket_sizes[b] == 0)
+            continue;
+        int shape[1]          = {(int)ddp->shard_sizes[b]};
+        ddp->param_buckets[b] = calloc(ddp_bucket_len(ddp, b), sizeof(float));
+        if (!ddp->param_buckets[b])
+            goto fail;
+        ddp->shard_grad_views[b] =
+            tensor_from_blob(ddp->shard_grads + ddp->shard_offsets[b], shape, 1, &cfg);
+        for (int q = 0; q < W; q++)
+            ddp->gather_views[b * W + q] = tensor_from_blob(
+                ddp->param_buckets[b] + (size_t)q * ddp->shard_sizes[b], shape, 1, &cfg);
+    }
 
-            Parameter* p = ddp->all_params[i];
-            if (!p || !p->tensor || !p->tensor->grad || !p->tensor->grad->data)
-                continue;
+    /* Parameters move into the buckets they are gathered into */
+    for (int i = 0; i < ddp->num_params; i++) {
+        if (!ddp_has_tensor(ddp, i))
+            continue;
+        Tensor* t   = ddp->all_params[i]->tensor;
+        float* slot = ddp->param_buckets[ddp->param_to_bucket[i]] + ddp->param_offsets[i];
+        memcpy(slot, t->data, t->numel * sizeof(float));
+        if (t->owns_data)
+            free(t->data);
+        t->data      = slot;
+        t->owns_data = false;
+    }
+
+    LOG_INFO("DDP: sharded %s state, %zu of %zu floats per moment on rank %d", optimizer->name,
+             ddp->shard_numel, ddp->shard_numel * (size_t)W, ddp->group->rank);
+    return 0;
+
+fail:
+    LOG_ERROR("DDP: out of memory sharding the optimizer");
+    ddp_unshard(ddp);
+    return -1;
+}
+
+/* Sum of squares of the owned, optimized gradients */
+static double ddp_shard_sum_sq(const CMLDataParallel* ddp) {
+    double sum = 0.0;
+    for (int i = 0; i < ddp->num_params; i++) {
+        if (!ddp_has_tensor(ddp, i) || ddp->param_group[i] < 0)
+            continue;
+        int b = ddp->param_to_bucket[i];
+        size_t lo, hi;
+        ddp_shard_range(ddp, b, &lo, &hi);
+        size_t a = ddp->param_offsets[i] > lo ? ddp->param_offsets[i] : lo;
+        size_t e = ddp->param_offsets[i] + ddp->all_params[i]->tensor->numel;
+        if (e > hi) e = hi;
+        const float* g = ddp->shard_grads + ddp->shard_offsets[b];
+        for (size_t j = a; j < e; j++)
+            sum += (double)g[j - lo] * g[j - lo];
+    }
+    return sum;
+}
 
-            float* grad_data = (float*)p->tensor->grad->data;
-            size_t numel = p->tensor->numel;
+int cml_ddp_step(CMLDataParallel* ddp) {
+    if (!ddp || !ddp->initialized)
+        return -1;
+    if (!ddp->optimizer) {
+        LOG_ERROR("DDP: cml_ddp_step needs cml_ddp_shard_optimizer");
+        return -1;
+    }
+    Optimizer* opt = ddp->optimizer;
+    int W          = ddp->group->world_size;
+    int rank       = ddp->group->rank;
 
-            if (ddp->buckets[b]) {
-                memcpy(grad_data, ddp->buckets[b] + offset, numel * sizeof(float));
+    /* Gradients backward did not report are packed now */
+    for (int i = 0; i < ddp->num_params; i++)
+        if (ddp_has_tensor(ddp, i))
+            ddp_mark_ready(ddp, i);
+
+    int ret = 0;
+    for (int b = 0; b < ddp->num_buckets; b++) {
+        if (ddp->bucket_sizes[b] == 0)
+            continue;
+        if (ddp_alloc_bucket(ddp, b) != 0 ||
+            cml_dist_reduce_scatter(ddp->shard_grad_views[b], ddp->bucket_tensors[b],
+                                    DIST_REDUCE_AVG) != 0) {
+            LOG_ERROR("DDP: reduce-scatter failed for bucket %d", b);
+            ret = -1;
+        }
+    }
+    ddp_reset_pass(ddp);
+    if (ddp->config.zero_stage >= 2) {
+        /* Only the owned shard of the gradient outlives the reduce-scatter */
+        for (int b = 0; b < ddp->num_buckets; b++)
+            ddp_drop_bucket(ddp, b);
+        for (int i = 0; i < ddp->num_params; i++) {
+            if (ddp_has_tensor(ddp, i) && ddp->all_params[i]->tensor->grad) {
+                tensor_free(ddp->all_params[i]->tensor->grad);
+                ddp->all_params[i]->tensor->grad = NULL;
             }
-            offset += numel;
         }
     }
+    if (ret != 0)
+        return ret;
+
+    /* Global norm for clipping and the inf/nan check: every rank adds its
+     * shard, so all of them take the same decision */
+    GradScaler* scaler = opt->grad_scaler;
+    float unscale      = scaler ? 1.0f / scaler->scale_factor : 1.0f;
+    float gs           = unscale;
+    if (opt->grad_clip_norm > 0.0f || scaler) {
+        float sum_sq     = (float)ddp_shard_sum_sq(ddp);
+        int shape[1]     = {1};
+        TensorConfig cfg = {.dtype = DTYPE_FLOAT32, .device = DEVICE_CPU,
+                            .has_dtype = true, .has_device = true};
+        Tensor* t        = tensor_from_data(&sum_sq, shape, 1, &cfg);
+        if (!t || cml_dist_allreduce(t, DIST_REDUCE_SUM) != 0) {
+            tensor_free(t);
+            return -1;
+        }
+        double norm = sqrt((double)tensor_get_float(t, 0)) * unscale;
+        tensor_free(t);
+        if (!isfinite(norm) && scaler) {
+            scaler->found_inf = true;
+            LOG_WARNING("GradScaler: inf/nan detected in gradients, skipping optimizer step");
+            return 0;
+        }
+        if (opt->grad_clip_norm > 0.0f && isfinite(norm) && norm > opt->grad_clip_norm)
+            gs *= opt->grad_clip_norm / ((float)norm + 1e-6f);
+    }
+    if (scaler)
+        scaler->found_inf = false;
+    if (opt->amsgrad && !ddp->shard_state[2] &&
+        !(ddp->shard_state[2] = calloc(ddp->shard_numel ? ddp->shard_numel : 1, sizeof(float))))
+        return -1;
 
-    LOG_DEBUG("DDP: gradient sync complete");
-    return 0;
+    /* Update the owned part of every optimized parameter */
+    for (int i = 0; i < ddp->num_params; i++) {
+        int g = ddp_has_tensor(ddp, i) ? ddp->param_group[i] : -1;
+        if (g < 0 || !ddp->all_params[i]->requires_grad)
+            continue;
+        ParameterGroup* grp = &opt->param_groups[g];
+        CMLFlatHyper hyper  = {grp->lr, grp->beta1, grp->beta2, grp->epsilon, grp->weight_decay,
+                               grp->step_count + 1};
+        int b = ddp->param_to_bucket[i];
+        size_t lo, hi;
+        ddp_shard_range(ddp, b, &lo, &hi);
+        size_t a = ddp->param_offsets[i] > lo ? ddp->param_offsets[i] : lo;
+        size_t e = ddp->param_offsets[i] + ddp->all_params[i]->tensor->numel;
+        if (e > hi) e = hi;
+        if (a >= e)
+            continue;
+        size_t s = ddp->shard_offsets[b] + (a - lo);
+        cml_flat_update_range((CMLFlatRule)ddp->shard_rule, &hyper, gs, ddp->param_buckets[b] + a,
+                              ddp->shard_grads + s, ddp->shard_state[0] + s,
+                              ddp->shard_state[1] + s,
+                              opt->amsgrad ? ddp->shard_state[2] + s : NULL, e - a);
+    }
+
+    for (int b = 0; b < ddp->num_buckets; b++) {
+        if (ddp->bucket_sizes[b] == 0)
+            continue;
+        if (cml_dist_allgather(&ddp->gather_views[b * W], ddp->gather_views[b * W + rank]) != 0) {
+            LOG_ERROR("DDP: allgather failed for bucket %d", b);
+            ret = -1;
+        }
+    }
+    /* Parameters were rewritten in place through the buckets */
+    for (int i = 0; i < ddp->num_params; i++)
+        if (ddp_has_tensor(ddp, i))
+            tensor_bump_version(ddp->all_params[i]->tensor);
+    for (int g = 0; g < opt->num_param_groups; g++)
+        opt->param_groups[g].step_count++;
+    return ret;
 }
 
 void cml_ddp_free(CMLDataParallel* ddp) {
     if (!ddp)
         return;
 
+    if (ddp->bucket_work) {
+        for (int b = 0; b < ddp->num_buckets; b++)
+            cml_dist_work_free(ddp->bucket_work[b]);
+    }
+
+    if (ddp->initialized && ddp->hook_refs) {
+        DDPHookRef* refs = (DDPHookRef*)ddp->hook_refs;
+        for (int i = 0; i < ddp->num_params; i++) {
+            if (!ddp_has_tensor(ddp, i))
+                continue;
+            tensor_remove_grad_ready_hook(ddp->all_params[i]->tensor, ddp_grad_ready, &refs[i]);
+            ddp_release_view(ddp, i);
+        }
+    }
+
+    ddp_unshard(ddp);
+
+    if (ddp->bucket_tensors) {
+        for (int b = 0; b < ddp->num_buckets; b++)
+            tensor_free(ddp->bucket_tensors[b]);
+        free(ddp->bucket_tensors);
+    }
+
     if (ddp->buckets) {
         for (int b = 0; b < ddp->num_buckets; b++)
             free(ddp->buckets[b]);
@@ -216,6 +732,12 @@ void cml_ddp_free(CMLDataParallel* ddp) {
     free(ddp->bucket_sizes);
     free(ddp->bucket_ready);
     free(ddp->param_to_bucket);
+    free(ddp->param_offsets);
+    free(ddp->bucket_pending);
+    free(ddp->param_ready);
+    free(ddp->bucket_work);
+    free(ddp->hook_refs);
+    free(ddp->shard_sizes);
     free(ddp->all_params);
     free(ddp);
 }
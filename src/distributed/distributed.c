@@ -158,7 +158,10 @@ int cml_dist_broadcast(Tensor* tensor, int src_rank) {
     if (!g_default_group->ops->broadcast)
         return -1;
 
-    return g_default_group->ops->broadcast(tensor, src_rank, g_default_group->backend_ctx);
+    int ret = g_default_group->ops->broadcast(tensor, src_rank, g_default_group->backend_ctx);
+    if (ret == 0)
+        tensor_bump_version(tensor);
+    return ret;
 }
 
 int cml_dist_allgather(Tensor** output, Tensor* input) {
@@ -170,6 +173,15 @@ int cml_dist_allgather(Tensor** output, Tensor* input) {
     return g_default_group->ops->allgather(output, input, g_default_group->backend_ctx);
 }
 
+int cml_dist_reduce_scatter(Tensor* output, Tensor* input, DistReduceOp op) {
+    if (!g_default_group || !g_default_group->initialized)
+        return -1;
+    if (!g_default_group->ops->reduce_scatter)
+        return -1;
+
+    return g_default_group->ops->reduce_scatter(output, input, op, g_default_group->backend_ctx);
+}
+
 int cml_dist_barrier(void) {
     if (!g_default_group || !g_default_group->initialized)
         return -1;
@@ -199,18 +211,20 @@ DistWork* cml_dist_allreduce_async(Tensor* tensor, DistReduceOp op) {
 int cml_dist_wait(DistWork* work) {
     if (!work)
         return -1;
-    if (work->completed)
-        return work->error_code;
 
+    /* Backends complete work on their own threads; let them synchronize */
     if (g_default_group && g_default_group->ops->wait)
         return g_default_group->ops->wait(work);
 
-    return -1;
+    return work->completed ? work->error_code : -1;
 }
 
 void cml_dist_work_free(DistWork* work) {
     if (!work)
         return;
+    /* In-flight work still references internal */
+    if (work->internal)
+        cml_dist_wait(work);
     free(work->internal);
     free(work);
 }
@@ -1,7 +1,9 @@
 #include "distributed/comm_backend.h"
 #include "distributed/distributed.h"
 #include "distributed/ring_allreduce.h"
+#include "distributed/shm_transport.h"
 #include "core/logging.h"
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
@@ -9,11 +11,21 @@
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <errno.h>
+#include <pthread.h>
 
 #define GLOO_DEFAULT_PORT_BASE 29500
 #define GLOO_DEFAULT_MASTER_ADDR "127.0.0.1"
 #define GLOO_MAX_CONNECT_RETRIES 50
 #define GLOO_CONNECT_RETRY_US 100000 /* 100ms */
+#define GLOO_HOSTNAME_LEN 256
+
+/* Queued async collective; owned by its DistWork (work->internal) */
+typedef struct GlooAsyncOp {
+    Tensor* tensor;
+    DistReduceOp op;
+    DistWork* work;
+    struct GlooAsyncOp* next;
+} GlooAsyncOp;
 
 typedef struct GlooContext {
     int rank;
@@ -22,6 +34,28 @@ typedef struct GlooContext {
     int* peer_fds;         /* Array of connected socket fds, indexed by rank */
     int port_base;
     char master_addr[256];
+
+    /* Communication thread: runs queued collectives one at a time, in
+     * submission order, so every rank drives the sockets identically. */
+    pthread_t comm_thread;
+    bool comm_running;
+    bool comm_stop;
+    pthread_mutex_t comm_lock;
+    pthread_cond_t comm_cond; /* Work queued or stop requested */
+    pthread_cond_t done_cond; /* A queued op completed */
+    GlooAsyncOp* queue_head;
+    GlooAsyncOp* queue_tail;
+
+    /* Ranks on this host talk through shared memory instead of TCP.
+     * local_index[r] is rank r's slot in the segment, or -1 off-node. */
+    CMLShmTransport* shm;
+    int* local_index;
+    int* local_ranks;  /* Global ranks on this host, ascending */
+    int local_size;
+    int* node_leaders; /* Lowest global rank on each host */
+    int num_nodes;
+    int node_index;
+    bool hierarchical; /* Allreduce via intra-node tree + leader ring */
 } GlooContext;
 
 /*
@@ -68,6 +102,22 @@ static int recv_all(int fd, void* buf, size_t len) {
     return 0;
 }
 
+static bool peer_is_local(const GlooContext* gctx, int peer) {
+    return gctx->shm && gctx->local_index[peer] >= 0;
+}
+
+static int peer_write(GlooContext* gctx, int peer, const void* buf, size_t len) {
+    if (peer_is_local(gctx, peer))
+        return cml_shm_send(gctx->shm, gctx->local_index[peer], buf, len);
+    return send_all(gctx->peer_fds[peer], buf, len);
+}
+
+static int peer_read(GlooContext* gctx, int peer, void* buf, size_t len) {
+    if (peer_is_local(gctx, peer))
+        return cml_shm_recv(gctx->shm, gctx->local_index[peer], buf, len);
+    return recv_all(gctx->peer_fds[peer], buf, len);
+}
+
 /* Forward declaration so async can call allreduce */
 static int gloo_allreduce(Tensor* tensor, DistReduceOp op, void* ctx);
 
@@ -85,23 +135,22 @@ static int gloo_send(Tensor* tensor, int dst_rank, int tag, void* ctx) {
         return -1;
     }
 
-    int fd = gctx->peer_fds[dst_rank];
-    if (fd < 0) {
+    if (!peer_is_local(gctx, dst_rank) && gctx->peer_fds[dst_rank] < 0) {
         LOG_ERROR("Gloo send: no connection to rank %d", dst_rank);
         return -1;
     }
 
     size_t data_size = tensor->numel * sizeof(float);
 
-    if (send_all(fd, &tag, sizeof(tag)) != 0) {
+    if (peer_write(gctx, dst_rank, &tag, sizeof(tag)) != 0) {
         LOG_ERROR("Gloo send: failed to send tag to rank %d", dst_rank);
         return -1;
     }
-    if (send_all(fd, &data_size, sizeof(data_size)) != 0) {
+    if (peer_write(gctx, dst_rank, &data_size, sizeof(data_size)) != 0) {
         LOG_ERROR("Gloo send: failed to send size to rank %d", dst_rank);
         return -1;
     }
-    if (send_all(fd, tensor->data, data_size) != 0) {
+    if (peer_write(gctx, dst_rank, tensor->data, data_size) != 0) {
         LOG_ERROR("Gloo send: failed to send data to rank %d", dst_rank);
         return -1;
     }
@@ -124,8 +173,7 @@ static int gloo_recv(Tensor* tensor, int src_rank, int tag, void* ctx) {
         return -1;
     }
 
-    int fd = gctx->peer_fds[src_rank];
-    if (fd < 0) {
+    if (!peer_is_local(gctx, src_rank) && gctx->peer_fds[src_rank] < 0) {
         LOG_ERROR("Gloo recv: no connection to rank %d", src_rank);
         return -1;
     }
@@ -133,7 +181,7 @@ static int gloo_recv(Tensor* tensor, int src_rank, int tag, void* ctx) {
     int recv_tag = 0;
     size_t recv_size = 0;
 
-    if (recv_all(fd, &recv_tag, sizeof(recv_tag)) != 0) {
+    if (peer_read(gctx, src_rank, &recv_tag, sizeof(recv_tag)) != 0) {
         LOG_ERROR("Gloo recv: failed to receive tag from rank %d", src_rank);
         return -1;
     }
@@ -142,7 +190,7 @@ static int gloo_recv(Tensor* tensor, int src_rank, int tag, void* ctx) {
                   tag, recv_tag, src_rank);
         return -1;
     }
-    if (recv_all(fd, &recv_size, sizeof(recv_size)) != 0) {
+    if (peer_read(gctx, src_rank, &recv_size, sizeof(recv_size)) != 0) {
         LOG_ERROR("Gloo recv: failed to receive size from rank %d", src_rank);
         return -1;
     }
@@ -154,7 +202,7 @@ static int gloo_recv(Tensor* tensor, int src_rank, int tag, void* ctx) {
         return -1;
     }
 
-    if (recv_all(fd, tensor->data, recv_size) != 0) {
+    if (peer_read(gctx, src_rank, tensor->data, recv_size) != 0) {
         LOG_ERROR("Gloo recv: failed to receive data from rank %d", src_rank);
         return -1;
     }
@@ -163,21 +211,78 @@ static int gloo_recv(Tensor* tensor, int src_rank, int tag, void* ctx) {
     return 0;
 }
 
-/* Synchronous fallback; wraps result in a completed DistWork handle */
+static void* gloo_comm_main(void* arg) {
+    GlooContext* gctx = (GlooContext*)arg;
+    pthread_mutex_lock(&gctx->comm_lock);
+    for (;;) {
+        while (!gctx->queue_head && !gctx->comm_stop)
+            pthread_cond_wait(&gctx->comm_cond, &gctx->comm_lock);
+        GlooAsyncOp* item = gctx->queue_head;
+        if (!item)
+            break; /* Stop requested and the queue is drained */
+        gctx->queue_head = item->next;
+        if (!gctx->queue_head)
+            gctx->queue_tail = NULL;
+        pthread_mutex_unlock(&gctx->comm_lock);
+
+        int ret = gloo_allreduce(item->tensor, item->op, gctx);
+
+        pthread_mutex_lock(&gctx->comm_lock);
+        item->work->error_code = ret;
+        item->work->completed  = true;
+        pthread_cond_broadcast(&gctx->done_cond);
+    }
+    pthread_mutex_unlock(&gctx->comm_lock);
+    return NULL;
+}
+
+/* Queues the allreduce on the communication thread and returns at once */
 static DistWork* gloo_allreduce_async(Tensor* tensor, DistReduceOp op, void* ctx) {
-    DistWork* work = calloc(1, sizeof(DistWork));
+    GlooContext* gctx = get_gloo_ctx(ctx);
+    DistWork* work    = calloc(1, sizeof(DistWork));
     if (!work)
         return NULL;
 
-    work->internal = NULL;
-    work->completed = false;
-    work->error_code = 0;
+    /* Nothing to overlap without peers */
+    if (!gctx || gctx->world_size <= 1) {
+        work->error_code = gloo_allreduce(tensor, op, ctx);
+        work->completed  = true;
+        return work;
+    }
 
-    int ret = gloo_allreduce(tensor, op, ctx);
-    work->error_code = ret;
-    work->completed = true;
+    GlooAsyncOp* item = calloc(1, sizeof(GlooAsyncOp));
+    if (!item) {
+        free(work);
+        return NULL;
+    }
+    item->tensor   = tensor;
+    item->op       = op;
+    item->work     = work;
+    work->internal = item;
+
+    pthread_mutex_lock(&gctx->comm_lock);
+    if (!gctx->comm_running) {
+        gctx->comm_stop = false;
+        if (pthread_create(&gctx->comm_thread, NULL, gloo_comm_main, gctx) != 0) {
+            pthread_mutex_unlock(&gctx->comm_lock);
+            LOG_WARNING("Gloo: failed to start communication thread, running synchronously");
+            work->internal   = NULL;
+            free(item);
+            work->error_code = gloo_allreduce(tensor, op, ctx);
+            work->completed  = true;
+            return work;
+        }
+        gctx->comm_running = true;
+    }
+    if (gctx->queue_tail)
+        gctx->queue_tail->next = item;
+    else
+        gctx->queue_head = item;
+    gctx->queue_tail = item;
+    pthread_cond_signal(&gctx->comm_cond);
+    pthread_mutex_unlock(&gctx->comm_lock);
 
-    LOG_DEBUG("Gloo allreduce_async completed synchronously (error=%d)", ret);
+    LOG_DEBUG("Gloo allreduce_async queued (numel: %zu)", tensor ? tensor->numel : 0);
     return work;
 }
 
@@ -185,15 +290,36 @@ static int gloo_wait(DistWork* work) {
     if (!work)
         return -1;
 
-    if (work->completed)
-        return work->error_code;
+    GlooContext* gctx = g_gloo_ctx;
+    if (!work->internal || !gctx)
+        return work->completed ? work->error_code : -1;
+
+    pthread_mutex_lock(&gctx->comm_lock);
+    while (!work->completed)
+        pthread_cond_wait(&gctx->done_cond, &gctx->comm_lock);
+    int ret = work->error_code;
+    pthread_mutex_unlock(&gctx->comm_lock);
+    return ret;
+}
 
-    LOG_ERROR("Gloo wait: work not completed (should not happen)");
-    return -1;
+/* Blocking allreduce; goes through the queue while async work is in flight
+ * so the two never interleave on the sockets. */
+static int gloo_allreduce_op(Tensor* tensor, DistReduceOp op, void* ctx) {
+    GlooContext* gctx = get_gloo_ctx(ctx);
+    if (gctx && gctx->comm_running && !pthread_equal(pthread_self(), gctx->comm_thread)) {
+        DistWork* work = gloo_allreduce_async(tensor, op, ctx);
+        if (!work)
+            return -1;
+        int ret = gloo_wait(work);
+        free(work->internal);
+        free(work);
+        return ret;
+    }
+    return gloo_allreduce(tensor, op, ctx);
 }
 
 static int gloo_allreduce(Tensor* tensor, DistReduceOp op, void* ctx) {
-    (void)ctx;
+    GlooContext* gctx = get_gloo_ctx(ctx);
     if (!tensor || !tensor->data)
         return -1;
 
@@ -210,10 +336,18 @@ static int gloo_allreduce(Tensor* tensor, DistReduceOp op, void* ctx) {
         return 0;
     }
 
-    /* For multi-process: use ring all-reduce algorithm */
-    int ret = cml_ring_allreduce((float*)tensor->data, tensor->numel,
-                                  group->world_size, group->rank,
-                                  op, group->ops, group->backend_ctx);
+    /* Hosts with several ranks reduce through shared memory first, so only
+     * one rank per host takes part in the TCP ring */
+    int ret;
+    if (gctx && gctx->hierarchical) {
+        ret = cml_hierarchical_allreduce(
+            (float*)tensor->data, tensor->numel, gctx->local_ranks, gctx->local_size,
+            gctx->local_index[gctx->rank], gctx->node_leaders, gctx->num_nodes,
+            gctx->node_index, group->world_size, op, group->ops, group->backend_ctx);
+    } else {
+        ret = cml_ring_allreduce((float*)tensor->data, tensor->numel, group->world_size,
+                                 group->rank, op, group->ops, group->backend_ctx);
+    }
     if (ret != 0) {
         LOG_ERROR("Ring allreduce failed");
         return ret;
@@ -234,32 +368,69 @@ static int gloo_broadcast(Tensor* tensor, int src_rank, void* ctx) {
     return 0;
 }
 
+/* output[r] receives rank r's input. Like the other blocking collectives
+ * these drive the sockets directly, so no async work may be in flight. */
 static int gloo_allgather(Tensor** output, Tensor* input, void* ctx) {
-    (void)ctx;
-    if (!output || !input)
+    if (!output || !input || !input->data)
         return -1;
 
-    /* Single-process: just copy input to output[0] */
-    if (output[0] && output[0]->data && input->data) {
-        memcpy(output[0]->data, input->data, input->numel * sizeof(float));
+    DistProcessGroup* group = cml_dist_get_default_group();
+    if (!group || group->world_size <= 1) {
+        if (output[0] && output[0]->data && output[0]->data != input->data)
+            memcpy(output[0]->data, input->data, input->numel * sizeof(float));
+        return 0;
     }
 
-    return 0;
+    int W    = group->world_size;
+    size_t n = input->numel;
+    for (int r = 0; r < W; r++)
+        if (!output[r] || !output[r]->data || output[r]->numel < n)
+            return -1;
+    float* flat = malloc((n * (size_t)W ? n * (size_t)W : 1) * sizeof(float));
+    if (!flat)
+        return -1;
+    memcpy(flat + (size_t)group->rank * n, input->data, n * sizeof(float));
+    int ret = cml_ring_allgather(flat, n * (size_t)W, W, group->rank, group->ops,
+                                 ctx ? ctx : group->backend_ctx);
+    for (int r = 0; ret == 0 && r < W; r++)
+        if (output[r]->data != input->data)
+            memcpy(output[r]->data, flat + (size_t)r * n, n * sizeof(float));
+    free(flat);
+    return ret;
 }
 
+/* output receives this rank's ceil(numel / world_size) chunk of the reduced
+ * input; input is left untouched */
 static int gloo_reduce_scatter(Tensor* output, Tensor* input, DistReduceOp op, void* ctx) {
-    (void)ctx;
-    (void)op;
-    if (!output || !input)
+    if (!output || !input || !output->data || !input->data)
         return -1;
 
-    /* Single-process: copy relevant chunk */
-    if (output->data && input->data) {
+    DistProcessGroup* group = cml_dist_get_default_group();
+    if (!group || group->world_size <= 1) {
         size_t copy_size = output->numel < input->numel ? output->numel : input->numel;
         memcpy(output->data, input->data, copy_size * sizeof(float));
+        return 0;
     }
 
-    return 0;
+    int W        = group->world_size;
+    size_t n     = input->numel;
+    size_t chunk = (n + (size_t)W - 1) / (size_t)W;
+    if (output->numel < chunk)
+        return -1;
+    float* flat = malloc((n ? n : 1) * sizeof(float));
+    if (!flat)
+        return -1;
+    memcpy(flat, input->data, n * sizeof(float));
+    int ret = cml_ring_reduce_scatter(flat, n, W, group->rank, op, group->ops,
+                                      ctx ? ctx : group->backend_ctx);
+    if (ret == 0) {
+        size_t lo = (size_t)group->rank * chunk < n ? (size_t)group->rank * chunk : n;
+        size_t hi = lo + chunk < n ? lo + chunk : n;
+        memcpy(output->data, flat + lo, (hi - lo) * sizeof(float));
+        memset((float*)output->data + (hi - lo), 0, (output->numel - (hi - lo)) * sizeof(float));
+    }
+    free(flat);
+    return ret;
 }
 
 static int gloo_barrier(void* ctx) {
@@ -268,6 +439,134 @@ static int gloo_barrier(void* ctx) {
     return 0;
 }
 
+static void gloo_free_topology(GlooContext* gctx) {
+    cml_shm_free(gctx->shm);
+    gctx->shm = NULL;
+    free(gctx->local_index);
+    free(gctx->local_ranks);
+    free(gctx->node_leaders);
+    gctx->local_index  = NULL;
+    gctx->local_ranks  = NULL;
+    gctx->node_leaders = NULL;
+    gctx->local_size   = 1;
+    gctx->num_nodes    = 1;
+    gctx->hierarchical = false;
+}
+
+/* Groups ranks by hostname (CML_HOSTNAME overrides gethostname) */
+static int gloo_discover_topology(GlooContext* gctx, char (*hosts)[GLOO_HOSTNAME_LEN]) {
+    int W = gctx->world_size;
+    const char* host_env = getenv("CML_HOSTNAME");
+    char* mine = hosts[gctx->rank];
+    memset(mine, 0, GLOO_HOSTNAME_LEN);
+    if (host_env && host_env[0])
+        strncpy(mine, host_env, GLOO_HOSTNAME_LEN - 1);
+    else if (gethostname(mine, GLOO_HOSTNAME_LEN - 1) != 0)
+        snprintf(mine, GLOO_HOSTNAME_LEN, "rank-%d", gctx->rank);
+
+    /* Hostnames are tiny, so every send fits the socket buffer before any
+     * rank starts receiving */
+    for (int peer = 0; peer < W; peer++)
+        if (peer != gctx->rank && send_all(gctx->peer_fds[peer], mine, GLOO_HOSTNAME_LEN) != 0)
+            return -1;
+    for (int peer = 0; peer < W; peer++)
+        if (peer != gctx->rank && recv_all(gctx->peer_fds[peer], hosts[peer], GLOO_HOSTNAME_LEN) != 0)
+            return -1;
+
+    gctx->local_index  = malloc((size_t)W * sizeof(int));
+    gctx->local_ranks  = malloc((size_t)W * sizeof(int));
+    gctx->node_leaders = malloc((size_t)W * sizeof(int));
+    if (!gctx->local_index || !gctx->local_ranks || !gctx->node_leaders)
+        return -1;
+
+    gctx->local_size = 0;
+    gctx->num_nodes  = 0;
+    for (int r = 0; r < W; r++) {
+        bool new_node = true;
+        for (int q = 0; q < r && new_node; q++)
+            new_node = strcmp(hosts[q], hosts[r]) != 0;
+        if (new_node) {
+            if (strcmp(hosts[r], mine) == 0)
+                gctx->node_index = gctx->num_nodes;
+            gctx->node_leaders[gctx->num_nodes++] = r;
+        }
+        if (strcmp(hosts[r], mine) == 0) {
+            gctx->local_index[r] = gctx->local_size;
+            gctx->local_ranks[gctx->local_size++] = r;
+        } else {
+            gctx->local_index[r] = -1;
+        }
+    }
+
+    /* Worth it only when some host has several ranks and there are several
+     * hosts; every rank sees the same names, so all agree on the algorithm
+     * even if one host later falls back to TCP. */
+    const char* enable = getenv("CML_SHM_TRANSPORT");
+    gctx->hierarchical = !(enable && strcmp(enable, "0") == 0) && gctx->num_nodes > 1 &&
+                         gctx->num_nodes < W;
+    return 0;
+}
+
+/* The host's lowest rank creates the segment and hands its name to the
+ * others over TCP; everyone reports back and the leader announces whether
+ * all attached, so the host either uses shared memory or stays on TCP
+ * as a whole. */
+static void gloo_setup_shm(GlooContext* gctx) {
+    const char* enable = getenv("CML_SHM_TRANSPORT");
+    if (enable && strcmp(enable, "0") == 0)
+        return;
+    if (gctx->local_size < 2)
+        return;
+
+    int me = gctx->local_index[gctx->rank];
+    size_t ring_bytes = 0;
+    const char* ring_env = getenv("CML_SHM_RING_BYTES");
+    if (ring_env && atoll(ring_env) > 0)
+        ring_bytes = (size_t)atoll(ring_env);
+
+    char name[64] = {0};
+    CMLShmTransport* shm = NULL;
+    int all_ok = 1;
+    if (me == 0) {
+        snprintf(name, sizeof(name), "/cml-gloo-%d-%d", (int)getpid(), gctx->port_base);
+        shm = cml_shm_open(name, 0, gctx->local_size, ring_bytes);
+        if (!shm)
+            name[0] = '\0';
+        for (int i = 1; i < gctx->local_size; i++)
+            if (send_all(gctx->peer_fds[gctx->local_ranks[i]], name, sizeof(name)) != 0)
+                all_ok = 0;
+        for (int i = 1; i < gctx->local_size; i++) {
+            int ok = 0;
+            if (recv_all(gctx->peer_fds[gctx->local_ranks[i]], &ok, sizeof(ok)) != 0 || !ok)
+                all_ok = 0;
+        }
+        all_ok = all_ok && shm;
+        cml_shm_unlink(shm);
+        for (int i = 1; i < gctx->local_size; i++)
+            send_all(gctx->peer_fds[gctx->local_ranks[i]], &all_ok, sizeof(all_ok));
+    } else {
+        int leader = gctx->local_ranks[0];
+        int ok = 0;
+        if (recv_all(gctx->peer_fds[leader], name, sizeof(name)) == 0 && name[0]) {
+            name[sizeof(name) - 1] = '\0';
+            shm = cml_shm_open(name, me, gctx->local_size, ring_bytes);
+            ok = shm != NULL;
+        }
+        if (send_all(gctx->peer_fds[leader], &ok, sizeof(ok)) != 0 ||
+            recv_all(gctx->peer_fds[leader], &all_ok, sizeof(all_ok)) != 0)
+            all_ok = 0;
+    }
+
+    if (!all_ok) {
+        LOG_WARNING("Gloo: shared-memory transport unavailable, using TCP between local ranks");
+        cml_shm_free(shm);
+        return;
+    }
+    gctx->shm = shm;
+    LOG_INFO("Gloo rank %d: shared memory with %d local ranks (%d nodes)", gctx->rank,
+             gctx->local_size, gctx->num_nodes);
+}
+
 static int gloo_init(void* ctx, int world_size, int rank) {
     (void)ctx;
 
@@ -435,6 +734,18 @@ static int gloo_init(void* ctx, int world_size, int rank) {
         LOG_DEBUG("Gloo rank %d accepted connection from rank %d", rank, peer_rank);
     }
 
+    {
+        char (*hosts)[GLOO_HOSTNAME_LEN] = calloc((size_t)world_size, GLOO_HOSTNAME_LEN);
+        int ret = hosts ? gloo_discover_topology(gctx, hosts) : -1;
+        free(hosts);
+        if (ret != 0) {
+            LOG_ERROR("Gloo init: failed to exchange host names");
+            gloo_free_topology(gctx);
+            goto cleanup_error;
+        }
+    }
+    gloo_setup_shm(gctx);
+
     LOG_INFO("Gloo backend initialized (rank %d/%d, port_base=%d, addr=%s)",
              rank, world_size, gctx->port_base, gctx->master_addr);
     return 0;
@@ -463,6 +774,20 @@ static void gloo_destroy(void* ctx) {
         return;
     }
 
+    if (gctx->comm_running) {
+        pthread_mutex_lock(&gctx->comm_lock);
+        gctx->comm_stop = true;
+        pthread_cond_signal(&gctx->comm_cond);
+        pthread_mutex_unlock(&gctx->comm_lock);
+        pthread_join(gctx->comm_thread, NULL);
+        gctx->comm_running = false;
+    }
+    cml_ring_release(gctx);
+    pthread_mutex_destroy(&gctx->comm_lock);
+    pthread_cond_destroy(&gctx->comm_cond);
+    pthread_cond_destroy(&gctx->done_cond);
+    gloo_free_topology(gctx);
+
     if (gctx->peer_fds) {
         for (int i = 0; i < gctx->world_size; i++) {
             if (gctx->peer_fds[i] >= 0)
@@ -482,6 +807,10 @@ static void gloo_destroy(void* ctx) {
     LOG_INFO("Gloo backend destroyed");
 }
 
+int cml_dist_gloo_local_size(void) {
+    return g_gloo_ctx && g_gloo_ctx->shm ? g_gloo_ctx->local_size : 1;
+}
+
 DistCommOps* cml_dist_create_gloo_backend(void) {
     DistCommOps* ops = calloc(1, sizeof(DistCommOps));
     if (!ops)
@@ -494,9 +823,14 @@ DistCommOps* cml_dist_create_gloo_backend(void) {
     }
     gctx->listen_fd = -1;
     gctx->peer_fds = NULL;
+    gctx->local_size = 1;
+    gctx->num_nodes = 1;
+    pthread_mutex_init(&gctx->comm_lock, NULL);
+    pthread_cond_init(&gctx->comm_cond, NULL);
+    pthread_cond_init(&gctx->done_cond, NULL);
     g_gloo_ctx = gctx;
 
-    ops->allreduce = gloo_allreduce;
+    ops->allreduce = gloo_allreduce_op;
     ops->broadcast = gloo_broadcast;
     ops->allgather = gloo_allgather;
     ops->reduce_scatter = gloo_reduce_scatter;
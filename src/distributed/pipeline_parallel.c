@@ -1,9 +1,29 @@
 #include "distributed/pipeline_parallel.h"
 #include "distributed/distributed.h"
 #include "autograd/autograd.h"
+#include "autograd/forward_ops.h"
+#include "ops/ir/ir.h"
 #include "core/logging.h"
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#define PIPELINE_MAX_DIMS 8
+#define PIPELINE_HEADER_INTS (4 + PIPELINE_MAX_DIMS)
+#define PIPELINE_TAG_HEADER 0
+#define PIPELINE_TAG_DATA 1
+
+static int pipeline_resolve_workers(const PipelineConfig* config, int num_stages,
+                                    const DistProcessGroup* group) {
+    if (config->num_workers > 0)
+        return config->num_workers;
+    if (group && group->initialized && group->world_size > 1)
+        return group->world_size;
+    if (config->schedule == PIPELINE_SCHEDULE_INTERLEAVED && num_stages % 2 == 0)
+        return num_stages / 2;
+    return num_stages;
+}
 
 CMLPipelineParallel* cml_pipeline_create(PipelineStage* stages, int num_stages,
                                           const PipelineConfig* config) {
@@ -12,8 +32,39 @@ CMLPipelineParallel* cml_pipeline_create(PipelineStage* stages, int num_stages,
         return NULL;
     }
 
+    PipelineConfig cfg = {.num_micro_batches = 4, .num_stages = num_stages,
+                          .schedule = PIPELINE_SCHEDULE_1F1B};
+    if (config)
+        cfg = *config;
+    if (cfg.interleaved)
+        cfg.schedule = PIPELINE_SCHEDULE_INTERLEAVED;
+
+    DistProcessGroup* group = cml_dist_get_default_group();
+    int num_workers = pipeline_resolve_workers(&cfg, num_stages, group);
+    if (num_workers <= 0 || num_stages % num_workers != 0 ||
+        (cfg.schedule != PIPELINE_SCHEDULE_INTERLEAVED && num_workers != num_stages)) {
+        LOG_ERROR("Pipeline: %d stages cannot run on %d workers with this schedule",
+                  num_stages, num_workers);
+        return NULL;
+    }
+    if (num_workers < num_stages && cfg.num_micro_batches % num_workers != 0) {
+        LOG_ERROR("Pipeline: interleaving needs micro-batches (%d) divisible by workers (%d)",
+                  cfg.num_micro_batches, num_workers);
+        return NULL;
+    }
+
+    int worker = -1;
+    if (group && group->initialized && group->world_size > 1) {
+        if (group->world_size != num_workers) {
+            LOG_ERROR("Pipeline: %d workers on a group of %d ranks", num_workers,
+                      group->world_size);
+            return NULL;
+        }
+        worker = group->rank;
+    }
+
     for (int i = 0; i < num_stages; i++) {
-        if (!stages[i].module) {
+        if (!stages[i].module && (worker < 0 || i % num_workers == worker)) {
             LOG_ERROR("Pipeline stage %d has NULL module", i);
             return NULL;
         }
@@ -31,16 +82,12 @@ CMLPipelineParallel* cml_pipeline_create(PipelineStage* stages, int num_stages,
     }
     memcpy(pipeline->stages, stages, num_stages * sizeof(PipelineStage));
 
-    if (config) {
-        pipeline->config = *config;
-    } else {
-        pipeline->config.num_micro_batches = 4;
-        pipeline->config.num_stages = num_stages;
-        pipeline->config.interleaved = false;
-    }
-
-    pipeline->num_micro_batches = pipeline->config.num_micro_batches;
-    pipeline->group = cml_dist_get_default_group();
+    pipeline->config = cfg;
+    pipeline->num_micro_batches = cfg.num_micro_batches;
+    pipeline->group = group;
+    pipeline->schedule = cfg.schedule;
+    pipeline->num_workers = num_workers;
+    pipeline->worker = worker;
 
     /* Allocate micro-batch output buffers: [num_stages][num_micro_batches] */
     pipeline->micro_batch_outputs = calloc(num_stages, sizeof(Tensor**));
@@ -62,8 +109,8 @@ CMLPipelineParallel* cml_pipeline_create(PipelineStage* stages, int num_stages,
         }
     }
 
-    LOG_INFO("Pipeline created: %d stages, %d micro-batches",
-             num_stages, pipeline->num_micro_batches);
+    LOG_INFO("Pipeline created: %d stages on %d workers, %d micro-batches",
+             num_stages, num_workers, pipeline->num_micro_batches);
     return pipeline;
 }
 
@@ -303,6 +350,656 @@ int cml_pipeline_backward(CMLPipelineParallel* pipeline, Tensor* grad_output) {
     return 0;
 }
 
+/* ── Scheduled training ─────────────────────────────────────────────────
+ *
+ * Stages exchange detached tensors: a stage's input is a fresh leaf built
+ * from the previous stage's output, so every (stage, micro-batch) forward
+ * gets its own IR graph. Graphs use private buffers because several of the
+ * same shape are alive at once, and each is freed by its backward, which
+ * also sends the input's gradient upstream.
+ */
+
+/* k-th forward or backward op of a worker. With v chunks per worker, the
+ * worker cycles through its chunks every num_workers micro-batches. */
+static PipelineOp schedule_op(PipelineOpType type, int k, int num_workers, int chunks,
+                              int worker) {
+    int group = num_workers * chunks;
+    int chunk = (k % group) / num_workers;
+    if (type == PIPELINE_OP_BACKWARD)
+        chunk = chunks - 1 - chunk;
+    PipelineOp op = {type, chunk * num_workers + worker, (k / group) * num_workers + k % num_workers};
+    return op;
+}
+
+int cml_pipeline_build_schedule(PipelineSchedule schedule, int num_stages, int num_workers,
+                                int num_micro_batches, int worker, PipelineOp* ops,
+                                int max_ops) {
+    int P = num_workers, M = num_micro_batches;
+    if (!ops || P <= 0 || M <= 0 || num_stages <= 0 || num_stages % P != 0 || worker < 0 ||
+        worker >= P)
+        return -1;
+    int v = num_stages / P;
+    if ((schedule != PIPELINE_SCHEDULE_INTERLEAVED && v != 1) || (v > 1 && M % P != 0))
+        return -1;
+    int total = M * v;
+    if (2 * total > max_ops)
+        return -1;
+
+    int n = 0;
+    if (schedule == PIPELINE_SCHEDULE_GPIPE) {
+        for (int k = 0; k < total; k++)
+            ops[n++] = schedule_op(PIPELINE_OP_FORWARD, k, P, v, worker);
+        for (int k = 0; k < total; k++)
+            ops[n++] = schedule_op(PIPELINE_OP_BACKWARD, k, P, v, worker);
+        return n;
+    }
+
+    /* Warm-up forwards fill the pipeline down to this worker; the last
+     * worker starts alternating at once. Interleaving needs an extra round
+     * of chunks in flight (and runs all-forward when M == P). */
+    int warmup = P - worker - 1;
+    if (v > 1)
+        warmup = M == P ? total : warmup * 2 + (v - 1) * P;
+    if (warmup > total)
+        warmup = total;
+
+    int f = 0, b = 0;
+    while (f < warmup)
+        ops[n++] = schedule_op(PIPELINE_OP_FORWARD, f++, P, v, worker);
+    while (f < total) {
+        ops[n++] = schedule_op(PIPELINE_OP_FORWARD, f++, P, v, worker);
+        ops[n++] = schedule_op(PIPELINE_OP_BACKWARD, b++, P, v, worker);
+    }
+    while (b < total)
+        ops[n++] = schedule_op(PIPELINE_OP_BACKWARD, b++, P, v, worker);
+    return n;
+}
+
+typedef struct {
+    bool ready;
+    int ndim;
+    int shape[PIPELINE_MAX_DIMS];
+    size_t numel;
+    float* data;
+} PipelineMsg;
+
+typedef struct PipelineSend {
+    int dst;
+    int header[PIPELINE_HEADER_INTS]; /* type, stage, micro-batch, ndim, shape */
+    float* data;
+    size_t numel;
+    struct PipelineSend* next;
+} PipelineSend;
+
+typedef struct {
+    CMLGraph_t graph;
+    Tensor* input;    /* Received activation; its gradient goes upstream */
+    Tensor* root;     /* Backward starts here: the output, or the scaled loss */
+    Tensor* extra[3]; /* Output, loss and scale behind the last stage's root */
+} PipelineSlot;
+
+typedef struct {
+    CMLPipelineParallel* pipeline;
+    int num_mb;
+    PipelineLossFn loss_fn;
+    void* loss_ctx;
+    Tensor** input_slices;
+    Tensor** target_slices;
+
+    /* Indexed by stage * num_mb + micro_batch */
+    PipelineMsg* acts;  /* Input of the stage */
+    PipelineMsg* grads; /* Gradient of the stage's output */
+    PipelineSlot* slots;
+    double* finish_ms;  /* Timeline, [2 * index + op type] */
+
+    double loss_sum;
+    int* in_flight;     /* Per worker */
+    int peak_in_flight;
+    double* lane_ms;    /* Timeline position per worker */
+    double* busy_ms;    /* Compute per worker */
+
+    /* Rank-per-worker transport */
+    DistCommOps* ops;
+    void* ctx;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    PipelineSend* send_head;
+    PipelineSend* send_tail;
+    bool send_closed;
+    int error;
+} PipelineRun;
+
+typedef struct {
+    PipelineRun* run;
+    int peer;
+    int expected;
+} PipelineReceiver;
+
+static double pipeline_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static int pipe_xfer(PipelineRun* run, void* buf, size_t numel, int peer, int tag, bool is_send) {
+    int shape[1] = {(int)numel};
+    Tensor t     = {0};
+    t.data       = buf;
+    t.numel      = numel;
+    t.ndim       = 1;
+    t.shape      = shape;
+    t.dtype      = DTYPE_FLOAT32;
+    return is_send ? run->ops->send(&t, peer, tag, run->ctx)
+                   : run->ops->recv(&t, peer, tag, run->ctx);
+}
+
+static void run_fail(PipelineRun* run) {
+    pthread_mutex_lock(&run->lock);
+    run->error = -1;
+    pthread_cond_broadcast(&run->cond);
+    pthread_mutex_unlock(&run->lock);
+}
+
+static void* pipeline_sender(void* arg) {
+    PipelineRun* run = (PipelineRun*)arg;
+    for (;;) {
+        pthread_mutex_lock(&run->lock);
+        while (!run->send_head && !run->send_closed && !run->error)
+            pthread_cond_wait(&run->cond, &run->lock);
+        PipelineSend* msg = run->error ? NULL : run->send_head;
+        if (msg) {
+            run->send_head = msg->next;
+            if (!run->send_head)
+                run->send_tail = NULL;
+        }
+        pthread_mutex_unlock(&run->lock);
+        if (!msg)
+            return NULL;
+
+        int ret = pipe_xfer(run, msg->header, PIPELINE_HEADER_INTS, msg->dst,
+                            PIPELINE_TAG_HEADER, true);
+        if (ret == 0 && msg->numel > 0)
+            ret = pipe_xfer(run, msg->data, msg->numel, msg->dst, PIPELINE_TAG_DATA, true);
+        int dst = msg->dst;
+        free(msg->data);
+        free(msg);
+        if (ret != 0) {
+            LOG_ERROR("Pipeline: send to rank %d failed", dst);
+            run_fail(run);
+            return NULL;
+        }
+    }
+}
+
+static void* pipeline_receiver(void* arg) {
+    PipelineReceiver* rcv = (PipelineReceiver*)arg;
+    PipelineRun* run      = rcv->run;
+    int num_stages        = run->pipeline->num_stages;
+    for (int i = 0; i < rcv->expected; i++) {
+        int header[PIPELINE_HEADER_INTS];
+        if (pipe_xfer(run, header, PIPELINE_HEADER_INTS, rcv->peer, PIPELINE_TAG_HEADER,
+                      false) != 0) {
+            LOG_ERROR("Pipeline: receive from rank %d failed", rcv->peer);
+            run_fail(run);
+            return NULL;
+        }
+        int type = header[0], stage = header[1], mb = header[2], ndim = header[3];
+        if (stage < 0 || stage >= num_stages || mb < 0 || mb >= run->num_mb || ndim < 0 ||
+            ndim > PIPELINE_MAX_DIMS) {
+            LOG_ERROR("Pipeline: malformed message from rank %d", rcv->peer);
+            run_fail(run);
+            return NULL;
+        }
+
+        PipelineMsg msg = {.ready = true, .ndim = ndim, .numel = 1};
+        for (int d = 0; d < ndim; d++) {
+            msg.shape[d] = header[4 + d];
+            msg.numel *= (size_t)msg.shape[d];
+        }
+        msg.data = malloc((msg.numel ? msg.numel : 1) * sizeof(float));
+        if (!msg.data || (msg.numel > 0 && pipe_xfer(run, msg.data, msg.numel, rcv->peer,
+                                                     PIPELINE_TAG_DATA, false) != 0)) {
+            free(msg.data);
+            run_fail(run);
+            return NULL;
+        }
+
+        pthread_mutex_lock(&run->lock);
+        PipelineMsg* box = type == PIPELINE_OP_FORWARD ? run->acts : run->grads;
+        box[stage * run->num_mb + mb] = msg;
+        pthread_cond_broadcast(&run->cond);
+        pthread_mutex_unlock(&run->lock);
+    }
+    return NULL;
+}
+
+/* Hands a copy of t to the worker running stage (as its input when type is
+ * FORWARD, as its output gradient when BACKWARD) */
+static int run_post(PipelineRun* run, PipelineOpType type, int stage, int mb, Tensor* t) {
+    if (!t || t->ndim > PIPELINE_MAX_DIMS || tensor_ensure_executed(t) != 0)
+        return -1;
+    const float* src = (const float*)tensor_data_ptr(t);
+    float* copy      = malloc((t->numel ? t->numel : 1) * sizeof(float));
+    if (!copy || (!src && t->numel > 0)) {
+        free(copy);
+        return -1;
+    }
+    memcpy(copy, src, t->numel * sizeof(float));
+
+    if (run->pipeline->worker < 0) {
+        PipelineMsg msg = {.ready = true, .ndim = t->ndim, .numel = t->numel, .data = copy};
+        memcpy(msg.shape, t->shape, (size_t)t->ndim * sizeof(int));
+        PipelineMsg* box = type == PIPELINE_OP_FORWARD ? run->acts : run->grads;
+        box[stage * run->num_mb + mb] = msg;
+        return 0;
+    }
+
+    PipelineSend* send = calloc(1, sizeof(PipelineSend));
+    if (!send) {
+        free(copy);
+        return -1;
+    }
+    send->dst       = stage % run->pipeline->num_workers;
+    send->header[0] = (int)type;
+    send->header[1] = stage;
+    send->header[2] = mb;
+    send->header[3] = t->ndim;
+    memcpy(send->header + 4, t->shape, (size_t)t->ndim * sizeof(int));
+    send->data  = copy;
+    send->numel = t->numel;
+
+    pthread_mutex_lock(&run->lock);
+    if (run->send_tail)
+        run->send_tail->next = send;
+    else
+        run->send_head = send;
+    run->send_tail = send;
+    pthread_cond_broadcast(&run->cond);
+    pthread_mutex_unlock(&run->lock);
+    return 0;
+}
+
+/* Waits for a message and turns it into a tensor */
+static Tensor* run_take(PipelineRun* run, PipelineOpType type, int stage, int mb,
+                        bool requires_grad) {
+    PipelineMsg* box = (type == PIPELINE_OP_FORWARD ? run->acts : run->grads) +
+                       stage * run->num_mb + mb;
+    pthread_mutex_lock(&run->lock);
+    while (!box->ready && !run->error)
+        pthread_cond_wait(&run->cond, &run->lock);
+    PipelineMsg msg = *box;
+    memset(box, 0, sizeof(*box));
+    pthread_mutex_unlock(&run->lock);
+    if (!msg.ready)
+        return NULL;
+
+    TensorConfig cfg = {.dtype = DTYPE_FLOAT32, .device = DEVICE_CPU,
+                        .has_dtype = true, .has_device = true};
+    Tensor* t = tensor_from_data(msg.data, msg.shape, msg.ndim, &cfg);
+    free(msg.data);
+    if (t)
+        t->requires_grad = requires_grad;
+    return t;
+}
+
+static bool op_ready(PipelineRun* run, const PipelineOp* op) {
+    int idx = op->stage * run->num_mb + op->micro_batch;
+    if (op->type == PIPELINE_OP_FORWARD)
+        return op->stage == 0 || run->acts[idx].ready;
+    return op->stage == run->pipeline->num_stages - 1 || run->grads[idx].ready;
+}
+
+static void slot_release(PipelineSlot* slot) {
+    for (int i = 0; i < 3; i++)
+        if (slot->extra[i] && slot->extra[i] != slot->root)
+            tensor_free(slot->extra[i]);
+    if (slot->root)
+        tensor_free(slot->root);
+    if (slot->graph)
+        cml_ir_free(slot->graph);
+    if (slot->input)
+        tensor_free(slot->input);
+    memset(slot, 0, sizeof(*slot));
+}
+
+static int run_forward(PipelineRun* run, int stage, int mb) {
+    CMLPipelineParallel* pipeline = run->pipeline;
+    bool last          = stage == pipeline->num_stages - 1;
+    PipelineSlot* slot = &run->slots[stage * run->num_mb + mb];
+
+    Tensor* in = stage == 0 ? run->input_slices[mb]
+                            : run_take(run, PIPELINE_OP_FORWARD, stage, mb, true);
+    if (!in)
+        return -1;
+    if (stage > 0)
+        slot->input = in;
+
+    CMLGraph_t prev = cml_ir_get_or_create_context();
+    slot->graph     = cml_ir_new(IR_TARGET_C);
+    if (!slot->graph)
+        return -1;
+    cml_ir_set_private_buffers(slot->graph, true);
+    cml_ir_set_eager_free(slot->graph, true);
+    cml_ir_set_global_context(slot->graph);
+
+    int ret     = -1;
+    Tensor* out = module_forward(pipeline->stages[stage].module, in);
+    if (out && !last) {
+        slot->root = out;
+        ret        = run_post(run, PIPELINE_OP_FORWARD, stage + 1, mb, out);
+    } else if (out) {
+        slot->extra[0] = out;
+        Tensor* loss   = run->loss_fn(out, run->target_slices[mb], run->loss_ctx);
+        slot->extra[1] = loss;
+        if (loss && tensor_ensure_executed(loss) == 0) {
+            run->loss_sum += (double)tensor_get_float(loss, 0);
+            /* Seeding backward with 1 / M: the step's loss is the mean */
+            float* scale_data = malloc(loss->numel * sizeof(float));
+            TensorConfig cfg  = {.dtype = DTYPE_FLOAT32, .device = DEVICE_CPU,
+                                 .has_dtype = true, .has_device = true};
+            for (size_t i = 0; scale_data && i < loss->numel; i++)
+                scale_data[i] = 1.0f / (float)run->num_mb;
+            Tensor* scale = scale_data ? tensor_from_data(scale_data, loss->shape, loss->ndim, &cfg)
+                                       : NULL;
+            free(scale_data);
+            slot->extra[2] = scale;
+            slot->root     = scale ? tensor_mul(loss, scale) : NULL;
+            ret = slot->root && tensor_ensure_executed(slot->root) == 0 ? 0 : -1;
+        }
+    }
+    cml_ir_set_global_context(prev);
+    if (ret != 0)
+        LOG_ERROR("Pipeline: forward failed at stage %d, micro-batch %d", stage, mb);
+    return ret;
+}
+
+static int run_backward(PipelineRun* run, int stage, int mb) {
+    bool last          = stage == run->pipeline->num_stages - 1;
+    PipelineSlot* slot = &run->slots[stage * run->num_mb + mb];
+    if (!slot->root)
+        return -1;
+
+    Tensor* grad = last ? NULL : run_take(run, PIPELINE_OP_BACKWARD, stage, mb, false);
+    if (!last && !grad)
+        return -1;
+
+    CMLGraph_t prev = cml_ir_get_or_create_context();
+    cml_ir_set_global_context(slot->graph);
+    tensor_backward(slot->root, grad, false, false);
+    cml_ir_set_global_context(prev);
+    if (grad)
+        tensor_free(grad);
+
+    int ret = 0;
+    if (stage > 0) {
+        ret = slot->input && slot->input->grad
+                  ? run_post(run, PIPELINE_OP_BACKWARD, stage - 1, mb, slot->input->grad)
+                  : -1;
+    }
+    slot_release(slot);
+    if (ret != 0)
+        LOG_ERROR("Pipeline: backward failed at stage %d, micro-batch %d", stage, mb);
+    return ret;
+}
+
+static int run_op(PipelineRun* run, int worker, const PipelineOp* op) {
+    double start = pipeline_now_ms();
+    int ret      = op->type == PIPELINE_OP_FORWARD ? run_forward(run, op->stage, op->micro_batch)
+                                                   : run_backward(run, op->stage, op->micro_batch);
+    double took  = pipeline_now_ms() - start;
+
+    /* Timeline: an op starts once its worker is free and its input exists */
+    int idx     = op->stage * run->num_mb + op->micro_batch;
+    double dep  = 0.0;
+    if (op->type == PIPELINE_OP_FORWARD && op->stage > 0)
+        dep = run->finish_ms[2 * (idx - run->num_mb) + PIPELINE_OP_FORWARD];
+    else if (op->type == PIPELINE_OP_BACKWARD && op->stage < run->pipeline->num_stages - 1)
+        dep = run->finish_ms[2 * (idx + run->num_mb) + PIPELINE_OP_BACKWARD];
+    double begin = run->lane_ms[worker] > dep ? run->lane_ms[worker] : dep;
+    run->finish_ms[2 * idx + op->type] = begin + took;
+    run->lane_ms[worker]               = begin + took;
+    run->busy_ms[worker] += took;
+
+    run->in_flight[worker] += op->type == PIPELINE_OP_FORWARD ? 1 : -1;
+    if (run->in_flight[worker] > run->peak_in_flight)
+        run->peak_in_flight = run->in_flight[worker];
+    return ret;
+}
+
+/* Every worker in this process: one op per worker per pass, whenever its
+ * input has arrived, which is the order the workers would reach on their own */
+static int run_local(PipelineRun* run, PipelineOp** ops, const int* num_ops) {
+    int P     = run->pipeline->num_workers;
+    int* next = calloc((size_t)P, sizeof(int));
+    if (!next)
+        return -1;
+    int left = 0;
+    for (int w = 0; w < P; w++)
+        left += num_ops[w];
+
+    int ret = 0;
+    while (left > 0 && ret == 0) {
+        bool progress = false;
+        for (int w = 0; w < P && ret == 0; w++) {
+            if (next[w] < num_ops[w] && op_ready(run, &ops[w][next[w]])) {
+                ret = run_op(run, w, &ops[w][next[w]++]);
+                progress = true;
+                left--;
+            }
+        }
+        if (!progress) {
+            LOG_ERROR("Pipeline: schedule stalled");
+            ret = -1;
+        }
+    }
+    free(next);
+    return ret;
+}
+
+/* This rank's worker: a sender thread drains outgoing tensors and one
+ * receiver per neighbouring rank files incoming ones, so compute only
+ * ever waits for data it actually needs. */
+static int run_distributed(PipelineRun* run, const PipelineOp* ops, int num_ops) {
+    CMLPipelineParallel* pipeline = run->pipeline;
+    int P = pipeline->num_workers, S = pipeline->num_stages, me = pipeline->worker;
+    DistProcessGroup* group = pipeline->group;
+    if (!group || !group->ops || !group->ops->send || !group->ops->recv)
+        return -1;
+    run->ops = group->ops;
+    run->ctx = group->backend_ctx;
+
+    PipelineReceiver rcv[2] = {{run, (me - 1 + P) % P, 0}, {run, (me + 1) % P, 0}};
+    for (int i = 0; i < num_ops; i++) {
+        const PipelineOp* op = &ops[i];
+        if (op->type == PIPELINE_OP_FORWARD && op->stage > 0)
+            rcv[(op->stage - 1) % P == rcv[0].peer ? 0 : 1].expected++;
+        else if (op->type == PIPELINE_OP_BACKWARD && op->stage < S - 1)
+            rcv[(op->stage + 1) % P == rcv[0].peer ? 0 : 1].expected++;
+    }
+    if (rcv[0].peer == rcv[1].peer) {
+        rcv[0].expected += rcv[1].expected;
+        rcv[1].expected = 0;
+    }
+
+    pthread_t sender, receivers[2];
+    bool have_sender = pthread_create(&sender, NULL, pipeline_sender, run) == 0;
+    bool have_rcv[2] = {false, false};
+    for (int i = 0; i < 2; i++)
+        have_rcv[i] = rcv[i].expected > 0 &&
+                      pthread_create(&receivers[i], NULL, pipeline_receiver, &rcv[i]) == 0;
+    int ret = have_sender ? 0 : -1;
+    for (int i = 0; i < 2; i++)
+        if (rcv[i].expected > 0 && !have_rcv[i])
+            ret = -1;
+    if (ret != 0)
+        run_fail(run);
+
+    for (int i = 0; ret == 0 && i < num_ops; i++)
+        ret = run_op(run, me, &ops[i]);
+    if (ret != 0)
+        run_fail(run);
+
+    pthread_mutex_lock(&run->lock);
+    run->send_closed = true;
+    pthread_cond_broadcast(&run->cond);
+    pthread_mutex_unlock(&run->lock);
+    if (have_sender)
+        pthread_join(sender, NULL);
+    for (int i = 0; i < 2; i++)
+        if (have_rcv[i])
+            pthread_join(receivers[i], NULL);
+
+    while (run->send_head) {
+        PipelineSend* next = run->send_head->next;
+        free(run->send_head->data);
+        free(run->send_head);
+        run->send_head = next;
+    }
+    return ret == 0 && !run->error ? 0 : -1;
+}
+
+static Tensor** split_micro_batches(Tensor* t, int num_mb) {
+    if (!t || t->ndim < 1 || t->shape[0] < num_mb)
+        return NULL;
+    Tensor** slices = calloc((size_t)num_mb, sizeof(Tensor*));
+    if (!slices)
+        return NULL;
+    int rows    = t->shape[0];
+    int mb_size = rows / num_mb;
+    for (int mb = 0; mb < num_mb; mb++) {
+        int start  = mb * mb_size;
+        int end    = (mb == num_mb - 1) ? rows : start + mb_size;
+        slices[mb] = slice_batch_dim(t, start, end);
+        if (!slices[mb]) {
+            for (int j = 0; j < mb; j++)
+                tensor_free(slices[j]);
+            free(slices);
+            return NULL;
+        }
+    }
+    return slices;
+}
+
+static void free_slices(Tensor** slices, int num_mb) {
+    for (int mb = 0; slices && mb < num_mb; mb++)
+        if (slices[mb])
+            tensor_free(slices[mb]);
+    free(slices);
+}
+
+int cml_pipeline_train_step(CMLPipelineParallel* pipeline, Tensor* input, Tensor* target,
+                            PipelineLossFn loss_fn, void* loss_ctx, float* loss_out) {
+    if (!pipeline || !loss_fn)
+        return -1;
+    int M = pipeline->num_micro_batches, S = pipeline->num_stages, P = pipeline->num_workers;
+    int me          = pipeline->worker;
+    bool has_first  = me < 0 || me == 0;
+    bool has_last   = me < 0 || me == (S - 1) % P;
+    if (M <= 0 || (has_first && !input) || (has_last && !target)) {
+        LOG_ERROR("Pipeline train step: missing input or target");
+        return -1;
+    }
+
+    size_t n       = (size_t)S * (size_t)M;
+    int max_ops    = 2 * M * (S / P);
+    PipelineRun run = {0};
+    run.pipeline   = pipeline;
+    run.num_mb     = M;
+    run.loss_fn    = loss_fn;
+    run.loss_ctx   = loss_ctx;
+    run.acts       = calloc(n, sizeof(PipelineMsg));
+    run.grads      = calloc(n, sizeof(PipelineMsg));
+    run.slots      = calloc(n, sizeof(PipelineSlot));
+    run.finish_ms  = calloc(2 * n, sizeof(double));
+    run.in_flight  = calloc((size_t)P, sizeof(int));
+    run.lane_ms    = calloc((size_t)P, sizeof(double));
+    run.busy_ms    = calloc((size_t)P, sizeof(double));
+    PipelineOp** ops = calloc((size_t)P, sizeof(PipelineOp*));
+    int* num_ops     = calloc((size_t)P, sizeof(int));
+    pthread_mutex_init(&run.lock, NULL);
+    pthread_cond_init(&run.cond, NULL);
+
+    int ret = run.acts && run.grads && run.slots && run.finish_ms && run.in_flight &&
+                      run.lane_ms && run.busy_ms && ops && num_ops
+                  ? 0
+                  : -1;
+    for (int w = 0; ret == 0 && w < P; w++) {
+        if (me >= 0 && w != me)
+            continue;
+        ops[w]     = malloc((size_t)max_ops * sizeof(PipelineOp));
+        num_ops[w] = ops[w] ? cml_pipeline_build_schedule(pipeline->schedule, S, P, M, w, ops[w],
+                                                          max_ops)
+                            : -1;
+        if (num_ops[w] < 0)
+            ret = -1;
+    }
+    if (ret == 0 && has_first && !(run.input_slices = split_micro_batches(input, M)))
+        ret = -1;
+    if (ret == 0 && has_last && !(run.target_slices = split_micro_batches(target, M)))
+        ret = -1;
+
+    double start = pipeline_now_ms();
+    if (ret == 0)
+        ret = me < 0 ? run_local(&run, ops, num_ops) : run_distributed(&run, ops[me], num_ops[me]);
+    double wall = pipeline_now_ms() - start;
+
+    if (ret == 0) {
+        PipelineStats* st = &pipeline->stats;
+        int chunks        = S / P;
+        if (me >= 0) {
+            st->step_ms    = wall;
+            st->compute_ms = run.busy_ms[me];
+        } else {
+            st->step_ms    = 0.0;
+            st->compute_ms = 0.0;
+            for (int w = 0; w < P; w++) {
+                if (run.lane_ms[w] > st->step_ms)
+                    st->step_ms = run.lane_ms[w];
+                st->compute_ms += run.busy_ms[w] / (double)P;
+            }
+        }
+        st->bubble_ms       = st->step_ms > st->compute_ms ? st->step_ms - st->compute_ms : 0.0;
+        st->bubble_fraction = st->step_ms > 0.0 ? st->bubble_ms / st->step_ms : 0.0;
+        st->ideal_bubble_fraction = (double)(P - 1) / (double)(chunks * M + P - 1);
+        st->peak_in_flight        = run.peak_in_flight;
+        LOG_DEBUG("Pipeline step: %.3f ms, bubble %.1f%% (ideal %.1f%%), peak in flight %d",
+                  st->step_ms, 100.0 * st->bubble_fraction, 100.0 * st->ideal_bubble_fraction,
+                  st->peak_in_flight);
+        if (loss_out && has_last)
+            *loss_out = (float)(run.loss_sum / (double)M);
+    }
+
+    for (size_t i = 0; run.slots && i < n; i++)
+        slot_release(&run.slots[i]);
+    for (size_t i = 0; i < n; i++) {
+        if (run.acts) free(run.acts[i].data);
+        if (run.grads) free(run.grads[i].data);
+    }
+    free_slices(run.input_slices, M);
+    free_slices(run.target_slices, M);
+    for (int w = 0; ops && w < P; w++)
+        free(ops[w]);
+    free(ops);
+    free(num_ops);
+    free(run.acts);
+    free(run.grads);
+    free(run.slots);
+    free(run.finish_ms);
+    free(run.in_flight);
+    free(run.lane_ms);
+    free(run.busy_ms);
+    pthread_mutex_destroy(&run.lock);
+    pthread_cond_destroy(&run.cond);
+    return ret;
+}
+
+int cml_pipeline_get_stats(const CMLPipelineParallel* pipeline, PipelineStats* stats) {
+    if (!pipeline || !stats)
+        return -1;
+    *stats = pipeline->stats;
+    return 0;
+}
+
 void cml_pipeline_free(CMLPipelineParallel* pipeline) {
     if (!pipeline) return;
 
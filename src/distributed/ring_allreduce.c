@@ -1,27 +1,475 @@
 #include "distributed/ring_allreduce.h"
 #include "tensor/tensor.h"
+#include "core/logging.h"
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define CML_RING_AVX2 1
+#endif
+
+#define RING_DEFAULT_SEGMENT     (64 * 1024) /* Floats per pipelined segment */
+#define RING_DEFAULT_SMALL_BYTES (64 * 1024) /* Below this, latency dominates */
+
+static size_t env_size(const char* name, size_t fallback) {
+    const char* v = getenv(name);
+    if (!v || !*v) return fallback;
+    long long n = atoll(v);
+    return n > 0 ? (size_t)n : fallback;
+}
+
+static size_t segment_elems(void) {
+    return env_size("CML_RING_SEGMENT", RING_DEFAULT_SEGMENT);
+}
+
+/*
+ * Per-communicator state, keyed by the ctx handed to the collectives:
+ * receive scratch and the pipelined ring's sender and receiver threads,
+ * which park between collectives instead of being created for each one.
+ * run_lock keeps one collective at a time on a communicator; everything is
+ * freed by cml_ring_release.
+ */
+struct RingState;
+
+typedef struct RingComm {
+    void* ctx;
+    struct RingComm* next;
+    pthread_mutex_t run_lock;
+
+    float* scratch;
+    size_t scratch_cap;
+
+    pthread_t threads[2]; /* Sender, receiver */
+    int num_threads;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;     /* New job, job finished or stop */
+    struct RingState* job;
+    unsigned long generation; /* Bumped per job */
+    int active;               /* Roles still working on the job */
+    bool stop;
+} RingComm;
+
+static RingComm* g_ring_comms = NULL;
+static pthread_mutex_t g_ring_comms_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Finds or creates ctx's state and takes its run lock */
+static RingComm* ring_comm_acquire(void* ctx) {
+    pthread_mutex_lock(&g_ring_comms_lock);
+    RingComm* c = g_ring_comms;
+    while (c && c->ctx != ctx)
+        c = c->next;
+    if (!c) {
+        c = calloc(1, sizeof(RingComm));
+        if (c) {
+            c->ctx = ctx;
+            pthread_mutex_init(&c->run_lock, NULL);
+            pthread_mutex_init(&c->lock, NULL);
+            pthread_cond_init(&c->cond, NULL);
+            c->next      = g_ring_comms;
+            g_ring_comms = c;
+        }
+    }
+    pthread_mutex_unlock(&g_ring_comms_lock);
+    if (c)
+        pthread_mutex_lock(&c->run_lock);
+    return c;
+}
+
+static void ring_comm_release_run(RingComm* c) {
+    pthread_mutex_unlock(&c->run_lock);
+}
+
+static float* ring_scratch(RingComm* c, size_t n) {
+    if (n > c->scratch_cap) {
+        float* p = realloc(c->scratch, n * sizeof(float));
+        if (!p) return NULL;
+        c->scratch     = p;
+        c->scratch_cap = n;
+    }
+    return c->scratch;
+}
+
+static void reduce_sum(float* dst, const float* src, size_t n) {
+    size_t i = 0;
+#ifdef CML_RING_AVX2
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_loadu_ps(src + i)));
+#endif
+    for (; i < n; i++)
+        dst[i] += src[i];
+}
+
+static void reduce_prod(float* dst, const float* src, size_t n) {
+    size_t i = 0;
+#ifdef CML_RING_AVX2
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(dst + i), _mm256_loadu_ps(src + i)));
+#endif
+    for (; i < n; i++)
+        dst[i] *= src[i];
+}
+
+static void reduce_max(float* dst, const float* src, size_t n) {
+    size_t i = 0;
+#ifdef CML_RING_AVX2
+    /* max_ps(src, dst) keeps dst when either is NaN, like the scalar branch */
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(dst + i, _mm256_max_ps(_mm256_loadu_ps(src + i), _mm256_loadu_ps(dst + i)));
+#endif
+    for (; i < n; i++)
+        if (src[i] > dst[i]) dst[i] = src[i];
+}
+
+static void reduce_min(float* dst, const float* src, size_t n) {
+    size_t i = 0;
+#ifdef CML_RING_AVX2
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(dst + i, _mm256_min_ps(_mm256_loadu_ps(src + i), _mm256_loadu_ps(dst + i)));
+#endif
+    for (; i < n; i++)
+        if (src[i] < dst[i]) dst[i] = src[i];
+}
+
 static void apply_reduce_op(float* dst, const float* src, size_t n, DistReduceOp op) {
-    for (size_t i = 0; i < n; i++) {
-        switch (op) {
-        case DIST_REDUCE_SUM:
-        case DIST_REDUCE_AVG:
-            dst[i] += src[i];
-            break;
-        case DIST_REDUCE_PRODUCT:
-            dst[i] *= src[i];
-            break;
-        case DIST_REDUCE_MAX:
-            if (src[i] > dst[i]) dst[i] = src[i];
+    switch (op) {
+    case DIST_REDUCE_SUM:
+    case DIST_REDUCE_AVG:
+        reduce_sum(dst, src, n);
+        break;
+    case DIST_REDUCE_PRODUCT:
+        reduce_prod(dst, src, n);
+        break;
+    case DIST_REDUCE_MAX:
+        reduce_max(dst, src, n);
+        break;
+    case DIST_REDUCE_MIN:
+        reduce_min(dst, src, n);
+        break;
+    }
+}
+
+/* Global rank of group member i; a NULL group is the whole world */
+static int group_rank(const int* ranks, int i) {
+    return ranks ? ranks[i] : i;
+}
+
+static int ring_xfer(DistCommOps* ops, void* ctx, float* buf, size_t n, int peer, int tag,
+                     bool is_send) {
+    int shape[1]  = {(int)n};
+    Tensor t      = {0};
+    t.data        = buf;
+    t.numel       = n;
+    t.ndim        = 1;
+    t.shape       = shape;
+    t.dtype       = DTYPE_FLOAT32;
+    return is_send ? ops->send(&t, peer, tag, ctx) : ops->recv(&t, peer, tag, ctx);
+}
+
+/* Blocking pairwise swap; the lower group index sends first so neither
+ * side can stall in send with a full socket buffer. */
+static int ring_exchange(DistCommOps* ops, void* ctx, int index, int peer_index, int peer,
+                         float* send_buf, float* recv_buf, size_t n, int tag) {
+    if (index < peer_index) {
+        if (ring_xfer(ops, ctx, send_buf, n, peer, tag, true) != 0) return -1;
+        return ring_xfer(ops, ctx, recv_buf, n, peer, tag, false);
+    }
+    if (ring_xfer(ops, ctx, recv_buf, n, peer, tag, false) != 0) return -1;
+    return ring_xfer(ops, ctx, send_buf, n, peer, tag, true);
+}
+
+/* Recursive doubling over the largest power of two; the ranks beyond it
+ * fold their data into a partner first and get the result back at the end.
+ * log2(world_size) full-vector rounds instead of 2 * (world_size - 1). */
+static int recursive_doubling(RingComm* c, float* data, size_t count, const int* ranks,
+                              int world_size, int rank, DistReduceOp op, DistCommOps* ops,
+                              void* ctx) {
+    int p2 = 1;
+    while (p2 * 2 <= world_size)
+        p2 *= 2;
+    int extra = world_size - p2;
+
+    if (rank >= p2) {
+        int partner = group_rank(ranks, rank - p2);
+        if (ring_xfer(ops, ctx, data, count, partner, 0, true) != 0) return -1;
+        return ring_xfer(ops, ctx, data, count, partner, 1, false);
+    }
+
+    float* tmp = ring_scratch(c, count);
+    if (!tmp && count > 0) return -1;
+
+    if (rank < extra) {
+        if (ring_xfer(ops, ctx, tmp, count, group_rank(ranks, rank + p2), 0, false) != 0)
+            return -1;
+        apply_reduce_op(data, tmp, count, op);
+    }
+    int tag = 2;
+    for (int mask = 1; mask < p2; mask <<= 1, tag++) {
+        int peer = rank ^ mask;
+        if (ring_exchange(ops, ctx, rank, peer, group_rank(ranks, peer), data, tmp, count, tag) != 0)
+            return -1;
+        apply_reduce_op(data, tmp, count, op);
+    }
+    if (rank < extra)
+        return ring_xfer(ops, ctx, data, count, group_rank(ranks, rank + p2), 1, true);
+    return 0;
+}
+
+/*
+ * Pipelined ring. Each chunk is cut into segments; a "unit" is one segment
+ * of one ring step, numbered through reduce-scatter then all-gather. Three
+ * roles run concurrently:
+ *   sender   - sends unit u once unit u - nseg (same segment, previous step)
+ *              has been reduced, since that is the data it forwards;
+ *   receiver - receives unit u into one of two segment buffers (all-gather
+ *              units land in place), at most two ahead of the reducer;
+ *   caller   - reduces received reduce-scatter units into data.
+ * So transfers in both directions and the reduction all overlap. Chunks are
+ * numbered so that rank r ends the reduce-scatter holding chunk r, which
+ * lets either phase also run on its own (units [first, units)).
+ */
+typedef struct RingState {
+    float* data;
+    size_t count;
+    size_t chunk;
+    size_t seg;
+    int nseg;
+    int steps; /* world_size - 1 */
+    int first;
+    int units;
+    const int* ranks; /* Group members' global ranks, or NULL for all */
+    int world_size;   /* Group size */
+    int rank;         /* Index within the group */
+    DistReduceOp op;
+    DistCommOps* ops;
+    void* ctx;
+    float* bufs[2];
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int received; /* Units fully received */
+    int consumed; /* Units reduced (or landed in place) */
+    int error;
+} RingState;
+
+/* Element range of a unit's send or receive segment */
+static void ring_unit_range(const RingState* r, int u, bool for_send, size_t* lo, size_t* n) {
+    int per_phase = r->steps * r->nseg;
+    bool gather   = u >= per_phase;
+    int step      = (u % per_phase) / r->nseg;
+    int seg       = u % r->nseg;
+    int W         = r->world_size;
+    int chunk     = gather ? (for_send ? r->rank - step : r->rank - step - 1)
+                           : (for_send ? r->rank - step - 1 : r->rank - step - 2);
+    chunk         = ((chunk % W) + W) % W;
+
+    size_t start = (size_t)chunk * r->chunk + (size_t)seg * r->seg;
+    size_t end   = (size_t)chunk * r->chunk + r->chunk;
+    if (end > r->count) end = r->count;
+    if (start > end) start = end;
+    size_t len = end - start < r->seg ? end - start : r->seg;
+    *lo        = start;
+    *n         = len;
+}
+
+static bool ring_wait(RingState* r, int* counter, int target) {
+    pthread_mutex_lock(&r->lock);
+    while (*counter < target && !r->error)
+        pthread_cond_wait(&r->cond, &r->lock);
+    bool ok = !r->error;
+    pthread_mutex_unlock(&r->lock);
+    return ok;
+}
+
+static void ring_post(RingState* r, int* counter, int value, int error) {
+    pthread_mutex_lock(&r->lock);
+    if (error)
+        r->error = error;
+    else
+        *counter = value;
+    pthread_cond_broadcast(&r->cond);
+    pthread_mutex_unlock(&r->lock);
+}
+
+static void ring_send_units(RingState* r) {
+    int right = group_rank(r->ranks, (r->rank + 1) % r->world_size);
+    for (int u = r->first; u < r->units; u++) {
+        if (u - r->nseg >= r->first && !ring_wait(r, &r->consumed, u - r->nseg + 1))
+            return;
+        size_t lo, n;
+        ring_unit_range(r, u, true, &lo, &n);
+        if (ring_xfer(r->ops, r->ctx, r->data + lo, n, right, u, true) != 0) {
+            ring_post(r, NULL, 0, -1);
+            return;
+        }
+    }
+}
+
+static void ring_recv_units(RingState* r) {
+    int left      = group_rank(r->ranks, (r->rank - 1 + r->world_size) % r->world_size);
+    int per_phase = r->steps * r->nseg;
+    for (int u = r->first; u < r->units; u++) {
+        if (!ring_wait(r, &r->consumed, u - 1))
+            return;
+        size_t lo, n;
+        ring_unit_range(r, u, false, &lo, &n);
+        float* dst = u < per_phase ? r->bufs[u & 1] : r->data + lo;
+        if (ring_xfer(r->ops, r->ctx, dst, n, left, u, false) != 0) {
+            ring_post(r, NULL, 0, -1);
+            return;
+        }
+        ring_post(r, &r->received, u + 1, 0);
+    }
+}
+
+/* Parked role thread: runs its half of each job the caller posts */
+static void ring_role_loop(RingComm* c, void (*run)(RingState*)) {
+    unsigned long seen = 0;
+    pthread_mutex_lock(&c->lock);
+    for (;;) {
+        while (!c->stop && c->generation == seen)
+            pthread_cond_wait(&c->cond, &c->lock);
+        if (c->stop)
             break;
-        case DIST_REDUCE_MIN:
-            if (src[i] < dst[i]) dst[i] = src[i];
+        seen         = c->generation;
+        RingState* r = c->job;
+        pthread_mutex_unlock(&c->lock);
+
+        run(r);
+
+        pthread_mutex_lock(&c->lock);
+        if (--c->active == 0)
+            pthread_cond_broadcast(&c->cond);
+    }
+    pthread_mutex_unlock(&c->lock);
+}
+
+static void* ring_sender_main(void* arg) {
+    ring_role_loop((RingComm*)arg, ring_send_units);
+    return NULL;
+}
+
+static void* ring_receiver_main(void* arg) {
+    ring_role_loop((RingComm*)arg, ring_recv_units);
+    return NULL;
+}
+
+static void ring_comm_stop_threads(RingComm* c) {
+    pthread_mutex_lock(&c->lock);
+    c->stop = true;
+    pthread_cond_broadcast(&c->cond);
+    pthread_mutex_unlock(&c->lock);
+    for (int i = 0; i < c->num_threads; i++)
+        pthread_join(c->threads[i], NULL);
+    c->num_threads = 0;
+    c->stop        = false;
+}
+
+static int ring_comm_start_threads(RingComm* c) {
+    void* (*mains[2])(void*) = {ring_sender_main, ring_receiver_main};
+    while (c->num_threads < 2) {
+        if (pthread_create(&c->threads[c->num_threads], NULL, mains[c->num_threads], c) != 0) {
+            ring_comm_stop_threads(c);
+            return -1;
+        }
+        c->num_threads++;
+    }
+    return 0;
+}
+
+typedef enum { RING_ALLREDUCE, RING_REDUCE_SCATTER, RING_ALLGATHER } RingPhases;
+
+static int ring_pipelined(RingComm* c, float* data, size_t count, const int* ranks,
+                          int world_size, int rank, DistReduceOp op, DistCommOps* ops, void* ctx,
+                          RingPhases phases) {
+    RingState r  = {0};
+    r.data       = data;
+    r.count      = count;
+    r.ranks      = ranks;
+    r.world_size = world_size;
+    r.rank       = rank;
+    r.op         = op;
+    r.ops        = ops;
+    r.ctx        = ctx;
+    r.steps      = world_size - 1;
+    r.chunk      = (count + (size_t)world_size - 1) / (size_t)world_size;
+    r.seg        = segment_elems();
+    if (r.seg > r.chunk) r.seg = r.chunk;
+    r.nseg  = (int)((r.chunk + r.seg - 1) / r.seg);
+    r.units = 2 * r.steps * r.nseg;
+    if (phases == RING_REDUCE_SCATTER)
+        r.units /= 2;
+    else if (phases == RING_ALLGATHER)
+        r.first = r.units / 2;
+    r.received = r.consumed = r.first;
+
+    float* scratch = ring_scratch(c, 2 * r.seg);
+    if (!scratch) return -1;
+    r.bufs[0] = scratch;
+    r.bufs[1] = scratch + r.seg;
+
+    if (ring_comm_start_threads(c) != 0) {
+        LOG_ERROR("Ring allreduce: failed to start transfer threads");
+        return -1;
+    }
+
+    pthread_mutex_init(&r.lock, NULL);
+    pthread_cond_init(&r.cond, NULL);
+
+    pthread_mutex_lock(&c->lock);
+    c->job    = &r;
+    c->active = 2;
+    c->generation++;
+    pthread_cond_broadcast(&c->cond);
+    pthread_mutex_unlock(&c->lock);
+
+    int per_phase = r.steps * r.nseg;
+    for (int u = r.first; u < r.units; u++) {
+        if (!ring_wait(&r, &r.received, u + 1))
             break;
+        if (u < per_phase) {
+            size_t lo, n;
+            ring_unit_range(&r, u, false, &lo, &n);
+            apply_reduce_op(data + lo, r.bufs[u & 1], n, op);
         }
+        ring_post(&r, &r.consumed, u + 1, 0);
     }
+
+    pthread_mutex_lock(&c->lock);
+    while (c->active > 0)
+        pthread_cond_wait(&c->cond, &c->lock);
+    c->job = NULL;
+    pthread_mutex_unlock(&c->lock);
+
+    pthread_mutex_destroy(&r.lock);
+    pthread_cond_destroy(&r.cond);
+    return r.error ? -1 : 0;
+}
+
+/* Allreduce without the final averaging, so AVG callers can compose it */
+static int group_allreduce(float* data, size_t count, const int* ranks, int n, int index,
+                           DistReduceOp op, DistCommOps* ops, void* ctx) {
+    if (n == 1)
+        return 0;
+    RingComm* c = ring_comm_acquire(ctx);
+    if (!c) return -1;
+    size_t small = env_size("CML_ALLREDUCE_SMALL_BYTES", RING_DEFAULT_SMALL_BYTES);
+    int ret      = (count * sizeof(float) <= small || count < (size_t)n)
+                       ? recursive_doubling(c, data, count, ranks, n, index, op, ops, ctx)
+                       : ring_pipelined(c, data, count, ranks, n, index, op, ops, ctx,
+                                        RING_ALLREDUCE);
+    ring_comm_release_run(c);
+    return ret;
+}
+
+static void scale_avg(float* data, size_t count, DistReduceOp op, int world_size) {
+    if (op != DIST_REDUCE_AVG)
+        return;
+    float scale = 1.0f / (float)world_size;
+    for (size_t i = 0; i < count; i++)
+        data[i] *= scale;
 }
 
 int cml_ring_allreduce(float* data, size_t count, int world_size, int rank,
@@ -29,121 +477,188 @@ int cml_ring_allreduce(float* data, size_t count, int world_size, int rank,
     if (!data || !ops || world_size <= 0 || rank < 0 || rank >= world_size)
         return -1;
 
-    /* Trivial case: single process */
-    if (world_size == 1) {
-        if (op == DIST_REDUCE_AVG) {
-            /* Average of 1 process is identity */
-        }
+    /* Trivial case: single process (the average of one is itself) */
+    if (world_size == 1)
         return 0;
-    }
 
     /* Need send/recv for ring communication */
     if (!ops->send || !ops->recv)
         return -1;
 
-    size_t chunk_size = (count + (size_t)world_size - 1) / (size_t)world_size;
-    float* recv_buf = (float*)malloc(chunk_size * sizeof(float));
-    if (!recv_buf) return -1;
-
-    int left  = (rank - 1 + world_size) % world_size;
-    int right = (rank + 1) % world_size;
-
-    /* Create temporary tensors for send/recv */
-    int send_shape[1], recv_shape[1];
-
-    /* Phase 1: Reduce-scatter ring */
-    for (int step = 0; step < world_size - 1; step++) {
-        int send_chunk = (rank - step + world_size) % world_size;
-        int recv_chunk = (rank - step - 1 + world_size) % world_size;
-
-        size_t send_offset = (size_t)send_chunk * chunk_size;
-        size_t recv_offset = (size_t)recv_chunk * chunk_size;
-        size_t send_count  = chunk_size;
-        size_t recv_count  = chunk_size;
-
-        /* Clamp to actual data size */
-        if (send_offset + send_count > count)
-            send_count = (send_offset < count) ? count - send_offset : 0;
-        if (recv_offset + recv_count > count)
-            recv_count = (recv_offset < count) ? count - recv_offset : 0;
-
-        /* Create tensor wrappers for send/recv */
-        send_shape[0] = (int)send_count;
-        recv_shape[0] = (int)recv_count;
-
-        Tensor send_tensor = {0};
-        send_tensor.data  = data + send_offset;
-        send_tensor.numel = send_count;
-        send_tensor.ndim  = 1;
-        send_tensor.shape = send_shape;
-        send_tensor.dtype = DTYPE_FLOAT32;
-
-        Tensor recv_tensor = {0};
-        recv_tensor.data  = recv_buf;
-        recv_tensor.numel = recv_count;
-        recv_tensor.ndim  = 1;
-        recv_tensor.shape = recv_shape;
-        recv_tensor.dtype = DTYPE_FLOAT32;
-
-        /* Send to right neighbor, recv from left neighbor */
-        int ret = ops->send(&send_tensor, right, step, ctx);
-        if (ret != 0) { free(recv_buf); return -1; }
-
-        ret = ops->recv(&recv_tensor, left, step, ctx);
-        if (ret != 0) { free(recv_buf); return -1; }
-
-        /* Reduce received data into local chunk */
-        if (recv_count > 0) {
-            apply_reduce_op(data + recv_offset, recv_buf, recv_count, op);
+    int ret = group_allreduce(data, count, NULL, world_size, rank, op, ops, ctx);
+    if (ret != 0)
+        return ret;
+
+    /* Apply averaging if requested */
+    scale_avg(data, count, op, world_size);
+    return 0;
+}
+
+int cml_ring_reduce_scatter(float* data, size_t count, int world_size, int rank,
+                            DistReduceOp op, DistCommOps* ops, void* ctx) {
+    if (!data || !ops || world_size <= 0 || rank < 0 || rank >= world_size)
+        return -1;
+    if (world_size == 1)
+        return 0;
+    if (!ops->send || !ops->recv)
+        return -1;
+
+    RingComm* c = ring_comm_acquire(ctx);
+    if (!c) return -1;
+    int ret = ring_pipelined(c, data, count, NULL, world_size, rank, op, ops, ctx,
+                             RING_REDUCE_SCATTER);
+    ring_comm_release_run(c);
+    if (ret != 0)
+        return ret;
+    size_t chunk = (count + (size_t)world_size - 1) / (size_t)world_size;
+    size_t lo    = (size_t)rank * chunk < count ? (size_t)rank * chunk : count;
+    size_t hi    = lo + chunk < count ? lo + chunk : count;
+    scale_avg(data + lo, hi - lo, op, world_size);
+    return 0;
+}
+
+int cml_ring_allgather(float* data, size_t count, int world_size, int rank, DistCommOps* ops,
+                       void* ctx) {
+    if (!data || !ops || world_size <= 0 || rank < 0 || rank >= world_size)
+        return -1;
+    if (world_size == 1)
+        return 0;
+    if (!ops->send || !ops->recv)
+        return -1;
+    RingComm* c = ring_comm_acquire(ctx);
+    if (!c) return -1;
+    int ret = ring_pipelined(c, data, count, NULL, world_size, rank, DIST_REDUCE_SUM, ops, ctx,
+                             RING_ALLGATHER);
+    ring_comm_release_run(c);
+    return ret;
+}
+
+/*
+ * Binomial trees rooted at group index 0, streamed a segment at a time:
+ * a rank forwards segment k as soon as it has it, so the depth of the tree
+ * costs latency rather than bandwidth, and receives need only one
+ * segment of scratch.
+ */
+int cml_tree_reduce(float* data, size_t count, const int* ranks, int n, int index,
+                    DistReduceOp op, DistCommOps* ops, void* ctx) {
+    if (!data || !ops || n <= 0 || index < 0 || index >= n)
+        return -1;
+    if (n == 1 || count == 0)
+        return 0;
+    if (!ops->send || !ops->recv)
+        return -1;
+
+    /* Children are index + mask for every mask below the lowest set bit */
+    int parent_mask = 1;
+    while (parent_mask < n && !(index & parent_mask))
+        parent_mask <<= 1;
+
+    RingComm* c = ring_comm_acquire(ctx);
+    if (!c) return -1;
+    size_t seg     = segment_elems();
+    float* scratch = ring_scratch(c, seg < count ? seg : count);
+    int ret        = scratch ? 0 : -1;
+
+    int tag = 0;
+    for (size_t lo = 0; ret == 0 && lo < count; lo += seg, tag++) {
+        size_t len = count - lo < seg ? count - lo : seg;
+        for (int mask = 1; ret == 0 && mask < parent_mask && index + mask < n; mask <<= 1) {
+            ret = ring_xfer(ops, ctx, scratch, len, group_rank(ranks, index + mask), tag, false);
+            if (ret == 0)
+                apply_reduce_op(data + lo, scratch, len, op);
         }
+        if (ret == 0 && index != 0)
+            ret = ring_xfer(ops, ctx, data + lo, len, group_rank(ranks, index - parent_mask), tag,
+                            true);
     }
+    ring_comm_release_run(c);
+    return ret != 0 ? -1 : 0;
+}
 
-    /* Phase 2: All-gather ring */
-    for (int step = 0; step < world_size - 1; step++) {
-        int send_chunk = (rank - step + 1 + world_size) % world_size;
-        int recv_chunk = (rank - step + world_size) % world_size;
-
-        size_t send_offset = (size_t)send_chunk * chunk_size;
-        size_t recv_offset = (size_t)recv_chunk * chunk_size;
-        size_t send_count  = chunk_size;
-        size_t recv_count  = chunk_size;
-
-        if (send_offset + send_count > count)
-            send_count = (send_offset < count) ? count - send_offset : 0;
-        if (recv_offset + recv_count > count)
-            recv_count = (recv_offset < count) ? count - recv_offset : 0;
-
-        send_shape[0] = (int)send_count;
-        recv_shape[0] = (int)recv_count;
-
-        Tensor send_tensor = {0};
-        send_tensor.data  = data + send_offset;
-        send_tensor.numel = send_count;
-        send_tensor.ndim  = 1;
-        send_tensor.shape = send_shape;
-        send_tensor.dtype = DTYPE_FLOAT32;
-
-        Tensor recv_tensor = {0};
-        recv_tensor.data  = data + recv_offset;
-        recv_tensor.numel = recv_count;
-        recv_tensor.ndim  = 1;
-        recv_tensor.shape = recv_shape;
-        recv_tensor.dtype = DTYPE_FLOAT32;
-
-        int ret = ops->send(&send_tensor, right, world_size + step, ctx);
-        if (ret != 0) { free(recv_buf); return -1; }
-
-        ret = ops->recv(&recv_tensor, left, world_size + step, ctx);
-        if (ret != 0) { free(recv_buf); return -1; }
-    }
+int cml_tree_broadcast(float* data, size_t count, const int* ranks, int n, int index,
+                       DistCommOps* ops, void* ctx) {
+    if (!data || !ops || n <= 0 || index < 0 || index >= n)
+        return -1;
+    if (n == 1 || count == 0)
+        return 0;
+    if (!ops->send || !ops->recv)
+        return -1;
 
-    /* Apply averaging if requested */
-    if (op == DIST_REDUCE_AVG) {
-        float scale = 1.0f / (float)world_size;
-        for (size_t i = 0; i < count; i++)
-            data[i] *= scale;
+    int parent_mask = 1;
+    while (parent_mask < n && !(index & parent_mask))
+        parent_mask <<= 1;
+
+    size_t seg = segment_elems();
+    int tag    = 0;
+    for (size_t lo = 0; lo < count; lo += seg, tag++) {
+        size_t len = count - lo < seg ? count - lo : seg;
+        if (index != 0 &&
+            ring_xfer(ops, ctx, data + lo, len, group_rank(ranks, index - parent_mask), tag,
+                      false) != 0)
+            return -1;
+        /* Farthest child first: it heads the largest subtree */
+        for (int mask = parent_mask >> 1; mask > 0; mask >>= 1) {
+            if (index + mask < n &&
+                ring_xfer(ops, ctx, data + lo, len, group_rank(ranks, index + mask), tag,
+                          true) != 0)
+                return -1;
+        }
     }
+    return 0;
+}
 
-    free(recv_buf);
+int cml_ring_allreduce_group(float* data, size_t count, const int* ranks, int n, int index,
+                             DistReduceOp op, DistCommOps* ops, void* ctx) {
+    if (!data || !ops || n <= 0 || index < 0 || index >= n)
+        return -1;
+    if (n > 1 && (!ops->send || !ops->recv))
+        return -1;
+    int ret = group_allreduce(data, count, ranks, n, index, op, ops, ctx);
+    if (ret == 0)
+        scale_avg(data, count, op, n);
+    return ret;
+}
+
+int cml_hierarchical_allreduce(float* data, size_t count, const int* local_ranks,
+                               int local_size, int local_index, const int* leader_ranks,
+                               int num_nodes, int node_index, int world_size, DistReduceOp op,
+                               DistCommOps* ops, void* ctx) {
+    if (!data || !ops || world_size <= 0)
+        return -1;
+    DistReduceOp inner = op == DIST_REDUCE_AVG ? DIST_REDUCE_SUM : op;
+
+    if (cml_tree_reduce(data, count, local_ranks, local_size, local_index, inner, ops, ctx) != 0)
+        return -1;
+    if (local_index == 0 &&
+        group_allreduce(data, count, leader_ranks, num_nodes, node_index, inner, ops, ctx) != 0)
+        return -1;
+    if (cml_tree_broadcast(data, count, local_ranks, local_size, local_index, ops, ctx) != 0)
+        return -1;
+
+    scale_avg(data, count, op, world_size);
     return 0;
 }
+
+void cml_ring_release(void* ctx) {
+    pthread_mutex_lock(&g_ring_comms_lock);
+    RingComm** link = &g_ring_comms;
+    while (*link && (*link)->ctx != ctx)
+        link = &(*link)->next;
+    RingComm* c = *link;
+    if (c)
+        *link = c->next;
+    pthread_mutex_unlock(&g_ring_comms_lock);
+    if (!c)
+        return;
+
+    /* Wait out a collective still running on this communicator */
+    pthread_mutex_lock(&c->run_lock);
+    ring_comm_stop_threads(c);
+    pthread_mutex_unlock(&c->run_lock);
+
+    free(c->scratch);
+    pthread_mutex_destroy(&c->run_lock);
+    pthread_mutex_destroy(&c->lock);
+    pthread_cond_destroy(&c->cond);
+    free(c);
+}
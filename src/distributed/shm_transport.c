@@ -0,0 +1,321 @@
+#include "distributed/shm_transport.h"
+#include "core/logging.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SHM_MAGIC          0x434d4c53484d3031ULL /* "CMLSHM01" */
+#define SHM_CACHELINE      64
+#define SHM_SPIN_ITERS     2048
+#define SHM_YIELD_ITERS    256
+#define SHM_SLEEP_NS       20000
+#define SHM_ATTACH_TIMEOUT 30 /* Seconds to wait for the creator */
+#define SHM_LIVENESS_ITERS 256 /* Sleeps between checks that a stalled peer lives */
+#define SHM_PEER_GONE      (-1) /* Peer slot of a rank that has closed the segment */
+
+typedef struct {
+    _Atomic uint64_t magic; /* Stored last by the creator */
+    uint32_t local_size;
+    uint32_t reserved;
+    uint64_t ring_bytes;
+} ShmHeader;
+
+/* Pid of each local rank, so a blocked send/recv can tell a slow peer from
+ * a dead one: 0 until the rank attaches, SHM_PEER_GONE once it has freed
+ * its mapping. */
+typedef struct {
+    _Atomic int32_t pid;
+} ShmPeer;
+
+/* Producer and consumer cursors on separate cache lines; both count bytes
+ * since creation and only ever grow, so head - tail is the fill level. */
+typedef struct {
+    _Alignas(SHM_CACHELINE) _Atomic uint64_t head;
+    _Alignas(SHM_CACHELINE) _Atomic uint64_t tail;
+} ShmRing;
+
+struct CMLShmTransport {
+    char name[64];
+    void* base;
+    size_t size;
+    ShmHeader* header;
+    ShmPeer* peers;
+    ShmRing* rings; /* [src * local_size + dst] */
+    char* data;
+    size_t ring_bytes;
+    int local_rank;
+    int local_size;
+    bool owner;
+    bool unlinked;
+    bool registered; /* Own pid is published in peers[] */
+};
+
+static size_t shm_header_bytes(void) {
+    return (sizeof(ShmHeader) + SHM_CACHELINE - 1) / SHM_CACHELINE * SHM_CACHELINE;
+}
+
+static size_t shm_peers_bytes(int local_size) {
+    size_t n = (size_t)local_size * sizeof(ShmPeer);
+    return (n + SHM_CACHELINE - 1) / SHM_CACHELINE * SHM_CACHELINE;
+}
+
+static size_t shm_segment_bytes(int local_size, size_t ring_bytes) {
+    size_t pairs = (size_t)local_size * (size_t)local_size;
+    return shm_header_bytes() + shm_peers_bytes(local_size) + pairs * sizeof(ShmRing) +
+           pairs * ring_bytes;
+}
+
+static void shm_layout(CMLShmTransport* shm) {
+    size_t pairs = (size_t)shm->local_size * (size_t)shm->local_size;
+    shm->header  = (ShmHeader*)shm->base;
+    shm->peers   = (ShmPeer*)((char*)shm->base + shm_header_bytes());
+    shm->rings   = (ShmRing*)((char*)shm->peers + shm_peers_bytes(shm->local_size));
+    shm->data    = (char*)(shm->rings + pairs);
+}
+
+/* False once the peer has closed the segment or its process has exited */
+static bool shm_peer_alive(CMLShmTransport* shm, int peer) {
+    int32_t pid = atomic_load_explicit(&shm->peers[peer].pid, memory_order_acquire);
+    if (pid == SHM_PEER_GONE)
+        return false;
+    return pid <= 0 || kill((pid_t)pid, 0) == 0 || errno != ESRCH;
+}
+
+/* Called only while stalled: checks the peer every SHM_LIVENESS_ITERS
+ * sleeps, once backoff has reached sleeping */
+static bool shm_peer_stalled_dead(CMLShmTransport* shm, int peer, int spins) {
+    int sleeps = spins - (SHM_SPIN_ITERS + SHM_YIELD_ITERS);
+    return sleeps >= 0 && sleeps % SHM_LIVENESS_ITERS == 0 && !shm_peer_alive(shm, peer);
+}
+
+/* Spin briefly (the peer is usually mid-copy), then yield, then sleep */
+static void shm_backoff(int* spins) {
+    if (*spins < SHM_SPIN_ITERS) {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    } else if (*spins < SHM_SPIN_ITERS + SHM_YIELD_ITERS) {
+        sched_yield();
+    } else {
+        struct timespec ts = {0, SHM_SLEEP_NS};
+        nanosleep(&ts, NULL);
+    }
+    (*spins)++;
+}
+
+static int shm_map(CMLShmTransport* shm, int fd) {
+    void* p = mmap(NULL, shm->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        LOG_ERROR("Shm transport: mmap of %zu bytes failed: %s", shm->size, strerror(errno));
+        return -1;
+    }
+    shm->base = p;
+    shm_layout(shm);
+    return 0;
+}
+
+static int shm_create(CMLShmTransport* shm) {
+    shm_unlink(shm->name); /* Stale segment from a crashed run */
+    int fd = shm_open(shm->name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        LOG_ERROR("Shm transport: cannot create %s: %s", shm->name, strerror(errno));
+        return -1;
+    }
+    shm->size = shm_segment_bytes(shm->local_size, shm->ring_bytes);
+    int ret   = -1;
+    if (ftruncate(fd, (off_t)shm->size) != 0)
+        LOG_ERROR("Shm transport: cannot size %s: %s", shm->name, strerror(errno));
+    else
+        ret = shm_map(shm, fd);
+    close(fd);
+    if (ret != 0) {
+        shm_unlink(shm->name);
+        return -1;
+    }
+    shm->owner = true;
+
+    /* ftruncate zero-filled the rings; publish the header last */
+    shm->header->local_size = (uint32_t)shm->local_size;
+    shm->header->ring_bytes = shm->ring_bytes;
+    atomic_store_explicit(&shm->header->magic, SHM_MAGIC, memory_order_release);
+    return 0;
+}
+
+static int shm_attach(CMLShmTransport* shm) {
+    time_t deadline = time(NULL) + SHM_ATTACH_TIMEOUT;
+    int fd          = -1;
+    struct stat st  = {0};
+    int spins       = SHM_SPIN_ITERS + SHM_YIELD_ITERS;
+    while (fd < 0 || st.st_size == 0) {
+        if (fd < 0)
+            fd = shm_open(shm->name, O_RDWR, 0600);
+        if (fd >= 0 && fstat(fd, &st) != 0) {
+            close(fd);
+            fd = -1;
+        }
+        if (fd >= 0 && st.st_size > 0)
+            break;
+        if (time(NULL) > deadline) {
+            LOG_ERROR("Shm transport: timed out waiting for %s", shm->name);
+            if (fd >= 0) close(fd);
+            return -1;
+        }
+        shm_backoff(&spins);
+    }
+
+    shm->size = (size_t)st.st_size;
+    int ret   = shm_map(shm, fd);
+    close(fd);
+    if (ret != 0)
+        return -1;
+
+    while (atomic_load_explicit(&shm->header->magic, memory_order_acquire) != SHM_MAGIC) {
+        if (time(NULL) > deadline) {
+            LOG_ERROR("Shm transport: %s was never initialized", shm->name);
+            return -1;
+        }
+        shm_backoff(&spins);
+    }
+    shm->ring_bytes = (size_t)shm->header->ring_bytes;
+    if ((int)shm->header->local_size != shm->local_size ||
+        shm_segment_bytes(shm->local_size, shm->ring_bytes) != shm->size) {
+        LOG_ERROR("Shm transport: %s was created for %u local ranks, expected %d", shm->name,
+                  shm->header->local_size, shm->local_size);
+        return -1;
+    }
+    return 0;
+}
+
+CMLShmTransport* cml_shm_open(const char* name, int local_rank, int local_size,
+                              size_t ring_bytes) {
+    if (!name || !name[0] || local_size < 1 || local_rank < 0 || local_rank >= local_size)
+        return NULL;
+
+    CMLShmTransport* shm = calloc(1, sizeof(CMLShmTransport));
+    if (!shm)
+        return NULL;
+    strncpy(shm->name, name, sizeof(shm->name) - 1);
+    shm->local_rank = local_rank;
+    shm->local_size = local_size;
+
+    size_t want     = ring_bytes ? ring_bytes : CML_SHM_DEFAULT_RING_BYTES;
+    shm->ring_bytes = SHM_CACHELINE;
+    while (shm->ring_bytes < want)
+        shm->ring_bytes <<= 1;
+
+    int ret = local_rank == 0 ? shm_create(shm) : shm_attach(shm);
+    if (ret != 0) {
+        cml_shm_free(shm);
+        return NULL;
+    }
+    atomic_store_explicit(&shm->peers[local_rank].pid, (int32_t)getpid(), memory_order_release);
+    shm->registered = true;
+    LOG_DEBUG("Shm transport %s: local rank %d/%d, %zu-byte rings", shm->name, local_rank,
+              local_size, shm->ring_bytes);
+    return shm;
+}
+
+void cml_shm_unlink(CMLShmTransport* shm) {
+    if (!shm || !shm->owner || shm->unlinked)
+        return;
+    shm_unlink(shm->name);
+    shm->unlinked = true;
+}
+
+void cml_shm_free(CMLShmTransport* shm) {
+    if (!shm)
+        return;
+    cml_shm_unlink(shm);
+    if (shm->registered)
+        atomic_store_explicit(&shm->peers[shm->local_rank].pid, SHM_PEER_GONE,
+                              memory_order_release);
+    if (shm->base)
+        munmap(shm->base, shm->size);
+    free(shm);
+}
+
+int cml_shm_send(CMLShmTransport* shm, int dst_local, const void* buf, size_t len) {
+    if (!shm || dst_local < 0 || dst_local >= shm->local_size || dst_local == shm->local_rank)
+        return -1;
+
+    size_t idx      = (size_t)shm->local_rank * (size_t)shm->local_size + (size_t)dst_local;
+    ShmRing* ring   = &shm->rings[idx];
+    char* ring_data = shm->data + idx * shm->ring_bytes;
+    size_t cap      = shm->ring_bytes;
+    const char* src = (const char*)buf;
+
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    int spins     = 0;
+    while (len > 0) {
+        uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        size_t space  = cap - (size_t)(head - tail);
+        if (space == 0) {
+            if (shm_peer_stalled_dead(shm, dst_local, spins) &&
+                atomic_load_explicit(&ring->tail, memory_order_acquire) == tail) {
+                LOG_ERROR("Shm transport: local rank %d is gone, send aborted", dst_local);
+                return -1;
+            }
+            shm_backoff(&spins);
+            continue;
+        }
+        spins      = 0;
+        size_t n   = len < space ? len : space;
+        size_t off = (size_t)head & (cap - 1);
+        size_t n1  = n < cap - off ? n : cap - off;
+        memcpy(ring_data + off, src, n1);
+        memcpy(ring_data, src + n1, n - n1);
+        head += n;
+        atomic_store_explicit(&ring->head, head, memory_order_release);
+        src += n;
+        len -= n;
+    }
+    return 0;
+}
+
+int cml_shm_recv(CMLShmTransport* shm, int src_local, void* buf, size_t len) {
+    if (!shm || src_local < 0 || src_local >= shm->local_size || src_local == shm->local_rank)
+        return -1;
+
+    size_t idx      = (size_t)src_local * (size_t)shm->local_size + (size_t)shm->local_rank;
+    ShmRing* ring   = &shm->rings[idx];
+    char* ring_data = shm->data + idx * shm->ring_bytes;
+    size_t cap      = shm->ring_bytes;
+    char* dst       = (char*)buf;
+
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    int spins     = 0;
+    while (len > 0) {
+        uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        size_t avail  = (size_t)(head - tail);
+        if (avail == 0) {
+            /* The peer's last head store precedes its GONE store */
+            if (shm_peer_stalled_dead(shm, src_local, spins) &&
+                atomic_load_explicit(&ring->head, memory_order_acquire) == head) {
+                LOG_ERROR("Shm transport: local rank %d is gone, recv aborted", src_local);
+                return -1;
+            }
+            shm_backoff(&spins);
+            continue;
+        }
+        spins      = 0;
+        size_t n   = len < avail ? len : avail;
+        size_t off = (size_t)tail & (cap - 1);
+        size_t n1  = n < cap - off ? n : cap - off;
+        memcpy(dst, ring_data + off, n1);
+        memcpy(dst + n1, ring_data, n - n1);
+        tail += n;
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+        dst += n;
+        len -= n;
+    }
+    return 0;
+}
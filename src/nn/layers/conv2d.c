@@ -32,9 +32,9 @@ static Tensor* conv2d_forward(Module* module, Tensor* input) {
     int in_channels        = input->shape[1];
     int out_channels       = weight->shape[0];
     int weight_in_channels = weight->shape[1];
-    if (in_channels != weight_in_channels) {
-        LOG_ERROR("Conv2d: input channels (%d) doesn't match weight in_channels (%d)", in_channels,
-                  weight_in_channels);
+    if (in_channels != weight_in_channels * conv2d->groups) {
+        LOG_ERROR("Conv2d: input channels (%d) doesn't match weight in_channels (%d) x groups (%d)",
+                  in_channels, weight_in_channels, conv2d->groups);
         return NULL;
     }
     if (in_channels != conv2d->in_channels || out_channels != conv2d->out_channels) {
@@ -47,7 +47,7 @@ static Tensor* conv2d_forward(Module* module, Tensor* input) {
     int padding_w  = conv2d->padding[1];
     int dilation_h = conv2d->dilation[0];
     int dilation_w = conv2d->dilation[1];
-    Conv2DParams conv_params;
+    Conv2DParams conv_params = {0};
     int stride_arr[]   = {stride_h, stride_w};
     int padding_arr[]  = {padding_h, padding_w};
     int dilation_arr[] = {dilation_h, dilation_w};
@@ -55,6 +55,7 @@ static Tensor* conv2d_forward(Module* module, Tensor* input) {
     conv_params.stride   = stride_arr;
     conv_params.padding  = padding_arr;
     conv_params.dilation = dilation_arr;
+    conv_params.groups   = conv2d->groups;
 
     Tensor* bias = NULL;
     if (conv2d->use_bias && bias_param && bias_param->tensor) {
@@ -96,6 +97,19 @@ static void kaiming_init(Tensor* tensor, int in_channels, int out_channels, int
 
 Conv2d* nn_conv2d(int in_channels, int out_channels, int kernel_size, int stride, int padding,
                   int dilation, bool use_bias, DType dtype, DeviceType device) {
+    return nn_conv2d_grouped(in_channels, out_channels, kernel_size, stride, padding, dilation, 1,
+                             use_bias, dtype, device);
+}
+
+Conv2d* nn_conv2d_grouped(int in_channels, int out_channels, int kernel_size, int stride,
+                          int padding, int dilation, int groups, bool use_bias, DType dtype,
+                          DeviceType device) {
+    if (groups < 1 || in_channels % groups != 0 || out_channels % groups != 0) {
+        LOG_ERROR("Conv2d: groups (%d) must divide in_channels (%d) and out_channels (%d)", groups,
+                  in_channels, out_channels);
+        return NULL;
+    }
+
     Conv2d* conv2d = malloc(sizeof(Conv2d));
     if (!conv2d)
         return NULL;
@@ -116,8 +130,8 @@ Conv2d* nn_conv2d(int in_channels, int out_channels, int kernel_size, int stride
     conv2d->dilation[0]    = dilation;
     conv2d->dilation[1]    = dilation;
     conv2d->use_bias       = use_bias;
-    conv2d->groups         = 1;
-    int weight_shape[] = {out_channels, in_channels, kernel_size, kernel_size};
+    conv2d->groups         = groups;
+    int weight_shape[] = {out_channels, in_channels / groups, kernel_size, kernel_size};
     TensorConfig config =
         (TensorConfig){.dtype = dtype, .device = device, .has_dtype = true, .has_device = true};
     Tensor* weight = tensor_empty(weight_shape, 4, &config);
@@ -125,7 +139,7 @@ Conv2d* nn_conv2d(int in_channels, int out_channels, int kernel_size, int stride
         module_free((Module*)conv2d);
         return NULL;
     }
-    kaiming_init(weight, in_channels, out_channels, kernel_size);
+    kaiming_init(weight, in_channels / groups, out_channels, kernel_size);
 
     if (module_add_parameter((Module*)conv2d, weight, "weight", true) != 0) {
         tensor_free(weight);
@@ -1,6 +1,8 @@
 #include "nn/llama.h"
 #include "nn/llm_ops.h"
+#include "nn/paged_attention.h"
 #include "core/gguf.h"
+#include "core/gguf_quant.h"
 #include "ops/uops.h"
 #include "core/logging.h"
 #include "tensor/tensor.h"
@@ -123,11 +125,19 @@ static Tensor* rms_norm(Tensor* x, Tensor* weight, float eps) {
     return result;
 }
 
-static Tensor* swiglu_ffn(Tensor* x, Tensor* gate_proj, Tensor* up_proj, Tensor* down_proj) {
-    if (!x || !gate_proj || !up_proj || !down_proj) return NULL;
+/* x @ W for an [in, out] float weight, or x @ W^T straight from the GGUF
+ * blocks ([out, in] rows) when the weight was kept quantized */
+static Tensor* llama_project(Tensor* x, Tensor* w, const CMLQuantWeight* wq) {
+    if (wq) return cml_quant_linear(x, wq);
+    if (!w) return NULL;
+    return uop_matmul(x, w);
+}
+
+static Tensor* swiglu_ffn(Tensor* x, const CMLLLaMALayer* layer) {
+    if (!x || !layer) return NULL;
 
     /* gate_out = x @ gate_proj -> [seq_len, intermediate_size] */
-    Tensor* gate_out = uop_matmul(x, gate_proj);
+    Tensor* gate_out = llama_project(x, layer->gate_proj, layer->gate_proj_quant);
     if (!gate_out) return NULL;
 
     /* gate_activated = silu(gate_out) */
@@ -137,7 +147,7 @@ static Tensor* swiglu_ffn(Tensor* x, Tensor* gate_proj, Tensor* up_proj, Tensor*
     if (!gate_activated) return NULL;
 
     /* up_out = x @ up_proj -> [seq_len, intermediate_size] */
-    Tensor* up_out = uop_matmul(x, up_proj);
+    Tensor* up_out = llama_project(x, layer->up_proj, layer->up_proj_quant);
     if (!up_out) return NULL;
 
     /* combined = gate_activated * up_out */
@@ -147,7 +157,7 @@ static Tensor* swiglu_ffn(Tensor* x, Tensor* gate_proj, Tensor* up_proj, Tensor*
     if (!combined) return NULL;
 
     /* output = combined @ down_proj -> [seq_len, hidden_size] */
-    Tensor* output = uop_matmul(combined, down_proj);
+    Tensor* output = llama_project(combined, layer->down_proj, layer->down_proj_quant);
     if (output)
         tensor_ensure_executed(output);
 
@@ -186,6 +196,13 @@ static void llama_layer_free(CMLLLaMALayer* layer) {
     if (layer->down_proj) tensor_free(layer->down_proj);
     if (layer->input_layernorm) tensor_free(layer->input_layernorm);
     if (layer->post_attn_layernorm) tensor_free(layer->post_attn_layernorm);
+    cml_quant_weight_free(layer->q_proj_quant);
+    cml_quant_weight_free(layer->k_proj_quant);
+    cml_quant_weight_free(layer->v_proj_quant);
+    cml_quant_weight_free(layer->o_proj_quant);
+    cml_quant_weight_free(layer->gate_proj_quant);
+    cml_quant_weight_free(layer->up_proj_quant);
+    cml_quant_weight_free(layer->down_proj_quant);
     if (layer->kv_cache) cml_kv_cache_free(layer->kv_cache);
 
     free(layer);
@@ -254,20 +271,125 @@ void cml_llama_free(CMLLLaMAModel* model) {
     if (model->embed_tokens) tensor_free(model->embed_tokens);
     if (model->norm) tensor_free(model->norm);
     if (model->lm_head) tensor_free(model->lm_head);
+    cml_quant_weight_free(model->lm_head_quant);
 
     /* Free tokenizer */
     if (model->tokenizer) cml_tokenizer_free(model->tokenizer);
 
+    /* Unmap weights only after every tensor aliasing them is gone */
+    if (model->weights_file) gguf_close(model->weights_file);
+
     free(model);
 }
 
-static int load_tensor_by_name(CMLLLaMAModel* model, GGUFContext* ctx, const char* name) {
+/* Parses "model.layers.N.<suffix>" or "blk.N.<suffix>"; returns N or -1 */
+static int parse_layer_name(const char* name, const char** suffix) {
+    const char* p = NULL;
+    if (strncmp(name, "model.layers.", 13) == 0) {
+        p = name + 13;
+    } else if (strncmp(name, "blk.", 4) == 0) {
+        /* llama.cpp style */
+        p = name + 4;
+    } else {
+        return -1;
+    }
+
+    char* end = NULL;
+    int layer_idx = (int)strtol(p, &end, 10);
+    if (end == p || *end != '.') return -1;
+    *suffix = end + 1; /* skip the dot */
+    return layer_idx;
+}
+
+static CMLQuantWeight** quant_projection_slot(CMLLLaMAModel* model, const char* name) {
+    if (strcmp(name, "lm_head.weight") == 0 || strcmp(name, "output.weight") == 0)
+        return &model->lm_head_quant;
+
+    const char* suffix = NULL;
+    int layer_idx = parse_layer_name(name, &suffix);
+    if (layer_idx < 0 || layer_idx >= model->num_layers) return NULL;
+
+    CMLLLaMALayer* layer = model->layers[layer_idx];
+    if (strcmp(suffix, "self_attn.q_proj.weight") == 0 || strcmp(suffix, "attn_q.weight") == 0)
+        return &layer->q_proj_quant;
+    if (strcmp(suffix, "self_attn.k_proj.weight") == 0 || strcmp(suffix, "attn_k.weight") == 0)
+        return &layer->k_proj_quant;
+    if (strcmp(suffix, "self_attn.v_proj.weight") == 0 || strcmp(suffix, "attn_v.weight") == 0)
+        return &layer->v_proj_quant;
+    if (strcmp(suffix, "self_attn.o_proj.weight") == 0 ||
+        strcmp(suffix, "attn_output.weight") == 0)
+        return &layer->o_proj_quant;
+    if (strcmp(suffix, "mlp.gate_proj.weight") == 0 || strcmp(suffix, "ffn_gate.weight") == 0)
+        return &layer->gate_proj_quant;
+    if (strcmp(suffix, "mlp.up_proj.weight") == 0 || strcmp(suffix, "ffn_up.weight") == 0)
+        return &layer->up_proj_quant;
+    if (strcmp(suffix, "mlp.down_proj.weight") == 0 || strcmp(suffix, "ffn_down.weight") == 0)
+        return &layer->down_proj_quant;
+    return NULL;
+}
+
+/*
+ * GGUF lists a matrix's dims fastest first, so a projection reads back as
+ * [ne0 = in, ne1 = out] over the rows of the [out, in] weight: the layout the
+ * quantized path multiplies as x @ W^T. The float path computes x @ W on an
+ * [in, out] matrix, so transpose once here to give both the same weights.
+ */
+static Tensor* projection_from_gguf(Tensor* t) {
+    if (t->ndim != 2 || (t->dtype != DTYPE_FLOAT32 && t->dtype != DTYPE_FLOAT16)) {
+        LOG_ERROR("GGUF: projection must be a 2-D float32/float16 matrix");
+        return NULL;
+    }
+    int in = t->shape[0], out = t->shape[1];
+    int shape[] = {in, out};
+    TensorConfig cfg = {.dtype = DTYPE_FLOAT32, .device = DEVICE_CPU,
+                        .has_dtype = true, .has_device = true};
+    Tensor* w = tensor_empty(shape, 2, &cfg);
+    if (!w) return NULL;
+    tensor_ensure_executed(w);
+    float* dst = (float*)w->data;
+    const void* src = tensor_data_ptr(t);
+    if (!dst || !src) {
+        tensor_free(w);
+        return NULL;
+    }
+    for (int o = 0; o < out; o++) {
+        for (int i = 0; i < in; i++) {
+            size_t k = (size_t)o * in + i;
+            dst[(size_t)i * out + o] = t->dtype == DTYPE_FLOAT32
+                                           ? ((const float*)src)[k]
+                                           : gguf_fp16_to_fp32(((const uint16_t*)src)[k]);
+        }
+    }
+    return w;
+}
+
+static int load_tensor_by_name(CMLLLaMAModel* model, GGUFContext* ctx, const char* name,
+                               bool keep_quantized) {
+    /* Projections stay in block form for the quantized matmul kernels */
+    if (keep_quantized) {
+        CMLQuantWeight** slot = quant_projection_slot(model, name);
+        CMLQuantWeight* wq = slot ? gguf_read_quant_weight(ctx, name) : NULL;
+        if (wq) {
+            cml_quant_weight_free(*slot);
+            *slot = wq;
+            return 0;
+        }
+    }
+
     Tensor* t = gguf_read_tensor(ctx, name);
     if (!t) {
         LOG_WARNING("GGUF: tensor '%s' not found, skipping", name);
         return -1;
     }
 
+    /* Projections not kept quantized (other types, F16/F32, CML_QUANT_MATMUL=0) */
+    if (quant_projection_slot(model, name)) {
+        Tensor* w = projection_from_gguf(t);
+        tensor_free(t);
+        if (!w) return -1;
+        t = w;
+    }
+
     /* Match model.embed_tokens.weight */
     if (strcmp(name, "model.embed_tokens.weight") == 0 ||
         strcmp(name, "token_embd.weight") == 0) {
@@ -293,29 +415,8 @@ static int load_tensor_by_name(CMLLLaMAModel* model, GGUFContext* ctx, const cha
     }
 
     /* Try to parse layer index: model.layers.N.xxx or blk.N.xxx */
-    int layer_idx = -1;
     const char* suffix = NULL;
-
-    /* Try "model.layers.N." format */
-    if (strncmp(name, "model.layers.", 13) == 0) {
-        const char* p = name + 13;
-        layer_idx = (int)strtol(p, (char**)&suffix, 10);
-        if (suffix && *suffix == '.') {
-            suffix++; /* skip the dot */
-        } else {
-            layer_idx = -1;
-        }
-    }
-    /* Try "blk.N." format (llama.cpp style) */
-    else if (strncmp(name, "blk.", 4) == 0) {
-        const char* p = name + 4;
-        layer_idx = (int)strtol(p, (char**)&suffix, 10);
-        if (suffix && *suffix == '.') {
-            suffix++;
-        } else {
-            layer_idx = -1;
-        }
-    }
+    int layer_idx = parse_layer_name(name, &suffix);
 
     if (layer_idx < 0 || layer_idx >= model->num_layers || !suffix) {
         LOG_WARNING("GGUF: unrecognized tensor name '%s'", name);
@@ -381,7 +482,22 @@ int cml_llama_load_gguf(CMLLLaMAModel* model, const char* filepath) {
         return -1;
     }
 
-    GGUFContext* ctx = gguf_open_read(filepath);
+    /* Map the file so unquantized weights are used in place: near-instant
+     * startup, and the pages are shared with other processes through the page
+     * cache. CML_MMAP=0 reads into private buffers instead; CML_MMAP_PREFETCH=1
+     * starts read-ahead of the whole file. Q4_0/Q4_K/Q8_0 projections are kept
+     * as blocks and multiplied in that form unless CML_QUANT_MATMUL=0, which
+     * dequantizes them to float32 at load time. */
+    const char* mmap_env = getenv("CML_MMAP");
+    const char* prefetch_env = getenv("CML_MMAP_PREFETCH");
+    const char* quant_env = getenv("CML_QUANT_MATMUL");
+    bool keep_quantized = !(quant_env && quant_env[0] == '0');
+    CMLWeightLoadOptions opts = {
+        .use_mmap = !(mmap_env && mmap_env[0] == '0'),
+        .prefetch = prefetch_env && prefetch_env[0] == '1',
+    };
+
+    GGUFContext* ctx = gguf_open_read_ex(filepath, &opts);
     if (!ctx) {
         LOG_ERROR("cml_llama_load_gguf: failed to open '%s'", filepath);
         return -1;
@@ -397,17 +513,22 @@ int cml_llama_load_gguf(CMLLLaMAModel* model, const char* filepath) {
         const char* name = gguf_get_tensor_name(ctx, i);
         if (!name) continue;
 
-        if (load_tensor_by_name(model, ctx, name) == 0) {
+        if (load_tensor_by_name(model, ctx, name, keep_quantized) == 0) {
             loaded++;
         } else {
             skipped++;
         }
     }
 
-    gguf_close(ctx);
+    if (opts.use_mmap) {
+        if (model->weights_file) gguf_close(model->weights_file);
+        model->weights_file = ctx;
+    } else {
+        gguf_close(ctx);
+    }
 
     /* If lm_head is not provided, share embed_tokens (weight tying) */
-    if (!model->lm_head && model->embed_tokens) {
+    if (!model->lm_head && !model->lm_head_quant && model->embed_tokens) {
         LOG_INFO("Weight tying: lm_head shares embed_tokens");
         model->lm_head = model->embed_tokens;
     }
@@ -461,9 +582,9 @@ Tensor* cml_llama_layer_forward(CMLLLaMAModel* model, CMLLLaMALayer* layer,
     Tensor* normed = rms_norm(hidden, layer->input_layernorm, cfg->rms_norm_eps);
     if (!normed) return NULL;
 
-    Tensor* Q = uop_matmul(normed, layer->q_proj);
-    Tensor* K = uop_matmul(normed, layer->k_proj);
-    Tensor* V = uop_matmul(normed, layer->v_proj);
+    Tensor* Q = llama_project(normed, layer->q_proj, layer->q_proj_quant);
+    Tensor* K = llama_project(normed, layer->k_proj, layer->k_proj_quant);
+    Tensor* V = llama_project(normed, layer->v_proj, layer->v_proj_quant);
     if (Q)
         tensor_ensure_executed(Q);
     if (K)
@@ -520,7 +641,7 @@ Tensor* cml_llama_layer_forward(CMLLLaMAModel* model, CMLLLaMALayer* layer,
     int out_2d[] = {attn_out->shape[1], attn_out->shape[2]};
     Tensor* attn_2d = tensor_reshape(attn_out, out_2d, 2);
 
-    Tensor* attn_proj = uop_matmul(attn_2d, layer->o_proj);
+    Tensor* attn_proj = llama_project(attn_2d, layer->o_proj, layer->o_proj_quant);
     if (attn_proj)
         tensor_ensure_executed(attn_proj);
     tensor_free(attn_2d);
@@ -535,7 +656,7 @@ Tensor* cml_llama_layer_forward(CMLLLaMAModel* model, CMLLLaMALayer* layer,
     Tensor* normed2 = rms_norm(residual1, layer->post_attn_layernorm, cfg->rms_norm_eps);
     if (!normed2) return NULL;
 
-    Tensor* ffn_out = swiglu_ffn(normed2, layer->gate_proj, layer->up_proj, layer->down_proj);
+    Tensor* ffn_out = swiglu_ffn(normed2, layer);
     if (ffn_out)
         tensor_ensure_executed(ffn_out);
     if (!ffn_out) return NULL;
@@ -547,6 +668,30 @@ Tensor* cml_llama_layer_forward(CMLLLaMAModel* model, CMLLLaMALayer* layer,
     return output;
 }
 
+/* [rows, hidden] -> [rows, vocab_size] */
+static Tensor* llama_lm_head(CMLLLaMAModel* model, Tensor* hidden) {
+    Tensor* logits = NULL;
+    if (model->lm_head_quant) {
+        logits = cml_quant_linear(hidden, model->lm_head_quant);
+    } else if (model->lm_head && model->lm_head != model->embed_tokens) {
+        logits = uop_matmul(hidden, model->lm_head);
+    } else if (model->embed_tokens) {
+        /* Weight tying: use embed_tokens transposed.
+         * For simplicity, use matmul with embed_tokens directly;
+         * the embedding shape is [vocab_size, hidden_size], and hidden is
+         * [seq_len, hidden_size]. We need hidden @ embed^T = [seq_len, vocab_size].
+         * We compute this via the matmul of hidden [seq, hidden] x embed^T [hidden, vocab].
+         * We'll explicitly use permute to transpose embed. */
+        PermuteParams pp = { .perm = (int[]){1, 0}, .num_dims = 2 };
+        Tensor* embed_t = uop_permute(model->embed_tokens, &pp);
+        if (embed_t) {
+            logits = uop_matmul(hidden, embed_t);
+        }
+    }
+
+    return logits;
+}
+
 Tensor* cml_llama_forward(CMLLLaMAModel* model, const int* token_ids, int seq_len) {
     if (!model || !token_ids || seq_len <= 0) {
         LOG_ERROR("cml_llama_forward: invalid arguments");
@@ -585,23 +730,7 @@ Tensor* cml_llama_forward(CMLLLaMAModel* model, const int* token_ids, int seq_le
         hidden = normed;
     }
 
-    Tensor* logits = NULL;
-    if (model->lm_head && model->lm_head != model->embed_tokens) {
-        logits = uop_matmul(hidden, model->lm_head);
-    } else if (model->embed_tokens) {
-        /* Weight tying: use embed_tokens transposed.
-         * For simplicity, use matmul with embed_tokens directly;
-         * the embedding shape is [vocab_size, hidden_size], and hidden is
-         * [seq_len, hidden_size]. We need hidden @ embed^T = [seq_len, vocab_size].
-         * We compute this via the matmul of hidden [seq, hidden] x embed^T [hidden, vocab].
-         * We'll explicitly use permute to transpose embed. */
-        PermuteParams pp = { .perm = (int[]){1, 0}, .num_dims = 2 };
-        Tensor* embed_t = uop_permute(model->embed_tokens, &pp);
-        if (embed_t) {
-            logits = uop_matmul(hidden, embed_t);
-        }
-    }
-
+    Tensor* logits = llama_lm_head(model, hidden);
     if (!logits) {
         LOG_ERROR("cml_llama_forward: lm_head projection failed");
         return NULL;
@@ -611,6 +740,198 @@ Tensor* cml_llama_forward(CMLLLaMAModel* model, const int* token_ids, int seq_le
     return logits;
 }
 
+/* Rotates rows [row, row + n) of x as positions start_pos.., exactly as
+ * cml_rope_forward does for a single sequence */
+static int rope_rows(Tensor* x, int row, int n, int start_pos, const CMLRoPEConfig* cfg) {
+    int width = x->shape[1];
+    float* rows = (float*)tensor_data_ptr(x) + (size_t)row * width;
+    int shape[] = {n, width};
+    Tensor* view = tensor_from_data(rows, shape, 2, NULL);
+    if (!view) return -1;
+
+    Tensor* rotated = cml_rope_forward(view, start_pos, cfg);
+    if (rotated)
+        memcpy(rows, tensor_data_ptr(rotated), (size_t)n * width * sizeof(float));
+    if (rotated && rotated != view) tensor_free(rotated);
+    tensor_free(view);
+    return rotated ? 0 : -1;
+}
+
+static Tensor* llama_layer_forward_paged(CMLLLaMAModel* model, CMLLLaMALayer* layer,
+                                         CMLPagedKVCache* cache, const int* seq_ids,
+                                         const int* num_tokens, int num_seqs,
+                                         Tensor* hidden) {
+    const CMLLLaMAConfig* cfg = &model->config;
+    int head_dim = cfg->hidden_size / cfg->num_heads;
+    int total = hidden->shape[0];
+
+    Tensor* normed = rms_norm(hidden, layer->input_layernorm, cfg->rms_norm_eps);
+    if (!normed) return NULL;
+
+    /* One projection over every sequence's tokens */
+    Tensor* Q = llama_project(normed, layer->q_proj, layer->q_proj_quant);
+    Tensor* K = llama_project(normed, layer->k_proj, layer->k_proj_quant);
+    Tensor* V = llama_project(normed, layer->v_proj, layer->v_proj_quant);
+    if (Q)
+        tensor_ensure_executed(Q);
+    if (K)
+        tensor_ensure_executed(K);
+    if (V)
+        tensor_ensure_executed(V);
+
+    if (!Q || !K || !V)
+        return NULL;
+
+    CMLRoPEConfig rope_cfg = {
+        .dim         = head_dim,
+        .max_seq_len = cfg->max_seq_len,
+        .base        = cfg->rope_theta
+    };
+
+    /* Per-sequence positions: rotate, then append K/V to the paged cache */
+    const float* k_data = NULL;
+    const float* v_data = NULL;
+    int kv_dim = K->shape[1];
+    for (int i = 0, row = 0; i < num_seqs; row += num_tokens[i], i++) {
+        int start_pos = cache->sequences[seq_ids[i]].seq_len;
+        if (rope_rows(Q, row, num_tokens[i], start_pos, &rope_cfg) != 0 ||
+            rope_rows(K, row, num_tokens[i], start_pos, &rope_cfg) != 0)
+            return NULL;
+
+        k_data = (const float*)tensor_data_ptr(K);
+        v_data = (const float*)tensor_data_ptr(V);
+        for (int t = row; t < row + num_tokens[i]; t++) {
+            if (cml_paged_cache_append(cache, seq_ids[i], k_data + (size_t)t * kv_dim,
+                                       v_data + (size_t)t * kv_dim) != 0)
+                return NULL;
+        }
+    }
+    tensor_free(K);
+    tensor_free(V);
+
+    CMLGQAConfig gqa_cfg = {
+        .num_heads    = cfg->num_heads,
+        .num_kv_heads = cfg->num_kv_heads,
+        .head_dim     = head_dim,
+        .scale        = 0.0f, /* auto: 1/sqrt(head_dim) */
+        .causal       = true
+    };
+
+    int attn_shape[] = {total, Q->shape[1]};
+    Tensor* attn_2d = tensor_empty(attn_shape, 2, NULL);
+    if (!attn_2d) return NULL;
+    tensor_ensure_executed(attn_2d);
+    int rc = cml_paged_attention_batch(cache, seq_ids, num_tokens, num_seqs,
+                                       (const float*)tensor_data_ptr(Q),
+                                       (float*)tensor_data_ptr(attn_2d), &gqa_cfg);
+    tensor_free(Q);
+    if (rc != 0) {
+        tensor_free(attn_2d);
+        return NULL;
+    }
+
+    Tensor* attn_proj = llama_project(attn_2d, layer->o_proj, layer->o_proj_quant);
+    if (attn_proj)
+        tensor_ensure_executed(attn_proj);
+    tensor_free(attn_2d);
+    if (!attn_proj) return NULL;
+
+    Tensor* residual1 = uop_add(hidden, attn_proj);
+    if (residual1)
+        tensor_ensure_executed(residual1);
+    if (!residual1) return NULL;
+
+    Tensor* normed2 = rms_norm(residual1, layer->post_attn_layernorm, cfg->rms_norm_eps);
+    if (!normed2) return NULL;
+
+    Tensor* ffn_out = swiglu_ffn(normed2, layer);
+    if (ffn_out)
+        tensor_ensure_executed(ffn_out);
+    if (!ffn_out) return NULL;
+
+    Tensor* output = uop_add(residual1, ffn_out);
+    if (output)
+        tensor_ensure_executed(output);
+
+    return output;
+}
+
+int cml_llama_forward_paged(CMLLLaMAModel* model, CMLPagedKVCache* const* layer_caches,
+                            const int* const* layer_seq_ids, const int* tokens,
+                            const int* num_tokens, int num_seqs, float* logits) {
+    if (!model || !layer_caches || !layer_seq_ids || !tokens || !num_tokens ||
+        num_seqs <= 0 || !logits) {
+        LOG_ERROR("cml_llama_forward_paged: invalid arguments");
+        return -1;
+    }
+    if (!model->embed_tokens) {
+        LOG_ERROR("cml_llama_forward_paged: embed_tokens not loaded");
+        return -1;
+    }
+
+    int total = 0;
+    for (int i = 0; i < num_seqs; i++) {
+        if (num_tokens[i] <= 0) {
+            LOG_ERROR("cml_llama_forward_paged: sequence %d feeds no tokens", i);
+            return -1;
+        }
+        total += num_tokens[i];
+    }
+
+    Tensor* hidden = embed_tokens_lookup(model->embed_tokens, tokens, total);
+    if (!hidden) {
+        LOG_ERROR("cml_llama_forward_paged: embedding lookup failed");
+        return -1;
+    }
+
+    for (int l = 0; l < model->num_layers; l++) {
+        Tensor* next_hidden = llama_layer_forward_paged(model, model->layers[l],
+                                                        layer_caches[l], layer_seq_ids[l],
+                                                        num_tokens, num_seqs, hidden);
+        if (!next_hidden) {
+            LOG_ERROR("cml_llama_forward_paged: layer %d failed", l);
+            return -1;
+        }
+        hidden = next_hidden;
+    }
+
+    /* Only each sequence's last position needs the final norm and lm_head */
+    tensor_ensure_executed(hidden);
+    int hidden_size = model->config.hidden_size;
+    int last_shape[] = {num_seqs, hidden_size};
+    Tensor* last = tensor_empty(last_shape, 2, NULL);
+    if (!last) return -1;
+    tensor_ensure_executed(last);
+    const float* src = (const float*)tensor_data_ptr(hidden);
+    float* dst = (float*)tensor_data_ptr(last);
+    for (int i = 0, row = 0; i < num_seqs; i++) {
+        row += num_tokens[i];
+        memcpy(dst + (size_t)i * hidden_size, src + (size_t)(row - 1) * hidden_size,
+               (size_t)hidden_size * sizeof(float));
+    }
+
+    if (model->norm) {
+        Tensor* normed = rms_norm(last, model->norm, model->config.rms_norm_eps);
+        if (!normed) {
+            LOG_ERROR("cml_llama_forward_paged: final norm failed");
+            return -1;
+        }
+        last = normed;
+    }
+
+    Tensor* out = llama_lm_head(model, last);
+    if (out)
+        tensor_ensure_executed(out);
+    if (!out || !tensor_data_ptr(out)) {
+        LOG_ERROR("cml_llama_forward_paged: lm_head projection failed");
+        return -1;
+    }
+    memcpy(logits, tensor_data_ptr(out),
+           (size_t)num_seqs * model->config.vocab_size * sizeof(float));
+    tensor_free(out);
+    return 0;
+}
+
 typedef struct {
     float value;
     int index;
@@ -1,6 +1,11 @@
 #include "nn/llm_ops.h"
 #include "tensor/tensor.h"
 #include "core/logging.h"
+#include "backend/threadpool.h"
+#include "backend/blas.h"
+#include <stdatomic.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -853,7 +858,8 @@ CMLMoELayer* cml_moe_create(const CMLMoEConfig* config) {
     /* Expert weights */
     moe->expert_w1 = (Tensor**)calloc((size_t)num_experts, sizeof(Tensor*));
     moe->expert_w2 = (Tensor**)calloc((size_t)num_experts, sizeof(Tensor*));
-    if (!moe->expert_w1 || !moe->expert_w2) {
+    moe->expert_load = (int*)calloc((size_t)num_experts, sizeof(int));
+    if (!moe->expert_w1 || !moe->expert_w2 || !moe->expert_load) {
         LOG_ERROR("cml_moe_create: failed to allocate expert arrays");
         cml_moe_free(moe);
         return NULL;
@@ -898,9 +904,97 @@ void cml_moe_free(CMLMoELayer* moe) {
         }
         free(moe->expert_w2);
     }
+    free(moe->expert_load);
     free(moe);
 }
 
+/* scores[T, E] = softmax(input[T, D] @ gate_weight[D, E]) */
+static int moe_gate_scores(const CMLMoELayer* moe, const float* in, int total_tokens,
+                           float* scores) {
+    const float* gate_w = (const float*)tensor_data_ptr(moe->gate_weight);
+    if (!gate_w) return -1;
+    if (cml_blas_sgemm(NULL, in, gate_w, scores, total_tokens, moe->config.num_experts,
+                       moe->config.input_dim, 1.0f, 0.0f) != 0)
+        return -1;
+    llm_softmax_inplace(scores, total_tokens, moe->config.num_experts);
+    return 0;
+}
+
+typedef struct {
+    const CMLMoELayer* moe;
+    const float* in;
+    const int* offsets;      /* [E + 1] start of each expert's slice */
+    const int* perm_token;   /* Source token of each permuted row */
+    float* x_perm;           /* [routed, D] */
+    float* h_perm;           /* [routed, hidden] */
+    float* y_perm;           /* [routed, D] */
+    _Atomic int failed;
+} MoEExpertArgs;
+
+static void moe_expert_task(void* data, size_t start, size_t end) {
+    MoEExpertArgs* a = (MoEExpertArgs*)data;
+    int D = a->moe->config.input_dim;
+    int H = a->moe->config.hidden_dim;
+
+    /* The experts are the parallelism: their GEMMs run on this thread
+     * instead of nesting another parallel_for inside the pool */
+    size_t saved_budget = threadpool_set_thread_budget(1);
+    for (size_t e = start; e < end; e++) {
+        int row0 = a->offsets[e];
+        int rows = a->offsets[e + 1] - row0;
+        if (rows == 0) continue;
+
+        const float* w1 = (const float*)tensor_data_ptr(a->moe->expert_w1[e]);
+        const float* w2 = (const float*)tensor_data_ptr(a->moe->expert_w2[e]);
+        if (!w1 || !w2) {
+            atomic_store(&a->failed, 1);
+            continue;
+        }
+
+        float* x = a->x_perm + (size_t)row0 * D;
+        float* h = a->h_perm + (size_t)row0 * H;
+        float* y = a->y_perm + (size_t)row0 * D;
+        for (int r = 0; r < rows; r++) {
+            memcpy(x + (size_t)r * D, a->in + (size_t)a->perm_token[row0 + r] * D,
+                   (size_t)D * sizeof(float));
+        }
+
+        /* y = ReLU(x @ W1) @ W2 */
+        if (cml_blas_sgemm(NULL, x, w1, h, rows, H, D, 1.0f, 0.0f) != 0) {
+            atomic_store(&a->failed, 1);
+            continue;
+        }
+        for (size_t i = 0; i < (size_t)rows * H; i++) h[i] = h[i] > 0.0f ? h[i] : 0.0f;
+        if (cml_blas_sgemm(NULL, h, w2, y, rows, D, H, 1.0f, 0.0f) != 0)
+            atomic_store(&a->failed, 1);
+    }
+    threadpool_set_thread_budget(saved_budget);
+}
+
+typedef struct {
+    const float* y_perm;
+    const int* dest;         /* [T, top_k] permuted row, -1 if dropped */
+    const float* weights;    /* [T, top_k] */
+    float* output;
+    int top_k;
+    int dim;
+} MoECombineArgs;
+
+static void moe_combine_task(void* data, size_t start, size_t end) {
+    MoECombineArgs* a = (MoECombineArgs*)data;
+    for (size_t t = start; t < end; t++) {
+        float* out = a->output + t * (size_t)a->dim;
+        memset(out, 0, (size_t)a->dim * sizeof(float));
+        for (int ki = 0; ki < a->top_k; ki++) {
+            int row = a->dest[t * (size_t)a->top_k + ki];
+            if (row < 0) continue;
+            float w = a->weights[t * (size_t)a->top_k + ki];
+            const float* y = a->y_perm + (size_t)row * a->dim;
+            for (int d = 0; d < a->dim; d++) out[d] += w * y[d];
+        }
+    }
+}
+
 Tensor* cml_moe_forward(CMLMoELayer* moe, Tensor* input) {
     if (!moe || !input) {
         LOG_ERROR("cml_moe_forward: NULL argument");
@@ -914,6 +1008,11 @@ Tensor* cml_moe_forward(CMLMoELayer* moe, Tensor* input) {
                   input->ndim);
         return NULL;
     }
+    if (input->shape[2] != moe->config.input_dim) {
+        LOG_ERROR("cml_moe_forward: input dim %d does not match layer dim %d",
+                  input->shape[2], moe->config.input_dim);
+        return NULL;
+    }
 
     int batch = input->shape[0];
     int seq_len = input->shape[1];
@@ -922,164 +1021,172 @@ Tensor* cml_moe_forward(CMLMoELayer* moe, Tensor* input) {
     int num_experts = moe->config.num_experts;
     int top_k = moe->config.top_k;
     int total_tokens = batch * seq_len;
+    size_t num_slots = (size_t)total_tokens * top_k;
 
     float* in_data = (float*)tensor_data_ptr(input);
-    float* gate_w = (float*)tensor_data_ptr(moe->gate_weight);
-
-    if (!in_data || !gate_w) {
+    if (!in_data) {
         LOG_ERROR("cml_moe_forward: failed to get data pointers");
         return NULL;
     }
 
-    /* Step 1: Compute gating scores [total_tokens, num_experts] */
-    float* gate_scores = (float*)calloc((size_t)total_tokens * num_experts, sizeof(float));
-    if (!gate_scores) {
+    float* gate_scores = (float*)malloc((size_t)total_tokens * num_experts * sizeof(float));
+    int* top_k_indices = (int*)malloc(num_slots * sizeof(int));
+    float* top_k_weights = (float*)malloc(num_slots * sizeof(float));
+    int* dest = (int*)malloc(num_slots * sizeof(int));
+    int* perm_token = (int*)malloc(num_slots * sizeof(int));
+    int* offsets = (int*)calloc((size_t)num_experts + 1, sizeof(int));
+    float* output = (float*)malloc((size_t)total_tokens * input_dim * sizeof(float));
+    float* x_perm = NULL;
+    float* h_perm = NULL;
+    float* y_perm = NULL;
+    Tensor* result = NULL;
+
+    if (!gate_scores || !top_k_indices || !top_k_weights || !dest || !perm_token ||
+        !offsets || !output) {
         LOG_ERROR("cml_moe_forward: allocation failed");
-        return NULL;
-    }
-
-    /* gate_scores = input @ gate_weight: [total_tokens, input_dim] @ [input_dim, num_experts] */
-    for (int t = 0; t < total_tokens; t++) {
-        for (int e = 0; e < num_experts; e++) {
-            float sum = 0.0f;
-            for (int d = 0; d < input_dim; d++) {
-                sum += in_data[t * input_dim + d] * gate_w[d * num_experts + e];
-            }
-            gate_scores[t * num_experts + e] = sum;
-        }
+        goto cleanup;
     }
 
-    /* Step 2: Softmax to get routing probabilities */
-    llm_softmax_inplace(gate_scores, total_tokens, num_experts);
-
-    /* Step 3: Find top-k experts per token */
-    int* top_k_indices = (int*)malloc((size_t)total_tokens * top_k * sizeof(int));
-    float* top_k_weights = (float*)malloc((size_t)total_tokens * top_k * sizeof(float));
-    if (!top_k_indices || !top_k_weights) {
-        LOG_ERROR("cml_moe_forward: allocation failed");
-        free(gate_scores);
-        free(top_k_indices);
-        free(top_k_weights);
-        return NULL;
+    /* Step 1: Routing probabilities [total_tokens, num_experts] */
+    if (moe_gate_scores(moe, in_data, total_tokens, gate_scores) != 0) {
+        LOG_ERROR("cml_moe_forward: gate projection failed");
+        goto cleanup;
     }
 
+    /* Step 2: Top-k experts per token by repeated argmax */
     for (int t = 0; t < total_tokens; t++) {
-        float* row = gate_scores + t * num_experts;
-
-        /* Simple selection of top-k by repeated argmax */
-        bool* selected = (bool*)calloc((size_t)num_experts, sizeof(bool));
-        if (!selected) {
-            free(gate_scores);
-            free(top_k_indices);
-            free(top_k_weights);
-            return NULL;
-        }
+        const float* row = gate_scores + (size_t)t * num_experts;
+        int* idx = top_k_indices + (size_t)t * top_k;
+        float* w = top_k_weights + (size_t)t * top_k;
 
         for (int ki = 0; ki < top_k; ki++) {
             int best_idx = -1;
             float best_val = -1e30f;
             for (int e = 0; e < num_experts; e++) {
-                if (!selected[e] && row[e] > best_val) {
+                bool taken = false;
+                for (int j = 0; j < ki; j++) taken |= idx[j] == e;
+                if (!taken && row[e] > best_val) {
                     best_val = row[e];
                     best_idx = e;
                 }
             }
-            top_k_indices[t * top_k + ki] = best_idx;
-            top_k_weights[t * top_k + ki] = best_val;
-            if (best_idx >= 0) selected[best_idx] = true;
+            idx[ki] = best_idx;
+            w[ki] = best_val;
         }
-        free(selected);
 
         /* Optionally re-normalize top-k weights to sum to 1 */
         if (moe->config.normalize_weights) {
             float w_sum = 0.0f;
-            for (int ki = 0; ki < top_k; ki++) {
-                w_sum += top_k_weights[t * top_k + ki];
-            }
+            for (int ki = 0; ki < top_k; ki++) w_sum += w[ki];
             if (w_sum > 0.0f) {
                 float inv = 1.0f / w_sum;
-                for (int ki = 0; ki < top_k; ki++) {
-                    top_k_weights[t * top_k + ki] *= inv;
-                }
+                for (int ki = 0; ki < top_k; ki++) w[ki] *= inv;
             }
         }
     }
 
-    free(gate_scores);
-
-    /* Step 4: Compute expert outputs and combine */
-    float* output = (float*)calloc((size_t)total_tokens * input_dim, sizeof(float));
-    float* expert_hidden = (float*)malloc((size_t)hidden_dim * sizeof(float));
-    float* expert_out = (float*)malloc((size_t)input_dim * sizeof(float));
-
-    if (!output || !expert_hidden || !expert_out) {
-        LOG_ERROR("cml_moe_forward: allocation failed");
-        free(output);
-        free(expert_hidden);
-        free(expert_out);
-        free(top_k_indices);
-        free(top_k_weights);
-        return NULL;
+    /* Step 3: Group assignments by expert. Tokens claim expert slots in order
+     * and anything past the capacity is dropped. */
+    int capacity = 0;
+    if (moe->config.capacity_factor > 0.0f) {
+        capacity = (int)ceilf(moe->config.capacity_factor * (float)num_slots /
+                              (float)num_experts);
+        if (capacity < 1) capacity = 1;
+    }
+
+    int* load = moe->expert_load;
+    memset(load, 0, (size_t)num_experts * sizeof(int));
+    int dropped = 0;
+    for (size_t s = 0; s < num_slots; s++) {
+        int e = top_k_indices[s];
+        if (e < 0 || (capacity > 0 && load[e] >= capacity)) {
+            dest[s] = -1;
+            dropped += e >= 0;
+            continue;
+        }
+        dest[s] = load[e]++;
     }
 
-    for (int t = 0; t < total_tokens; t++) {
-        float* token_in = in_data + t * input_dim;
-        float* token_out = output + t * input_dim;
-
-        for (int ki = 0; ki < top_k; ki++) {
-            int expert_idx = top_k_indices[t * top_k + ki];
-            float weight = top_k_weights[t * top_k + ki];
-
-            if (expert_idx < 0 || expert_idx >= num_experts) continue;
-
-            float* w1_data = (float*)tensor_data_ptr(moe->expert_w1[expert_idx]);
-            float* w2_data = (float*)tensor_data_ptr(moe->expert_w2[expert_idx]);
-            if (!w1_data || !w2_data) continue;
-
-            /* hidden = ReLU(input @ W1): [input_dim] @ [input_dim, hidden_dim] -> [hidden_dim] */
-            for (int h = 0; h < hidden_dim; h++) {
-                float sum = 0.0f;
-                for (int d = 0; d < input_dim; d++) {
-                    sum += token_in[d] * w1_data[d * hidden_dim + h];
-                }
-                /* ReLU */
-                expert_hidden[h] = sum > 0.0f ? sum : 0.0f;
-            }
+    for (int e = 0; e < num_experts; e++) offsets[e + 1] = offsets[e] + load[e];
+    int routed = offsets[num_experts];
+    for (size_t s = 0; s < num_slots; s++) {
+        if (dest[s] < 0) continue;
+        dest[s] += offsets[top_k_indices[s]];
+        perm_token[dest[s]] = (int)(s / (size_t)top_k);
+    }
 
-            /* out = hidden @ W2: [hidden_dim] @ [hidden_dim, input_dim] -> [input_dim] */
-            for (int d = 0; d < input_dim; d++) {
-                float sum = 0.0f;
-                for (int h = 0; h < hidden_dim; h++) {
-                    sum += expert_hidden[h] * w2_data[h * input_dim + d];
-                }
-                expert_out[d] = sum;
-            }
+    CMLMoEStats* st = &moe->stats;
+    st->num_tokens = total_tokens;
+    st->num_routed = routed;
+    st->num_dropped = dropped;
+    st->capacity = capacity;
+    st->max_load = 0;
+    st->min_load = load[0];
+    for (int e = 0; e < num_experts; e++) {
+        if (load[e] > st->max_load) st->max_load = load[e];
+        if (load[e] < st->min_load) st->min_load = load[e];
+    }
+    st->imbalance = routed > 0 ? (float)st->max_load * num_experts / (float)routed : 0.0f;
+
+    /* Step 4: Each expert gathers its rows and runs two GEMMs over them */
+    if (routed > 0) {
+        x_perm = (float*)malloc((size_t)routed * input_dim * sizeof(float));
+        h_perm = (float*)malloc((size_t)routed * hidden_dim * sizeof(float));
+        y_perm = (float*)malloc((size_t)routed * input_dim * sizeof(float));
+        if (!x_perm || !h_perm || !y_perm) {
+            LOG_ERROR("cml_moe_forward: allocation failed");
+            goto cleanup;
+        }
 
-            /* Weighted accumulation */
-            for (int d = 0; d < input_dim; d++) {
-                token_out[d] += weight * expert_out[d];
-            }
+        MoEExpertArgs ea = {moe, in_data, offsets, perm_token, x_perm, h_perm, y_perm, 0};
+        threadpool_parallel_for_grain(threadpool_get_global(), moe_expert_task, &ea,
+                                      (size_t)num_experts, 1);
+        if (atomic_load(&ea.failed)) {
+            LOG_ERROR("cml_moe_forward: expert computation failed");
+            goto cleanup;
         }
     }
 
-    free(expert_hidden);
-    free(expert_out);
-    free(top_k_indices);
-    free(top_k_weights);
+    /* Step 5: Scatter back, weighting each expert's output */
+    MoECombineArgs ca = {y_perm, dest, top_k_weights, output, top_k, input_dim};
+    threadpool_parallel_for(threadpool_get_global(), moe_combine_task, &ca,
+                            (size_t)total_tokens);
 
     /* Create output tensor [batch, seq_len, input_dim] */
     int out_shape[] = {batch, seq_len, input_dim};
     TensorConfig out_cfg = {.dtype = input->dtype, .device = input->device,
                             .has_dtype = true, .has_device = true};
-    Tensor* result = tensor_from_data(output, out_shape, 3, &out_cfg);
-    free(output);
-
+    result = tensor_from_data(output, out_shape, 3, &out_cfg);
     if (!result) {
         LOG_ERROR("cml_moe_forward: failed to create output tensor");
     }
+
+cleanup:
+    free(gate_scores);
+    free(top_k_indices);
+    free(top_k_weights);
+    free(dest);
+    free(perm_token);
+    free(offsets);
+    free(output);
+    free(x_perm);
+    free(h_perm);
+    free(y_perm);
     return result;
 }
 
+int cml_moe_get_stats(const CMLMoELayer* moe, CMLMoEStats* stats, int* expert_load) {
+    if (!moe || !stats) {
+        LOG_ERROR("cml_moe_get_stats: NULL argument");
+        return -1;
+    }
+    *stats = moe->stats;
+    if (expert_load) {
+        memcpy(expert_load, moe->expert_load, (size_t)moe->config.num_experts * sizeof(int));
+    }
+    return 0;
+}
+
 Tensor* cml_moe_get_routing(CMLMoELayer* moe, Tensor* input) {
     if (!moe || !input) {
         LOG_ERROR("cml_moe_get_routing: NULL argument");
@@ -1100,35 +1207,30 @@ Tensor* cml_moe_get_routing(CMLMoELayer* moe, Tensor* input) {
 
     int input_dim = moe->config.input_dim;
     int num_experts = moe->config.num_experts;
+    if (input->shape[input->ndim - 1] != input_dim) {
+        LOG_ERROR("cml_moe_get_routing: input dim %d does not match layer dim %d",
+                  input->shape[input->ndim - 1], input_dim);
+        return NULL;
+    }
 
     float* in_data = (float*)tensor_data_ptr(input);
-    float* gate_w = (float*)tensor_data_ptr(moe->gate_weight);
-
-    if (!in_data || !gate_w) {
+    if (!in_data) {
         LOG_ERROR("cml_moe_get_routing: failed to get data pointers");
         return NULL;
     }
 
-    float* routing = (float*)calloc((size_t)total_tokens * num_experts, sizeof(float));
+    float* routing = (float*)malloc((size_t)total_tokens * num_experts * sizeof(float));
     if (!routing) {
         LOG_ERROR("cml_moe_get_routing: allocation failed");
         return NULL;
     }
 
-    /* routing = input @ gate_weight */
-    for (int t = 0; t < total_tokens; t++) {
-        for (int e = 0; e < num_experts; e++) {
-            float sum = 0.0f;
-            for (int d = 0; d < input_dim; d++) {
-                sum += in_data[t * input_dim + d] * gate_w[d * num_experts + e];
-            }
-            routing[t * num_experts + e] = sum;
-        }
+    if (moe_gate_scores(moe, in_data, total_tokens, routing) != 0) {
+        LOG_ERROR("cml_moe_get_routing: gate projection failed");
+        free(routing);
+        return NULL;
     }
 
-    /* Softmax */
-    llm_softmax_inplace(routing, total_tokens, num_experts);
-
     int out_shape[] = {total_tokens, num_experts};
     TensorConfig out_cfg = {.dtype = DTYPE_FLOAT32, .device = DEVICE_CPU,
                             .has_dtype = true, .has_device = true};
@@ -1137,6 +1239,348 @@ Tensor* cml_moe_get_routing(CMLMoELayer* moe, Tensor* input) {
     return result;
 }
 
+/* Byte-level BPE.
+ *
+ * Merge rules are turned into a (left id, right id) -> rank table when the
+ * tokenizer is created: every split of a merge string whose halves are both
+ * in the vocab becomes an entry, and the lowest rank wins. A word is encoded
+ * by mapping its bytes to ids, linking them in a list and repeatedly merging
+ * the best pair popped from a binary heap. Stale heap entries are skipped on
+ * pop instead of being removed.
+ */
+
+#define BPE_EMPTY_KEY UINT64_MAX
+#define BPE_DEAD (-2)
+#define BPE_CACHE_SLOTS 512
+#define BPE_CACHE_WORD 24
+
+typedef struct BPEPair {
+    uint64_t key; /* left id << 32 | right id */
+    int rank;
+    int id;
+} BPEPair;
+
+typedef struct BPETable {
+    int byte_to_id[256];
+    BPEPair* pairs;
+    size_t pair_mask;
+    uint32_t serial; /* Tags this tokenizer's word cache entries */
+} BPETable;
+
+typedef struct BPEHeapItem {
+    int rank;
+    int pos;   /* Left symbol */
+    int rpos;  /* Right symbol when pushed */
+    int left;  /* Ids when pushed, to spot stale entries */
+    int right;
+} BPEHeapItem;
+
+typedef struct BPEWork {
+    int* ids;
+    int* prev;
+    int* next;
+    BPEHeapItem* heap;
+    size_t heap_len;
+    size_t cap;
+} BPEWork;
+
+typedef struct BPECacheEntry {
+    uint32_t serial; /* 0 = empty */
+    uint8_t len;
+    uint8_t count;
+    char word[BPE_CACHE_WORD];
+    int ids[BPE_CACHE_WORD]; /* Raw ids, -1 for bytes outside the vocab */
+} BPECacheEntry;
+
+/* A thread's word cache, linked into a global list so cml_tokenizer_cleanup
+ * can free the pool workers' caches too. Cleanup bumps the epoch, which
+ * tells every thread its cache pointer is gone. */
+typedef struct BPECache {
+    struct BPECache* next;
+    BPECacheEntry slots[BPE_CACHE_SLOTS];
+} BPECache;
+
+static _Atomic uint32_t g_bpe_serial;
+static BPECache* g_bpe_caches;
+static _Atomic uint32_t g_bpe_cache_epoch;
+static pthread_mutex_t g_bpe_caches_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local BPECache* tl_bpe_cache;
+static _Thread_local uint32_t tl_bpe_cache_epoch;
+
+static inline uint64_t bpe_pair_key(int left, int right) {
+    return ((uint64_t)(uint32_t)left << 32) | (uint32_t)right;
+}
+
+static inline size_t bpe_pair_slot(uint64_t key, size_t mask) {
+    uint64_t h = key * 0x9E3779B97F4A7C15ull;
+    return (size_t)(h ^ (h >> 29)) & mask;
+}
+
+static const BPEPair* bpe_pair_find(const BPETable* t, int left, int right) {
+    uint64_t key = bpe_pair_key(left, right);
+    for (size_t i = bpe_pair_slot(key, t->pair_mask);; i = (i + 1) & t->pair_mask) {
+        const BPEPair* p = &t->pairs[i];
+        if (p->key == key) return p;
+        if (p->key == BPE_EMPTY_KEY) return NULL;
+    }
+}
+
+static void bpe_pair_insert(BPETable* t, int left, int right, int rank, int id) {
+    uint64_t key = bpe_pair_key(left, right);
+    for (size_t i = bpe_pair_slot(key, t->pair_mask);; i = (i + 1) & t->pair_mask) {
+        BPEPair* p = &t->pairs[i];
+        if (p->key == key) return; /* An earlier merge already owns this pair */
+        if (p->key == BPE_EMPTY_KEY) {
+            p->key = key;
+            p->rank = rank;
+            p->id = id;
+            return;
+        }
+    }
+}
+
+static void bpe_table_free(BPETable* t) {
+    if (!t) return;
+    free(t->pairs);
+    free(t);
+}
+
+static BPETable* bpe_table_build(const CMLTokenizer* tok) {
+    BPETable* t = (BPETable*)calloc(1, sizeof(BPETable));
+    if (!t) return NULL;
+
+    t->serial = atomic_fetch_add(&g_bpe_serial, 1) + 1;
+    for (int b = 0; b < 256; b++) {
+        char key[2] = {(char)b, '\0'};
+        t->byte_to_id[b] = b ? hash_lookup(tok->token_to_id, tok->hash_size, tok->vocab, key)
+                             : -1;
+    }
+
+    size_t max_pairs = 0, max_len = 0;
+    for (int m = 0; m < tok->num_merges; m++) {
+        if (!tok->merges || !tok->merges[m].pair || tok->merges[m].new_token_id < 0) continue;
+        size_t len = strlen(tok->merges[m].pair);
+        if (len > 1) max_pairs += len - 1;
+        if (len > max_len) max_len = len;
+    }
+
+    size_t cap = 16;
+    while (cap < 2 * max_pairs) cap <<= 1;
+    t->pairs = (BPEPair*)malloc(cap * sizeof(BPEPair));
+    char* buf = (char*)malloc(max_len + 1);
+    if (!t->pairs || !buf) {
+        free(buf);
+        bpe_table_free(t);
+        return NULL;
+    }
+    t->pair_mask = cap - 1;
+    for (size_t i = 0; i < cap; i++) t->pairs[i].key = BPE_EMPTY_KEY;
+
+    for (int m = 0; m < tok->num_merges; m++) {
+        if (!tok->merges || !tok->merges[m].pair || tok->merges[m].new_token_id < 0) continue;
+        const char* s = tok->merges[m].pair;
+        size_t len = strlen(s);
+        for (size_t k = 1; k < len; k++) {
+            memcpy(buf, s, k);
+            buf[k] = '\0';
+            int left = hash_lookup(tok->token_to_id, tok->hash_size, tok->vocab, buf);
+            if (left < 0) continue;
+            int right = hash_lookup(tok->token_to_id, tok->hash_size, tok->vocab, s + k);
+            if (right < 0) continue;
+            bpe_pair_insert(t, left, right, m, tok->merges[m].new_token_id);
+        }
+    }
+    free(buf);
+    return t;
+}
+
+static int bpe_work_reserve(BPEWork* w, size_t n) {
+    if (n <= w->cap) return 0;
+    size_t cap = w->cap ? w->cap : 64;
+    while (cap < n) cap *= 2;
+    int* ids = (int*)realloc(w->ids, cap * sizeof(int));
+    if (ids) w->ids = ids;
+    int* prev = (int*)realloc(w->prev, cap * sizeof(int));
+    if (prev) w->prev = prev;
+    int* next = (int*)realloc(w->next, cap * sizeof(int));
+    if (next) w->next = next;
+    /* Each merge pops one entry and pushes at most two */
+    BPEHeapItem* heap = (BPEHeapItem*)realloc(w->heap, 3 * cap * sizeof(BPEHeapItem));
+    if (heap) w->heap = heap;
+    if (!ids || !prev || !next || !heap) return -1;
+    w->cap = cap;
+    return 0;
+}
+
+static void bpe_work_free(BPEWork* w) {
+    free(w->ids);
+    free(w->prev);
+    free(w->next);
+    free(w->heap);
+}
+
+static inline bool bpe_heap_less(const BPEHeapItem* a, const BPEHeapItem* b) {
+    return a->rank < b->rank || (a->rank == b->rank && a->pos < b->pos);
+}
+
+static void bpe_push_pair(const BPETable* t, BPEWork* w, int pos, int rpos) {
+    int left = w->ids[pos], right = w->ids[rpos];
+    if (left < 0 || right < 0) return;
+    const BPEPair* p = bpe_pair_find(t, left, right);
+    if (!p) return;
+
+    BPEHeapItem item = {p->rank, pos, rpos, left, right};
+    size_t i = w->heap_len++;
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!bpe_heap_less(&item, &w->heap[parent])) break;
+        w->heap[i] = w->heap[parent];
+        i = parent;
+    }
+    w->heap[i] = item;
+}
+
+static BPEHeapItem bpe_pop(BPEWork* w) {
+    BPEHeapItem top = w->heap[0];
+    BPEHeapItem last = w->heap[--w->heap_len];
+    size_t n = w->heap_len, i = 0;
+    for (;;) {
+        size_t c = 2 * i + 1;
+        if (c >= n) break;
+        if (c + 1 < n && bpe_heap_less(&w->heap[c + 1], &w->heap[c])) c++;
+        if (!bpe_heap_less(&w->heap[c], &last)) break;
+        w->heap[i] = w->heap[c];
+        i = c;
+    }
+    if (n > 0) w->heap[i] = last;
+    return top;
+}
+
+/* Writes the raw ids of word[0..n) to out and returns how many */
+static int bpe_encode_word(const BPETable* t, BPEWork* w, const unsigned char* word, int n,
+                           int* out) {
+    for (int i = 0; i < n; i++) {
+        w->ids[i] = t->byte_to_id[word[i]];
+        w->prev[i] = i - 1;
+        w->next[i] = i + 1 < n ? i + 1 : -1;
+    }
+
+    w->heap_len = 0;
+    for (int i = 0; i + 1 < n; i++) bpe_push_pair(t, w, i, i + 1);
+
+    while (w->heap_len > 0) {
+        BPEHeapItem it = bpe_pop(w);
+        if (w->ids[it.pos] != it.left || w->next[it.pos] != it.rpos ||
+            w->ids[it.rpos] != it.right)
+            continue;
+
+        w->ids[it.pos] = bpe_pair_find(t, it.left, it.right)->id;
+        w->ids[it.rpos] = BPE_DEAD;
+        int nx = w->next[it.rpos];
+        w->next[it.pos] = nx;
+        if (nx >= 0) w->prev[nx] = it.pos;
+
+        if (w->prev[it.pos] >= 0) bpe_push_pair(t, w, w->prev[it.pos], it.pos);
+        if (nx >= 0) bpe_push_pair(t, w, it.pos, nx);
+    }
+
+    int count = 0;
+    for (int i = 0; i >= 0; i = w->next[i]) out[count++] = w->ids[i];
+    return count;
+}
+
+enum { BPE_CLASS_SPACE, BPE_CLASS_LETTER, BPE_CLASS_DIGIT, BPE_CLASS_OTHER };
+
+static inline int bpe_class(unsigned char c) {
+    if (c == ' ' || (c >= '\t' && c <= '\r')) return BPE_CLASS_SPACE;
+    if ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') return BPE_CLASS_LETTER;
+    if (c >= 0x80) return BPE_CLASS_LETTER; /* Keep UTF-8 sequences inside words */
+    if (c >= '0' && c <= '9') return BPE_CLASS_DIGIT;
+    return BPE_CLASS_OTHER;
+}
+
+/* Length of the word starting at s[0]; GPT-2 style, minus the contraction rules */
+static size_t bpe_next_word(const unsigned char* s, size_t n) {
+    size_t j = 1;
+    int cls = bpe_class(s[0]);
+    if (cls == BPE_CLASS_SPACE) {
+        if (s[0] == ' ' && n > 1 && bpe_class(s[1]) != BPE_CLASS_SPACE) {
+            cls = bpe_class(s[1]);
+            j = 2;
+        } else {
+            while (j < n && bpe_class(s[j]) == BPE_CLASS_SPACE) j++;
+            /* Leave a trailing space to lead the next word */
+            if (j < n && j > 1 && s[j - 1] == ' ') j--;
+            return j;
+        }
+    }
+    while (j < n && bpe_class(s[j]) == cls) j++;
+    return j;
+}
+
+static uint32_t bpe_word_hash(const unsigned char* s, size_t n) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; i++) {
+        h ^= s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static BPECache* bpe_thread_cache(void) {
+    if (tl_bpe_cache && tl_bpe_cache_epoch == atomic_load(&g_bpe_cache_epoch))
+        return tl_bpe_cache;
+    pthread_mutex_lock(&g_bpe_caches_lock);
+    if (tl_bpe_cache && tl_bpe_cache_epoch != g_bpe_cache_epoch)
+        tl_bpe_cache = NULL; /* Freed by cml_tokenizer_cleanup */
+    if (!tl_bpe_cache) {
+        tl_bpe_cache = (BPECache*)calloc(1, sizeof(BPECache));
+        if (tl_bpe_cache) {
+            tl_bpe_cache->next = g_bpe_caches;
+            g_bpe_caches       = tl_bpe_cache;
+            tl_bpe_cache_epoch = g_bpe_cache_epoch;
+        }
+    }
+    BPECache* cache = tl_bpe_cache;
+    pthread_mutex_unlock(&g_bpe_caches_lock);
+    return cache;
+}
+
+static int bpe_encode_word_cached(const BPETable* t, BPEWork* w, const unsigned char* word,
+                                  int n, int* out) {
+    if (n > BPE_CACHE_WORD) return bpe_encode_word(t, w, word, n, out);
+
+    BPECache* cache = bpe_thread_cache();
+    if (!cache) return bpe_encode_word(t, w, word, n, out);
+
+    BPECacheEntry* e =
+        &cache->slots[(bpe_word_hash(word, (size_t)n) ^ t->serial) & (BPE_CACHE_SLOTS - 1)];
+    if (e->serial == t->serial && e->len == n && memcmp(e->word, word, (size_t)n) == 0) {
+        memcpy(out, e->ids, (size_t)e->count * sizeof(int));
+        return e->count;
+    }
+
+    int count = bpe_encode_word(t, w, word, n, out);
+    e->serial = t->serial;
+    e->len = (uint8_t)n;
+    e->count = (uint8_t)count;
+    memcpy(e->word, word, (size_t)n);
+    memcpy(e->ids, out, (size_t)count * sizeof(int));
+    return count;
+}
+
+void cml_tokenizer_cleanup(void) {
+    pthread_mutex_lock(&g_bpe_caches_lock);
+    while (g_bpe_caches) {
+        BPECache* next = g_bpe_caches->next;
+        free(g_bpe_caches);
+        g_bpe_caches = next;
+    }
+    g_bpe_cache_epoch++;
+    tl_bpe_cache = NULL;
+    pthread_mutex_unlock(&g_bpe_caches_lock);
+}
+
 CMLTokenizer* cml_tokenizer_create(char** vocab, int vocab_size,
                                      char** merge_pairs, int num_merges) {
     if (!vocab || vocab_size <= 0) {
@@ -1224,6 +1668,13 @@ CMLTokenizer* cml_tokenizer_create(char** vocab, int vocab_size,
     } else {
         tok->merges = NULL;
     }
+
+    tok->bpe = bpe_table_build(tok);
+    if (!tok->bpe) {
+        LOG_ERROR("cml_tokenizer_create: failed to build merge table");
+        cml_tokenizer_free(tok);
+        return NULL;
+    }
     return tok;
 }
 
@@ -1244,6 +1695,7 @@ void cml_tokenizer_free(CMLTokenizer* tok) {
         free(tok->merges);
     }
 
+    bpe_table_free((BPETable*)tok->bpe);
     free(tok->token_to_id);
     free(tok);
 }
@@ -1254,104 +1706,92 @@ int* cml_tokenizer_encode(CMLTokenizer* tok, const char* text, int* num_tokens)
         if (num_tokens) *num_tokens = 0;
         return NULL;
     }
+    *num_tokens = 0;
 
-    int text_len = (int)strlen(text);
-    if (text_len == 0) {
-        *num_tokens = 0;
+    size_t text_len = strlen(text);
+    if (text_len == 0) return NULL;
+    if (text_len > INT32_MAX) {
+        LOG_ERROR("cml_tokenizer_encode: text too long (%zu bytes)", text_len);
         return NULL;
     }
 
-    /* Step 1: Split text into initial character tokens.
-     * Each character becomes a separate token string. */
-    int capacity = text_len + 16;
-    int count = 0;
-    char** tokens = (char**)malloc((size_t)capacity * sizeof(char*));
-    if (!tokens) {
-        *num_tokens = 0;
+    /* Merges only shrink a word, so the byte count bounds the output */
+    int* ids = (int*)malloc(text_len * sizeof(int));
+    if (!ids) {
+        LOG_ERROR("cml_tokenizer_encode: allocation failed");
         return NULL;
     }
 
-    for (int i = 0; i < text_len; i++) {
-        char buf[2] = {text[i], '\0'};
-        tokens[count] = strdup(buf);
-        if (!tokens[count]) {
-            for (int j = 0; j < count; j++) free(tokens[j]);
-            free(tokens);
-            *num_tokens = 0;
+    const BPETable* t = (const BPETable*)tok->bpe;
+    const unsigned char* s = (const unsigned char*)text;
+    BPEWork work = {0};
+    int count = 0;
+    for (size_t pos = 0; pos < text_len;) {
+        size_t len = bpe_next_word(s + pos, text_len - pos);
+        if (bpe_work_reserve(&work, len) != 0) {
+            LOG_ERROR("cml_tokenizer_encode: allocation failed");
+            bpe_work_free(&work);
+            free(ids);
             return NULL;
         }
-        count++;
-    }
-
-    /* Step 2: Iteratively apply BPE merges.
-     * For each merge rule (in priority order), scan the token list for
-     * adjacent pairs that concatenate to the merge's pair string,
-     * and merge them. */
-    for (int m = 0; m < tok->num_merges && count > 1; m++) {
-        if (!tok->merges[m].pair) continue;
-        const char* merge_str = tok->merges[m].pair;
-        size_t merge_len = strlen(merge_str);
-
-        bool found = true;
-        while (found && count > 1) {
-            found = false;
-            for (int i = 0; i < count - 1; i++) {
-                /* Check if tokens[i] + tokens[i+1] == merge_str */
-                size_t len_a = strlen(tokens[i]);
-                size_t len_b = strlen(tokens[i + 1]);
-                if (len_a + len_b != merge_len) continue;
-
-                /* Build concatenated string to compare */
-                char* concat = (char*)malloc(merge_len + 1);
-                if (!concat) continue;
-                memcpy(concat, tokens[i], len_a);
-                memcpy(concat + len_a, tokens[i + 1], len_b);
-                concat[merge_len] = '\0';
-
-                if (strcmp(concat, merge_str) == 0) {
-                    /* Merge: replace tokens[i] with the merged string, remove tokens[i+1] */
-                    free(tokens[i]);
-                    tokens[i] = concat;
-                    free(tokens[i + 1]);
-                    /* Shift remaining tokens left */
-                    for (int j = i + 1; j < count - 1; j++) {
-                        tokens[j] = tokens[j + 1];
-                    }
-                    count--;
-                    found = true;
-                    break; /* restart scan for this merge rule */
-                } else {
-                    free(concat);
-                }
-            }
-        }
-    }
-
-    /* Step 3: Convert token strings to IDs */
-    int* ids = (int*)malloc((size_t)count * sizeof(int));
-    if (!ids) {
-        for (int i = 0; i < count; i++) free(tokens[i]);
-        free(tokens);
-        *num_tokens = 0;
-        return NULL;
+        count += bpe_encode_word_cached(t, &work, s + pos, (int)len, ids + count);
+        pos += len;
     }
+    bpe_work_free(&work);
 
+    int unk = tok->unk_token_id >= 0 ? tok->unk_token_id : 0;
     for (int i = 0; i < count; i++) {
-        int id = hash_lookup(tok->token_to_id, tok->hash_size, tok->vocab, tokens[i]);
-        if (id >= 0) {
-            ids[i] = id;
-        } else {
-            /* Unknown token */
-            ids[i] = tok->unk_token_id >= 0 ? tok->unk_token_id : 0;
-        }
-        free(tokens[i]);
+        if (ids[i] < 0) ids[i] = unk;
     }
-    free(tokens);
 
     *num_tokens = count;
     return ids;
 }
 
+typedef struct {
+    CMLTokenizer* tok;
+    const char* const* texts;
+    int** tokens;
+    int* num_tokens;
+    _Atomic int failed;
+} TokenizerBatchArgs;
+
+static void tokenizer_batch_task(void* data, size_t start, size_t end) {
+    TokenizerBatchArgs* a = (TokenizerBatchArgs*)data;
+    for (size_t i = start; i < end; i++) {
+        a->tokens[i] = NULL;
+        a->num_tokens[i] = 0;
+        if (!a->texts[i]) {
+            atomic_store(&a->failed, 1);
+            continue;
+        }
+        a->tokens[i] = cml_tokenizer_encode(a->tok, a->texts[i], &a->num_tokens[i]);
+        if (!a->tokens[i] && a->texts[i][0] != '\0') atomic_store(&a->failed, 1);
+    }
+}
+
+int cml_tokenizer_encode_batch(CMLTokenizer* tok, const char* const* texts, int num_texts,
+                               int** tokens, int* num_tokens) {
+    if (!tok || !texts || !tokens || !num_tokens || num_texts < 0) {
+        LOG_ERROR("cml_tokenizer_encode_batch: invalid arguments");
+        return -1;
+    }
+
+    TokenizerBatchArgs args = {tok, texts, tokens, num_tokens, 0};
+    threadpool_parallel_for(threadpool_get_global(), tokenizer_batch_task, &args,
+                            (size_t)num_texts);
+    if (atomic_load(&args.failed)) {
+        LOG_ERROR("cml_tokenizer_encode_batch: failed to encode some prompts");
+        for (int i = 0; i < num_texts; i++) {
+            free(tokens[i]);
+            tokens[i]     = NULL;
+            num_tokens[i] = 0;
+        }
+        return -1;
+    }
+    return 0;
+}
+
 char* cml_tokenizer_decode(CMLTokenizer* tok, const int* tokens, int num_tokens) {
     if (!tok || !tokens || num_tokens <= 0) {
         LOG_ERROR("cml_tokenizer_decode: invalid arguments");
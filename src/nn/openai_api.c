@@ -1,20 +1,29 @@
 #include "nn/openai_api.h"
 #include "nn/llama.h"
 #include "nn/llm_ops.h"
+#include "nn/paged_attention.h"
+#include "nn/serving.h"
 #include "core/logging.h"
 
 #include <arpa/inet.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <netinet/tcp.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <time.h>
 #include <unistd.h>
 
-#define HTTP_BUF_SIZE  (256 * 1024)
-#define MAX_MESSAGES   64
+#define HTTP_BUF_SIZE   (256 * 1024)        /* Largest request accepted */
+#define HTTP_OUT_LIMIT  (8 * 1024 * 1024)   /* Unsent bytes before a client is dropped */
+#define MAX_MESSAGES    64
+#define MAX_EVENTS      256
 
 /* Minimal JSON helpers */
 
@@ -107,37 +116,358 @@ static int parse_messages(const char* json, ChatMessage* msgs, int max_msgs) {
     return count;
 }
 
-/* HTTP helpers */
+static char* json_escape(const char* s) {
+    size_t len = strlen(s);
+    char* out = (char*)malloc(len * 6 + 1);
+    if (!out) return NULL;
+
+    size_t o = 0;
+    for (const unsigned char* p = (const unsigned char*)s; *p; p++) {
+        switch (*p) {
+        case '"':  out[o++] = '\\'; out[o++] = '"'; break;
+        case '\\': out[o++] = '\\'; out[o++] = '\\'; break;
+        case '\n': out[o++] = '\\'; out[o++] = 'n'; break;
+        case '\r': out[o++] = '\\'; out[o++] = 'r'; break;
+        case '\t': out[o++] = '\\'; out[o++] = 't'; break;
+        default:
+            if (*p < 0x20) o += (size_t)sprintf(out + o, "\\u%04x", *p);
+            else out[o++] = (char)*p;
+        }
+    }
+    out[o] = '\0';
+    return out;
+}
+
+/* Generation engine
+ *
+ * Chat completions are submitted to a continuous-batching scheduler whose
+ * forward step runs every scheduled sequence through one packed LLaMA pass.
+ * The scheduler owns the paged KV pool of layer 0; the other layers keep
+ * pools of the same size whose sequences shadow the scheduler's. */
+
+typedef struct {
+    CMLLLaMAModel* model;
+    CMLServingContext* serving;
+    CMLPagedKVCache** caches;  /* [num_layers]; caches[0] is the scheduler's */
+    int** seq_map;             /* [layer][scheduler seq] -> seq in caches[layer] */
+    int** seq_ids;             /* [layer][entry] per-step scratch */
+    int* tokens;
+    int* num_tokens;
+    float* logits;             /* [max_batch, vocab_size] */
+} GenEngine;
+
+static int engine_forward(void* user_data, CMLPagedKVCache* cache,
+                          const CMLServingBatchEntry* entries, int num_entries,
+                          int* next_tokens) {
+    GenEngine* eng = (GenEngine*)user_data;
+    int num_layers = eng->model->num_layers;
+
+    /* Drop shadows of sequences the scheduler released */
+    for (int l = 1; l < num_layers; l++) {
+        for (int s = 0; s < cache->max_sequences; s++) {
+            if (eng->seq_map[l][s] >= 0 && !cache->sequences[s].block_ids) {
+                cml_paged_cache_free_sequence(eng->caches[l], eng->seq_map[l][s]);
+                eng->seq_map[l][s] = -1;
+            }
+        }
+    }
 
-static int recv_http_request(int fd, char* buf, size_t buf_size) {
-    size_t total = 0;
-    while (total < buf_size - 1) {
-        ssize_t n = recv(fd, buf + total, buf_size - 1 - total, 0);
-        if (n <= 0) return (total > 0) ? (int)total : -1;
-        total += (size_t)n;
-        buf[total] = '\0';
-        if (strstr(buf, "\r\n\r\n")) {
-            char* cl = strstr(buf, "Content-Length:");
-            if (!cl) cl = strstr(buf, "content-length:");
-            if (cl) {
-                int content_len = atoi(cl + 15);
-                char* body = strstr(buf, "\r\n\r\n") + 4;
-                size_t body_received = total - (size_t)(body - buf);
-                while ((int)body_received < content_len && total < buf_size - 1) {
-                    n = recv(fd, buf + total, buf_size - 1 - total, 0);
-                    if (n <= 0) break;
-                    total += (size_t)n;
-                    body_received += (size_t)n;
-                }
-                buf[total] = '\0';
+    int total = 0;
+    for (int e = 0; e < num_entries; e++) {
+        const CMLServingBatchEntry* en = &entries[e];
+        int s = en->paged_seq_id;
+        eng->seq_ids[0][e] = s;
+
+        /* A shadow out of step with the scheduler belongs to a sequence that
+         * was restarted (recompute) or whose slot was reused */
+        for (int l = 1; l < num_layers; l++) {
+            CMLPagedKVCache* lc = eng->caches[l];
+            int m = eng->seq_map[l][s];
+            if (m >= 0 && lc->sequences[m].seq_len != en->start_pos) {
+                cml_paged_cache_free_sequence(lc, m);
+                m = -1;
             }
-            return (int)total;
+            if (m < 0 && (m = cml_paged_cache_init_sequence(lc)) < 0) return -1;
+            eng->seq_map[l][s] = m;
+            eng->seq_ids[l][e] = m;
+        }
+
+        memcpy(eng->tokens + total, en->tokens, (size_t)en->num_tokens * sizeof(int));
+        eng->num_tokens[e] = en->num_tokens;
+        total += en->num_tokens;
+    }
+
+    if (cml_llama_forward_paged(eng->model, eng->caches, (const int* const*)eng->seq_ids,
+                                eng->tokens, eng->num_tokens, num_entries, eng->logits) != 0)
+        return -1;
+
+    int vocab = eng->model->config.vocab_size;
+    for (int e = 0; e < num_entries; e++) {
+        if (!entries[e].wants_token) continue;
+
+        CMLGenerationConfig gen = cml_generation_default_config();
+        gen.temperature = entries[e].temperature;
+        gen.top_p = entries[e].top_p;
+        gen.do_sample = (gen.temperature > 0.0f);
+
+        int shape[] = {vocab};
+        Tensor* row = tensor_from_data(eng->logits + (size_t)e * vocab, shape, 1, NULL);
+        next_tokens[e] = row ? cml_llama_sample_token(row, &gen) : -1;
+        tensor_free(row);
+        if (next_tokens[e] < 0) return -1;
+    }
+    return 0;
+}
+
+static void engine_free(GenEngine* eng) {
+    if (!eng) return;
+    cml_serving_free(eng->serving);
+    for (int l = 0; eng->caches && l < eng->model->num_layers; l++) {
+        cml_paged_kv_cache_free(eng->caches[l]);
+        if (eng->seq_map) free(eng->seq_map[l]);
+        if (eng->seq_ids) free(eng->seq_ids[l]);
+    }
+    free(eng->caches);
+    free(eng->seq_map);
+    free(eng->seq_ids);
+    free(eng->tokens);
+    free(eng->num_tokens);
+    free(eng->logits);
+    free(eng);
+}
+
+static GenEngine* engine_create(CMLOpenAIServer* srv) {
+    CMLLLaMAModel* model = (CMLLLaMAModel*)srv->model;
+    const CMLLLaMAConfig* mc = &model->config;
+    int head_dim = mc->hidden_size / mc->num_heads;
+
+    CMLServingConfig sc = cml_serving_default_config();
+    sc.max_batch_size = srv->max_batch_size;
+    sc.max_queue_size = CML_SERVING_MAX_QUEUE;
+    sc.max_seq_len = mc->max_seq_len;
+    sc.max_new_tokens_default = srv->max_tokens;
+    sc.temperature_default = srv->temperature;
+    sc.top_p_default = srv->top_p;
+    sc.eos_token_id = cml_generation_default_config().eos_token_id;
+    /* Swapping would only save layer 0's K/V */
+    sc.preempt_mode = CML_PREEMPT_RECOMPUTE;
+
+    GenEngine* eng = (GenEngine*)calloc(1, sizeof(GenEngine));
+    if (!eng) return NULL;
+    eng->model = model;
+    eng->serving = cml_serving_create(&sc);
+    if (!eng->serving) {
+        free(eng);
+        return NULL;
+    }
+
+    int max_batch = eng->serving->config.max_batch_size;
+    int max_blocks = srv->kv_cache_tokens / CML_PAGE_BLOCK_SIZE;
+    if (max_blocks < 1) max_blocks = 1;
+
+    int L = model->num_layers;
+    eng->caches = (CMLPagedKVCache**)calloc((size_t)L, sizeof(CMLPagedKVCache*));
+    eng->seq_map = (int**)calloc((size_t)L, sizeof(int*));
+    eng->seq_ids = (int**)calloc((size_t)L, sizeof(int*));
+    eng->tokens = (int*)malloc((size_t)eng->serving->config.max_batch_tokens * sizeof(int));
+    eng->num_tokens = (int*)malloc((size_t)max_batch * sizeof(int));
+    eng->logits = (float*)malloc((size_t)max_batch * mc->vocab_size * sizeof(float));
+    if (!eng->caches || !eng->seq_map || !eng->seq_ids || !eng->tokens ||
+        !eng->num_tokens || !eng->logits) {
+        engine_free(eng);
+        return NULL;
+    }
+
+    for (int l = 0; l < L; l++) {
+        eng->caches[l] = cml_paged_kv_cache_create(max_blocks, max_batch,
+                                                   mc->num_kv_heads, head_dim);
+        eng->seq_map[l] = (int*)malloc((size_t)max_batch * sizeof(int));
+        eng->seq_ids[l] = (int*)malloc((size_t)max_batch * sizeof(int));
+        if (!eng->caches[l] || !eng->seq_map[l] || !eng->seq_ids[l]) {
+            engine_free(eng);
+            return NULL;
+        }
+        for (int s = 0; s < max_batch; s++)
+            eng->seq_map[l][s] = -1;
+    }
+
+    cml_serving_set_kv_cache(eng->serving, eng->caches[0]);
+    cml_serving_set_forward(eng->serving, engine_forward, eng);
+    LOG_INFO("openai_api: batching engine ready (max_batch=%d, kv_blocks=%d x %d layers)",
+             max_batch, max_blocks, L);
+    return eng;
+}
+
+static bool engine_busy(const GenEngine* eng) {
+    if (!eng) return false;
+    const CMLServingContext* s = eng->serving;
+    return s->batch_size > 0 || s->queue_count > 0 || s->num_swapped > 0;
+}
+
+/* Connections */
+
+typedef enum {
+    CONN_READING,      /* Waiting for (more of) a request */
+    CONN_GENERATING    /* A chat completion is in the engine */
+} ConnState;
+
+typedef struct HttpConn {
+    int fd;
+    ConnState state;
+    bool keep_alive;
+    bool closing;      /* Close once the output buffer drains */
+    bool read_closed;  /* Peer shut down its side */
+    bool dead;
+    uint32_t events;   /* Current epoll interest */
+
+    char* in;
+    size_t in_len, in_cap;
+    char* out;
+    size_t out_off, out_len, out_cap;
+
+    /* In-flight chat completion */
+    int request_id;
+    bool stream;
+    int emitted;
+    int prompt_tokens;
+    char comp_id[64];
+    long created;
+
+    struct HttpConn* prev;
+    struct HttpConn* next;
+} HttpConn;
+
+typedef struct {
+    CMLOpenAIServer* srv;
+    int epfd;
+    HttpConn* conns;
+    GenEngine* engine;
+} EventLoop;
+
+static char listen_tag, wake_tag;
+
+static int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return (flags < 0) ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+static void conn_write(HttpConn* c, const void* data, size_t len) {
+    if (c->dead) return;
+    if (c->out_len + len > c->out_cap) {
+        size_t cap = c->out_cap ? c->out_cap : 4096;
+        while (cap < c->out_len + len) cap *= 2;
+        char* grown = (char*)realloc(c->out, cap);
+        if (!grown) {
+            c->dead = true;
+            return;
         }
+        c->out = grown;
+        c->out_cap = cap;
     }
-    return (int)total;
+    memcpy(c->out + c->out_len, data, len);
+    c->out_len += len;
 }
 
-static void send_http_response(int fd, int status_code, const char* status_text,
+static void conn_update_events(EventLoop* loop, HttpConn* c) {
+    uint32_t events = (c->read_closed ? 0 : EPOLLIN) |
+                      (c->out_off < c->out_len ? EPOLLOUT : 0);
+    if (events == c->events) return;
+    struct epoll_event ev = {.events = events, .data.ptr = c};
+    epoll_ctl(loop->epfd, EPOLL_CTL_MOD, c->fd, &ev);
+    c->events = events;
+}
+
+/* Sends what the socket takes now; the rest waits for EPOLLOUT */
+static void conn_flush(EventLoop* loop, HttpConn* c) {
+    while (!c->dead && c->out_off < c->out_len) {
+        ssize_t n = send(c->fd, c->out + c->out_off, c->out_len - c->out_off, MSG_NOSIGNAL);
+        if (n > 0) {
+            c->out_off += (size_t)n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            c->dead = true;
+        }
+    }
+    if (c->dead) return;
+
+    if (c->out_off == c->out_len) {
+        c->out_off = c->out_len = 0;
+        if (c->closing || (c->read_closed && c->state == CONN_READING)) {
+            c->dead = true;
+            return;
+        }
+    } else if (c->out_len - c->out_off > HTTP_OUT_LIMIT) {
+        LOG_WARNING("openai_api: dropping client that stopped reading");
+        c->dead = true;
+        return;
+    }
+    conn_update_events(loop, c);
+}
+
+static void conn_destroy(EventLoop* loop, HttpConn* c) {
+    if (c->state == CONN_GENERATING && loop->engine)
+        cml_serving_finish_request(loop->engine->serving, c->request_id);
+    epoll_ctl(loop->epfd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    if (c->prev) c->prev->next = c->next;
+    else loop->conns = c->next;
+    if (c->next) c->next->prev = c->prev;
+    free(c->in);
+    free(c->out);
+    free(c);
+}
+
+/* HTTP helpers */
+
+static const char* http_header(const char* headers, size_t len, const char* name) {
+    size_t name_len = strlen(name);
+    const char* end = headers + len;
+    const char* line = strstr(headers, "\r\n");
+    while (line && line + 2 < end) {
+        line += 2;
+        if (strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') {
+            const char* v = line + name_len + 1;
+            while (*v == ' ' || *v == '\t') v++;
+            return v;
+        }
+        line = strstr(line, "\r\n");
+    }
+    return NULL;
+}
+
+/* Content-Length as a plain decimal (0 when absent); -1 when malformed.
+ * Values past ULONG_MAX come back as SIZE_MAX so the size check rejects them. */
+static int http_content_length(const char* headers, size_t len, size_t* out) {
+    const char* cl = http_header(headers, len, "Content-Length");
+    *out           = 0;
+    if (!cl)
+        return 0;
+    if (*cl < '0' || *cl > '9')
+        return -1; /* strtoul would take a sign or leading space */
+
+    char* end;
+    errno               = 0;
+    unsigned long value = strtoul(cl, &end, 10);
+    while (*end == ' ' || *end == '\t') end++;
+    if (strncmp(end, "\r\n", 2) != 0)
+        return -1;
+    *out = errno == ERANGE ? SIZE_MAX : (size_t)value;
+    return 0;
+}
+
+static bool http_keep_alive(const char* headers, size_t len) {
+    const char* conn = http_header(headers, len, "Connection");
+    if (conn && strncasecmp(conn, "close", 5) == 0) return false;
+    if (conn && strncasecmp(conn, "keep-alive", 10) == 0) return true;
+    /* HTTP/1.1 defaults to persistent connections, 1.0 does not */
+    const char* eol = strstr(headers, "\r\n");
+    return !(eol && eol - headers >= 8 && strncmp(eol - 8, "HTTP/1.0", 8) == 0);
+}
+
+static void send_http_response(HttpConn* c, int status_code, const char* status_text,
                                const char* content_type, const char* body) {
     char header[1024];
     size_t body_len = body ? strlen(body) : 0;
@@ -146,19 +476,31 @@ static void send_http_response(int fd, int status_code, const char* status_text,
                            "Content-Type: %s\r\n"
                            "Content-Length: %zu\r\n"
                            "Access-Control-Allow-Origin: *\r\n"
-                           "Connection: close\r\n"
+                           "Connection: %s\r\n"
                            "\r\n",
-                           status_code, status_text, content_type, body_len);
-    send(fd, header, (size_t)hdr_len, MSG_NOSIGNAL);
+                           status_code, status_text, content_type, body_len,
+                           c->keep_alive ? "keep-alive" : "close");
+    conn_write(c, header, (size_t)hdr_len);
     if (body && body_len > 0) {
-        send(fd, body, body_len, MSG_NOSIGNAL);
+        conn_write(c, body, body_len);
     }
+    if (!c->keep_alive) c->closing = true;
+}
+
+/* One SSE event as one chunk of a chunked-encoded stream */
+static void send_sse_chunk(HttpConn* c, const char* data) {
+    char size_line[32];
+    size_t data_len = strlen(data);
+    int n = snprintf(size_line, sizeof(size_line), "%zx\r\n", data_len + 8);
+    conn_write(c, size_line, (size_t)n);
+    conn_write(c, "data: ", 6);
+    conn_write(c, data, data_len);
+    conn_write(c, "\n\n\r\n", 4);
 }
 
-static void send_sse_chunk(int fd, const char* data) {
-    char buf[16384];
-    int n = snprintf(buf, sizeof(buf), "data: %s\n\n", data);
-    send(fd, buf, (size_t)n, MSG_NOSIGNAL);
+static void end_sse_stream(HttpConn* c) {
+    conn_write(c, "0\r\n\r\n", 5);
+    if (!c->keep_alive) c->closing = true;
 }
 
 /* Chat completion ID generator */
@@ -168,40 +510,42 @@ static void generate_id(char* buf, size_t size) {
     snprintf(buf, size, "chatcmpl-%ld-%d", (long)time(NULL), counter++);
 }
 
+static const char* served_model_name(const CMLOpenAIServer* srv) {
+    return srv->model_name[0] ? srv->model_name : "cml-default";
+}
+
 /* Route handlers */
 
-static void handle_health(int fd) {
-    send_http_response(fd, 200, "OK", "application/json", "{\"status\":\"ok\"}");
+static void handle_health(HttpConn* c) {
+    send_http_response(c, 200, "OK", "application/json", "{\"status\":\"ok\"}");
 }
 
-static void handle_models(int fd, CMLOpenAIServer* srv) {
+static void handle_models(HttpConn* c, CMLOpenAIServer* srv) {
     char body[1024];
     snprintf(body, sizeof(body),
              "{\"object\":\"list\",\"data\":[{\"id\":\"%s\","
              "\"object\":\"model\",\"owned_by\":\"cml\"}]}",
-             srv->model_name[0] ? srv->model_name : "cml-default");
-    send_http_response(fd, 200, "OK", "application/json", body);
+             served_model_name(srv));
+    send_http_response(c, 200, "OK", "application/json", body);
 }
 
-static void handle_chat_completions(int fd, CMLOpenAIServer* srv, const char* body_json) {
-    CMLLLaMAModel* model = (CMLLLaMAModel*)srv->model;
+static void handle_chat_completions(EventLoop* loop, HttpConn* c, const char* body_json) {
+    CMLOpenAIServer* srv = loop->srv;
     CMLTokenizer* tokenizer = (CMLTokenizer*)srv->tokenizer;
 
     ChatMessage msgs[MAX_MESSAGES];
     int num_msgs = parse_messages(body_json, msgs, MAX_MESSAGES);
 
-    const char* model_p = json_find_key(body_json, "model");
-    (void)model_p;
-
     float temperature = json_read_float(json_find_key(body_json, "temperature"), srv->temperature);
     float top_p = json_read_float(json_find_key(body_json, "top_p"), srv->top_p);
     int max_tokens = json_read_int(json_find_key(body_json, "max_tokens"), srv->max_tokens);
     bool stream = json_read_bool(json_find_key(body_json, "stream"), false);
+    if (max_tokens <= 0) max_tokens = srv->max_tokens;
 
-    if (!model || !tokenizer || num_msgs == 0) {
+    if (!loop->engine || !tokenizer || num_msgs == 0) {
         const char* err = "{\"error\":{\"message\":\"Model not loaded or empty messages\","
                           "\"type\":\"invalid_request_error\"}}";
-        send_http_response(fd, 400, "Bad Request", "application/json", err);
+        send_http_response(c, 400, "Bad Request", "application/json", err);
         return;
     }
 
@@ -211,17 +555,32 @@ static void handle_chat_completions(int fd, CMLOpenAIServer* srv, const char* bo
         int written = snprintf(prompt + prompt_off, sizeof(prompt) - prompt_off,
                                "[%s]: %s\n", msgs[i].role, msgs[i].content);
         if (written > 0) prompt_off += (size_t)written;
+        if (prompt_off >= sizeof(prompt)) break;
     }
 
-    CMLGenerationConfig gen_config = cml_generation_default_config();
-    gen_config.temperature = temperature;
-    gen_config.top_p = top_p;
-    gen_config.max_new_tokens = max_tokens;
-    gen_config.do_sample = (temperature > 0.0f);
+    int num_prompt_tokens = 0;
+    int* prompt_tokens = cml_tokenizer_encode(tokenizer, prompt, &num_prompt_tokens);
+    int id = -1;
+    if (prompt_tokens && num_prompt_tokens > 0) {
+        id = cml_serving_submit(loop->engine->serving, prompt_tokens, num_prompt_tokens,
+                                max_tokens);
+    }
+    free(prompt_tokens);
+    if (id < 0) {
+        const char* err = "{\"error\":{\"message\":\"Could not queue request\","
+                          "\"type\":\"server_error\"}}";
+        send_http_response(c, 503, "Service Unavailable", "application/json", err);
+        return;
+    }
+    cml_serving_set_sampling(loop->engine->serving, id, temperature, top_p);
 
-    char comp_id[64];
-    generate_id(comp_id, sizeof(comp_id));
-    long created = (long)time(NULL);
+    c->state = CONN_GENERATING;
+    c->request_id = id;
+    c->stream = stream;
+    c->emitted = 0;
+    c->prompt_tokens = num_prompt_tokens;
+    c->created = (long)time(NULL);
+    generate_id(c->comp_id, sizeof(c->comp_id));
 
     if (stream) {
         char hdr[512];
@@ -230,156 +589,272 @@ static void handle_chat_completions(int fd, CMLOpenAIServer* srv, const char* bo
                                "Content-Type: text/event-stream\r\n"
                                "Cache-Control: no-cache\r\n"
                                "Access-Control-Allow-Origin: *\r\n"
-                               "Connection: keep-alive\r\n"
-                               "\r\n");
-        send(fd, hdr, (size_t)hdr_len, MSG_NOSIGNAL);
-
-        int num_prompt_tokens = 0;
-        int* prompt_tokens = cml_tokenizer_encode(tokenizer, prompt, &num_prompt_tokens);
-        if (!prompt_tokens || num_prompt_tokens == 0) {
-            send_sse_chunk(fd, "[DONE]");
-            free(prompt_tokens);
-            return;
-        }
-
-        cml_llama_reset(model);
-        int total_generated = 0;
-
-        for (int i = 0; i < max_tokens; i++) {
-            int seq_len = (i == 0) ? num_prompt_tokens : 1;
-            const int* input_tokens = (i == 0) ? prompt_tokens : &prompt_tokens[num_prompt_tokens + i - 1];
-
-            Tensor* logits = cml_llama_forward(model, input_tokens, seq_len);
-            if (!logits) break;
-
-            int token_id = cml_llama_sample_token(logits, &gen_config);
-            tensor_free(logits);
-
-            if (token_id == gen_config.eos_token_id) break;
+                               "Transfer-Encoding: chunked\r\n"
+                               "Connection: %s\r\n"
+                               "\r\n",
+                               c->keep_alive ? "keep-alive" : "close");
+        conn_write(c, hdr, (size_t)hdr_len);
+    }
+}
 
-            char* token_text = cml_tokenizer_decode(tokenizer, &token_id, 1);
-            if (!token_text) break;
+static void send_stream_delta(HttpConn* c, const CMLOpenAIServer* srv, const char* text) {
+    char* escaped = json_escape(text);
+    if (!escaped) return;
+    size_t size = strlen(escaped) + 512;
+    char* chunk_json = (char*)malloc(size);
+    if (chunk_json) {
+        snprintf(chunk_json, size,
+                 "{\"id\":\"%s\",\"object\":\"chat.completion.chunk\","
+                 "\"created\":%ld,\"model\":\"%s\","
+                 "\"choices\":[{\"index\":0,\"delta\":{\"content\":\"%s\"},"
+                 "\"finish_reason\":null}]}",
+                 c->comp_id, c->created, served_model_name(srv), escaped);
+        send_sse_chunk(c, chunk_json);
+        free(chunk_json);
+    }
+    free(escaped);
+}
 
-            char chunk_json[16384];
-            char escaped[8192];
-            size_t ei = 0;
-            for (size_t ti = 0; token_text[ti] && ei < sizeof(escaped) - 2; ti++) {
-                if (token_text[ti] == '"' || token_text[ti] == '\\') {
-                    escaped[ei++] = '\\';
-                }
-                if (token_text[ti] == '\n') {
-                    escaped[ei++] = '\\'; escaped[ei++] = 'n'; continue;
-                }
-                escaped[ei++] = token_text[ti];
-            }
-            escaped[ei] = '\0';
+static void conn_process(EventLoop* loop, HttpConn* c);
 
-            snprintf(chunk_json, sizeof(chunk_json),
-                     "{\"id\":\"%s\",\"object\":\"chat.completion.chunk\","
-                     "\"created\":%ld,\"model\":\"%s\","
-                     "\"choices\":[{\"index\":0,\"delta\":{\"content\":\"%s\"},"
-                     "\"finish_reason\":null}]}",
-                     comp_id, created,
-                     srv->model_name[0] ? srv->model_name : "cml-default",
-                     escaped);
+/* Forwards new tokens of an in-flight completion; finishes the response
+ * when the engine is done with it */
+static void pump_generation(EventLoop* loop, HttpConn* c) {
+    CMLOpenAIServer* srv = loop->srv;
+    CMLServingContext* serving = loop->engine->serving;
+    CMLTokenizer* tokenizer = (CMLTokenizer*)srv->tokenizer;
+    int eos = serving->config.eos_token_id;
 
-            send_sse_chunk(fd, chunk_json);
+    CMLSequenceStatus status = cml_serving_get_status(serving, c->request_id);
+    int count = 0;
+    const int* tokens = cml_serving_get_tokens(serving, c->request_id, &count);
+    bool hit_eos = count > 0 && tokens[count - 1] == eos;
+    int text_count = hit_eos ? count - 1 : count;
+
+    if (c->stream) {
+        for (; c->emitted < text_count; c->emitted++) {
+            char* token_text = cml_tokenizer_decode(tokenizer, &tokens[c->emitted], 1);
+            if (!token_text) continue;
+            send_stream_delta(c, srv, token_text);
             free(token_text);
-            total_generated++;
         }
+    }
+
+    if (status != CML_SEQ_STATUS_FINISHED && status != CML_SEQ_STATUS_ERROR) return;
 
+    if (c->stream) {
         char done_json[512];
+        if (status == CML_SEQ_STATUS_ERROR) {
+            send_sse_chunk(c, "{\"error\":{\"message\":\"Generation failed\","
+                              "\"type\":\"server_error\"}}");
+        }
         snprintf(done_json, sizeof(done_json),
                  "{\"id\":\"%s\",\"object\":\"chat.completion.chunk\","
                  "\"created\":%ld,\"model\":\"%s\","
                  "\"choices\":[{\"index\":0,\"delta\":{},"
-                 "\"finish_reason\":\"stop\"}]}",
-                 comp_id, created,
-                 srv->model_name[0] ? srv->model_name : "cml-default");
-        send_sse_chunk(fd, done_json);
-        send_sse_chunk(fd, "[DONE]");
-
-        free(prompt_tokens);
+                 "\"finish_reason\":\"%s\"}]}",
+                 c->comp_id, c->created, served_model_name(srv),
+                 hit_eos ? "stop" : "length");
+        send_sse_chunk(c, done_json);
+        send_sse_chunk(c, "[DONE]");
+        end_sse_stream(c);
+    } else if (status == CML_SEQ_STATUS_ERROR) {
+        const char* err = "{\"error\":{\"message\":\"Generation failed\","
+                          "\"type\":\"server_error\"}}";
+        send_http_response(c, 500, "Internal Server Error", "application/json", err);
     } else {
-        CMLGenerationResult* result = cml_llama_generate(model, prompt, &gen_config);
-        if (!result || !result->text) {
-            const char* err = "{\"error\":{\"message\":\"Generation failed\","
-                              "\"type\":\"server_error\"}}";
-            send_http_response(fd, 500, "Internal Server Error", "application/json", err);
-            if (result) cml_generation_result_free(result);
-            return;
-        }
-
-        char escaped[32768];
-        size_t ei = 0;
-        for (size_t i = 0; result->text[i] && ei < sizeof(escaped) - 2; i++) {
-            if (result->text[i] == '"' || result->text[i] == '\\') {
-                escaped[ei++] = '\\';
-            }
-            if (result->text[i] == '\n') {
-                escaped[ei++] = '\\'; escaped[ei++] = 'n'; continue;
-            }
-            escaped[ei++] = result->text[i];
+        char* text = text_count > 0 ? cml_tokenizer_decode(tokenizer, tokens, text_count) : NULL;
+        char* escaped = json_escape(text ? text : "");
+        size_t size = (escaped ? strlen(escaped) : 0) + 1024;
+        char* resp = (char*)malloc(size);
+        if (resp && escaped) {
+            snprintf(resp, size,
+                     "{\"id\":\"%s\",\"object\":\"chat.completion\","
+                     "\"created\":%ld,\"model\":\"%s\","
+                     "\"choices\":[{\"index\":0,\"message\":{\"role\":\"assistant\","
+                     "\"content\":\"%s\"},\"finish_reason\":\"%s\"}],"
+                     "\"usage\":{\"prompt_tokens\":%d,\"completion_tokens\":%d,"
+                     "\"total_tokens\":%d}}",
+                     c->comp_id, c->created, served_model_name(srv), escaped,
+                     hit_eos ? "stop" : "length",
+                     c->prompt_tokens, count, c->prompt_tokens + count);
+            send_http_response(c, 200, "OK", "application/json", resp);
+        } else {
+            c->dead = true;
         }
-        escaped[ei] = '\0';
-
-        int prompt_tokens_count = 0;
-        int* pt = cml_tokenizer_encode(tokenizer, prompt, &prompt_tokens_count);
-        free(pt);
+        free(resp);
+        free(escaped);
+        free(text);
+    }
 
-        char resp[65536];
-        snprintf(resp, sizeof(resp),
-                 "{\"id\":\"%s\",\"object\":\"chat.completion\","
-                 "\"created\":%ld,\"model\":\"%s\","
-                 "\"choices\":[{\"index\":0,\"message\":{\"role\":\"assistant\","
-                 "\"content\":\"%s\"},\"finish_reason\":\"stop\"}],"
-                 "\"usage\":{\"prompt_tokens\":%d,\"completion_tokens\":%d,"
-                 "\"total_tokens\":%d}}",
-                 comp_id, created,
-                 srv->model_name[0] ? srv->model_name : "cml-default",
-                 escaped,
-                 prompt_tokens_count, result->num_tokens,
-                 prompt_tokens_count + result->num_tokens);
+    cml_serving_finish_request(serving, c->request_id);
+    c->state = CONN_READING;
+    c->request_id = -1;
 
-        send_http_response(fd, 200, "OK", "application/json", resp);
-        cml_generation_result_free(result);
-    }
+    /* Pipelined requests waited behind this one */
+    conn_process(loop, c);
 }
 
 /* Request dispatch */
 
-static void handle_request(int fd, CMLOpenAIServer* srv, const char* request) {
+static void handle_request(EventLoop* loop, HttpConn* c, const char* request) {
     const char* body = strstr(request, "\r\n\r\n");
     if (body) body += 4;
 
     if (strncmp(request, "GET /health", 11) == 0) {
-        handle_health(fd);
+        handle_health(c);
     } else if (strncmp(request, "GET /v1/models", 14) == 0) {
-        handle_models(fd, srv);
+        handle_models(c, loop->srv);
     } else if (strncmp(request, "POST /v1/chat/completions", 25) == 0) {
         if (!body) {
-            send_http_response(fd, 400, "Bad Request", "application/json",
+            send_http_response(c, 400, "Bad Request", "application/json",
                                "{\"error\":{\"message\":\"Missing body\"}}");
             return;
         }
-        handle_chat_completions(fd, srv, body);
+        handle_chat_completions(loop, c, body);
     } else if (strncmp(request, "OPTIONS ", 8) == 0) {
-        char cors[] = "";
-        char hdr[256];
+        char hdr[320];
         int hdr_len = snprintf(hdr, sizeof(hdr),
                                "HTTP/1.1 204 No Content\r\n"
                                "Access-Control-Allow-Origin: *\r\n"
                                "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n"
                                "Access-Control-Allow-Headers: Content-Type, Authorization\r\n"
-                               "Connection: close\r\n\r\n");
-        send(fd, hdr, (size_t)hdr_len, MSG_NOSIGNAL);
-        (void)cors;
+                               "Connection: %s\r\n\r\n",
+                               c->keep_alive ? "keep-alive" : "close");
+        conn_write(c, hdr, (size_t)hdr_len);
+        if (!c->keep_alive) c->closing = true;
     } else {
-        send_http_response(fd, 404, "Not Found", "application/json",
+        send_http_response(c, 404, "Not Found", "application/json",
                            "{\"error\":{\"message\":\"Not found\"}}");
     }
 }
 
+/* Handles every complete request in the input buffer, in order. A chat
+ * completion holds the rest back until its response is written. */
+static void conn_process(EventLoop* loop, HttpConn* c) {
+    while (!c->dead && !c->closing && c->state == CONN_READING && c->in_len > 0) {
+        c->in[c->in_len] = '\0';
+        char* hdr_end = strstr(c->in, "\r\n\r\n");
+        if (!hdr_end) {
+            if (c->in_len >= HTTP_BUF_SIZE) {
+                c->keep_alive = false;
+                send_http_response(c, 431, "Request Header Fields Too Large",
+                                   "application/json",
+                                   "{\"error\":{\"message\":\"Headers too large\"}}");
+            }
+            break;
+        }
+
+        size_t header_len = (size_t)(hdr_end - c->in) + 4;
+        size_t body_len;
+        if (http_content_length(c->in, header_len, &body_len) != 0) {
+            c->keep_alive = false;
+            send_http_response(c, 400, "Bad Request", "application/json",
+                               "{\"error\":{\"message\":\"Invalid Content-Length\"}}");
+            break;
+        }
+        if (header_len > HTTP_BUF_SIZE || body_len > HTTP_BUF_SIZE - header_len) {
+            c->keep_alive = false;
+            send_http_response(c, 413, "Payload Too Large", "application/json",
+                               "{\"error\":{\"message\":\"Request too large\"}}");
+            break;
+        }
+        size_t req_len = header_len + body_len;
+        if (c->in_len < req_len) break;
+
+        c->keep_alive = http_keep_alive(c->in, header_len);
+        char saved = c->in[req_len];
+        c->in[req_len] = '\0';
+        handle_request(loop, c, c->in);
+        c->in[req_len] = saved;
+
+        memmove(c->in, c->in + req_len, c->in_len - req_len);
+        c->in_len -= req_len;
+    }
+}
+
+static void conn_read(EventLoop* loop, HttpConn* c) {
+    for (;;) {
+        if (c->in_len >= HTTP_BUF_SIZE) break; /* conn_process rejects it */
+        if (c->in_cap - c->in_len < 4096 + 1) {
+            size_t cap = c->in_cap ? c->in_cap * 2 : 8192;
+            if (cap > HTTP_BUF_SIZE + 1) cap = HTTP_BUF_SIZE + 1;
+            char* grown = (char*)realloc(c->in, cap);
+            if (!grown) {
+                c->dead = true;
+                return;
+            }
+            c->in = grown;
+            c->in_cap = cap;
+        }
+
+        ssize_t n = recv(c->fd, c->in + c->in_len, c->in_cap - 1 - c->in_len, 0);
+        if (n > 0) {
+            c->in_len += (size_t)n;
+        } else if (n == 0) {
+            /* Answer what was sent, then close */
+            c->read_closed = true;
+            c->keep_alive = false;
+            break;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else {
+            c->dead = true;
+            return;
+        }
+    }
+
+    conn_process(loop, c);
+    if (c->read_closed && c->state == CONN_READING)
+        c->closing = true;
+}
+
+static void accept_clients(EventLoop* loop) {
+    for (;;) {
+        int fd = accept(loop->srv->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK && loop->srv->running)
+                LOG_ERROR("openai_api: accept() failed: %s", strerror(errno));
+            return;
+        }
+
+        int flag = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+        HttpConn* c = (HttpConn*)calloc(1, sizeof(HttpConn));
+        if (!c || set_nonblocking(fd) != 0) {
+            free(c);
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        c->request_id = -1;
+        c->keep_alive = true;
+        c->events = EPOLLIN;
+
+        struct epoll_event ev = {.events = EPOLLIN, .data.ptr = c};
+        if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            free(c);
+            close(fd);
+            continue;
+        }
+        c->next = loop->conns;
+        if (loop->conns) loop->conns->prev = c;
+        loop->conns = c;
+    }
+}
+
+static void reap_connections(EventLoop* loop) {
+    HttpConn* c = loop->conns;
+    while (c) {
+        HttpConn* next = c->next;
+        if (c->dead) conn_destroy(loop, c);
+        c = next;
+    }
+}
+
 /* Server lifecycle */
 
 CMLOpenAIServer* cml_openai_server_create(int port) {
@@ -393,6 +868,15 @@ CMLOpenAIServer* cml_openai_server_create(int port) {
     srv->max_tokens = 256;
     srv->temperature = 0.8f;
     srv->top_p = 0.9f;
+    srv->max_batch_size = 8;
+    srv->kv_cache_tokens = 4096;
+
+    srv->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (srv->wake_fd < 0) {
+        LOG_ERROR("openai_api: eventfd() failed: %s", strerror(errno));
+        free(srv);
+        return NULL;
+    }
 
     return srv;
 }
@@ -425,6 +909,28 @@ int cml_openai_server_load_model(CMLOpenAIServer* srv, const char* model_path) {
     return 0;
 }
 
+static void event_loop_handle(EventLoop* loop, const struct epoll_event* ev) {
+    if (ev->data.ptr == &listen_tag) {
+        accept_clients(loop);
+        return;
+    }
+    if (ev->data.ptr == &wake_tag) {
+        uint64_t v;
+        while (read(loop->srv->wake_fd, &v, sizeof(v)) > 0) {}
+        return;
+    }
+
+    HttpConn* c = (HttpConn*)ev->data.ptr;
+    if (c->dead) return;
+    if (ev->events & (EPOLLERR | EPOLLHUP)) {
+        c->dead = true;
+        return;
+    }
+    if (ev->events & EPOLLIN)
+        conn_read(loop, c);
+    conn_flush(loop, c);
+}
+
 int cml_openai_server_run(CMLOpenAIServer* srv) {
     if (!srv) return -1;
 
@@ -449,54 +955,76 @@ int cml_openai_server_run(CMLOpenAIServer* srv) {
         return -1;
     }
 
-    if (listen(srv->listen_fd, 16) != 0) {
+    if (listen(srv->listen_fd, SOMAXCONN) != 0 || set_nonblocking(srv->listen_fd) != 0) {
         LOG_ERROR("openai_api: listen() failed: %s", strerror(errno));
         close(srv->listen_fd);
         srv->listen_fd = -1;
         return -1;
     }
 
+    EventLoop loop = {.srv = srv};
+    loop.epfd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event lev = {.events = EPOLLIN, .data.ptr = &listen_tag};
+    struct epoll_event wev = {.events = EPOLLIN, .data.ptr = &wake_tag};
+    if (loop.epfd < 0 ||
+        epoll_ctl(loop.epfd, EPOLL_CTL_ADD, srv->listen_fd, &lev) != 0 ||
+        epoll_ctl(loop.epfd, EPOLL_CTL_ADD, srv->wake_fd, &wev) != 0) {
+        LOG_ERROR("openai_api: epoll setup failed: %s", strerror(errno));
+        if (loop.epfd >= 0) close(loop.epfd);
+        return -1;
+    }
+
+    if (srv->model && srv->tokenizer) {
+        loop.engine = engine_create(srv);
+        if (!loop.engine)
+            LOG_ERROR("openai_api: generation engine setup failed; completions disabled");
+    }
+
     srv->running = true;
     LOG_INFO("OpenAI-compatible API server listening on port %d", srv->port);
     LOG_INFO("  POST /v1/chat/completions");
     LOG_INFO("  GET  /v1/models");
     LOG_INFO("  GET  /health");
 
-    char* buf = (char*)malloc(HTTP_BUF_SIZE);
-    if (!buf) {
-        LOG_ERROR("openai_api: buffer allocation failed");
-        return -1;
-    }
-
+    struct epoll_event events[MAX_EVENTS];
     while (srv->running) {
-        struct sockaddr_in client_addr;
-        socklen_t addr_len = sizeof(client_addr);
-        int client_fd = accept(srv->listen_fd, (struct sockaddr*)&client_addr, &addr_len);
-        if (client_fd < 0) {
-            if (!srv->running) break;
+        /* Poll without blocking while the engine has work */
+        int n = epoll_wait(loop.epfd, events, MAX_EVENTS, engine_busy(loop.engine) ? 0 : 1000);
+        if (n < 0) {
             if (errno == EINTR) continue;
-            LOG_ERROR("openai_api: accept() failed: %s", strerror(errno));
-            continue;
+            LOG_ERROR("openai_api: epoll_wait() failed: %s", strerror(errno));
+            break;
         }
-
-        int flag = 1;
-        setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
-
-        int n = recv_http_request(client_fd, buf, HTTP_BUF_SIZE);
-        if (n > 0) {
-            handle_request(client_fd, srv, buf);
+        for (int i = 0; i < n; i++)
+            event_loop_handle(&loop, &events[i]);
+
+        /* One scheduler iteration covers every in-flight completion */
+        if (engine_busy(loop.engine)) {
+            cml_serving_step(loop.engine->serving);
+            for (HttpConn* c = loop.conns; c; c = c->next) {
+                if (c->dead || c->state != CONN_GENERATING) continue;
+                pump_generation(&loop, c);
+                conn_flush(&loop, c);
+            }
         }
-
-        close(client_fd);
+        reap_connections(&loop);
     }
 
-    free(buf);
+    while (loop.conns)
+        conn_destroy(&loop, loop.conns);
+    engine_free(loop.engine);
+    close(loop.epfd);
     return 0;
 }
 
 void cml_openai_server_stop(CMLOpenAIServer* srv) {
     if (!srv) return;
     srv->running = false;
+    if (srv->wake_fd >= 0) {
+        uint64_t one = 1;
+        ssize_t rc = write(srv->wake_fd, &one, sizeof(one));
+        (void)rc;
+    }
     if (srv->listen_fd >= 0) {
         shutdown(srv->listen_fd, SHUT_RDWR);
     }
@@ -508,6 +1036,9 @@ void cml_openai_server_free(CMLOpenAIServer* srv) {
     if (srv->listen_fd >= 0) {
         close(srv->listen_fd);
     }
+    if (srv->wake_fd >= 0) {
+        close(srv->wake_fd);
+    }
     if (srv->model) {
         cml_llama_free((CMLLLaMAModel*)srv->model);
     }
@@ -1,31 +1,13 @@
 #include "nn/paged_attention.h"
 #include "tensor/tensor.h"
 #include "core/logging.h"
+#include "backend/threadpool.h"
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
-static void paged_softmax_inplace(float* data, int rows, int cols) {
-    for (int r = 0; r < rows; r++) {
-        float* row = data + (size_t)r * cols;
-        float max_val = row[0];
-        for (int c = 1; c < cols; c++) {
-            if (row[c] > max_val) max_val = row[c];
-        }
-        float sum = 0.0f;
-        for (int c = 0; c < cols; c++) {
-            row[c] = expf(row[c] - max_val);
-            sum += row[c];
-        }
-        if (sum > 0.0f) {
-            float inv = 1.0f / sum;
-            for (int c = 0; c < cols; c++) {
-                row[c] *= inv;
-            }
-        }
-    }
-}
-
 static inline size_t token_kv_size(const CMLPagedKVCache* cache) {
     return (size_t)cache->num_kv_heads * cache->head_dim;
 }
@@ -322,173 +304,336 @@ int cml_paged_cache_append(CMLPagedKVCache* cache, int seq_id,
     return 0;
 }
 
-Tensor* cml_paged_gqa_forward(CMLPagedKVCache* cache, int seq_id,
-                               Tensor* Q, const CMLGQAConfig* config) {
-    if (!cache || !Q || !config) {
-        LOG_ERROR("cml_paged_gqa_forward: NULL argument");
-        return NULL;
-    }
-    if (seq_id < 0 || seq_id >= cache->max_sequences) {
-        LOG_ERROR("cml_paged_gqa_forward: invalid seq_id %d", seq_id);
-        return NULL;
+/* ── Batched paged attention ────────────────────────────────────────────────
+ * Work is split into (sequence, kv-head) tasks. A task walks the sequence's
+ * block table once, and for every block updates the online-softmax state
+ * (running max, denominator, unnormalized output) of all query rows that read
+ * that kv-head: its q_len tokens times the GQA group. Scores exist for one
+ * block at a time, so scratch is O(block_size) per query row and independent
+ * of context length. */
+
+typedef struct {
+    float* buf;
+    size_t size;
+} PagedScratch;
+
+static pthread_key_t g_paged_scratch_key;
+static pthread_once_t g_paged_scratch_once = PTHREAD_ONCE_INIT;
+
+static void paged_scratch_destroy(void* p) {
+    PagedScratch* s = (PagedScratch*)p;
+    if (!s) return;
+    free(s->buf);
+    free(s);
+}
+
+static void paged_scratch_key_create(void) {
+    pthread_key_create(&g_paged_scratch_key, paged_scratch_destroy);
+}
+
+/* Grow-only per-thread buffer, so steady-state decode does no allocation */
+static float* paged_scratch_reserve(size_t floats) {
+    pthread_once(&g_paged_scratch_once, paged_scratch_key_create);
+    PagedScratch* s = (PagedScratch*)pthread_getspecific(g_paged_scratch_key);
+    if (!s) {
+        s = (PagedScratch*)calloc(1, sizeof(PagedScratch));
+        if (!s) return NULL;
+        pthread_setspecific(g_paged_scratch_key, s);
+    }
+    if (s->size < floats) {
+        free(s->buf);
+        s->buf = (float*)malloc(floats * sizeof(float));
+        s->size = s->buf ? floats : 0;
+    }
+    return s->buf;
+}
+
+typedef struct {
+    const CMLPagedKVCache* cache;
+    const int* seq_ids;
+    const int* q_lens;
+    const size_t* q_offsets;  /* First query row of each sequence */
+    const float* q;
+    float* out;
+    int num_heads;
+    int num_kv_heads;
+    int head_dim;
+    float scale;
+    bool causal;
+    atomic_bool failed;
+} PagedBatchTask;
+
+static void paged_attention_task(PagedBatchTask* pt, int s, int kv_h) {
+    const CMLPagedKVCache* cache = pt->cache;
+    const CMLBlockTable* bt = &cache->sequences[pt->seq_ids[s]];
+    const int head_dim = pt->head_dim;
+    const int groups = pt->num_heads / pt->num_kv_heads;
+    const int q_len = pt->q_lens[s];
+    const int kv_len = bt->seq_len;
+    const int nq = q_len * groups;
+    const size_t q_stride = (size_t)pt->num_heads * head_dim;
+    const size_t kv_stride = (size_t)pt->num_kv_heads * head_dim;
+
+    /* Per row: running max, denominator, then head_dim accumulators */
+    float* scratch = paged_scratch_reserve((size_t)nq * (head_dim + 2));
+    if (!scratch) {
+        atomic_store(&pt->failed, true);
+        return;
     }
+    float* row_max = scratch;
+    float* row_sum = scratch + nq;
+    float* acc = scratch + 2 * (size_t)nq;
+    for (int r = 0; r < nq; r++) {
+        row_max[r] = -INFINITY;
+        row_sum[r] = 0.0f;
+    }
+    memset(acc, 0, (size_t)nq * head_dim * sizeof(float));
+
+    float scores[CML_PAGE_BLOCK_SIZE];
+    int token_base = 0;
+    for (int bi = 0; bi < bt->num_blocks; bi++) {
+        const CMLPageBlock* blk = &cache->blocks[bt->block_ids[bi]];
+        const float* k_blk = blk->key_data + (size_t)kv_h * head_dim;
+        const float* v_blk = blk->value_data + (size_t)kv_h * head_dim;
+        const int n = blk->num_tokens;
+
+        for (int sq = 0; sq < q_len; sq++) {
+            /* Query sq sits at absolute position kv_len - q_len + sq */
+            int limit = n;
+            if (pt->causal) {
+                int visible = kv_len - q_len + sq - token_base + 1;
+                if (visible < limit) limit = visible;
+            }
+            if (limit <= 0) continue;
 
-    CMLBlockTable* bt = &cache->sequences[seq_id];
-    if (!bt->block_ids) {
-        LOG_ERROR("cml_paged_gqa_forward: sequence %d not initialised", seq_id);
-        return NULL;
+            for (int g = 0; g < groups; g++) {
+                const int h = kv_h * groups + g;
+                const int r = sq * groups + g;
+                const float* qv = pt->q + (pt->q_offsets[s] + sq) * q_stride + (size_t)h * head_dim;
+                float* a = acc + (size_t)r * head_dim;
+
+                float blk_max = -INFINITY;
+                for (int t = 0; t < limit; t++) {
+                    const float* kv = k_blk + (size_t)t * kv_stride;
+                    float dot = 0.0f;
+                    for (int d = 0; d < head_dim; d++) dot += qv[d] * kv[d];
+                    scores[t] = dot * pt->scale;
+                    if (scores[t] > blk_max) blk_max = scores[t];
+                }
+
+                /* Rescale what was accumulated under the old max */
+                const float new_max = blk_max > row_max[r] ? blk_max : row_max[r];
+                const float correction = expf(row_max[r] - new_max);
+                if (correction != 1.0f) {
+                    row_sum[r] *= correction;
+                    for (int d = 0; d < head_dim; d++) a[d] *= correction;
+                }
+                row_max[r] = new_max;
+
+                for (int t = 0; t < limit; t++) {
+                    const float p = expf(scores[t] - new_max);
+                    const float* vv = v_blk + (size_t)t * kv_stride;
+                    row_sum[r] += p;
+                    for (int d = 0; d < head_dim; d++) a[d] += p * vv[d];
+                }
+            }
+        }
+        token_base += n;
     }
 
-    tensor_ensure_executed(Q);
+    for (int sq = 0; sq < q_len; sq++) {
+        for (int g = 0; g < groups; g++) {
+            const int h = kv_h * groups + g;
+            const int r = sq * groups + g;
+            const float inv = row_sum[r] > 0.0f ? 1.0f / row_sum[r] : 0.0f;
+            float* o = pt->out + (pt->q_offsets[s] + sq) * q_stride + (size_t)h * head_dim;
+            const float* a = acc + (size_t)r * head_dim;
+            for (int d = 0; d < head_dim; d++) o[d] = a[d] * inv;
+        }
+    }
+}
 
-    if (Q->ndim != 3) {
-        LOG_ERROR("cml_paged_gqa_forward: Q must be 3D [batch, seq_len, num_heads*head_dim], "
-                  "got ndim=%d", Q->ndim);
-        return NULL;
+static void paged_attention_range(void* data, size_t start, size_t end) {
+    PagedBatchTask* pt = (PagedBatchTask*)data;
+    for (size_t i = start; i < end; i++) {
+        paged_attention_task(pt, (int)(i / (size_t)pt->num_kv_heads),
+                             (int)(i % (size_t)pt->num_kv_heads));
     }
+}
 
+static int paged_check_config(const CMLPagedKVCache* cache, const CMLGQAConfig* config,
+                              const char* fn) {
     int num_heads = config->num_heads;
     int num_kv_heads = config->num_kv_heads;
     int head_dim = config->head_dim;
 
     if (num_heads <= 0 || num_kv_heads <= 0 || head_dim <= 0) {
-        LOG_ERROR("cml_paged_gqa_forward: invalid config "
-                  "(num_heads=%d, kv_heads=%d, head_dim=%d)",
-                  num_heads, num_kv_heads, head_dim);
-        return NULL;
+        LOG_ERROR("%s: invalid config (num_heads=%d, kv_heads=%d, head_dim=%d)",
+                  fn, num_heads, num_kv_heads, head_dim);
+        return -1;
     }
     if (num_heads % num_kv_heads != 0) {
-        LOG_ERROR("cml_paged_gqa_forward: num_heads (%d) must be divisible by num_kv_heads (%d)",
-                  num_heads, num_kv_heads);
-        return NULL;
+        LOG_ERROR("%s: num_heads (%d) must be divisible by num_kv_heads (%d)",
+                  fn, num_heads, num_kv_heads);
+        return -1;
     }
     if (num_kv_heads != cache->num_kv_heads || head_dim != cache->head_dim) {
-        LOG_ERROR("cml_paged_gqa_forward: config mismatch with cache "
+        LOG_ERROR("%s: config mismatch with cache "
                   "(config kv_heads=%d vs cache %d, config head_dim=%d vs cache %d)",
-                  num_kv_heads, cache->num_kv_heads, head_dim, cache->head_dim);
-        return NULL;
+                  fn, num_kv_heads, cache->num_kv_heads, head_dim, cache->head_dim);
+        return -1;
     }
+    return 0;
+}
 
-    int groups = num_heads / num_kv_heads;
-    int batch = Q->shape[0];
-    int seq_q = Q->shape[1];
-    int kv_len = bt->seq_len;
+int cml_paged_attention_batch(CMLPagedKVCache* cache, const int* seq_ids, const int* q_lens,
+                              int num_seqs, const float* q, float* out,
+                              const CMLGQAConfig* config) {
+    if (!cache || !seq_ids || !q_lens || num_seqs <= 0 || !q || !out || !config) {
+        LOG_ERROR("cml_paged_attention_batch: invalid argument");
+        return -1;
+    }
+    if (paged_check_config(cache, config, "cml_paged_attention_batch") != 0) return -1;
 
-    if (batch != 1) {
-        LOG_ERROR("cml_paged_gqa_forward: paged attention only supports batch=1, got %d",
-                  batch);
-        return NULL;
+    size_t q_offsets_stack[64];
+    size_t* q_offsets = q_offsets_stack;
+    if (num_seqs > 64) {
+        q_offsets = (size_t*)malloc((size_t)num_seqs * sizeof(size_t));
+        if (!q_offsets) return -1;
     }
-    if (kv_len == 0) {
-        LOG_ERROR("cml_paged_gqa_forward: sequence %d has no cached tokens", seq_id);
-        return NULL;
+
+    size_t total_q = 0;
+    double work = 0.0;
+    for (int s = 0; s < num_seqs; s++) {
+        int seq_id = seq_ids[s];
+        if (seq_id < 0 || seq_id >= cache->max_sequences || !cache->sequences[seq_id].block_ids) {
+            LOG_ERROR("cml_paged_attention_batch: sequence %d not initialised", seq_id);
+            goto fail;
+        }
+        int kv_len = cache->sequences[seq_id].seq_len;
+        if (kv_len == 0) {
+            LOG_ERROR("cml_paged_attention_batch: sequence %d has no cached tokens", seq_id);
+            goto fail;
+        }
+        if (q_lens[s] <= 0 || q_lens[s] > kv_len) {
+            LOG_ERROR("cml_paged_attention_batch: sequence %d has %d queries for %d cached tokens",
+                      seq_id, q_lens[s], kv_len);
+            goto fail;
+        }
+        q_offsets[s] = total_q;
+        total_q += (size_t)q_lens[s];
+        work += (double)q_lens[s] * kv_len;
     }
 
     float scale = config->scale;
     if (scale <= 0.0f) {
-        scale = 1.0f / sqrtf((float)head_dim);
+        scale = 1.0f / sqrtf((float)config->head_dim);
+    }
+
+    PagedBatchTask pt = {
+        .cache = cache, .seq_ids = seq_ids, .q_lens = q_lens, .q_offsets = q_offsets,
+        .q = q, .out = out, .num_heads = config->num_heads,
+        .num_kv_heads = config->num_kv_heads, .head_dim = config->head_dim,
+        .scale = scale, .causal = config->causal,
+    };
+    atomic_init(&pt.failed, false);
+
+    /* Small batches run inline; otherwise one task per chunk is plenty since
+     * sequence lengths are ragged and the pool balances by stealing */
+    size_t num_tasks = (size_t)num_seqs * (size_t)config->num_kv_heads;
+    work *= (double)config->num_heads * config->head_dim;
+    size_t grain = work < 16384.0 ? num_tasks : 1;
+    threadpool_parallel_for_grain(NULL, paged_attention_range, &pt, num_tasks, grain);
+
+    if (q_offsets != q_offsets_stack) free(q_offsets);
+    if (atomic_load(&pt.failed)) {
+        LOG_ERROR("cml_paged_attention_batch: scratch allocation failed");
+        return -1;
     }
+    return 0;
+
+fail:
+    if (q_offsets != q_offsets_stack) free(q_offsets);
+    return -1;
+}
 
-    float* q_data = (float*)tensor_data_ptr(Q);
-    if (!q_data) {
-        LOG_ERROR("cml_paged_gqa_forward: failed to get Q data pointer");
+Tensor* cml_paged_gqa_forward_batch(CMLPagedKVCache* cache, const int* seq_ids,
+                                     const int* q_lens, int num_seqs, Tensor* Q,
+                                     const CMLGQAConfig* config) {
+    if (!cache || !seq_ids || !q_lens || !Q || !config) {
+        LOG_ERROR("cml_paged_gqa_forward_batch: NULL argument");
         return NULL;
     }
 
-    /* Allocate output: [1, seq_q, num_heads * head_dim] */
-    size_t out_size = (size_t)seq_q * num_heads * head_dim;
-    float* output = (float*)calloc(out_size, sizeof(float));
-    if (!output) {
-        LOG_ERROR("cml_paged_gqa_forward: output allocation failed");
+    tensor_ensure_executed(Q);
+    if (Q->dtype != DTYPE_FLOAT32 || Q->ndim < 2 ||
+        Q->shape[Q->ndim - 1] != config->num_heads * config->head_dim) {
+        LOG_ERROR("cml_paged_gqa_forward_batch: Q must be float32 [..., num_heads*head_dim]");
         return NULL;
     }
 
-    /* Allocate scratch for attention scores: [seq_q, kv_len] */
-    float* scores = (float*)malloc((size_t)seq_q * kv_len * sizeof(float));
-    if (!scores) {
-        LOG_ERROR("cml_paged_gqa_forward: scores allocation failed");
-        free(output);
+    size_t total_q = 0;
+    for (int s = 0; s < num_seqs; s++) total_q += (size_t)(q_lens[s] > 0 ? q_lens[s] : 0);
+    if (Q->numel != total_q * (size_t)config->num_heads * config->head_dim) {
+        LOG_ERROR("cml_paged_gqa_forward_batch: Q holds %zu elements, expected %zu query rows",
+                  Q->numel, total_q);
         return NULL;
     }
 
-    size_t kv_stride = (size_t)num_kv_heads * head_dim;  /* floats per token in a block */
+    Tensor* Qc = tensor_is_contiguous(Q) ? Q : tensor_contiguous(Q);
+    const float* q_data = Qc ? (const float*)tensor_data_ptr(Qc) : NULL;
 
-    /* For each query head */
-    for (int h = 0; h < num_heads; h++) {
-        int kv_h = h / groups;
-
-        /* Compute attention scores by iterating over paged blocks */
-        for (int sq = 0; sq < seq_q; sq++) {
-            int token_idx = 0;  /* running KV position across blocks */
-            for (int bi = 0; bi < bt->num_blocks; bi++) {
-                int bid = bt->block_ids[bi];
-                CMLPageBlock* blk = &cache->blocks[bid];
-                int tokens_in_blk = blk->num_tokens;
+    TensorConfig out_cfg = {.dtype = DTYPE_FLOAT32, .device = DEVICE_CPU,
+                            .has_dtype = true, .has_device = true};
+    Tensor* result = tensor_empty(Q->shape, Q->ndim, &out_cfg);
+    if (result) tensor_ensure_executed(result);
 
-                for (int t = 0; t < tokens_in_blk; t++, token_idx++) {
-                    float dot = 0.0f;
-                    for (int d = 0; d < head_dim; d++) {
-                        float q_val = q_data[(size_t)sq * num_heads * head_dim
-                                             + h * head_dim + d];
-                        float k_val = blk->key_data[(size_t)t * kv_stride
-                                                    + kv_h * head_dim + d];
-                        dot += q_val * k_val;
-                    }
-                    scores[sq * kv_len + token_idx] = dot * scale;
-                }
-            }
-        }
+    if (!q_data || !result || !result->data ||
+        cml_paged_attention_batch(cache, seq_ids, q_lens, num_seqs, q_data,
+                                  (float*)result->data, config) != 0) {
+        if (result) tensor_free(result);
+        result = NULL;
+    }
+    if (Qc && Qc != Q) tensor_free(Qc);
+    return result;
+}
 
-        /* Apply causal mask */
-        if (config->causal) {
-            for (int sq = 0; sq < seq_q; sq++) {
-                /* In decode mode the query position is typically at the end of
-                   the KV sequence.  Map query position sq to its absolute
-                   position: kv_len - seq_q + sq  (last seq_q positions). */
-                int abs_pos = kv_len - seq_q + sq;
-                for (int sk = 0; sk < kv_len; sk++) {
-                    if (sk > abs_pos) {
-                        scores[sq * kv_len + sk] = -1e9f;
-                    }
-                }
-            }
-        }
+Tensor* cml_paged_gqa_forward(CMLPagedKVCache* cache, int seq_id,
+                               Tensor* Q, const CMLGQAConfig* config) {
+    if (!cache || !Q || !config) {
+        LOG_ERROR("cml_paged_gqa_forward: NULL argument");
+        return NULL;
+    }
+    if (seq_id < 0 || seq_id >= cache->max_sequences) {
+        LOG_ERROR("cml_paged_gqa_forward: invalid seq_id %d", seq_id);
+        return NULL;
+    }
 
-        /* Softmax over kv_len */
-        paged_softmax_inplace(scores, seq_q, kv_len);
-
-        /* Weighted sum: gather V from paged blocks */
-        for (int sq = 0; sq < seq_q; sq++) {
-            int token_idx = 0;
-            for (int bi = 0; bi < bt->num_blocks; bi++) {
-                int bid = bt->block_ids[bi];
-                CMLPageBlock* blk = &cache->blocks[bid];
-                int tokens_in_blk = blk->num_tokens;
-
-                for (int t = 0; t < tokens_in_blk; t++, token_idx++) {
-                    float w = scores[sq * kv_len + token_idx];
-                    for (int d = 0; d < head_dim; d++) {
-                        float v_val = blk->value_data[(size_t)t * kv_stride
-                                                      + kv_h * head_dim + d];
-                        output[(size_t)sq * num_heads * head_dim
-                               + h * head_dim + d] += w * v_val;
-                    }
-                }
-            }
-        }
+    CMLBlockTable* bt = &cache->sequences[seq_id];
+    if (!bt->block_ids) {
+        LOG_ERROR("cml_paged_gqa_forward: sequence %d not initialised", seq_id);
+        return NULL;
     }
 
-    free(scores);
+    tensor_ensure_executed(Q);
 
-    /* Wrap output into a tensor [1, seq_q, num_heads * head_dim] */
-    int out_shape[] = {1, seq_q, num_heads * head_dim};
-    TensorConfig out_cfg = {.dtype = DTYPE_FLOAT32, .device = DEVICE_CPU,
-                            .has_dtype = true, .has_device = true};
-    Tensor* result = tensor_from_data(output, out_shape, 3, &out_cfg);
-    free(output);
+    if (Q->ndim != 3) {
+        LOG_ERROR("cml_paged_gqa_forward: Q must be 3D [batch, seq_len, num_heads*head_dim], "
+                  "got ndim=%d", Q->ndim);
+        return NULL;
+    }
+    if (paged_check_config(cache, config, "cml_paged_gqa_forward") != 0) return NULL;
 
-    if (!result) {
-        LOG_ERROR("cml_paged_gqa_forward: failed to create output tensor");
+    if (Q->shape[0] != 1) {
+        LOG_ERROR("cml_paged_gqa_forward: one sequence per call (batch=1), got %d; "
+                  "use cml_paged_gqa_forward_batch", Q->shape[0]);
+        return NULL;
     }
-    return result;
+    if (bt->seq_len == 0) {
+        LOG_ERROR("cml_paged_gqa_forward: sequence %d has no cached tokens", seq_id);
+        return NULL;
+    }
+
+    int seq_q = Q->shape[1];
+    return cml_paged_gqa_forward_batch(cache, &seq_id, &seq_q, 1, Q, config);
 }
@@ -1,6 +1,8 @@
 #include "nn/serving.h"
+#include "nn/paged_attention.h"
 #include "core/logging.h"
 
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -29,6 +31,14 @@ static CMLSequenceRequest* find_request(CMLServingContext* ctx, int request_id)
         }
     }
 
+    /* Swapped out, or finished and not yet collected */
+    for (int i = 0; i < ctx->num_swapped; i++) {
+        if (ctx->swapped[i]->request_id == request_id) return ctx->swapped[i];
+    }
+    for (int i = 0; i < ctx->num_finished; i++) {
+        if (ctx->finished[i]->request_id == request_id) return ctx->finished[i];
+    }
+
     return NULL;
 }
 
@@ -36,6 +46,8 @@ static void free_request(CMLSequenceRequest* req) {
     if (!req) return;
     free(req->prompt_tokens);
     free(req->generated_tokens);
+    free(req->swap_keys);
+    free(req->swap_values);
     free(req);
 }
 
@@ -47,10 +59,28 @@ CMLServingConfig cml_serving_default_config(void) {
         .max_new_tokens_default = 256,
         .temperature_default  = 0.8f,
         .top_p_default        = 0.9f,
+        .max_batch_tokens     = 512,
+        .prefill_chunk_size   = 256,
+        .eos_token_id         = -1,
+        .preempt_mode         = CML_PREEMPT_RECOMPUTE,
     };
     return config;
 }
 
+static void serving_release(CMLServingContext* ctx) {
+    free(ctx->queue);
+    free(ctx->active_batch);
+    free(ctx->swapped);
+    free(ctx->finished);
+    free(ctx->entries);
+    free(ctx->entry_reqs);
+    free(ctx->entry_tokens);
+    free(ctx->next_tokens);
+    free(ctx->ttft_samples);
+    free(ctx->itl_samples);
+    free(ctx);
+}
+
 CMLServingContext* cml_serving_create(const CMLServingConfig* config) {
     if (!config) {
         LOG_ERROR("cml_serving_create: NULL config");
@@ -76,13 +106,22 @@ CMLServingContext* cml_serving_create(const CMLServingConfig* config) {
     if (ctx->config.max_queue_size > CML_SERVING_MAX_QUEUE)
         ctx->config.max_queue_size = CML_SERVING_MAX_QUEUE;
 
-    /* Allocate circular queue */
-    ctx->queue_capacity = ctx->config.max_queue_size;
+    /* Every sequence needs at least its decode token each step */
+    if (ctx->config.max_batch_tokens < ctx->config.max_batch_size)
+        ctx->config.max_batch_tokens = ctx->config.max_batch_size > 512
+                                       ? ctx->config.max_batch_size : 512;
+    if (ctx->config.prefill_chunk_size <= 0 ||
+        ctx->config.prefill_chunk_size > ctx->config.max_batch_tokens)
+        ctx->config.prefill_chunk_size = ctx->config.max_batch_tokens;
+
+    /* Allocate circular queue; preempted requests go back to its front, so
+     * leave room for a full batch beyond the submission limit */
+    ctx->queue_capacity = ctx->config.max_queue_size + ctx->config.max_batch_size;
     ctx->queue = (CMLSequenceRequest**)calloc((size_t)ctx->queue_capacity,
                                               sizeof(CMLSequenceRequest*));
     if (!ctx->queue) {
         LOG_ERROR("cml_serving_create: queue allocation failed");
-        free(ctx);
+        serving_release(ctx);
         return NULL;
     }
     ctx->queue_head = 0;
@@ -90,16 +129,30 @@ CMLServingContext* cml_serving_create(const CMLServingConfig* config) {
     ctx->queue_count = 0;
 
     /* Allocate active batch array */
-    ctx->active_batch = (CMLSequenceRequest**)calloc((size_t)ctx->config.max_batch_size,
-                                                     sizeof(CMLSequenceRequest*));
+    size_t max_batch = (size_t)ctx->config.max_batch_size;
+    ctx->active_batch = (CMLSequenceRequest**)calloc(max_batch, sizeof(CMLSequenceRequest*));
     if (!ctx->active_batch) {
         LOG_ERROR("cml_serving_create: active batch allocation failed");
-        free(ctx->queue);
-        free(ctx);
+        serving_release(ctx);
         return NULL;
     }
     ctx->batch_size = 0;
 
+    /* Forward-loop scratch */
+    ctx->swapped      = (CMLSequenceRequest**)calloc(max_batch, sizeof(CMLSequenceRequest*));
+    ctx->entries      = (CMLServingBatchEntry*)calloc(max_batch, sizeof(CMLServingBatchEntry));
+    ctx->entry_reqs   = (CMLSequenceRequest**)calloc(max_batch, sizeof(CMLSequenceRequest*));
+    ctx->next_tokens  = (int*)calloc(max_batch, sizeof(int));
+    ctx->entry_tokens = (int*)malloc((size_t)ctx->config.max_batch_tokens * sizeof(int));
+    ctx->ttft_samples = (double*)malloc(CML_SERVING_LATENCY_WINDOW * sizeof(double));
+    ctx->itl_samples  = (double*)malloc(CML_SERVING_LATENCY_WINDOW * sizeof(double));
+    if (!ctx->swapped || !ctx->entries || !ctx->entry_reqs || !ctx->next_tokens ||
+        !ctx->entry_tokens || !ctx->ttft_samples || !ctx->itl_samples) {
+        LOG_ERROR("cml_serving_create: scheduler scratch allocation failed");
+        serving_release(ctx);
+        return NULL;
+    }
+
     /* Stats start at zero (calloc) */
     ctx->next_request_id = 1;
     ctx->kv_cache = NULL;
@@ -109,6 +162,12 @@ CMLServingContext* cml_serving_create(const CMLServingConfig* config) {
     return ctx;
 }
 
+static void kv_release(CMLServingContext* ctx, CMLSequenceRequest* req) {
+    if (ctx->kv_cache && req->paged_seq_id >= 0)
+        cml_paged_cache_free_sequence(ctx->kv_cache, req->paged_seq_id);
+    req->paged_seq_id = -1;
+}
+
 void cml_serving_free(CMLServingContext* ctx) {
     if (!ctx) return;
 
@@ -118,18 +177,21 @@ void cml_serving_free(CMLServingContext* ctx) {
         free_request(ctx->queue[idx]);
         ctx->queue[idx] = NULL;
     }
-    free(ctx->queue);
 
-    /* Free all active requests */
+    /* Free all active requests, returning their blocks to the pool */
     for (int i = 0; i < ctx->batch_size; i++) {
+        kv_release(ctx, ctx->active_batch[i]);
         free_request(ctx->active_batch[i]);
         ctx->active_batch[i] = NULL;
     }
-    free(ctx->active_batch);
+    for (int i = 0; i < ctx->num_swapped; i++)
+        free_request(ctx->swapped[i]);
+    for (int i = 0; i < ctx->num_finished; i++)
+        free_request(ctx->finished[i]);
 
     LOG_INFO("Serving context freed (total_requests=%zu, completed=%zu)",
              ctx->stats.total_requests, ctx->stats.completed_requests);
-    free(ctx);
+    serving_release(ctx);
 }
 
 void cml_serving_set_kv_cache(CMLServingContext* ctx, CMLPagedKVCache* cache) {
@@ -138,6 +200,13 @@ void cml_serving_set_kv_cache(CMLServingContext* ctx, CMLPagedKVCache* cache) {
     LOG_INFO("Paged KV cache set on serving context");
 }
 
+void cml_serving_set_forward(CMLServingContext* ctx, CMLServingForwardFn forward,
+                             void* user_data) {
+    if (!ctx) return;
+    ctx->forward = forward;
+    ctx->forward_user_data = user_data;
+}
+
 int cml_serving_submit(CMLServingContext* ctx, const int* prompt_tokens,
                        int num_tokens, int max_new_tokens) {
     if (!ctx) {
@@ -151,9 +220,9 @@ int cml_serving_submit(CMLServingContext* ctx, const int* prompt_tokens,
     }
 
     /* Check queue capacity */
-    if (ctx->queue_count >= ctx->queue_capacity) {
+    if (ctx->queue_count >= ctx->config.max_queue_size) {
         LOG_WARNING("cml_serving_submit: queue full (%d/%d)",
-                    ctx->queue_count, ctx->queue_capacity);
+                    ctx->queue_count, ctx->config.max_queue_size);
         return -1;
     }
 
@@ -182,6 +251,7 @@ int cml_serving_submit(CMLServingContext* ctx, const int* prompt_tokens,
     req->status = CML_SEQ_STATUS_QUEUED;
     req->paged_seq_id = -1;
     req->current_pos = 0;
+    req->prefill_target = num_tokens;
 
     /* Pre-allocate generated token buffer */
     req->gen_capacity = req->max_new_tokens;
@@ -209,15 +279,385 @@ int cml_serving_submit(CMLServingContext* ctx, const int* prompt_tokens,
     return req->request_id;
 }
 
+int cml_serving_set_sampling(CMLServingContext* ctx, int request_id,
+                             float temperature, float top_p) {
+    CMLSequenceRequest* req = find_request(ctx, request_id);
+    if (!req) return -1;
+    req->temperature = temperature;
+    req->top_p = top_p;
+    return 0;
+}
+
+static CMLSequenceRequest* queue_pop_front(CMLServingContext* ctx) {
+    CMLSequenceRequest* req = ctx->queue[ctx->queue_head];
+    ctx->queue[ctx->queue_head] = NULL;
+    ctx->queue_head = (ctx->queue_head + 1) % ctx->queue_capacity;
+    ctx->queue_count--;
+    return req;
+}
+
+static void queue_push_front(CMLServingContext* ctx, CMLSequenceRequest* req) {
+    ctx->queue_head = (ctx->queue_head + ctx->queue_capacity - 1) % ctx->queue_capacity;
+    ctx->queue[ctx->queue_head] = req;
+    ctx->queue_count++;
+}
+
+/* Keeps the batch in admission order, which is also preemption priority */
+static void batch_remove(CMLServingContext* ctx, int idx) {
+    memmove(&ctx->active_batch[idx], &ctx->active_batch[idx + 1],
+            (size_t)(ctx->batch_size - idx - 1) * sizeof(CMLSequenceRequest*));
+    ctx->active_batch[--ctx->batch_size] = NULL;
+}
+
+static int batch_index(const CMLServingContext* ctx, const CMLSequenceRequest* req) {
+    for (int i = 0; i < ctx->batch_size; i++) {
+        if (ctx->active_batch[i] == req) return i;
+    }
+    return -1;
+}
+
+static void record_latency(double* ring, size_t* count, double value) {
+    ring[*count % CML_SERVING_LATENCY_WINDOW] = value;
+    (*count)++;
+}
+
+/* Completion stats, shared by both modes */
+static void account_finished(CMLServingContext* ctx, CMLSequenceRequest* req) {
+    req->finish_time_ms = serving_time_ms();
+
+    /* Update stats */
+    ctx->stats.completed_requests++;
+    ctx->stats.total_tokens_generated += (size_t)req->num_generated;
+    if (ctx->stats.active_sequences > 0)
+        ctx->stats.active_sequences--;
+
+    /* Compute timing stats */
+    double request_time_ms = req->finish_time_ms - req->submit_time_ms;
+    ctx->stats.total_time_ms += request_time_ms;
+
+    if (req->first_token_time_ms > 0.0) {
+        double ttft = req->first_token_time_ms - req->submit_time_ms;
+        /* Running average of time-to-first-token */
+        size_t n = ctx->stats.completed_requests;
+        ctx->stats.avg_time_to_first_token_ms =
+            ((ctx->stats.avg_time_to_first_token_ms * (double)(n - 1)) + ttft) / (double)n;
+        /* The forward loop records TTFT when the token is produced */
+        if (!ctx->forward)
+            record_latency(ctx->ttft_samples, &ctx->num_ttft_samples, ttft);
+    }
+
+    if (ctx->stats.total_time_ms > 0.0) {
+        ctx->stats.avg_tokens_per_second =
+            (double)ctx->stats.total_tokens_generated /
+            (ctx->stats.total_time_ms / 1000.0);
+    }
+}
+
+/* Forward loop: retire an active request to the finished list, where it
+ * stays readable until cml_serving_finish_request */
+static void complete_request(CMLServingContext* ctx, CMLSequenceRequest* req,
+                             CMLSequenceStatus status) {
+    int idx = batch_index(ctx, req);
+    if (idx >= 0) batch_remove(ctx, idx);
+    kv_release(ctx, req);
+    req->status = status;
+    account_finished(ctx, req);
+
+    if (ctx->num_finished >= ctx->finished_capacity) {
+        int cap = ctx->finished_capacity ? ctx->finished_capacity * 2 : 16;
+        CMLSequenceRequest** grown =
+            (CMLSequenceRequest**)realloc(ctx->finished, (size_t)cap * sizeof(*grown));
+        if (!grown) {
+            LOG_ERROR("serving: cannot retain finished request %d", req->request_id);
+            free_request(req);
+            return;
+        }
+        ctx->finished = grown;
+        ctx->finished_capacity = cap;
+    }
+    ctx->finished[ctx->num_finished++] = req;
+
+    LOG_DEBUG("Request %d %s (%d tokens, %.1f ms)", req->request_id,
+              status == CML_SEQ_STATUS_FINISHED ? "finished" : "failed",
+              req->num_generated, req->finish_time_ms - req->submit_time_ms);
+}
+
+static int kv_block_size(const CMLServingContext* ctx) {
+    return ctx->kv_cache ? ctx->kv_cache->block_size : 1;
+}
+
+static int kv_blocks_for(const CMLServingContext* ctx, int tokens) {
+    int bs = kv_block_size(ctx);
+    return (tokens + bs - 1) / bs;
+}
+
+/* Blocks a sequence holding `have` tokens allocates to append `add` more */
+static int kv_blocks_to_grow(const CMLServingContext* ctx, int have, int add) {
+    return kv_blocks_for(ctx, have + add) - kv_blocks_for(ctx, have);
+}
+
+static int kv_free_blocks(const CMLServingContext* ctx) {
+    return ctx->kv_cache ? ctx->kv_cache->free_count : INT_MAX / 2;
+}
+
+/* Copies a sequence's K/V out of the pool so its blocks can be reused */
+static int swap_out(CMLServingContext* ctx, CMLSequenceRequest* req) {
+    CMLPagedKVCache* cache = ctx->kv_cache;
+    const CMLBlockTable* bt = &cache->sequences[req->paged_seq_id];
+    size_t kv_floats = (size_t)cache->num_kv_heads * cache->head_dim;
+    size_t total = (size_t)bt->seq_len * kv_floats;
+
+    req->swap_keys = (float*)malloc(total * sizeof(float));
+    req->swap_values = (float*)malloc(total * sizeof(float));
+    if (!req->swap_keys || !req->swap_values) {
+        free(req->swap_keys);
+        free(req->swap_values);
+        req->swap_keys = req->swap_values = NULL;
+        return -1;
+    }
+
+    size_t off = 0;
+    for (int b = 0; b < bt->num_blocks; b++) {
+        const CMLPageBlock* blk = &cache->blocks[bt->block_ids[b]];
+        size_t n = (size_t)blk->num_tokens * kv_floats;
+        memcpy(req->swap_keys + off, blk->key_data, n * sizeof(float));
+        memcpy(req->swap_values + off, blk->value_data, n * sizeof(float));
+        off += n;
+    }
+    kv_release(ctx, req);
+    return 0;
+}
+
+static int swap_in(CMLServingContext* ctx, CMLSequenceRequest* req) {
+    CMLPagedKVCache* cache = ctx->kv_cache;
+    int seq_id = cml_paged_cache_init_sequence(cache);
+    if (seq_id < 0) return -1;
+
+    size_t kv_floats = (size_t)cache->num_kv_heads * cache->head_dim;
+    for (int t = 0; t < req->num_computed; t++) {
+        if (cml_paged_cache_append(cache, seq_id, req->swap_keys + t * kv_floats,
+                                   req->swap_values + t * kv_floats) != 0) {
+            cml_paged_cache_free_sequence(cache, seq_id);
+            return -1;
+        }
+    }
+    free(req->swap_keys);
+    free(req->swap_values);
+    req->swap_keys = req->swap_values = NULL;
+    req->paged_seq_id = seq_id;
+    return 0;
+}
+
+/* Frees the blocks of the newest request in the batch */
+static void preempt_newest(CMLServingContext* ctx) {
+    int idx = ctx->batch_size - 1;
+    CMLSequenceRequest* req = ctx->active_batch[idx];
+    batch_remove(ctx, idx);
+    req->num_preemptions++;
+    ctx->stats.num_preemptions++;
+
+    if (ctx->config.preempt_mode == CML_PREEMPT_SWAP && ctx->kv_cache &&
+        req->paged_seq_id >= 0 && req->num_computed > 0 && swap_out(ctx, req) == 0) {
+        req->status = CML_SEQ_STATUS_SWAPPED;
+        ctx->swapped[ctx->num_swapped++] = req;
+        ctx->stats.num_swaps++;
+        LOG_DEBUG("Request %d swapped out (%d tokens)", req->request_id, req->num_computed);
+        return;
+    }
+
+    /* Recompute: prompt and output so far become the prefill */
+    kv_release(ctx, req);
+    req->num_computed = 0;
+    req->prefill_target = req->num_prompt_tokens + req->num_generated;
+    req->status = CML_SEQ_STATUS_QUEUED;
+    queue_push_front(ctx, req);
+    LOG_DEBUG("Request %d preempted for recompute", req->request_id);
+}
+
+static int sequence_token(const CMLSequenceRequest* req, int pos) {
+    return pos < req->num_prompt_tokens ? req->prompt_tokens[pos]
+                                        : req->generated_tokens[pos - req->num_prompt_tokens];
+}
+
+typedef struct {
+    int num_entries;
+    int tokens_used;
+    int budget;
+    int free_blocks;   /* Pool blocks not yet promised to an entry this step */
+} StepPlan;
+
+static void plan_entry(CMLServingContext* ctx, StepPlan* plan, CMLSequenceRequest* req,
+                       int num_tokens, bool wants_token) {
+    int* toks = ctx->entry_tokens + plan->tokens_used;
+    for (int i = 0; i < num_tokens; i++)
+        toks[i] = sequence_token(req, req->num_computed + i);
+
+    CMLServingBatchEntry* e = &ctx->entries[plan->num_entries];
+    e->request_id   = req->request_id;
+    e->paged_seq_id = req->paged_seq_id;
+    e->tokens       = toks;
+    e->num_tokens   = num_tokens;
+    e->start_pos    = req->num_computed;
+    e->wants_token  = wants_token;
+    e->temperature  = req->temperature;
+    e->top_p        = req->top_p;
+    ctx->entry_reqs[plan->num_entries++] = req;
+
+    plan->tokens_used += num_tokens;
+    plan->budget -= num_tokens;
+    plan->free_blocks -= kv_blocks_to_grow(ctx, req->num_computed, num_tokens);
+}
+
+/* Largest prefill chunk for req that fits the budget and the free blocks */
+static int prefill_chunk(const CMLServingContext* ctx, const StepPlan* plan,
+                         const CMLSequenceRequest* req) {
+    int n = req->prefill_target - req->num_computed;
+    if (n > ctx->config.prefill_chunk_size) n = ctx->config.prefill_chunk_size;
+    if (n > plan->budget) n = plan->budget;
+
+    int bs = kv_block_size(ctx);
+    long room = ((long)kv_blocks_for(ctx, req->num_computed) + plan->free_blocks) * bs -
+                req->num_computed;
+    if (room < n) n = room > 0 ? (int)room : 0;
+    return n;
+}
+
+static int serving_step_forward(CMLServingContext* ctx) {
+    StepPlan plan = {.budget = ctx->config.max_batch_tokens};
+
+    /* 1. Swapped sequences resume before anything new is admitted */
+    while (ctx->num_swapped > 0 && ctx->batch_size < ctx->config.max_batch_size) {
+        CMLSequenceRequest* req = ctx->swapped[0];
+        if (kv_blocks_for(ctx, req->num_computed + 1) > kv_free_blocks(ctx) ||
+            swap_in(ctx, req) != 0)
+            break;
+        memmove(&ctx->swapped[0], &ctx->swapped[1],
+                (size_t)(--ctx->num_swapped) * sizeof(CMLSequenceRequest*));
+        req->status = req->num_computed < req->prefill_target ? CML_SEQ_STATUS_PREFILL
+                                                              : CML_SEQ_STATUS_DECODING;
+        ctx->active_batch[ctx->batch_size++] = req;
+    }
+    plan.free_blocks = kv_free_blocks(ctx);
+
+    /* 2. One token per decoding sequence, oldest first; when the pool is
+     * out of blocks, the newest sequences give theirs up */
+    for (int i = 0; i < ctx->batch_size && plan.budget > 0; i++) {
+        CMLSequenceRequest* req = ctx->active_batch[i];
+        if (req->status != CML_SEQ_STATUS_DECODING) continue;
+
+        int grow = kv_blocks_to_grow(ctx, req->num_computed, 1);
+        bool preempted_self = false;
+        while (grow > plan.free_blocks) {
+            preempted_self = (ctx->batch_size - 1 == i);
+            int before = kv_free_blocks(ctx);
+            preempt_newest(ctx);
+            plan.free_blocks += kv_free_blocks(ctx) - before;
+            if (preempted_self) break;
+        }
+        if (preempted_self) break;
+        plan_entry(ctx, &plan, req, 1, true);
+    }
+
+    /* 3. Chunked prefill for sequences already admitted */
+    int outstanding = 0; /* Blocks still owed to unfinished prompts */
+    for (int i = 0; i < ctx->batch_size; i++) {
+        CMLSequenceRequest* req = ctx->active_batch[i];
+        if (req->status != CML_SEQ_STATUS_PREFILL) continue;
+
+        int n = plan.budget > 0 ? prefill_chunk(ctx, &plan, req) : 0;
+        if (n > 0) plan_entry(ctx, &plan, req, n, req->num_computed + n == req->prefill_target);
+        outstanding += kv_blocks_to_grow(ctx, req->num_computed + n,
+                                         req->prefill_target - req->num_computed - n + 1);
+    }
+
+    /* 4. Admission: FIFO, only while the pool can hold the whole prompt (plus
+     * the first generated token) on top of what running prompts still need */
+    int headroom = plan.free_blocks - outstanding;
+    while (plan.budget > 0 && ctx->queue_count > 0 &&
+           ctx->batch_size + ctx->num_swapped < ctx->config.max_batch_size) {
+        CMLSequenceRequest* req = ctx->queue[ctx->queue_head];
+        int need = kv_blocks_for(ctx, req->prefill_target + 1);
+
+        if (ctx->kv_cache && need > ctx->kv_cache->max_blocks) {
+            LOG_ERROR("serving: request %d needs %d KV blocks, pool has %d",
+                      req->request_id, need, ctx->kv_cache->max_blocks);
+            queue_pop_front(ctx);
+            ctx->stats.active_sequences++;
+            complete_request(ctx, req, CML_SEQ_STATUS_ERROR);
+            continue;
+        }
+        if (need > headroom) break;
+
+        int seq_id = -1;
+        if (ctx->kv_cache) {
+            seq_id = cml_paged_cache_init_sequence(ctx->kv_cache);
+            if (seq_id < 0) break;
+        }
+        queue_pop_front(ctx);
+        req->paged_seq_id = seq_id;
+        req->status = CML_SEQ_STATUS_PREFILL;
+        ctx->active_batch[ctx->batch_size++] = req;
+        if (req->num_preemptions == 0) ctx->stats.active_sequences++;
+        headroom -= need;
+
+        int n = prefill_chunk(ctx, &plan, req);
+        if (n > 0) plan_entry(ctx, &plan, req, n, n == req->prefill_target);
+    }
+
+    if (plan.num_entries == 0) return ctx->batch_size;
+
+    /* 5. One model call for the whole mixed batch */
+    if (ctx->forward(ctx->forward_user_data, ctx->kv_cache, ctx->entries, plan.num_entries,
+                     ctx->next_tokens) != 0) {
+        LOG_ERROR("serving: forward pass failed for a batch of %d sequences", plan.num_entries);
+        for (int e = 0; e < plan.num_entries; e++)
+            complete_request(ctx, ctx->entry_reqs[e], CML_SEQ_STATUS_ERROR);
+        return ctx->batch_size;
+    }
+    ctx->stats.num_steps++;
+
+    /* 6. Advance each sequence and collect sampled tokens */
+    double now = serving_time_ms();
+    for (int e = 0; e < plan.num_entries; e++) {
+        CMLSequenceRequest* req = ctx->entry_reqs[e];
+        const CMLServingBatchEntry* entry = &ctx->entries[e];
+        req->num_computed += entry->num_tokens;
+        if (req->status == CML_SEQ_STATUS_DECODING)
+            ctx->stats.decode_tokens += (size_t)entry->num_tokens;
+        else
+            ctx->stats.prefill_tokens += (size_t)entry->num_tokens;
+        if (!entry->wants_token) continue;
+
+        int token = ctx->next_tokens[e];
+        req->generated_tokens[req->num_generated++] = token;
+        req->current_pos = req->num_computed;
+        req->status = CML_SEQ_STATUS_DECODING;
+        if (req->first_token_time_ms == 0.0) {
+            req->first_token_time_ms = now;
+            record_latency(ctx->ttft_samples, &ctx->num_ttft_samples,
+                           now - req->submit_time_ms);
+        } else {
+            record_latency(ctx->itl_samples, &ctx->num_itl_samples,
+                           now - req->last_token_time_ms);
+            ctx->itl_total_ms += now - req->last_token_time_ms;
+        }
+        req->last_token_time_ms = now;
+
+        if (req->num_generated >= req->max_new_tokens ||
+            (ctx->config.eos_token_id >= 0 && token == ctx->config.eos_token_id))
+            complete_request(ctx, req, CML_SEQ_STATUS_FINISHED);
+    }
+
+    return ctx->batch_size;
+}
+
 int cml_serving_step(CMLServingContext* ctx) {
     if (!ctx) return 0;
+    if (ctx->forward) return serving_step_forward(ctx);
 
     /* Admit queued requests into the active batch */
     while (ctx->queue_count > 0 && ctx->batch_size < ctx->config.max_batch_size) {
-        CMLSequenceRequest* req = ctx->queue[ctx->queue_head];
-        ctx->queue[ctx->queue_head] = NULL;
-        ctx->queue_head = (ctx->queue_head + 1) % ctx->queue_capacity;
-        ctx->queue_count--;
+        CMLSequenceRequest* req = queue_pop_front(ctx);
 
         /* Transition: QUEUED -> PREFILL */
         req->status = CML_SEQ_STATUS_PREFILL;
@@ -262,6 +702,15 @@ const int* cml_serving_get_tokens(CMLServingContext* ctx, int request_id,
 int cml_serving_finish_request(CMLServingContext* ctx, int request_id) {
     if (!ctx) return -1;
 
+    /* Already completed by the forward loop: just release it */
+    for (int i = 0; i < ctx->num_finished; i++) {
+        if (ctx->finished[i]->request_id == request_id) {
+            free_request(ctx->finished[i]);
+            ctx->finished[i] = ctx->finished[--ctx->num_finished];
+            return 0;
+        }
+    }
+
     /* Search active batch for this request */
     int found_idx = -1;
     for (int i = 0; i < ctx->batch_size; i++) {
@@ -272,56 +721,70 @@ int cml_serving_finish_request(CMLServingContext* ctx, int request_id) {
         }
     }
 
-    if (found_idx < 0) {
+    CMLSequenceRequest* req = NULL;
+    if (found_idx >= 0) {
+        req = ctx->active_batch[found_idx];
+        batch_remove(ctx, found_idx);
+    } else {
+        for (int i = 0; i < ctx->num_swapped; i++) {
+            if (ctx->swapped[i]->request_id == request_id) {
+                req = ctx->swapped[i];
+                memmove(&ctx->swapped[i], &ctx->swapped[i + 1],
+                        (size_t)(--ctx->num_swapped - i) * sizeof(CMLSequenceRequest*));
+                break;
+            }
+        }
+    }
+
+    if (!req) {
         LOG_WARNING("cml_serving_finish_request: request %d not in active batch",
                     request_id);
         return -1;
     }
 
-    CMLSequenceRequest* req = ctx->active_batch[found_idx];
     req->status = CML_SEQ_STATUS_FINISHED;
-    req->finish_time_ms = serving_time_ms();
-
-    /* Update stats */
-    ctx->stats.completed_requests++;
-    ctx->stats.total_tokens_generated += (size_t)req->num_generated;
-    if (ctx->stats.active_sequences > 0)
-        ctx->stats.active_sequences--;
-
-    /* Compute timing stats */
-    double request_time_ms = req->finish_time_ms - req->submit_time_ms;
-    ctx->stats.total_time_ms += request_time_ms;
-
-    if (req->first_token_time_ms > 0.0) {
-        double ttft = req->first_token_time_ms - req->submit_time_ms;
-        /* Running average of time-to-first-token */
-        size_t n = ctx->stats.completed_requests;
-        ctx->stats.avg_time_to_first_token_ms =
-            ((ctx->stats.avg_time_to_first_token_ms * (double)(n - 1)) + ttft) / (double)n;
-    }
-
-    if (ctx->stats.total_time_ms > 0.0) {
-        ctx->stats.avg_tokens_per_second =
-            (double)ctx->stats.total_tokens_generated /
-            (ctx->stats.total_time_ms / 1000.0);
-    }
+    kv_release(ctx, req);
+    account_finished(ctx, req);
 
     LOG_DEBUG("Request %d finished (%d tokens, %.1f ms)",
               request_id, req->num_generated, req->finish_time_ms - req->submit_time_ms);
 
-    /* Remove from active batch: swap with last element */
     free_request(req);
-    ctx->active_batch[found_idx] = ctx->active_batch[ctx->batch_size - 1];
-    ctx->active_batch[ctx->batch_size - 1] = NULL;
-    ctx->batch_size--;
-
     return 0;
 }
 
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* p50/p99 over the retained window (nearest rank) */
+static void latency_percentiles(const double* ring, size_t count, double* p50, double* p99) {
+    size_t n = count < CML_SERVING_LATENCY_WINDOW ? count : CML_SERVING_LATENCY_WINDOW;
+    *p50 = *p99 = 0.0;
+    if (n == 0) return;
+
+    double* sorted = (double*)malloc(n * sizeof(double));
+    if (!sorted) return;
+    memcpy(sorted, ring, n * sizeof(double));
+    qsort(sorted, n, sizeof(double), cmp_double);
+    *p50 = sorted[(n - 1) / 2];
+    *p99 = sorted[(size_t)((double)(n - 1) * 0.99 + 0.5)];
+    free(sorted);
+}
+
 CMLServingStats cml_serving_get_stats(const CMLServingContext* ctx) {
     if (!ctx) {
         CMLServingStats empty = {0};
         return empty;
     }
-    return ctx->stats;
+
+    CMLServingStats stats = ctx->stats;
+    latency_percentiles(ctx->ttft_samples, ctx->num_ttft_samples,
+                        &stats.p50_time_to_first_token_ms, &stats.p99_time_to_first_token_ms);
+    latency_percentiles(ctx->itl_samples, ctx->num_itl_samples,
+                        &stats.p50_inter_token_latency_ms, &stats.p99_inter_token_latency_ms);
+    if (ctx->num_itl_samples > 0)
+        stats.avg_inter_token_latency_ms = ctx->itl_total_ms / (double)ctx->num_itl_samples;
+    return stats;
 }
@@ -138,6 +138,7 @@ int nn_load_state_dict(Module* module, const StateDict* sd, bool strict) {
         if (dst->data && src->data) {
             memcpy(dst->data, src->data, byte_size);
             dst->is_executed = true;
+            tensor_bump_version(dst);
         }
     }
     nn_state_dict_free(mod_sd);
@@ -0,0 +1,524 @@
+#include "ops/conv_blocked.h"
+#include "backend/threadpool.h"
+#include "core/logging.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX512F__) || (defined(__AVX2__) && defined(__FMA__))
+#include <immintrin.h>
+#endif
+
+#define CB                  CML_CONV_BLOCK
+#define CONV_TW             6  /* Output pixels per register tile */
+#define CONV_CARRY_SLOTS    16
+#define CONV_WEIGHT_SLOTS   32
+
+typedef struct {
+    float* data;
+    size_t cap; /* Floats */
+} ConvScratch;
+
+/* Output, padded input, per-call packed weights and padded bias of a
+ * convolution that keeps nothing for later */
+static _Thread_local ConvScratch t_out;
+static _Thread_local ConvScratch t_padded;
+static _Thread_local ConvScratch t_weights;
+static _Thread_local ConvScratch t_bias;
+
+/* Blocked outputs kept for a later node, keyed by (node, graph epoch). An
+ * entry with a key belongs to one producer and then one consumer, which the
+ * graph orders, so only claiming and releasing entries takes the lock. */
+typedef struct {
+    const void* key;
+    uint64_t epoch;
+    int batch, channels, h, w;
+    ConvScratch buf;
+} ConvCarry;
+
+static ConvCarry g_carry[CONV_CARRY_SLOTS];
+static pthread_mutex_t g_carry_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Atomic uint64_t g_carry_epoch;
+
+/* Packed weights keyed by (tensor, version), pinned while a convolution
+ * reads them, like the Winograd transform cache */
+typedef struct {
+    const void* key;
+    uint64_t version;
+    int out_channels, in_channels, kernel_h, kernel_w;
+    uint64_t last_use;
+    int pins;
+    ConvScratch buf;
+} ConvPacked;
+
+static ConvPacked g_packed[CONV_WEIGHT_SLOTS];
+static uint64_t g_packed_clock;
+static pthread_mutex_t g_packed_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static float* scratch_reserve(ConvScratch* s, size_t floats) {
+    if (floats <= s->cap)
+        return s->data;
+    size_t bytes = (floats * sizeof(float) + 63) & ~(size_t)63;
+    float* p     = aligned_alloc(64, bytes);
+    if (!p)
+        return NULL;
+    free(s->data);
+    s->data = p;
+    s->cap  = bytes / sizeof(float);
+    return p;
+}
+
+static int blocks(int channels) { return (channels + CB - 1) / CB; }
+
+bool cml_conv_blocked_applicable(const ConvBlockedShape* s, int groups) {
+    static int s_mode = -1; /* 0 = off, 1 = auto, 2 = always */
+    if (s_mode < 0) {
+        const char* env = getenv("CML_CONV_LAYOUT");
+        s_mode          = !env ? 1 : strcmp(env, "nchw") == 0 ? 0 : strcmp(env, "blocked") == 0 ? 2 : 1;
+    }
+    if (s_mode == 0 || groups != 1 || !s)
+        return false;
+    if (s_mode == 2)
+        return true;
+    /* Shallow inputs waste most of each channel block */
+    return s->in_channels >= CB / 2 && s->out_channels >= CB;
+}
+
+/* NCHW -> blocked with a zero halo of pad_h x pad_w */
+static void reorder_in(const float* src, float* dst, int batch, int channels, int h, int w,
+                       int pad_h, int pad_w) {
+    int nb = blocks(channels), hp = h + 2 * pad_h, wp = w + 2 * pad_w;
+    memset(dst, 0, (size_t)batch * nb * hp * wp * CB * sizeof(float));
+    for (int b = 0; b < batch; b++) {
+        for (int c = 0; c < channels; c++) {
+            const float* s = src + ((size_t)b * channels + c) * h * w;
+            float* d       = dst + ((size_t)b * nb + c / CB) * hp * wp * CB + c % CB;
+            for (int y = 0; y < h; y++) {
+                float* row = d + ((size_t)(y + pad_h) * wp + pad_w) * CB;
+                for (int x = 0; x < w; x++)
+                    row[(size_t)x * CB] = s[(size_t)y * w + x];
+            }
+        }
+    }
+}
+
+/* Unpadded blocked -> blocked with a zero halo */
+static void pad_blocked(const float* src, float* dst, int batch, int channels, int h, int w,
+                        int pad_h, int pad_w) {
+    int nb = blocks(channels), hp = h + 2 * pad_h, wp = w + 2 * pad_w;
+    memset(dst, 0, (size_t)batch * nb * hp * wp * CB * sizeof(float));
+    for (size_t p = 0; p < (size_t)batch * nb; p++)
+        for (int y = 0; y < h; y++)
+            memcpy(dst + ((p * hp + y + pad_h) * wp + pad_w) * CB, src + (p * h + y) * w * CB,
+                   (size_t)w * CB * sizeof(float));
+}
+
+static void reorder_out(const float* src, float* dst, int batch, int channels, int h, int w) {
+    int nb = blocks(channels);
+    for (int b = 0; b < batch; b++) {
+        for (int c = 0; c < channels; c++) {
+            const float* s = src + ((size_t)b * nb + c / CB) * h * w * CB + c % CB;
+            float* d       = dst + ((size_t)b * channels + c) * h * w;
+            for (size_t i = 0; i < (size_t)h * w; i++)
+                d[i] = s[i * CB];
+        }
+    }
+}
+
+/* [oc][ic][kh][kw] -> [ocb][icb][kh][kw][ic % CB][oc % CB], zero-filled */
+static void pack_weights(const float* w, float* dst, const ConvBlockedShape* s) {
+    int ocb = blocks(s->out_channels), icb = blocks(s->in_channels);
+    int kk  = s->kernel_h * s->kernel_w;
+    memset(dst, 0, (size_t)ocb * icb * kk * CB * CB * sizeof(float));
+    for (int oc = 0; oc < s->out_channels; oc++)
+        for (int ic = 0; ic < s->in_channels; ic++)
+            for (int k = 0; k < kk; k++)
+                dst[((((size_t)(oc / CB) * icb + ic / CB) * kk + k) * CB + ic % CB) * CB +
+                    oc % CB] = w[((size_t)oc * s->in_channels + ic) * kk + k];
+}
+
+typedef struct {
+    const float* in; /* [batch][icb][hp][wp][CB] */
+    const float* w;  /* Packed weights */
+    const float* bias; /* [ocb * CB], zero-padded */
+    float* out;      /* [batch][ocb][out_h][out_w][CB] */
+    const ConvBlockedShape* s;
+    int icb, ocb, hp, wp;
+} ConvBlockedArgs;
+
+#if defined(__AVX512F__) || (defined(__AVX2__) && defined(__FMA__))
+
+#if defined(__AVX512F__)
+typedef __m512 cvec;
+#define VLOAD(p)       _mm512_load_ps(p)
+#define VSTORE(p, v)   _mm512_store_ps(p, v)
+#define VSET1(x)       _mm512_set1_ps(x)
+#define VFMA(a, b, c)  _mm512_fmadd_ps(a, b, c)
+#else
+typedef __m256 cvec;
+#define VLOAD(p)       _mm256_load_ps(p)
+#define VSTORE(p, v)   _mm256_store_ps(p, v)
+#define VSET1(x)       _mm256_set1_ps(x)
+#define VFMA(a, b, c)  _mm256_fmadd_ps(a, b, c)
+#endif
+
+/* tw output pixels x nocb output-channel blocks, all in registers for the
+ * full tile (tw and nocb are constants at the hot call sites) */
+static inline __attribute__((always_inline)) void
+conv_tile(const ConvBlockedArgs* a, int b, int ob, int nocb, int oy, int ox0, int tw) {
+    const ConvBlockedShape* s = a->s;
+    size_t wstride = (size_t)a->icb * s->kernel_h * s->kernel_w * CB * CB;
+    cvec acc0[CONV_TW], acc1[CONV_TW];
+    cvec b0 = VLOAD(a->bias + (size_t)ob * CB);
+    cvec b1 = nocb > 1 ? VLOAD(a->bias + (size_t)(ob + 1) * CB) : b0;
+    for (int t = 0; t < tw; t++) {
+        acc0[t] = b0;
+        acc1[t] = b1;
+    }
+    int xstep = s->stride_w * CB;
+    for (int ib = 0; ib < a->icb; ib++) {
+        const float* plane = a->in + ((size_t)b * a->icb + ib) * a->hp * a->wp * CB;
+        const float* wblk =
+            a->w + ((size_t)ob * a->icb + ib) * s->kernel_h * s->kernel_w * CB * CB;
+        for (int ky = 0; ky < s->kernel_h; ky++) {
+            const float* row = plane + (size_t)(oy * s->stride_h + ky * s->dilation_h) * a->wp * CB;
+            for (int kx = 0; kx < s->kernel_w; kx++) {
+                const float* x  = row + (size_t)(ox0 * s->stride_w + kx * s->dilation_w) * CB;
+                const float* w0 = wblk + (size_t)(ky * s->kernel_w + kx) * CB * CB;
+                for (int c = 0; c < CB; c++) {
+                    cvec wv0 = VLOAD(w0 + c * CB);
+                    if (nocb > 1) {
+                        cvec wv1 = VLOAD(w0 + wstride + c * CB);
+                        for (int t = 0; t < tw; t++) {
+                            cvec xv = VSET1(x[t * xstep + c]);
+                            acc0[t] = VFMA(xv, wv0, acc0[t]);
+                            acc1[t] = VFMA(xv, wv1, acc1[t]);
+                        }
+                    } else {
+                        for (int t = 0; t < tw; t++)
+                            acc0[t] = VFMA(VSET1(x[t * xstep + c]), wv0, acc0[t]);
+                    }
+                }
+            }
+        }
+    }
+    size_t plane_out = (size_t)s->out_h * s->out_w * CB;
+    float* o0 = a->out + ((size_t)b * a->ocb + ob) * plane_out + ((size_t)oy * s->out_w + ox0) * CB;
+    for (int t = 0; t < tw; t++) {
+        VSTORE(o0 + (size_t)t * CB, acc0[t]);
+        if (nocb > 1)
+            VSTORE(o0 + plane_out + (size_t)t * CB, acc1[t]);
+    }
+}
+
+static void conv_row(const ConvBlockedArgs* a, int b, int ob, int nocb, int oy) {
+    int ow = a->s->out_w, ox = 0;
+    if (nocb > 1) {
+        for (; ox + CONV_TW <= ow; ox += CONV_TW)
+            conv_tile(a, b, ob, 2, oy, ox, CONV_TW);
+        if (ox < ow)
+            conv_tile(a, b, ob, 2, oy, ox, ow - ox);
+    } else {
+        for (; ox + CONV_TW <= ow; ox += CONV_TW)
+            conv_tile(a, b, ob, 1, oy, ox, CONV_TW);
+        if (ox < ow)
+            conv_tile(a, b, ob, 1, oy, ox, ow - ox);
+    }
+}
+
+#else
+
+static void conv_row(const ConvBlockedArgs* a, int b, int ob, int nocb, int oy) {
+    const ConvBlockedShape* s = a->s;
+    size_t plane_out          = (size_t)s->out_h * s->out_w * CB;
+    for (int j = 0; j < nocb; j++) {
+        float* o = a->out + ((size_t)b * a->ocb + ob + j) * plane_out + (size_t)oy * s->out_w * CB;
+        for (int ox = 0; ox < s->out_w; ox++)
+            memcpy(o + (size_t)ox * CB, a->bias + (size_t)(ob + j) * CB, CB * sizeof(float));
+        for (int ib = 0; ib < a->icb; ib++) {
+            const float* plane = a->in + ((size_t)b * a->icb + ib) * a->hp * a->wp * CB;
+            const float* wblk =
+                a->w + ((size_t)(ob + j) * a->icb + ib) * s->kernel_h * s->kernel_w * CB * CB;
+            for (int ky = 0; ky < s->kernel_h; ky++) {
+                for (int kx = 0; kx < s->kernel_w; kx++) {
+                    const float* wk = wblk + (size_t)(ky * s->kernel_w + kx) * CB * CB;
+                    for (int ox = 0; ox < s->out_w; ox++) {
+                        const float* x =
+                            plane + ((size_t)(oy * s->stride_h + ky * s->dilation_h) * a->wp +
+                                     ox * s->stride_w + kx * s->dilation_w) *
+                                        CB;
+                        float* acc = o + (size_t)ox * CB;
+                        for (int c = 0; c < CB; c++)
+                            for (int k = 0; k < CB; k++)
+                                acc[k] += x[c] * wk[c * CB + k];
+                    }
+                }
+            }
+        }
+    }
+}
+
+#endif
+
+/* One task per (batch, output-channel block pair, output row) */
+static void conv_rows_task(void* data, size_t start, size_t end) {
+    const ConvBlockedArgs* a = (const ConvBlockedArgs*)data;
+    int pairs                = (a->ocb + 1) / 2;
+    int oh                   = a->s->out_h;
+    for (size_t r = start; r < end; r++) {
+        int oy = (int)(r % (size_t)oh);
+        int p  = (int)(r / (size_t)oh % (size_t)pairs);
+        int b  = (int)(r / ((size_t)oh * pairs));
+        int ob = 2 * p;
+        conv_row(a, b, ob, ob + 1 < a->ocb ? 2 : 1, oy);
+    }
+}
+
+static ConvCarry* carry_find(const void* key, uint64_t epoch) {
+    if (!key)
+        return NULL;
+    ConvCarry* found = NULL;
+    pthread_mutex_lock(&g_carry_lock);
+    for (int i = 0; i < CONV_CARRY_SLOTS && !found; i++)
+        if (g_carry[i].key == key && g_carry[i].epoch == epoch)
+            found = &g_carry[i];
+    pthread_mutex_unlock(&g_carry_lock);
+    return found;
+}
+
+/* Claims a free entry with room for floats, NULL when every entry is taken */
+static ConvCarry* carry_claim(const void* key, uint64_t epoch, size_t floats) {
+    ConvCarry* slot = NULL;
+    pthread_mutex_lock(&g_carry_lock);
+    for (int i = 0; i < CONV_CARRY_SLOTS; i++) {
+        ConvCarry* c = &g_carry[i];
+        if (!c->key && (!slot || (slot->buf.cap < floats && c->buf.cap > slot->buf.cap)))
+            slot = c;
+    }
+    if (slot && scratch_reserve(&slot->buf, floats)) {
+        slot->key   = key;
+        slot->epoch = epoch;
+    } else {
+        slot = NULL;
+    }
+    pthread_mutex_unlock(&g_carry_lock);
+    return slot;
+}
+
+/* Hands the entry on to key; NULL drops it, keeping the buffer for the next claim */
+static void carry_rekey(ConvCarry* c, const void* key) {
+    pthread_mutex_lock(&g_carry_lock);
+    c->key = key;
+    pthread_mutex_unlock(&g_carry_lock);
+}
+
+static bool carry_matches(const ConvCarry* c, int batch, int channels, int h, int w) {
+    return c->batch == batch && c->channels == channels && c->h == h && c->w == w;
+}
+
+static const float* packed_weights_cached(const void* key, uint64_t version,
+                                          const float* weight, const ConvBlockedShape* s) {
+    if (!key || version == 0)
+        return NULL;
+    size_t floats = (size_t)blocks(s->out_channels) * blocks(s->in_channels) * s->kernel_h *
+                    s->kernel_w * CB * CB;
+    pthread_mutex_lock(&g_packed_lock);
+    ConvPacked* slot   = NULL;
+    ConvPacked* victim = NULL;
+    for (int i = 0; i < CONV_WEIGHT_SLOTS; i++) {
+        ConvPacked* e = &g_packed[i];
+        if (e->key == key) {
+            if (e->version == version && e->out_channels == s->out_channels &&
+                e->in_channels == s->in_channels && e->kernel_h == s->kernel_h &&
+                e->kernel_w == s->kernel_w) {
+                slot = e;
+                break;
+            }
+            e->key = NULL; /* Stale: reusable once unpinned */
+        }
+        if (e->pins == 0 &&
+            (!victim || (victim->key && (!e->key || e->last_use < victim->last_use))))
+            victim = e;
+    }
+    if (!slot) {
+        slot = victim;
+        if (!slot || !scratch_reserve(&slot->buf, floats)) {
+            pthread_mutex_unlock(&g_packed_lock);
+            return NULL;
+        }
+        pack_weights(weight, slot->buf.data, s);
+        slot->key          = key;
+        slot->version      = version;
+        slot->out_channels = s->out_channels;
+        slot->in_channels  = s->in_channels;
+        slot->kernel_h     = s->kernel_h;
+        slot->kernel_w     = s->kernel_w;
+    }
+    slot->last_use    = ++g_packed_clock;
+    slot->pins++;
+    const float* data = slot->buf.data;
+    pthread_mutex_unlock(&g_packed_lock);
+    return data;
+}
+
+static void packed_weights_release(const float* packed) {
+    pthread_mutex_lock(&g_packed_lock);
+    for (int i = 0; i < CONV_WEIGHT_SLOTS; i++) {
+        if (g_packed[i].buf.data == packed && g_packed[i].pins > 0) {
+            g_packed[i].pins--;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_packed_lock);
+}
+
+int cml_conv2d_blocked_ex(const float* input, const float* weight, const float* bias,
+                          float* output, const ConvBlockedShape* s, const ConvBlockedIO* io) {
+    if (!weight || !s)
+        return -1;
+    static const ConvBlockedIO none;
+    if (!io)
+        io = &none;
+    int icb = blocks(s->in_channels), ocb = blocks(s->out_channels);
+    int hp = s->in_h + 2 * s->pad_h, wp = s->in_w + 2 * s->pad_w;
+
+    /* Input: the producer's kept blocked output, else the NCHW tensor */
+    ConvCarry* in_carry = carry_find(io->in_key, io->epoch);
+    if (in_carry && !carry_matches(in_carry, s->batch, s->in_channels, s->in_h, s->in_w))
+        in_carry = NULL;
+    if (!in_carry && !input)
+        return -1;
+    const float* in_blk = NULL;
+    if (in_carry && s->pad_h == 0 && s->pad_w == 0) {
+        in_blk = in_carry->buf.data;
+    } else {
+        float* padded = scratch_reserve(&t_padded, (size_t)s->batch * icb * hp * wp * CB);
+        if (padded && in_carry)
+            pad_blocked(in_carry->buf.data, padded, s->batch, s->in_channels, s->in_h, s->in_w,
+                        s->pad_h, s->pad_w);
+        else if (padded)
+            reorder_in(input, padded, s->batch, s->in_channels, s->in_h, s->in_w, s->pad_h,
+                       s->pad_w);
+        in_blk = padded;
+    }
+
+    /* Weights: packed once per version for a tracked tensor, else per call */
+    const float* wpack =
+        packed_weights_cached(io->weight_key, io->weight_version, weight, s);
+    bool pinned = wpack != NULL;
+    if (!wpack) {
+        float* w = scratch_reserve(&t_weights, (size_t)ocb * icb * s->kernel_h * s->kernel_w *
+                                                   CB * CB);
+        if (w)
+            pack_weights(weight, w, s);
+        wpack = w;
+    }
+    float* bias_blk = scratch_reserve(&t_bias, (size_t)ocb * CB);
+
+    /* Output: kept for out_key when an entry is free, else scratch */
+    size_t out_floats   = (size_t)s->batch * ocb * s->out_h * s->out_w * CB;
+    ConvCarry* out_carry = io->out_key ? carry_claim(io->out_key, io->epoch, out_floats) : NULL;
+    float* out_blk       = out_carry ? out_carry->buf.data : scratch_reserve(&t_out, out_floats);
+
+    if (!in_blk || !wpack || !bias_blk || !out_blk || (!out_carry && !output)) {
+        LOG_ERROR("Blocked conv: failed to allocate scratch");
+        if (pinned)
+            packed_weights_release(wpack);
+        if (out_carry)
+            carry_rekey(out_carry, NULL);
+        return -1;
+    }
+    memset(bias_blk, 0, (size_t)ocb * CB * sizeof(float));
+    if (bias)
+        memcpy(bias_blk, bias, (size_t)s->out_channels * sizeof(float));
+
+    ConvBlockedArgs args = {.in = in_blk, .w = wpack, .bias = bias_blk, .out = out_blk, .s = s,
+                            .icb = icb, .ocb = ocb, .hp = hp, .wp = wp};
+    size_t rows = (size_t)s->batch * ((ocb + 1) / 2) * s->out_h;
+    ThreadPool* pool = threadpool_get_global();
+    if (pool && rows > 1)
+        threadpool_parallel_for(pool, conv_rows_task, &args, rows);
+    else
+        conv_rows_task(&args, 0, rows);
+
+    if (pinned)
+        packed_weights_release(wpack);
+    /* The input had this convolution as its only reader */
+    if (in_carry)
+        carry_rekey(in_carry, NULL);
+
+    if (out_carry) {
+        out_carry->batch    = s->batch;
+        out_carry->channels = s->out_channels;
+        out_carry->h        = s->out_h;
+        out_carry->w        = s->out_w;
+        if (io->skip_output)
+            return 1;
+    }
+    reorder_out(out_blk, output, s->batch, s->out_channels, s->out_h, s->out_w);
+    return 0;
+}
+
+int cml_conv2d_blocked(const float* input, const float* weight, const float* bias,
+                       float* output, const ConvBlockedShape* s) {
+    return cml_conv2d_blocked_ex(input, weight, bias, output, s, NULL);
+}
+
+int cml_conv_blocked_relu(const ConvBlockedIO* io, float* out, size_t numel) {
+    ConvCarry* c = io ? carry_find(io->in_key, io->epoch) : NULL;
+    bool keep    = c && io->out_key && io->skip_output;
+    if (!c || (!keep && !out) || numel != (size_t)c->batch * c->channels * c->h * c->w)
+        return -1;
+    /* Padding lanes are zero and stay zero */
+    float* d = c->buf.data;
+    size_t n = (size_t)c->batch * blocks(c->channels) * c->h * c->w * CB;
+    for (size_t i = 0; i < n; i++)
+        d[i] = d[i] > 0.0f ? d[i] : 0.0f;
+    if (!keep)
+        reorder_out(d, out, c->batch, c->channels, c->h, c->w);
+    carry_rekey(c, io->out_key);
+    return keep ? 1 : 0;
+}
+
+int cml_conv_blocked_materialize(const void* key, uint64_t epoch, float* out, size_t numel) {
+    ConvCarry* c = carry_find(key, epoch);
+    if (!c || !out || numel != (size_t)c->batch * c->channels * c->h * c->w)
+        return -1;
+    reorder_out(c->buf.data, out, c->batch, c->channels, c->h, c->w);
+    return 0;
+}
+
+uint64_t cml_conv_blocked_graph_begin(void) { return atomic_fetch_add(&g_carry_epoch, 1) + 1; }
+
+void cml_conv_blocked_graph_end(uint64_t epoch) {
+    pthread_mutex_lock(&g_carry_lock);
+    for (int i = 0; i < CONV_CARRY_SLOTS; i++)
+        if (g_carry[i].key && g_carry[i].epoch == epoch)
+            g_carry[i].key = NULL;
+    pthread_mutex_unlock(&g_carry_lock);
+}
+
+void cml_conv_blocked_cleanup(void) {
+    ConvScratch* all[] = {&t_out, &t_padded, &t_weights, &t_bias};
+    for (size_t i = 0; i < sizeof(all) / sizeof(all[0]); i++) {
+        free(all[i]->data);
+        *all[i] = (ConvScratch){0};
+    }
+    pthread_mutex_lock(&g_carry_lock);
+    for (int i = 0; i < CONV_CARRY_SLOTS; i++) {
+        if (g_carry[i].key) /* Still kept for a consumer */
+            continue;
+        free(g_carry[i].buf.data);
+        g_carry[i] = (ConvCarry){0};
+    }
+    pthread_mutex_unlock(&g_carry_lock);
+    pthread_mutex_lock(&g_packed_lock);
+    for (int i = 0; i < CONV_WEIGHT_SLOTS; i++) {
+        if (g_packed[i].pins > 0) /* A conv still reads it */
+            continue;
+        free(g_packed[i].buf.data);
+        g_packed[i] = (ConvPacked){0};
+    }
+    pthread_mutex_unlock(&g_packed_lock);
+}
@@ -0,0 +1,558 @@
+#include "ops/conv_separable.h"
+#include "backend/threadpool.h"
+#include "core/logging.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX512F__) || (defined(__AVX2__) && defined(__FMA__))
+#include <immintrin.h>
+#endif
+
+#define DW_MAX_TAPS 121 /* Up to 11x11 */
+#define DW_BAND_FLOATS (32 * 1024) /* Depthwise tile kept hot for the fused pointwise GEMM */
+
+#if defined(__AVX512F__)
+#define DW_VW 16
+typedef __m512 dwvec;
+#define DW_LOADU(p)      _mm512_loadu_ps(p)
+#define DW_STOREU(p, v)  _mm512_storeu_ps(p, v)
+#define DW_SET1(x)       _mm512_set1_ps(x)
+#define DW_FMA(a, b, c)  _mm512_fmadd_ps(a, b, c)
+#define DW_HSUM(v)       _mm512_reduce_add_ps(v)
+typedef __mmask16 dwmask;
+#define DW_TAIL(n)             ((__mmask16)((1u << (n)) - 1))
+#define DW_MLOAD(p, m)         _mm512_maskz_loadu_ps(m, p)
+#define DW_MSTORE(p, m, v)     _mm512_mask_storeu_ps(p, m, v)
+#elif defined(__AVX2__) && defined(__FMA__)
+#define DW_VW 8
+typedef __m256 dwvec;
+#define DW_LOADU(p)      _mm256_loadu_ps(p)
+#define DW_STOREU(p, v)  _mm256_storeu_ps(p, v)
+#define DW_SET1(x)       _mm256_set1_ps(x)
+#define DW_FMA(a, b, c)  _mm256_fmadd_ps(a, b, c)
+static inline float dw_hsum(__m256 v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s        = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s        = _mm_add_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+}
+#define DW_HSUM(v) dw_hsum(v)
+typedef __m256i dwmask;
+static const int dw_tail_bits[16] = {-1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0};
+#define DW_TAIL(n)             _mm256_loadu_si256((const __m256i*)(dw_tail_bits + 8 - (n)))
+#define DW_MLOAD(p, m)         _mm256_maskload_ps(p, m)
+#define DW_MSTORE(p, m, v)     _mm256_maskstore_ps(p, m, v)
+#else
+#define DW_VW 1
+#endif
+
+typedef struct {
+    float* data;
+    size_t cap; /* Floats */
+} SepScratch;
+
+/* Padded input plane, padded gradient plane, depthwise band, pointwise band */
+static _Thread_local SepScratch t_plane;
+static _Thread_local SepScratch t_gplane;
+static _Thread_local SepScratch t_band;
+static _Thread_local SepScratch t_pwband;
+
+static float* scratch_reserve(SepScratch* s, size_t floats) {
+    if (floats <= s->cap)
+        return s->data;
+    float* p = malloc(floats * sizeof(float));
+    if (!p)
+        return NULL;
+    free(s->data);
+    s->data = p;
+    s->cap  = floats;
+    return p;
+}
+
+static bool separable_enabled(void) {
+    static int s_enabled = -1;
+    if (s_enabled < 0) {
+        const char* env = getenv("CML_CONV_SEPARABLE");
+        s_enabled       = !(env && env[0] == '0');
+    }
+    return s_enabled;
+}
+
+bool cml_conv_depthwise_applicable(const ConvBlockedShape* s, int groups) {
+    return s && separable_enabled() && groups > 1 && groups == s->in_channels &&
+           groups == s->out_channels && s->kernel_h * s->kernel_w <= DW_MAX_TAPS;
+}
+
+bool cml_conv_pointwise_applicable(const ConvBlockedShape* s, int groups) {
+    return s && separable_enabled() && groups == 1 && s->kernel_h == 1 && s->kernel_w == 1 &&
+           s->stride_h == 1 && s->stride_w == 1 && s->pad_h == 0 && s->pad_w == 0;
+}
+
+/*
+ * Padded plane layout: [hp][stride_w][wq]. Padded column x lives in phase
+ * x % stride_w at index x / stride_w, so the columns one tap reads for
+ * consecutive outputs are adjacent.
+ */
+typedef struct {
+    int hp, wp, wq;
+} PlaneGeom;
+
+static PlaneGeom plane_geom(const ConvBlockedShape* s) {
+    PlaneGeom g;
+    g.hp = s->in_h + 2 * s->pad_h;
+    g.wp = s->in_w + 2 * s->pad_w;
+    g.wq = (g.wp + s->stride_w - 1) / s->stride_w;
+    return g;
+}
+
+/* Padded rows [y0, y0 + rows) of one input plane */
+static void pad_rows(const float* src, float* dst, const ConvBlockedShape* s, PlaneGeom g,
+                     int y0, int rows) {
+    int sw = s->stride_w;
+    memset(dst, 0, (size_t)rows * sw * g.wq * sizeof(float));
+    for (int r = 0; r < rows; r++) {
+        int iy = y0 + r - s->pad_h;
+        if (iy < 0 || iy >= s->in_h)
+            continue;
+        const float* in = src + (size_t)iy * s->in_w;
+        float* row      = dst + (size_t)r * sw * g.wq;
+        if (sw == 1) {
+            memcpy(row + s->pad_w, in, (size_t)s->in_w * sizeof(float));
+            continue;
+        }
+        /* Phase r holds padded columns r, r + sw, ... */
+        for (int r = 0; r < sw; r++) {
+            float* d = row + (size_t)r * g.wq;
+            int j    = r < s->pad_w ? (s->pad_w - r + sw - 1) / sw : 0;
+            for (int ix = j * sw + r - s->pad_w; ix < s->in_w; ix += sw, j++)
+                d[j] = in[ix];
+        }
+    }
+}
+
+/* Start of the contiguous run tap (ky, kx) reads for output row oy, with the
+ * padded rows starting at y0 */
+static inline const float* tap_row(const float* plane, const ConvBlockedShape* s, PlaneGeom g,
+                                   int y0, int oy, int ky, int kx) {
+    int y = oy * s->stride_h + ky * s->dilation_h - y0;
+    int x = kx * s->dilation_w;
+    return plane + ((size_t)y * s->stride_w + x % s->stride_w) * g.wq + x / s->stride_w;
+}
+
+/* One output row, accumulated in registers over all taps. The ragged end
+ * of the row is a masked vector, so narrow planes stay vectorized. */
+static inline __attribute__((always_inline)) void
+dw_row(const float* const* src, const float* w, const int taps, float bias, float* out, int ow) {
+#if DW_VW > 1
+    for (int ox = 0; ox < ow; ox += DW_VW) {
+        dwvec acc = DW_SET1(bias);
+        if (ox + DW_VW <= ow) {
+            for (int t = 0; t < taps; t++)
+                acc = DW_FMA(DW_LOADU(src[t] + ox), DW_SET1(w[t]), acc);
+            DW_STOREU(out + ox, acc);
+        } else {
+            dwmask m = DW_TAIL(ow - ox);
+            for (int t = 0; t < taps; t++)
+                acc = DW_FMA(DW_MLOAD(src[t] + ox, m), DW_SET1(w[t]), acc);
+            DW_MSTORE(out + ox, m, acc);
+        }
+    }
+#else
+    for (int ox = 0; ox < ow; ox++) {
+        float acc = bias;
+        for (int t = 0; t < taps; t++)
+            acc += src[t][ox] * w[t];
+        out[ox] = acc;
+    }
+#endif
+}
+
+/* Output rows [oy0, oy1) of one plane from padded rows starting at y0.
+ * taps is a constant at the unrolled call sites. */
+static inline __attribute__((always_inline)) void
+dw_rows(const float* plane, const float* w, const int taps, float bias, float* out,
+        const ConvBlockedShape* s, PlaneGeom g, int y0, int oy0, int oy1) {
+    const float* src[DW_MAX_TAPS];
+    for (int oy = oy0; oy < oy1; oy++) {
+        for (int ky = 0, t = 0; ky < s->kernel_h; ky++)
+            for (int kx = 0; kx < s->kernel_w; kx++, t++)
+                src[t] = tap_row(plane, s, g, y0, oy, ky, kx);
+        dw_row(src, w, taps, bias, out + (size_t)(oy - oy0) * s->out_w, s->out_w);
+    }
+}
+
+static void dw_rows_dispatch(const float* plane, const float* w, float bias, float* out,
+                             const ConvBlockedShape* s, PlaneGeom g, int y0, int oy0, int oy1) {
+    switch (s->kernel_h * s->kernel_w) {
+    case 9:
+        dw_rows(plane, w, 9, bias, out, s, g, y0, oy0, oy1);
+        break;
+    case 25:
+        dw_rows(plane, w, 25, bias, out, s, g, y0, oy0, oy1);
+        break;
+    case 49:
+        dw_rows(plane, w, 49, bias, out, s, g, y0, oy0, oy1);
+        break;
+    default:
+        dw_rows(plane, w, s->kernel_h * s->kernel_w, bias, out, s, g, y0, oy0, oy1);
+        break;
+    }
+}
+
+/* Padded input rows needed for output rows [oy0, oy1) */
+static void band_rows(const ConvBlockedShape* s, int oy0, int oy1, int* y0, int* rows) {
+    *y0   = oy0 * s->stride_h;
+    *rows = (oy1 - 1 - oy0) * s->stride_h + (s->kernel_h - 1) * s->dilation_h + 1;
+}
+
+typedef struct {
+    const float* in;
+    const float* w;
+    const float* bias;
+    float* out;
+    size_t out_stride; /* Floats between consecutive channels of out */
+    const ConvBlockedShape* s;
+    int n;             /* Image, for the band task */
+    int oy0, oy1;      /* Output rows, for the band task */
+    const float* gout;
+    float* gin;
+    float* gw;
+} DepthwiseArgs;
+
+/* One task per (image, channel) plane */
+static void dw_forward_task(void* data, size_t start, size_t end) {
+    const DepthwiseArgs* a    = (const DepthwiseArgs*)data;
+    const ConvBlockedShape* s = a->s;
+    PlaneGeom g               = plane_geom(s);
+    int taps                  = s->kernel_h * s->kernel_w;
+    float* plane = scratch_reserve(&t_plane, (size_t)g.hp * s->stride_w * g.wq);
+    if (!plane)
+        return;
+    for (size_t p = start; p < end; p++) {
+        int c = (int)(p % (size_t)s->in_channels);
+        pad_rows(a->in + p * s->in_h * s->in_w, plane, s, g, 0, g.hp);
+        dw_rows_dispatch(plane, a->w + (size_t)c * taps, a->bias ? a->bias[c] : 0.0f,
+                         a->out + p * s->out_h * s->out_w, s, g, 0, 0, s->out_h);
+    }
+}
+
+int cml_conv2d_depthwise(const float* input, const float* weight, const float* bias,
+                         float* output, const ConvBlockedShape* s) {
+    if (!input || !weight || !output || !s)
+        return -1;
+    DepthwiseArgs args = {.in = input, .w = weight, .bias = bias, .out = output, .s = s};
+    size_t planes      = (size_t)s->batch * s->in_channels;
+    ThreadPool* pool   = threadpool_get_global();
+    if (pool && planes > 1)
+        threadpool_parallel_for(pool, dw_forward_task, &args, planes);
+    else
+        dw_forward_task(&args, 0, planes);
+    return 0;
+}
+
+/* Strided convolutions: adds the gradient of one plane's output into its
+ * padded input, tap by tap */
+static void dw_scatter_rows(float* gplane, const float* gout, const float* w,
+                            const ConvBlockedShape* s, PlaneGeom g) {
+    int ow = s->out_w;
+    for (int oy = 0; oy < s->out_h; oy++) {
+        const float* go = gout + (size_t)oy * ow;
+        for (int ky = 0, t = 0; ky < s->kernel_h; ky++) {
+            for (int kx = 0; kx < s->kernel_w; kx++, t++) {
+                float* dst = (float*)tap_row(gplane, s, g, 0, oy, ky, kx);
+#if DW_VW > 1
+                dwvec wv = DW_SET1(w[t]);
+                for (int ox = 0; ox < ow; ox += DW_VW) {
+                    if (ox + DW_VW <= ow) {
+                        DW_STOREU(dst + ox, DW_FMA(DW_LOADU(go + ox), wv, DW_LOADU(dst + ox)));
+                    } else {
+                        dwmask m = DW_TAIL(ow - ox);
+                        DW_MSTORE(dst + ox, m,
+                                  DW_FMA(DW_MLOAD(go + ox, m), wv, DW_MLOAD(dst + ox, m)));
+                    }
+                }
+#else
+                for (int ox = 0; ox < ow; ox++)
+                    dst[ox] += go[ox] * w[t];
+#endif
+            }
+        }
+    }
+}
+
+static void unpad_add(const float* gplane, float* gin, const ConvBlockedShape* s, PlaneGeom g) {
+    int sw = s->stride_w;
+    for (int iy = 0; iy < s->in_h; iy++) {
+        const float* row = gplane + (size_t)(iy + s->pad_h) * sw * g.wq;
+        float* dst       = gin + (size_t)iy * s->in_w;
+        for (int r = 0; r < sw; r++) {
+            const float* src = row + (size_t)r * g.wq;
+            int j            = r < s->pad_w ? (s->pad_w - r + sw - 1) / sw : 0;
+            for (int ix = j * sw + r - s->pad_w; ix < s->in_w; ix += sw, j++)
+                dst[ix] += src[j];
+        }
+    }
+}
+
+/* With stride 1 the input gradient is itself a depthwise convolution: the
+ * output gradient, padded by (k - 1) * dilation - pad, against the flipped
+ * kernel. Fills *t and returns false when the padding would be negative. */
+static bool transpose_shape(const ConvBlockedShape* s, ConvBlockedShape* t) {
+    *t = *s;
+    t->in_h = s->out_h, t->in_w = s->out_w;
+    t->out_h = s->in_h, t->out_w = s->in_w;
+    t->pad_h = (s->kernel_h - 1) * s->dilation_h - s->pad_h;
+    t->pad_w = (s->kernel_w - 1) * s->dilation_w - s->pad_w;
+    return s->stride_h == 1 && s->stride_w == 1 && t->pad_h >= 0 && t->pad_w >= 0;
+}
+
+/* gw[t] += sum over the plane of gout * tap t's inputs, one register
+ * accumulator per tap */
+static inline __attribute__((always_inline)) void
+dw_wgrad(const float* plane, const float* gout, float* gw, const int taps,
+         const ConvBlockedShape* s, PlaneGeom g) {
+    const float* src[DW_MAX_TAPS];
+    int ow = s->out_w;
+#if DW_VW > 1
+    dwvec acc[DW_MAX_TAPS];
+    for (int t = 0; t < taps; t++)
+        acc[t] = DW_SET1(0.0f);
+#else
+    float acc[DW_MAX_TAPS] = {0};
+#endif
+    for (int oy = 0; oy < s->out_h; oy++) {
+        for (int ky = 0, t = 0; ky < s->kernel_h; ky++)
+            for (int kx = 0; kx < s->kernel_w; kx++, t++)
+                src[t] = tap_row(plane, s, g, 0, oy, ky, kx);
+        const float* go = gout + (size_t)oy * ow;
+#if DW_VW > 1
+        for (int ox = 0; ox < ow; ox += DW_VW) {
+            if (ox + DW_VW <= ow) {
+                dwvec gv = DW_LOADU(go + ox);
+                for (int t = 0; t < taps; t++)
+                    acc[t] = DW_FMA(gv, DW_LOADU(src[t] + ox), acc[t]);
+            } else {
+                dwmask m = DW_TAIL(ow - ox);
+                dwvec gv = DW_MLOAD(go + ox, m);
+                for (int t = 0; t < taps; t++)
+                    acc[t] = DW_FMA(gv, DW_MLOAD(src[t] + ox, m), acc[t]);
+            }
+        }
+#else
+        for (int ox = 0; ox < ow; ox++)
+            for (int t = 0; t < taps; t++)
+                acc[t] += go[ox] * src[t][ox];
+#endif
+    }
+    for (int t = 0; t < taps; t++)
+#if DW_VW > 1
+        gw[t] += DW_HSUM(acc[t]);
+#else
+        gw[t] += acc[t];
+#endif
+}
+
+static void dw_wgrad_dispatch(const float* plane, const float* gout, float* gw,
+                              const ConvBlockedShape* s, PlaneGeom g) {
+    switch (s->kernel_h * s->kernel_w) {
+    case 9:
+        dw_wgrad(plane, gout, gw, 9, s, g);
+        break;
+    case 25:
+        dw_wgrad(plane, gout, gw, 25, s, g);
+        break;
+    case 49:
+        dw_wgrad(plane, gout, gw, 49, s, g);
+        break;
+    default:
+        dw_wgrad(plane, gout, gw, s->kernel_h * s->kernel_w, s, g);
+        break;
+    }
+}
+
+/* One task per channel, looping over the batch, so every write is owned */
+static void dw_backward_task(void* data, size_t start, size_t end) {
+    const DepthwiseArgs* a    = (const DepthwiseArgs*)data;
+    const ConvBlockedShape* s = a->s;
+    PlaneGeom g               = plane_geom(s);
+    int taps                  = s->kernel_h * s->kernel_w;
+    ConvBlockedShape ts;
+    bool transposed = transpose_shape(s, &ts);
+    PlaneGeom tg    = plane_geom(&ts);
+    size_t pfloats  = (size_t)g.hp * s->stride_w * g.wq;
+    size_t gfloats  = transposed ? (size_t)tg.hp * tg.wq : pfloats;
+    size_t in_plane = (size_t)s->in_h * s->in_w;
+    float* plane    = a->gw ? scratch_reserve(&t_plane, pfloats) : NULL;
+    float* gplane   = a->gin ? scratch_reserve(&t_gplane, gfloats) : NULL;
+    float* gtmp     = a->gin && transposed ? scratch_reserve(&t_band, in_plane) : NULL;
+    if ((a->gw && !plane) || (a->gin && !gplane) || (a->gin && transposed && !gtmp))
+        return;
+    for (size_t c = start; c < end; c++) {
+        const float* w = a->w + c * taps;
+        float flipped[DW_MAX_TAPS];
+        for (int t = 0; t < taps; t++)
+            flipped[t] = w[taps - 1 - t];
+        for (int n = 0; n < s->batch; n++) {
+            size_t p        = (size_t)n * s->in_channels + c;
+            const float* go = a->gout + p * s->out_h * s->out_w;
+            if (a->gin && transposed) {
+                float* gin = a->gin + p * in_plane;
+                pad_rows(go, gplane, &ts, tg, 0, tg.hp);
+                dw_rows_dispatch(gplane, flipped, 0.0f, gtmp, &ts, tg, 0, 0, ts.out_h);
+                for (size_t i = 0; i < in_plane; i++)
+                    gin[i] += gtmp[i];
+            } else if (a->gin) {
+                memset(gplane, 0, pfloats * sizeof(float));
+                dw_scatter_rows(gplane, go, w, s, g);
+                unpad_add(gplane, a->gin + p * in_plane, s, g);
+            }
+            if (a->gw) {
+                pad_rows(a->in + p * in_plane, plane, s, g, 0, g.hp);
+                dw_wgrad_dispatch(plane, go, a->gw + c * taps, s, g);
+            }
+        }
+    }
+}
+
+int cml_conv2d_depthwise_backward(const float* input, const float* weight,
+                                  const float* grad_output, float* grad_input,
+                                  float* grad_weight, const ConvBlockedShape* s) {
+    if (!s || !grad_output || (grad_input && !weight) || (grad_weight && !input))
+        return -1;
+    if (!grad_input && !grad_weight)
+        return 0;
+    DepthwiseArgs args = {.in = input, .w = weight, .s = s, .gout = grad_output,
+                          .gin = grad_input, .gw = grad_weight};
+    ThreadPool* pool   = threadpool_get_global();
+    if (pool && s->in_channels > 1)
+        threadpool_parallel_for(pool, dw_backward_task, &args, (size_t)s->in_channels);
+    else
+        dw_backward_task(&args, 0, (size_t)s->in_channels);
+    return 0;
+}
+
+static void add_bias(float* out, const float* bias, int channels, size_t spatial,
+                     size_t stride) {
+    for (int c = 0; c < channels; c++) {
+        float b  = bias[c];
+        float* o = out + (size_t)c * stride;
+        for (size_t i = 0; i < spatial; i++)
+            o[i] += b;
+    }
+}
+
+int cml_conv2d_pointwise(CMLBlasContext* blas, const float* input, const float* weight,
+                         const float* bias, float* output, const ConvBlockedShape* s) {
+    if (!input || !weight || !output || !s)
+        return -1;
+    int hw = s->in_h * s->in_w;
+    for (int n = 0; n < s->batch; n++) {
+        float* out = output + (size_t)n * s->out_channels * hw;
+        if (cml_blas_sgemm(blas, weight, input + (size_t)n * s->in_channels * hw, out,
+                           s->out_channels, hw, s->in_channels, 1.0f, 0.0f) != 0)
+            return -1;
+        if (bias)
+            add_bias(out, bias, s->out_channels, (size_t)hw, (size_t)hw);
+    }
+    return 0;
+}
+
+int cml_conv2d_pointwise_backward(CMLBlasContext* blas, const float* input,
+                                  const float* weight, const float* grad_output,
+                                  float* grad_input, float* grad_weight,
+                                  const ConvBlockedShape* s) {
+    if (!s || !grad_output || (grad_input && !weight) || (grad_weight && !input))
+        return -1;
+    int hw = s->in_h * s->in_w;
+    for (int n = 0; n < s->batch; n++) {
+        const float* go = grad_output + (size_t)n * s->out_channels * hw;
+        /* grad_in[C, HW] += W^T[C, OC] @ go[OC, HW] */
+        if (grad_input &&
+            cml_blas_sgemm_ex(blas, weight, go, grad_input + (size_t)n * s->in_channels * hw,
+                              s->in_channels, hw, s->out_channels, 1.0f, 1.0f, true, false) != 0)
+            return -1;
+        /* grad_w[OC, C] += go[OC, HW] @ in^T[HW, C] */
+        if (grad_weight &&
+            cml_blas_sgemm_ex(blas, go, input + (size_t)n * s->in_channels * hw, grad_weight,
+                              s->out_channels, s->in_channels, hw, 1.0f, 1.0f, false, true) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+/* One task per channel of a band of output rows of image a->n */
+static void dw_band_task(void* data, size_t start, size_t end) {
+    const DepthwiseArgs* a    = (const DepthwiseArgs*)data;
+    const ConvBlockedShape* s = a->s;
+    PlaneGeom g               = plane_geom(s);
+    int taps                  = s->kernel_h * s->kernel_w;
+    int y0, rows;
+    band_rows(s, a->oy0, a->oy1, &y0, &rows);
+    float* plane = scratch_reserve(&t_plane, (size_t)rows * s->stride_w * g.wq);
+    if (!plane)
+        return;
+    for (size_t c = start; c < end; c++) {
+        size_t p = (size_t)a->n * s->in_channels + c;
+        pad_rows(a->in + p * s->in_h * s->in_w, plane, s, g, y0, rows);
+        dw_rows_dispatch(plane, a->w + c * taps, a->bias ? a->bias[c] : 0.0f,
+                         a->out + c * a->out_stride, s, g, y0, a->oy0, a->oy1);
+    }
+}
+
+int cml_conv2d_depthwise_pointwise(CMLBlasContext* blas, const float* input,
+                                   const float* dw_weight, const float* dw_bias,
+                                   float* dw_output, const ConvBlockedShape* dw,
+                                   const float* pw_weight, const float* pw_bias,
+                                   float* pw_output, int pw_channels) {
+    if (!input || !dw_weight || !dw_output || !dw || !pw_weight || !pw_output)
+        return -1;
+    int c = dw->in_channels, ow = dw->out_w, oh = dw->out_h;
+    int band = DW_BAND_FLOATS / (c * ow);
+    if (band < 1)
+        band = 1;
+    if (band > oh)
+        band = oh;
+    float* dw_band = scratch_reserve(&t_band, (size_t)c * band * ow);
+    float* pw_band = scratch_reserve(&t_pwband, (size_t)pw_channels * band * ow);
+    if (!dw_band || !pw_band)
+        return -1;
+
+    ThreadPool* pool = threadpool_get_global();
+    size_t plane_out = (size_t)oh * ow;
+    for (int n = 0; n < dw->batch; n++) {
+        for (int oy0 = 0; oy0 < oh; oy0 += band) {
+            int oy1      = oy0 + band < oh ? oy0 + band : oh;
+            size_t span  = (size_t)(oy1 - oy0) * ow;
+            DepthwiseArgs args = {.in = input, .w = dw_weight, .bias = dw_bias, .out = dw_band,
+                                  .out_stride = span, .s = dw, .n = n, .oy0 = oy0, .oy1 = oy1};
+            if (pool && c > 1)
+                threadpool_parallel_for(pool, dw_band_task, &args, (size_t)c);
+            else
+                dw_band_task(&args, 0, (size_t)c);
+
+            /* The band is still in cache: publish it and run the pointwise GEMM on it */
+            float* dwo = dw_output + (size_t)n * c * plane_out + (size_t)oy0 * ow;
+            for (int ch = 0; ch < c; ch++)
+                memcpy(dwo + (size_t)ch * plane_out, dw_band + (size_t)ch * span,
+                       span * sizeof(float));
+            if (cml_blas_sgemm(blas, pw_weight, dw_band, pw_band, pw_channels, (int)span, c, 1.0f,
+                               0.0f) != 0)
+                return -1;
+            float* pwo = pw_output + (size_t)n * pw_channels * plane_out + (size_t)oy0 * ow;
+            for (int oc = 0; oc < pw_channels; oc++)
+                memcpy(pwo + (size_t)oc * plane_out, pw_band + (size_t)oc * span,
+                       span * sizeof(float));
+            if (pw_bias)
+                add_bias(pwo, pw_bias, pw_channels, span, plane_out);
+        }
+    }
+    return 0;
+}
+
+void cml_conv_separable_cleanup(void) {
+    SepScratch* all[] = {&t_plane, &t_gplane, &t_band, &t_pwband};
+    for (size_t i = 0; i < sizeof(all) / sizeof(all[0]); i++) {
+        free(all[i]->data);
+        *all[i] = (SepScratch){0};
+    }
+}
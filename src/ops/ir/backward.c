@@ -5,10 +5,14 @@
 #include "tensor/tensor.h"
 #include "tensor/realize.h"
 #include "core/logging.h"
+#include "autograd/autograd.h"
 #include "ops/ir/ir.h"
 #include "ops/ir/internal.h"
+#include "ops/ir/execution.h"
+#include "alloc/buffer_cache.h"
 #include "ops/uops.h"
 #include "backend/blas.h"
+#include "ops/conv_separable.h"
 #include "ops/simd_math.h"
 
 #ifdef __SSE__
@@ -784,6 +788,46 @@ static int cpu_backward_node(struct IRNode* node) {
 
         CMLBlasContext* blas = get_blas_context();
 
+        /* Bias grad: sum over batch, height, width */
+        if (node->num_inputs >= 3 && node->inputs[2] && node->inputs[2]->requires_grad) {
+            Tensor* gb = ensure_grad(node->inputs[2]);
+            if (gb && gb->data) {
+                float* gbd = (float*)gb->data;
+                for (int n = 0; n < NB; n++)
+                    for (int co = 0; co < C_out; co++) {
+                        const float* og = out_grad + ((size_t)n * C_out + co) * col_w;
+                        float s = 0.f;
+                        for (int j = 0; j < col_w; j++)
+                            s += og[j];
+                        gbd[co] += s;
+                    }
+            }
+        }
+
+        ConvBlockedShape shape = {
+            .batch = NB, .in_channels = C_in, .in_h = H, .in_w = W,
+            .out_channels = C_out, .out_h = oH, .out_w = oW,
+            .kernel_h = kH, .kernel_w = kW, .stride_h = str_h, .stride_w = str_w,
+            .pad_h = pad_h, .pad_w = pad_w, .dilation_h = dil_h, .dilation_w = dil_w};
+        float* sep_gin = NULL;
+        float* sep_gw  = NULL;
+        if (in1->requires_grad && in2->data) {
+            Tensor* g1 = ensure_grad(in1);
+            sep_gin    = g1 ? (float*)g1->data : NULL;
+        }
+        if (in2->requires_grad && in1->data) {
+            Tensor* g2 = ensure_grad(in2);
+            sep_gw     = g2 ? (float*)g2->data : NULL;
+        }
+        if (cml_conv_depthwise_applicable(&shape, groups) &&
+            cml_conv2d_depthwise_backward(in1->data, in2->data, out_grad, sep_gin, sep_gw,
+                                          &shape) == 0)
+            break;
+        if (blas && blas->initialized && cml_conv_pointwise_applicable(&shape, groups) &&
+            cml_conv2d_pointwise_backward(blas, in1->data, in2->data, out_grad, sep_gin, sep_gw,
+                                          &shape) == 0)
+            break;
+
         if (blas && blas->initialized) {
             float* col_buf = (float*)malloc((size_t)col_h * col_w * sizeof(float));
             if (!col_buf) break;
@@ -2913,6 +2957,125 @@ static int cpu_backward_node(struct IRNode* node) {
     return 0;
 }
 
+typedef struct {
+    Tensor* tensor;
+    int first_use; /* Index of the first node reading the tensor */
+} HookedGrad;
+
+static size_t hooked_slot(const Tensor* t, size_t mask) {
+    uint64_t h = (uint64_t)(uintptr_t)t * 0x9E3779B97F4A7C15ull;
+    return (size_t)(h >> 32) & mask;
+}
+
+/* Inserts t into the open-addressed set; false if it was already there */
+static bool hooked_set_add(const Tensor** set, size_t mask, const Tensor* t) {
+    size_t i = hooked_slot(t, mask);
+    while (set[i]) {
+        if (set[i] == t)
+            return false;
+        i = (i + 1) & mask;
+    }
+    set[i] = t;
+    return true;
+}
+
+static int collect_hooked_grads(struct IRNode** nodes, int node_count, HookedGrad** out,
+                                int* count) {
+    int cap            = 0;
+    size_t set_size    = 0;
+    const Tensor** set = NULL;
+    for (int i = 0; i < node_count; i++) {
+        for (int k = 0; k < nodes[i]->num_inputs; k++) {
+            Tensor* t = nodes[i]->inputs ? nodes[i]->inputs[k] : NULL;
+            if (!t || !tensor_has_backward_hooks(t))
+                continue;
+            /* Keep the set at most half full */
+            if ((size_t)(*count + 1) * 2 > set_size) {
+                size_t size = set_size ? set_size * 2 : 32;
+                const Tensor** grown = calloc(size, sizeof(*grown));
+                if (!grown) {
+                    free(set);
+                    return -1;
+                }
+                for (int j = 0; j < *count; j++)
+                    hooked_set_add(grown, size - 1, (*out)[j].tensor);
+                free(set);
+                set      = grown;
+                set_size = size;
+            }
+            if (!hooked_set_add(set, set_size - 1, t))
+                continue;
+            if (*count == cap) {
+                cap           = cap ? cap * 2 : 16;
+                HookedGrad* h = realloc(*out, (size_t)cap * sizeof(HookedGrad));
+                if (!h) {
+                    free(set);
+                    return -1;
+                }
+                *out = h;
+            }
+            (*out)[(*count)++] = (HookedGrad){t, i};
+        }
+    }
+    free(set);
+    return 0;
+}
+
+static CMLBackwardStats g_backward_stats;
+
+static size_t owned_bytes(const Tensor* t) {
+    return t && t->data && t->owns_data ? t->numel * cml_dtype_size(t->dtype) : 0;
+}
+
+/* Gradient bytes held by the node's inputs (new grads show up as growth) */
+static size_t input_grad_bytes(const struct IRNode* node) {
+    size_t bytes = 0;
+    for (int k = 0; node->inputs && k < node->num_inputs; k++) {
+        bool repeat = false;
+        for (int j = 0; j < k && !repeat; j++)
+            repeat = node->inputs[j] == node->inputs[k];
+        if (node->inputs[k] && !repeat)
+            bytes += owned_bytes(node->inputs[k]->grad);
+    }
+    return bytes;
+}
+
+/* Called once the node has propagated its gradient: every consumer of its
+ * output ran earlier in the reverse sweep and its own rule has now run, so
+ * neither the value nor the gradient is read again. */
+static size_t release_after_backward(struct IRNode* node) {
+    Tensor* out  = node->output;
+    size_t freed = 0;
+    if (!out || out->ir_node != node)
+        return 0;
+
+    if (out->grad) {
+        size_t bytes = owned_bytes(out->grad);
+        tensor_free(out->grad);
+        out->grad = NULL;
+        g_backward_stats.grads_freed++;
+        g_backward_stats.grad_bytes_freed += bytes;
+        freed += bytes;
+    }
+
+    /* Views share their input's storage and elided nodes never had any */
+    if (!node->is_elided && out->owns_data && out->data && !out->buffer_handle &&
+        (out->device == DEVICE_CPU || out->device == DEVICE_AUTO)) {
+        size_t bytes = owned_bytes(out);
+        if (out->from_buffer_cache)
+            cml_buffer_cache_free(out->data, bytes);
+        else
+            free(out->data);
+        out->data              = NULL;
+        out->owns_data         = false;
+        out->from_buffer_cache = false;
+        g_backward_stats.activations_freed++;
+        g_backward_stats.activation_bytes_freed += bytes;
+        freed += bytes;
+    }
+    return freed;
+}
+
 static int cpu_execute_backward(CMLGraph_t ir) {
     if (!ir)
         return -1;
@@ -2944,19 +3107,70 @@ static int cpu_execute_backward(CMLGraph_t ir) {
 
     /* Loss gradient is already set up by cml_ir_execute_backward — no need to redo here */
 
+    /* Tensors with hooks, in order of their first use. Walking backward, a
+     * tensor's gradient is final once that first consumer has run. */
+    HookedGrad* hooked = NULL;
+    int num_hooked     = 0;
+    if (collect_hooked_grads(nodes, node_count, &hooked, &num_hooked) != 0)
+        LOG_WARNING("Backward: failed to track gradient hooks; they will not fire");
+    int next_hook = num_hooked - 1;
+
+    /* Activations and gradients the graph holds, tracked through the sweep.
+     * Outputs whose gradient was seeded by the caller are the roots it reads
+     * back, so eager freeing leaves them alone. */
+    bool seeded_buf[64];
+    bool* seeded = NULL;
+    if (ir->eager_free)
+        seeded = node_count <= 64 ? seeded_buf : malloc((size_t)node_count * sizeof(bool));
+    size_t live = 0;
+    for (int i = 0; i < node_count; i++) {
+        Tensor* out = nodes[i]->output;
+        if (out)
+            live += owned_bytes(out) + owned_bytes(out->grad);
+        if (seeded)
+            seeded[i] = out && out->grad;
+    }
+    size_t peak = live;
+
     for (int i = node_count - 1; i >= 0; i--) {
+        struct IRNode* node = nodes[i];
         /* Backward DCE: skip nodes where no input requires a gradient.
          * cml_ir_build_backward sets requires_grad via a forward scan. */
-        if (!nodes[i]->requires_grad)
-            continue;
-        cpu_backward_node(nodes[i]);
-    }
-
+        bool propagates = node->requires_grad && node->output && node->output->grad &&
+                          node->output->grad->data;
+        size_t before   = propagates ? input_grad_bytes(node) : 0;
+        if (node->requires_grad)
+            cpu_backward_node(node);
+        if (propagates) {
+            live += input_grad_bytes(node) - before;
+            peak = live > peak ? live : peak;
+        }
+        for (; next_hook >= 0 && hooked[next_hook].first_use == i; next_hook--)
+            tensor_run_backward_hooks(hooked[next_hook].tensor);
+        if (seeded && propagates && !seeded[i])
+            live -= release_after_backward(node);
+    }
+    if (seeded != seeded_buf)
+        free(seeded);
+
+    g_backward_stats.passes++;
+    if (peak > g_backward_stats.peak_bytes)
+        g_backward_stats.peak_bytes = peak;
+    g_backward_stats.last_peak_bytes = peak;
+
+    free(hooked);
     if (nodes != stack_buf)
         free(nodes);
     return 0;
 }
 
+void cml_get_backward_stats(CMLBackwardStats* stats) {
+    if (stats)
+        *stats = g_backward_stats;
+}
+
+void cml_reset_backward_stats(void) { memset(&g_backward_stats, 0, sizeof(g_backward_stats)); }
+
 int cml_ir_execute_backward(CMLGraph_t ir) {
     if (!ir) {
         LOG_ERROR("NULL IR passed to cml_ir_execute_backward");
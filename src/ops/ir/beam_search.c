@@ -1,12 +1,20 @@
 #include "ops/ir/beam_search.h"
 #include "ops/ir/opt_transforms.h"
-#include "ops/ir/linearize.h"
+#include "ops/ir/fused_codegen.h"
+#include "ops/ir/runtime_compiler.h"
+#include "backend/threadpool.h"
 #include "core/logging.h"
 
+#include <dlfcn.h>
+#include <errno.h>
 #include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
 
 static const int BLOCK_SIZES[]   = {32, 64, 128, 256, 512, 1024};
 static const int UNROLL_FACTORS[] = {1, 2, 4};
@@ -16,6 +24,67 @@ static const int VEC_WIDTHS[]    = {1, 2, 4};
 #define NUM_UNROLL_FACTORS (int)(sizeof(UNROLL_FACTORS) / sizeof(UNROLL_FACTORS[0]))
 #define NUM_VEC_WIDTHS    (int)(sizeof(VEC_WIDTHS)    / sizeof(VEC_WIDTHS[0]))
 
+/* CPU search space: code variants are compiled, launch shapes are not */
+static const int CPU_VEC_WIDTHS[]  = {1, 4, 8, 16};
+static const int CPU_UNROLLS[]     = {1, 2, 4};
+static const size_t CPU_TILES[]    = {1024, 4096, 16384, 65536};
+
+#define NUM_CPU_VEC_WIDTHS (int)(sizeof(CPU_VEC_WIDTHS) / sizeof(CPU_VEC_WIDTHS[0]))
+#define NUM_CPU_UNROLLS    (int)(sizeof(CPU_UNROLLS)    / sizeof(CPU_UNROLLS[0]))
+#define NUM_CPU_TILES      (int)(sizeof(CPU_TILES)      / sizeof(CPU_TILES[0]))
+#define NUM_CPU_VARIANTS   (NUM_CPU_VEC_WIDTHS * NUM_CPU_UNROLLS)
+#define CPU_MAX_TIMING_RUNS 64
+
+#define BEAM_CACHE_MAGIC 0x424D4332 /* "BMC2": entries carry a CPU id */
+
+static char g_cpu_model[192];
+static uint64_t g_cpu_id;
+static pthread_once_t g_cpu_once = PTHREAD_ONCE_INIT;
+
+static void detect_cpu(void) {
+    char model[128] = "unknown";
+    FILE* f = fopen("/proc/cpuinfo", "r");
+    if (f) {
+        /* x86 reports "model name"; arm64 only has implementer/part ids */
+        char line[256], part[64] = "";
+        while (fgets(line, sizeof(line), f)) {
+            char* colon = strchr(line, ':');
+            if (!colon) continue;
+            char* val = colon + 1;
+            while (*val == ' ' || *val == '\t') val++;
+            val[strcspn(val, "\n")] = '\0';
+            if (strncmp(line, "model name", 10) == 0) {
+                snprintf(model, sizeof(model), "%s", val);
+                break;
+            }
+            if (strncmp(line, "CPU part", 8) == 0 && !part[0])
+                snprintf(part, sizeof(part), "part %s", val);
+        }
+        fclose(f);
+        if (strcmp(model, "unknown") == 0 && part[0])
+            snprintf(model, sizeof(model), "%s", part);
+    }
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    snprintf(g_cpu_model, sizeof(g_cpu_model), "%s, %ld cpus", model, ncpu);
+
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (const char* p = g_cpu_model; *p; p++) {
+        h ^= (uint8_t)*p;
+        h *= 0x100000001b3ULL;
+    }
+    g_cpu_id = h;
+}
+
+const char* cml_beam_cpu_model(void) {
+    pthread_once(&g_cpu_once, detect_cpu);
+    return g_cpu_model;
+}
+
+uint64_t cml_beam_cpu_id(void) {
+    pthread_once(&g_cpu_once, detect_cpu);
+    return g_cpu_id;
+}
+
 /**
  * Map a kernel hash to a cache slot index (simple modular hash).
  */
@@ -71,7 +140,8 @@ int cml_beam_search_lookup(CMLBeamSearchCtx* ctx, uint64_t kernel_hash,
                            CMLBeamConfig* best_out) {
     if (!ctx || !best_out) return -1;
 
-    int slot = cache_slot(kernel_hash);
+    uint64_t cpu_id = cml_beam_cpu_id();
+    int slot = cache_slot(kernel_hash ^ cpu_id);
 
     /*
      * Linear probe starting from the hashed slot.  The cache is small (256
@@ -83,7 +153,7 @@ int cml_beam_search_lookup(CMLBeamSearchCtx* ctx, uint64_t kernel_hash,
             /* Empty slot -- not found. */
             return -1;
         }
-        if (ctx->cache[idx].hash == kernel_hash) {
+        if (ctx->cache[idx].hash == kernel_hash && ctx->cache[idx].cpu_id == cpu_id) {
             *best_out = ctx->cache[idx].config;
             LOG_DEBUG("BEAM cache hit for hash 0x%016llx (slot %d, time=%.2f us)",
                       (unsigned long long)kernel_hash, idx,
@@ -95,11 +165,9 @@ int cml_beam_search_lookup(CMLBeamSearchCtx* ctx, uint64_t kernel_hash,
     return -1; /* Cache full and key not found. */
 }
 
-int cml_beam_search_store(CMLBeamSearchCtx* ctx, uint64_t kernel_hash,
-                          const CMLBeamConfig* config, double time_us) {
-    if (!ctx || !config) return -1;
-
-    int slot = cache_slot(kernel_hash);
+static int cache_store(CMLBeamSearchCtx* ctx, uint64_t kernel_hash, uint64_t cpu_id,
+                       const CMLBeamConfig* config, double time_us) {
+    int slot = cache_slot(kernel_hash ^ cpu_id);
 
     /*
      * Linear probe: find an empty slot or the existing entry with the same
@@ -111,6 +179,7 @@ int cml_beam_search_store(CMLBeamSearchCtx* ctx, uint64_t kernel_hash,
         if (!ctx->cache[idx].occupied) {
             /* Empty slot -- insert. */
             ctx->cache[idx].hash     = kernel_hash;
+            ctx->cache[idx].cpu_id   = cpu_id;
             ctx->cache[idx].config   = *config;
             ctx->cache[idx].time_us  = time_us;
             ctx->cache[idx].occupied = true;
@@ -122,7 +191,7 @@ int cml_beam_search_store(CMLBeamSearchCtx* ctx, uint64_t kernel_hash,
             return 0;
         }
 
-        if (ctx->cache[idx].hash == kernel_hash) {
+        if (ctx->cache[idx].hash == kernel_hash && ctx->cache[idx].cpu_id == cpu_id) {
             /* Existing entry -- update if the new time is better. */
             if (time_us < ctx->cache[idx].time_us) {
                 ctx->cache[idx].config  = *config;
@@ -140,6 +209,12 @@ int cml_beam_search_store(CMLBeamSearchCtx* ctx, uint64_t kernel_hash,
     return -1;
 }
 
+int cml_beam_search_store(CMLBeamSearchCtx* ctx, uint64_t kernel_hash,
+                          const CMLBeamConfig* config, double time_us) {
+    if (!ctx || !config) return -1;
+    return cache_store(ctx, kernel_hash, cml_beam_cpu_id(), config, time_us);
+}
+
 /**
  * Compute a heuristic score for a candidate configuration.
  *
@@ -174,23 +249,6 @@ static double heuristic_score(const CMLBeamConfig* cfg, size_t total_elements) {
     return norm_dist + 0.5 * overshoot_penalty;
 }
 
-/**
- * Estimate execution time for a candidate on the CPU.
- *
- * Since there is no actual GPU to time, we use a simple throughput model:
- *   time ~ total_elements / (block_size * vec_width * unroll_factor)
- *
- * The result is in arbitrary units -- only the *relative* ordering matters.
- */
-static double estimate_time_cpu(const CMLBeamConfig* cfg,
-                                size_t total_elements) {
-    double throughput = (double)cfg->block_size_x *
-                        (double)cfg->vec_width *
-                        (double)cfg->unroll_factor;
-    if (throughput < 1.0) throughput = 1.0;
-    return (double)total_elements / throughput;
-}
-
 /**
  * Sort helper -- used to rank candidates by their heuristic score.
  * We stash the score in time_us temporarily during candidate generation.
@@ -203,6 +261,199 @@ static int cmp_beam_result(const void* a, const void* b) {
     return 0;
 }
 
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec * 1e-3;
+}
+
+static int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* Median wall time of one launch, after warmup launches */
+static double time_cpu_launch(CMLBeamSearchCtx* ctx, void* fn, float* const* bufs, size_t n,
+                              const CMLNativeLaunch* launch) {
+    int runs = ctx->timing_runs;
+    if (runs < 1) runs = 1;
+    if (runs > CPU_MAX_TIMING_RUNS) runs = CPU_MAX_TIMING_RUNS;
+
+    for (int w = 0; w < ctx->warmup_runs; w++)
+        cml_runtime_launch_native_fn(fn, bufs, n, launch);
+
+    double times[CPU_MAX_TIMING_RUNS];
+    for (int r = 0; r < runs; r++) {
+        double t0 = now_us();
+        cml_runtime_launch_native_fn(fn, bufs, n, launch);
+        times[r] = now_us() - t0;
+    }
+    qsort(times, (size_t)runs, sizeof(double), cmp_double);
+    return times[runs / 2];
+}
+
+typedef struct {
+    void* fn;
+    int vec_width;
+    int unroll;
+    double time_us;
+} CPUVariant;
+
+static int cmp_cpu_variant(const void* a, const void* b) {
+    return cmp_double(&((const CPUVariant*)a)->time_us, &((const CPUVariant*)b)->time_us);
+}
+
+int cml_beam_search_tune_cpu(CMLBeamSearchCtx* ctx, uint64_t kernel_hash,
+                             const struct CMLLinearProgram* prog, size_t n,
+                             CMLBeamConfig* best_out) {
+    if (!ctx || !prog || !best_out || n == 0) return -1;
+
+    if (cml_beam_search_lookup(ctx, kernel_hash, best_out) == 0)
+        return 0;
+
+    /* Every code variant goes into one shared object: one compiler run */
+    size_t src_cap = (size_t)NUM_CPU_VARIANTS * 16384;
+    char* source   = malloc(src_cap);
+    if (!source) return -1;
+    size_t src_len = 0;
+    CPUVariant variants[NUM_CPU_VARIANTS];
+    int num_variants = 0;
+    for (int vi = 0; vi < NUM_CPU_VEC_WIDTHS; vi++) {
+        for (int ui = 0; ui < NUM_CPU_UNROLLS; ui++) {
+            char name[32];
+            snprintf(name, sizeof(name), "beam_v%d_u%d", CPU_VEC_WIDTHS[vi], CPU_UNROLLS[ui]);
+            char* fn_src = cml_fused_codegen_c_variant(prog, name, CPU_VEC_WIDTHS[vi],
+                                                       CPU_UNROLLS[ui]);
+            size_t len = fn_src ? strlen(fn_src) : 0;
+            if (fn_src && src_len + len < src_cap) {
+                memcpy(source + src_len, fn_src, len + 1);
+                src_len += len;
+                variants[num_variants].vec_width = CPU_VEC_WIDTHS[vi];
+                variants[num_variants].unroll    = CPU_UNROLLS[ui];
+                num_variants++;
+            }
+            free(fn_src);
+        }
+    }
+
+    double t0     = now_us();
+    void* handle  = num_variants > 0 ? cml_runtime_build_native(source) : NULL;
+    double build  = now_us() - t0;
+    free(source);
+    if (!handle) {
+        LOG_WARNING("BEAM cpu tune: could not build candidates for hash 0x%016llx",
+                    (unsigned long long)kernel_hash);
+        return -1;
+    }
+
+    /* Real buffers: loads get finite positive data so log/sqrt stay cheap */
+    int num_bufs = 0;
+    for (int i = 0; i < prog->num_ops; i++) {
+        if (prog->ops[i].kind != LINOP_COMPUTE) num_bufs++;
+    }
+    float** bufs = calloc((size_t)(num_bufs > 0 ? num_bufs : 1), sizeof(float*));
+    int rc       = bufs ? 0 : -1;
+    for (int i = 0, b = 0; i < prog->num_ops && rc == 0; i++) {
+        if (prog->ops[i].kind == LINOP_COMPUTE) continue;
+        bufs[b] = malloc(n * sizeof(float));
+        if (!bufs[b]) {
+            rc = -1;
+            break;
+        }
+        for (size_t j = 0; j < n; j++)
+            bufs[b][j] = 0.5f + (float)(j % 97) / 97.0f;
+        b++;
+    }
+
+    CMLBeamConfig best;
+    memset(&best, 0, sizeof(best));
+    double best_time = 1e18;
+
+    if (rc == 0) {
+        /* Stage 1: every code variant under the default launch */
+        int live = 0;
+        for (int v = 0; v < num_variants; v++) {
+            char name[32];
+            snprintf(name, sizeof(name), "beam_v%d_u%d", variants[v].vec_width,
+                     variants[v].unroll);
+            void* fn = dlsym(handle, name);
+            if (!fn) continue;
+            variants[live]         = variants[v];
+            variants[live].fn      = fn;
+            variants[live].time_us = time_cpu_launch(ctx, fn, bufs, n, NULL);
+            live++;
+        }
+        qsort(variants, (size_t)live, sizeof(CPUVariant), cmp_cpu_variant);
+
+        int keep = ctx->beam_width;
+        if (keep > live) keep = live;
+
+        /* Stage 2: launch shapes for the survivors */
+        size_t pool = threadpool_get_num_threads(threadpool_get_global());
+        int threads[3] = {1, (int)(pool / 2), (int)pool};
+        ctx->num_candidates = 0;
+
+        for (int v = 0; v < keep; v++) {
+            for (int ti = 0; ti < NUM_CPU_TILES; ti++) {
+                /* A tile at least n long is one call; the first covers it */
+                if (ti > 0 && CPU_TILES[ti - 1] >= n) break;
+                for (int th = 0; th < 3; th++) {
+                    if (threads[th] < 1 || (th > 0 && threads[th] == threads[th - 1])) continue;
+                    for (int order = 0; order < 2; order++) {
+                        if (order == 1 && threads[th] == 1) continue;
+                        CMLNativeLaunch launch = {CPU_TILES[ti], threads[th], order == 1};
+                        double t = time_cpu_launch(ctx, variants[v].fn, bufs, n, &launch);
+
+                        CMLBeamConfig cfg;
+                        memset(&cfg, 0, sizeof(cfg));
+                        cfg.block_size_x  = (int)CPU_TILES[ti];
+                        cfg.block_size_y  = 1;
+                        cfg.block_size_z  = 1;
+                        cfg.unroll_factor = variants[v].unroll;
+                        cfg.vec_width     = variants[v].vec_width;
+                        cfg.loop_order    = order;
+                        cfg.num_threads   = threads[th];
+                        cfg.block[0]      = CPU_TILES[ti];
+                        cfg.block[1]      = 1;
+                        cfg.block[2]      = 1;
+                        cfg.grid[0]       = (n + CPU_TILES[ti] - 1) / CPU_TILES[ti];
+                        cfg.grid[1]       = 1;
+                        cfg.grid[2]       = 1;
+
+                        if (ctx->num_candidates < CML_BEAM_MAX_CANDIDATES) {
+                            CMLBeamResult* r = &ctx->candidates[ctx->num_candidates++];
+                            r->config  = cfg;
+                            r->time_us = t;
+                            r->valid   = true;
+                        }
+                        if (t < best_time) {
+                            best_time = t;
+                            best      = cfg;
+                        }
+                    }
+                }
+            }
+        }
+        if (best_time >= 1e18) rc = -1;
+    }
+
+    for (int b = 0; bufs && b < num_bufs; b++)
+        free(bufs[b]);
+    free(bufs);
+    dlclose(handle);
+
+    if (rc != 0) return -1;
+
+    *best_out = best;
+    cache_store(ctx, kernel_hash, cml_beam_cpu_id(), &best, best_time);
+    LOG_INFO("BEAM cpu tune: hash 0x%016llx on %s: vec=%d unroll=%d tile=%d threads=%d "
+             "%s (%.2f us, build %.0f ms)",
+             (unsigned long long)kernel_hash, cml_beam_cpu_model(), best.vec_width,
+             best.unroll_factor, best.block_size_x, best.num_threads,
+             best.loop_order ? "interleaved" : "contiguous", best_time, build / 1e3);
+    return 0;
+}
+
 int cml_beam_search_tune(CMLBeamSearchCtx* ctx, uint64_t kernel_hash,
                          size_t total_elements, int ndim, const int* shape,
                          CMLBeamConfig* best_out) {
@@ -224,7 +475,8 @@ int cml_beam_search_tune(CMLBeamSearchCtx* ctx, uint64_t kernel_hash,
     LOG_INFO("BEAM tune: searching for hash 0x%016llx (total_elements=%zu)",
              (unsigned long long)kernel_hash, total_elements);
 
-    /* 2. Generate all candidate configurations. */
+    /* 2. No program to time: rank by heuristic. The pick says nothing
+     * measured about this kernel, so it is not cached. */
     CMLBeamResult all_candidates[CML_BEAM_MAX_CANDIDATES];
     int num_all = 0;
 
@@ -241,7 +493,6 @@ int cml_beam_search_tune(CMLBeamSearchCtx* ctx, uint64_t kernel_hash,
                 r->config.vec_width     = VEC_WIDTHS[vi];
                 r->config.shared_mem    = 0;
 
-                /* Derive grid from total_elements and block_size. */
                 size_t threads = (size_t)r->config.block_size_x;
                 r->config.block[0] = threads;
                 r->config.block[1] = 1;
@@ -251,65 +502,25 @@ int cml_beam_search_tune(CMLBeamSearchCtx* ctx, uint64_t kernel_hash,
                 r->config.grid[2]  = 1;
 
                 r->valid   = true;
-                /* Use heuristic score as an initial "time" for sorting. */
                 r->time_us = heuristic_score(&r->config, total_elements);
                 num_all++;
             }
         }
     }
 
-    if (num_all == 0) {
-        LOG_ERROR("BEAM tune: no candidates generated");
-        return -1;
-    }
-
-    /* 3. Quick filter: sort by heuristic score and keep top beam_width. */
     qsort(all_candidates, (size_t)num_all, sizeof(CMLBeamResult),
           cmp_beam_result);
 
     int keep = ctx->beam_width;
     if (keep > num_all) keep = num_all;
-    if (keep > CML_BEAM_MAX_CANDIDATES) keep = CML_BEAM_MAX_CANDIDATES;
-
-    LOG_DEBUG("BEAM tune: generated %d candidates, keeping top %d",
-              num_all, keep);
-
-    /* Copy the survivors into the context's candidate array. */
-    memcpy(ctx->candidates, all_candidates,
-           (size_t)keep * sizeof(CMLBeamResult));
+    memcpy(ctx->candidates, all_candidates, (size_t)keep * sizeof(CMLBeamResult));
     ctx->num_candidates = keep;
 
-    /* 4. Estimate execution time for each surviving candidate (CPU model). */
-    for (int i = 0; i < keep; i++) {
-        ctx->candidates[i].time_us =
-            estimate_time_cpu(&ctx->candidates[i].config, total_elements);
-        LOG_DEBUG("  candidate %d: block=%d unroll=%d vec=%d -> est %.2f us",
-                  i, ctx->candidates[i].config.block_size_x,
-                  ctx->candidates[i].config.unroll_factor,
-                  ctx->candidates[i].config.vec_width,
-                  ctx->candidates[i].time_us);
-    }
-
-    /* 5. Pick the best (lowest estimated time). */
-    int best_idx = 0;
-    for (int i = 1; i < keep; i++) {
-        if (ctx->candidates[i].time_us < ctx->candidates[best_idx].time_us) {
-            best_idx = i;
-        }
-    }
+    *best_out = all_candidates[0].config;
+    LOG_INFO("BEAM tune: heuristic config for hash 0x%016llx: block=%d unroll=%d vec=%d",
+             (unsigned long long)kernel_hash, best_out->block_size_x,
+             best_out->unroll_factor, best_out->vec_width);
 
-    *best_out = ctx->candidates[best_idx].config;
-
-    LOG_INFO("BEAM tune: best config for hash 0x%016llx: "
-             "block=%d unroll=%d vec=%d (est %.2f us)",
-             (unsigned long long)kernel_hash,
-             best_out->block_size_x, best_out->unroll_factor,
-             best_out->vec_width,
-             ctx->candidates[best_idx].time_us);
-
-    /* 6. Store in cache. */
-    cml_beam_search_store(ctx, kernel_hash, best_out,
-                          ctx->candidates[best_idx].time_us);
     return 0;
 }
 
@@ -410,10 +621,37 @@ int cml_beam_search_tune_hw(CMLBeamSearchCtx* ctx, uint64_t kernel_hash,
     return 0;
 }
 
+int cml_beam_cache_default_path(char* out, size_t size)
+{
+    if (!out || size == 0) return -1;
+    const char* dir = getenv("CML_CACHE_DIR");
+    int len;
+    if (dir && dir[0]) {
+        len = snprintf(out, size, "%s/beam.cache", dir);
+    } else {
+        const char* home = getenv("HOME");
+        len = snprintf(out, size, "%s/.cache/cml/beam.cache", home ? home : "/tmp");
+    }
+    return (len > 0 && (size_t)len < size) ? 0 : -1;
+}
+
+static void mkdir_parents(const char* path)
+{
+    char tmp[1024];
+    if (snprintf(tmp, sizeof(tmp), "%s", path) >= (int)sizeof(tmp)) return;
+    for (char* p = tmp + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(tmp, 0755) != 0 && errno != EEXIST) return;
+        *p = '/';
+    }
+}
+
 int cml_beam_cache_save(CMLBeamSearchCtx* ctx, const char* path)
 {
     if (!ctx || !path) return -1;
 
+    mkdir_parents(path);
     FILE* fp = fopen(path, "wb");
     if (!fp) {
         LOG_ERROR("BEAM cache save: cannot open %s", path);
@@ -421,7 +659,7 @@ int cml_beam_cache_save(CMLBeamSearchCtx* ctx, const char* path)
     }
 
     /* Write header: magic + count */
-    uint32_t magic = 0x424D4348; /* "BMCH" */
+    uint32_t magic = BEAM_CACHE_MAGIC;
     fwrite(&magic, sizeof(magic), 1, fp);
     fwrite(&ctx->cache_count, sizeof(ctx->cache_count), 1, fp);
 
@@ -429,6 +667,7 @@ int cml_beam_cache_save(CMLBeamSearchCtx* ctx, const char* path)
     for (int i = 0; i < 256; i++) {
         if (!ctx->cache[i].occupied) continue;
         fwrite(&ctx->cache[i].hash, sizeof(uint64_t), 1, fp);
+        fwrite(&ctx->cache[i].cpu_id, sizeof(uint64_t), 1, fp);
         fwrite(&ctx->cache[i].config, sizeof(CMLBeamConfig), 1, fp);
         fwrite(&ctx->cache[i].time_us, sizeof(double), 1, fp);
     }
@@ -449,8 +688,8 @@ int cml_beam_cache_load(CMLBeamSearchCtx* ctx, const char* path)
     }
 
     uint32_t magic = 0;
-    if (fread(&magic, sizeof(magic), 1, fp) != 1 || magic != 0x424D4348) {
-        LOG_ERROR("BEAM cache load: invalid magic in %s", path);
+    if (fread(&magic, sizeof(magic), 1, fp) != 1 || magic != BEAM_CACHE_MAGIC) {
+        LOG_WARNING("BEAM cache load: invalid or outdated format in %s", path);
         fclose(fp);
         return -1;
     }
@@ -463,15 +702,16 @@ int cml_beam_cache_load(CMLBeamSearchCtx* ctx, const char* path)
 
     int loaded = 0;
     for (int i = 0; i < count; i++) {
-        uint64_t hash;
+        uint64_t hash, cpu_id;
         CMLBeamConfig config;
         double time_us;
 
         if (fread(&hash, sizeof(hash), 1, fp) != 1) break;
+        if (fread(&cpu_id, sizeof(cpu_id), 1, fp) != 1) break;
         if (fread(&config, sizeof(config), 1, fp) != 1) break;
         if (fread(&time_us, sizeof(time_us), 1, fp) != 1) break;
 
-        if (cml_beam_search_store(ctx, hash, &config, time_us) == 0) {
+        if (cache_store(ctx, hash, cpu_id, &config, time_us) == 0) {
             loaded++;
         }
     }
@@ -14,8 +14,11 @@
 #include "ops/simd_utils.h"
 #include "ops/simd_math.h"
 #include "ops/winograd.h"
+#include "ops/conv_blocked.h"
+#include "ops/conv_separable.h"
 #include "ops/ir/dispatch.h"
 #include "ops/ir/cpu_lazy_materialize.h"
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -44,179 +47,6 @@ CMLLLVMBackend* cml_get_llvm_backend(void) {
 }
 #endif
 
-#define BUFFER_CACHE_MIN_BUCKET 6  // 64 bytes (2^6)
-#define BUFFER_CACHE_MAX_BUCKET 26 // 64 MB (2^26)
-#define BUFFER_CACHE_NUM_BUCKETS (BUFFER_CACHE_MAX_BUCKET - BUFFER_CACHE_MIN_BUCKET + 1)
-#define BUFFER_CACHE_MAX_PER_BUCKET 8 // Max cached buffers per size bucket
-
-typedef struct CachedBuffer {
-    void* data;
-    struct CachedBuffer* next;
-} CachedBuffer;
-
-typedef struct {
-    CachedBuffer* free_list; // Linked list of free buffers
-    int count;               // Number of buffers in list
-    size_t bucket_size;      // Size of buffers in this bucket
-} BufferBucket;
-
-typedef struct {
-    BufferBucket buckets[BUFFER_CACHE_NUM_BUCKETS];
-    size_t cache_hits;
-    size_t cache_misses;
-    size_t bytes_cached;
-    size_t bytes_allocated;
-    bool initialized;
-} BufferCache;
-
-static BufferCache g_buffer_cache = {0};
-
-static int get_bucket_index(size_t size) {
-    if (size == 0)
-        return -1;
-
-    int bucket = 0;
-    size_t s   = size - 1;
-    while (s > 0) {
-        s >>= 1;
-        bucket++;
-    }
-
-    if (bucket < BUFFER_CACHE_MIN_BUCKET)
-        bucket = BUFFER_CACHE_MIN_BUCKET;
-    if (bucket > BUFFER_CACHE_MAX_BUCKET)
-        return -1; // Too large
-
-    return bucket - BUFFER_CACHE_MIN_BUCKET;
-}
-
-static void init_buffer_cache(void) {
-    if (g_buffer_cache.initialized)
-        return;
-
-    for (int i = 0; i < BUFFER_CACHE_NUM_BUCKETS; i++) {
-        g_buffer_cache.buckets[i].free_list   = NULL;
-        g_buffer_cache.buckets[i].count       = 0;
-        g_buffer_cache.buckets[i].bucket_size = (size_t)1 << (i + BUFFER_CACHE_MIN_BUCKET);
-    }
-    g_buffer_cache.initialized = true;
-}
-
-void* cml_buffer_cache_alloc(size_t size) {
-    if (size == 0)
-        return NULL;
-
-    init_buffer_cache();
-
-    int bucket_idx = get_bucket_index(size);
-    if (bucket_idx < 0) {
-        g_buffer_cache.cache_misses++;
-        g_buffer_cache.bytes_allocated += size;
-        return malloc(size);
-    }
-
-    BufferBucket* bucket = &g_buffer_cache.buckets[bucket_idx];
-
-    if (bucket->free_list) {
-        CachedBuffer* cached = bucket->free_list;
-        bucket->free_list    = cached->next;
-        bucket->count--;
-
-        void* data = cached->data;
-        free(cached);
-
-        g_buffer_cache.cache_hits++;
-        g_buffer_cache.bytes_cached -= bucket->bucket_size;
-
-        /* Don't zero — callers that need zeroing (e.g. reduce ops) do it themselves.
-         * Most ops (matmul, add, relu, conv) write every output element. */
-        return data;
-    }
-
-    g_buffer_cache.cache_misses++;
-    g_buffer_cache.bytes_allocated += bucket->bucket_size;
-    return malloc(bucket->bucket_size);
-}
-
-void cml_buffer_cache_free(void* ptr, size_t size) {
-    if (!ptr)
-        return;
-
-    init_buffer_cache();
-
-    int bucket_idx = get_bucket_index(size);
-    if (bucket_idx < 0) {
-        free(ptr);
-        return;
-    }
-
-    BufferBucket* bucket = &g_buffer_cache.buckets[bucket_idx];
-
-    if (bucket->count >= BUFFER_CACHE_MAX_PER_BUCKET) {
-        free(ptr);
-        return;
-    }
-
-    CachedBuffer* cached = (CachedBuffer*)malloc(sizeof(CachedBuffer));
-    if (!cached) {
-        free(ptr);
-        return;
-    }
-
-    cached->data      = ptr;
-    cached->next      = bucket->free_list;
-    bucket->free_list = cached;
-    bucket->count++;
-    g_buffer_cache.bytes_cached += bucket->bucket_size;
-}
-
-void cml_cleanup_buffer_cache(void) {
-    if (!g_buffer_cache.initialized)
-        return;
-
-    for (int i = 0; i < BUFFER_CACHE_NUM_BUCKETS; i++) {
-        BufferBucket* bucket  = &g_buffer_cache.buckets[i];
-        CachedBuffer* current = bucket->free_list;
-        while (current) {
-            CachedBuffer* next = current->next;
-            free(current->data);
-            free(current);
-            current = next;
-        }
-        bucket->free_list = NULL;
-        bucket->count     = 0;
-    }
-
-    g_buffer_cache.bytes_cached = 0;
-    g_buffer_cache.initialized  = false;
-}
-
-void cml_print_buffer_cache_stats(void) {
-    printf("Buffer Cache Stats:\n");
-    if (!g_buffer_cache.initialized) {
-        printf("  (Not initialized)\n");
-        return;
-    }
-
-    size_t total_cached = 0;
-    int total_buffers   = 0;
-    for (int i = 0; i < BUFFER_CACHE_NUM_BUCKETS; i++) {
-        if (g_buffer_cache.buckets[i].count > 0) {
-            total_buffers += g_buffer_cache.buckets[i].count;
-            total_cached += g_buffer_cache.buckets[i].count * g_buffer_cache.buckets[i].bucket_size;
-        }
-    }
-
-    size_t total_requests = g_buffer_cache.cache_hits + g_buffer_cache.cache_misses;
-    float hit_rate = total_requests > 0 ? (100.0f * g_buffer_cache.cache_hits / total_requests) : 0;
-
-    printf("  Cache hits:    %zu\n", g_buffer_cache.cache_hits);
-    printf("  Cache misses:  %zu\n", g_buffer_cache.cache_misses);
-    printf("  Hit rate:      %.1f%%\n", hit_rate);
-    printf("  Cached now:    %d buffers (%.2f KB)\n", total_buffers, total_cached / 1024.0f);
-    printf("  Total alloc:   %.2f KB\n", g_buffer_cache.bytes_allocated / 1024.0f);
-}
-
 CMLBlasContext* get_blas_context(void) {
     if (!g_exec_blas_ctx) {
         g_exec_blas_ctx = cml_blas_init();
@@ -227,265 +57,6 @@ CMLBlasContext* get_blas_context(void) {
     return g_exec_blas_ctx;
 }
 
-/* Winograd F(2,3) hardcoded transforms — adds/subs only, no multiply.
- * Input transform: V = B^T * d * B for a 4x4 tile
- * B^T = [1,0,-1,0; 0,1,1,0; 0,-1,1,0; 0,1,0,-1] */
-#ifdef __SSE__
-static inline void wino_f23_input_transform(const float d[16], float V[16]) {
-    /* SSE: process all 4 columns simultaneously.
-     * Step 1: B^T * d (column-wise, 4 columns in parallel) */
-    __m128 d0 = _mm_loadu_ps(&d[0]);  /* row 0 */
-    __m128 d1 = _mm_loadu_ps(&d[4]);  /* row 1 */
-    __m128 d2 = _mm_loadu_ps(&d[8]);  /* row 2 */
-    __m128 d3 = _mm_loadu_ps(&d[12]); /* row 3 */
-
-    __m128 t0 = _mm_sub_ps(d0, d2); /* d0 - d2 */
-    __m128 t1 = _mm_add_ps(d1, d2); /* d1 + d2 */
-    __m128 t2 = _mm_sub_ps(d2, d1); /* -d1 + d2 */
-    __m128 t3 = _mm_sub_ps(d1, d3); /* d1 - d3 */
-
-    /* Step 2: Transpose to get columns as rows, apply B again, transpose back.
-     * _MM_TRANSPOSE4_PS does in-place 4x4 transpose. */
-    _MM_TRANSPOSE4_PS(t0, t1, t2, t3);
-
-    __m128 v0 = _mm_sub_ps(t0, t2); /* t[col0] - t[col2] */
-    __m128 v1 = _mm_add_ps(t1, t2); /* t[col1] + t[col2] */
-    __m128 v2 = _mm_sub_ps(t2, t1); /* -t[col1] + t[col2] */
-    __m128 v3 = _mm_sub_ps(t1, t3); /* t[col1] - t[col3] */
-
-    /* Transpose back to row-major layout */
-    _MM_TRANSPOSE4_PS(v0, v1, v2, v3);
-
-    _mm_storeu_ps(&V[0], v0);
-    _mm_storeu_ps(&V[4], v1);
-    _mm_storeu_ps(&V[8], v2);
-    _mm_storeu_ps(&V[12], v3);
-}
-#else
-static inline void wino_f23_input_transform(const float d[16], float V[16]) {
-    float t[16];
-    for (int j = 0; j < 4; j++) {
-        t[0 * 4 + j] = d[0 * 4 + j] - d[2 * 4 + j];
-        t[1 * 4 + j] = d[1 * 4 + j] + d[2 * 4 + j];
-        t[2 * 4 + j] = -d[1 * 4 + j] + d[2 * 4 + j];
-        t[3 * 4 + j] = d[1 * 4 + j] - d[3 * 4 + j];
-    }
-    for (int i = 0; i < 4; i++) {
-        V[i * 4 + 0] = t[i * 4 + 0] - t[i * 4 + 2];
-        V[i * 4 + 1] = t[i * 4 + 1] + t[i * 4 + 2];
-        V[i * 4 + 2] = -t[i * 4 + 1] + t[i * 4 + 2];
-        V[i * 4 + 3] = t[i * 4 + 1] - t[i * 4 + 3];
-    }
-}
-#endif
-
-/* Weight transform: U = G * g * G^T for 3x3 filter
- * G = [1,0,0; 0.5,0.5,0.5; 0.5,-0.5,0.5; 0,0,1] */
-static inline void wino_f23_weight_transform(const float g[9], float U[16]) {
-    float t[12]; /* 4x3 */
-    for (int j = 0; j < 3; j++) {
-        t[0 * 3 + j] = g[0 * 3 + j];
-        t[1 * 3 + j] = 0.5f * (g[0 * 3 + j] + g[1 * 3 + j] + g[2 * 3 + j]);
-        t[2 * 3 + j] = 0.5f * (g[0 * 3 + j] - g[1 * 3 + j] + g[2 * 3 + j]);
-        t[3 * 3 + j] = g[2 * 3 + j];
-    }
-    for (int i = 0; i < 4; i++) {
-        U[i * 4 + 0] = t[i * 3 + 0];
-        U[i * 4 + 1] = 0.5f * (t[i * 3 + 0] + t[i * 3 + 1] + t[i * 3 + 2]);
-        U[i * 4 + 2] = 0.5f * (t[i * 3 + 0] - t[i * 3 + 1] + t[i * 3 + 2]);
-        U[i * 4 + 3] = t[i * 3 + 2];
-    }
-}
-
-/* Output transform: Y = A^T * M * A for 4x4 → 2x2
- * A^T = [1,1,1,0; 0,1,-1,-1] */
-#ifdef __SSE__
-static inline void wino_f23_output_transform(const float M[16], float Y[4]) {
-    /* SSE: A^T * M (process 4 columns in parallel), then * A */
-    __m128 m0 = _mm_loadu_ps(&M[0]);
-    __m128 m1 = _mm_loadu_ps(&M[4]);
-    __m128 m2 = _mm_loadu_ps(&M[8]);
-    __m128 m3 = _mm_loadu_ps(&M[12]);
-
-    /* A^T * M: t0 = m0+m1+m2, t1 = m1-m2-m3 */
-    __m128 t0 = _mm_add_ps(_mm_add_ps(m0, m1), m2);
-    __m128 t1 = _mm_sub_ps(_mm_sub_ps(m1, m2), m3);
-
-    /* Now t0 and t1 are 1x4 rows. Apply * A column-wise:
-     * Y[0,0] = t0[0]+t0[1]+t0[2], Y[0,1] = t0[1]-t0[2]-t0[3]
-     * Y[1,0] = t1[0]+t1[1]+t1[2], Y[1,1] = t1[1]-t1[2]-t1[3]
-     * Extract scalar since output is only 2x2 */
-    float t0v[4], t1v[4];
-    _mm_storeu_ps(t0v, t0);
-    _mm_storeu_ps(t1v, t1);
-    Y[0] = t0v[0] + t0v[1] + t0v[2];
-    Y[1] = t0v[1] - t0v[2] - t0v[3];
-    Y[2] = t1v[0] + t1v[1] + t1v[2];
-    Y[3] = t1v[1] - t1v[2] - t1v[3];
-}
-#else
-static inline void wino_f23_output_transform(const float M[16], float Y[4]) {
-    float t[8];
-    for (int j = 0; j < 4; j++) {
-        t[0 * 4 + j] = M[0 * 4 + j] + M[1 * 4 + j] + M[2 * 4 + j];
-        t[1 * 4 + j] = M[1 * 4 + j] - M[2 * 4 + j] - M[3 * 4 + j];
-    }
-    Y[0] = t[0] + t[1] + t[2];
-    Y[1] = t[1] - t[2] - t[3];
-    Y[2] = t[4] + t[5] + t[6];
-    Y[3] = t[5] - t[6] - t[7];
-}
-#endif
-
-/* BLAS-batched Winograd F(2,3) with hardcoded transforms.
- * Uses add/sub-only transforms (no generic matmul) + batched GEMM/inline
- * multiply at each of the 16 Winograd points. */
-static int winograd_conv2d_blas(CMLBlasContext* blas, const float* input, const float* weight,
-                                const float* bias, float* output, int batch, int in_channels,
-                                int out_channels, int H, int W, int pad_h, int pad_w, int groups) {
-    const int ks = 3, ot = 2;
-    int out_h = H + 2 * pad_h - ks + 1;
-    int out_w = W + 2 * pad_w - ks + 1;
-    if (out_h <= 0 || out_w <= 0)
-        return -1;
-
-    int tiles_h     = (out_h + ot - 1) / ot;
-    int tiles_w     = (out_w + ot - 1) / ot;
-    int total_tiles = batch * tiles_h * tiles_w;
-
-    int ic_pg = in_channels / groups;
-    int oc_pg = out_channels / groups;
-
-    /* U[16][oc_pg * ic_pg], V[16][ic_pg * total_tiles], M[16][oc_pg * total_tiles] */
-    size_t U_sz  = (size_t)16 * oc_pg * ic_pg;
-    size_t V_sz  = (size_t)16 * ic_pg * total_tiles;
-    size_t M_sz  = (size_t)16 * oc_pg * total_tiles;
-    float* U_buf = (float*)malloc(U_sz * sizeof(float));
-    float* V_buf = (float*)malloc(V_sz * sizeof(float));
-    float* M_buf = (float*)malloc(M_sz * sizeof(float));
-    if (!U_buf || !V_buf || !M_buf) {
-        free(U_buf);
-        free(V_buf);
-        free(M_buf);
-        return -1;
-    }
-
-    memset(output, 0, (size_t)batch * out_channels * out_h * out_w * sizeof(float));
-
-    for (int g = 0; g < groups; g++) {
-        int ic_start = g * ic_pg;
-        int oc_start = g * oc_pg;
-
-        /* Step 1: Transform weights with hardcoded add/sub formula */
-        for (int oc = 0; oc < oc_pg; oc++) {
-            for (int ic = 0; ic < ic_pg; ic++) {
-                const float* w =
-                    weight + ((size_t)(oc_start + oc) * in_channels + (ic_start + ic)) * 9;
-                float U[16];
-                wino_f23_weight_transform(w, U);
-                for (int p = 0; p < 16; p++)
-                    U_buf[p * oc_pg * ic_pg + oc * ic_pg + ic] = U[p];
-            }
-        }
-
-        /* Step 2: Transform input tiles with hardcoded add/sub formula */
-        for (int b = 0; b < batch; b++) {
-            for (int th = 0; th < tiles_h; th++) {
-                for (int tw = 0; tw < tiles_w; tw++) {
-                    int tile_idx = b * tiles_h * tiles_w + th * tiles_w + tw;
-                    int trow = th * ot, tcol = tw * ot;
-
-                    for (int ic = 0; ic < ic_pg; ic++) {
-                        const float* in_ch =
-                            input + ((size_t)b * in_channels + ic_start + ic) * H * W;
-                        float d[16];
-                        for (int i = 0; i < 4; i++) {
-                            int r = trow + i - pad_h;
-                            for (int j = 0; j < 4; j++) {
-                                int c = tcol + j - pad_w;
-                                d[i * 4 + j] =
-                                    (r >= 0 && r < H && c >= 0 && c < W) ? in_ch[r * W + c] : 0.0f;
-                            }
-                        }
-                        float V[16];
-                        wino_f23_input_transform(d, V);
-                        for (int p = 0; p < 16; p++)
-                            V_buf[p * ic_pg * total_tiles + ic * total_tiles + tile_idx] = V[p];
-                    }
-                }
-            }
-        }
-
-        /* Step 3: Pointwise multiply — BLAS GEMM for large K, inline for small */
-        if (ic_pg >= 8) {
-            for (int p = 0; p < 16; p++) {
-                float* Up = U_buf + (size_t)p * oc_pg * ic_pg;
-                float* Vp = V_buf + (size_t)p * ic_pg * total_tiles;
-                float* Mp = M_buf + (size_t)p * oc_pg * total_tiles;
-                cml_blas_sgemm(blas, Up, Vp, Mp, oc_pg, total_tiles, ic_pg, 1.0f, 0.0f);
-            }
-        } else {
-            for (int p = 0; p < 16; p++) {
-                const float* Up = U_buf + (size_t)p * oc_pg * ic_pg;
-                const float* Vp = V_buf + (size_t)p * ic_pg * total_tiles;
-                float* Mp       = M_buf + (size_t)p * oc_pg * total_tiles;
-                for (int oc = 0; oc < oc_pg; oc++) {
-                    const float* u_row = Up + oc * ic_pg;
-                    float* m_row       = Mp + oc * total_tiles;
-                    memset(m_row, 0, total_tiles * sizeof(float));
-                    for (int ic = 0; ic < ic_pg; ic++) {
-                        float u_val        = u_row[ic];
-                        const float* v_row = Vp + ic * total_tiles;
-                        for (int t = 0; t < total_tiles; t++)
-                            m_row[t] += u_val * v_row[t];
-                    }
-                }
-            }
-        }
-
-        /* Step 4: Inverse transform with hardcoded formula */
-        for (int b = 0; b < batch; b++) {
-            for (int th = 0; th < tiles_h; th++) {
-                for (int tw = 0; tw < tiles_w; tw++) {
-                    int tile_idx = b * tiles_h * tiles_w + th * tiles_w + tw;
-                    int out_row = th * ot, out_col = tw * ot;
-
-                    for (int oc = 0; oc < oc_pg; oc++) {
-                        float Mtile[16];
-                        for (int p = 0; p < 16; p++)
-                            Mtile[p] = M_buf[p * oc_pg * total_tiles + oc * total_tiles + tile_idx];
-
-                        float Y[4];
-                        wino_f23_output_transform(Mtile, Y);
-
-                        float* out_plane =
-                            output + ((size_t)b * out_channels + oc_start + oc) * out_h * out_w;
-                        for (int i = 0; i < 2 && out_row + i < out_h; i++)
-                            for (int j = 0; j < 2 && out_col + j < out_w; j++)
-                                out_plane[(out_row + i) * out_w + (out_col + j)] += Y[i * 2 + j];
-                    }
-                }
-            }
-        }
-
-        if (bias) {
-            for (int b = 0; b < batch; b++)
-                for (int oc = 0; oc < oc_pg; oc++) {
-                    float bv = bias[oc_start + oc];
-                    float* out_plane =
-                        output + ((size_t)b * out_channels + oc_start + oc) * out_h * out_w;
-                    for (int i = 0; i < out_h * out_w; i++)
-                        out_plane[i] += bv;
-                }
-        }
-    }
-
-    free(U_buf);
-    free(V_buf);
-    free(M_buf);
-    return 0;
-}
-
 // Numpy-style broadcast index: given a flat index in the output tensor,
 // compute the corresponding flat index in a (possibly smaller) input tensor.
 // Handles cases like [N,M] op [N,1] or [N,M] op [1,M] correctly.
@@ -581,6 +152,84 @@ static inline int _detect_broadcast_2d(Tensor* a, Tensor* b, Tensor* out, size_t
         }                                                                                          \
     } while (0)
 
+static int ensure_output_data(Tensor* out) {
+    if (!out->data && out->numel > 0) {
+        size_t size = out->numel * cml_dtype_size(out->dtype);
+        out->data   = cml_buffer_cache_alloc(size);
+        if (!out->data) {
+            LOG_ERROR("Failed to allocate output tensor data");
+            return -1;
+        }
+        out->owns_data         = true;
+        out->from_buffer_cache = true;
+    }
+    return 0;
+}
+
+/* Shape of a UOP_CONV2D node, as the conv case reads it */
+static bool conv_node_shape(const struct IRNode* node, ConvBlockedShape* s, int* groups) {
+    if (node->type != UOP_CONV2D || node->num_inputs < 2 || !node->inputs || !node->output)
+        return false;
+    const Tensor* in  = node->inputs[0];
+    const Tensor* w   = node->inputs[1];
+    const Tensor* out = node->output;
+    if (!in || !w || in->ndim != 4 || w->ndim != 4 || out->ndim != 4)
+        return false;
+    const Conv2DParams* p = (const Conv2DParams*)node->params;
+    *s = (ConvBlockedShape){
+        .batch = in->shape[0], .in_channels = in->shape[1], .in_h = in->shape[2],
+        .in_w = in->shape[3], .out_channels = w->shape[0], .out_h = out->shape[2],
+        .out_w = out->shape[3], .kernel_h = w->shape[2], .kernel_w = w->shape[3],
+        .stride_h = p && p->stride ? p->stride[0] : 1,
+        .stride_w = p && p->stride ? p->stride[1] : 1,
+        .pad_h = p && p->padding ? p->padding[0] : 0, .pad_w = p && p->padding ? p->padding[1] : 0,
+        .dilation_h = p && p->dilation ? p->dilation[0] : 1,
+        .dilation_w = p && p->dilation ? p->dilation[1] : 1};
+    *groups = p && p->groups > 1 ? p->groups : 1;
+    return true;
+}
+
+/* Winograd for 3x3, stride 1, dilation 1 convolutions. Only beneficial when
+ * in_channels >= 16: for shallow inputs (e.g. 3-ch RGB) the per-point GEMMs
+ * have K=in_ch, too small to amortise the tile transforms. */
+static bool conv_takes_winograd(const Conv2DParams* p, const ConvBlockedShape* s, int groups) {
+    return p && p->use_winograd && winograd_enabled() && s->in_channels / groups >= 16 &&
+           s->kernel_h == 3 && s->kernel_w == 3 && s->stride_h == 1 && s->stride_w == 1 &&
+           s->dilation_h == 1 && s->dilation_w == 1;
+}
+
+/* Whether the conv case takes the blocked path for node */
+static bool conv_node_blocked(const struct IRNode* node) {
+    ConvBlockedShape s;
+    int groups;
+    return conv_node_shape(node, &s, &groups) && !node->fused_into &&
+           !cml_conv_depthwise_applicable(&s, groups) &&
+           !conv_takes_winograd((const Conv2DParams*)node->params, &s, groups) &&
+           cml_conv_blocked_applicable(&s, groups);
+}
+
+/* Producer of node's first input when the plan hands it over in blocked layout */
+static struct IRNode* blocked_producer(const struct IRNode* node) {
+    Tensor* in          = node->num_inputs >= 1 && node->inputs ? node->inputs[0] : NULL;
+    struct IRNode* prod = in ? in->ir_node : NULL;
+    return prod && prod->blocked_consumer == node ? prod : NULL;
+}
+
+/* Writes a producer's kept blocked output to its NCHW tensor, for a consumer
+ * that could not take the blocked path */
+static int blocked_materialize(struct IRNode* producer) {
+    Tensor* t = producer->output;
+    if (t->is_executed)
+        return 0;
+    if (cml_conv_blocked_materialize(producer, producer->blocked_epoch, (float*)t->data,
+                                     t->numel) != 0)
+        return -1;
+    producer->is_elided   = false;
+    producer->is_executed = true;
+    t->is_executed        = true;
+    return 0;
+}
+
 int cpu_execute_node(struct IRNode* node) {
     if (!node || !node->output) {
         return -1;
@@ -588,22 +237,18 @@ int cpu_execute_node(struct IRNode* node) {
 
     Tensor* out = node->output;
 
+    /* Already produced by the depthwise conv it was fused into */
+    if (node->fused_into && node->is_executed && out->is_executed && out->data)
+        return 0;
+
     /* Guard against stale output pointers (tensor freed but node->output
      * not cleared). Check for obviously invalid dtype/numel. */
     if ((int)out->dtype < 0 || (int)out->dtype >= 32 || out->numel > (size_t)1 << 40) {
         return -1;
     }
 
-    if (!out->data && out->numel > 0) {
-        size_t size = out->numel * cml_dtype_size(out->dtype);
-        out->data   = cml_buffer_cache_alloc(size);
-        if (!out->data) {
-            LOG_ERROR("Failed to allocate output tensor data");
-            return -1;
-        }
-        out->owns_data         = true;
-        out->from_buffer_cache = true;
-    }
+    if (ensure_output_data(out) != 0)
+        return -1;
 
     float* out_data = (float*)out->data;
 
@@ -611,6 +256,7 @@ int cpu_execute_node(struct IRNode* node) {
     float* in2_data  = NULL;
     size_t in1_numel = 0;
     size_t in2_numel = 0;
+    bool kept_blocked = false; /* Output left only in blocked layout for the next node */
 
     /* Ensure input data is materialized for EXTERNAL tensors only.
      * In-graph inputs are already executed by the head-to-tail walk in
@@ -2846,7 +2492,21 @@ int cpu_execute_node(struct IRNode* node) {
         break;
     }
 
-    case UOP_RELU:
+    case UOP_RELU: {
+        /* Rectify a conv output kept in blocked layout where it is */
+        struct IRNode* producer = blocked_producer(node);
+        if (producer && in1_numel == out->numel) {
+            ConvBlockedIO io = {.in_key = producer, .epoch = producer->blocked_epoch};
+            if (node->blocked_consumer)
+                io.out_key = node, io.skip_output = true;
+            int r = cml_conv_blocked_relu(&io, out_data, out->numel);
+            if (r >= 0) {
+                kept_blocked = r == 1;
+                break;
+            }
+            if (blocked_materialize(producer) != 0)
+                return -1;
+        }
         if (!in1_data)
             return -1;
         if (in1_numel == out->numel) {
@@ -2862,6 +2522,7 @@ int cpu_execute_node(struct IRNode* node) {
             }
         }
         break;
+    }
 
     case UOP_RELU6:
         if (!in1_data)
@@ -3170,22 +2831,95 @@ int cpu_execute_node(struct IRNode* node) {
         int ch_per_group_in  = in_channels / groups;
         int ch_per_group_out = out_channels / groups;
 
+        ConvBlockedShape shape = {
+            .batch = batch, .in_channels = in_channels, .in_h = in_h, .in_w = in_w,
+            .out_channels = out_channels, .out_h = out_h, .out_w = out_w,
+            .kernel_h = kernel_h, .kernel_w = kernel_w, .stride_h = stride_h,
+            .stride_w = stride_w, .pad_h = pad_h, .pad_w = pad_w,
+            .dilation_h = dilation_h, .dilation_w = dilation_w};
         CMLBlasContext* conv_blas = get_blas_context();
+        bool have_blas            = conv_blas && conv_blas->initialized;
+
+        /* Depthwise: one vectorized pass per plane instead of a GEMM per channel.
+         * When the graph plan fused the next node (a pointwise conv of this
+         * output) into this one, run both band by band and mark it done. */
+        if (cml_conv_depthwise_applicable(&shape, groups)) {
+            struct IRNode* pw = node->next;
+            if (have_blas && pw && pw->fused_into == node && pw->inputs[1]->ndim == 4 &&
+                pw->inputs[1]->shape[1] == out_channels &&
+                pw->output && pw->output->numel ==
+                    (size_t)batch * pw->inputs[1]->shape[0] * out_h * out_w) {
+                Conv2DParams* pp = (Conv2DParams*)pw->params;
+                ConvBlockedShape pws = shape;
+                pws.in_channels = out_channels, pws.in_h = out_h, pws.in_w = out_w;
+                pws.out_channels = pw->inputs[1]->shape[0];
+                pws.kernel_h = pw->inputs[1]->shape[2], pws.kernel_w = pw->inputs[1]->shape[3];
+                pws.stride_h = pp && pp->stride ? pp->stride[0] : 1;
+                pws.stride_w = pp && pp->stride ? pp->stride[1] : 1;
+                pws.pad_h = pp && pp->padding ? pp->padding[0] : 0;
+                pws.pad_w = pp && pp->padding ? pp->padding[1] : 0;
+                const float* pw_bias = pw->num_inputs >= 3 && pw->inputs[2]
+                                           ? (const float*)pw->inputs[2]->data
+                                           : NULL;
+                if (cml_conv_pointwise_applicable(&pws, pp && pp->groups > 1 ? pp->groups : 1) &&
+                    ensure_output_data(pw->output) == 0 &&
+                    cml_conv2d_depthwise_pointwise(conv_blas, in1_data, in2_data, bias_data,
+                                                   out_data, &shape, pw->inputs[1]->data,
+                                                   pw_bias, pw->output->data,
+                                                   pws.out_channels) == 0) {
+                    pw->is_executed         = true;
+                    pw->output->is_executed = true;
+                    break;
+                }
+            }
+            if (cml_conv2d_depthwise(in1_data, in2_data, bias_data, out_data, &shape) == 0)
+                break;
+        }
 
-        /* Winograd F(2,3) for 3x3, stride 1, dilation 1 convolutions.
-         * Only beneficial when in_channels >= 16: for shallow inputs (e.g. 3-ch RGB)
-         * the 16 mini-GEMMs each have K=in_ch which is too small to amortise the
-         * input/output transform overhead, making im2col+GEMM faster. */
-        if (p && p->use_winograd && conv_blas && conv_blas->initialized && ch_per_group_in >= 16 &&
-            kernel_h == 3 && kernel_w == 3 && stride_h == 1 && stride_w == 1 && dilation_h == 1 &&
-            dilation_w == 1) {
-            int ret =
-                winograd_conv2d_blas(conv_blas, in1_data, in2_data, bias_data, out_data, batch,
-                                     in_channels, out_channels, in_h, in_w, pad_h, pad_w, groups);
-            if (ret == 0)
+        /* Winograd ahead of the direct kernels since it needs 2-4x fewer
+         * multiplies. Leaf weights are transformed once per version. */
+        if (conv_takes_winograd(p, &shape, groups)) {
+            WinogradConfig wcfg = winograd_select_variant(out_h, out_w);
+            const float* U      = NULL;
+            if (!weight_t->ir_node)
+                U = winograd_weight_cached(weight_t, weight_t->version, in2_data, out_channels,
+                                           ch_per_group_in, groups, &wcfg);
+            int wret = winograd_conv2d_gemm(in1_data, in2_data, U, bias_data, out_data, batch,
+                                            in_channels, out_channels, in_h, in_w, pad_h, pad_w,
+                                            groups, &wcfg);
+            winograd_weight_release(U);
+            if (wret == 0)
                 break;
-            /* Fall through to im2col on failure */
+            /* Fall through to the other paths on failure */
+        }
+
+        /* Direct convolution on channel-blocked activations: no im2col buffer.
+         * Within a planned chain the input comes from the producer's kept
+         * blocked output and this output is kept for the next node instead of
+         * written back; leaf weights are packed once per version. */
+        struct IRNode* producer = blocked_producer(node);
+        if (cml_conv_blocked_applicable(&shape, groups)) {
+            ConvBlockedIO io = {.epoch = node->blocked_epoch};
+            if (producer)
+                io.in_key = producer, io.epoch = producer->blocked_epoch;
+            if (node->blocked_consumer)
+                io.out_key = node, io.skip_output = true;
+            if (!weight_t->ir_node)
+                io.weight_key = weight_t, io.weight_version = weight_t->version;
+            const float* in_nchw = producer && !input_t->is_executed ? NULL : in1_data;
+            int r = cml_conv2d_blocked_ex(in_nchw, in2_data, bias_data, out_data, &shape, &io);
+            if (r >= 0) {
+                kept_blocked = r == 1;
+                break;
+            }
         }
+        if (producer && blocked_materialize(producer) != 0)
+            return -1;
+
+        /* Pointwise: a GEMM per image on the NCHW data */
+        if (have_blas && cml_conv_pointwise_applicable(&shape, groups) &&
+            cml_conv2d_pointwise(conv_blas, in1_data, in2_data, bias_data, out_data, &shape) == 0)
+            break;
 
         /* im2col + BLAS matmul path (fast) or naive fallback */
         size_t col_h    = (size_t)ch_per_group_in * kernel_h * kernel_w;
@@ -3969,6 +3703,12 @@ int cpu_execute_node(struct IRNode* node) {
         break;
     }
 
+    /* Not written: a later read recomputes it, like a fused-away output */
+    if (kept_blocked) {
+        node->is_elided = true;
+        return 0;
+    }
+
     node->is_executed = true;
     out->is_executed  = true;
 
@@ -3987,6 +3727,442 @@ void cml_cpu_execute_cache_reset(void) {
     g_cpu_exec_last_plan = NULL;
 }
 
+/* ── Parallel DAG executor ───────────────────────────────────────────────
+ *
+ * CML_PARALLEL_EXEC=1 makes cpu_execute_ir run independent nodes
+ * concurrently. Dependencies come from each node's inputs (inp->ir_node);
+ * nodes whose in-degree drops to zero go on a ready queue drained by
+ * CML_INTEROP_THREADS runner slots on the global pool. Every node then runs
+ * with a per-thread budget of pool_threads / interop threads for its own
+ * parallel kernels (GEMM, SIMD loops), so the two levels don't oversubscribe.
+ *
+ * A few ops are not pure functions of their inputs and get extra edges:
+ *   - ordered ops share process-wide state (conv im2col scratch, rand())
+ *     and run one after another in list order, keeping results identical;
+ *   - barrier ops write into their inputs (optimizer steps) and wait for
+ *     everything before them; everything after them waits in turn.
+ */
+
+#define PARALLEL_EXEC_MIN_NODES 4
+
+static int g_parallel_exec_override = -1;
+
+static int cml_ir_use_parallel_exec(void) {
+    static int s_checked = 0;
+    static int s_enabled = 0;
+
+    if (g_parallel_exec_override >= 0)
+        return g_parallel_exec_override;
+
+    if (!s_checked) {
+        const char* env = getenv("CML_PARALLEL_EXEC");
+        s_enabled       = (env && env[0] == '1');
+        s_checked       = 1;
+    }
+
+    return s_enabled;
+}
+
+void cml_ir_set_parallel_exec(int enabled) {
+    g_parallel_exec_override = enabled < 0 ? -1 : (enabled != 0);
+}
+
+/* Runner slots for independent nodes; the rest of the pool goes to the
+ * kernels inside each node. */
+static size_t parallel_exec_interop_threads(size_t pool_threads) {
+    static long s_env = -1;
+    if (s_env < 0) {
+        const char* env = getenv("CML_INTEROP_THREADS");
+        s_env           = (env && atol(env) > 0) ? atol(env) : 0;
+    }
+
+    size_t n = s_env > 0 ? (size_t)s_env : pool_threads / 2;
+    if (n < 2)
+        n = 2;
+    if (n > pool_threads)
+        n = pool_threads;
+    return n;
+}
+
+typedef enum { DAG_NODE_PURE, DAG_NODE_ORDERED, DAG_NODE_BARRIER } DagNodeKind;
+
+static DagNodeKind dag_node_kind(UOpType type) {
+    switch (type) {
+    case UOP_CONV2D:
+    case UOP_RAND_UNIFORM:
+    case UOP_RAND_NORMAL:
+    case UOP_RAND_INT:
+        return DAG_NODE_ORDERED;
+    case UOP_SGD_STEP:
+    case UOP_ADAM_STEP:
+        return DAG_NODE_BARRIER;
+    default:
+        return DAG_NODE_PURE;
+    }
+}
+
+typedef struct {
+    struct IRNode** nodes; /* Pending nodes in list order */
+    int count;
+    int* indegree;
+    int* succ_start; /* CSR successor lists: succ[succ_start[i] .. succ_start[i+1]) */
+    int* succ;
+    int* ready; /* FIFO; every node is pushed exactly once */
+    int ready_head;
+    int ready_tail;
+    int in_flight;
+    int completed;
+    bool stalled;
+    size_t intra_budget;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} DagExec;
+
+typedef struct {
+    int from;
+    int to;
+} DagEdge;
+
+typedef struct {
+    DagEdge* edges;
+    int count;
+    int capacity;
+} DagEdgeList;
+
+static int dag_add_edge(DagEdgeList* list, int from, int to) {
+    if (list->count == list->capacity) {
+        int cap        = list->capacity ? list->capacity * 2 : 64;
+        DagEdge* grown = realloc(list->edges, (size_t)cap * sizeof(DagEdge));
+        if (!grown)
+            return -1;
+        list->edges    = grown;
+        list->capacity = cap;
+    }
+    list->edges[list->count].from = from;
+    list->edges[list->count].to   = to;
+    list->count++;
+    return 0;
+}
+
+/* Open-addressed node -> index map, only alive while the DAG is built */
+static size_t dag_slot(const struct IRNode* node, size_t mask) {
+    uintptr_t h = (uintptr_t)node;
+    h ^= h >> 17;
+    h *= (uintptr_t)0xed5ad4bbu;
+    h ^= h >> 11;
+    return (size_t)h & mask;
+}
+
+static int dag_build(DagExec* ex) {
+    int n       = ex->count;
+    size_t cap  = 16;
+    while (cap < (size_t)n * 2)
+        cap <<= 1;
+    size_t mask = cap - 1;
+
+    struct IRNode** keys = calloc(cap, sizeof(struct IRNode*));
+    int* vals            = malloc(cap * sizeof(int));
+    DagEdgeList list     = {0};
+    int rc               = -1;
+    if (!keys || !vals)
+        goto out;
+
+    for (int i = 0; i < n; i++) {
+        size_t s = dag_slot(ex->nodes[i], mask);
+        while (keys[s])
+            s = (s + 1) & mask;
+        keys[s] = ex->nodes[i];
+        vals[s] = i;
+    }
+
+    int last_ordered = -1;
+    int last_barrier = -1;
+    for (int i = 0; i < n; i++) {
+        struct IRNode* node = ex->nodes[i];
+        DagNodeKind kind    = dag_node_kind(node->type);
+
+        for (int k = 0; k < node->num_inputs && node->inputs; k++) {
+            Tensor* inp = node->inputs[k];
+            if (!inp || !inp->ir_node)
+                continue;
+            size_t s = dag_slot(inp->ir_node, mask);
+            while (keys[s] && keys[s] != inp->ir_node)
+                s = (s + 1) & mask;
+            /* Producers outside the pending set are already materialized */
+            if (keys[s] && vals[s] != i && dag_add_edge(&list, vals[s], i) != 0)
+                goto out;
+        }
+
+        if (kind == DAG_NODE_BARRIER) {
+            for (int j = last_barrier + 1; j < i; j++) {
+                if (dag_add_edge(&list, j, i) != 0)
+                    goto out;
+            }
+            last_barrier = i;
+            last_ordered = i;
+            continue;
+        }
+        if (last_barrier >= 0 && dag_add_edge(&list, last_barrier, i) != 0)
+            goto out;
+        if (kind == DAG_NODE_ORDERED) {
+            if (last_ordered >= 0 && last_ordered != last_barrier &&
+                dag_add_edge(&list, last_ordered, i) != 0)
+                goto out;
+            last_ordered = i;
+        }
+    }
+
+    ex->succ_start = calloc((size_t)n + 1, sizeof(int));
+    ex->succ       = malloc((size_t)(list.count ? list.count : 1) * sizeof(int));
+    if (!ex->succ_start || !ex->succ)
+        goto out;
+
+    for (int e = 0; e < list.count; e++) {
+        ex->succ_start[list.edges[e].from + 1]++;
+        ex->indegree[list.edges[e].to]++;
+    }
+    for (int i = 0; i < n; i++)
+        ex->succ_start[i + 1] += ex->succ_start[i];
+    /* The ready queue is still empty: borrow it as the fill cursor */
+    int* cursor = ex->ready;
+    memcpy(cursor, ex->succ_start, (size_t)n * sizeof(int));
+    for (int e = 0; e < list.count; e++)
+        ex->succ[cursor[list.edges[e].from]++] = list.edges[e].to;
+    rc = 0;
+
+out:
+    free(list.edges);
+    free(keys);
+    free(vals);
+    return rc;
+}
+
+/* One runner slot: pop ready nodes until the graph is done */
+static void dag_exec_drain(DagExec* ex) {
+    static _Thread_local bool tl_in_drain = false;
+
+    /* A runner waiting on its own kernel's parallel_for may pick up another
+     * slot of the same job; blocking there would wait on itself. */
+    if (tl_in_drain)
+        return;
+    tl_in_drain = true;
+
+    size_t saved_budget = threadpool_set_thread_budget(ex->intra_budget);
+
+    pthread_mutex_lock(&ex->lock);
+    for (;;) {
+        while (ex->ready_head == ex->ready_tail && ex->completed < ex->count && !ex->stalled) {
+            if (ex->in_flight == 0) {
+                /* Nothing running and nothing ready: a cycle through the
+                 * edges. Leave the rest to the sequential walk. */
+                ex->stalled = true;
+                pthread_cond_broadcast(&ex->cond);
+                break;
+            }
+            pthread_cond_wait(&ex->cond, &ex->lock);
+        }
+        if (ex->ready_head == ex->ready_tail)
+            break;
+
+        int idx          = ex->ready[ex->ready_head++];
+        ex->indegree[idx] = -1; /* Claimed */
+        ex->in_flight++;
+        pthread_mutex_unlock(&ex->lock);
+
+        if (cpu_execute_node(ex->nodes[idx]) != 0) {
+            LOG_WARNING("CPU fallback: failed to execute node");
+        }
+
+        pthread_mutex_lock(&ex->lock);
+        ex->in_flight--;
+        ex->completed++;
+        for (int e = ex->succ_start[idx]; e < ex->succ_start[idx + 1]; e++) {
+            int s = ex->succ[e];
+            if (--ex->indegree[s] == 0)
+                ex->ready[ex->ready_tail++] = s;
+        }
+        pthread_cond_broadcast(&ex->cond);
+    }
+    pthread_mutex_unlock(&ex->lock);
+
+    threadpool_set_thread_budget(saved_budget);
+    tl_in_drain = false;
+}
+
+static void dag_exec_task(void* data, size_t start, size_t end) {
+    for (size_t slot = start; slot < end; slot++)
+        dag_exec_drain((DagExec*)data);
+}
+
+/* Runs the pending nodes of ir concurrently. Returns the number of nodes
+ * executed, or -1 if the graph should take the sequential path instead
+ * (too small, single-threaded pool, out of memory). */
+static int cpu_execute_ir_parallel(CMLGraph_t ir) {
+    ThreadPool* pool    = threadpool_get_global();
+    size_t pool_threads = threadpool_get_num_threads(pool);
+    if (pool_threads < 2)
+        return -1;
+
+    int pending = 0;
+    for (struct IRNode* node = ir->head; node; node = node->next) {
+        if (node->output && !(node->is_executed && node->output->is_executed))
+            pending++;
+    }
+    if (pending < PARALLEL_EXEC_MIN_NODES)
+        return -1;
+
+    DagExec ex    = {0};
+    ex.count      = pending;
+    ex.nodes      = malloc((size_t)pending * sizeof(struct IRNode*));
+    ex.indegree   = calloc((size_t)pending, sizeof(int));
+    ex.ready      = malloc((size_t)pending * sizeof(int));
+    int executed  = -1;
+    if (!ex.nodes || !ex.indegree || !ex.ready)
+        goto out;
+
+    int i = 0;
+    for (struct IRNode* node = ir->head; node; node = node->next) {
+        if (node->output && !(node->is_executed && node->output->is_executed))
+            ex.nodes[i++] = node;
+    }
+
+    /* Detached leaves get zero-filled on first use; do it here so two
+     * consumers of the same leaf don't both allocate it. */
+    for (i = 0; i < pending; i++) {
+        struct IRNode* node = ex.nodes[i];
+        for (int k = 0; k < node->num_inputs && node->inputs; k++) {
+            Tensor* inp = node->inputs[k];
+            if (inp && !inp->data && !inp->ir_node && inp->numel > 0) {
+                inp->data      = calloc(1, inp->numel * cml_dtype_size(inp->dtype));
+                inp->owns_data = true;
+            }
+        }
+    }
+    if (dag_build(&ex) != 0)
+        goto out;
+
+    for (i = 0; i < pending; i++) {
+        if (ex.indegree[i] == 0)
+            ex.ready[ex.ready_tail++] = i;
+    }
+
+    /* Lazily-initialized singletons must exist before nodes race on them */
+    get_blas_context();
+    cml_get_simd_caps();
+
+    size_t interop = parallel_exec_interop_threads(pool_threads);
+    if (interop > (size_t)pending)
+        interop = (size_t)pending;
+    ex.intra_budget = pool_threads / interop;
+    if (ex.intra_budget < 1)
+        ex.intra_budget = 1;
+
+    pthread_mutex_init(&ex.lock, NULL);
+    pthread_cond_init(&ex.cond, NULL);
+    threadpool_parallel_for_grain(pool, dag_exec_task, &ex, interop, 1);
+    pthread_cond_destroy(&ex.cond);
+    pthread_mutex_destroy(&ex.lock);
+
+    executed = ex.completed;
+    if (ex.stalled)
+        LOG_WARNING("Parallel executor: dependency cycle, finishing sequentially");
+
+    /* Anything never claimed (a stall, or a runner that found itself nested
+     * inside another drain) runs here in list order. */
+    for (i = 0; i < pending; i++) {
+        if (ex.indegree[i] < 0)
+            continue;
+        if (cpu_execute_node(ex.nodes[i]) != 0) {
+            LOG_WARNING("CPU fallback: failed to execute node");
+        }
+        executed++;
+    }
+
+out:
+    free(ex.nodes);
+    free(ex.indegree);
+    free(ex.ready);
+    free(ex.succ_start);
+    free(ex.succ);
+    return executed;
+}
+
+/* Data a node may read before the run starts: a leaf's, or an executed node's */
+static bool tensor_materialized(const Tensor* t) {
+    return t && t->data && (!t->ir_node || (t->is_executed && t->ir_node->is_executed));
+}
+
+static bool node_pending(const struct IRNode* node) {
+    return node->output && !(node->is_executed && node->output->is_executed);
+}
+
+/*
+ * Decisions taken for the whole graph before any node runs, so they hold on
+ * whichever thread the parallel executor runs each node:
+ *
+ * - A depthwise conv followed by a pointwise conv of its output computes
+ *   both, provided the pointwise weight and bias are already materialized:
+ *   nothing in this run may still be producing them.
+ * - A blocked conv whose output only the next node reads, as the input of a
+ *   blocked conv or of a ReLU feeding one, keeps that output in blocked
+ *   layout for it under (node, epoch) and never writes it as NCHW.
+ */
+static void cpu_plan_graph(CMLGraph_t ir, uint64_t epoch) {
+    for (struct IRNode* dw = ir->head; dw; dw = dw->next) {
+        struct IRNode* pw = dw->next;
+        if (dw->type != UOP_CONV2D || !dw->output || dw->is_executed || !pw ||
+            pw->type != UOP_CONV2D || pw->is_executed || !pw->output || pw->num_inputs < 2 ||
+            !pw->inputs || pw->inputs[0] != dw->output)
+            continue;
+        Tensor* bias = pw->num_inputs >= 3 ? pw->inputs[2] : NULL;
+        if (tensor_materialized(pw->inputs[1]) && (!bias || tensor_materialized(bias)))
+            pw->fused_into = dw;
+    }
+
+    for (struct IRNode* node = ir->head; node; node = node->next) {
+        struct IRNode* next = node->next;
+        /* Backward would read the unwritten output */
+        if (!next || !node_pending(node) || !node_pending(next) || node->output->requires_grad ||
+            next->output->requires_grad || next->num_inputs < 1 || !next->inputs ||
+            next->inputs[0] != node->output)
+            continue;
+        /* A conv into a blocked conv or a same-size ReLU; a ReLU, itself
+         * handed a blocked output, into a blocked conv */
+        bool from = node->type == UOP_CONV2D ? conv_node_blocked(node)
+                    : node->type == UOP_RELU ? blocked_producer(node) != NULL
+                                             : false;
+        bool to   = next->type == UOP_CONV2D ? conv_node_blocked(next)
+                    : next->type == UOP_RELU ? node->type == UOP_CONV2D &&
+                                                 next->output->numel == node->output->numel
+                                             : false;
+        if (from && to)
+            node->blocked_consumer = next;
+    }
+
+    /* Any other reader of a planned output needs the NCHW tensor */
+    for (struct IRNode* node = ir->head; node; node = node->next) {
+        for (int k = 0; k < node->num_inputs && node->inputs; k++) {
+            struct IRNode* prod = node->inputs[k] ? node->inputs[k]->ir_node : NULL;
+            if (prod && prod->blocked_consumer && (prod->blocked_consumer != node || k != 0))
+                prod->blocked_consumer = NULL;
+        }
+    }
+    for (struct IRNode* node = ir->head; node; node = node->next) {
+        if (node->type == UOP_RELU && node->blocked_consumer && !blocked_producer(node))
+            node->blocked_consumer = NULL;
+        if (node->blocked_consumer)
+            node->blocked_epoch = epoch;
+    }
+}
+
+static void cpu_unplan_graph(CMLGraph_t ir) {
+    for (struct IRNode* node = ir->head; node; node = node->next) {
+        node->fused_into       = NULL;
+        node->blocked_consumer = NULL;
+        node->blocked_epoch    = 0;
+    }
+}
+
 // Non-static to allow use from dispatch layer
 int cpu_execute_ir(CMLGraph_t ir) {
     if (!ir)
@@ -4004,11 +4180,13 @@ int cpu_execute_ir(CMLGraph_t ir) {
     /* Graph cache: reuse pre-allocated buffers for repeated graph structures.
      * Compute signature → lookup → if hit, assign cached buffers to node outputs
      * so cpu_execute_node() doesn't need to malloc per-node. */
-    uint64_t sig           = cml_graph_compute_signature(ir);
-    CMLGraphCache* cache   = cml_get_graph_cache();
+    uint64_t sig           = ir->private_buffers ? 0 : cml_graph_compute_signature(ir);
+    CMLGraphCache* cache   = ir->private_buffers ? NULL : cml_get_graph_cache();
     CMLExecutionPlan* plan = NULL;
 
-    if (sig == g_cpu_exec_last_sig && g_cpu_exec_last_plan && g_cpu_exec_last_plan->valid) {
+    if (ir->private_buffers) {
+        /* Nodes allocate their own outputs */
+    } else if (sig == g_cpu_exec_last_sig && g_cpu_exec_last_plan && g_cpu_exec_last_plan->valid) {
         plan = g_cpu_exec_last_plan; /* fast path: same graph as last time */
     } else {
         plan = cache ? cml_graph_cache_lookup(cache, sig) : NULL;
@@ -4039,7 +4217,14 @@ int cpu_execute_ir(CMLGraph_t ir) {
         }
     }
 
-    struct IRNode* node = ir->head;
+    uint64_t blocked_epoch = cml_conv_blocked_graph_begin();
+    cpu_plan_graph(ir, blocked_epoch);
+
+    int parallel_executed = cml_ir_use_parallel_exec() ? cpu_execute_ir_parallel(ir) : -1;
+    if (parallel_executed >= 0)
+        g_total_nodes_executed += (size_t)parallel_executed;
+
+    struct IRNode* node = parallel_executed >= 0 ? NULL : ir->head;
     while (node) {
         // Skip nodes that have already been executed and still have valid output
         if (node->is_executed && node->output && node->output->is_executed) {
@@ -4060,6 +4245,8 @@ int cpu_execute_ir(CMLGraph_t ir) {
 
         node = node->next;
     }
+    cpu_unplan_graph(ir);
+    cml_conv_blocked_graph_end(blocked_epoch);
 
     /* Cache miss (or invalidated plan): create plan and cache it */
     if (cache && (!plan || !plan->valid)) {
@@ -4094,11 +4281,22 @@ void cml_print_exec_stats(void) {
     if (g_cpu_exec_calls > 0) {
         printf("  Avg nodes per call: %.1f\n", (double)g_total_nodes_executed / g_cpu_exec_calls);
     }
+
+    CMLBackwardStats bw;
+    cml_get_backward_stats(&bw);
+    if (bw.passes > 0) {
+        printf("  Backward passes: %zu, peak %zu bytes (last %zu)\n", bw.passes, bw.peak_bytes,
+               bw.last_peak_bytes);
+        printf("  Freed during backward: %zu activations (%zu bytes), %zu grads (%zu bytes)\n",
+               bw.activations_freed, bw.activation_bytes_freed, bw.grads_freed,
+               bw.grad_bytes_freed);
+    }
 }
 
 void cml_reset_exec_stats(void) {
     g_cpu_exec_calls       = 0;
     g_total_nodes_executed = 0;
+    cml_reset_backward_stats();
 }
 
 static int cml_ir_use_fusion_scheduler(void) {
@@ -4157,6 +4355,10 @@ int cml_ir_execute_up_to(CMLGraph_t ir, struct IRNode* target_node) {
 
     target_node->is_used = true;
 
+    /* Reading an intermediate the fused executor kept in registers */
+    if (target_node->is_elided)
+        cml_ir_fusion_unelide(target_node);
+
     /* Check if graph should target a GPU backend via CML_BACKEND env.
      * Cache env check + dispatch context to avoid repeated getenv()/lookup. */
     static int s_backend_checked              = 0;
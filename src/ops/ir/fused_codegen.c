@@ -4,8 +4,10 @@
 #include "ops/ir/fused_codegen.h"
 #include "ops/ir/ir.h"
 #include "ops/ir/internal.h"
+#include "ops/uops.h"
 #include "core/logging.h"
 
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -41,6 +43,8 @@ CMLLinearProgram* cml_linearize_group(const CMLFusionGroup* g) {
         compute_op.kind = LINOP_COMPUTE;
         compute_op.uop = node->type;
         compute_op.num_srcs = 0;
+        if (node->type == UOP_FILL && node->params)
+            compute_op.imm = ((FillParams*)node->params)->value;
 
         /* Resolve source operands */
         for (int j = 0; j < node->num_inputs && j < 8; j++) {
@@ -76,6 +80,7 @@ CMLLinearProgram* cml_linearize_group(const CMLFusionGroup* g) {
                 load_op.kind = LINOP_LOAD;
                 load_op.dest_reg = src_reg;
                 load_op.tensor = inp;
+                load_op.is_scalar = inp->numel == 1;
 
                 /* Emit */
                 if (prog->num_ops >= prog->capacity) {
@@ -198,132 +203,180 @@ static bool uop_is_unary(UOpType uop) {
            uop == UOP_SIGMOID || uop == UOP_RECIP || uop == UOP_SILU;
 }
 
-static char* fused_codegen_c(const CMLLinearProgram* prog, size_t work_size) {
-    char* buf = malloc(FUSED_BUF_SIZE);
-    if (!buf) return NULL;
-    int pos = 0;
+/* The C backend covers a few more ops than the GPU emitters */
+static bool c_uop_is_binary(UOpType uop) {
+    return uop_is_binary(uop) || uop == UOP_MINIMUM || uop == UOP_CMPLT;
+}
 
-    pos += snprintf(buf + pos, FUSED_BUF_SIZE - pos,
-        "/* Fused kernel: %d ops, %d vregs */\n"
-        "#include <math.h>\n"
-        "void fused_kernel(", prog->num_ops, prog->next_vreg);
+static bool c_uop_is_unary(UOpType uop) {
+    return uop_is_unary(uop) || uop == UOP_SQUARE || uop == UOP_RSQRT || uop == UOP_EXP2 ||
+           uop == UOP_LOG2 || uop == UOP_ERF;
+}
 
-    /* Count input/output buffers */
-    int buf_idx = 0;
-    for (int i = 0; i < prog->num_ops; i++) {
-        if (prog->ops[i].kind == LINOP_LOAD || prog->ops[i].kind == LINOP_STORE) {
-            if (buf_idx > 0) pos += snprintf(buf + pos, FUSED_BUF_SIZE - pos, ", ");
-            pos += snprintf(buf + pos, FUSED_BUF_SIZE - pos,
-                "float* buf%d", buf_idx);
-            buf_idx++;
-        }
-    }
-    pos += snprintf(buf + pos, FUSED_BUF_SIZE - pos,
-        ", int n) {\n"
-        "    for (int i = 0; i < n; i++) {\n");
+bool cml_fused_c_supports(UOpType uop) {
+    return c_uop_is_binary(uop) || c_uop_is_unary(uop) || uop == UOP_FILL;
+}
 
-    /* Emit operations */
-    buf_idx = 0;
+/* Hex float literal so the constant survives the round trip exactly */
+static int c_float_literal(char* buf, size_t size, float v) {
+    if (isnan(v)) return snprintf(buf, size, "NAN");
+    if (isinf(v)) return snprintf(buf, size, v > 0 ? "INFINITY" : "(-INFINITY)");
+    return snprintf(buf, size, "%af", (double)v);
+}
+
+typedef struct {
+    char* buf;
+    int pos;
+} CSource;
+
+#define EMIT(...)                                                                          \
+    do {                                                                                   \
+        if (src->pos < FUSED_BUF_SIZE)                                                     \
+            src->pos += snprintf(src->buf + src->pos, (size_t)(FUSED_BUF_SIZE - src->pos), \
+                                 __VA_ARGS__);                                             \
+    } while (0)
+
+/* One element of the loop body, indexed by idx */
+static void c_emit_body(CSource* src, const CMLLinearProgram* prog, const char* idx,
+                        const char* ind) {
+    int buf_idx = 0;
     for (int i = 0; i < prog->num_ops; i++) {
         const CMLLinearOp* op = &prog->ops[i];
         switch (op->kind) {
         case LINOP_LOAD:
-            pos += snprintf(buf + pos, FUSED_BUF_SIZE - pos,
-                "        float v%d = buf%d[i];\n", op->dest_reg, buf_idx);
+            if (!op->is_scalar)
+                EMIT("%sfloat v%d = buf%d[%s];\n", ind, op->dest_reg, buf_idx, idx);
             buf_idx++;
             break;
 
         case LINOP_COMPUTE:
-            if (uop_is_binary(op->uop) && op->num_srcs >= 2) {
+            if (c_uop_is_binary(op->uop) && op->num_srcs >= 2) {
+                int a = op->src_regs[0], b = op->src_regs[1];
                 if (op->uop == UOP_MAX) {
-                    pos += snprintf(buf + pos, FUSED_BUF_SIZE - pos,
-                        "        float v%d = fmaxf(v%d, v%d);\n",
-                        op->dest_reg, op->src_regs[0], op->src_regs[1]);
+                    EMIT("%sfloat v%d = fmaxf(v%d, v%d);\n", ind, op->dest_reg, a, b);
+                } else if (op->uop == UOP_MINIMUM) {
+                    EMIT("%sfloat v%d = fminf(v%d, v%d);\n", ind, op->dest_reg, a, b);
                 } else if (op->uop == UOP_POW) {
-                    pos += snprintf(buf + pos, FUSED_BUF_SIZE - pos,
-                        "        float v%d = powf(v%d, v%d);\n",
-                        op->dest_reg, op->src_regs[0], op->src_regs[1]);
+                    EMIT("%sfloat v%d = powf(v%d, v%d);\n", ind, op->dest_reg, a, b);
+                } else if (op->uop == UOP_CMPLT) {
+                    EMIT("%sfloat v%d = v%d < v%d ? 1.0f : 0.0f;\n", ind, op->dest_reg, a, b);
                 } else {
-                    pos += snprintf(buf + pos, FUSED_BUF_SIZE - pos,
-                        "        float v%d = v%d %s v%d;\n",
-                        op->dest_reg, op->src_regs[0],
-                        uop_to_c_binary(op->uop), op->src_regs[1]);
+                    EMIT("%sfloat v%d = v%d %s v%d;\n", ind, op->dest_reg, a,
+                         uop_to_c_binary(op->uop), b);
                 }
-            } else if (uop_is_unary(op->uop) && op->num_srcs >= 1) {
-                int s = op->src_regs[0];
+            } else if (c_uop_is_unary(op->uop) && op->num_srcs >= 1) {
+                int d = op->dest_reg, s = op->src_regs[0];
                 switch (op->uop) {
-                case UOP_NEG:
-                    pos += snprintf(buf + pos, FUSED_BUF_SIZE - pos,
-                        "        float v%d = -v%d;\n", op->dest_reg, s);
-                    break;
-                case UOP_EXP:
-                    pos += snprintf(buf + pos, FUSED_BUF_SIZE - pos,
-                        "        float v%d = expf(v%d);\n", op->dest_reg, s);
-                    break;
-                case UOP_LOG:
-                    pos += snprintf(buf + pos, FUSED_BUF_SIZE - pos,
-                        "        float v%d = logf(v%d);\n", op->dest_reg, s);
-                    break;
-                case UOP_SQRT:
-                    pos += snprintf(buf + pos, FUSED_BUF_SIZE - pos,
-                        "        float v%d = sqrtf(v%d);\n", op->dest_reg, s);
-                    break;
-                case UOP_ABS:
-                    pos += snprintf(buf + pos, FUSED_BUF_SIZE - pos,
-                        "        float v%d = fabsf(v%d);\n", op->dest_reg, s);
-                    break;
-                case UOP_SIN:
-                    pos += snprintf(buf + pos, FUSED_BUF_SIZE - pos,
-                        "        float v%d = sinf(v%d);\n", op->dest_reg, s);
-                    break;
-                case UOP_COS:
-                    pos += snprintf(buf + pos, FUSED_BUF_SIZE - pos,
-                        "        float v%d = cosf(v%d);\n", op->dest_reg, s);
-                    break;
-                case UOP_TANH:
-                    pos += snprintf(buf + pos, FUSED_BUF_SIZE - pos,
-                        "        float v%d = tanhf(v%d);\n", op->dest_reg, s);
-                    break;
+                case UOP_NEG:     EMIT("%sfloat v%d = -v%d;\n", ind, d, s); break;
+                case UOP_EXP:     EMIT("%sfloat v%d = expf(v%d);\n", ind, d, s); break;
+                case UOP_LOG:     EMIT("%sfloat v%d = logf(v%d);\n", ind, d, s); break;
+                case UOP_SQRT:    EMIT("%sfloat v%d = sqrtf(v%d);\n", ind, d, s); break;
+                case UOP_ABS:     EMIT("%sfloat v%d = fabsf(v%d);\n", ind, d, s); break;
+                case UOP_SIN:     EMIT("%sfloat v%d = sinf(v%d);\n", ind, d, s); break;
+                case UOP_COS:     EMIT("%sfloat v%d = cosf(v%d);\n", ind, d, s); break;
+                case UOP_TANH:    EMIT("%sfloat v%d = tanhf(v%d);\n", ind, d, s); break;
+                case UOP_EXP2:    EMIT("%sfloat v%d = exp2f(v%d);\n", ind, d, s); break;
+                case UOP_ERF:     EMIT("%sfloat v%d = erff(v%d);\n", ind, d, s); break;
+                case UOP_RECIP:   EMIT("%sfloat v%d = 1.0f / v%d;\n", ind, d, s); break;
+                case UOP_SQUARE:  EMIT("%sfloat v%d = v%d * v%d;\n", ind, d, s, s); break;
                 case UOP_SIGMOID:
-                    pos += snprintf(buf + pos, FUSED_BUF_SIZE - pos,
-                        "        float v%d = 1.0f / (1.0f + expf(-v%d));\n",
-                        op->dest_reg, s);
-                    break;
-                case UOP_RECIP:
-                    pos += snprintf(buf + pos, FUSED_BUF_SIZE - pos,
-                        "        float v%d = 1.0f / v%d;\n", op->dest_reg, s);
+                    EMIT("%sfloat v%d = 1.0f / (1.0f + expf(-v%d));\n", ind, d, s);
                     break;
                 case UOP_SILU:
-                    pos += snprintf(buf + pos, FUSED_BUF_SIZE - pos,
-                        "        float v%d = v%d / (1.0f + expf(-v%d));\n",
-                        op->dest_reg, s, s);
+                    EMIT("%sfloat v%d = v%d / (1.0f + expf(-v%d));\n", ind, d, s, s);
+                    break;
+                case UOP_RSQRT:
+                    EMIT("%sfloat v%d = 1.0f / sqrtf(fabsf(v%d) + 1e-8f);\n", ind, d, s);
+                    break;
+                case UOP_LOG2:
+                    EMIT("%sfloat v%d = log2f(v%d + 1e-8f);\n", ind, d, s);
                     break;
                 default:
-                    pos += snprintf(buf + pos, FUSED_BUF_SIZE - pos,
-                        "        float v%d = v%d; /* unknown unary */\n",
-                        op->dest_reg, s);
+                    EMIT("%sfloat v%d = v%d; /* unknown unary */\n", ind, d, s);
                     break;
                 }
+            } else if (op->uop == UOP_FILL) {
+                char lit[48];
+                c_float_literal(lit, sizeof(lit), op->imm);
+                EMIT("%sfloat v%d = %s;\n", ind, op->dest_reg, lit);
             } else {
-                pos += snprintf(buf + pos, FUSED_BUF_SIZE - pos,
-                    "        float v%d = 0.0f; /* unsupported op */\n",
-                    op->dest_reg);
+                EMIT("%sfloat v%d = 0.0f; /* unsupported op */\n", ind, op->dest_reg);
             }
             break;
 
         case LINOP_STORE:
-            pos += snprintf(buf + pos, FUSED_BUF_SIZE - pos,
-                "        buf%d[i] = v%d;\n", buf_idx, op->dest_reg);
+            EMIT("%sbuf%d[%s] = v%d;\n", ind, buf_idx, idx, op->dest_reg);
             buf_idx++;
             break;
         }
     }
+}
 
-    pos += snprintf(buf + pos, FUSED_BUF_SIZE - pos,
-        "    }\n}\n");
+/* Entry point: void <name>(float* const* bufs, long start, long end).
+ * bufs holds one pointer per LOAD/STORE in program order; scalar loads are
+ * hoisted out of the loop. Matches the guards of the per-node CPU kernels
+ * where they differ from plain libm (RSQRT, LOG2).
+ *
+ * vec_width > 1 strip-mines the loop into fixed-width strips the compiler
+ * can turn into straight-line vector code, with a scalar tail; unroll > 1
+ * asks the compiler to unroll the outer loop that many times. */
+char* cml_fused_codegen_c_variant(const CMLLinearProgram* prog, const char* name,
+                                  int vec_width, int unroll) {
+    if (!prog || !name) return NULL;
+    CSource source = {malloc(FUSED_BUF_SIZE), 0};
+    CSource* src   = &source;
+    if (!src->buf) return NULL;
+
+    EMIT("/* Fused kernel: %d ops, %d vregs, vec %d, unroll %d */\n"
+         "#include <math.h>\n"
+         "void %s(float* const* bufs, long start, long end) {\n",
+         prog->num_ops, prog->next_vreg, vec_width, unroll, name);
+
+    /* Buffer pointers and hoisted scalar loads */
+    int buf_idx = 0;
+    for (int i = 0; i < prog->num_ops; i++) {
+        const CMLLinearOp* op = &prog->ops[i];
+        if (op->kind == LINOP_LOAD) {
+            EMIT("    const float* restrict buf%d = bufs[%d];\n", buf_idx, buf_idx);
+            if (op->is_scalar)
+                EMIT("    const float v%d = buf%d[0];\n", op->dest_reg, buf_idx);
+            buf_idx++;
+        } else if (op->kind == LINOP_STORE) {
+            EMIT("    float* restrict buf%d = bufs[%d];\n", buf_idx, buf_idx);
+            buf_idx++;
+        }
+    }
+
+    if (vec_width > 1) {
+        EMIT("    long i = start;\n");
+        if (unroll > 1)
+            EMIT("#pragma GCC unroll %d\n", unroll);
+        EMIT("    for (; i + %d <= end; i += %d) {\n"
+             "        for (long j = i; j < i + %d; j++) {\n",
+             vec_width, vec_width, vec_width);
+        c_emit_body(src, prog, "j", "            ");
+        EMIT("        }\n    }\n    for (; i < end; i++) {\n");
+    } else {
+        if (unroll > 1)
+            EMIT("#pragma GCC unroll %d\n", unroll);
+        EMIT("    for (long i = start; i < end; i++) {\n");
+    }
+    c_emit_body(src, prog, "i", "        ");
+    EMIT("    }\n}\n");
+
+    if (src->pos >= FUSED_BUF_SIZE) {
+        LOG_WARNING("Fused codegen: C source exceeds %d bytes", FUSED_BUF_SIZE);
+        free(src->buf);
+        return NULL;
+    }
+    return src->buf;
+}
+
+#undef EMIT
 
+static char* fused_codegen_c(const CMLLinearProgram* prog, size_t work_size) {
     (void)work_size;
-    return buf;
+    return cml_fused_codegen_c_variant(prog, "fused_kernel", 1, 1);
 }
 
 char* cml_ptx_gen_fused_kernel(const CMLLinearProgram* prog, size_t work_size) {
@@ -11,9 +11,15 @@
 
 #include "ops/ir/schedule.h"
 #include "ops/ir/memory_planner.h"
+#include "ops/ir/runtime_compiler.h"
+#include "ops/ir/beam_search.h"
+#include "ops/ir/execution.h"
 #include "ops/ir/ir.h"
 #include "ops/ir/internal.h"
 #include "core/logging.h"
+#include "alloc/buffer_cache.h"
+#include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -521,6 +527,313 @@ void cml_fusion_schedule_print(const CMLFusionSchedule* sched) {
         cml_memory_plan_print(sched->memory_plan);
 }
 
+/* Nodes the current execution will run */
+static bool fusion_node_pending(const struct IRNode* node) {
+    return node && node->is_used && !node->is_executed && !node->is_elided;
+}
+
+/* Number of pending consumers of each tensor, by open addressing */
+typedef struct {
+    const Tensor** keys;
+    int* counts;
+    size_t cap;
+} ConsumerMap;
+
+static size_t consumer_slot(const ConsumerMap* m, const Tensor* t) {
+    size_t i = (size_t)(((uintptr_t)t >> 4) * 0x9E3779B97F4A7C15ULL) & (m->cap - 1);
+    while (m->keys[i] && m->keys[i] != t)
+        i = (i + 1) & (m->cap - 1);
+    return i;
+}
+
+static int consumer_map_build(ConsumerMap* m, CMLGraph_t ir) {
+    size_t edges = 0;
+    for (struct IRNode* n = ir->head; n; n = n->next) {
+        if (fusion_node_pending(n) && n->inputs)
+            edges += (size_t)n->num_inputs;
+    }
+    m->cap = 16;
+    while (m->cap < edges * 2)
+        m->cap <<= 1;
+    m->keys   = calloc(m->cap, sizeof(*m->keys));
+    m->counts = calloc(m->cap, sizeof(*m->counts));
+    if (!m->keys || !m->counts) {
+        free(m->keys);
+        free(m->counts);
+        return -1;
+    }
+
+    for (struct IRNode* n = ir->head; n; n = n->next) {
+        if (!fusion_node_pending(n) || !n->inputs) continue;
+        for (int k = 0; k < n->num_inputs; k++) {
+            if (!n->inputs[k]) continue;
+            size_t slot     = consumer_slot(m, n->inputs[k]);
+            m->keys[slot]   = n->inputs[k];
+            m->counts[slot]++;
+        }
+    }
+    return 0;
+}
+
+static int consumer_count(const ConsumerMap* m, const Tensor* t) {
+    size_t slot = consumer_slot(m, t);
+    return m->keys[slot] ? m->counts[slot] : 0;
+}
+
+/* Shared by every graph; the compiled-kernel cache is keyed by program hash */
+static CMLRuntimeCompiler* g_fusion_compiler = NULL;
+static pthread_mutex_t g_fusion_compiler_lock = PTHREAD_MUTEX_INITIALIZER;
+
+struct CMLRuntimeCompiler* cml_ir_fusion_compiler(void) {
+    pthread_mutex_lock(&g_fusion_compiler_lock);
+    if (!g_fusion_compiler)
+        g_fusion_compiler = cml_runtime_compiler_create();
+    pthread_mutex_unlock(&g_fusion_compiler_lock);
+    return g_fusion_compiler;
+}
+
+/* CML_BEAM: tuning results, persisted across processes */
+static CMLBeamSearchCtx* g_fusion_beam = NULL;
+static pthread_mutex_t g_fusion_beam_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Times codegen and launch variants the first time a kernel runs, or reuses
+ * a result measured earlier on this CPU model. Tuning happens once per
+ * kernel, at the size of its first launch; results are keyed by size class. */
+static void fusion_tune_kernel(CMLCompiledKernel* kernel, const CMLLinearProgram* prog,
+                               size_t n) {
+    if (kernel->tuned || !cml_beam_search_enabled()) return;
+    kernel->tuned = true;
+
+    char path[512];
+    bool persist = cml_beam_cache_default_path(path, sizeof(path)) == 0;
+    int size_class = 0;
+    while (size_class < 63 && ((size_t)1 << (size_class + 1)) <= n)
+        size_class++;
+    uint64_t key = kernel->hash ^ ((uint64_t)size_class * 0x9E3779B97F4A7C15ULL);
+
+    CMLBeamConfig cfg;
+    int rc = -1;
+    pthread_mutex_lock(&g_fusion_beam_lock);
+    if (!g_fusion_beam) {
+        g_fusion_beam = cml_beam_search_create();
+        if (g_fusion_beam && persist) cml_beam_cache_load(g_fusion_beam, path);
+    }
+    if (g_fusion_beam) {
+        rc = cml_beam_search_lookup(g_fusion_beam, key, &cfg);
+        if (rc != 0) {
+            rc = cml_beam_search_tune_cpu(g_fusion_beam, key, prog, n, &cfg);
+            if (rc == 0 && persist) cml_beam_cache_save(g_fusion_beam, path);
+        }
+    }
+    pthread_mutex_unlock(&g_fusion_beam_lock);
+    if (rc != 0) return;
+
+    CMLNativeLaunch launch = {(size_t)cfg.block_size_x, cfg.num_threads, cfg.loop_order == 1};
+    cml_runtime_tune_native(kernel, cfg.vec_width, cfg.unroll_factor, &launch);
+}
+
+static bool run_produces(struct IRNode* const* run, int len, const Tensor* t) {
+    for (int i = 0; i < len; i++) {
+        if (run[i]->output == t) return true;
+    }
+    return false;
+}
+
+/* node can join run: a C-expressible elementwise op over n floats whose
+ * inputs come from the run or are materialized (full-size or scalar) */
+static bool fusion_node_fusable(struct IRNode* node, struct IRNode* const* run, int len,
+                                size_t n) {
+    if (!cml_fused_c_supports(node->type)) return false;
+    if (node->num_inputs > 2 || (node->type == UOP_FILL) != (node->num_inputs == 0))
+        return false;
+
+    const Tensor* out = node->output;
+    if (!out || out->dtype != DTYPE_FLOAT32 || out->numel == 0) return false;
+    if (len > 0 && out->numel != n) return false;
+
+    for (int k = 0; k < node->num_inputs; k++) {
+        const Tensor* t = node->inputs ? node->inputs[k] : NULL;
+        if (!t) return false;
+        if (run_produces(run, len, t)) continue;
+        if (!t->data || t->dtype != DTYPE_FLOAT32) return false;
+        if (t->numel != out->numel && t->numel != 1) return false;
+    }
+    return true;
+}
+
+static int fusion_alloc_output(Tensor* out) {
+    if (out->data) return 0;
+    out->data = cml_buffer_cache_alloc(out->numel * sizeof(float));
+    if (!out->data) return -1;
+    out->owns_data         = true;
+    out->from_buffer_cache = true;
+    return 0;
+}
+
+/* Compiles run into one kernel and executes it. Returns -1 (nothing
+ * executed) if the kernel cannot be built or bound. */
+static int fusion_execute_run(struct IRNode** run, int len, const ConsumerMap* consumers) {
+    size_t n = run[0]->output->numel;
+
+    /* Keep an output in registers when every pending consumer is in the
+     * run and autograd will not read it back */
+    int* elim   = malloc((size_t)len * sizeof(int));
+    if (!elim) return -1;
+    int num_elim = 0;
+    for (int i = 0; i < len; i++) {
+        const Tensor* out = run[i]->output;
+        int total = consumer_count(consumers, out), internal = 0;
+        for (int j = i + 1; j < len; j++) {
+            for (int k = 0; k < run[j]->num_inputs; k++) {
+                if (run[j]->inputs[k] == out) internal++;
+            }
+        }
+        if (total > 0 && total == internal && !out->requires_grad)
+            elim[num_elim++] = i;
+    }
+
+    CMLFusionGroup group    = {0};
+    group.nodes              = run;
+    group.num_nodes          = len;
+    group.eliminated_buffers = elim;
+    group.num_eliminated     = num_elim;
+    group.type               = SCHED_ELEMENTWISE;
+
+    CMLLinearProgram* prog = cml_linearize_group(&group);
+    if (!prog) {
+        free(elim);
+        return -1;
+    }
+
+    int num_bufs = 0;
+    for (int i = 0; i < prog->num_ops; i++) {
+        if (prog->ops[i].kind != LINOP_COMPUTE) num_bufs++;
+    }
+    float** bufs   = malloc((size_t)(num_bufs > 0 ? num_bufs : 1) * sizeof(float*));
+    bool* is_store = malloc((size_t)(num_bufs > 0 ? num_bufs : 1) * sizeof(bool));
+
+    /* Lookup and codegen are cheap and run under the lock. Building native
+     * code (a compiler subprocess) and launching happen outside it, with the
+     * entry pinned against eviction. One caller builds a kernel; the rest
+     * run its nodes unfused until the build is done. */
+    int rc                    = -1;
+    void* fn                  = NULL;
+    CMLNativeLaunch launch    = {0};
+    bool tuned                = false;
+    bool pinned               = false;
+    bool build                = false;
+    CMLCompiledKernel* kernel = NULL;
+
+    pthread_mutex_lock(&g_fusion_compiler_lock);
+    if (!g_fusion_compiler)
+        g_fusion_compiler = cml_runtime_compiler_create();
+    if (g_fusion_compiler)
+        kernel = (CMLCompiledKernel*)cml_runtime_compile_program(g_fusion_compiler, prog, n);
+    if (kernel && !kernel->building) {
+        if (kernel->native_fn) {
+            fn     = kernel->native_fn;
+            launch = kernel->launch;
+            tuned  = kernel->tuned;
+            pinned = true;
+        } else if (!kernel->native_failed) {
+            kernel->building = true;
+            pinned = build = true;
+        }
+        if (pinned) kernel->pins++;
+    }
+    pthread_mutex_unlock(&g_fusion_compiler_lock);
+
+    if (build) {
+        fusion_tune_kernel(kernel, prog, n);
+        if (cml_runtime_compile_native(kernel) == 0) {
+            fn     = kernel->native_fn;
+            launch = kernel->launch;
+            tuned  = kernel->tuned;
+        }
+        pthread_mutex_lock(&g_fusion_compiler_lock);
+        kernel->building = false;
+        pthread_mutex_unlock(&g_fusion_compiler_lock);
+    }
+
+    if (bufs && is_store && fn) {
+        rc = 0;
+        int b = 0;
+        for (int i = 0; i < prog->num_ops && rc == 0; i++) {
+            const CMLLinearOp* op = &prog->ops[i];
+            if (op->kind == LINOP_COMPUTE) continue;
+            if (op->kind == LINOP_STORE && fusion_alloc_output(op->tensor) != 0) rc = -1;
+            is_store[b] = op->kind == LINOP_STORE;
+            bufs[b++]   = (float*)op->tensor->data;
+        }
+
+        /* The kernel declares its buffers restrict: only loads may alias */
+        for (int i = 0; i < num_bufs && rc == 0; i++) {
+            for (int j = i + 1; j < num_bufs; j++) {
+                if (bufs[i] == bufs[j] && (is_store[i] || is_store[j])) {
+                    rc = -1;
+                    break;
+                }
+            }
+        }
+
+        if (rc == 0)
+            rc = cml_runtime_launch_native_fn(fn, bufs, n, tuned ? &launch : NULL);
+    }
+
+    if (pinned) {
+        pthread_mutex_lock(&g_fusion_compiler_lock);
+        kernel->pins--;
+        pthread_mutex_unlock(&g_fusion_compiler_lock);
+    }
+
+    if (rc == 0) {
+        for (int i = 0, e = 0; i < len; i++) {
+            if (e < num_elim && elim[e] == i) {
+                run[i]->is_elided = true;
+                e++;
+            } else {
+                run[i]->is_executed = true;
+            }
+        }
+    }
+
+    free(bufs);
+    free(is_store);
+    free(elim);
+    cml_linear_program_free(prog);
+    return rc;
+}
+
+static int fusion_execute_node(struct IRNode* node) {
+    int rc = cpu_execute_node(node);
+    if (rc == 0) node->is_executed = true;
+    return rc;
+}
+
+/* Single nodes gain nothing from fusion and keep the tuned CPU kernels */
+static int fusion_flush_run(struct IRNode** run, int len, const ConsumerMap* consumers) {
+    if (len >= 2 && consumers && fusion_execute_run(run, len, consumers) == 0) {
+        LOG_DEBUG("Fused CPU execution of %d nodes", len);
+        return 0;
+    }
+    for (int i = 0; i < len; i++) {
+        int rc = fusion_execute_node(run[i]);
+        if (rc != 0) return rc;
+    }
+    return 0;
+}
+
+void cml_ir_fusion_unelide(struct IRNode* target) {
+    if (!target || !target->is_elided) return;
+    target->is_elided = false;
+    target->is_used   = true; /* Partial execution runs only used nodes */
+    for (int k = 0; k < target->num_inputs && target->inputs; k++) {
+        Tensor* t = target->inputs[k];
+        if (t && t->ir_node && !t->ir_node->is_executed)
+            cml_ir_fusion_unelide(t->ir_node);
+    }
+}
+
 int cml_ir_execute_fusion(CMLGraph_t ir) {
     if (!ir) return -1;
 
@@ -530,23 +843,66 @@ int cml_ir_execute_fusion(CMLGraph_t ir) {
         return -1;
     }
 
-    /* Execute each group in order */
+    /* Nodes added since the last run may read outputs that were fused away */
+    for (struct IRNode* n = ir->head; n; n = n->next) {
+        if (!fusion_node_pending(n) || !n->inputs) continue;
+        for (int k = 0; k < n->num_inputs; k++) {
+            if (n->inputs[k] && n->inputs[k]->ir_node)
+                cml_ir_fusion_unelide(n->inputs[k]->ir_node);
+        }
+    }
+
+    ConsumerMap consumers = {0};
+    bool have_consumers   = consumer_map_build(&consumers, ir) == 0;
+
+    struct IRNode** run = NULL;
+    int run_cap         = 0;
+
+    /* Execute each group in order, fusing its elementwise runs */
     int rc = 0;
     for (int i = 0; i < sched->num_ordered && rc == 0; i++) {
         int idx = sched->execution_order[i];
         CMLFusionGroup* g = sched->groups[idx];
         if (!g) continue;
 
-        /* Execute each node in the group sequentially (CPU fallback) */
+        if (g->num_nodes > run_cap) {
+            struct IRNode** grown = realloc(run, (size_t)g->num_nodes * sizeof(*run));
+            if (!grown) {
+                rc = -1;
+                break;
+            }
+            run     = grown;
+            run_cap = g->num_nodes;
+        }
+
+        int len = 0;
         for (int j = 0; j < g->num_nodes && rc == 0; j++) {
             struct IRNode* node = g->nodes[j];
-            if (!node || node->is_executed) continue;
-            if (!node->is_used) continue;  /* DCE: skip nodes not needed for target */
-            rc = cpu_execute_node(node);
-            if (rc == 0) node->is_executed = true;
+            /* DCE: skip nodes not needed for target */
+            if (!fusion_node_pending(node)) continue;
+
+            size_t n = len > 0 ? run[0]->output->numel : 0;
+            if (fusion_node_fusable(node, run, len, n)) {
+                run[len++] = node;
+                continue;
+            }
+            rc  = fusion_flush_run(run, len, have_consumers ? &consumers : NULL);
+            len = 0;
+            if (rc != 0) break;
+
+            if (fusion_node_fusable(node, run, 0, 0)) {
+                run[len++] = node;
+            } else {
+                rc = fusion_execute_node(node);
+            }
         }
+        if (rc == 0)
+            rc = fusion_flush_run(run, len, have_consumers ? &consumers : NULL);
     }
 
+    free(run);
+    free(consumers.keys);
+    free(consumers.counts);
     cml_fusion_schedule_free(sched);
     return rc;
 }
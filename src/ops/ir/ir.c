@@ -265,6 +265,19 @@ const char* uop_type_to_string(UOpType type) {
     }
 }
 
+static bool ir_eager_free_default(void) {
+    static int s_checked = 0;
+    static bool s_enabled = false;
+
+    if (!s_checked) {
+        const char* env = getenv("CML_EAGER_FREE");
+        s_enabled       = env && env[0] == '1';
+        s_checked       = 1;
+    }
+
+    return s_enabled;
+}
+
 CMLGraph_t cml_ir_new(IRTarget target) {
     CMLGraph_t ir = malloc(sizeof(struct CMLGraph));
     if (!ir)
@@ -280,6 +293,8 @@ CMLGraph_t cml_ir_new(IRTarget target) {
     ir->is_executed                = false;
     ir->is_optimized               = false;
     ir->is_decomposed              = false;
+    ir->private_buffers            = false;
+    ir->eager_free                 = ir_eager_free_default();
     ir->execution_results          = NULL;
     ir->execution_results_count    = 0;
     ir->execution_results_capacity = 0;
@@ -1094,6 +1109,7 @@ int cml_ir_add_uop(CMLGraph_t ir, UOpType type, Tensor** inputs, int num_inputs,
     node->execution_result = NULL;
 
     node->is_used        = false;
+    node->is_elided      = false;
     node->is_fused       = false;
     node->fusion_type    = FUSION_NONE;
     node->fused_kernel   = NULL;
@@ -1101,6 +1117,9 @@ int cml_ir_add_uop(CMLGraph_t ir, UOpType type, Tensor** inputs, int num_inputs,
     node->users          = NULL;
     node->users_capacity = 0;
     node->chain_id       = -1;
+    node->fused_into     = NULL;
+    node->blocked_consumer = NULL;
+    node->blocked_epoch    = 0;
 
     node->ref_count = 1;
     {
@@ -1139,6 +1158,16 @@ struct IRNode* cml_ir_get_tail(CMLGraph_t ir) {
     return ir->last_result ? ir->last_result : ir->tail;
 }
 
+void cml_ir_set_private_buffers(CMLGraph_t ir, bool enabled) {
+    if (ir)
+        ir->private_buffers = enabled;
+}
+
+void cml_ir_set_eager_free(CMLGraph_t ir, bool enabled) {
+    if (ir)
+        ir->eager_free = enabled;
+}
+
 char* cml_ir_compile(CMLGraph_t ir, const char* output_file) {
     if (!ir)
         return NULL;
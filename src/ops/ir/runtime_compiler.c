@@ -3,6 +3,7 @@
 #include "ops/ir/schedule.h"
 #include "ops/ir/ir.h"
 #include "ops/ir/internal.h"
+#include "backend/threadpool.h"
 #include "core/logging.h"
 
 #include <stdlib.h>
@@ -10,6 +11,8 @@
 #include <stdio.h>
 #include <time.h>
 #include <math.h>
+#include <dlfcn.h>
+#include <unistd.h>
 
 #define FNV_OFFSET 0xcbf29ce484222325ULL
 #define FNV_PRIME  0x100000001b3ULL
@@ -37,6 +40,9 @@ static uint64_t hash_linear_program(const CMLLinearProgram* prog) {
         for (int j = 0; j < op->num_srcs; j++) {
             h = hash_bytes(h, &op->src_regs[j], sizeof(op->src_regs[j]));
         }
+        h = hash_bytes(h, &op->is_scalar, sizeof(op->is_scalar));
+        if (op->kind == LINOP_COMPUTE && op->uop == UOP_FILL)
+            h = hash_bytes(h, &op->imm, sizeof(op->imm));
     }
     return h;
 }
@@ -50,14 +56,20 @@ CMLRuntimeCompiler* cml_runtime_compiler_create(void) {
     return rc;
 }
 
+static void kernel_release(CMLCompiledKernel* k) {
+    free(k->source);
+    free(k->binary);
+    free(k->ops);
+    if (k->native_handle)
+        dlclose(k->native_handle);
+}
+
 void cml_runtime_compiler_free(CMLRuntimeCompiler* rc) {
     if (!rc) return;
     for (int i = 0; i < CML_COMPILED_CACHE_SIZE; i++) {
         CMLCompiledKernel* k = &rc->cache[i];
         if (k->valid) {
-            free(k->source);
-            free(k->binary);
-            free(k->ops);
+            kernel_release(k);
         }
     }
     free(rc);
@@ -87,9 +99,8 @@ static CMLCompiledKernel* cache_insert(CMLRuntimeCompiler* rc, uint64_t hash) {
         }
     }
     CMLCompiledKernel* k = &rc->cache[hash % CML_COMPILED_CACHE_SIZE];
-    free(k->source);
-    free(k->binary);
-    free(k->ops);
+    if (k->pins > 0) return NULL;
+    kernel_release(k);
     memset(k, 0, sizeof(*k));
     k->hash = hash;
     k->valid = true;
@@ -201,16 +212,15 @@ int cml_runtime_execute_compiled(const CMLCompiledKernel* kernel,
 
                 for (int op_i = 0; op_i < kernel->num_ops; op_i++) {
                     const CMLLinearOp* op = &kernel->ops[op_i];
-                    if (op->is_eliminated) continue;
-
                     int d = op->dest_reg;
                     if (d < 0 || d >= nregs) continue;
 
                     if (op->kind == LINOP_LOAD) {
+                        size_t src_i = op->is_scalar ? 0 : i;
                         if (input_idx < num_inputs && inputs[input_idx]
                             && inputs[input_idx]->data
-                            && i < (size_t)inputs[input_idx]->numel) {
-                            vregs[d] = ((float*)inputs[input_idx]->data)[i];
+                            && src_i < (size_t)inputs[input_idx]->numel) {
+                            vregs[d] = ((float*)inputs[input_idx]->data)[src_i];
                         }
                         input_idx++;
                     } else if (op->kind == LINOP_STORE) {
@@ -251,6 +261,7 @@ int cml_runtime_execute_compiled(const CMLCompiledKernel* kernel,
                         case UOP_POW:   vregs[d] = powf(a, b); break;
                         case UOP_MAX:   vregs[d] = a > b ? a : b; break;
                         case UOP_CMPLT: vregs[d] = a < b ? 1.0f : 0.0f; break;
+                        case UOP_FILL:  vregs[d] = op->imm; break;
                         default:        vregs[d] = a; break; /* passthrough */
                         }
                     }
@@ -281,6 +292,181 @@ int cml_runtime_execute_compiled(const CMLCompiledKernel* kernel,
     return 0;
 }
 
+/* The compiler comes from the environment and goes through popen */
+static bool native_cc_is_safe(const char* cc) {
+    for (const char* p = cc; *p; p++) {
+        if (strchr(";|&$`\n\r(){}<>!\\'\"", *p))
+            return false;
+    }
+    return true;
+}
+
+void* cml_runtime_build_native(const char* source) {
+    if (!source) return NULL;
+
+    const char* cc = getenv("CML_CC");
+    if (!cc || !cc[0]) cc = "cc";
+    if (!native_cc_is_safe(cc)) {
+        LOG_ERROR("Runtime compiler: unsafe CML_CC rejected");
+        return NULL;
+    }
+
+    char dir[] = "/tmp/cml_fused_XXXXXX";
+    if (!mkdtemp(dir)) {
+        LOG_WARNING("Runtime compiler: cannot create build directory");
+        return NULL;
+    }
+    char c_path[64], so_path[64];
+    snprintf(c_path, sizeof(c_path), "%s/kernel.c", dir);
+    snprintf(so_path, sizeof(so_path), "%s/kernel.so", dir);
+
+    void* handle = NULL;
+    FILE* f = fopen(c_path, "w");
+    if (f) {
+        fputs(source, f);
+        fclose(f);
+
+        /* Elementwise only, so reassociation is harmless; keep inf/nan */
+        char cmd[512];
+        snprintf(cmd, sizeof(cmd),
+                 "%s -O3 -march=native -ffast-math -fno-finite-math-only -fPIC -shared "
+                 "-o %s %s -lm 2>&1", cc, so_path, c_path);
+
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        FILE* proc = popen(cmd, "r");
+        if (proc) {
+            char line[256];
+            while (fgets(line, sizeof(line), proc)) {
+                LOG_DEBUG("cc: %s", line);
+            }
+            int status = pclose(proc);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            if (status == 0) {
+                handle = dlopen(so_path, RTLD_NOW | RTLD_LOCAL);
+                if (handle)
+                    LOG_DEBUG("Runtime compiler: native build took %.1f ms",
+                              (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) * 1e-6);
+                else
+                    LOG_WARNING("Runtime compiler: failed to load fused kernel: %s", dlerror());
+            } else {
+                LOG_WARNING("Runtime compiler: '%s' failed with status %d", cc, status);
+            }
+        }
+    }
+
+    remove(c_path);
+    remove(so_path);
+    rmdir(dir);
+    return handle;
+}
+
+int cml_runtime_compile_native(CMLCompiledKernel* kernel) {
+    if (!kernel || kernel->backend != CML_FUSED_BACKEND_C || !kernel->source) return -1;
+    if (kernel->native_fn) return 0;
+    if (kernel->native_failed) return -1;
+    kernel->native_failed = true;
+
+    void* handle = cml_runtime_build_native(kernel->source);
+    void* fn     = handle ? dlsym(handle, "fused_kernel") : NULL;
+    if (!fn) {
+        if (handle) dlclose(handle);
+        return -1;
+    }
+    kernel->native_handle = handle;
+    kernel->native_fn     = fn;
+    kernel->native_failed = false;
+    return 0;
+}
+
+int cml_runtime_tune_native(CMLCompiledKernel* kernel, int vec_width, int unroll,
+                            const CMLNativeLaunch* launch) {
+    if (!kernel || kernel->backend != CML_FUSED_BACKEND_C || !kernel->ops || !launch) return -1;
+    if (vec_width < 1) vec_width = 1;
+    if (unroll < 1) unroll = 1;
+
+    if (vec_width != (kernel->vec_width > 0 ? kernel->vec_width : 1) ||
+        unroll != (kernel->unroll > 0 ? kernel->unroll : 1)) {
+        CMLLinearProgram prog = {kernel->ops, kernel->num_ops, kernel->num_ops, kernel->num_vregs};
+        char* source = cml_fused_codegen_c_variant(&prog, "fused_kernel", vec_width, unroll);
+        if (!source) return -1;
+
+        free(kernel->source);
+        if (kernel->native_handle) dlclose(kernel->native_handle);
+        kernel->source        = source;
+        kernel->native_handle = NULL;
+        kernel->native_fn     = NULL;
+        kernel->native_failed = false;
+        kernel->vec_width     = vec_width;
+        kernel->unroll        = unroll;
+    }
+    kernel->launch = *launch;
+    kernel->tuned  = true;
+    return cml_runtime_compile_native(kernel);
+}
+
+typedef void (*FusedKernelFn)(float* const* bufs, long start, long end);
+
+typedef struct {
+    FusedKernelFn fn;
+    float* const* bufs;
+    size_t n;
+    size_t tile;
+    size_t lanes;
+} NativeLaunch;
+
+static void native_launch_range(void* data, size_t start, size_t end) {
+    const NativeLaunch* l = (const NativeLaunch*)data;
+    l->fn(l->bufs, (long)start, (long)end);
+}
+
+/* Lane t runs tiles t, t + lanes, t + 2 * lanes, ... */
+static void native_launch_lanes(void* data, size_t start, size_t end) {
+    const NativeLaunch* l = (const NativeLaunch*)data;
+    for (size_t lane = start; lane < end; lane++) {
+        for (size_t lo = lane * l->tile; lo < l->n; lo += l->lanes * l->tile) {
+            size_t hi = lo + l->tile < l->n ? lo + l->tile : l->n;
+            l->fn(l->bufs, (long)lo, (long)hi);
+        }
+    }
+}
+
+/* Big enough that a chunk amortizes the task handoff */
+#define NATIVE_LAUNCH_GRAIN 16384
+
+int cml_runtime_launch_native_fn(void* fn, float* const* bufs, size_t n,
+                                 const CMLNativeLaunch* launch) {
+    if (!fn || !bufs) return -1;
+    NativeLaunch l = {.fn = (FusedKernelFn)fn, .bufs = bufs, .n = n};
+    l.tile = launch && launch->tile > 0 ? launch->tile : NATIVE_LAUNCH_GRAIN;
+    size_t threads = launch && launch->num_threads > 0 ? (size_t)launch->num_threads : 0;
+
+    if (threads == 1 || n <= l.tile) {
+        l.fn(bufs, 0, (long)n);
+    } else if (launch && launch->interleaved) {
+        size_t tiles = (n + l.tile - 1) / l.tile;
+        l.lanes      = threads ? threads : threadpool_get_num_threads(threadpool_get_global());
+        if (l.lanes == 0) l.lanes = 1;
+        if (l.lanes > tiles) l.lanes = tiles;
+        threadpool_parallel_for_grain(NULL, native_launch_lanes, &l, l.lanes, 1);
+    } else {
+        /* At most `threads` spans, each a whole number of tiles */
+        size_t grain = l.tile;
+        if (threads) {
+            size_t span = (n + threads - 1) / threads;
+            grain       = (span + l.tile - 1) / l.tile * l.tile;
+        }
+        threadpool_parallel_for_grain(NULL, native_launch_range, &l, n, grain);
+    }
+    return 0;
+}
+
+int cml_runtime_launch_native(const CMLCompiledKernel* kernel, float* const* bufs, size_t n) {
+    if (!kernel || !kernel->native_fn) return -1;
+    return cml_runtime_launch_native_fn(kernel->native_fn, bufs, n,
+                                        kernel->tuned ? &kernel->launch : NULL);
+}
+
 int cml_runtime_execute_graph(CMLRuntimeCompiler* rc, CMLGraph_t ir) {
     if (!rc || !ir) return -1;
 
@@ -378,16 +564,16 @@ void cml_runtime_compiler_stats(const CMLRuntimeCompiler* rc,
 
 void cml_runtime_compiler_clear_cache(CMLRuntimeCompiler* rc) {
     if (!rc) return;
+    rc->num_cached = 0;
     for (int i = 0; i < CML_COMPILED_CACHE_SIZE; i++) {
         CMLCompiledKernel* k = &rc->cache[i];
-        if (k->valid) {
-            free(k->source);
-            free(k->binary);
-            free(k->ops);
+        if (k->valid && k->pins > 0) {
+            rc->num_cached++;
+        } else if (k->valid) {
+            kernel_release(k);
             memset(k, 0, sizeof(*k));
         }
     }
-    rc->num_cached = 0;
 }
 
 void cml_runtime_compiler_set_backend(CMLRuntimeCompiler* rc,
@@ -2266,6 +2266,15 @@ static size_t g_parallel_threshold = 10000; // Min elements for parallel executi
 
 void simd_set_parallel_threshold(size_t threshold) { g_parallel_threshold = threshold; }
 
+/* Elementwise chunks smaller than this cost more to schedule than to run */
+#define PARALLEL_MIN_GRAIN 4096
+
+static size_t parallel_grain(ThreadPool* pool, size_t n) {
+    size_t chunks = threadpool_get_num_threads(pool) * 4;
+    size_t grain  = chunks ? n / chunks : n;
+    return grain < PARALLEL_MIN_GRAIN ? PARALLEL_MIN_GRAIN : grain;
+}
+
 typedef struct {
     const float* a;
     const float* b;
@@ -2294,7 +2303,7 @@ void simd_add_f32_parallel(const float* a, const float* b, float* out, size_t n)
     }
 
     ParallelBinaryData data = {a, b, out};
-    threadpool_parallel_for(pool, parallel_add_task, &data, n);
+    threadpool_parallel_for_grain(pool, parallel_add_task, &data, n, parallel_grain(pool, n));
 }
 
 static void parallel_mul_task(void* data, size_t start, size_t end) {
@@ -2318,7 +2327,7 @@ void simd_mul_f32_parallel(const float* a, const float* b, float* out, size_t n)
     }
 
     ParallelBinaryData data = {a, b, out};
-    threadpool_parallel_for(pool, parallel_mul_task, &data, n);
+    threadpool_parallel_for_grain(pool, parallel_mul_task, &data, n, parallel_grain(pool, n));
 }
 
 typedef struct {
@@ -2347,27 +2356,24 @@ void simd_exp_f32_parallel(const float* in, float* out, size_t n) {
     }
 
     ParallelUnaryData data = {in, out};
-    threadpool_parallel_for(pool, parallel_exp_task, &data, n);
+    threadpool_parallel_for_grain(pool, parallel_exp_task, &data, n, parallel_grain(pool, n));
 }
 
 typedef struct {
     const float* data;
     float* partial_sums;
     size_t num_threads;
+    size_t n;
 } ParallelSumData;
 
+/* Iterates over partial-sum slots rather than elements, so each slot owns a
+ * fixed sub-range regardless of how the pool splits [0, num_threads). */
 static void parallel_sum_task(void* data, size_t start, size_t end) {
     ParallelSumData* d = (ParallelSumData*)data;
-    // Compute partial sum for this chunk
-    float sum = simd_sum_float(&d->data[start], end - start);
-    // Store in partial sums array (thread-safe: each thread writes to different index)
-    // Approximate thread index from start position
-    size_t chunk_size = (end - start);
-    if (chunk_size > 0) {
-        size_t thread_idx = start / chunk_size;
-        if (thread_idx < d->num_threads) {
-            d->partial_sums[thread_idx] = sum;
-        }
+    for (size_t t = start; t < end; t++) {
+        size_t lo          = t * d->n / d->num_threads;
+        size_t hi          = (t + 1) * d->n / d->num_threads;
+        d->partial_sums[t] = simd_sum_float(&d->data[lo], hi - lo);
     }
 }
 
@@ -2393,8 +2399,8 @@ float simd_sum_f32_parallel(const float* data, size_t n) {
         return simd_sum_float(data, n);
     }
 
-    ParallelSumData pdata = {data, partial_sums, num_threads};
-    threadpool_parallel_for(pool, parallel_sum_task, &pdata, n);
+    ParallelSumData pdata = {data, partial_sums, num_threads, n};
+    threadpool_parallel_for_grain(pool, parallel_sum_task, &pdata, num_threads, 1);
 
     // Reduce partial sums
     float total = 0.0f;
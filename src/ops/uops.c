@@ -1046,9 +1046,10 @@ Tensor* uop_conv2d(Tensor* input, Tensor* weight, Tensor* bias, Conv2DParams* pa
     int kernel_h           = weight->shape[2];
     int kernel_w           = weight->shape[3];
 
-    if (in_channels != weight_in_channels) {
-        LOG_ERROR("Conv2D: input channels (%d) doesn't match weight in_channels (%d)", in_channels,
-                  weight_in_channels);
+    int groups = params && params->groups > 1 ? params->groups : 1;
+    if (in_channels != weight_in_channels * groups || out_channels % groups != 0) {
+        LOG_ERROR("Conv2D: input channels (%d) doesn't match weight in_channels (%d) x groups (%d)",
+                  in_channels, weight_in_channels, groups);
         error_stack_push(CM_INVALID_ARGUMENT, "uop_conv2d: channel mismatch", __FILE__, __LINE__,
                          __func__);
         return NULL;
@@ -1107,7 +1108,7 @@ Tensor* uop_conv2d(Tensor* input, Tensor* weight, Tensor* bias, Conv2DParams* pa
     params_copy->padding[1]     = padding_w;
     params_copy->dilation[0]    = dilation_h;
     params_copy->dilation[1]    = dilation_w;
-    params_copy->groups         = params ? params->groups : 1;
+    params_copy->groups         = groups;
 
     params_copy->use_winograd = winograd_applicable(
         kernel_h, kernel_w, stride_h, stride_w, dilation_h, dilation_w);
@@ -4,6 +4,8 @@
  * Ref: Lavin & Gray, "Fast Algorithms for Convolutional Neural Networks" */
 
 #include "ops/winograd.h"
+#include "backend/threadpool.h"
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
@@ -159,6 +161,16 @@ bool winograd_applicable(int kernel_h, int kernel_w,
             dilation_h == 1 && dilation_w == 1);
 }
 
+bool winograd_enabled(void)
+{
+    static int s_enabled = -1;
+    if (s_enabled < 0) {
+        const char *env = getenv("CML_WINOGRAD");
+        s_enabled       = !(env && env[0] == '0');
+    }
+    return s_enabled;
+}
+
 WinogradConfig winograd_select_variant(int height, int width)
 {
     WinogradConfig cfg;
@@ -395,3 +407,546 @@ int winograd_conv2d(const float *input, const float *weight, const float *bias,
 
     return 0;
 }
+
+/* Batched-GEMM path.
+ *
+ * Tiles are handled a chunk of tile rows at a time. Each channel's tiles are
+ * transformed into V[p][ic][tile], one row per tile point p; every tile point
+ * is then a GEMM M[p] = U[p] V[p] with U packed in blocks of WINO_OCB output
+ * channels, and M[p][oc][tile] is transformed back into the output. Tile
+ * pixels are gathered as d[i][j][tile] first, so both transforms are
+ * contiguous loops over the chunk's tiles. */
+
+#define WINO_MAX_TS       6
+#define WINO_CHUNK_FLOATS (1 << 19) /* V + M per chunk */
+#define WINO_CACHE_SLOTS  64
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#define WINO_VW  16
+#define WINO_OCB 12 /* Output channels per register block */
+#define WINO_NV  2  /* Vectors of tiles per register block */
+typedef __m512 wvec;
+#define WV_ZERO()        _mm512_setzero_ps()
+#define WV_LOAD(p)       _mm512_load_ps(p)
+#define WV_STORE(p, v)   _mm512_store_ps(p, v)
+#define WV_SET1(x)       _mm512_set1_ps(x)
+#define WV_FMA(a, b, c)  _mm512_fmadd_ps(a, b, c)
+#elif defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define WINO_VW  8
+#define WINO_OCB 6
+#define WINO_NV  2
+typedef __m256 wvec;
+#define WV_ZERO()        _mm256_setzero_ps()
+#define WV_LOAD(p)       _mm256_load_ps(p)
+#define WV_STORE(p, v)   _mm256_store_ps(p, v)
+#define WV_SET1(x)       _mm256_set1_ps(x)
+#define WV_FMA(a, b, c)  _mm256_fmadd_ps(a, b, c)
+#else
+#define WINO_VW  1
+#define WINO_OCB 4
+#define WINO_NV  4
+typedef float wvec;
+#define WV_ZERO()        0.0f
+#define WV_LOAD(p)       (*(p))
+#define WV_STORE(p, v)   (*(p) = (v))
+#define WV_SET1(x)       (x)
+#define WV_FMA(a, b, c)  ((a) * (b) + (c))
+#endif
+
+#define WINO_NT (WINO_VW * WINO_NV) /* Tiles per register block */
+
+/* The transform loops touch up to a dozen rows of one buffer; without this
+ * the compiler gives up on the alias checks and stays scalar */
+#if defined(__clang__)
+#define WINO_IVDEP _Pragma("clang loop vectorize(assume_safety)")
+#elif defined(__GNUC__)
+#define WINO_IVDEP _Pragma("GCC ivdep")
+#else
+#define WINO_IVDEP
+#endif
+
+typedef struct {
+    float* data;
+    size_t cap; /* Floats */
+} WinoScratch;
+
+/* Weights packed for an uncached call, the V/M chunk, and a task's tile row */
+static _Thread_local WinoScratch t_weights;
+static _Thread_local WinoScratch t_tiles;
+static _Thread_local WinoScratch t_rows;
+
+static float* scratch_reserve(WinoScratch* s, size_t floats) {
+    if (floats <= s->cap)
+        return s->data;
+    size_t bytes = (floats * sizeof(float) + 63) & ~(size_t)63;
+    float* p     = aligned_alloc(64, bytes);
+    if (!p)
+        return NULL;
+    free(s->data);
+    s->data = p;
+    s->cap  = bytes / sizeof(float);
+    return p;
+}
+
+/* 1-D transforms, strides in floats.
+ * F(2,3): B^T = [1,0,-1,0; 0,1,1,0; 0,-1,1,0; 0,1,0,-1], A^T = [1,1,1,0; 0,1,-1,-1]
+ * F(4,3): B^T, A^T and G as BT_4x4, AT_4x4 and G_4x4 above */
+#define WINO_IN_F23(d, v, ds, vs)                      \
+    do {                                               \
+        float d0 = (d)[0 * (ds)], d1 = (d)[1 * (ds)];  \
+        float d2 = (d)[2 * (ds)], d3 = (d)[3 * (ds)];  \
+        (v)[0 * (vs)] = d0 - d2;                       \
+        (v)[1 * (vs)] = d1 + d2;                       \
+        (v)[2 * (vs)] = d2 - d1;                       \
+        (v)[3 * (vs)] = d1 - d3;                       \
+    } while (0)
+
+#define WINO_IN_F43(d, v, ds, vs)                                         \
+    do {                                                                  \
+        float d0 = (d)[0 * (ds)], d1 = (d)[1 * (ds)], d2 = (d)[2 * (ds)]; \
+        float d3 = (d)[3 * (ds)], d4 = (d)[4 * (ds)], d5 = (d)[5 * (ds)]; \
+        (v)[0 * (vs)] = 4.0f * d0 - 5.0f * d2 + d4;                       \
+        (v)[1 * (vs)] = d3 + d4 - 4.0f * (d1 + d2);                       \
+        (v)[2 * (vs)] = d4 - d3 + 4.0f * (d1 - d2);                       \
+        (v)[3 * (vs)] = d4 - d2 + 2.0f * (d3 - d1);                       \
+        (v)[4 * (vs)] = d4 - d2 + 2.0f * (d1 - d3);                       \
+        (v)[5 * (vs)] = 4.0f * d1 - 5.0f * d3 + d5;                       \
+    } while (0)
+
+#define WINO_OUT_F23(m, y, ms, ys)                       \
+    do {                                                 \
+        float m0 = (m)[0 * (ms)], m1 = (m)[1 * (ms)];    \
+        float m2 = (m)[2 * (ms)], m3 = (m)[3 * (ms)];    \
+        (y)[0 * (ys)] = m0 + m1 + m2;                    \
+        (y)[1 * (ys)] = m1 - m2 - m3;                    \
+    } while (0)
+
+#define WINO_OUT_F43(m, y, ms, ys)                                        \
+    do {                                                                  \
+        float m0 = (m)[0 * (ms)], m1 = (m)[1 * (ms)], m2 = (m)[2 * (ms)]; \
+        float m3 = (m)[3 * (ms)], m4 = (m)[4 * (ms)], m5 = (m)[5 * (ms)]; \
+        float s12 = m1 + m2, d12 = m1 - m2, s34 = m3 + m4, d34 = m3 - m4; \
+        (y)[0 * (ys)] = m0 + s12 + s34;                                   \
+        (y)[1 * (ys)] = d12 + 2.0f * d34;                                 \
+        (y)[2 * (ys)] = s12 + 4.0f * s34;                                 \
+        (y)[3 * (ys)] = d12 + 8.0f * d34 + m5;                            \
+    } while (0)
+
+#define WINO_W_F23(g, u, gs, us)                                          \
+    do {                                                                  \
+        float g0 = (g)[0 * (gs)], g1 = (g)[1 * (gs)], g2 = (g)[2 * (gs)]; \
+        (u)[0 * (us)] = g0;                                               \
+        (u)[1 * (us)] = 0.5f * (g0 + g1 + g2);                            \
+        (u)[2 * (us)] = 0.5f * (g0 - g1 + g2);                            \
+        (u)[3 * (us)] = g2;                                               \
+    } while (0)
+
+#define WINO_W_F43(g, u, gs, us)                                          \
+    do {                                                                  \
+        float g0 = (g)[0 * (gs)], g1 = (g)[1 * (gs)], g2 = (g)[2 * (gs)]; \
+        (u)[0 * (us)] = 0.25f * g0;                                       \
+        (u)[1 * (us)] = -(g0 + g1 + g2) / 6.0f;                           \
+        (u)[2 * (us)] = -(g0 - g1 + g2) / 6.0f;                           \
+        (u)[3 * (us)] = g0 / 24.0f + g1 / 12.0f + g2 / 6.0f;              \
+        (u)[4 * (us)] = g0 / 24.0f - g1 / 12.0f + g2 / 6.0f;              \
+        (u)[5 * (us)] = g2;                                               \
+    } while (0)
+
+/* U = G g G^T, g 3x3 */
+static inline void weight_tile(const float* g, float* U, int ts) {
+    float t[WINO_MAX_TS * 3];
+    if (ts == 4) {
+        for (int j = 0; j < 3; j++)
+            WINO_W_F23(g + j, t + j, 3, 3);
+        for (int i = 0; i < 4; i++)
+            WINO_W_F23(t + i * 3, U + i * 4, 1, 1);
+    } else {
+        for (int j = 0; j < 3; j++)
+            WINO_W_F43(g + j, t + j, 3, 3);
+        for (int i = 0; i < 6; i++)
+            WINO_W_F43(t + i * 3, U + i * 6, 1, 1);
+    }
+}
+
+static int oc_blocks(int ocg) { return (ocg + WINO_OCB - 1) / WINO_OCB; }
+
+size_t winograd_gemm_weight_size(int out_channels, int in_channels_per_group, int groups,
+                                 const WinogradConfig* config) {
+    size_t ocb = (size_t)oc_blocks(out_channels / groups) * WINO_OCB;
+    return (size_t)config->tile_size * config->tile_size * groups * ocb * in_channels_per_group;
+}
+
+/* U[group][p][oc block][ic][WINO_OCB], zero past the last output channel */
+int winograd_transform_weight_gemm(const float* weight, int out_channels,
+                                   int in_channels_per_group, int groups,
+                                   const WinogradConfig* config, float* transformed) {
+    if (!weight || !config || !transformed || groups < 1 || out_channels % groups != 0)
+        return -1;
+    int ts = config->tile_size, icg = in_channels_per_group, ocg = out_channels / groups;
+    size_t tp = (size_t)ts * ts, pstride = (size_t)oc_blocks(ocg) * WINO_OCB * icg;
+    memset(transformed, 0,
+           winograd_gemm_weight_size(out_channels, icg, groups, config) * sizeof(float));
+    float U[WINO_MAX_TS * WINO_MAX_TS];
+    for (int oc = 0; oc < out_channels; oc++) {
+        int o      = oc % ocg;
+        float* dst = transformed + (size_t)(oc / ocg) * tp * pstride +
+                     (size_t)(o / WINO_OCB) * icg * WINO_OCB + o % WINO_OCB;
+        for (int ic = 0; ic < icg; ic++) {
+            weight_tile(weight + ((size_t)oc * icg + ic) * 9, U, ts);
+            for (size_t p = 0; p < tp; p++)
+                dst[p * pstride + (size_t)ic * WINO_OCB] = U[p];
+        }
+    }
+    return 0;
+}
+
+/* Transformed weights keyed by (tensor, version). A version is never reused,
+ * so a weight written in place, or a new tensor at a freed address, misses.
+ * An entry handed out is pinned until winograd_weight_release: pinned
+ * entries are never rebuilt or evicted, a stale one is only detached from
+ * its key. */
+typedef struct {
+    const void* key;
+    uint64_t version;
+    int out_channels, in_channels_per_group, groups;
+    WinogradVariant variant;
+    uint64_t last_use;
+    int pins;
+    float* data;
+    size_t cap; /* Floats */
+} WinoCacheEntry;
+
+static WinoCacheEntry g_wino_cache[WINO_CACHE_SLOTS];
+static uint64_t g_wino_cache_clock;
+static pthread_mutex_t g_wino_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+const float* winograd_weight_cached(const void* key, uint64_t version, const float* weight,
+                                    int out_channels, int in_channels_per_group, int groups,
+                                    const WinogradConfig* config) {
+    if (!key || version == 0 || !weight || !config || groups < 1)
+        return NULL;
+    pthread_mutex_lock(&g_wino_cache_lock);
+    WinoCacheEntry* slot   = NULL;
+    WinoCacheEntry* victim = NULL;
+    for (int i = 0; i < WINO_CACHE_SLOTS; i++) {
+        WinoCacheEntry* e = &g_wino_cache[i];
+        if (e->key == key) {
+            if (e->version == version && e->out_channels == out_channels &&
+                e->in_channels_per_group == in_channels_per_group && e->groups == groups &&
+                e->variant == config->variant) {
+                slot = e;
+                break;
+            }
+            e->key = NULL; /* Stale: reusable once unpinned */
+        }
+        if (e->pins == 0 &&
+            (!victim || (victim->key && (!e->key || e->last_use < victim->last_use))))
+            victim = e;
+    }
+    if (!slot) {
+        slot = victim;
+        if (!slot) { /* Every entry is in use */
+            pthread_mutex_unlock(&g_wino_cache_lock);
+            return NULL;
+        }
+        size_t n = winograd_gemm_weight_size(out_channels, in_channels_per_group, groups, config);
+        if (n > slot->cap) {
+            free(slot->data);
+            slot->data = aligned_alloc(64, (n * sizeof(float) + 63) & ~(size_t)63);
+            slot->cap  = slot->data ? n : 0;
+        }
+        if (!slot->data ||
+            winograd_transform_weight_gemm(weight, out_channels, in_channels_per_group, groups,
+                                           config, slot->data) != 0) {
+            free(slot->data);
+            *slot = (WinoCacheEntry){0};
+            pthread_mutex_unlock(&g_wino_cache_lock);
+            return NULL;
+        }
+        slot->key                   = key;
+        slot->version               = version;
+        slot->out_channels          = out_channels;
+        slot->in_channels_per_group = in_channels_per_group;
+        slot->groups                = groups;
+        slot->variant               = config->variant;
+    }
+    slot->last_use    = ++g_wino_cache_clock;
+    slot->pins++;
+    const float* data = slot->data;
+    pthread_mutex_unlock(&g_wino_cache_lock);
+    return data;
+}
+
+void winograd_weight_release(const float* transformed) {
+    if (!transformed)
+        return;
+    pthread_mutex_lock(&g_wino_cache_lock);
+    for (int i = 0; i < WINO_CACHE_SLOTS; i++) {
+        if (g_wino_cache[i].data == transformed && g_wino_cache[i].pins > 0) {
+            g_wino_cache[i].pins--;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_wino_cache_lock);
+}
+
+typedef struct {
+    const float* input;
+    const float* U; /* This group's packed weights */
+    const float* bias;
+    float* output;
+    float* V; /* V[p][ic][tile] */
+    float* M; /* M[p][oc][tile] */
+    int in_channels, out_channels, H, W, pad_h, pad_w;
+    int out_h, out_w, tiles_h, tiles_w;
+    int ts, ot;
+    int ic0, icg, oc0, ocg; /* The group's channels */
+    int row0, rows;         /* Tile rows in the chunk, counted across images */
+    size_t stride;          /* Floats between channels in V and M, >= rows * tiles_w */
+} WinoChunkArgs;
+
+/* d[i][j][q] = input pixel (i, j) of tile q for the tiles of tile row r,
+ * zero outside the image. prow holds one zero-padded input row. */
+static void gather_tiles(const WinoChunkArgs* a, const float* plane, int r, size_t Q,
+                         float* restrict prow, float* restrict d) {
+    int ts = a->ts, ot = a->ot, tw = a->tiles_w;
+    int th = (a->row0 + r) % a->tiles_h;
+    int wp = (tw - 1) * ot + ts; /* Padded columns the tiles cover */
+    int x0 = a->pad_w, nx = a->W < wp - x0 ? a->W : wp - x0;
+    memset(prow, 0, (size_t)wp * sizeof(float));
+    for (int i = 0; i < ts; i++) {
+        int y = th * ot - a->pad_h + i;
+        if (y >= 0 && y < a->H)
+            memcpy(prow + x0, plane + (size_t)y * a->W, (size_t)nx * sizeof(float));
+        else
+            memset(prow + x0, 0, (size_t)nx * sizeof(float));
+        for (int j = 0; j < ts; j++) {
+            float* dst       = d + ((size_t)i * ts + j) * Q + (size_t)r * tw;
+            const float* src = prow + j;
+            if (ot == 4)
+                for (int t = 0; t < tw; t++)
+                    dst[t] = src[t * 4];
+            else
+                for (int t = 0; t < tw; t++)
+                    dst[t] = src[t * 2];
+        }
+    }
+}
+
+/* One 1-D input transform per q, reading rows in[u * is + q] and writing
+ * out[u * os + q] for u < ts */
+static void input_pass(const float* restrict in, size_t is, float* restrict out, size_t os,
+                       size_t n, int ts) {
+    if (ts == 4) {
+        WINO_IVDEP
+        for (size_t q = 0; q < n; q++)
+            WINO_IN_F23(in + q, out + q, is, os);
+    } else {
+        WINO_IVDEP
+        for (size_t q = 0; q < n; q++)
+            WINO_IN_F43(in + q, out + q, is, os);
+    }
+}
+
+/* One task per input channel of the group: its tiles into V */
+static void wino_input_task(void* data, size_t start, size_t end) {
+    const WinoChunkArgs* a = (const WinoChunkArgs*)data;
+    int ts         = a->ts;
+    size_t Q       = (size_t)a->rows * a->tiles_w;
+    size_t tp      = (size_t)ts * ts;
+    size_t pstride = (size_t)a->icg * a->stride;
+    size_t wp      = (size_t)(a->tiles_w - 1) * a->ot + ts;
+    float* d       = scratch_reserve(&t_rows, 2 * tp * Q + wp);
+    if (!d)
+        return;
+    float* tmp  = d + tp * Q; /* tmp[k][j][q] = B^T down the tile columns */
+    float* prow = tmp + tp * Q;
+    for (size_t c = start; c < end; c++) {
+        float* V = a->V + c * a->stride;
+        for (int r = 0; r < a->rows; r++) {
+            int b = (a->row0 + r) / a->tiles_h;
+            gather_tiles(a, a->input + ((size_t)b * a->in_channels + a->ic0 + c) * a->H * a->W,
+                         r, Q, prow, d);
+        }
+        input_pass(d, ts * Q, tmp, ts * Q, ts * Q, ts);
+        for (int k = 0; k < ts; k++)
+            input_pass(tmp + (size_t)k * ts * Q, Q, V + (size_t)k * ts * pstride, pstride, Q,
+                       ts);
+        /* Keep the padding lanes finite for the GEMM */
+        for (size_t p = 0; p < tp; p++)
+            memset(V + p * pstride + Q, 0, (a->stride - Q) * sizeof(float));
+    }
+}
+
+/* M[p][ob rows] = U[p][ob] V[p], one task per (tile point, oc block) */
+static void wino_gemm_task(void* data, size_t start, size_t end) {
+    const WinoChunkArgs* a = (const WinoChunkArgs*)data;
+    int nob = oc_blocks(a->ocg), icg = a->icg;
+    size_t T = a->stride;
+    for (size_t job = start; job < end; job++) {
+        size_t p = job / nob;
+        int ob   = (int)(job % nob);
+        const float* U = a->U + (p * nob + ob) * icg * WINO_OCB;
+        const float* V = a->V + p * icg * T;
+        float* M       = a->M + (p * a->ocg + (size_t)ob * WINO_OCB) * T;
+        int rows       = a->ocg - ob * WINO_OCB < WINO_OCB ? a->ocg - ob * WINO_OCB : WINO_OCB;
+        for (size_t t = 0; t < T; t += WINO_NT) {
+            wvec acc[WINO_OCB][WINO_NV];
+            for (int o = 0; o < WINO_OCB; o++)
+                for (int v = 0; v < WINO_NV; v++)
+                    acc[o][v] = WV_ZERO();
+            for (int i = 0; i < icg; i++) {
+                const float* vp = V + (size_t)i * T + t;
+                const float* up = U + (size_t)i * WINO_OCB;
+                wvec x[WINO_NV];
+                for (int v = 0; v < WINO_NV; v++)
+                    x[v] = WV_LOAD(vp + v * WINO_VW);
+                for (int o = 0; o < WINO_OCB; o++) {
+                    wvec u = WV_SET1(up[o]);
+                    for (int v = 0; v < WINO_NV; v++)
+                        acc[o][v] = WV_FMA(u, x[v], acc[o][v]);
+                }
+            }
+            for (int o = 0; o < rows; o++)
+                for (int v = 0; v < WINO_NV; v++)
+                    WV_STORE(M + (size_t)o * T + t + v * WINO_VW, acc[o][v]);
+        }
+    }
+}
+
+/* One 1-D output transform per q, reading rows in[u * is + q] for u < ts
+ * and writing out[u * os + q] for u < ts - 2 */
+static void output_pass(const float* restrict in, size_t is, float* restrict out, size_t os,
+                        size_t n, int ts) {
+    if (ts == 4) {
+        WINO_IVDEP
+        for (size_t q = 0; q < n; q++)
+            WINO_OUT_F23(in + q, out + q, is, os);
+    } else {
+        WINO_IVDEP
+        for (size_t q = 0; q < n; q++)
+            WINO_OUT_F43(in + q, out + q, is, os);
+    }
+}
+
+/* One task per output channel of the group: its tiles from M into the output */
+static void wino_output_task(void* data, size_t start, size_t end) {
+    const WinoChunkArgs* a = (const WinoChunkArgs*)data;
+    int ts = a->ts, ot = a->ot, tw = a->tiles_w;
+    size_t Q       = (size_t)a->rows * tw;
+    size_t pstride = (size_t)a->ocg * a->stride;
+    float* tmp     = scratch_reserve(&t_rows, (size_t)(ot * ts + ot * ot) * Q);
+    if (!tmp)
+        return;
+    float* y = tmp + (size_t)ot * ts * Q; /* y[i][j][q], output pixel (i, j) of tile q */
+    for (size_t c = start; c < end; c++) {
+        int oc           = a->oc0 + (int)c;
+        float bias       = a->bias ? a->bias[oc] : 0.0f;
+        const float* src = a->M + c * a->stride;
+        /* tmp[i][l][q] = A^T down the tile columns */
+        for (int l = 0; l < ts; l++)
+            output_pass(src + (size_t)l * pstride, ts * pstride, tmp + (size_t)l * Q, ts * Q, Q,
+                        ts);
+        for (int i = 0; i < ot; i++)
+            output_pass(tmp + (size_t)i * ts * Q, Q, y + (size_t)i * ot * Q, Q, Q, ts);
+        for (int r = 0; r < a->rows; r++) {
+            int b = (a->row0 + r) / a->tiles_h, y0 = (a->row0 + r) % a->tiles_h * ot;
+            float* plane = a->output + ((size_t)b * a->out_channels + oc) * a->out_h * a->out_w;
+            int nrows    = a->out_h - y0 < ot ? a->out_h - y0 : ot;
+            for (int i = 0; i < nrows; i++) {
+                float* dst = plane + (size_t)(y0 + i) * a->out_w;
+                for (int j = 0; j < ot; j++) {
+                    const float* yj = y + ((size_t)i * ot + j) * Q + (size_t)r * tw;
+                    int n           = (a->out_w - j + ot - 1) / ot;
+                    n               = n < tw ? n : tw;
+                    for (int t = 0; t < n; t++)
+                        dst[t * ot + j] = yj[t] + bias;
+                }
+            }
+        }
+    }
+}
+
+static void run_tasks(TaskFunc fn, void* args, size_t n) {
+    ThreadPool* pool = threadpool_get_global();
+    if (pool && n > 1)
+        threadpool_parallel_for(pool, fn, args, n);
+    else
+        fn(args, 0, n);
+}
+
+int winograd_conv2d_gemm(const float* input, const float* weight, const float* transformed,
+                         const float* bias, float* output, int batch, int in_channels,
+                         int out_channels, int height, int width, int padding_h, int padding_w,
+                         int groups, const WinogradConfig* config) {
+    if (!input || (!weight && !transformed) || !output || !config || groups < 1)
+        return -1;
+    if (in_channels % groups != 0 || out_channels % groups != 0)
+        return -1;
+    int ts = config->tile_size, ot = config->output_tile;
+    int out_h = height + 2 * padding_h - 2;
+    int out_w = width + 2 * padding_w - 2;
+    if (out_h <= 0 || out_w <= 0)
+        return -1;
+
+    int icg = in_channels / groups, ocg = out_channels / groups;
+    if (!transformed) {
+        float* U = scratch_reserve(&t_weights,
+                                   winograd_gemm_weight_size(out_channels, icg, groups, config));
+        if (!U || winograd_transform_weight_gemm(weight, out_channels, icg, groups, config, U) != 0)
+            return -1;
+        transformed = U;
+    }
+
+    WinoChunkArgs a = {.input = input, .bias = bias, .output = output,
+                       .in_channels = in_channels, .out_channels = out_channels,
+                       .H = height, .W = width, .pad_h = padding_h, .pad_w = padding_w,
+                       .out_h = out_h, .out_w = out_w,
+                       .tiles_h = (out_h + ot - 1) / ot, .tiles_w = (out_w + ot - 1) / ot,
+                       .ts = ts, .ot = ot, .icg = icg, .ocg = ocg};
+    size_t tp         = (size_t)ts * ts;
+    int total_rows    = batch * a.tiles_h;
+    size_t per_tile   = tp * (icg + (size_t)oc_blocks(ocg) * WINO_OCB);
+    int chunk_rows    = (int)(WINO_CHUNK_FLOATS / per_tile / a.tiles_w);
+    chunk_rows        = chunk_rows < 1 ? 1 : chunk_rows > total_rows ? total_rows : chunk_rows;
+    size_t max_stride = ((size_t)chunk_rows * a.tiles_w + WINO_NT - 1) / WINO_NT * WINO_NT;
+    float* buf        = scratch_reserve(&t_tiles, per_tile * max_stride);
+    if (!buf)
+        return -1;
+
+    size_t nob = (size_t)oc_blocks(ocg);
+    for (int g = 0; g < groups; g++) {
+        a.U   = transformed + (size_t)g * tp * nob * WINO_OCB * icg;
+        a.ic0 = g * icg;
+        a.oc0 = g * ocg;
+        for (int r0 = 0; r0 < total_rows; r0 += chunk_rows) {
+            a.row0   = r0;
+            a.rows   = total_rows - r0 < chunk_rows ? total_rows - r0 : chunk_rows;
+            a.stride = ((size_t)a.rows * a.tiles_w + WINO_NT - 1) / WINO_NT * WINO_NT;
+            a.V      = buf;
+            a.M      = buf + tp * icg * a.stride;
+            run_tasks(wino_input_task, &a, (size_t)icg);
+            run_tasks(wino_gemm_task, &a, tp * nob);
+            run_tasks(wino_output_task, &a, (size_t)ocg);
+        }
+    }
+    return 0;
+}
+
+void winograd_cleanup(void) {
+    WinoScratch* all[] = {&t_weights, &t_tiles, &t_rows};
+    for (size_t i = 0; i < sizeof(all) / sizeof(all[0]); i++) {
+        free(all[i]->data);
+        *all[i] = (WinoScratch){0};
+    }
+    pthread_mutex_lock(&g_wino_cache_lock);
+    for (int i = 0; i < WINO_CACHE_SLOTS; i++) {
+        if (g_wino_cache[i].pins > 0) /* A conv still reads it */
+            continue;
+        free(g_wino_cache[i].data);
+        g_wino_cache[i] = (WinoCacheEntry){0};
+    }
+    pthread_mutex_unlock(&g_wino_cache_lock);
+}
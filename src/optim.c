@@ -7,6 +7,8 @@
 #include "tensor/tensor.h"
 #include "autograd/autograd.h"
 #include "backend/blas.h"
+#include "autograd/amp.h"
+#include "optim/multi_tensor.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -29,6 +31,9 @@ int optimizer_init(Optimizer* optimizer, const char* name, StepFn step, ZeroGrad
     optimizer->lr_scheduler_step_size = 0;
     optimizer->lr_scheduler_gamma     = 1.0f;
     optimizer->training_metrics       = NULL;
+    optimizer->use_flat               = false;
+    optimizer->flat_arena             = NULL;
+    optimizer->grad_scaler            = NULL;
     optimizer->version                = "1.0.0";
     optimizer->description            = "Optimizer";
 
@@ -169,6 +174,10 @@ void optimizer_free(Optimizer* optimizer) {
     extern void cml_untrack_optimizer(Optimizer*);
     cml_untrack_optimizer(optimizer);
 
+    /* Give parameters and state their own buffers before the state goes */
+    cml_flat_arena_free((CMLFlatArena*)optimizer->flat_arena);
+    optimizer->flat_arena = NULL;
+
     if (optimizer->param_groups) {
         for (int i = 0; i < optimizer->num_param_groups; i++) {
             ParameterGroup* group = &optimizer->param_groups[i];
@@ -380,14 +389,46 @@ ParameterGroup* optimizer_get_param_group(Optimizer* optimizer, int index) {
     return &optimizer->param_groups[index];
 }
 
+/* Unscales through grad_scaler_unscale for the per-tensor path; returns true
+ * when the step must be skipped. */
+static bool optimizer_unscale_grads(Optimizer* optimizer) {
+    GradScaler* scaler = optimizer->grad_scaler;
+    if (!scaler)
+        return false;
+    bool found_inf = false;
+    for (int g = 0; g < optimizer->num_param_groups; g++) {
+        ParameterGroup* grp = &optimizer->param_groups[g];
+        grad_scaler_unscale(scaler, grp->parameters, grp->num_parameters);
+        found_inf = found_inf || scaler->found_inf;
+    }
+    scaler->found_inf = found_inf;
+    return found_inf;
+}
+
 void optimizer_step(Optimizer* optimizer) {
     if (!optimizer || !optimizer->step)
         return;
 
+    /* The flat step folds unscaling into its own pass */
+    if (!optimizer->use_flat && optimizer_unscale_grads(optimizer))
+        return;
+
     optimizer->step(optimizer);
+    optimizer_bump_param_versions(optimizer);
     training_metrics_auto_capture_optimizer(optimizer);
 }
 
+void optimizer_bump_param_versions(Optimizer* optimizer) {
+    if (!optimizer)
+        return;
+    for (int g = 0; g < optimizer->num_param_groups; g++) {
+        ParameterGroup* grp = &optimizer->param_groups[g];
+        for (int i = 0; i < grp->num_parameters; i++)
+            if (grp->parameters[i])
+                tensor_bump_version(grp->parameters[i]->tensor);
+    }
+}
+
 void optimizer_set_metrics(Optimizer* optimizer, void* metrics) {
     if (!optimizer) {
         LOG_ERROR("Invalid optimizer");
@@ -597,9 +638,191 @@ static void generic_zero_grad(Optimizer* optimizer) {
     }
 }
 
+/* Allocates Adam/AdamW state on first use, plus the AMSGrad maxima whenever
+ * amsgrad is on (it may be switched on after the first step). */
+static int adam_ensure_state(Optimizer* optimizer, ParameterGroup* group) {
+    if (!group->state) {
+        group->state = optimizer_alloc_state(group, sizeof(AdamState), adam_state_init);
+        if (!group->state)
+            return -1;
+    }
+    if (optimizer->amsgrad) {
+        AdamState** st = (AdamState**)group->state;
+        for (int i = 0; i < group->num_parameters; i++) {
+            if (!st[i] || st[i]->max_exp_avg_sq || !group->parameters[i] ||
+                !group->parameters[i]->tensor)
+                continue;
+            Tensor* t        = group->parameters[i]->tensor;
+            TensorConfig cfg = {.dtype = t->dtype, .device = t->device,
+                                .has_dtype = true, .has_device = true};
+            st[i]->max_exp_avg_sq = optim_zeros(t->shape, t->ndim, &cfg);
+        }
+    }
+    return 0;
+}
+
+static int flat_rule_for(const Optimizer* optimizer, CMLFlatRule* rule) {
+    if (strcmp(optimizer->name, "Adam") == 0)
+        *rule = CML_FLAT_ADAM;
+    else if (strcmp(optimizer->name, "AdamW") == 0)
+        *rule = CML_FLAT_ADAMW;
+    else if (strcmp(optimizer->name, "LAMB") == 0)
+        *rule = CML_FLAT_LAMB;
+    else
+        return -1;
+    return 0;
+}
+
+static int flat_num_state(const Optimizer* optimizer, CMLFlatRule rule) {
+    return (rule != CML_FLAT_LAMB && optimizer->amsgrad) ? 3 : 2;
+}
+
+static int flat_count_params(const Optimizer* optimizer) {
+    int n = 0;
+    for (int g = 0; g < optimizer->num_param_groups; g++) {
+        ParameterGroup* grp = &optimizer->param_groups[g];
+        for (int i = 0; i < grp->num_parameters; i++) {
+            Parameter* p = grp->parameters[i];
+            if (p && p->tensor && p->requires_grad) n++;
+        }
+    }
+    return n;
+}
+
+/* (Re)packs every trainable parameter and its state into a new arena */
+static int optimizer_flat_pack(Optimizer* optimizer, CMLFlatRule rule) {
+    cml_flat_arena_free((CMLFlatArena*)optimizer->flat_arena);
+    optimizer->flat_arena = NULL;
+
+    int count = flat_count_params(optimizer);
+    if (count == 0)
+        return -1;
+    CMLFlatEntry* entries = calloc((size_t)count, sizeof(CMLFlatEntry));
+    if (!entries)
+        return -1;
+
+    int n = 0;
+    for (int g = 0; g < optimizer->num_param_groups; g++) {
+        ParameterGroup* grp = &optimizer->param_groups[g];
+        if (rule == CML_FLAT_LAMB) {
+            if (!grp->state)
+                grp->state = optimizer_alloc_state(grp, sizeof(LAMBState), lamb_state_init);
+        } else if (adam_ensure_state(optimizer, grp) != 0) {
+            grp->state = NULL;
+        }
+        if (!grp->state)
+            break;
+
+        for (int i = 0; i < grp->num_parameters; i++) {
+            Parameter* p = grp->parameters[i];
+            if (!p || !p->tensor || !p->requires_grad) continue;
+            CMLFlatEntry* e = &entries[n++];
+            e->param        = p->tensor;
+            e->group        = g;
+            if (rule == CML_FLAT_LAMB) {
+                LAMBState* st = ((LAMBState**)grp->state)[i];
+                e->state[0]   = st ? st->exp_avg : NULL;
+                e->state[1]   = st ? st->exp_avg_sq : NULL;
+            } else {
+                AdamState* st = ((AdamState**)grp->state)[i];
+                e->state[0]   = st ? st->exp_avg : NULL;
+                e->state[1]   = st ? st->exp_avg_sq : NULL;
+                e->state[2]   = st ? st->max_exp_avg_sq : NULL;
+            }
+        }
+    }
+
+    CMLFlatArena* arena = n == count
+                              ? cml_flat_arena_create(entries, n, flat_num_state(optimizer, rule))
+                              : NULL;
+    free(entries);
+    optimizer->flat_arena = arena;
+    return arena ? 0 : -1;
+}
+
+/* Returns 0 when the step was handled here (taken or skipped on inf/nan) and
+ * -1 when the caller should fall back to the per-tensor loop. */
+static int optimizer_flat_step(Optimizer* optimizer) {
+    CMLFlatRule rule;
+    if (!optimizer->use_flat || flat_rule_for(optimizer, &rule) != 0)
+        return -1;
+
+    CMLFlatArena* arena = (CMLFlatArena*)optimizer->flat_arena;
+    if (!arena || cml_flat_arena_num_entries(arena) != flat_count_params(optimizer) ||
+        cml_flat_arena_num_state(arena) != flat_num_state(optimizer, rule)) {
+        if (optimizer_flat_pack(optimizer, rule) != 0) {
+            LOG_WARNING("%s: parameters cannot be packed, using the per-tensor step",
+                        optimizer->name);
+            optimizer->use_flat = false;
+            return optimizer_unscale_grads(optimizer) ? 0 : -1;
+        }
+        arena = (CMLFlatArena*)optimizer->flat_arena;
+    }
+
+    CMLFlatHyper* hyper = malloc((size_t)optimizer->num_param_groups * sizeof(CMLFlatHyper));
+    if (!hyper)
+        return optimizer_unscale_grads(optimizer) ? 0 : -1;
+    for (int g = 0; g < optimizer->num_param_groups; g++) {
+        ParameterGroup* grp = &optimizer->param_groups[g];
+        hyper[g] = (CMLFlatHyper){grp->lr, grp->beta1, grp->beta2, grp->epsilon,
+                                  grp->weight_decay, grp->step_count + 1};
+    }
+
+    CMLFlatStepArgs args = {
+        .grad_scale = optimizer->grad_scaler ? 1.0f / optimizer->grad_scaler->scale_factor : 0.0f,
+        .clip_norm  = optimizer->grad_clip_norm,
+        .amsgrad    = optimizer->amsgrad,
+    };
+    int rc = cml_flat_arena_step(arena, rule, hyper, &args);
+    free(hyper);
+    if (rc != 0)
+        return optimizer_unscale_grads(optimizer) ? 0 : -1;
+
+    if (optimizer->grad_scaler)
+        optimizer->grad_scaler->found_inf = args.found_inf;
+    if (args.found_inf) {
+        LOG_WARNING("GradScaler: inf/nan detected in gradients, skipping optimizer step");
+        return 0;
+    }
+    for (int g = 0; g < optimizer->num_param_groups; g++)
+        optimizer->param_groups[g].step_count++;
+    return 0;
+}
+
+int optimizer_set_flat(Optimizer* optimizer, bool enable) {
+    if (!optimizer)
+        return -1;
+    if (!enable) {
+        cml_flat_arena_free((CMLFlatArena*)optimizer->flat_arena);
+        optimizer->flat_arena = NULL;
+        optimizer->use_flat   = false;
+        return 0;
+    }
+
+    CMLFlatRule rule;
+    if (flat_rule_for(optimizer, &rule) != 0) {
+        LOG_ERROR("Flat multi-tensor step is not available for %s", optimizer->name);
+        return -1;
+    }
+    if (optimizer_flat_pack(optimizer, rule) != 0) {
+        LOG_ERROR("%s: parameters cannot be packed into a flat arena", optimizer->name);
+        return -1;
+    }
+    optimizer->use_flat = true;
+    return 0;
+}
+
+void optimizer_set_grad_scaler(Optimizer* optimizer, GradScaler* scaler) {
+    if (optimizer) {
+        optimizer->grad_scaler = scaler;
+    }
+}
+
 static void adam_step(Optimizer* optimizer) {
     if (!optimizer)
         return;
+    if (optimizer_flat_step(optimizer) == 0)
+        return;
 
     /* Gradient clipping: compute global L2 norm, then scale all grads down */
     if (optimizer->grad_clip_norm > 0.0f) {
@@ -644,22 +867,9 @@ static void adam_step(Optimizer* optimizer) {
         float beta2           = group->beta2;
         float epsilon         = group->epsilon;
 
-        if (!group->state) {
-            group->state = optimizer_alloc_state(group, sizeof(AdamState), adam_state_init);
-            if (!group->state) {
-                LOG_ERROR("Failed to allocate Adam state");
-                continue;
-            }
-            if (optimizer->amsgrad) {
-                AdamState** st = (AdamState**)group->state;
-                for (int i = 0; i < group->num_parameters; i++) {
-                    if (!st[i] || !group->parameters[i] || !group->parameters[i]->tensor) continue;
-                    Tensor* t = group->parameters[i]->tensor;
-                    TensorConfig cfg = {.dtype = t->dtype, .device = t->device,
-                                        .has_dtype = true, .has_device = true};
-                    st[i]->max_exp_avg_sq = optim_zeros(t->shape, t->ndim, &cfg);
-                }
-            }
+        if (adam_ensure_state(optimizer, group) != 0) {
+            LOG_ERROR("Failed to allocate Adam state");
+            continue;
         }
 
         AdamState** states = (AdamState**)group->state;
@@ -831,6 +1041,8 @@ static void adagrad_step(Optimizer* optimizer) {
 static void adamw_step(Optimizer* optimizer) {
     if (!optimizer)
         return;
+    if (optimizer_flat_step(optimizer) == 0)
+        return;
 
     for (int g_idx = 0; g_idx < optimizer->num_param_groups; g_idx++) {
         ParameterGroup* group = &optimizer->param_groups[g_idx];
@@ -840,22 +1052,9 @@ static void adamw_step(Optimizer* optimizer) {
         float beta2           = group->beta2;
         float epsilon         = group->epsilon;
 
-        if (!group->state) {
-            group->state = optimizer_alloc_state(group, sizeof(AdamState), adam_state_init);
-            if (!group->state) {
-                LOG_ERROR("Failed to allocate AdamW state");
-                continue;
-            }
-            if (optimizer->amsgrad) {
-                AdamState** st = (AdamState**)group->state;
-                for (int i = 0; i < group->num_parameters; i++) {
-                    if (!st[i] || !group->parameters[i] || !group->parameters[i]->tensor) continue;
-                    Tensor* t = group->parameters[i]->tensor;
-                    TensorConfig cfg = {.dtype = t->dtype, .device = t->device,
-                                        .has_dtype = true, .has_device = true};
-                    st[i]->max_exp_avg_sq = optim_zeros(t->shape, t->ndim, &cfg);
-                }
-            }
+        if (adam_ensure_state(optimizer, group) != 0) {
+            LOG_ERROR("Failed to allocate AdamW state");
+            continue;
         }
 
         AdamState** states = (AdamState**)group->state;
@@ -1127,6 +1326,8 @@ Optimizer* optim_adam_for_model(Module* model, float lr, float weight_decay, flo
 static void lamb_step(Optimizer* optimizer) {
     if (!optimizer)
         return;
+    if (optimizer_flat_step(optimizer) == 0)
+        return;
 
     for (int g_idx = 0; g_idx < optimizer->num_param_groups; g_idx++) {
         ParameterGroup* group = &optimizer->param_groups[g_idx];
@@ -0,0 +1,579 @@
+#include "optim/multi_tensor.h"
+#include "alloc/buffer_cache.h"
+#include "backend/threadpool.h"
+#include "core/logging.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define CML_FLAT_AVX2 1
+#endif
+
+#define FLAT_ALIGN 16    /* Floats per 64-byte line; every tensor starts on one */
+#define FLAT_PIECE 32768 /* Elements per task in a sweep */
+
+typedef struct {
+    Tensor* param;
+    Tensor* state[CML_FLAT_MAX_STATE];
+    size_t offset;
+    size_t numel;
+    size_t padded; /* numel rounded up to FLAT_ALIGN; the tail stays zero */
+    int group;
+    bool active;   /* Had a gradient this step */
+} FlatSlot;
+
+/* A contiguous range of the arena; slot is -1 when it spans several tensors */
+typedef struct {
+    size_t lo;
+    size_t hi;
+    int slot;
+    int group;
+} FlatPiece;
+
+struct CMLFlatArena {
+    FlatSlot* slots;
+    int num_slots;
+    int num_state;
+    int num_groups;
+    size_t total;
+
+    float* params;
+    float* grads;
+    float* state[CML_FLAT_MAX_STATE];
+
+    /* Per-step scratch, grown on demand */
+    FlatPiece* pieces;
+    int num_pieces;
+    int cap_pieces;
+    double* partial; /* Two sums per piece */
+    float* trust;    /* LAMB ratio per slot */
+};
+
+static float* flat_alloc(size_t n) {
+    size_t bytes = (n * sizeof(float) + 63) & ~(size_t)63;
+    float* p     = aligned_alloc(64, bytes > 0 ? bytes : 64);
+    if (p) memset(p, 0, bytes);
+    return p;
+}
+
+static bool flat_packable(Tensor* t, size_t numel) {
+    if (!t || t->dtype != DTYPE_FLOAT32 || t->numel != numel || t->buffer_handle) return false;
+    if (t->device != DEVICE_CPU && t->device != DEVICE_AUTO) return false;
+    if (!t->is_contiguous || t->storage_offset != 0) return false;
+    return tensor_data_ptr(t) != NULL;
+}
+
+/* Copies t into slot and points t at it, releasing what t owned */
+static void flat_adopt(Tensor* t, float* slot) {
+    memcpy(slot, t->data, t->numel * sizeof(float));
+    if (t->owns_data) {
+        if (t->from_buffer_cache)
+            cml_buffer_cache_free(t->data, t->numel * sizeof(float));
+        else
+            free(t->data);
+    }
+    t->data              = slot;
+    t->owns_data         = false;
+    t->from_buffer_cache = false;
+}
+
+static void flat_release(Tensor* t, const float* slot) {
+    if (!t || t->data != slot) return;
+    float* own = malloc((t->numel ? t->numel : 1) * sizeof(float));
+    if (own) {
+        memcpy(own, slot, t->numel * sizeof(float));
+    } else {
+        LOG_ERROR("Flat optimizer: out of memory unpacking a %zu-element tensor", t->numel);
+    }
+    t->data      = own;
+    t->owns_data = own != NULL;
+}
+
+CMLFlatArena* cml_flat_arena_create(const CMLFlatEntry* entries, int num_entries, int num_state) {
+    if (!entries || num_entries <= 0 || num_state < 0 || num_state > CML_FLAT_MAX_STATE)
+        return NULL;
+
+    CMLFlatArena* a = calloc(1, sizeof(CMLFlatArena));
+    if (!a) return NULL;
+    a->slots     = calloc((size_t)num_entries, sizeof(FlatSlot));
+    a->trust     = calloc((size_t)num_entries, sizeof(float));
+    a->num_slots = num_entries;
+    a->num_state = num_state;
+    if (!a->slots || !a->trust) goto fail;
+
+    /* Validate everything before touching any tensor */
+    for (int i = 0; i < num_entries; i++) {
+        const CMLFlatEntry* e = &entries[i];
+        FlatSlot* s           = &a->slots[i];
+        if (!e->param || e->group < 0 || !flat_packable(e->param, e->param->numel)) goto fail;
+        for (int k = 0; k < num_state; k++) {
+            if (!flat_packable(e->state[k], e->param->numel)) goto fail;
+            s->state[k] = e->state[k];
+        }
+        s->param  = e->param;
+        s->numel  = e->param->numel;
+        s->padded = (s->numel + FLAT_ALIGN - 1) / FLAT_ALIGN * FLAT_ALIGN;
+        s->offset = a->total;
+        s->group  = e->group;
+        a->total += s->padded;
+        if (e->group + 1 > a->num_groups) a->num_groups = e->group + 1;
+    }
+
+    a->params = flat_alloc(a->total);
+    a->grads  = flat_alloc(a->total);
+    if (!a->params || !a->grads) goto fail;
+    for (int k = 0; k < num_state; k++) {
+        if (!(a->state[k] = flat_alloc(a->total))) goto fail;
+    }
+
+    for (int i = 0; i < num_entries; i++) {
+        FlatSlot* s = &a->slots[i];
+        flat_adopt(s->param, a->params + s->offset);
+        for (int k = 0; k < num_state; k++)
+            flat_adopt(s->state[k], a->state[k] + s->offset);
+        Tensor* g = s->param->grad;
+        if (g && flat_packable(g, s->numel))
+            flat_adopt(g, a->grads + s->offset);
+    }
+
+    LOG_DEBUG("Flat optimizer: packed %d tensors, %zu floats x %d arenas", num_entries, a->total,
+              2 + num_state);
+    return a;
+
+fail:
+    free(a->slots);
+    free(a->trust);
+    free(a->params);
+    free(a->grads);
+    for (int k = 0; k < CML_FLAT_MAX_STATE; k++)
+        free(a->state[k]);
+    free(a);
+    return NULL;
+}
+
+void cml_flat_arena_free(CMLFlatArena* a) {
+    if (!a) return;
+    for (int i = 0; i < a->num_slots; i++) {
+        FlatSlot* s = &a->slots[i];
+        flat_release(s->param, a->params + s->offset);
+        if (s->param) flat_release(s->param->grad, a->grads + s->offset);
+        for (int k = 0; k < a->num_state; k++)
+            flat_release(s->state[k], a->state[k] + s->offset);
+    }
+    free(a->slots);
+    free(a->trust);
+    free(a->pieces);
+    free(a->partial);
+    free(a->params);
+    free(a->grads);
+    for (int k = 0; k < CML_FLAT_MAX_STATE; k++)
+        free(a->state[k]);
+    free(a);
+}
+
+int cml_flat_arena_num_entries(const CMLFlatArena* a) { return a ? a->num_slots : 0; }
+int cml_flat_arena_num_state(const CMLFlatArena* a) { return a ? a->num_state : 0; }
+
+/* Re-homes anything replaced since the last step and marks who has a gradient */
+static void flat_sync(CMLFlatArena* a) {
+    for (int i = 0; i < a->num_slots; i++) {
+        FlatSlot* s  = &a->slots[i];
+        float* pslot = a->params + s->offset;
+        if (s->param->data != pslot && flat_packable(s->param, s->numel))
+            flat_adopt(s->param, pslot);
+        for (int k = 0; k < a->num_state; k++) {
+            float* sslot = a->state[k] + s->offset;
+            if (s->state[k]->data != sslot && flat_packable(s->state[k], s->numel))
+                flat_adopt(s->state[k], sslot);
+        }
+
+        Tensor* g   = s->param->grad;
+        float* gslot = a->grads + s->offset;
+        if (g && g->data != gslot && flat_packable(g, s->numel))
+            flat_adopt(g, gslot);
+        s->active = s->param->requires_grad && s->param->data == pslot && g &&
+                    g->data == gslot;
+    }
+}
+
+static int flat_push_piece(CMLFlatArena* a, size_t lo, size_t hi, int slot, int group) {
+    if (a->num_pieces == a->cap_pieces) {
+        int cap          = a->cap_pieces ? a->cap_pieces * 2 : 64;
+        FlatPiece* p     = realloc(a->pieces, (size_t)cap * sizeof(FlatPiece));
+        double* partial  = p ? realloc(a->partial, (size_t)cap * 2 * sizeof(double)) : NULL;
+        if (p) a->pieces = p;
+        if (!p || !partial) return -1;
+        a->partial    = partial;
+        a->cap_pieces = cap;
+    }
+    a->pieces[a->num_pieces++] = (FlatPiece){lo, hi, slot, group};
+    return 0;
+}
+
+/* Splits [lo, hi) into line-aligned pieces of at most FLAT_PIECE */
+static int flat_push_range(CMLFlatArena* a, size_t lo, size_t hi, int slot, int group) {
+    for (size_t p = lo; p < hi; p += FLAT_PIECE) {
+        if (flat_push_piece(a, p, p + FLAT_PIECE < hi ? p + FLAT_PIECE : hi, slot, group) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+/* Elementwise rules run over merged runs of active tensors (padding is zero
+ * and stays zero); LAMB needs per-tensor norms, so its pieces stay inside one
+ * tensor. */
+static int flat_build_pieces(CMLFlatArena* a, bool per_tensor) {
+    a->num_pieces = 0;
+    for (int i = 0; i < a->num_slots;) {
+        FlatSlot* s = &a->slots[i];
+        if (!s->active) {
+            i++;
+            continue;
+        }
+        if (per_tensor) {
+            if (flat_push_range(a, s->offset, s->offset + s->numel, i, s->group) != 0) return -1;
+            i++;
+            continue;
+        }
+        int j = i + 1;
+        while (j < a->num_slots && a->slots[j].active && a->slots[j].group == s->group)
+            j++;
+        const FlatSlot* last = &a->slots[j - 1];
+        if (flat_push_range(a, s->offset, last->offset + last->padded, -1, s->group) != 0)
+            return -1;
+        i = j;
+    }
+    return 0;
+}
+
+typedef struct {
+    float lr, b1, b2, eps, wd;
+    float lr_t;    /* Adam: lr * sqrt(bc2) / bc1 */
+    float bc1, bc2;
+    float gs;      /* Unscale times clip coefficient */
+} FlatCoeff;
+
+typedef struct {
+    CMLFlatArena* a;
+    CMLFlatRule rule;
+    const FlatCoeff* coeff;
+    bool amsgrad;
+} FlatSweep;
+
+#ifdef CML_FLAT_AVX2
+static inline double hsum_pd(__m256d v) {
+    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+static inline void acc_sq_pd(__m256 x, __m256d* acc0, __m256d* acc1) {
+    __m256d lo = _mm256_cvtps_pd(_mm256_castps256_ps128(x));
+    __m256d hi = _mm256_cvtps_pd(_mm256_extractf128_ps(x, 1));
+    *acc0      = _mm256_fmadd_pd(lo, lo, *acc0);
+    *acc1      = _mm256_fmadd_pd(hi, hi, *acc1);
+}
+#endif
+
+static double sum_sq(const float* x, size_t n) {
+    size_t j  = 0;
+    double sum = 0.0;
+#ifdef CML_FLAT_AVX2
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    for (; j + 8 <= n; j += 8)
+        acc_sq_pd(_mm256_loadu_ps(x + j), &acc0, &acc1);
+    sum = hsum_pd(_mm256_add_pd(acc0, acc1));
+#endif
+    for (; j < n; j++)
+        sum += (double)x[j] * x[j];
+    return sum;
+}
+
+static void adam_range(float* p, const float* g, float* m, float* v, float* vmax, size_t n,
+                       const FlatCoeff* c) {
+    size_t j = 0;
+#ifdef CML_FLAT_AVX2
+    const __m256 gs = _mm256_set1_ps(c->gs), wd = _mm256_set1_ps(c->wd);
+    const __m256 b1 = _mm256_set1_ps(c->b1), nb1 = _mm256_set1_ps(1.0f - c->b1);
+    const __m256 b2 = _mm256_set1_ps(c->b2), nb2 = _mm256_set1_ps(1.0f - c->b2);
+    const __m256 eps = _mm256_set1_ps(c->eps), lr_t = _mm256_set1_ps(c->lr_t);
+    for (; j + 8 <= n; j += 8) {
+        __m256 pj = _mm256_loadu_ps(p + j);
+        __m256 gj = _mm256_fmadd_ps(wd, pj, _mm256_mul_ps(gs, _mm256_loadu_ps(g + j)));
+        __m256 mj = _mm256_fmadd_ps(b1, _mm256_loadu_ps(m + j), _mm256_mul_ps(nb1, gj));
+        __m256 vj = _mm256_fmadd_ps(b2, _mm256_loadu_ps(v + j),
+                                    _mm256_mul_ps(nb2, _mm256_mul_ps(gj, gj)));
+        _mm256_storeu_ps(m + j, mj);
+        _mm256_storeu_ps(v + j, vj);
+        if (vmax) {
+            vj = _mm256_max_ps(_mm256_loadu_ps(vmax + j), vj);
+            _mm256_storeu_ps(vmax + j, vj);
+        }
+        __m256 denom = _mm256_add_ps(_mm256_sqrt_ps(vj), eps);
+        _mm256_storeu_ps(p + j, _mm256_sub_ps(pj, _mm256_div_ps(_mm256_mul_ps(lr_t, mj), denom)));
+    }
+#endif
+    for (; j < n; j++) {
+        float gj = c->gs * g[j] + c->wd * p[j];
+        m[j]     = c->b1 * m[j] + (1.0f - c->b1) * gj;
+        v[j]     = c->b2 * v[j] + (1.0f - c->b2) * gj * gj;
+        float vj = v[j];
+        if (vmax) vj = vmax[j] = fmaxf(vmax[j], vj);
+        p[j] -= c->lr_t * m[j] / (sqrtf(vj) + c->eps);
+    }
+}
+
+static void adamw_range(float* p, const float* g, float* m, float* v, float* vmax, size_t n,
+                        const FlatCoeff* c) {
+    const float decay = 1.0f - c->lr * c->wd;
+    size_t j          = 0;
+#ifdef CML_FLAT_AVX2
+    const __m256 gs = _mm256_set1_ps(c->gs), dk = _mm256_set1_ps(decay);
+    const __m256 b1 = _mm256_set1_ps(c->b1), nb1 = _mm256_set1_ps(1.0f - c->b1);
+    const __m256 b2 = _mm256_set1_ps(c->b2), nb2 = _mm256_set1_ps(1.0f - c->b2);
+    const __m256 ibc1 = _mm256_set1_ps(1.0f / c->bc1), ibc2 = _mm256_set1_ps(1.0f / c->bc2);
+    const __m256 eps = _mm256_set1_ps(c->eps), lr = _mm256_set1_ps(c->lr);
+    for (; j + 8 <= n; j += 8) {
+        __m256 pj = _mm256_mul_ps(dk, _mm256_loadu_ps(p + j));
+        __m256 gj = _mm256_mul_ps(gs, _mm256_loadu_ps(g + j));
+        __m256 mj = _mm256_fmadd_ps(b1, _mm256_loadu_ps(m + j), _mm256_mul_ps(nb1, gj));
+        __m256 vj = _mm256_fmadd_ps(b2, _mm256_loadu_ps(v + j),
+                                    _mm256_mul_ps(nb2, _mm256_mul_ps(gj, gj)));
+        _mm256_storeu_ps(m + j, mj);
+        _mm256_storeu_ps(v + j, vj);
+        __m256 vh = _mm256_mul_ps(vj, ibc2);
+        if (vmax) {
+            vh = _mm256_max_ps(_mm256_loadu_ps(vmax + j), vh);
+            _mm256_storeu_ps(vmax + j, vh);
+        }
+        __m256 step = _mm256_div_ps(_mm256_mul_ps(lr, _mm256_mul_ps(mj, ibc1)),
+                                    _mm256_add_ps(_mm256_sqrt_ps(vh), eps));
+        _mm256_storeu_ps(p + j, _mm256_sub_ps(pj, step));
+    }
+#endif
+    for (; j < n; j++) {
+        float gj = c->gs * g[j];
+        p[j] *= decay;
+        m[j]     = c->b1 * m[j] + (1.0f - c->b1) * gj;
+        v[j]     = c->b2 * v[j] + (1.0f - c->b2) * gj * gj;
+        float vh = v[j] / c->bc2;
+        if (vmax) vh = vmax[j] = fmaxf(vmax[j], vh);
+        p[j] -= c->lr * (m[j] / c->bc1) / (sqrtf(vh) + c->eps);
+    }
+}
+
+/* LAMB, first half: moments, the raw update (left in g) and both norms */
+static void lamb_moments(const float* p, float* g, float* m, float* v, size_t n,
+                         const FlatCoeff* c, double* pn_out, double* un_out) {
+    size_t j  = 0;
+    double pn = 0.0, un = 0.0;
+#ifdef CML_FLAT_AVX2
+    const __m256 gs = _mm256_set1_ps(c->gs), wd = _mm256_set1_ps(c->wd);
+    const __m256 b1 = _mm256_set1_ps(c->b1), nb1 = _mm256_set1_ps(1.0f - c->b1);
+    const __m256 b2 = _mm256_set1_ps(c->b2), nb2 = _mm256_set1_ps(1.0f - c->b2);
+    const __m256 ibc1 = _mm256_set1_ps(1.0f / c->bc1), ibc2 = _mm256_set1_ps(1.0f / c->bc2);
+    const __m256 eps = _mm256_set1_ps(c->eps);
+    __m256d p0 = _mm256_setzero_pd(), p1 = _mm256_setzero_pd();
+    __m256d u0 = _mm256_setzero_pd(), u1 = _mm256_setzero_pd();
+    for (; j + 8 <= n; j += 8) {
+        __m256 pj = _mm256_loadu_ps(p + j);
+        __m256 gj = _mm256_mul_ps(gs, _mm256_loadu_ps(g + j));
+        __m256 mj = _mm256_fmadd_ps(b1, _mm256_loadu_ps(m + j), _mm256_mul_ps(nb1, gj));
+        __m256 vj = _mm256_fmadd_ps(b2, _mm256_loadu_ps(v + j),
+                                    _mm256_mul_ps(nb2, _mm256_mul_ps(gj, gj)));
+        _mm256_storeu_ps(m + j, mj);
+        _mm256_storeu_ps(v + j, vj);
+        __m256 u = _mm256_div_ps(_mm256_mul_ps(mj, ibc1),
+                                 _mm256_add_ps(_mm256_sqrt_ps(_mm256_mul_ps(vj, ibc2)), eps));
+        u        = _mm256_fmadd_ps(wd, pj, u);
+        _mm256_storeu_ps(g + j, u);
+        acc_sq_pd(pj, &p0, &p1);
+        acc_sq_pd(u, &u0, &u1);
+    }
+    pn = hsum_pd(_mm256_add_pd(p0, p1));
+    un = hsum_pd(_mm256_add_pd(u0, u1));
+#endif
+    for (; j < n; j++) {
+        float gj = c->gs * g[j];
+        m[j]     = c->b1 * m[j] + (1.0f - c->b1) * gj;
+        v[j]     = c->b2 * v[j] + (1.0f - c->b2) * gj * gj;
+        float u  = (m[j] / c->bc1) / (sqrtf(v[j] / c->bc2) + c->eps) + c->wd * p[j];
+        g[j]     = u;
+        pn += (double)p[j] * p[j];
+        un += (double)u * u;
+    }
+    *pn_out = pn;
+    *un_out = un;
+}
+
+static void lamb_apply(float* p, const float* u, size_t n, float scale) {
+    size_t j = 0;
+#ifdef CML_FLAT_AVX2
+    const __m256 s = _mm256_set1_ps(scale);
+    for (; j + 8 <= n; j += 8)
+        _mm256_storeu_ps(p + j, _mm256_fnmadd_ps(s, _mm256_loadu_ps(u + j), _mm256_loadu_ps(p + j)));
+#endif
+    for (; j < n; j++)
+        p[j] -= scale * u[j];
+}
+
+static void flat_norm_task(void* data, size_t start, size_t end) {
+    CMLFlatArena* a = (CMLFlatArena*)data;
+    for (size_t i = start; i < end; i++) {
+        const FlatPiece* pc = &a->pieces[i];
+        a->partial[2 * i]   = sum_sq(a->grads + pc->lo, pc->hi - pc->lo);
+    }
+}
+
+static void flat_update_task(void* data, size_t start, size_t end) {
+    const FlatSweep* sw = (const FlatSweep*)data;
+    CMLFlatArena* a     = sw->a;
+    for (size_t i = start; i < end; i++) {
+        const FlatPiece* pc = &a->pieces[i];
+        const FlatCoeff* c  = &sw->coeff[pc->group];
+        size_t lo = pc->lo, n = pc->hi - pc->lo;
+        float* vmax = sw->amsgrad && a->num_state > 2 ? a->state[2] + lo : NULL;
+        switch (sw->rule) {
+        case CML_FLAT_ADAM:
+            adam_range(a->params + lo, a->grads + lo, a->state[0] + lo, a->state[1] + lo, vmax, n,
+                       c);
+            break;
+        case CML_FLAT_ADAMW:
+            adamw_range(a->params + lo, a->grads + lo, a->state[0] + lo, a->state[1] + lo, vmax, n,
+                        c);
+            break;
+        case CML_FLAT_LAMB:
+            lamb_moments(a->params + lo, a->grads + lo, a->state[0] + lo, a->state[1] + lo, n, c,
+                         &a->partial[2 * i], &a->partial[2 * i + 1]);
+            break;
+        }
+    }
+}
+
+static void flat_lamb_apply_task(void* data, size_t start, size_t end) {
+    const FlatSweep* sw = (const FlatSweep*)data;
+    CMLFlatArena* a     = sw->a;
+    for (size_t i = start; i < end; i++) {
+        const FlatPiece* pc = &a->pieces[i];
+        float scale         = sw->coeff[pc->group].lr * a->trust[pc->slot];
+        lamb_apply(a->params + pc->lo, a->grads + pc->lo, pc->hi - pc->lo, scale);
+    }
+}
+
+static void flat_coeff(const CMLFlatHyper* h, float gs, FlatCoeff* c) {
+    c->lr   = h->lr;
+    c->b1   = h->beta1;
+    c->b2   = h->beta2;
+    c->eps  = h->eps;
+    c->wd   = h->weight_decay;
+    c->bc1  = 1.0f - powf(h->beta1, (float)h->step);
+    c->bc2  = 1.0f - powf(h->beta2, (float)h->step);
+    c->lr_t = h->lr * sqrtf(c->bc2) / c->bc1;
+    c->gs   = gs;
+}
+
+int cml_flat_arena_step(CMLFlatArena* a, CMLFlatRule rule, const CMLFlatHyper* hyper,
+                        CMLFlatStepArgs* args) {
+    if (!a || !hyper || !args) return -1;
+    if (a->num_state < 2) return -1; /* Every rule needs both moments */
+    args->found_inf = false;
+    args->grad_norm = 0.0f;
+
+    flat_sync(a);
+
+    float unscale = args->grad_scale > 0.0f ? args->grad_scale : 1.0f;
+    float gs      = unscale;
+
+    /* Pass 1: global norm of the unscaled gradients, which also catches inf/nan */
+    if (args->clip_norm > 0.0f || args->grad_scale > 0.0f) {
+        if (flat_build_pieces(a, false) != 0) return -1;
+        threadpool_parallel_for_grain(NULL, flat_norm_task, a, (size_t)a->num_pieces, 1);
+        double total = 0.0;
+        for (int i = 0; i < a->num_pieces; i++)
+            total += a->partial[2 * i];
+        double norm     = sqrt(total) * unscale;
+        args->grad_norm = (float)norm;
+        if (!isfinite(norm)) {
+            if (args->grad_scale > 0.0f) {
+                args->found_inf = true;
+                return 0;
+            }
+        } else if (args->clip_norm > 0.0f && norm > args->clip_norm) {
+            gs *= args->clip_norm / ((float)norm + 1e-6f);
+        }
+    }
+
+    FlatCoeff* coeff = malloc((size_t)a->num_groups * sizeof(FlatCoeff));
+    if (!coeff) return -1;
+    for (int g = 0; g < a->num_groups; g++)
+        flat_coeff(&hyper[g], gs, &coeff[g]);
+
+    /* Pass 2: the update */
+    int rc = flat_build_pieces(a, rule == CML_FLAT_LAMB);
+    FlatSweep sw = {a, rule, coeff, args->amsgrad};
+    if (rc == 0)
+        threadpool_parallel_for_grain(NULL, flat_update_task, &sw, (size_t)a->num_pieces, 1);
+
+    if (rc == 0 && rule == CML_FLAT_LAMB) {
+        /* Per-tensor trust ratios, then the scaled step */
+        for (int s = 0; s < a->num_slots; s++)
+            a->trust[s] = 0.0f;
+        double* pn = calloc((size_t)a->num_slots * 2, sizeof(double));
+        if (!pn) {
+            free(coeff);
+            return -1;
+        }
+        for (int i = 0; i < a->num_pieces; i++) {
+            pn[2 * a->pieces[i].slot] += a->partial[2 * i];
+            pn[2 * a->pieces[i].slot + 1] += a->partial[2 * i + 1];
+        }
+        for (int s = 0; s < a->num_slots; s++) {
+            double p_norm = sqrt(pn[2 * s]), u_norm = sqrt(pn[2 * s + 1]);
+            a->trust[s]   = (p_norm > 0.0 && u_norm > 0.0) ? (float)(p_norm / u_norm) : 1.0f;
+        }
+        free(pn);
+        threadpool_parallel_for_grain(NULL, flat_lamb_apply_task, &sw, (size_t)a->num_pieces, 1);
+    }
+
+    free(coeff);
+    return rc;
+}
+
+typedef struct {
+    CMLFlatRule rule;
+    FlatCoeff c;
+    float* p;
+    const float* g;
+    float* m;
+    float* v;
+    float* vmax;
+    size_t n;
+} FlatRange;
+
+static void flat_range_task(void* data, size_t start, size_t end) {
+    const FlatRange* r = (const FlatRange*)data;
+    for (size_t k = start; k < end; k++) {
+        size_t lo = k * FLAT_PIECE;
+        size_t n  = r->n - lo < FLAT_PIECE ? r->n - lo : FLAT_PIECE;
+        float* vmax = r->vmax ? r->vmax + lo : NULL;
+        if (r->rule == CML_FLAT_ADAM)
+            adam_range(r->p + lo, r->g + lo, r->m + lo, r->v + lo, vmax, n, &r->c);
+        else
+            adamw_range(r->p + lo, r->g + lo, r->m + lo, r->v + lo, vmax, n, &r->c);
+    }
+}
+
+int cml_flat_update_range(CMLFlatRule rule, const CMLFlatHyper* hyper, float grad_scale,
+                          float* params, const float* grads, float* exp_avg, float* exp_avg_sq,
+                          float* max_exp_avg_sq, size_t n) {
+    if (!hyper || rule == CML_FLAT_LAMB) return -1;
+    if (n == 0) return 0;
+    if (!params || !grads || !exp_avg || !exp_avg_sq) return -1;
+
+    FlatRange r = {rule, {0}, params, grads, exp_avg, exp_avg_sq, max_exp_avg_sq, n};
+    flat_coeff(hyper, grad_scale > 0.0f ? grad_scale : 1.0f, &r.c);
+    threadpool_parallel_for_grain(NULL, flat_range_task, &r, (n + FLAT_PIECE - 1) / FLAT_PIECE,
+                                  1);
+    return 0;
+}
@@ -5,6 +5,7 @@
 #include <math.h>
 #include <stdarg.h>
 #include <unistd.h>
+#include <stdatomic.h>
 #include "tensor/tensor.h"
 #include "tensor/realize.h"
 #include "core/serialization.h"
@@ -197,6 +198,13 @@ static void resolve_config(const TensorConfig* config, DType* dtype, DeviceType*
     }
 }
 
+static _Atomic uint64_t g_tensor_version = 0;
+
+void tensor_bump_version(Tensor* t) {
+    if (t)
+        t->version = atomic_fetch_add(&g_tensor_version, 1) + 1;
+}
+
 Tensor* tensor_create(DType dtype, DeviceType device, int ndim, const int* shape,
                       bool requires_grad) {
     Tensor* t = (Tensor*)malloc(sizeof(Tensor));
@@ -247,6 +255,7 @@ Tensor* tensor_create(DType dtype, DeviceType device, int ndim, const int* shape
     t->user_data         = NULL;
     t->owns_data         = true;
     t->from_buffer_cache = false;
+    tensor_bump_version(t);
 
     t->numel = 1;
     for (int i = 0; i < ndim; i++) {
@@ -542,6 +551,8 @@ void tensor_set_float(Tensor* t, size_t idx, float value) {
     }
     if (!t->data)
         return;
+    if (t->version)
+        tensor_bump_version(t);
 
     size_t offset = t->storage_offset;
     if (!t->is_contiguous) {
@@ -668,6 +679,7 @@ Tensor* tensor_from_ir_node(struct IRNode* node, CMLGraph_t ir_context) {
     t->is_executed = false;
     t->data        = NULL;
     t->owns_data   = true; // Will own data when executed
+    t->version     = 0;
 
     // Autograd
     t->requires_grad = node->requires_grad;
@@ -37,10 +37,7 @@ ConvNeXtConfig cml_zoo_convnext_config_large(void) {
 }
 
 static Conv2d* depthwise_conv7x7(int channels, DType dtype, DeviceType device) {
-    Conv2d* conv = nn_conv2d(channels, channels, 7, 1, 3, 1, true, dtype, device);
-    if (conv)
-        conv->groups = channels;
-    return conv;
+    return nn_conv2d_grouped(channels, channels, 7, 1, 3, 1, channels, true, dtype, device);
 }
 
 typedef struct {
@@ -51,7 +51,7 @@ static void add_mbconv(Sequential* model, int in_ch, int out_ch, int expand_rati
         sequential_add(model, (Module*)nn_silu());
     }
 
-    sequential_add(model, (Module*)nn_conv2d(expanded, expanded, kernel_size, stride, padding, 1, false, dtype, device));
+    sequential_add(model, (Module*)nn_conv2d_grouped(expanded, expanded, kernel_size, stride, padding, 1, expanded, false, dtype, device));
     sequential_add(model, (Module*)nn_batchnorm2d(expanded, 1e-5f, 0.1f, true, true, dtype, device));
     sequential_add(model, (Module*)nn_silu());
 
@@ -5,6 +5,7 @@
 #include <math.h>
 
 #include "cml.h"
+#include "ops/ir/execution.h"
 
 static int tests_run = 0;
 static int tests_passed = 0;
@@ -175,6 +176,171 @@ static int test_loss_backward(void) {
     return ok;
 }
 
+/* Deterministic 4-layer MLP on 8 features with ReLUs in between */
+static Sequential* make_ckpt_mlp(Parameter*** params, int* num_params) {
+    Sequential* model = cml_nn_sequential();
+    sequential_add(model, (Module*)cml_nn_linear(8, 32, DTYPE_FLOAT32, DEVICE_CPU, true));
+    sequential_add(model, (Module*)cml_nn_relu(false));
+    sequential_add(model, (Module*)cml_nn_linear(32, 32, DTYPE_FLOAT32, DEVICE_CPU, true));
+    sequential_add(model, (Module*)cml_nn_relu(false));
+    sequential_add(model, (Module*)cml_nn_linear(32, 32, DTYPE_FLOAT32, DEVICE_CPU, true));
+    sequential_add(model, (Module*)cml_nn_relu(false));
+    sequential_add(model, (Module*)cml_nn_linear(32, 2, DTYPE_FLOAT32, DEVICE_CPU, true));
+    module_set_training((Module*)model, true);
+    *params = NULL;
+    module_collect_parameters((Module*)model, params, num_params, true);
+    for (int i = 0; i < *num_params; i++) {
+        float* w = (float*)tensor_data_ptr((*params)[i]->tensor);
+        for (size_t j = 0; j < (*params)[i]->tensor->numel; j++)
+            w[j] = 0.2f * sinf(1.3f * (float)j + (float)i);
+    }
+    return model;
+}
+
+static void make_ckpt_batch(Tensor** x, Tensor** y) {
+    float xd[16 * 8], yd[16 * 2];
+    for (int i = 0; i < 16 * 8; i++)
+        xd[i] = cosf(0.7f * (float)i);
+    for (int i = 0; i < 16 * 2; i++)
+        yd[i] = sinf(0.3f * (float)i);
+    *x = cml_tensor_2d(xd, 16, 8);
+    *y = cml_tensor_2d(yd, 16, 2);
+}
+
+static Tensor* ckpt_mse(Tensor* out, Tensor* target, void* ctx) {
+    (void)ctx;
+    return tensor_mse_loss(out, target);
+}
+
+static int test_checkpoint_plan_budget(void) {
+    Parameter** params; int n;
+    Sequential* model = make_ckpt_mlp(&params, &n);
+    Tensor *x, *y;
+    make_ckpt_batch(&x, &y);
+
+    CheckpointPlan* plan = checkpoint_plan_create(model, x, 0);
+    int ok = plan && plan->num_segments == 7 && plan->fits && plan->recompute_flops == 0 &&
+             plan->total_flops > 0 && plan->predicted_peak > 0;
+    size_t full = ok ? plan->predicted_peak : 0;
+
+    /* A tighter budget drops some activations, never the last segment's */
+    ok = ok && checkpoint_plan_set_budget(plan, full * 3 / 4) == 0;
+    ok = ok && plan->fits && plan->predicted_peak <= full * 3 / 4;
+    ok = ok && plan->recompute_flops > 0 && plan->recompute_flops < plan->total_flops;
+    ok = ok && !plan->segments[plan->num_segments - 1].recompute;
+
+    /* Below what the last segment alone needs nothing can help */
+    ok = ok && checkpoint_plan_set_budget(plan, 1) == -1 && !plan->fits;
+
+    checkpoint_plan_free(plan);
+    tensor_free(x); tensor_free(y);
+    free(params);
+    module_free((Module*)model);
+    cml_ir_reset_global_context();
+    return ok;
+}
+
+static int test_checkpoint_train_step(void) {
+    Parameter **ref_params, **params; int n;
+    Sequential* ref   = make_ckpt_mlp(&ref_params, &n);
+    Sequential* model = make_ckpt_mlp(&params, &n);
+    Tensor *x, *y;
+    make_ckpt_batch(&x, &y);
+
+    Tensor* out  = module_forward((Module*)ref, x);
+    Tensor* loss = tensor_mse_loss(out, y);
+    float ref_loss = tensor_get_float(loss, 0);
+    tensor_backward(loss, NULL, false, false);
+    tensor_free(loss); tensor_free(out);
+    tensor_free(x); tensor_free(y);
+    cml_ir_reset_global_context();
+    make_ckpt_batch(&x, &y);
+
+    /* Same gradients with activations recomputed, in less memory */
+    CheckpointPlan* plan = checkpoint_plan_create(model, x, 0);
+    int ok = plan != NULL;
+    size_t full = ok ? plan->predicted_peak : 0;
+    ok = ok && checkpoint_plan_set_budget(plan, full * 3 / 4) == 0;
+    float step_loss = 0.0f;
+    ok = ok && checkpoint_train_step(plan, x, y, ckpt_mse, NULL, &step_loss) == 0;
+    ok = ok && APPROX_EQ(step_loss, ref_loss) && plan->actual_peak > 0;
+    for (int i = 0; ok && i < n; i++) {
+        Tensor* g  = params[i]->tensor->grad;
+        Tensor* rg = ref_params[i]->tensor->grad;
+        ok = g && rg && g->numel == rg->numel;
+        for (size_t j = 0; ok && j < g->numel; j++)
+            ok = APPROX_EQ(tensor_get_float(g, j), tensor_get_float(rg, j));
+    }
+    size_t budgeted_actual = ok ? plan->actual_peak : 0;
+    ok = ok && checkpoint_plan_set_budget(plan, 0) == 0;
+    ok = ok && checkpoint_train_step(plan, x, y, ckpt_mse, NULL, NULL) == 0;
+    ok = ok && budgeted_actual < plan->actual_peak;
+
+    checkpoint_plan_free(plan);
+    tensor_free(x); tensor_free(y);
+    free(ref_params); free(params);
+    module_free((Module*)ref);
+    module_free((Module*)model);
+    cml_ir_reset_global_context();
+    return ok;
+}
+
+/* Backward of the MLP in a graph of its own; returns the sweep's peak */
+static size_t eager_free_backward(Sequential* model, bool eager) {
+    Tensor *x, *y;
+    make_ckpt_batch(&x, &y);
+    tensor_ensure_executed(x);
+    tensor_ensure_executed(y);
+    CMLGraph_t prev = cml_ir_get_or_create_context();
+    CMLGraph_t g    = cml_ir_new(IR_TARGET_C);
+    cml_ir_set_private_buffers(g, true);
+    cml_ir_set_eager_free(g, eager);
+    cml_ir_set_global_context(g);
+
+    Tensor* out  = module_forward((Module*)model, x);
+    Tensor* loss = tensor_mse_loss(out, y);
+    tensor_backward(loss, NULL, false, false);
+    CMLBackwardStats stats;
+    cml_get_backward_stats(&stats);
+    float value = tensor_get_float(loss, 0);
+
+    cml_ir_set_global_context(prev);
+    tensor_free(loss); tensor_free(out);
+    cml_ir_free(g);
+    tensor_free(x); tensor_free(y);
+    return value > 0.0f ? stats.last_peak_bytes : 0;
+}
+
+static int test_backward_eager_free(void) {
+    Parameter **ref_params, **params; int n;
+    Sequential* ref   = make_ckpt_mlp(&ref_params, &n);
+    Sequential* model = make_ckpt_mlp(&params, &n);
+
+    cml_reset_backward_stats();
+    size_t kept_peak = eager_free_backward(ref, false);
+    CMLBackwardStats stats;
+    cml_get_backward_stats(&stats);
+    int ok = kept_peak > 0 && stats.activations_freed == 0 && stats.grads_freed == 0;
+
+    /* Same gradients, with values and grads released along the way */
+    size_t eager_peak = eager_free_backward(model, true);
+    cml_get_backward_stats(&stats);
+    ok = ok && eager_peak > 0 && eager_peak < kept_peak && stats.passes == 2;
+    ok = ok && stats.activations_freed > 0 && stats.grads_freed > 0;
+    for (int i = 0; ok && i < n; i++) {
+        Tensor* g  = params[i]->tensor->grad;
+        Tensor* rg = ref_params[i]->tensor->grad;
+        ok = g && rg && g->numel == rg->numel;
+        for (size_t j = 0; ok && j < g->numel; j++)
+            ok = APPROX_EQ(tensor_get_float(g, j), tensor_get_float(rg, j));
+    }
+
+    free(ref_params); free(params);
+    module_free((Module*)ref);
+    module_free((Module*)model);
+    return ok;
+}
+
 int main(void) {
     cml_init();
 
@@ -192,6 +358,11 @@ int main(void) {
     TEST(requires_grad);
     TEST(no_grad);
     TEST(is_leaf);
+    TEST(backward_eager_free);
+
+    printf("\nCheckpointing:\n");
+    TEST(checkpoint_plan_budget);
+    TEST(checkpoint_train_step);
 
     printf("\n");
     printf("Results: %d/%d tests passed\n", tests_passed, tests_run);
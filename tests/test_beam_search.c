@@ -3,7 +3,13 @@
 #include <string.h>
 #include <assert.h>
 
+#include <dlfcn.h>
+#include <math.h>
+#include <unistd.h>
+
 #include "ops/ir/beam_search.h"
+#include "ops/ir/fused_codegen.h"
+#include "ops/ir/runtime_compiler.h"
 
 static void test_create_free(void) {
     printf("  test_create_free...");
@@ -124,13 +130,152 @@ static void test_tune(void) {
     /* The best config should have reasonable block sizes (> 0) */
     assert(best.block_size_x > 0);
 
-    /* After tuning, the result should be cached */
+    /* Nothing was measured, so the heuristic pick is not cached */
     CMLBeamConfig cached;
     memset(&cached, 0, sizeof(cached));
     ret = cml_beam_search_lookup(ctx, 0xABCD, &cached);
+    assert(ret != 0);
+
+    /* A stored result is returned as is */
+    CMLBeamConfig stored = best;
+    stored.block_size_x  = best.block_size_x * 2;
+    assert(cml_beam_search_store(ctx, 0xABCD, &stored, 1.0) == 0);
+    ret = cml_beam_search_tune(ctx, 0xABCD, total, 2, shape, &cached);
     assert(ret == 0);
-    assert(cached.block_size_x == best.block_size_x);
+    assert(cached.block_size_x == stored.block_size_x);
+
+    cml_beam_search_free(ctx);
+    printf(" PASS\n");
+}
+
+/* y = exp(x) * x, as the linearizer would emit it */
+static void make_program(CMLLinearOp ops[4], CMLLinearProgram* prog) {
+    memset(ops, 0, 4 * sizeof(CMLLinearOp));
+    ops[0].kind = LINOP_LOAD;
+    ops[0].dest_reg = 0;
+    ops[1].kind = LINOP_COMPUTE;
+    ops[1].uop = UOP_EXP;
+    ops[1].dest_reg = 1;
+    ops[1].src_regs[0] = 0;
+    ops[1].num_srcs = 1;
+    ops[2].kind = LINOP_COMPUTE;
+    ops[2].uop = UOP_MUL;
+    ops[2].dest_reg = 2;
+    ops[2].src_regs[0] = 1;
+    ops[2].src_regs[1] = 0;
+    ops[2].num_srcs = 2;
+    ops[3].kind = LINOP_STORE;
+    ops[3].dest_reg = 2;
+    prog->ops = ops;
+    prog->num_ops = 4;
+    prog->capacity = 4;
+    prog->next_vreg = 3;
+}
 
+static void test_variants_match_reference(void) {
+    printf("  test_variants_match_reference...");
+
+    CMLLinearOp ops[4];
+    CMLLinearProgram prog;
+    make_program(ops, &prog);
+
+    /* Strip width and tile deliberately do not divide n */
+    char* src = cml_fused_codegen_c_variant(&prog, "k", 8, 4);
+    assert(src != NULL);
+    void* handle = cml_runtime_build_native(src);
+    free(src);
+    assert(handle != NULL);
+    void* fn = dlsym(handle, "k");
+    assert(fn != NULL);
+
+    enum { N = 10007 };
+    static float x[N], y[N];
+    for (int i = 0; i < N; i++) x[i] = (float)(i % 50) * 0.05f - 1.0f;
+    float* bufs[2] = {x, y};
+
+    CMLNativeLaunch launches[3] = {{0, 0, false}, {1000, 3, false}, {512, 4, true}};
+    for (int l = 0; l < 3; l++) {
+        memset(y, 0, sizeof(y));
+        assert(cml_runtime_launch_native_fn(fn, bufs, N, &launches[l]) == 0);
+        for (int i = 0; i < N; i++) {
+            float want = expf(x[i]) * x[i];
+            assert(fabsf(y[i] - want) <= 1e-5f * (1.0f + fabsf(want)));
+        }
+    }
+
+    dlclose(handle);
+    printf(" PASS\n");
+}
+
+static void test_tune_cpu_measured(void) {
+    printf("  test_tune_cpu_measured...");
+
+    CMLBeamSearchCtx* ctx = cml_beam_search_create();
+    assert(ctx != NULL);
+    CMLLinearOp ops[4];
+    CMLLinearProgram prog;
+    make_program(ops, &prog);
+
+    CMLBeamConfig best;
+    memset(&best, 0, sizeof(best));
+    assert(cml_beam_search_tune_cpu(ctx, 0x5151, &prog, 1 << 16, &best) == 0);
+    assert(best.vec_width >= 1 && best.unroll_factor >= 1);
+    assert(best.block_size_x >= 1024 && best.num_threads >= 1);
+    assert(best.loop_order == 0 || best.loop_order == 1);
+
+    /* Launch shapes of the surviving variants were all measured */
+    assert(ctx->num_candidates > 1);
+    for (int i = 0; i < ctx->num_candidates; i++)
+        assert(ctx->candidates[i].valid && ctx->candidates[i].time_us > 0.0);
+
+    CMLBeamConfig cached;
+    assert(cml_beam_search_lookup(ctx, 0x5151, &cached) == 0);
+    assert(memcmp(&cached, &best, sizeof(best)) == 0);
+
+    cml_beam_search_free(ctx);
+    printf(" PASS\n");
+}
+
+static void test_cache_keyed_by_cpu(void) {
+    printf("  test_cache_keyed_by_cpu...");
+
+    assert(strlen(cml_beam_cpu_model()) > 0);
+    assert(cml_beam_cpu_id() != 0);
+
+    CMLBeamSearchCtx* ctx = cml_beam_search_create();
+    CMLBeamConfig cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.block_size_x = 4096;
+    cfg.vec_width = 8;
+    cfg.num_threads = 2;
+    cfg.loop_order = 1;
+    assert(cml_beam_search_store(ctx, 0x77, &cfg, 3.0) == 0);
+
+    /* Same kernel measured on another machine */
+    for (int i = 0; i < 256; i++) {
+        if (ctx->cache[i].occupied) ctx->cache[i].cpu_id ^= 1;
+    }
+    CMLBeamConfig found;
+    assert(cml_beam_search_lookup(ctx, 0x77, &found) == -1);
+    cfg.vec_width = 4;
+    assert(cml_beam_search_store(ctx, 0x77, &cfg, 5.0) == 0);
+    assert(ctx->cache_count == 2);
+
+    /* Both survive a round trip; only the local one is visible */
+    char path[] = "/tmp/cml_beam_test_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    assert(cml_beam_cache_save(ctx, path) == 0);
+
+    CMLBeamSearchCtx* loaded = cml_beam_search_create();
+    assert(cml_beam_cache_load(loaded, path) == 0);
+    assert(loaded->cache_count == 2);
+    assert(cml_beam_search_lookup(loaded, 0x77, &found) == 0);
+    assert(found.vec_width == 4 && found.num_threads == 2 && found.loop_order == 1);
+
+    remove(path);
+    cml_beam_search_free(loaded);
     cml_beam_search_free(ctx);
     printf(" PASS\n");
 }
@@ -143,6 +288,9 @@ int main(void) {
     test_store_and_lookup();
     test_store_multiple();
     test_tune();
+    test_variants_match_reference();
+    test_tune_cpu_measured();
+    test_cache_keyed_by_cpu();
 
     printf("All BEAM search tests passed.\n");
     return 0;
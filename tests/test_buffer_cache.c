@@ -0,0 +1,222 @@
+/*
+ * Tests for the size-class buffer cache: reuse within a class, the byte cap,
+ * stats, the TLSF arena, and concurrent use from several threads.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "alloc/buffer_cache.h"
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+static int tests_run    = 0;
+static int tests_passed = 0;
+
+#define RUN_TEST(test) do { \
+    tests_run++; \
+    printf("  [%d] %-55s ", tests_run, #test); \
+    if (test()) { tests_passed++; printf("PASS\n"); } \
+    else { printf("FAIL\n"); } \
+} while(0)
+
+static int test_reuse_same_size(void) {
+    cml_cleanup_buffer_cache();
+    void* a = cml_buffer_cache_alloc(1000);
+    cml_buffer_cache_free(a, 1000);
+    void* b = cml_buffer_cache_alloc(1000);
+    int ok = a && a == b;
+    cml_buffer_cache_free(b, 1000);
+    return ok;
+}
+
+static int test_reuse_within_class(void) {
+    /* 1100 and 1200 both round to the 1280-byte class, 2000 does not */
+    cml_cleanup_buffer_cache();
+    void* a = cml_buffer_cache_alloc(1100);
+    memset(a, 0xAB, 1280);
+    cml_buffer_cache_free(a, 1100);
+    void* b = cml_buffer_cache_alloc(1200);
+    void* c = cml_buffer_cache_alloc(2000);
+    int ok = a && b == a && c && c != a;
+    cml_buffer_cache_free(b, 1200);
+    cml_buffer_cache_free(c, 2000);
+    return ok;
+}
+
+static int test_stats_track_hits(void) {
+    cml_cleanup_buffer_cache();
+    CMLBufferCacheStats before, after;
+    cml_buffer_cache_get_stats(&before);
+
+    void* p = cml_buffer_cache_alloc(4096);
+    cml_buffer_cache_free(p, 4096);
+    CMLBufferCacheStats mid;
+    cml_buffer_cache_get_stats(&mid);
+    p = cml_buffer_cache_alloc(4096);
+    cml_buffer_cache_get_stats(&after);
+    cml_buffer_cache_free(p, 4096);
+
+    return after.misses == before.misses + 1 && after.hits == before.hits + 1 &&
+           mid.bytes_cached >= 4096 && after.bytes_cached == mid.bytes_cached - 4096;
+}
+
+static int test_limit_evicts(void) {
+    cml_cleanup_buffer_cache();
+    CMLBufferCacheStats s0, s1;
+    cml_buffer_cache_get_stats(&s0);
+    size_t saved_limit = s0.bytes_limit;
+
+    cml_buffer_cache_set_limit(64 * 1024);
+    void* bufs[4];
+    for (int i = 0; i < 4; i++)
+        bufs[i] = cml_buffer_cache_alloc(32 * 1024);
+    for (int i = 0; i < 4; i++)
+        cml_buffer_cache_free(bufs[i], 32 * 1024);
+    cml_buffer_cache_get_stats(&s1);
+
+    int ok = s1.bytes_cached <= 64 * 1024 && s1.evictions >= s0.evictions + 2;
+
+    cml_buffer_cache_set_limit(0);
+    void* p = cml_buffer_cache_alloc(256);
+    cml_buffer_cache_free(p, 256);
+    cml_buffer_cache_get_stats(&s1);
+    ok = ok && s1.bytes_limit == 0;
+
+    cml_buffer_cache_set_limit(saved_limit);
+    cml_cleanup_buffer_cache();
+    return ok;
+}
+
+static int test_oversize_passthrough(void) {
+    size_t big = ((size_t)64 << 20) + 1;
+    void* p = cml_buffer_cache_alloc(big);
+    if (!p)
+        return 1; /* Nothing to check without the memory */
+    ((char*)p)[big - 1] = 1;
+    cml_buffer_cache_free(p, big);
+    return 1;
+}
+
+/* Bytes glibc holds in mmapped chunks; the 8 MB arena pool is one */
+static size_t mapped_bytes(void) {
+#ifdef __GLIBC__
+    return mallinfo2().hblkhd;
+#else
+    return 0;
+#endif
+}
+
+/* main() configures an 8 MB arena before the cache first initializes */
+static int test_arena_released_on_cleanup(void) {
+    const size_t size = (size_t)2 << 20;
+#ifdef __GLIBC__
+    /* Freeing a mapped pool would otherwise raise the threshold past 8 MB */
+    mallopt(M_MMAP_THRESHOLD, 1 << 20);
+#endif
+    cml_cleanup_buffer_cache();
+    CMLBufferCacheStats s0, s1;
+    cml_buffer_cache_get_stats(&s0);
+
+    /* A live block keeps the pool through a cleanup */
+    void* a = cml_buffer_cache_alloc(size);
+    cml_buffer_cache_get_stats(&s1);
+    int ok = a && s1.arena_allocs == s0.arena_allocs + 1;
+    size_t with_pool = mapped_bytes();
+    cml_cleanup_buffer_cache();
+    if (a)
+        memset(a, 0x5A, size);
+    cml_buffer_cache_free(a, size);
+
+    /* Once empty, cleanup gives the pool back */
+    cml_cleanup_buffer_cache();
+    size_t released = mapped_bytes();
+#ifdef __GLIBC__
+    ok = ok && with_pool >= released + ((size_t)8 << 20);
+#else
+    (void)with_pool;
+    (void)released;
+#endif
+
+    /* ... and the next large buffer reserves it again */
+    void* b = cml_buffer_cache_alloc(size);
+    cml_buffer_cache_get_stats(&s1);
+    ok = ok && b && s1.arena_allocs == s0.arena_allocs + 2;
+    cml_buffer_cache_free(b, size);
+    cml_cleanup_buffer_cache();
+    return ok;
+}
+
+#define WORKER_ITERS 2000
+
+static void* churn_worker(void* arg) {
+    unsigned seed = (unsigned)(size_t)arg;
+    void* live[16] = {0};
+    size_t sizes[16] = {0};
+    for (int it = 0; it < WORKER_ITERS; it++) {
+        seed = seed * 1103515245u + 12345u;
+        int slot = (int)((seed >> 16) % 16);
+        if (live[slot]) {
+            /* Check no other thread scribbled over this buffer */
+            unsigned char tag = (unsigned char)(slot + 1);
+            unsigned char* bytes = live[slot];
+            for (size_t i = 0; i < sizes[slot]; i += 61) {
+                if (bytes[i] != tag)
+                    return (void*)1;
+            }
+            cml_buffer_cache_free(live[slot], sizes[slot]);
+            live[slot] = NULL;
+        } else {
+            sizes[slot] = 64 + (seed % 20000);
+            live[slot]  = cml_buffer_cache_alloc(sizes[slot]);
+            if (!live[slot])
+                return (void*)1;
+            memset(live[slot], slot + 1, sizes[slot]);
+        }
+    }
+    for (int i = 0; i < 16; i++) {
+        if (live[i])
+            cml_buffer_cache_free(live[i], sizes[i]);
+    }
+    return NULL;
+}
+
+static int test_concurrent_churn(void) {
+    enum { THREADS = 4 };
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++)
+        pthread_create(&threads[i], NULL, churn_worker, (void*)(size_t)(i + 1));
+    int ok = 1;
+    for (int i = 0; i < THREADS; i++) {
+        void* ret = NULL;
+        pthread_join(threads[i], &ret);
+        if (ret)
+            ok = 0;
+    }
+
+    /* Exited threads hand their magazines back to the central pool */
+    CMLBufferCacheStats s;
+    cml_buffer_cache_get_stats(&s);
+    cml_cleanup_buffer_cache();
+    CMLBufferCacheStats after;
+    cml_buffer_cache_get_stats(&after);
+    return ok && s.hits > 0 && after.bytes_cached == 0;
+}
+
+int main(void) {
+    printf("=== Buffer Cache Tests ===\n\n");
+    setenv("CML_BUFFER_CACHE_ARENA_MB", "8", 1);
+
+    RUN_TEST(test_reuse_same_size);
+    RUN_TEST(test_reuse_within_class);
+    RUN_TEST(test_stats_track_hits);
+    RUN_TEST(test_limit_evicts);
+    RUN_TEST(test_oversize_passthrough);
+    RUN_TEST(test_arena_released_on_cleanup);
+    RUN_TEST(test_concurrent_churn);
+
+    printf("\n%d/%d tests passed\n", tests_passed, tests_run);
+    cml_cleanup_buffer_cache();
+    return (tests_passed == tests_run) ? 0 : 1;
+}
@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "cml.h"
+#include "ops/conv_blocked.h"
+
+static void fill(float* p, size_t n, float phase) {
+    for (size_t i = 0; i < n; i++)
+        p[i] = sinf(0.37f * (float)i + phase);
+}
+
+static void conv_reference(const float* in, const float* w, const float* bias, float* out,
+                           const ConvBlockedShape* s) {
+    for (int b = 0; b < s->batch; b++)
+        for (int oc = 0; oc < s->out_channels; oc++)
+            for (int oy = 0; oy < s->out_h; oy++)
+                for (int ox = 0; ox < s->out_w; ox++) {
+                    float sum = bias ? bias[oc] : 0.0f;
+                    for (int ic = 0; ic < s->in_channels; ic++)
+                        for (int ky = 0; ky < s->kernel_h; ky++)
+                            for (int kx = 0; kx < s->kernel_w; kx++) {
+                                int iy = oy * s->stride_h - s->pad_h + ky * s->dilation_h;
+                                int ix = ox * s->stride_w - s->pad_w + kx * s->dilation_w;
+                                if (iy < 0 || iy >= s->in_h || ix < 0 || ix >= s->in_w)
+                                    continue;
+                                sum += in[((size_t)(b * s->in_channels + ic) * s->in_h + iy) *
+                                              s->in_w + ix] *
+                                       w[((size_t)(oc * s->in_channels + ic) * s->kernel_h + ky) *
+                                             s->kernel_w + kx];
+                            }
+                    out[((size_t)(b * s->out_channels + oc) * s->out_h + oy) * s->out_w + ox] = sum;
+                }
+}
+
+static ConvBlockedShape make_shape(int batch, int ic, int h, int w, int oc, int k, int stride,
+                                   int pad, int dilation) {
+    ConvBlockedShape s = {.batch = batch, .in_channels = ic, .in_h = h, .in_w = w,
+                          .out_channels = oc, .kernel_h = k, .kernel_w = k,
+                          .stride_h = stride, .stride_w = stride, .pad_h = pad, .pad_w = pad,
+                          .dilation_h = dilation, .dilation_w = dilation};
+    s.out_h = (h + 2 * pad - dilation * (k - 1) - 1) / stride + 1;
+    s.out_w = (w + 2 * pad - dilation * (k - 1) - 1) / stride + 1;
+    return s;
+}
+
+static float max_diff(const float* a, const float* b, size_t n) {
+    float m = 0.0f;
+    for (size_t i = 0; i < n; i++)
+        m = fmaxf(m, fabsf(a[i] - b[i]));
+    return m;
+}
+
+/* Matches the reference on one shape, with and without bias */
+static void check_shape(ConvBlockedShape s) {
+    size_t in_n  = (size_t)s.batch * s.in_channels * s.in_h * s.in_w;
+    size_t w_n   = (size_t)s.out_channels * s.in_channels * s.kernel_h * s.kernel_w;
+    size_t out_n = (size_t)s.batch * s.out_channels * s.out_h * s.out_w;
+    float* in    = malloc(in_n * sizeof(float));
+    float* w     = malloc(w_n * sizeof(float));
+    float* bias  = malloc((size_t)s.out_channels * sizeof(float));
+    float* out   = malloc(out_n * sizeof(float));
+    float* ref   = malloc(out_n * sizeof(float));
+    fill(in, in_n, 0.1f);
+    fill(w, w_n, 1.3f);
+    fill(bias, (size_t)s.out_channels, 2.2f);
+
+    for (int with_bias = 0; with_bias < 2; with_bias++) {
+        assert(cml_conv2d_blocked(in, w, with_bias ? bias : NULL, out, &s) == 0);
+        conv_reference(in, w, with_bias ? bias : NULL, ref, &s);
+        assert(max_diff(out, ref, out_n) < 1e-3f);
+    }
+    free(in); free(w); free(bias); free(out); free(ref);
+}
+
+static void test_conv_blocked_shapes(void) {
+    printf("  test_conv_blocked_shapes...");
+    check_shape(make_shape(1, 16, 9, 9, 16, 3, 1, 1, 1));   /* Full blocks, padded 3x3 */
+    check_shape(make_shape(2, 5, 7, 11, 19, 3, 2, 1, 1));   /* Ragged channels, stride 2 */
+    check_shape(make_shape(1, 8, 10, 10, 8, 1, 1, 0, 1));   /* Pointwise */
+    check_shape(make_shape(1, 12, 12, 12, 24, 3, 1, 2, 2)); /* Dilated */
+    check_shape(make_shape(2, 3, 15, 15, 32, 7, 2, 3, 1));  /* RGB stem */
+    printf(" PASS\n");
+}
+
+static void relu_ref(const float* in, float* out, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        out[i] = in[i] > 0.0f ? in[i] : 0.0f;
+}
+
+/* conv -> ReLU -> conv hands the blocked activation along under node keys
+ * and still gives the NCHW answer */
+static void test_conv_blocked_chain(void) {
+    printf("  test_conv_blocked_chain...");
+    ConvBlockedShape s1 = make_shape(1, 8, 8, 8, 24, 3, 1, 1, 1);
+    ConvBlockedShape s2 = make_shape(1, 24, 8, 8, 16, 1, 1, 0, 1);
+    size_t in_n = 8 * 64, mid_n = 24 * 64, out_n = 16 * 64;
+    float *in = malloc(in_n * sizeof(float)), *w1 = malloc(24 * 8 * 9 * sizeof(float));
+    float *w2 = malloc(16 * 24 * sizeof(float)), *mid = malloc(mid_n * sizeof(float));
+    float *act = malloc(mid_n * sizeof(float)), *out = malloc(out_n * sizeof(float));
+    float* ref = malloc(out_n * sizeof(float));
+    fill(in, in_n, 0.4f);
+    fill(w1, 24 * 8 * 9, 0.9f);
+    fill(w2, 16 * 24, 1.7f);
+    int conv1, relu, conv2; /* Stand-ins for the graph nodes */
+
+    uint64_t epoch = cml_conv_blocked_graph_begin();
+    ConvBlockedIO io1 = {.out_key = &conv1, .epoch = epoch, .skip_output = true};
+    assert(cml_conv2d_blocked_ex(in, w1, NULL, NULL, &s1, &io1) == 1);
+    ConvBlockedIO io_relu = {.in_key = &conv1, .out_key = &relu, .epoch = epoch,
+                             .skip_output = true};
+    assert(cml_conv_blocked_relu(&io_relu, NULL, mid_n) == 1);
+    /* Only the relu's key finds it now */
+    assert(cml_conv_blocked_materialize(&conv1, epoch, act, mid_n) != 0);
+    assert(cml_conv_blocked_materialize(&relu, epoch, act, mid_n) == 0);
+    ConvBlockedIO io2 = {.in_key = &relu, .out_key = &conv2, .epoch = epoch};
+    assert(cml_conv2d_blocked_ex(NULL, w2, NULL, out, &s2, &io2) == 0);
+
+    assert(cml_conv2d_blocked(in, w1, NULL, mid, &s1) == 0);
+    float* act_ref = malloc(mid_n * sizeof(float));
+    relu_ref(mid, act_ref, mid_n);
+    assert(max_diff(act, act_ref, mid_n) < 1e-5f);
+    conv_reference(act_ref, w2, NULL, ref, &s2);
+    assert(max_diff(out, ref, out_n) < 1e-3f);
+    /* The consumer took the relu's entry */
+    assert(cml_conv_blocked_materialize(&relu, epoch, act, mid_n) != 0);
+
+    /* Padded consumer of a kept activation; another epoch does not see it */
+    ConvBlockedShape s3 = make_shape(1, 16, 8, 8, 8, 3, 1, 1, 1);
+    float* w3   = malloc(8 * 16 * 9 * sizeof(float));
+    float* out3 = malloc(8 * 64 * sizeof(float));
+    float* ref3 = malloc(8 * 64 * sizeof(float));
+    fill(w3, 8 * 16 * 9, 0.2f);
+    ConvBlockedIO io3 = {.in_key = &conv2, .epoch = epoch + 1};
+    assert(cml_conv2d_blocked_ex(NULL, w3, NULL, out3, &s3, &io3) == -1);
+    io3.epoch = epoch;
+    assert(cml_conv2d_blocked_ex(NULL, w3, NULL, out3, &s3, &io3) == 0);
+    conv_reference(out, w3, NULL, ref3, &s3);
+    assert(max_diff(out3, ref3, 8 * 64) < 1e-3f);
+
+    /* Whatever is left is gone once the run ends */
+    assert(cml_conv2d_blocked_ex(in, w1, NULL, NULL, &s1, &io1) == 1);
+    cml_conv_blocked_graph_end(epoch);
+    assert(cml_conv_blocked_materialize(&conv1, epoch, act, mid_n) != 0);
+
+    free(in); free(w1); free(w2); free(mid); free(act); free(act_ref); free(out); free(ref);
+    free(w3); free(out3); free(ref3);
+    cml_conv_blocked_cleanup();
+    printf(" PASS\n");
+}
+
+/* Packed weights are reused per version and rebuilt for a new one */
+static void test_conv_blocked_weight_cache(void) {
+    printf("  test_conv_blocked_weight_cache...");
+    ConvBlockedShape s = make_shape(1, 16, 6, 6, 16, 3, 1, 1, 1);
+    size_t in_n = 16 * 36, w_n = 16 * 16 * 9;
+    float *in = malloc(in_n * sizeof(float)), *w = malloc(w_n * sizeof(float));
+    float *out = malloc(in_n * sizeof(float)), *first = malloc(in_n * sizeof(float));
+    float* ref = malloc(in_n * sizeof(float));
+    fill(in, in_n, 0.6f);
+    fill(w, w_n, 2.4f);
+    int weight; /* Stand-in for the weight tensor */
+
+    ConvBlockedIO io = {.weight_key = &weight, .weight_version = 1};
+    assert(cml_conv2d_blocked_ex(in, w, NULL, first, &s, &io) == 0);
+    fill(w, w_n, 0.5f);
+    assert(cml_conv2d_blocked_ex(in, w, NULL, out, &s, &io) == 0);
+    assert(max_diff(out, first, in_n) == 0.0f); /* Same version: old packing */
+    io.weight_version = 2;
+    assert(cml_conv2d_blocked_ex(in, w, NULL, out, &s, &io) == 0);
+    conv_reference(in, w, NULL, ref, &s);
+    assert(max_diff(out, ref, in_n) < 1e-3f);
+
+    free(in); free(w); free(out); free(first); free(ref);
+    cml_conv_blocked_cleanup();
+    printf(" PASS\n");
+}
+
+/* conv -> ReLU -> conv built as a graph: the intermediates are only kept
+ * blocked, and reading one afterwards recomputes it */
+static void test_conv_blocked_graph(void) {
+    printf("  test_conv_blocked_graph...");
+    ConvBlockedShape s1 = make_shape(2, 8, 8, 8, 32, 3, 1, 1, 1);
+    ConvBlockedShape s2 = make_shape(2, 32, 8, 8, 16, 1, 1, 0, 1);
+    size_t in_n = 2 * 8 * 64, mid_n = 2 * 32 * 64, out_n = 2 * 16 * 64;
+    size_t w1_n = 32 * 8 * 9, w2_n = 16 * 32;
+    float *in = malloc(in_n * sizeof(float)), *w1 = malloc(w1_n * sizeof(float));
+    float *w2 = malloc(w2_n * sizeof(float)), *b1 = malloc(32 * sizeof(float));
+    fill(in, in_n, 0.3f);
+    fill(w1, w1_n, 1.1f);
+    fill(w2, w2_n, 2.9f);
+    fill(b1, 32, 0.7f);
+
+    TensorConfig cfg = {.dtype = DTYPE_FLOAT32, .device = DEVICE_CPU, .has_dtype = true,
+                        .has_device = true};
+    int in_shape[4] = {2, 8, 8, 8}, w1_shape[4] = {32, 8, 3, 3}, w2_shape[4] = {16, 32, 1, 1};
+    int b1_shape[1] = {32};
+    Tensor* x  = tensor_from_data(in, in_shape, 4, &cfg);
+    Tensor* tw1 = tensor_from_data(w1, w1_shape, 4, &cfg);
+    Tensor* tb1 = tensor_from_data(b1, b1_shape, 1, &cfg);
+    Tensor* tw2 = tensor_from_data(w2, w2_shape, 4, &cfg);
+    int k3[2] = {3, 3}, k1[2] = {1, 1}, one[2] = {1, 1}, zero[2] = {0, 0};
+    Conv2DParams p1 = {.kernel_size = k3, .stride = one, .padding = one, .dilation = one,
+                       .groups = 1, .bias = true};
+    Conv2DParams p2 = {.kernel_size = k1, .stride = one, .padding = zero, .dilation = one,
+                       .groups = 1};
+
+    Tensor* c1  = uop_conv2d(x, tw1, tb1, &p1);
+    Tensor* act = uop_relu(c1);
+    Tensor* y   = uop_conv2d(act, tw2, NULL, &p2);
+    assert(y);
+    tensor_ensure_executed(y);
+    assert(!act->is_executed && !c1->is_executed);
+
+    float *mid = malloc(mid_n * sizeof(float)), *act_ref = malloc(mid_n * sizeof(float));
+    float* ref = malloc(out_n * sizeof(float));
+    conv_reference(in, w1, b1, mid, &s1);
+    relu_ref(mid, act_ref, mid_n);
+    conv_reference(act_ref, w2, NULL, ref, &s2);
+    assert(max_diff((const float*)tensor_data_ptr(y), ref, out_n) < 1e-3f);
+    assert(max_diff((const float*)tensor_data_ptr(act), act_ref, mid_n) < 1e-3f);
+
+    tensor_free(y);
+    tensor_free(act);
+    tensor_free(c1);
+    tensor_free(tw2);
+    tensor_free(tb1);
+    tensor_free(tw1);
+    tensor_free(x);
+    free(in); free(w1); free(w2); free(b1); free(mid); free(act_ref); free(ref);
+    printf(" PASS\n");
+}
+
+int main(void) {
+    printf("Blocked Convolution Tests\n");
+
+    test_conv_blocked_shapes();
+    test_conv_blocked_chain();
+    test_conv_blocked_weight_cache();
+
+    cml_init();
+    test_conv_blocked_graph();
+    cml_cleanup();
+
+    printf("All blocked convolution tests passed.\n");
+    return 0;
+}
@@ -0,0 +1,334 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "cml.h"
+#include "nn/layers/conv2d.h"
+#include "ops/conv_separable.h"
+
+static void fill(float* p, size_t n, float phase) {
+    for (size_t i = 0; i < n; i++)
+        p[i] = sinf(0.37f * (float)i + phase);
+}
+
+static ConvBlockedShape make_shape(int batch, int ic, int h, int w, int oc, int k, int stride,
+                                   int pad, int dilation) {
+    ConvBlockedShape s = {.batch = batch, .in_channels = ic, .in_h = h, .in_w = w,
+                          .out_channels = oc, .kernel_h = k, .kernel_w = k,
+                          .stride_h = stride, .stride_w = stride, .pad_h = pad, .pad_w = pad,
+                          .dilation_h = dilation, .dilation_w = dilation};
+    s.out_h = (h + 2 * pad - dilation * (k - 1) - 1) / stride + 1;
+    s.out_w = (w + 2 * pad - dilation * (k - 1) - 1) / stride + 1;
+    return s;
+}
+
+static size_t in_numel(const ConvBlockedShape* s) {
+    return (size_t)s->batch * s->in_channels * s->in_h * s->in_w;
+}
+
+static size_t out_numel(const ConvBlockedShape* s) {
+    return (size_t)s->batch * s->out_channels * s->out_h * s->out_w;
+}
+
+/* Index of input element feeding output (oy, ox) through tap (ky, kx), or -1 */
+static long tap_index(const ConvBlockedShape* s, int b, int c, int oy, int ox, int ky, int kx) {
+    int iy = oy * s->stride_h - s->pad_h + ky * s->dilation_h;
+    int ix = ox * s->stride_w - s->pad_w + kx * s->dilation_w;
+    if (iy < 0 || iy >= s->in_h || ix < 0 || ix >= s->in_w)
+        return -1;
+    return (((long)b * s->in_channels + c) * s->in_h + iy) * s->in_w + ix;
+}
+
+/* Depthwise forward and both gradients, the slow way */
+static void depthwise_reference(const float* in, const float* w, const float* bias,
+                                const float* gout, float* out, float* gin, float* gw,
+                                const ConvBlockedShape* s) {
+    int taps = s->kernel_h * s->kernel_w;
+    memset(gin, 0, in_numel(s) * sizeof(float));
+    memset(gw, 0, (size_t)s->in_channels * taps * sizeof(float));
+    for (int b = 0; b < s->batch; b++)
+        for (int c = 0; c < s->in_channels; c++)
+            for (int oy = 0; oy < s->out_h; oy++)
+                for (int ox = 0; ox < s->out_w; ox++) {
+                    size_t o  = (((size_t)b * s->in_channels + c) * s->out_h + oy) * s->out_w + ox;
+                    float sum = bias ? bias[c] : 0.0f;
+                    for (int ky = 0; ky < s->kernel_h; ky++)
+                        for (int kx = 0; kx < s->kernel_w; kx++) {
+                            long i = tap_index(s, b, c, oy, ox, ky, kx);
+                            if (i < 0)
+                                continue;
+                            int t = ky * s->kernel_w + kx;
+                            sum += in[i] * w[c * taps + t];
+                            gin[i] += gout[o] * w[c * taps + t];
+                            gw[c * taps + t] += gout[o] * in[i];
+                        }
+                    out[o] = sum;
+                }
+}
+
+static float max_diff(const float* a, const float* b, size_t n) {
+    float m = 0.0f;
+    for (size_t i = 0; i < n; i++)
+        m = fmaxf(m, fabsf(a[i] - b[i]));
+    return m;
+}
+
+static void check_depthwise(ConvBlockedShape s) {
+    int taps     = s.kernel_h * s.kernel_w;
+    size_t in_n  = in_numel(&s);
+    size_t out_n = out_numel(&s);
+    size_t w_n   = (size_t)s.in_channels * taps;
+    float *in = malloc(in_n * sizeof(float)), *w = malloc(w_n * sizeof(float));
+    float *bias = malloc((size_t)s.in_channels * sizeof(float));
+    float *gout = malloc(out_n * sizeof(float)), *out = malloc(out_n * sizeof(float));
+    float *ref = malloc(out_n * sizeof(float)), *gin = malloc(in_n * sizeof(float));
+    float *gin_ref = malloc(in_n * sizeof(float)), *gw = malloc(w_n * sizeof(float));
+    float* gw_ref = malloc(w_n * sizeof(float));
+    fill(in, in_n, 0.1f);
+    fill(w, w_n, 1.3f);
+    fill(bias, (size_t)s.in_channels, 2.2f);
+    fill(gout, out_n, 0.7f);
+
+    assert(cml_conv_depthwise_applicable(&s, s.in_channels));
+    depthwise_reference(in, w, bias, gout, ref, gin_ref, gw_ref, &s);
+    assert(cml_conv2d_depthwise(in, w, bias, out, &s) == 0);
+    assert(max_diff(out, ref, out_n) < 1e-4f);
+
+    /* Gradients accumulate into what is already there */
+    for (size_t i = 0; i < in_n; i++)
+        gin[i] = 1.0f;
+    for (size_t i = 0; i < w_n; i++)
+        gw[i] = 1.0f;
+    assert(cml_conv2d_depthwise_backward(in, w, gout, gin, gw, &s) == 0);
+    for (size_t i = 0; i < in_n; i++)
+        gin[i] -= 1.0f;
+    for (size_t i = 0; i < w_n; i++)
+        gw[i] -= 1.0f;
+    assert(max_diff(gin, gin_ref, in_n) < 1e-3f);
+    assert(max_diff(gw, gw_ref, w_n) < 1e-2f);
+
+    free(in); free(w); free(bias); free(gout); free(out); free(ref);
+    free(gin); free(gin_ref); free(gw); free(gw_ref);
+}
+
+static void test_depthwise_shapes(void) {
+    printf("  test_depthwise_shapes...");
+    check_depthwise(make_shape(2, 6, 13, 21, 6, 3, 1, 1, 1));  /* 3x3, ragged width */
+    check_depthwise(make_shape(1, 4, 16, 16, 4, 3, 2, 1, 1));  /* 3x3 stride 2 */
+    check_depthwise(make_shape(2, 5, 15, 19, 5, 5, 2, 2, 1));  /* 5x5 stride 2 */
+    check_depthwise(make_shape(1, 3, 14, 40, 3, 7, 1, 3, 1));  /* 7x7 */
+    check_depthwise(make_shape(1, 4, 12, 12, 4, 3, 1, 2, 2));  /* Dilated */
+    check_depthwise(make_shape(1, 2, 9, 9, 2, 4, 3, 0, 1));    /* Generic taps */
+    printf(" PASS\n");
+}
+
+static void test_pointwise(void) {
+    printf("  test_pointwise...");
+    ConvBlockedShape s = make_shape(2, 12, 5, 7, 9, 1, 1, 0, 1);
+    size_t in_n = in_numel(&s), out_n = out_numel(&s), w_n = 9 * 12, hw = 35;
+    float *in = malloc(in_n * sizeof(float)), *w = malloc(w_n * sizeof(float));
+    float *bias = malloc(9 * sizeof(float)), *out = malloc(out_n * sizeof(float));
+    float *gout = malloc(out_n * sizeof(float)), *gin = calloc(in_n, sizeof(float));
+    float* gw = calloc(w_n, sizeof(float));
+    fill(in, in_n, 0.3f);
+    fill(w, w_n, 0.8f);
+    fill(bias, 9, 1.9f);
+    fill(gout, out_n, 2.4f);
+
+    assert(cml_conv_pointwise_applicable(&s, 1));
+    assert(cml_conv2d_pointwise(NULL, in, w, bias, out, &s) == 0);
+    assert(cml_conv2d_pointwise_backward(NULL, in, w, gout, gin, gw, &s) == 0);
+    for (int b = 0; b < 2; b++)
+        for (size_t p = 0; p < hw; p++) {
+            for (int oc = 0; oc < 9; oc++) {
+                float sum = bias[oc];
+                for (int ic = 0; ic < 12; ic++)
+                    sum += w[oc * 12 + ic] * in[((size_t)b * 12 + ic) * hw + p];
+                assert(fabsf(out[((size_t)b * 9 + oc) * hw + p] - sum) < 1e-4f);
+            }
+            for (int ic = 0; ic < 12; ic++) {
+                float sum = 0.0f;
+                for (int oc = 0; oc < 9; oc++)
+                    sum += w[oc * 12 + ic] * gout[((size_t)b * 9 + oc) * hw + p];
+                assert(fabsf(gin[((size_t)b * 12 + ic) * hw + p] - sum) < 1e-4f);
+            }
+        }
+    for (int oc = 0; oc < 9; oc++)
+        for (int ic = 0; ic < 12; ic++) {
+            float sum = 0.0f;
+            for (int b = 0; b < 2; b++)
+                for (size_t p = 0; p < hw; p++)
+                    sum += gout[((size_t)b * 9 + oc) * hw + p] * in[((size_t)b * 12 + ic) * hw + p];
+            assert(fabsf(gw[oc * 12 + ic] - sum) < 1e-3f);
+        }
+    free(in); free(w); free(bias); free(out); free(gout); free(gin); free(gw);
+    printf(" PASS\n");
+}
+
+/* The banded depthwise -> pointwise pass matches running them one by one */
+static void test_depthwise_pointwise_fused(void) {
+    printf("  test_depthwise_pointwise_fused...");
+    ConvBlockedShape dw = make_shape(2, 24, 30, 30, 24, 3, 2, 1, 1);
+    ConvBlockedShape pw = make_shape(2, 24, dw.out_h, dw.out_w, 40, 1, 1, 0, 1);
+    size_t mid_n = out_numel(&dw), out_n = out_numel(&pw);
+    float *in = malloc(in_numel(&dw) * sizeof(float)), *dw_w = malloc(24 * 9 * sizeof(float));
+    float *dw_b = malloc(24 * sizeof(float)), *pw_w = malloc(40 * 24 * sizeof(float));
+    float *pw_b = malloc(40 * sizeof(float)), *mid = malloc(mid_n * sizeof(float));
+    float *out = malloc(out_n * sizeof(float)), *mid_ref = malloc(mid_n * sizeof(float));
+    float* out_ref = malloc(out_n * sizeof(float));
+    fill(in, in_numel(&dw), 0.5f);
+    fill(dw_w, 24 * 9, 1.1f);
+    fill(dw_b, 24, 0.2f);
+    fill(pw_w, 40 * 24, 2.6f);
+    fill(pw_b, 40, 0.9f);
+
+    assert(cml_conv2d_depthwise(in, dw_w, dw_b, mid_ref, &dw) == 0);
+    assert(cml_conv2d_pointwise(NULL, mid_ref, pw_w, pw_b, out_ref, &pw) == 0);
+    assert(cml_conv2d_depthwise_pointwise(NULL, in, dw_w, dw_b, mid, &dw, pw_w, pw_b, out, 40) ==
+           0);
+    assert(max_diff(mid, mid_ref, mid_n) < 1e-5f);
+    assert(max_diff(out, out_ref, out_n) < 1e-4f);
+
+    free(in); free(dw_w); free(dw_b); free(pw_w); free(pw_b);
+    free(mid); free(out); free(mid_ref); free(out_ref);
+    cml_conv_separable_cleanup();
+    printf(" PASS\n");
+}
+
+/* A depthwise Conv2d layer trains through the graph: bias and weight get
+ * gradients, and the input gradient matches the reference */
+static void test_depthwise_layer_backward(void) {
+    printf("  test_depthwise_layer_backward...");
+    Conv2d* conv = nn_conv2d_grouped(4, 4, 3, 1, 1, 1, 4, true, DTYPE_FLOAT32, DEVICE_CPU);
+    assert(conv && conv->weight->tensor->shape[1] == 1);
+    ConvBlockedShape s = make_shape(1, 4, 6, 6, 4, 3, 1, 1, 1);
+    int shape[4]       = {1, 4, 6, 6};
+    TensorConfig cfg   = {.dtype = DTYPE_FLOAT32, .device = DEVICE_CPU, .has_dtype = true,
+                          .has_device = true};
+    Tensor* x = tensor_empty(shape, 4, &cfg);
+    fill((float*)tensor_data_ptr(x), 144, 0.6f);
+    x->requires_grad = true;
+
+    Tensor* y    = module_forward((Module*)conv, x);
+    Tensor* loss = tensor_sum(y, -1, false);
+    assert(y && loss);
+    tensor_backward(loss, NULL, false, false);
+
+    float *ones = malloc(144 * sizeof(float)), *ref = malloc(144 * sizeof(float));
+    float *gin = malloc(144 * sizeof(float)), *gw = malloc(36 * sizeof(float));
+    for (int i = 0; i < 144; i++)
+        ones[i] = 1.0f;
+    const float* w = (const float*)tensor_data_ptr(conv->weight->tensor);
+    depthwise_reference((const float*)tensor_data_ptr(x), w, NULL, ones, ref, gin, gw, &s);
+    assert(x->grad && max_diff((const float*)tensor_data_ptr(x->grad), gin, 144) < 1e-4f);
+    assert(conv->weight->tensor->grad &&
+           max_diff((const float*)tensor_data_ptr(conv->weight->tensor->grad), gw, 36) < 1e-3f);
+    const float* gb = (const float*)tensor_data_ptr(conv->bias->tensor->grad);
+    for (int c = 0; c < 4; c++)
+        assert(fabsf(gb[c] - 36.0f) < 1e-4f);
+
+    free(ones); free(ref); free(gin); free(gw);
+    tensor_free(loss);
+    tensor_free(y);
+    tensor_free(x);
+    module_free((Module*)conv);
+    printf(" PASS\n");
+}
+
+/* dw -> pw layers back to back hit the fused executor path */
+static void test_depthwise_pointwise_graph(void) {
+    printf("  test_depthwise_pointwise_graph...");
+    Conv2d* dwc = nn_conv2d_grouped(8, 8, 3, 1, 1, 1, 8, true, DTYPE_FLOAT32, DEVICE_CPU);
+    Conv2d* pwc = nn_conv2d(8, 16, 1, 1, 0, 1, true, DTYPE_FLOAT32, DEVICE_CPU);
+    fill((float*)tensor_data_ptr(pwc->bias->tensor), 16, 0.3f);
+    ConvBlockedShape dw = make_shape(2, 8, 10, 10, 8, 3, 1, 1, 1);
+    ConvBlockedShape pw = make_shape(2, 8, 10, 10, 16, 1, 1, 0, 1);
+    int shape[4]        = {2, 8, 10, 10};
+    TensorConfig cfg    = {.dtype = DTYPE_FLOAT32, .device = DEVICE_CPU, .has_dtype = true,
+                           .has_device = true};
+    Tensor* x = tensor_empty(shape, 4, &cfg);
+    fill((float*)tensor_data_ptr(x), 1600, 1.4f);
+
+    Tensor* mid = module_forward((Module*)dwc, x);
+    Tensor* y   = module_forward((Module*)pwc, mid);
+    assert(y);
+    tensor_ensure_executed(y);
+
+    float *mid_ref = malloc(1600 * sizeof(float)), *ref = malloc(3200 * sizeof(float));
+    assert(cml_conv2d_depthwise(tensor_data_ptr(x), tensor_data_ptr(dwc->weight->tensor),
+                                tensor_data_ptr(dwc->bias->tensor), mid_ref, &dw) == 0);
+    assert(cml_conv2d_pointwise(NULL, mid_ref, tensor_data_ptr(pwc->weight->tensor),
+                                tensor_data_ptr(pwc->bias->tensor), ref, &pw) == 0);
+    assert(max_diff((const float*)tensor_data_ptr(mid), mid_ref, 1600) < 1e-5f);
+    assert(max_diff((const float*)tensor_data_ptr(y), ref, 3200) < 1e-4f);
+
+    free(mid_ref); free(ref);
+    tensor_free(y);
+    tensor_free(mid);
+    tensor_free(x);
+    module_free((Module*)dwc);
+    module_free((Module*)pwc);
+    printf(" PASS\n");
+}
+
+/* A pointwise bias still pending when the graph runs must not be dropped by the fusion */
+static void test_depthwise_pointwise_lazy_bias(void) {
+    printf("  test_depthwise_pointwise_lazy_bias...");
+    Conv2d* dwc = nn_conv2d_grouped(8, 8, 3, 1, 1, 1, 8, true, DTYPE_FLOAT32, DEVICE_CPU);
+    Conv2d* pwc = nn_conv2d(8, 16, 1, 1, 0, 1, true, DTYPE_FLOAT32, DEVICE_CPU);
+    fill((float*)tensor_data_ptr(pwc->bias->tensor), 16, 0.3f);
+    ConvBlockedShape dw = make_shape(2, 8, 10, 10, 8, 3, 1, 1, 1);
+    ConvBlockedShape pw = make_shape(2, 8, 10, 10, 16, 1, 1, 0, 1);
+    int shape[4]        = {2, 8, 10, 10};
+    TensorConfig cfg    = {.dtype = DTYPE_FLOAT32, .device = DEVICE_CPU, .has_dtype = true,
+                           .has_device = true};
+    Tensor* x = tensor_empty(shape, 4, &cfg);
+    fill((float*)tensor_data_ptr(x), 1600, 1.4f);
+
+    Tensor* bias = uop_add(pwc->bias->tensor, pwc->bias->tensor);
+    Tensor* mid  = module_forward((Module*)dwc, x);
+    int kernel[2] = {1, 1}, stride[2] = {1, 1}, padding[2] = {0, 0}, dilation[2] = {1, 1};
+    Conv2DParams params = {.kernel_size = kernel, .stride = stride, .padding = padding,
+                           .dilation = dilation, .groups = 1, .bias = true};
+    Tensor* y = uop_conv2d(mid, pwc->weight->tensor, bias, &params);
+    assert(y);
+    tensor_ensure_executed(y);
+
+    float *mid_ref = malloc(1600 * sizeof(float)), *ref = malloc(3200 * sizeof(float));
+    float bias_ref[16];
+    fill(bias_ref, 16, 0.3f);
+    for (int i = 0; i < 16; i++)
+        bias_ref[i] *= 2.0f;
+    assert(cml_conv2d_depthwise(tensor_data_ptr(x), tensor_data_ptr(dwc->weight->tensor),
+                                tensor_data_ptr(dwc->bias->tensor), mid_ref, &dw) == 0);
+    assert(cml_conv2d_pointwise(NULL, mid_ref, tensor_data_ptr(pwc->weight->tensor), bias_ref,
+                                ref, &pw) == 0);
+    assert(max_diff((const float*)tensor_data_ptr(y), ref, 3200) < 1e-4f);
+
+    free(mid_ref); free(ref);
+    tensor_free(y);
+    tensor_free(mid);
+    tensor_free(bias);
+    tensor_free(x);
+    module_free((Module*)dwc);
+    module_free((Module*)pwc);
+    printf(" PASS\n");
+}
+
+int main(void) {
+    printf("Separable Convolution Tests\n");
+    cml_init();
+
+    test_depthwise_shapes();
+    test_pointwise();
+    test_depthwise_pointwise_fused();
+    test_depthwise_layer_backward();
+    test_depthwise_pointwise_graph();
+    test_depthwise_pointwise_lazy_bias();
+
+    cml_cleanup();
+    printf("All separable convolution tests passed.\n");
+    return 0;
+}
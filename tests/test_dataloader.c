@@ -0,0 +1,193 @@
+/*
+ * Tests for the DataLoader: multi-worker prefetch order and coverage,
+ * epoch resets, batch buffer recycling, drop_last and teardown.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cml.h"
+#include "core/dataset.h"
+
+static int tests_run    = 0;
+static int tests_passed = 0;
+
+#define RUN_TEST(test) do { \
+    tests_run++; \
+    printf("  [%d] %-55s ", tests_run, #test); \
+    if (test()) { tests_passed++; printf("PASS\n"); } \
+    else { printf("FAIL\n"); } \
+} while(0)
+
+#define NUM_SAMPLES 103
+#define INPUT_SIZE 3
+
+/* Row i holds i in every feature and -i as its target */
+static Dataset* make_dataset(void) {
+    float X[NUM_SAMPLES * INPUT_SIZE], y[NUM_SAMPLES];
+    for (int i = 0; i < NUM_SAMPLES; i++) {
+        for (int j = 0; j < INPUT_SIZE; j++)
+            X[i * INPUT_SIZE + j] = (float)i;
+        y[i] = -(float)i;
+    }
+    return dataset_from_arrays(X, y, NUM_SAMPLES, INPUT_SIZE, 1);
+}
+
+/* Fixed permutation so loaders with and without workers agree */
+static void set_permutation(DataLoader* loader) {
+    for (int i = 0; i < NUM_SAMPLES; i++)
+        loader->shuffled_indices[i] = (i * 37 + 11) % NUM_SAMPLES;
+}
+
+/* Appends each sample id in the epoch to ids; returns the count or -1 */
+static int drain_epoch(DataLoader* loader, int* ids, int* num_batches) {
+    int n = 0, expected_idx = 0;
+    *num_batches = 0;
+    Batch* batch;
+    while ((batch = dataloader_next_batch(loader)) != NULL) {
+        const float* X = (const float*)tensor_data_ptr(batch->X);
+        const float* y = (const float*)tensor_data_ptr(batch->y);
+        if (batch->batch_index != expected_idx++ || !X || !y) {
+            batch_free(batch);
+            return -1;
+        }
+        for (int r = 0; r < batch->batch_size; r++) {
+            if (X[r * INPUT_SIZE + INPUT_SIZE - 1] != X[r * INPUT_SIZE] || y[r] != -X[r * INPUT_SIZE]) {
+                batch_free(batch);
+                return -1;
+            }
+            ids[n++] = (int)X[r * INPUT_SIZE];
+        }
+        (*num_batches)++;
+        batch_free(batch);
+    }
+    return n;
+}
+
+static int test_workers_match_sequential_order(void) {
+    Dataset* ds       = make_dataset();
+    DataLoader* seq   = dataloader_create(ds, 8, false);
+    DataLoader* multi = dataloader_create_with_workers(ds, 8, false, 4);
+    set_permutation(seq);
+    set_permutation(multi);
+    /* Workers start prefetching at creation; restart with the new order */
+    dataloader_reset(multi);
+
+    int a[NUM_SAMPLES], b[NUM_SAMPLES], nb_a, nb_b;
+    int ok = multi && multi->num_active_workers == 4 &&
+             drain_epoch(seq, a, &nb_a) == NUM_SAMPLES &&
+             drain_epoch(multi, b, &nb_b) == NUM_SAMPLES && nb_a == 13 && nb_b == 13 &&
+             memcmp(a, b, sizeof(a)) == 0;
+    for (int i = 0; ok && i < NUM_SAMPLES; i++)
+        ok = a[i] == (i * 37 + 11) % NUM_SAMPLES;
+
+    dataloader_free(seq);
+    dataloader_free(multi);
+    dataset_free(ds);
+    return ok;
+}
+
+static int test_every_sample_once_per_epoch(void) {
+    Dataset* ds        = make_dataset();
+    DataLoader* loader = dataloader_create_with_workers(ds, 10, true, 3);
+
+    int ok = loader != NULL;
+    for (int epoch = 0; ok && epoch < 4; epoch++) {
+        int ids[NUM_SAMPLES], seen[NUM_SAMPLES] = {0}, nb;
+        ok = drain_epoch(loader, ids, &nb) == NUM_SAMPLES && nb == 11 &&
+             !dataloader_has_next(loader) && dataloader_next_batch(loader) == NULL;
+        for (int i = 0; ok && i < NUM_SAMPLES; i++)
+            ok = ids[i] >= 0 && ids[i] < NUM_SAMPLES && seen[ids[i]]++ == 0;
+        ok = ok && dataloader_reset(loader) == 0 && loader->current_epoch == epoch + 1;
+    }
+
+    dataloader_free(loader);
+    dataset_free(ds);
+    return ok;
+}
+
+static int test_reset_mid_epoch(void) {
+    Dataset* ds        = make_dataset();
+    DataLoader* loader = dataloader_create_with_workers(ds, 4, false, 2);
+    set_permutation(loader);
+
+    /* Abandon the epoch with prefetched batches still queued */
+    Batch* first = dataloader_next_batch(loader);
+    int ok       = first && first->batch_index == 0;
+    batch_free(first);
+    ok = ok && dataloader_reset(loader) == 0;
+
+    int ids[NUM_SAMPLES], nb;
+    ok = ok && drain_epoch(loader, ids, &nb) == NUM_SAMPLES && nb == 26 &&
+         ids[0] == 11;
+
+    dataloader_free(loader);
+    dataset_free(ds);
+    return ok;
+}
+
+static int test_batches_are_recycled(void) {
+    Dataset* ds        = make_dataset();
+    DataLoader* loader = dataloader_create(ds, 16, false);
+
+    Batch* b0     = dataloader_next_batch(loader);
+    Tensor* x0    = b0 ? b0->X : NULL;
+    float* data0  = b0 ? (float*)tensor_data_ptr(b0->X) : NULL;
+    batch_free(b0);
+    Batch* b1 = dataloader_next_batch(loader);
+
+    /* Same buffers, refilled with the next batch's rows */
+    int ok = b1 && b1->X == x0 && tensor_data_ptr(b1->X) == data0 && b1->batch_index == 1 &&
+             data0[0] == 16.0f;
+    batch_free(b1);
+
+    dataloader_free(loader);
+    dataset_free(ds);
+    return ok;
+}
+
+static int test_drop_last(void) {
+    Dataset* ds   = make_dataset();
+    int ok        = 1;
+    for (int workers = 0; ok && workers <= 2; workers += 2) {
+        DataLoader* loader = dataloader_create_with_workers(ds, 10, false, workers);
+        loader->drop_last  = true;
+
+        int ids[NUM_SAMPLES], nb;
+        ok = drain_epoch(loader, ids, &nb) == 100 && nb == 10 && !dataloader_has_next(loader);
+        dataloader_free(loader);
+    }
+    dataset_free(ds);
+    return ok;
+}
+
+static int test_batches_outlive_loader(void) {
+    Dataset* ds        = make_dataset();
+    DataLoader* loader = dataloader_create_with_workers(ds, 8, false, 2);
+
+    Batch* held[3];
+    for (int i = 0; i < 3; i++)
+        held[i] = dataloader_next_batch(loader);
+    dataloader_free(loader);
+
+    int ok = 1;
+    for (int i = 0; i < 3; i++) {
+        ok = ok && held[i] && ((float*)tensor_data_ptr(held[i]->X))[0] == (float)(i * 8);
+        batch_free(held[i]);
+    }
+    dataset_free(ds);
+    return ok;
+}
+
+int main(void) {
+    printf("=== DataLoader Tests ===\n\n");
+
+    RUN_TEST(test_workers_match_sequential_order);
+    RUN_TEST(test_every_sample_once_per_epoch);
+    RUN_TEST(test_reset_mid_epoch);
+    RUN_TEST(test_batches_are_recycled);
+    RUN_TEST(test_drop_last);
+    RUN_TEST(test_batches_outlive_loader);
+
+    printf("\n%d/%d tests passed\n", tests_passed, tests_run);
+    return (tests_passed == tests_run) ? 0 : 1;
+}
@@ -3,12 +3,18 @@
 #include <stdbool.h>
 #include <string.h>
 #include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
 
 #include "cml.h"
 #include "nn/layers/linear.h"
 #include "distributed/distributed.h"
 #include "distributed/comm_backend.h"
 #include "distributed/data_parallel.h"
+#include "distributed/ring_allreduce.h"
+#include "distributed/shm_transport.h"
 #include "distributed/pipeline_parallel.h"
 #include "distributed/tensor_parallel.h"
 
@@ -261,6 +267,216 @@ static bool test_allreduce_async_single(void) {
 }
 
 
+/* In-process ranks for cml_ring_allreduce: one thread per rank, a Unix
+ * socketpair per rank pair, framed as tag + element count + payload. */
+#define FAKE_MAX_RANKS 8
+
+typedef struct {
+    int fds[FAKE_MAX_RANKS];
+    int rank;
+    int world_size;
+    float* data;
+    size_t count;
+    DistReduceOp op;
+    DistCommOps* ops;
+    bool split;    /* Reduce-scatter then all-gather instead of allreduce */
+    bool chunk_ok; /* After the reduce-scatter, the own chunk was reduced */
+    int result;
+} FakeRank;
+
+static int fake_io(int fd, void* buf, size_t len, bool is_send) {
+    char* p = (char*)buf;
+    while (len > 0) {
+        ssize_t n = is_send ? send(fd, p, len, 0) : recv(fd, p, len, 0);
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int fake_send(Tensor* t, int dst, int tag, void* ctx) {
+    int fd = ((FakeRank*)ctx)->fds[dst];
+    size_t n = t->numel;
+    return fake_io(fd, &tag, sizeof(tag), true) || fake_io(fd, &n, sizeof(n), true) ||
+           fake_io(fd, t->data, n * sizeof(float), true) ? -1 : 0;
+}
+
+static int fake_recv(Tensor* t, int src, int tag, void* ctx) {
+    int fd = ((FakeRank*)ctx)->fds[src];
+    int got_tag; size_t n;
+    if (fake_io(fd, &got_tag, sizeof(got_tag), false) || fake_io(fd, &n, sizeof(n), false) ||
+        got_tag != tag || n != t->numel)
+        return -1;
+    return fake_io(fd, t->data, n * sizeof(float), false);
+}
+
+static float fake_value(size_t i, int rank) {
+    return (float)((int)((i * 7 + (size_t)rank * 13) % 17) - 8);
+}
+
+static float fake_expected(size_t i, int world_size, DistReduceOp op) {
+    float want = fake_value(i, 0);
+    for (int r = 1; r < world_size; r++) {
+        float v = fake_value(i, r);
+        if (op == DIST_REDUCE_MAX) want = v > want ? v : want;
+        else want += v;
+    }
+    return op == DIST_REDUCE_AVG ? want / (float)world_size : want;
+}
+
+static void* fake_rank_main(void* arg) {
+    FakeRank* r = (FakeRank*)arg;
+    if (!r->split) {
+        r->result = cml_ring_allreduce(r->data, r->count, r->world_size, r->rank, r->op, r->ops, r);
+        cml_ring_release(r);
+        return NULL;
+    }
+    r->result = cml_ring_reduce_scatter(r->data, r->count, r->world_size, r->rank, r->op,
+                                        r->ops, r);
+    size_t chunk = (r->count + (size_t)r->world_size - 1) / (size_t)r->world_size;
+    r->chunk_ok  = r->result == 0;
+    for (size_t j = (size_t)r->rank * chunk; r->chunk_ok && j < r->count &&
+                                              j < (size_t)(r->rank + 1) * chunk; j++)
+        r->chunk_ok = float_eq(r->data[j], fake_expected(j, r->world_size, r->op));
+    if (r->result == 0)
+        r->result = cml_ring_allgather(r->data, r->count, r->world_size, r->rank, r->ops, r);
+    cml_ring_release(r);
+    return NULL;
+}
+
+static bool run_fake_ring(int world_size, size_t count, DistReduceOp op, bool split) {
+    DistCommOps ops = {0};
+    ops.send = fake_send;
+    ops.recv = fake_recv;
+
+    FakeRank ranks[FAKE_MAX_RANKS];
+    memset(ranks, 0, sizeof(ranks));
+    for (int i = 0; i < world_size; i++) {
+        ranks[i].rank = i;
+        ranks[i].world_size = world_size;
+        ranks[i].count = count;
+        ranks[i].op = op;
+        ranks[i].ops = &ops;
+        ranks[i].split = split;
+        ranks[i].data = malloc(count * sizeof(float) + 1);
+        for (size_t j = 0; j < count; j++)
+            ranks[i].data[j] = fake_value(j, i);
+        for (int k = i + 1; k < world_size; k++) {
+            int sv[2];
+            socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+            ranks[i].fds[k] = sv[0];
+            ranks[k].fds[i] = sv[1];
+        }
+    }
+
+    pthread_t threads[FAKE_MAX_RANKS];
+    for (int i = 0; i < world_size; i++)
+        pthread_create(&threads[i], NULL, fake_rank_main, &ranks[i]);
+    for (int i = 0; i < world_size; i++)
+        pthread_join(threads[i], NULL);
+
+    bool ok = true;
+    for (int i = 0; i < world_size; i++) {
+        ok = ok && ranks[i].result == 0 && (!split || ranks[i].chunk_ok);
+        for (size_t j = 0; ok && j < count; j++)
+            ok = float_eq(ranks[i].data[j], fake_expected(j, world_size, op));
+    }
+
+    for (int i = 0; i < world_size; i++) {
+        for (int k = 0; k < world_size; k++)
+            if (k != i) close(ranks[i].fds[k]);
+        free(ranks[i].data);
+    }
+    return ok;
+}
+
+static bool run_fake_allreduce(int world_size, size_t count, DistReduceOp op) {
+    return run_fake_ring(world_size, count, op, false);
+}
+
+static bool test_ring_allreduce_small(void) {
+    /* Recursive doubling, including the fold for non-power-of-two worlds */
+    return run_fake_allreduce(2, 1000, DIST_REDUCE_SUM) &&
+           run_fake_allreduce(3, 1000, DIST_REDUCE_SUM) &&
+           run_fake_allreduce(4, 7, DIST_REDUCE_MAX) &&
+           run_fake_allreduce(5, 3, DIST_REDUCE_AVG);
+}
+
+static bool test_ring_allreduce_pipelined(void) {
+    /* Chunks far beyond the socket buffers, uneven tail, several segments */
+    return run_fake_allreduce(2, 300001, DIST_REDUCE_SUM) &&
+           run_fake_allreduce(3, 600007, DIST_REDUCE_AVG) &&
+           run_fake_allreduce(4, 250000, DIST_REDUCE_MAX);
+}
+
+static bool test_ring_reduce_scatter_allgather(void) {
+    /* Own chunk reduced after the first half, everything after the second;
+     * short last chunk, empty chunks, several segments */
+    return run_fake_ring(2, 1001, DIST_REDUCE_SUM, true) &&
+           run_fake_ring(4, 3, DIST_REDUCE_AVG, true) &&
+           run_fake_ring(3, 400003, DIST_REDUCE_AVG, true);
+}
+
+typedef struct {
+    int local_rank;
+    size_t len;
+    int result;
+} ShmPeer;
+
+static void* shm_peer_main(void* arg) {
+    ShmPeer* p = (ShmPeer*)arg;
+    CMLShmTransport* shm = cml_shm_open("/cml-test-shm", p->local_rank, 2, 4096);
+    unsigned char* buf = malloc(p->len);
+    int ok = shm && buf;
+    if (ok && p->local_rank == 0) {
+        for (size_t i = 0; i < p->len; i++)
+            buf[i] = (unsigned char)(i * 31 + 7);
+        ok = cml_shm_send(shm, 1, buf, p->len) == 0 && cml_shm_recv(shm, 1, buf, 1) == 0 &&
+             buf[0] == 0xab;
+    } else if (ok) {
+        ok = cml_shm_recv(shm, 0, buf, p->len) == 0;
+        for (size_t i = 0; ok && i < p->len; i++)
+            ok = buf[i] == (unsigned char)(i * 31 + 7);
+        buf[0] = 0xab;
+        ok = ok && cml_shm_send(shm, 0, buf, 1) == 0;
+    }
+    /* The ack orders rank 1's attach before rank 0 unlinks */
+    cml_shm_free(shm);
+    free(buf);
+    p->result = ok;
+    return NULL;
+}
+
+static bool test_shm_transport_stream(void) {
+    /* Odd length through a 4 KiB ring: many wraps and partial copies */
+    ShmPeer peers[2] = {{0, 3 * 1024 * 1024 + 13, 0}, {1, 3 * 1024 * 1024 + 13, 0}};
+    pthread_t threads[2];
+    for (int i = 0; i < 2; i++)
+        pthread_create(&threads[i], NULL, shm_peer_main, &peers[i]);
+    for (int i = 0; i < 2; i++)
+        pthread_join(threads[i], NULL);
+    return peers[0].result && peers[1].result && access("/dev/shm/cml-test-shm", F_OK) != 0;
+}
+
+static bool test_shm_transport_dead_peer(void) {
+    /* Rank 1 attaches and dies without closing; rank 0 must not wait on it */
+    CMLShmTransport* shm = cml_shm_open("/cml-test-shm-dead", 0, 2, 4096);
+    if (!shm) return false;
+    pid_t pid = fork();
+    if (pid == 0)
+        _exit(cml_shm_open("/cml-test-shm-dead", 1, 2, 4096) ? 0 : 1);
+    int status = 1;
+    waitpid(pid, &status, 0);
+
+    static unsigned char buf[8192];
+    bool ok = pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0 &&
+              cml_shm_recv(shm, 1, buf, 1) == -1 &&
+              cml_shm_send(shm, 1, buf, sizeof(buf)) == -1;
+    cml_shm_free(shm);
+    return ok;
+}
+
 static bool test_gloo_backend_create(void) {
     DistCommOps* ops = cml_dist_create_gloo_backend();
     if (!ops) return false;
@@ -373,6 +589,170 @@ static bool test_pipeline_forward(void) {
 }
 
 
+/* Stage s is Linear(4, 4), the last one Linear(4, 2); weights fixed so the
+ * reference and every process agree */
+static void make_pipe_stages(Linear** layers, PipelineStage* stages, int n) {
+    for (int s = 0; s < n; s++) {
+        layers[s] = nn_linear(4, s == n - 1 ? 2 : 4, DTYPE_FLOAT32, DEVICE_CPU, true);
+        Parameter* params[2] = {layers[s]->weight, layers[s]->bias};
+        for (int p = 0; p < 2; p++) {
+            float* w = (float*)tensor_data_ptr(params[p]->tensor);
+            for (size_t j = 0; j < params[p]->tensor->numel; j++)
+                w[j] = 0.4f * sinf(1.3f * (float)j + 0.7f * (float)(2 * s + p));
+        }
+        stages[s] = (PipelineStage){.module = &layers[s]->base, .device = DEVICE_CPU,
+                                    .stage_id = s};
+    }
+}
+
+static void free_pipe_stages(Linear** layers, int n) {
+    for (int s = 0; s < n; s++)
+        module_free(&layers[s]->base);
+}
+
+static void make_pipe_batch(Tensor** X, Tensor** Y) {
+    float x[32], y[16];
+    for (int i = 0; i < 32; i++) x[i] = cosf(0.37f * (float)i);
+    for (int i = 0; i < 16; i++) y[i] = 0.1f * (float)(i % 5);
+    *X = make_tensor_2d(x, 8, 4);
+    *Y = make_tensor_2d(y, 8, 2);
+}
+
+static Tensor* pipe_mse(Tensor* output, Tensor* target, void* ctx) {
+    (void)ctx;
+    return tensor_mse_loss(output, target);
+}
+
+/* Whole-batch loss and gradients without the pipeline */
+static float pipe_reference(int n, float grads[][2][16]) {
+    Linear* layers[4]; PipelineStage stages[4];
+    make_pipe_stages(layers, stages, n);
+    Tensor *X, *Y;
+    make_pipe_batch(&X, &Y);
+    Tensor* acts[5] = {X};
+    for (int s = 0; s < n; s++)
+        acts[s + 1] = module_forward(stages[s].module, acts[s]);
+    Tensor* loss = tensor_mse_loss(acts[n], Y);
+    tensor_backward(loss, NULL, false, false);
+    float value = tensor_get_float(loss, 0);
+    for (int s = 0; s < n; s++) {
+        Parameter* params[2] = {layers[s]->weight, layers[s]->bias};
+        for (int p = 0; p < 2; p++)
+            memcpy(grads[s][p], params[p]->tensor->grad->data,
+                   params[p]->tensor->numel * sizeof(float));
+    }
+    tensor_free(loss);
+    for (int s = n; s > 0; s--)
+        tensor_free(acts[s]);
+    tensor_free(X);
+    tensor_free(Y);
+    cml_ir_reset_global_context();
+    free_pipe_stages(layers, n);
+    return value;
+}
+
+/* Runs two train steps (gradients accumulate) and checks the stages this
+ * worker owns against twice the reference; 0 on success */
+static int check_pipe_step(PipelineSchedule schedule, int n, int num_workers, int rank) {
+    float expected[4][2][16];
+    float ref_loss = pipe_reference(n, expected);
+
+    Linear* layers[4]; PipelineStage stages[4];
+    make_pipe_stages(layers, stages, n);
+    PipelineConfig config = {.num_micro_batches = 4, .num_stages = n, .schedule = schedule,
+                             .num_workers = num_workers};
+    CMLPipelineParallel* pipeline = cml_pipeline_create(stages, n, &config);
+    Tensor *X, *Y;
+    make_pipe_batch(&X, &Y);
+
+    int status = pipeline ? 0 : 10;
+    float loss = -1.0f;
+    for (int step = 0; status == 0 && step < 2; step++)
+        if (cml_pipeline_train_step(pipeline, X, Y, pipe_mse, NULL, &loss) != 0)
+            status = 11;
+
+    bool has_last = rank < 0 || (n - 1) % num_workers == rank;
+    if (status == 0 && has_last && !float_eq(loss, ref_loss))
+        status = 12;
+    for (int s = 0; status == 0 && s < n; s++) {
+        if (rank >= 0 && s % num_workers != rank)
+            continue;
+        Parameter* params[2] = {layers[s]->weight, layers[s]->bias};
+        for (int p = 0; status == 0 && p < 2; p++) {
+            const float* g = params[p]->tensor->grad
+                                 ? (const float*)params[p]->tensor->grad->data : NULL;
+            for (size_t j = 0; status == 0 && j < params[p]->tensor->numel; j++)
+                if (!g || !float_eq(g[j], 2.0f * expected[s][p][j])) status = 13;
+        }
+    }
+
+    PipelineStats stats;
+    if (status == 0 && (cml_pipeline_get_stats(pipeline, &stats) != 0 ||
+                        stats.step_ms <= 0.0 || stats.bubble_fraction < 0.0 ||
+                        stats.bubble_fraction >= 1.0))
+        status = 14;
+
+    tensor_free(X);
+    tensor_free(Y);
+    cml_pipeline_free(pipeline);
+    free_pipe_stages(layers, n);
+    return status;
+}
+
+static int count_in_flight(const PipelineOp* ops, int n) {
+    int live = 0, peak = 0;
+    for (int i = 0; i < n; i++) {
+        live += ops[i].type == PIPELINE_OP_FORWARD ? 1 : -1;
+        if (live > peak) peak = live;
+    }
+    return peak;
+}
+
+static bool test_pipeline_schedules(void) {
+    PipelineOp ops[64];
+    bool ok = true;
+
+    /* 1F1B: worker w keeps at most P - w micro-batches alive, GPipe all M */
+    for (int w = 0; w < 4; w++) {
+        int n = cml_pipeline_build_schedule(PIPELINE_SCHEDULE_1F1B, 4, 4, 8, w, ops, 64);
+        ok = ok && n == 16 && count_in_flight(ops, n) == 4 - w;
+        ok = ok && ops[0].type == PIPELINE_OP_FORWARD && ops[0].stage == w &&
+             ops[n - 1].type == PIPELINE_OP_BACKWARD && ops[n - 1].micro_batch == 7;
+        n = cml_pipeline_build_schedule(PIPELINE_SCHEDULE_GPIPE, 4, 4, 8, w, ops, 64);
+        ok = ok && n == 16 && count_in_flight(ops, n) == 8;
+    }
+
+    /* Interleaved: 2 workers x 2 chunks, every (stage, micro-batch) once each way */
+    for (int w = 0; w < 2; w++) {
+        int n = cml_pipeline_build_schedule(PIPELINE_SCHEDULE_INTERLEAVED, 4, 2, 4, w, ops, 64);
+        int seen[2][4][4] = {{{0}}};
+        ok = ok && n == 16;
+        for (int i = 0; ok && i < n; i++) {
+            ok = ops[i].stage % 2 == w;
+            seen[ops[i].type][ops[i].stage][ops[i].micro_batch]++;
+        }
+        for (int s = w; ok && s < 4; s += 2)
+            for (int mb = 0; mb < 4; mb++)
+                ok = ok && seen[0][s][mb] == 1 && seen[1][s][mb] == 1;
+    }
+
+    /* Too small a buffer, or stages not divisible by workers */
+    ok = ok && cml_pipeline_build_schedule(PIPELINE_SCHEDULE_1F1B, 4, 4, 8, 0, ops, 8) < 0;
+    ok = ok && cml_pipeline_build_schedule(PIPELINE_SCHEDULE_INTERLEAVED, 3, 2, 4, 0, ops,
+                                           64) < 0;
+    return ok;
+}
+
+static bool test_pipeline_train_1f1b(void) {
+    return check_pipe_step(PIPELINE_SCHEDULE_1F1B, 4, 4, -1) == 0 &&
+           check_pipe_step(PIPELINE_SCHEDULE_GPIPE, 2, 2, -1) == 0;
+}
+
+static bool test_pipeline_train_interleaved(void) {
+    return check_pipe_step(PIPELINE_SCHEDULE_INTERLEAVED, 4, 2, -1) == 0;
+}
+
+
 static bool test_ddp_create_free(void) {
     int ret = cml_dist_init(DIST_BACKEND_GLOO, 1, 0);
     if (ret != 0) return false;
@@ -456,6 +836,379 @@ static bool test_ddp_sync_gradients_single(void) {
 }
 
 
+/* x -> Linear(4,3) -> Linear(3,2), weights fixed so every process agrees */
+static Sequential* make_mlp(Parameter*** params, int* num_params) {
+    Sequential* model = cml_nn_sequential();
+    sequential_add(model, (Module*)cml_nn_linear(4, 3, DTYPE_FLOAT32, DEVICE_CPU, true));
+    sequential_add(model, (Module*)cml_nn_linear(3, 2, DTYPE_FLOAT32, DEVICE_CPU, true));
+    module_set_training((Module*)model, true);
+    *params = NULL;
+    module_collect_parameters((Module*)model, params, num_params, true);
+    for (int i = 0; i < *num_params; i++) {
+        float* w = (float*)tensor_data_ptr((*params)[i]->tensor);
+        for (size_t j = 0; j < (*params)[i]->tensor->numel; j++)
+            w[j] = 0.3f * sinf(1.7f * (float)j + (float)i);
+    }
+    return model;
+}
+
+/* One forward/backward of an MSE loss on an input that depends on seed */
+static void run_backward(Module* model, int seed) {
+    float x[8], y[4] = {0};
+    for (int i = 0; i < 8; i++)
+        x[i] = cosf(0.9f * (float)i + 2.1f * (float)seed);
+    Tensor* X = make_tensor_2d(x, 2, 4);
+    Tensor* Y = make_tensor_2d(y, 2, 2);
+    Tensor* out  = module_forward(model, X);
+    Tensor* loss = tensor_mse_loss(out, Y);
+    tensor_backward(loss, NULL, false, false);
+    tensor_free(loss);
+    tensor_free(out);
+    tensor_free(X);
+    tensor_free(Y);
+    cml_ir_reset_global_context();
+}
+
+static float grad_sum(Tensor* t) {
+    float s = 0.0f;
+    const float* g = t->grad ? (const float*)t->grad->data : NULL;
+    for (size_t j = 0; g && j < t->numel; j++)
+        s += g[j];
+    return s;
+}
+
+typedef struct {
+    int order[8];
+    float sums[8];
+    int fired;
+    Parameter** params;
+} HookLog;
+
+static HookLog g_hook_log;
+
+static void record_ready(Tensor* t, void* ctx) {
+    int idx = (int)(size_t)ctx;
+    g_hook_log.sums[idx] = grad_sum(t);
+    g_hook_log.order[g_hook_log.fired++] = idx;
+}
+
+static bool test_grad_ready_hooks(void) {
+    Parameter** params; int n;
+    Sequential* model = make_mlp(&params, &n);
+    memset(&g_hook_log, 0, sizeof(g_hook_log));
+    for (int i = 0; i < n; i++)
+        tensor_register_grad_ready_hook(params[i]->tensor, record_ready, (void*)(size_t)i);
+
+    run_backward((Module*)model, 0);
+
+    /* Once each, last layer first, with the gradient already final */
+    bool ok = n == 4 && g_hook_log.fired == 4 &&
+              g_hook_log.order[0] >= 2 && g_hook_log.order[1] >= 2;
+    for (int i = 0; ok && i < n; i++)
+        ok = float_eq(g_hook_log.sums[i], grad_sum(params[i]->tensor));
+
+    for (int i = 0; i < n; i++)
+        tensor_remove_grad_ready_hook(params[i]->tensor, record_ready, (void*)(size_t)i);
+    run_backward((Module*)model, 0);
+    ok = ok && g_hook_log.fired == 4;
+
+    free(params);
+    module_free((Module*)model);
+    return ok;
+}
+
+/* Sharded Adam (clipped, L2 decay) through cml_ddp_step against the plain
+ * optimizer on the rank-averaged gradients; 0 on success */
+static int check_zero_step(int stage, int rank, int world_size) {
+    Parameter** ref_params; int n;
+    Sequential* ref    = make_mlp(&ref_params, &n);
+    Optimizer* ref_opt = optim_adam(ref_params, n, 0.05f, 0.01f, 0.9f, 0.999f, 1e-8f);
+    optimizer_set_grad_clip_norm(ref_opt, 0.5f);
+
+    Parameter** params;
+    Sequential* model = make_mlp(&params, &n);
+    Optimizer* opt    = optim_adam(params, n, 0.05f, 0.01f, 0.9f, 0.999f, 1e-8f);
+    optimizer_set_grad_clip_norm(opt, 0.5f);
+    DDPConfig config = cml_ddp_default_config();
+    config.bucket_size_bytes = 8 * sizeof(float); /* Parameters straddle shard edges */
+    config.zero_stage        = stage;
+    CMLDataParallel* ddp = cml_ddp_create((Module*)model, &config);
+    int status = ddp && cml_ddp_shard_optimizer(ddp, opt) == 0 ? 0 : 3;
+
+    /* Each rank holds a world_size-th of the state */
+    size_t total = 0;
+    for (int i = 0; i < n; i++)
+        total += params[i]->tensor->numel;
+    if (status == 0 && (ddp->shard_numel * (size_t)world_size < total ||
+                        ddp->shard_numel > total / (size_t)world_size + (size_t)ddp->num_buckets))
+        status = 4;
+    if (status == 0 && cml_ddp_sync_gradients(ddp) == 0)
+        status = 5; /* Sharded DDP only steps through cml_ddp_step */
+
+    for (int step = 0; status == 0 && step < 3; step++) {
+        float expected[64] = {0};
+        for (int r = 0; r < world_size; r++) {
+            for (int i = 0; i < n; i++)
+                tensor_zero_grad(ref_params[i]->tensor);
+            run_backward((Module*)ref, r + 3 * step);
+            size_t off = 0;
+            for (int i = 0; i < n; i++) {
+                const float* g = (const float*)ref_params[i]->tensor->grad->data;
+                for (size_t j = 0; j < ref_params[i]->tensor->numel; j++)
+                    expected[off++] += g[j] / (float)world_size;
+            }
+        }
+        size_t off = 0;
+        for (int i = 0; i < n; i++) {
+            float* g = (float*)ref_params[i]->tensor->grad->data;
+            for (size_t j = 0; j < ref_params[i]->tensor->numel; j++)
+                g[j] = expected[off++];
+        }
+        optimizer_step(ref_opt);
+
+        optimizer_zero_grad(opt);
+        run_backward((Module*)model, rank + 3 * step);
+        uint64_t version0 = params[0]->tensor->version;
+        if (cml_ddp_step(ddp) != 0)
+            status = 6;
+        if (status == 0 && params[0]->tensor->version == version0)
+            status = 9; /* Version-keyed caches would keep the old weights */
+        for (int i = 0; status == 0 && i < n; i++) {
+            const float* want = (const float*)tensor_data_ptr(ref_params[i]->tensor);
+            const float* got  = (const float*)tensor_data_ptr(params[i]->tensor);
+            for (size_t j = 0; status == 0 && j < params[i]->tensor->numel; j++)
+                if (!float_eq(got[j], want[j])) status = 7;
+            if (stage >= 2 && params[i]->tensor->grad) status = 8;
+        }
+    }
+
+    cml_ddp_free(ddp);
+    optimizer_free(opt);
+    optimizer_free(ref_opt);
+    free(params);
+    free(ref_params);
+    module_free((Module*)model);
+    module_free((Module*)ref);
+    return status;
+}
+
+static bool test_zero_step_single(void) {
+    if (cml_dist_init(DIST_BACKEND_GLOO, 1, 0) != 0) return false;
+    bool ok = check_zero_step(1, 0, 1) == 0 && check_zero_step(2, 0, 1) == 0;
+    cml_dist_destroy();
+    return ok;
+}
+
+/* Rank body of the two-process test; exit status 0 on success */
+static int ddp_worker(int rank) {
+    if (cml_dist_init(DIST_BACKEND_GLOO, 2, rank) != 0)
+        return 2;
+
+    /* Expected: mean of both ranks' gradients, computed locally */
+    Parameter** ref_params; int n;
+    Sequential* ref = make_mlp(&ref_params, &n);
+    float expected[64] = {0};
+    for (int r = 0; r < 2; r++) {
+        for (int i = 0; i < n; i++)
+            tensor_zero_grad(ref_params[i]->tensor);
+        run_backward((Module*)ref, r);
+        size_t off = 0;
+        for (int i = 0; i < n; i++) {
+            const float* g = (const float*)ref_params[i]->tensor->grad->data;
+            for (size_t j = 0; j < ref_params[i]->tensor->numel; j++)
+                expected[off++] += 0.5f * g[j];
+        }
+    }
+
+    Parameter** params;
+    Sequential* model = make_mlp(&params, &n);
+    DDPConfig config = cml_ddp_default_config();
+    config.bucket_size_bytes = sizeof(float); /* One bucket per parameter */
+    CMLDataParallel* ddp = cml_ddp_create((Module*)model, &config);
+    int status = ddp && ddp->num_buckets == 4 ? 0 : 3;
+
+    for (int iter = 0; status == 0 && iter < 3; iter++) {
+        if (iter == 0) {
+            for (int i = 0; i < n; i++)
+                tensor_zero_grad(params[i]->tensor);
+        } else {
+            /* Swaps in fresh gradient tensors; the views must come back */
+            module_zero_grad((Module*)model);
+        }
+        if (iter == 2) {
+            /* ... already at the start of the step, not only once packed */
+            float x[4] = {0};
+            Tensor* X   = make_tensor_2d(x, 1, 4);
+            Tensor* out = cml_ddp_forward(ddp, X);
+            tensor_free(out);
+            tensor_free(X);
+            cml_ir_reset_global_context();
+            for (int i = 0; status == 0 && i < n; i++) {
+                Tensor* t = params[i]->tensor;
+                if (!t->grad ||
+                    t->grad->data != ddp->buckets[ddp->param_to_bucket[i]] + ddp->param_offsets[i])
+                    status = 8;
+                for (size_t j = 0; status == 0 && j < t->numel; j++)
+                    if (((const float*)t->grad->data)[j] != 0.0f) status = 9;
+            }
+        }
+        run_backward((Module*)model, rank);
+
+        /* Every bucket went out during backward */
+        if (ddp->next_launch != ddp->num_buckets) status = 4;
+        if (status == 0 && cml_ddp_sync_gradients(ddp) != 0) status = 5;
+
+        size_t off = 0;
+        for (int i = 0; status == 0 && i < n; i++) {
+            Tensor* t = params[i]->tensor;
+            if (t->grad->data != ddp->buckets[ddp->param_to_bucket[i]] + ddp->param_offsets[i])
+                status = 6;
+            const float* g = (const float*)t->grad->data;
+            for (size_t j = 0; status == 0 && j < t->numel; j++)
+                if (!float_eq(g[j], expected[off++])) status = 7;
+        }
+    }
+
+    cml_ddp_free(ddp);
+    free(params);
+    free(ref_params);
+    module_free((Module*)model);
+    module_free((Module*)ref);
+    cml_dist_destroy();
+    return status;
+}
+
+/* Re-runs this binary as world_size Gloo ranks: argv is
+ * <mode> <rank> <world_size> <hostname>; a NULL hostname keeps the real one. */
+static bool run_workers(const char* mode, int world_size, const char* const* hosts) {
+    static int launches = 0;
+    char port[16];
+    snprintf(port, sizeof(port), "%d", 30000 + (int)(getpid() % 2000) * 10 + launches);
+    launches += world_size;
+
+    pid_t pids[8];
+    for (int r = 0; r < world_size; r++) {
+        pids[r] = fork();
+        if (pids[r] == 0) {
+            char rank[4], world[4];
+            snprintf(rank, sizeof(rank), "%d", r);
+            snprintf(world, sizeof(world), "%d", world_size);
+            setenv("CML_GLOO_PORT", port, 1);
+            if (hosts && hosts[r])
+                setenv("CML_HOSTNAME", hosts[r], 1);
+            alarm(60);
+            execl("/proc/self/exe", "test_distributed", mode, rank, world, (char*)NULL);
+            _exit(127);
+        }
+        if (pids[r] < 0) return false;
+    }
+
+    bool ok = true;
+    for (int r = 0; r < world_size; r++) {
+        int status = 0;
+        waitpid(pids[r], &status, 0);
+        ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            printf("(rank %d status %d) ", r, WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+    }
+    return ok;
+}
+
+static bool test_ddp_overlap_two_ranks(void) {
+    return run_workers("--ddp-worker", 2, NULL);
+}
+
+/* Rank body of the shared-memory tests: allreduce through cml_dist_* on
+ * the small (tree / recursive doubling) and pipelined paths */
+static int shm_worker(int rank, int world_size) {
+    if (cml_dist_init(DIST_BACKEND_GLOO, world_size, rank) != 0)
+        return 2;
+
+    /* Ranks sharing this rank's host name */
+    const char* host = getenv("CML_HOSTNAME");
+    int expect_local = host && strncmp(host, "node", 4) == 0 ? atoi(host + 4) : 1;
+    int status = cml_dist_gloo_local_size() == expect_local ? 0 : 3;
+
+    const size_t sizes[] = {37, 300001};
+    const DistReduceOp reduce_ops[] = {DIST_REDUCE_SUM, DIST_REDUCE_AVG, DIST_REDUCE_MAX};
+    for (int s = 0; status == 0 && s < 2; s++) {
+        size_t n = sizes[s];
+        float* data = malloc(n * sizeof(float));
+        for (int o = 0; status == 0 && o < 3; o++) {
+            for (size_t i = 0; i < n; i++)
+                data[i] = fake_value(i, rank);
+            Tensor* t = make_tensor_1d(data, (int)n);
+            if (!t || cml_dist_allreduce(t, reduce_ops[o]) != 0)
+                status = 4;
+            const float* out = t ? (const float*)tensor_data_ptr(t) : NULL;
+            for (size_t i = 0; status == 0 && i < n; i++) {
+                float want = fake_value(i, 0);
+                for (int r = 1; r < world_size; r++) {
+                    float v = fake_value(i, r);
+                    want = reduce_ops[o] == DIST_REDUCE_MAX ? (v > want ? v : want) : want + v;
+                }
+                if (reduce_ops[o] == DIST_REDUCE_AVG) want /= (float)world_size;
+                if (!float_eq(out[i], want)) status = 5;
+            }
+            tensor_free(t);
+        }
+        free(data);
+    }
+
+    cml_dist_destroy();
+    return status;
+}
+
+static bool test_shm_allreduce_one_node(void) {
+    /* Host names encode how many ranks share them */
+    const char* hosts[] = {"node3", "node3", "node3"};
+    return run_workers("--shm-worker", 3, hosts);
+}
+
+static bool test_shm_allreduce_hierarchical(void) {
+    /* Interleaved placement: node leaders are ranks 0 and 1 */
+    const char* hosts[] = {"node3-a", "node2-b", "node3-a", "node2-b", "node3-a"};
+    return run_workers("--shm-worker", 5, hosts);
+}
+
+
+/* Rank body of the pipeline tests: one pipeline worker per rank */
+static int pipe_worker(const char* mode, int rank, int world_size) {
+    if (cml_dist_init(DIST_BACKEND_GLOO, world_size, rank) != 0)
+        return 2;
+    int status = strcmp(mode, "--pipe-1f1b-worker") == 0
+                     ? check_pipe_step(PIPELINE_SCHEDULE_1F1B, world_size, world_size, rank)
+                     : check_pipe_step(PIPELINE_SCHEDULE_INTERLEAVED, 2 * world_size,
+                                       world_size, rank);
+    cml_dist_destroy();
+    return status;
+}
+
+static bool test_pipeline_1f1b_ranks(void) {
+    return run_workers("--pipe-1f1b-worker", 2, NULL);
+}
+
+static bool test_pipeline_interleaved_ranks(void) {
+    return run_workers("--pipe-interleaved-worker", 2, NULL);
+}
+
+
+/* Rank body of the ZeRO tests: stage 1, then stage 2 */
+static int zero_worker(int rank, int world_size) {
+    if (cml_dist_init(DIST_BACKEND_GLOO, world_size, rank) != 0)
+        return 2;
+    int status = check_zero_step(1, rank, world_size);
+    if (status == 0)
+        status = check_zero_step(2, rank, world_size);
+    cml_dist_destroy();
+    return status;
+}
+
+static bool test_zero_sharded_ranks(void) {
+    return run_workers("--zero-worker", 2, NULL) && run_workers("--zero-worker", 3, NULL);
+}
+
+
 static bool test_ddp_default_config(void) {
     DDPConfig config = cml_ddp_default_config();
     return config.bucket_size_bytes == 25 * 1024 * 1024 &&
@@ -507,7 +1260,16 @@ static bool test_pipeline_null_stages(void) {
 }
 
 
-int main(void) {
+int main(int argc, char** argv) {
+    if (argc == 4 && strcmp(argv[1], "--ddp-worker") == 0)
+        return ddp_worker(atoi(argv[2]));
+    if (argc == 4 && strcmp(argv[1], "--shm-worker") == 0)
+        return shm_worker(atoi(argv[2]), atoi(argv[3]));
+    if (argc == 4 && strcmp(argv[1], "--zero-worker") == 0)
+        return zero_worker(atoi(argv[2]), atoi(argv[3]));
+    if (argc == 4 && strncmp(argv[1], "--pipe-", 7) == 0)
+        return pipe_worker(argv[1], atoi(argv[2]), atoi(argv[3]));
+
     printf("Distributed Training Tests\n\n");
 
     printf("Process group lifecycle:\n");
@@ -529,15 +1291,33 @@ int main(void) {
     printf("\nAsync operations:\n");
     TEST(allreduce_async_single);
 
+    printf("\nRing allreduce (in-process ranks):\n");
+    TEST(ring_allreduce_small);
+    TEST(ring_allreduce_pipelined);
+    TEST(ring_reduce_scatter_allgather);
+    TEST(shm_transport_stream);
+    TEST(shm_transport_dead_peer);
+
     printf("\nPipeline parallel:\n");
     TEST(pipeline_create_free);
     TEST(pipeline_forward);
+    TEST(pipeline_schedules);
+    TEST(pipeline_train_1f1b);
+    TEST(pipeline_train_interleaved);
 
     printf("\nData parallel (DDP):\n");
     TEST(ddp_default_config);
     TEST(ddp_create_free);
     TEST(ddp_forward);
     TEST(ddp_sync_gradients_single);
+    TEST(grad_ready_hooks);
+    TEST(ddp_overlap_two_ranks);
+    TEST(shm_allreduce_one_node);
+    TEST(shm_allreduce_hierarchical);
+    TEST(zero_step_single);
+    TEST(zero_sharded_ranks);
+    TEST(pipeline_1f1b_ranks);
+    TEST(pipeline_interleaved_ranks);
 
     printf("\nError handling:\n");
     TEST(allreduce_without_init);
@@ -2,8 +2,13 @@
 #include <stdlib.h>
 #include <string.h>
 #include "cml.h"
+#include <math.h>
 #include "ops/ir/schedule.h"
 #include "ops/ir/ir.h"
+#include "ops/ir/internal.h"
+#include "ops/ir/context.h"
+#include "ops/ir/execution.h"
+#include "ops/ir/runtime_compiler.h"
 #include "ops/uops.h"
 #include "tensor/tensor.h"
 
@@ -386,9 +391,145 @@ static int test_fusion_group_colors(void) {
 }
 
 
+/* Fused execution (CML_FUSION_SCHEDULER=1 is set in main) */
+
+#define EXEC_N 4099 /* Not a multiple of any vector width */
+
+static float exec_x[EXEC_N];
+
+static Tensor* exec_input(float scale) {
+    float data[EXEC_N];
+    for (int i = 0; i < EXEC_N; i++)
+        data[i] = exec_x[i] * scale;
+    int shape[1] = {EXEC_N};
+    return tensor_from_data(data, shape, 1, NULL);
+}
+
+static int count_elided(CMLGraph_t g) {
+    int n = 0;
+    for (struct IRNode* node = g ? g->head : NULL; node; node = node->next)
+        n += node->is_elided;
+    return n;
+}
+
+static float gelu_ref(float x) {
+    float inner = 0.7978845608f * (x + 0.044715f * x * x * x);
+    return 0.5f * x * (1.0f + tanhf(inner));
+}
+
+static int close_enough(float got, float want) {
+    return fabsf(got - want) <= 1e-5f * (1.0f + fabsf(want));
+}
+
+static int test_fused_exec_gelu_chain(void) {
+    cml_ir_reset_global_context();
+    Tensor* x   = exec_input(1.0f);
+    Tensor* y   = uop_gelu(x);
+    float* out  = y ? (float*)tensor_data_ptr(y) : NULL;
+
+    int ok = out != NULL;
+    for (int i = 0; ok && i < EXEC_N; i++)
+        ok = close_enough(out[i], gelu_ref(exec_x[i]));
+
+    /* x^2, x^3, the fills and tanh never touch memory */
+    ok = ok && count_elided(cml_ir_get_or_create_context()) >= 8;
+
+    cml_ir_reset_global_context();
+    tensor_free(x);
+    return ok;
+}
+
+static int test_fused_exec_reuses_kernel(void) {
+    size_t compilations_before, compilations_after, hits_before, hits_after;
+    cml_runtime_compiler_stats(cml_ir_fusion_compiler(), &hits_before, NULL,
+                               &compilations_before);
+
+    cml_ir_reset_global_context();
+    Tensor* x  = exec_input(0.5f);
+    Tensor* y  = uop_gelu(x);
+    float* out = y ? (float*)tensor_data_ptr(y) : NULL;
+    int ok     = out != NULL && close_enough(out[17], gelu_ref(exec_x[17] * 0.5f));
+
+    cml_runtime_compiler_stats(cml_ir_fusion_compiler(), &hits_after, NULL,
+                               &compilations_after);
+    ok = ok && compilations_after == compilations_before && hits_after > hits_before;
+
+    cml_ir_reset_global_context();
+    tensor_free(x);
+    return ok;
+}
+
+static int test_fused_exec_keeps_shared_outputs(void) {
+    cml_ir_reset_global_context();
+    Tensor* a = exec_input(1.0f);
+    Tensor* b = exec_input(-0.25f);
+    Tensor* h = uop_mul(a, b);   /* Read by the reduction as well */
+    Tensor* z = uop_add(h, a);
+    Tensor* s = uop_sum(h, NULL);
+
+    float* sum = s ? (float*)tensor_data_ptr(s) : NULL;
+    double want = 0.0;
+    for (int i = 0; i < EXEC_N; i++)
+        want += (double)exec_x[i] * (exec_x[i] * -0.25f);
+    int ok = sum && fabs(sum[0] - want) <= 1e-3 * (1.0 + fabs(want));
+
+    float* zd = (float*)tensor_data_ptr(z);
+    for (int i = 0; ok && i < EXEC_N; i++)
+        ok = close_enough(zd[i], exec_x[i] * (exec_x[i] * -0.25f) + exec_x[i]);
+
+    cml_ir_reset_global_context();
+    tensor_free(a);
+    tensor_free(b);
+    return ok;
+}
+
+static int test_fused_exec_elided_read_on_demand(void) {
+    cml_ir_reset_global_context();
+    Tensor* a = exec_input(1.0f);
+    Tensor* t = uop_mul(a, a);
+    Tensor* y = uop_exp(uop_add(t, a));
+
+    float* yd = y ? (float*)tensor_data_ptr(y) : NULL;
+    int ok    = yd && t->ir_node && t->ir_node->is_elided && t->data == NULL;
+
+    /* The intermediate is recomputed when asked for */
+    float* td = ok ? (float*)tensor_data_ptr(t) : NULL;
+    ok = ok && td != NULL;
+    for (int i = 0; ok && i < EXEC_N; i++)
+        ok = close_enough(td[i], exec_x[i] * exec_x[i]) &&
+             close_enough(yd[i], expf(exec_x[i] * exec_x[i] + exec_x[i]));
+
+    cml_ir_reset_global_context();
+    tensor_free(a);
+    return ok;
+}
+
+static int test_fused_exec_scalar_broadcast(void) {
+    cml_ir_reset_global_context();
+    Tensor* a     = exec_input(1.0f);
+    float three   = 3.0f;
+    int shape1[1] = {1};
+    Tensor* c     = tensor_from_data(&three, shape1, 1, NULL);
+    Tensor* y     = uop_exp(uop_neg(uop_mul(a, c)));
+
+    float* yd = y ? (float*)tensor_data_ptr(y) : NULL;
+    int ok    = yd != NULL;
+    for (int i = 0; ok && i < EXEC_N; i++)
+        ok = close_enough(yd[i], expf(-(exec_x[i] * 3.0f)));
+
+    cml_ir_reset_global_context();
+    tensor_free(a);
+    tensor_free(c);
+    return ok;
+}
+
 int main(void) {
     printf("\ntest_fusion_scheduler\n\n");
 
+    setenv("CML_FUSION_SCHEDULER", "1", 1);
+    for (int i = 0; i < EXEC_N; i++)
+        exec_x[i] = (float)(i % 401 - 200) * 0.02f;
+
     RUN_TEST(test_fusion_create_empty);
     RUN_TEST(test_fusion_create_null);
     RUN_TEST(test_fusion_free_null);
@@ -406,6 +547,11 @@ int main(void) {
     RUN_TEST(test_fusion_execution_order);
     RUN_TEST(test_fusion_print);
     RUN_TEST(test_fusion_group_colors);
+    RUN_TEST(test_fused_exec_gelu_chain);
+    RUN_TEST(test_fused_exec_reuses_kernel);
+    RUN_TEST(test_fused_exec_keeps_shared_outputs);
+    RUN_TEST(test_fused_exec_elided_read_on_demand);
+    RUN_TEST(test_fused_exec_scalar_broadcast);
 
     printf("\n  Results: %d/%d passed\n\n", tests_passed, tests_run);
     return (tests_passed == tests_run) ? 0 : 1;
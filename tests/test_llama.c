@@ -6,6 +6,10 @@
 
 #include "cml.h"
 #include "nn/llama.h"
+#include "nn/paged_attention.h"
+#include "core/gguf.h"
+#include "core/gguf_quant.h"
+#include <unistd.h>
 
 static int tests_run = 0;
 static int tests_passed = 0;
@@ -438,6 +442,170 @@ static int test_model_gqa_config(void) {
 }
 
 
+/* Last-row logits of a fresh single-sequence forward over tokens */
+static int sequential_last_logits(CMLLLaMAModel* model, const int* tokens, int n,
+                                  float* out) {
+    cml_llama_reset(model);
+    Tensor* logits = cml_llama_forward(model, tokens, n);
+    if (!logits) return -1;
+    tensor_ensure_executed(logits);
+    const float* data = (const float*)tensor_data_ptr(logits);
+    int vocab = model->config.vocab_size;
+    memcpy(out, data + (size_t)(n - 1) * vocab, (size_t)vocab * sizeof(float));
+    tensor_free(logits);
+    return 0;
+}
+
+static int logits_close(const float* a, const float* b, int n) {
+    for (int i = 0; i < n; i++) {
+        if (fabsf(a[i] - b[i]) > 1e-3f * (1.0f + fabsf(b[i]))) return 0;
+    }
+    return 1;
+}
+
+static int test_forward_paged_matches_sequential(void) {
+    CMLLLaMAConfig cfg = tiny_test_config();
+    cfg.num_heads = 8;
+    cfg.num_kv_heads = 2;
+    cfg.hidden_size = 64;
+    CMLLLaMAModel* model = cml_llama_create(&cfg);
+    if (!model || init_model_random(model) != 0) { cml_llama_free(model); return 0; }
+
+    int head_dim = cfg.hidden_size / cfg.num_heads;
+    CMLPagedKVCache* caches[2];
+    int ids0[2], ids1[2];
+    const int* seq_ids[2] = {ids0, ids1};
+    int* ids[2] = {ids0, ids1};
+    for (int l = 0; l < 2; l++) {
+        caches[l] = cml_paged_kv_cache_create(8, 4, cfg.num_kv_heads, head_dim);
+        ids[l][0] = cml_paged_cache_init_sequence(caches[l]);
+        ids[l][1] = cml_paged_cache_init_sequence(caches[l]);
+    }
+
+    /* Sequence A is prefilled in two chunks while B prefills then decodes */
+    int a[] = {1, 5, 10, 3, 7};
+    int b[] = {2, 9, 4};
+    int step1[] = {1, 5, 10, 2, 9}, n1[] = {3, 2};
+    int step2[] = {3, 7, 4}, n2[] = {2, 1};
+
+    float paged[2 * 64], ref_a[64], ref_b[64];
+    int ok = cml_llama_forward_paged(model, caches, seq_ids, step1, n1, 2, paged) == 0 &&
+             cml_llama_forward_paged(model, caches, seq_ids, step2, n2, 2, paged) == 0 &&
+             caches[1]->sequences[ids1[0]].seq_len == 5 &&
+             caches[1]->sequences[ids1[1]].seq_len == 3;
+
+    ok = ok && sequential_last_logits(model, a, 5, ref_a) == 0 &&
+         sequential_last_logits(model, b, 3, ref_b) == 0 &&
+         logits_close(paged, ref_a, cfg.vocab_size) &&
+         logits_close(paged + cfg.vocab_size, ref_b, cfg.vocab_size);
+
+    cml_paged_kv_cache_free(caches[0]);
+    cml_paged_kv_cache_free(caches[1]);
+    cml_llama_free(model);
+    return ok;
+}
+static void gguf_put_tensor_info(FILE* f, const char* name, uint64_t ne0, uint64_t ne1,
+                                 uint32_t type, uint64_t offset) {
+    uint64_t len = strlen(name);
+    uint32_t ndim = 2;
+    fwrite(&len, 8, 1, f);
+    fwrite(name, 1, len, f);
+    fwrite(&ndim, 4, 1, f);
+    fwrite(&ne0, 8, 1, f);
+    fwrite(&ne1, 8, 1, f);
+    fwrite(&type, 4, 1, f);
+    fwrite(&offset, 8, 1, f);
+}
+
+/* y[m, out] = x[m, in] @ W^T for W stored as [out, in] rows */
+static void rows_reference(const float* x, const float* w, float* y, int m, int in, int out) {
+    for (int r = 0; r < m; r++)
+        for (int o = 0; o < out; o++) {
+            float sum = 0.0f;
+            for (int i = 0; i < in; i++)
+                sum += x[r * in + i] * w[o * in + i];
+            y[r * out + o] = sum;
+        }
+}
+
+static int close_to(const float* a, const float* b, int n, float tol) {
+    float scale = 0.0f;
+    for (int i = 0; i < n; i++) scale = fmaxf(scale, fabsf(b[i]));
+    for (int i = 0; i < n; i++)
+        if (fabsf(a[i] - b[i]) > tol * scale) return 0;
+    return 1;
+}
+
+/* A llama.cpp-style file mixing a Q8_0 projection (kept quantized) with an
+ * F32 one (float path): both must compute x @ W^T of the rows in the file */
+static int test_load_gguf_mixed_projections(void) {
+    enum { IN = 32, OUT = 64, M = 3 };
+    float gate[OUT * IN], up[OUT * IN];
+    uint8_t gate_q8[OUT * 34];
+    const float d = 0.0078125f; /* 2^-7, exact in fp16 */
+    for (int o = 0; o < OUT; o++) {
+        uint16_t d16 = 0x2000;
+        memcpy(gate_q8 + o * 34, &d16, 2);
+        for (int i = 0; i < IN; i++) {
+            int8_t q = (int8_t)((o * 7 + i * 13) % 61 - 30);
+            gate_q8[o * 34 + 2 + i] = (uint8_t)q;
+            gate[o * IN + i] = d * (float)q;
+            up[o * IN + i] = sinf(0.3f * (float)(o * IN + i));
+        }
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/cml_test_llama_%d.gguf", (int)getpid());
+    FILE* f = fopen(path, "wb");
+    if (!f) return 0;
+    uint32_t magic = GGUF_MAGIC, version = 3;
+    uint64_t n_tensors = 2, n_kv = 0;
+    fwrite(&magic, 4, 1, f);
+    fwrite(&version, 4, 1, f);
+    fwrite(&n_tensors, 8, 1, f);
+    fwrite(&n_kv, 8, 1, f);
+    uint64_t up_offset = (sizeof(gate_q8) + 31) & ~(uint64_t)31;
+    gguf_put_tensor_info(f, "blk.0.ffn_gate.weight", IN, OUT, GGUF_TENSOR_Q8_0, 0);
+    gguf_put_tensor_info(f, "blk.0.ffn_up.weight", IN, OUT, GGUF_TENSOR_F32, up_offset);
+    static const uint8_t zeros[32];
+    long pos = ftell(f);
+    fwrite(zeros, 1, (size_t)(((pos + 31) & ~31L) - pos), f);
+    fwrite(gate_q8, 1, sizeof(gate_q8), f);
+    fwrite(zeros, 1, (size_t)(up_offset - sizeof(gate_q8)), f);
+    fwrite(up, sizeof(float), OUT * IN, f);
+    fclose(f);
+
+    CMLLLaMAConfig cfg = tiny_test_config();
+    CMLLLaMAModel* model = cml_llama_create(&cfg);
+    int ok = model && cml_llama_load_gguf(model, path) == 0;
+    CMLLLaMALayer* layer = ok ? model->layers[0] : NULL;
+    ok = ok && layer->gate_proj_quant && layer->up_proj && !layer->up_proj_quant;
+
+    float x[M * IN], ref[M * OUT];
+    for (int i = 0; i < M * IN; i++) x[i] = cosf(0.7f * (float)i);
+    int x_shape[] = {M, IN};
+    TensorConfig tcfg = {.dtype = DTYPE_FLOAT32, .device = DEVICE_CPU,
+                         .has_dtype = true, .has_device = true};
+    Tensor* xt = tensor_from_data(x, x_shape, 2, &tcfg);
+    if (ok) {
+        Tensor* g = cml_quant_linear(xt, layer->gate_proj_quant);
+        rows_reference(x, gate, ref, M, IN, OUT);
+        ok = g && g->numel == M * OUT && close_to(tensor_data_ptr(g), ref, M * OUT, 2e-2f);
+        tensor_free(g);
+    }
+    if (ok) {
+        Tensor* u = uop_matmul(xt, layer->up_proj);
+        rows_reference(x, up, ref, M, IN, OUT);
+        ok = u && u->numel == M * OUT && close_to(tensor_data_ptr(u), ref, M * OUT, 1e-4f);
+        tensor_free(u);
+    }
+    tensor_free(xt);
+    cml_llama_free(model);
+    remove(path);
+    return ok;
+}
+
+
 int main(void) {
     printf("test_llama\n\n");
 
@@ -457,6 +625,8 @@ int main(void) {
     TEST(forward_single_token);
     TEST(forward_no_weights);
     TEST(forward_invalid_args);
+    TEST(forward_paged_matches_sequential);
+    TEST(load_gguf_mixed_projections);
 
     /* Sampling tests */
     TEST(sample_greedy);
@@ -547,6 +547,159 @@ static int test_moe_single_expert(void) {
 }
 
 
+/* Token-by-token MoE without capacity limits */
+static void moe_reference(CMLMoELayer* moe, const float* x, int T, float* out) {
+    int D = moe->config.input_dim, H = moe->config.hidden_dim;
+    int E = moe->config.num_experts, K = moe->config.top_k;
+    const float* gw = (const float*)tensor_data_ptr(moe->gate_weight);
+    float probs[16];
+    float* hidden = (float*)malloc((size_t)H * sizeof(float));
+
+    for (int t = 0; t < T; t++) {
+        const float* xt = x + t * D;
+        float mx = -1e30f, sum = 0.0f;
+        for (int e = 0; e < E; e++) {
+            probs[e] = 0.0f;
+            for (int d = 0; d < D; d++) probs[e] += xt[d] * gw[d * E + e];
+            if (probs[e] > mx) mx = probs[e];
+        }
+        for (int e = 0; e < E; e++) { probs[e] = expf(probs[e] - mx); sum += probs[e]; }
+        for (int e = 0; e < E; e++) probs[e] /= sum;
+
+        int idx[16];
+        float w[16], wsum = 0.0f;
+        for (int k = 0; k < K; k++) {
+            idx[k] = -1;
+            for (int e = 0; e < E; e++) {
+                int taken = 0;
+                for (int j = 0; j < k; j++) taken |= idx[j] == e;
+                if (!taken && (idx[k] < 0 || probs[e] > probs[idx[k]])) idx[k] = e;
+            }
+            w[k] = probs[idx[k]];
+            wsum += w[k];
+        }
+
+        for (int d = 0; d < D; d++) out[t * D + d] = 0.0f;
+        for (int k = 0; k < K; k++) {
+            const float* w1 = (const float*)tensor_data_ptr(moe->expert_w1[idx[k]]);
+            const float* w2 = (const float*)tensor_data_ptr(moe->expert_w2[idx[k]]);
+            for (int h = 0; h < H; h++) {
+                float acc = 0.0f;
+                for (int d = 0; d < D; d++) acc += xt[d] * w1[d * H + h];
+                hidden[h] = acc > 0.0f ? acc : 0.0f;
+            }
+            for (int d = 0; d < D; d++) {
+                float acc = 0.0f;
+                for (int h = 0; h < H; h++) acc += hidden[h] * w2[h * D + d];
+                out[t * D + d] += w[k] / wsum * acc;
+            }
+        }
+    }
+    free(hidden);
+}
+
+static int check_moe_matches_reference(int E, int D, int H, int batch, int seq, float tol) {
+    CMLMoEConfig cfg = {
+        .num_experts = E,
+        .top_k = 2,
+        .input_dim = D,
+        .hidden_dim = H,
+        .capacity_factor = 0.0f,
+        .normalize_weights = true
+    };
+
+    CMLMoELayer* moe = cml_moe_create(&cfg);
+    if (!moe) return 0;
+
+    int in_shape[] = {batch, seq, D};
+    TensorConfig tcfg = {.dtype = DTYPE_FLOAT32, .device = DEVICE_CPU,
+                         .has_dtype = true, .has_device = true};
+    Tensor* input = tensor_rand(in_shape, 3, &tcfg);
+    if (!input) { cml_moe_free(moe); return 0; }
+
+    Tensor* output = cml_moe_forward(moe, input);
+    if (!output) { tensor_free(input); cml_moe_free(moe); return 0; }
+
+    int T = batch * seq;
+    float* ref = (float*)malloc((size_t)T * D * sizeof(float));
+    moe_reference(moe, (const float*)tensor_data_ptr(input), T, ref);
+    const float* got = (const float*)tensor_data_ptr(output);
+
+    int ok = 1;
+    for (int i = 0; i < T * D && ok; i++) {
+        if (fabsf(got[i] - ref[i]) > tol * (1.0f + fabsf(ref[i]))) ok = 0;
+    }
+
+    /* No capacity limit: every assignment is computed */
+    CMLMoEStats stats;
+    int load[16], total = 0;
+    if (ok && cml_moe_get_stats(moe, &stats, load) != 0) ok = 0;
+    for (int e = 0; ok && e < E; e++) total += load[e];
+    if (ok && (stats.num_tokens != T || stats.num_routed != 2 * T || total != 2 * T ||
+               stats.num_dropped != 0 || stats.capacity != 0 || stats.imbalance < 1.0f))
+        ok = 0;
+
+    free(ref);
+    tensor_free(output);
+    tensor_free(input);
+    cml_moe_free(moe);
+    return ok;
+}
+
+static int test_moe_grouped_matches_reference(void) {
+    return check_moe_matches_reference(8, 32, 64, 3, 37, 1e-4f);
+}
+
+/* Experts big enough for the packed (multithreaded) GEMM path, run from
+ * inside the pool's expert tasks */
+static int test_moe_grouped_packed_experts(void) {
+    return check_moe_matches_reference(4, 256, 512, 2, 128, 1e-3f);
+}
+
+static int test_moe_capacity_drop(void) {
+    CMLMoEConfig cfg = {
+        .num_experts = 4,
+        .top_k = 1,
+        .input_dim = 8,
+        .hidden_dim = 16,
+        .capacity_factor = 1.0f,
+        .normalize_weights = true
+    };
+
+    CMLMoELayer* moe = cml_moe_create(&cfg);
+    if (!moe) return 0;
+
+    /* Identical tokens all pick the same expert; only capacity = 64 / 4 fit */
+    int in_shape[] = {1, 64, 8};
+    TensorConfig tcfg = {.dtype = DTYPE_FLOAT32, .device = DEVICE_CPU,
+                         .has_dtype = true, .has_device = true};
+    Tensor* input = tensor_ones(in_shape, 3, &tcfg);
+    if (!input) { cml_moe_free(moe); return 0; }
+
+    Tensor* output = cml_moe_forward(moe, input);
+    if (!output) { tensor_free(input); cml_moe_free(moe); return 0; }
+
+    CMLMoEStats stats;
+    int ok = cml_moe_get_stats(moe, &stats, NULL) == 0;
+    if (ok && (stats.capacity != 16 || stats.num_routed != 16 || stats.num_dropped != 48 ||
+               stats.max_load != 16 || stats.min_load != 0 || fabsf(stats.imbalance - 4.0f) > 1e-6f))
+        ok = 0;
+
+    /* Kept tokens get the expert output, dropped tokens pass through as zero */
+    const float* out = (const float*)tensor_data_ptr(output);
+    for (int t = 1; ok && t < 64; t++) {
+        for (int d = 0; d < 8; d++) {
+            float expect = t < 16 ? out[d] : 0.0f;
+            if (out[t * 8 + d] != expect) { ok = 0; break; }
+        }
+    }
+
+    tensor_free(output);
+    tensor_free(input);
+    cml_moe_free(moe);
+    return ok;
+}
+
 static int test_tokenizer_create_free(void) {
     char* vocab[] = {"a", "b", "c", "d", "ab", "cd", "abcd"};
     int vocab_size = 7;
@@ -716,6 +869,100 @@ static int test_tokenizer_bpe_merge(void) {
     return 1;
 }
 
+static int test_tokenizer_merge_rank(void) {
+    /* The lowest-ranked pair wins even when a later rule matches further left */
+    char* vocab[] = {"a", "b", "c", "ab", "bc"};
+    char* merges[] = {"bc", "ab"};
+
+    CMLTokenizer* tok = cml_tokenizer_create(vocab, 5, merges, 2);
+    if (!tok) return 0;
+
+    int num_tokens = 0;
+    int* ids = cml_tokenizer_encode(tok, "abcab", &num_tokens);
+    if (!ids) { cml_tokenizer_free(tok); return 0; }
+
+    /* a|bc|ab */
+    int ok = num_tokens == 3 && ids[0] == 0 && ids[1] == 4 && ids[2] == 3;
+
+    free(ids);
+    cml_tokenizer_free(tok);
+    return ok;
+}
+
+static int test_tokenizer_pretokenize(void) {
+    /* Merges stay inside a word; a single space leads the following word */
+    char* vocab[] = {"a", "b", " ", "ab", " a", "b ", " ab"};
+    char* merges[] = {"ab", " a", "b ", " ab"};
+
+    CMLTokenizer* tok = cml_tokenizer_create(vocab, 7, merges, 4);
+    if (!tok) return 0;
+
+    int num_tokens = 0;
+    int* ids = cml_tokenizer_encode(tok, "ab ab  ab", &num_tokens);
+    if (!ids) { cml_tokenizer_free(tok); return 0; }
+
+    /* "ab" | " ab" | " " | " ab" */
+    int ok = num_tokens == 4 && ids[0] == 3 && ids[1] == 6 && ids[2] == 2 && ids[3] == 6;
+
+    free(ids);
+    cml_tokenizer_free(tok);
+    return ok;
+}
+
+static int test_tokenizer_encode_batch(void) {
+    char* vocab[] = {"a", "b", "c", " ", "ab", "abc", " abc"};
+    char* merges[] = {"ab", "abc", " abc"};
+
+    CMLTokenizer* tok = cml_tokenizer_create(vocab, 7, merges, 3);
+    if (!tok) return 0;
+
+    /* Long prompt with repeated words goes through the word cache */
+    size_t long_len = 4 * 2000;
+    char* long_text = (char*)malloc(long_len + 1);
+    if (!long_text) { cml_tokenizer_free(tok); return 0; }
+    for (size_t i = 0; i < long_len; i += 4) memcpy(long_text + i, "abc ", 4);
+    long_text[long_len] = '\0';
+
+    const char* texts[] = {"abc abc", "", "cba", long_text};
+    int* tokens[4];
+    int counts[4];
+    int ok = cml_tokenizer_encode_batch(tok, texts, 4, tokens, counts) == 0;
+
+    for (int i = 0; ok && i < 4; i++) {
+        int n = 0;
+        int* ref = cml_tokenizer_encode(tok, texts[i], &n);
+        if (n != counts[i]) ok = 0;
+        for (int j = 0; ok && j < n; j++) {
+            if (ref[j] != tokens[i][j]) ok = 0;
+        }
+        free(ref);
+    }
+    /* "abc" then " abc" for each following word, one trailing " " */
+    if (ok && (counts[0] != 2 || counts[1] != 0 || tokens[1] != NULL || counts[3] != 2001))
+        ok = 0;
+    if (ok && (tokens[3][0] != 5 || tokens[3][1] != 6 || tokens[3][2000] != 3)) ok = 0;
+
+    for (int i = 0; i < 4; i++) free(tokens[i]);
+
+    /* A failed prompt leaves nothing allocated */
+    const char* bad[] = {"abc abc", NULL, long_text};
+    if (ok && cml_tokenizer_encode_batch(tok, bad, 3, tokens, counts) != -1) ok = 0;
+    for (int i = 0; ok && i < 3; i++)
+        if (tokens[i] != NULL || counts[i] != 0) ok = 0;
+
+    /* Caches freed by cleanup are rebuilt on the next encode */
+    cml_tokenizer_cleanup();
+    if (ok && cml_tokenizer_encode_batch(tok, texts, 4, tokens, counts) != 0) ok = 0;
+    if (ok && (counts[3] != 2001 || tokens[3][2000] != 3)) ok = 0;
+    if (ok)
+        for (int i = 0; i < 4; i++) free(tokens[i]);
+
+    free(long_text);
+    cml_tokenizer_free(tok);
+    cml_tokenizer_cleanup();
+    return ok;
+}
+
 
 int main(void) {
     printf("test_llm_ops\n\n");
@@ -741,6 +988,9 @@ int main(void) {
     TEST(moe_forward_shape);
     TEST(moe_routing);
     TEST(moe_single_expert);
+    TEST(moe_grouped_matches_reference);
+    TEST(moe_grouped_packed_experts);
+    TEST(moe_capacity_drop);
 
     /* Tokenizer */
     TEST(tokenizer_create_free);
@@ -751,6 +1001,9 @@ int main(void) {
     TEST(tokenizer_vocab_size);
     TEST(tokenizer_unknown_token);
     TEST(tokenizer_bpe_merge);
+    TEST(tokenizer_merge_rank);
+    TEST(tokenizer_pretokenize);
+    TEST(tokenizer_encode_batch);
 
     printf("\n%d/%d passed\n", tests_passed, tests_run);
     return (tests_passed == tests_run) ? 0 : 1;
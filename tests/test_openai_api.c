@@ -1,4 +1,8 @@
+/* Checks below are asserts; keep them in release builds */
+#undef NDEBUG
 #include "nn/openai_api.h"
+#include "nn/llama.h"
+#include "cml.h"
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -6,6 +10,7 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
@@ -132,6 +137,299 @@ static void test_404(void) {
     printf(" PASSED\n");
 }
 
+static int connect_to(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Reads one response off a keep-alive connection: up to the end of a
+ * Content-Length body or of a chunked stream */
+static int read_response(int fd, char* buf, size_t buf_size) {
+    size_t total = 0;
+    while (total < buf_size - 1) {
+        ssize_t n = recv(fd, buf + total, buf_size - 1 - total, 0);
+        if (n <= 0) break;
+        total += (size_t)n;
+        buf[total] = '\0';
+
+        char* body = strstr(buf, "\r\n\r\n");
+        if (!body) continue;
+        body += 4;
+        const char* cl = strstr(buf, "Content-Length: ");
+        if (cl && cl < body) {
+            if (total - (size_t)(body - buf) >= strtoul(cl + 16, NULL, 10)) break;
+        } else if (strstr(body, "\r\n0\r\n\r\n") || strncmp(body, "0\r\n\r\n", 5) == 0) {
+            break;
+        }
+    }
+    buf[total] = '\0';
+    return (int)total;
+}
+
+static void test_keep_alive(void) {
+    printf("  test_keep_alive...");
+
+    CMLOpenAIServer* srv = cml_openai_server_create(TEST_PORT + 3);
+    assert(srv != NULL);
+
+    pthread_t tid;
+    pthread_create(&tid, NULL, server_thread, srv);
+    usleep(100000);
+
+    int fd = connect_to(TEST_PORT + 3);
+    assert(fd >= 0);
+
+    /* Two pipelined requests, then a third after the answers */
+    const char* two = "GET /health HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                      "GET /v1/models HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    send(fd, two, strlen(two), 0);
+    char resp[8192];
+    assert(read_response(fd, resp, sizeof(resp)) > 0);
+    assert(strstr(resp, "\"status\":\"ok\"") != NULL);
+    assert(strstr(resp, "Connection: keep-alive") != NULL);
+    if (!strstr(resp, "\"object\":\"list\"")) {
+        assert(read_response(fd, resp, sizeof(resp)) > 0);
+        assert(strstr(resp, "\"object\":\"list\"") != NULL);
+    }
+
+    const char* third = "GET /health HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+    send(fd, third, strlen(third), 0);
+    assert(read_response(fd, resp, sizeof(resp)) > 0);
+    assert(strstr(resp, "Connection: close") != NULL);
+    close(fd);
+
+    cml_openai_server_stop(srv);
+    pthread_join(tid, NULL);
+    cml_openai_server_free(srv);
+
+    printf(" PASSED\n");
+}
+
+static void test_stalled_client_does_not_block(void) {
+    printf("  test_stalled_client_does_not_block...");
+
+    CMLOpenAIServer* srv = cml_openai_server_create(TEST_PORT + 4);
+    assert(srv != NULL);
+
+    pthread_t tid;
+    pthread_create(&tid, NULL, server_thread, srv);
+    usleep(100000);
+
+    /* Half a request that never completes */
+    int stalled = connect_to(TEST_PORT + 4);
+    assert(stalled >= 0);
+    const char* partial = "POST /v1/chat/completions HTTP/1.1\r\nContent-Length: 100\r\n\r\n{";
+    send(stalled, partial, strlen(partial), 0);
+    usleep(50000);
+
+    char resp[4096];
+    int n = http_get(TEST_PORT + 4, "/health", resp, sizeof(resp));
+    assert(n > 0);
+    assert(strstr(resp, "200 OK") != NULL);
+
+    close(stalled);
+    cml_openai_server_stop(srv);
+    pthread_join(tid, NULL);
+    cml_openai_server_free(srv);
+
+    printf(" PASSED\n");
+}
+
+/* Sends raw bytes on a fresh connection and reads until the server closes
+ * (or goes quiet for five seconds) */
+static int http_raw(int port, const char* req, char* resp_buf, size_t buf_size) {
+    int fd = connect_to(port);
+    if (fd < 0) return -1;
+    struct timeval tv = {.tv_sec = 5};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    send(fd, req, strlen(req), 0);
+
+    size_t total = 0;
+    while (total < buf_size - 1) {
+        ssize_t n = recv(fd, resp_buf + total, buf_size - 1 - total, 0);
+        if (n <= 0) break;
+        total += (size_t)n;
+    }
+    resp_buf[total] = '\0';
+    close(fd);
+    return (int)total;
+}
+
+static void test_bad_content_length(void) {
+    printf("  test_bad_content_length...");
+
+    CMLOpenAIServer* srv = cml_openai_server_create(TEST_PORT + 6);
+    assert(srv != NULL);
+
+    pthread_t tid;
+    pthread_create(&tid, NULL, server_thread, srv);
+    usleep(100000);
+
+    /* Unparseable lengths are a 400; ones that wrap header_len + body_len
+     * or exceed the buffer are a 413 */
+    const struct {
+        const char* value;
+        const char* status;
+    } cases[] = {
+        {"-1", "400"},
+        {"abc", "400"},
+        {"12abc", "400"},
+        {"", "400"},
+        {"18446744073709551615", "413"},
+        {"99999999999999999999999", "413"},
+        {"300000", "413"},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        char req[256], resp[4096];
+        snprintf(req, sizeof(req),
+                 "POST /v1/chat/completions HTTP/1.1\r\nContent-Length: %s\r\n\r\n{}",
+                 cases[i].value);
+        assert(http_raw(TEST_PORT + 6, req, resp, sizeof(resp)) > 0);
+        assert(strncmp(resp + 9, cases[i].status, 3) == 0);
+    }
+
+    /* The server is still answering */
+    char resp[4096];
+    assert(http_get(TEST_PORT + 6, "/health", resp, sizeof(resp)) > 0);
+    assert(strstr(resp, "200 OK") != NULL);
+
+    cml_openai_server_stop(srv);
+    pthread_join(tid, NULL);
+    cml_openai_server_free(srv);
+
+    printf(" PASSED\n");
+}
+
+/* Tiny random LLaMA with a byte-level tokenizer */
+static CMLLLaMAModel* tiny_model(void) {
+    CMLLLaMAConfig cfg = {
+        .vocab_size = 128, .hidden_size = 32, .intermediate_size = 64,
+        .num_layers = 2, .num_heads = 4, .num_kv_heads = 2,
+        .max_seq_len = 128, .rope_theta = 10000.0f, .rms_norm_eps = 1e-5f
+    };
+    CMLLLaMAModel* model = cml_llama_create(&cfg);
+    assert(model != NULL);
+
+    TensorConfig tc = {.dtype = DTYPE_FLOAT32, .device = DEVICE_CPU,
+                       .has_dtype = true, .has_device = true};
+    int head_dim = cfg.hidden_size / cfg.num_heads;
+    int h = cfg.hidden_size, kv = cfg.num_kv_heads * head_dim, ff = cfg.intermediate_size;
+    int embed[] = {cfg.vocab_size, h}, lm[] = {h, cfg.vocab_size}, norm[] = {h};
+    int q[] = {h, h}, k[] = {h, kv}, up[] = {h, ff}, down[] = {ff, h};
+
+    model->embed_tokens = tensor_rand(embed, 2, &tc);
+    model->lm_head = tensor_rand(lm, 2, &tc);
+    model->norm = tensor_ones(norm, 1, &tc);
+    for (int l = 0; l < cfg.num_layers; l++) {
+        CMLLLaMALayer* layer = model->layers[l];
+        layer->q_proj = tensor_rand(q, 2, &tc);
+        layer->k_proj = tensor_rand(k, 2, &tc);
+        layer->v_proj = tensor_rand(k, 2, &tc);
+        layer->o_proj = tensor_rand(q, 2, &tc);
+        layer->gate_proj = tensor_rand(up, 2, &tc);
+        layer->up_proj = tensor_rand(up, 2, &tc);
+        layer->down_proj = tensor_rand(down, 2, &tc);
+        layer->input_layernorm = tensor_ones(norm, 1, &tc);
+        layer->post_attn_layernorm = tensor_ones(norm, 1, &tc);
+    }
+    model->weights_loaded = true;
+
+    char* vocab[128];
+    char chars[128][2];
+    for (int i = 0; i < 128; i++) {
+        chars[i][0] = (char)(i ? i : ' ');
+        chars[i][1] = '\0';
+        vocab[i] = chars[i];
+    }
+    model->tokenizer = cml_tokenizer_create(vocab, 128, NULL, 0);
+    assert(model->tokenizer != NULL);
+    return model;
+}
+
+typedef struct {
+    int port;
+    bool stream;
+    int ok;
+} ChatClient;
+
+static void* chat_client(void* arg) {
+    ChatClient* cc = (ChatClient*)arg;
+    int fd = connect_to(cc->port);
+    if (fd < 0) return NULL;
+
+    char body[256];
+    int body_len = snprintf(body, sizeof(body),
+                            "{\"messages\":[{\"role\":\"user\",\"content\":\"hi\"}],"
+                            "\"max_tokens\":6,\"temperature\":0,\"stream\":%s}",
+                            cc->stream ? "true" : "false");
+    char req[512];
+    int req_len = snprintf(req, sizeof(req),
+                           "POST /v1/chat/completions HTTP/1.1\r\nHost: localhost\r\n"
+                           "Content-Type: application/json\r\nContent-Length: %d\r\n\r\n%s",
+                           body_len, body);
+
+    /* Two completions back to back on one connection */
+    char* resp = (char*)malloc(65536);
+    int ok = 1;
+    for (int r = 0; r < 2 && ok; r++) {
+        send(fd, req, (size_t)req_len, 0);
+        ok = read_response(fd, resp, 65536) > 0 && strstr(resp, "200 OK") != NULL;
+        if (cc->stream)
+            ok = ok && strstr(resp, "chat.completion.chunk") && strstr(resp, "data: [DONE]");
+        else
+            ok = ok && strstr(resp, "\"completion_tokens\":");
+    }
+    cc->ok = ok;
+    free(resp);
+    close(fd);
+    return NULL;
+}
+
+static void test_concurrent_chat_completions(void) {
+    printf("  test_concurrent_chat_completions...");
+
+    CMLOpenAIServer* srv = cml_openai_server_create(TEST_PORT + 5);
+    assert(srv != NULL);
+    CMLLLaMAModel* model = tiny_model();
+    srv->model = model;
+    srv->tokenizer = model->tokenizer;
+    srv->max_batch_size = 4;
+    srv->kv_cache_tokens = 256;
+
+    pthread_t tid;
+    pthread_create(&tid, NULL, server_thread, srv);
+    usleep(100000);
+
+    enum { CLIENTS = 6 };
+    ChatClient clients[CLIENTS];
+    pthread_t threads[CLIENTS];
+    for (int i = 0; i < CLIENTS; i++) {
+        clients[i] = (ChatClient){.port = TEST_PORT + 5, .stream = (i % 2) == 0, .ok = 0};
+        pthread_create(&threads[i], NULL, chat_client, &clients[i]);
+    }
+    for (int i = 0; i < CLIENTS; i++) {
+        pthread_join(threads[i], NULL);
+        assert(clients[i].ok);
+    }
+
+    cml_openai_server_stop(srv);
+    pthread_join(tid, NULL);
+    cml_openai_server_free(srv);
+
+    printf(" PASSED\n");
+}
+
 int main(void) {
     printf("Running OpenAI API tests:\n");
 
@@ -139,6 +437,10 @@ int main(void) {
     test_health_endpoint();
     test_models_endpoint();
     test_404();
+    test_keep_alive();
+    test_stalled_client_does_not_block();
+    test_bad_content_length();
+    test_concurrent_chat_completions();
 
     printf("All OpenAI API tests passed.\n");
     return 0;
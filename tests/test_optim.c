@@ -5,6 +5,8 @@
 #include <math.h>
 
 #include "cml.h"
+#include "autograd/amp.h"
+#include "tensor/realize.h"
 
 static int tests_run = 0;
 static int tests_passed = 0;
@@ -227,6 +229,164 @@ static int test_optim_for_model(void) {
     return 1;
 }
 
+/* Two models with identical weights, sized so AVX bodies and scalar tails both run */
+static void create_twin_models(Sequential** a, Sequential** b, Parameter*** pa, Parameter*** pb,
+                               int* num_params) {
+    Sequential* models[2];
+    Parameter** params[2];
+    for (int m = 0; m < 2; m++) {
+        models[m] = cml_nn_sequential();
+        sequential_add(models[m], (Module*)cml_nn_linear(13, 37, DTYPE_FLOAT32, DEVICE_CPU, true));
+        sequential_add(models[m], (Module*)cml_nn_linear(37, 5, DTYPE_FLOAT32, DEVICE_CPU, true));
+        params[m] = NULL;
+        module_collect_parameters((Module*)models[m], &params[m], num_params, true);
+    }
+    for (int i = 0; i < *num_params; i++) {
+        Tensor* src = params[0][i]->tensor;
+        memcpy(tensor_data_ptr(params[1][i]->tensor), tensor_data_ptr(src),
+               src->numel * sizeof(float));
+    }
+    *a = models[0]; *b = models[1];
+    *pa = params[0]; *pb = params[1];
+}
+
+/* Deterministic gradients for a given step, multiplied by scale */
+static void fill_grads(Parameter** params, int num_params, int step, float scale) {
+    for (int i = 0; i < num_params; i++) {
+        Tensor* t = params[i]->tensor;
+        if (!t->grad) {
+            TensorConfig cfg = {.dtype = DTYPE_FLOAT32, .device = DEVICE_CPU,
+                                .has_dtype = true, .has_device = true};
+            t->grad = tensor_zeros(t->shape, t->ndim, &cfg);
+            tensor_realize(t->grad);
+        }
+        float* g = (float*)tensor_data_ptr(t->grad);
+        for (size_t j = 0; j < t->numel; j++)
+            g[j] = scale * sinf(0.37f * (float)j + 1.3f * (float)i + 0.71f * (float)step);
+    }
+}
+
+static int params_close(Parameter** pa, Parameter** pb, int num_params) {
+    for (int i = 0; i < num_params; i++) {
+        const float* a = (const float*)tensor_data_ptr(pa[i]->tensor);
+        const float* b = (const float*)tensor_data_ptr(pb[i]->tensor);
+        for (size_t j = 0; j < pa[i]->tensor->numel; j++) {
+            if (fabsf(a[j] - b[j]) > 1e-4f * (1.0f + fabsf(a[j]))) return 0;
+        }
+    }
+    return 1;
+}
+
+typedef Optimizer* (*MakeOptFn)(Parameter** params, int num_params);
+
+static Optimizer* make_adam(Parameter** p, int n) {
+    Optimizer* opt = cml_optim_adam(p, n, 0.01f, 0.01f, 0.9f, 0.999f, 1e-8f);
+    optimizer_set_grad_clip_norm(opt, 0.5f);
+    optimizer_set_amsgrad(opt, true);
+    return opt;
+}
+
+static Optimizer* make_adamw(Parameter** p, int n) {
+    Optimizer* opt = cml_optim_adamw(p, n, 0.01f, 0.01f, 0.9f, 0.999f, 1e-8f);
+    optimizer_set_amsgrad(opt, true);
+    return opt;
+}
+
+static Optimizer* make_lamb(Parameter** p, int n) {
+    return cml_optim_lamb(p, n, 0.01f, 0.01f, 0.9f, 0.999f, 1e-6f);
+}
+
+static int flat_matches(MakeOptFn make) {
+    Sequential *ma, *mb; Parameter **pa, **pb; int n;
+    create_twin_models(&ma, &mb, &pa, &pb, &n);
+
+    Optimizer* ref  = make(pa, n);
+    Optimizer* flat = make(pb, n);
+    int ok = ref && flat && optimizer_set_flat(flat, true) == 0;
+    float w0 = ((float*)tensor_data_ptr(pa[0]->tensor))[0];
+    for (int step = 0; ok && step < 5; step++) {
+        fill_grads(pa, n, step, 1.0f);
+        fill_grads(pb, n, step, 1.0f);
+        optimizer_step(ref);
+        optimizer_step(flat);
+        ok = params_close(pa, pb, n);
+    }
+    ok = ok && optimizer_get_step_count(flat) == 5 &&
+         ((float*)tensor_data_ptr(pa[0]->tensor))[0] != w0;
+
+    optimizer_free(ref);
+    optimizer_free(flat);
+    free(pa); free(pb);
+    module_free((Module*)ma);
+    module_free((Module*)mb);
+    return ok;
+}
+
+static int test_flat_adam(void) { return flat_matches(make_adam); }
+static int test_flat_adamw(void) { return flat_matches(make_adamw); }
+static int test_flat_lamb(void) { return flat_matches(make_lamb); }
+
+static int test_flat_grad_scaler(void) {
+    Sequential *ma, *mb; Parameter **pa, **pb; int n;
+    create_twin_models(&ma, &mb, &pa, &pb, &n);
+
+    Optimizer* ref    = make_adam(pa, n);
+    Optimizer* flat   = make_adam(pb, n);
+    GradScaler* scaler = grad_scaler_create(1024.0f, 2.0f, 0.5f, 2000);
+    int ok = ref && flat && scaler && optimizer_set_flat(flat, true) == 0;
+    optimizer_set_grad_scaler(flat, scaler);
+
+    /* Scaled gradients unscale inside the step */
+    fill_grads(pa, n, 0, 1.0f);
+    fill_grads(pb, n, 0, 1024.0f);
+    optimizer_step(ref);
+    optimizer_step(flat);
+    ok = ok && !scaler->found_inf && params_close(pa, pb, n);
+
+    /* An inf anywhere skips the whole update */
+    fill_grads(pb, n, 1, 1024.0f);
+    ((float*)tensor_data_ptr(pb[n - 1]->tensor->grad))[0] = INFINITY;
+    optimizer_step(flat);
+    ok = ok && scaler->found_inf && params_close(pa, pb, n) &&
+         optimizer_get_step_count(flat) == 1;
+
+    optimizer_free(ref);
+    optimizer_free(flat);
+    grad_scaler_free(scaler);
+    free(pa); free(pb);
+    module_free((Module*)ma);
+    module_free((Module*)mb);
+    return ok;
+}
+
+static int test_flat_disable(void) {
+    Sequential* model; Parameter** params; int n;
+    create_test_model(&model, &params, &n);
+
+    Optimizer* opt = cml_optim_adamw(params, n, 0.01f, 0.0f, 0.9f, 0.999f, 1e-8f);
+    int ok = opt && optimizer_set_flat(opt, true) == 0 && !params[0]->tensor->owns_data;
+    fill_grads(params, n, 0, 1.0f);
+    optimizer_step(opt);
+
+    float before = ((float*)tensor_data_ptr(params[0]->tensor))[0];
+    ok = ok && optimizer_set_flat(opt, false) == 0 && params[0]->tensor->owns_data &&
+         params[0]->tensor->grad->owns_data &&
+         ((float*)tensor_data_ptr(params[0]->tensor))[0] == before;
+
+    /* Back on the per-tensor path */
+    optimizer_step(opt);
+    ok = ok && optimizer_get_step_count(opt) == 2;
+
+    Optimizer* sgd = cml_optim_sgd(params, n, 0.01f, 0.0f, 0.0f);
+    ok = ok && sgd && optimizer_set_flat(sgd, true) != 0;
+
+    optimizer_free(sgd);
+    optimizer_free(opt);
+    free(params);
+    module_free((Module*)model);
+    return ok;
+}
+
 int main(void) {
     cml_init();
 
@@ -243,6 +403,11 @@ int main(void) {
     TEST(zero_grad);
     TEST(optim_for_model);
     TEST(lr_scheduler_step);
+    TEST(flat_adam);
+    TEST(flat_adamw);
+    TEST(flat_lamb);
+    TEST(flat_grad_scaler);
+    TEST(flat_disable);
 
     printf("\n%d/%d passed\n", tests_passed, tests_run);
 
@@ -0,0 +1,179 @@
+/*
+ * Tests for the GGUF block-quantized matmul kernels: Q4_0 / Q8_0 / Q4_K
+ * against dequantize-then-multiply, batching, and the Tensor wrapper.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "cml.h"
+#include "core/gguf_quant.h"
+#include "backend/threadpool.h"
+
+static int tests_run    = 0;
+static int tests_passed = 0;
+
+#define RUN_TEST(test) do { \
+    tests_run++; \
+    printf("  [%d] %-55s ", tests_run, #test); \
+    if (test()) { tests_passed++; printf("PASS\n"); } \
+    else { printf("FAIL\n"); } \
+} while(0)
+
+/* Exact fp16 scales: 1.0, 0.5, 0.25, 0.125, 0.09375, 0.0625 */
+static const uint16_t HALF_SCALES[] = {0x3C00, 0x3800, 0x3400, 0x3000, 0x2E00, 0x2C00};
+
+static unsigned rng_state = 12345u;
+static unsigned rng(void) {
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 8;
+}
+static float rng_float(void) { return (float)(rng() % 20001) / 10000.0f - 1.0f; }
+
+static void* random_blocks(GGUFTensorType type, int rows, int cols) {
+    size_t nblocks = (size_t)rows * (size_t)(cols / gguf_quant_block_size(type));
+    size_t bsize   = gguf_quant_type_size(type);
+    uint8_t* data  = malloc(nblocks * bsize);
+    for (size_t i = 0; i < nblocks * bsize; i++)
+        data[i] = (uint8_t)rng();
+
+    /* Keep scales finite and in a sane range */
+    for (size_t b = 0; b < nblocks; b++) {
+        uint8_t* blk = data + b * bsize;
+        uint16_t d   = HALF_SCALES[rng() % 6];
+        memcpy(blk, &d, sizeof(d));
+        if (type == GGUF_TENSOR_Q4_K) {
+            uint16_t dmin = HALF_SCALES[rng() % 6];
+            memcpy(blk + 2, &dmin, sizeof(dmin));
+        }
+    }
+    return data;
+}
+
+/* Dequantize each row and multiply in double */
+static void reference_matmul(GGUFTensorType type, const void* blocks, int rows, int cols,
+                             const float* x, int m, double* y, double* mag) {
+    size_t row_bytes = (size_t)(cols / gguf_quant_block_size(type)) * gguf_quant_type_size(type);
+    float* wrow = malloc((size_t)cols * sizeof(float));
+    for (int r = 0; r < rows; r++) {
+        gguf_dequantize(type, (const uint8_t*)blocks + r * row_bytes, wrow, (size_t)cols);
+        for (int i = 0; i < m; i++) {
+            double s = 0.0, a = 0.0;
+            for (int k = 0; k < cols; k++) {
+                s += (double)wrow[k] * x[i * cols + k];
+                a += fabs((double)wrow[k] * x[i * cols + k]);
+            }
+            y[i * rows + r]   = s;
+            mag[i * rows + r] = a;
+        }
+    }
+    free(wrow);
+}
+
+static int check_type(GGUFTensorType type, int rows, int cols, int m) {
+    void* blocks = random_blocks(type, rows, cols);
+    float* x     = malloc((size_t)m * cols * sizeof(float));
+    for (int i = 0; i < m * cols; i++)
+        x[i] = rng_float();
+
+    CMLQuantWeight* w = cml_quant_weight_create(type, rows, cols, blocks);
+    float* y    = malloc((size_t)m * rows * sizeof(float));
+    double* ref = malloc((size_t)m * rows * sizeof(double));
+    double* mag = malloc((size_t)m * rows * sizeof(double));
+    reference_matmul(type, blocks, rows, cols, x, m, ref, mag);
+
+    /* Error budget: int8 activation rounding, relative to sum |w * x| */
+    int ok = w && cml_quant_matmul(w, x, y, m) == 0;
+    for (int i = 0; ok && i < m * rows; i++) {
+        if (fabs((double)y[i] - ref[i]) > 0.01 * mag[i] + 1e-3)
+            ok = 0;
+    }
+
+    cml_quant_weight_free(w);
+    free(blocks);
+    free(x);
+    free(y);
+    free(ref);
+    free(mag);
+    return ok;
+}
+
+static int test_q4_0_matches_dequantized(void) { return check_type(GGUF_TENSOR_Q4_0, 37, 128, 1); }
+static int test_q8_0_matches_dequantized(void) { return check_type(GGUF_TENSOR_Q8_0, 41, 96, 1); }
+static int test_q4_k_matches_dequantized(void) { return check_type(GGUF_TENSOR_Q4_K, 19, 512, 1); }
+static int test_batched_rows(void) { return check_type(GGUF_TENSOR_Q4_K, 300, 256, 7); }
+
+static int test_batch_equals_single_rows(void) {
+    /* Each output depends only on its own activation row */
+    const int rows = 64, cols = 256, m = 4;
+    void* blocks      = random_blocks(GGUF_TENSOR_Q4_0, rows, cols);
+    CMLQuantWeight* w = cml_quant_weight_create(GGUF_TENSOR_Q4_0, rows, cols, blocks);
+    float x[4 * 256], batched[4 * 64], single[64];
+    for (int i = 0; i < m * cols; i++)
+        x[i] = rng_float();
+
+    int ok = w && cml_quant_matmul(w, x, batched, m) == 0;
+    for (int i = 0; ok && i < m; i++) {
+        ok = cml_quant_matmul(w, x + i * cols, single, 1) == 0 &&
+             memcmp(single, batched + i * rows, sizeof(single)) == 0;
+    }
+    cml_quant_weight_free(w);
+    free(blocks);
+    return ok;
+}
+
+static int test_quant_linear_tensor(void) {
+    const int rows = 24, cols = 64;
+    void* blocks      = random_blocks(GGUF_TENSOR_Q8_0, rows, cols);
+    CMLQuantWeight* w = cml_quant_weight_create(GGUF_TENSOR_Q8_0, rows, cols, blocks);
+
+    float xd[2 * 3 * 64];
+    for (int i = 0; i < 2 * 3 * cols; i++)
+        xd[i] = rng_float();
+    int shape[3] = {2, 3, cols};
+    Tensor* x    = tensor_from_data(xd, shape, 3, NULL);
+    Tensor* y    = cml_quant_linear(x, w);
+
+    float expect[6 * 24];
+    int ok = y && y->ndim == 3 && y->shape[0] == 2 && y->shape[1] == 3 && y->shape[2] == rows &&
+             cml_quant_matmul(w, xd, expect, 6) == 0 &&
+             memcmp(tensor_data_ptr(y), expect, sizeof(expect)) == 0;
+
+    /* Width mismatch is rejected */
+    int bad_shape[2] = {1, 32};
+    Tensor* bad = tensor_zeros(bad_shape, 2, NULL);
+    ok = ok && cml_quant_linear(bad, w) == NULL;
+
+    tensor_free(bad);
+    tensor_free(y);
+    tensor_free(x);
+    cml_quant_weight_free(w);
+    free(blocks);
+    return ok;
+}
+
+static int test_unsupported_types(void) {
+    uint8_t dummy[256] = {0};
+    return !cml_quant_matmul_supported(GGUF_TENSOR_Q6_K) &&
+           cml_quant_weight_create(GGUF_TENSOR_Q6_K, 1, 256, dummy) == NULL &&
+           cml_quant_weight_create(GGUF_TENSOR_Q4_0, 1, 48, dummy) == NULL;
+}
+
+int main(void) {
+    printf("=== Quantized Matmul Tests ===\n\n");
+
+    RUN_TEST(test_q4_0_matches_dequantized);
+    RUN_TEST(test_q8_0_matches_dequantized);
+    RUN_TEST(test_q4_k_matches_dequantized);
+    RUN_TEST(test_batch_equals_single_rows);
+    RUN_TEST(test_quant_linear_tensor);
+    RUN_TEST(test_unsupported_types);
+
+    /* Same kernels split across workers */
+    threadpool_set_global(threadpool_create(4));
+    RUN_TEST(test_batched_rows);
+    RUN_TEST(test_q4_k_matches_dequantized);
+
+    printf("\n%d/%d tests passed\n", tests_passed, tests_run);
+    return (tests_passed == tests_run) ? 0 : 1;
+}
@@ -4,6 +4,7 @@
 
 #include "cml.h"
 #include "nn/serving.h"
+#include "nn/paged_attention.h"
 
 static int tests_run = 0;
 static int tests_passed = 0;
@@ -503,6 +504,245 @@ static int test_config_clamping(void) {
 }
 
 
+/*
+ * Forward-loop tests. The fake model writes K = {pos, token} and
+ * V = {token, pos} for every fed token, checks the sequence's cache holds
+ * exactly the positions before it, and "samples" a token that depends on
+ * the last fed token and its position, so any scheduling mistake (lost,
+ * duplicated or reordered tokens) changes the output.
+ */
+typedef struct {
+    int budget;
+    int max_step_tokens;
+    int steps;
+    int mixed_steps;   /* Steps holding both prefill and decode entries */
+    int errors;
+} FakeModel;
+
+static int fake_next_token(int last_token, int pos) {
+    return (last_token * 31 + pos) % 1000;
+}
+
+static int fake_forward(void* user_data, CMLPagedKVCache* cache,
+                        const CMLServingBatchEntry* entries, int num_entries,
+                        int* next_tokens) {
+    FakeModel* m = (FakeModel*)user_data;
+    int total = 0, prefill = 0, decode = 0;
+
+    for (int e = 0; e < num_entries; e++) {
+        const CMLServingBatchEntry* en = &entries[e];
+        const CMLBlockTable* bt = &cache->sequences[en->paged_seq_id];
+        if (bt->seq_len != en->start_pos) m->errors++;
+
+        /* Everything already cached is in position order */
+        for (int p = 0; p < bt->seq_len; p++) {
+            const CMLPageBlock* blk = &cache->blocks[bt->block_ids[p / cache->block_size]];
+            if ((int)blk->key_data[(p % cache->block_size) * 2] != p) m->errors++;
+        }
+
+        for (int i = 0; i < en->num_tokens; i++) {
+            float k[2] = {(float)(en->start_pos + i), (float)en->tokens[i]};
+            float v[2] = {(float)en->tokens[i], (float)(en->start_pos + i)};
+            if (cml_paged_cache_append(cache, en->paged_seq_id, k, v) != 0) return -1;
+        }
+        int last = en->start_pos + en->num_tokens - 1;
+        next_tokens[e] = fake_next_token(en->tokens[en->num_tokens - 1], last);
+
+        total += en->num_tokens;
+        if (en->num_tokens == 1 && en->start_pos > 0 && en->wants_token) decode++;
+        else prefill++;
+    }
+
+    if (total > m->budget) m->errors++;
+    if (total > m->max_step_tokens) m->max_step_tokens = total;
+    if (prefill > 0 && decode > 0) m->mixed_steps++;
+    m->steps++;
+    return 0;
+}
+
+static void fake_prompt(int* tokens, int n, int seed) {
+    for (int i = 0; i < n; i++)
+        tokens[i] = (seed * 7 + i * 13) % 1000;
+}
+
+static int fake_output_matches(CMLServingContext* ctx, int id, const int* prompt,
+                               int prompt_len, int max_new) {
+    int seq[512];
+    memcpy(seq, prompt, (size_t)prompt_len * sizeof(int));
+    int len = prompt_len;
+    for (int i = 0; i < max_new; i++, len++)
+        seq[len] = fake_next_token(seq[len - 1], len - 1);
+
+    int count = 0;
+    const int* out = cml_serving_get_tokens(ctx, id, &count);
+    return out && count == max_new &&
+           memcmp(out, seq + prompt_len, (size_t)max_new * sizeof(int)) == 0;
+}
+
+/* Submits ragged prompts and steps until everything finishes */
+static int run_forward_loop(CMLServingConfig* cfg, int max_blocks, FakeModel* model,
+                            const int* prompt_lens, int num_requests, int max_new,
+                            CMLServingStats* stats_out) {
+    CMLPagedKVCache* cache = cml_paged_kv_cache_create(max_blocks, 16, 1, 2);
+    CMLServingContext* ctx = cml_serving_create(cfg);
+    if (!cache || !ctx) return 0;
+    cml_serving_set_kv_cache(ctx, cache);
+    cml_serving_set_forward(ctx, fake_forward, model);
+    model->budget = ctx->config.max_batch_tokens;
+
+    int ids[16], prompts[16][128];
+    for (int r = 0; r < num_requests; r++) {
+        fake_prompt(prompts[r], prompt_lens[r], r + 1);
+        ids[r] = cml_serving_submit(ctx, prompts[r], prompt_lens[r], max_new);
+        if (ids[r] < 0) return 0;
+    }
+
+    int ok = 1, steps = 0;
+    for (;;) {
+        int done = 0;
+        for (int r = 0; r < num_requests; r++)
+            done += cml_serving_get_status(ctx, ids[r]) == CML_SEQ_STATUS_FINISHED;
+        if (done == num_requests || steps++ > 2000) break;
+        cml_serving_step(ctx);
+    }
+
+    for (int r = 0; r < num_requests; r++) {
+        ok = ok && cml_serving_get_status(ctx, ids[r]) == CML_SEQ_STATUS_FINISHED &&
+             fake_output_matches(ctx, ids[r], prompts[r], prompt_lens[r], max_new);
+        ok = ok && cml_serving_finish_request(ctx, ids[r]) == 0;
+    }
+    ok = ok && model->errors == 0 && ctx->batch_size == 0 &&
+         cache->free_count == cache->max_blocks;
+    if (stats_out) *stats_out = cml_serving_get_stats(ctx);
+
+    cml_serving_free(ctx);
+    cml_paged_kv_cache_free(cache);
+    return ok;
+}
+
+static int test_forward_chunked_prefill(void) {
+    CMLServingConfig cfg = cml_serving_default_config();
+    cfg.max_batch_size = 4;
+    cfg.max_batch_tokens = 32;
+    cfg.prefill_chunk_size = 16;
+    FakeModel model = {0};
+    int lens[5] = {3, 45, 17, 70, 1};
+    CMLServingStats stats;
+
+    int ok = run_forward_loop(&cfg, 64, &model, lens, 5, 12, &stats);
+    return ok && model.max_step_tokens <= 32 && stats.num_preemptions == 0 &&
+           stats.completed_requests == 5 && stats.decode_tokens > 0 &&
+           stats.prefill_tokens >= 3 + 45 + 17 + 70 + 1;
+}
+
+static int test_forward_mixes_prefill_and_decode(void) {
+    /* A long prompt arriving behind a short one is prefilled in chunks
+     * while the short one keeps decoding */
+    CMLServingConfig cfg = cml_serving_default_config();
+    cfg.max_batch_size = 4;
+    cfg.max_batch_tokens = 16;
+    cfg.prefill_chunk_size = 8;
+    FakeModel model = {0};
+    int lens[2] = {4, 100};
+
+    int ok = run_forward_loop(&cfg, 64, &model, lens, 2, 20, NULL);
+    return ok && model.mixed_steps > 0;
+}
+
+static int test_forward_admission_waits_for_blocks(void) {
+    /* 3 blocks hold one 30-token sequence at a time */
+    CMLPagedKVCache* cache = cml_paged_kv_cache_create(3, 8, 1, 2);
+    CMLServingConfig cfg = cml_serving_default_config();
+    cfg.max_batch_size = 4;
+    cfg.max_batch_tokens = 64;
+    CMLServingContext* ctx = cml_serving_create(&cfg);
+    FakeModel model = {.budget = 64};
+    cml_serving_set_kv_cache(ctx, cache);
+    cml_serving_set_forward(ctx, fake_forward, &model);
+
+    int prompt[30], big[80];
+    fake_prompt(prompt, 30, 1);
+    fake_prompt(big, 80, 2);
+    int a = cml_serving_submit(ctx, prompt, 30, 2);
+    int b = cml_serving_submit(ctx, prompt, 30, 2);
+    int c = cml_serving_submit(ctx, big, 80, 2);
+
+    cml_serving_step(ctx);
+    int ok = cml_serving_get_status(ctx, a) == CML_SEQ_STATUS_DECODING &&
+             cml_serving_get_status(ctx, b) == CML_SEQ_STATUS_QUEUED;
+
+    /* a finishes, then b runs; c can never fit in the pool */
+    for (int i = 0; i < 10; i++) cml_serving_step(ctx);
+    ok = ok && cml_serving_get_status(ctx, a) == CML_SEQ_STATUS_FINISHED &&
+         cml_serving_get_status(ctx, b) == CML_SEQ_STATUS_FINISHED &&
+         cml_serving_get_status(ctx, c) == CML_SEQ_STATUS_ERROR &&
+         fake_output_matches(ctx, b, prompt, 30, 2) && model.errors == 0;
+
+    cml_serving_free(ctx);
+    cml_paged_kv_cache_free(cache);
+    return ok;
+}
+
+static int test_forward_preempt_recompute(void) {
+    CMLServingConfig cfg = cml_serving_default_config();
+    cfg.max_batch_size = 4;
+    cfg.max_batch_tokens = 64;
+    cfg.preempt_mode = CML_PREEMPT_RECOMPUTE;
+    FakeModel model = {0};
+    int lens[2] = {20, 20};
+    CMLServingStats stats;
+
+    /* Both prompts fit in 4 blocks, but not both full generations */
+    int ok = run_forward_loop(&cfg, 4, &model, lens, 2, 30, &stats);
+    return ok && stats.num_preemptions > 0 && stats.num_swaps == 0;
+}
+
+static int test_forward_preempt_swap(void) {
+    CMLServingConfig cfg = cml_serving_default_config();
+    cfg.max_batch_size = 4;
+    cfg.max_batch_tokens = 64;
+    cfg.preempt_mode = CML_PREEMPT_SWAP;
+    FakeModel model = {0};
+    int lens[3] = {20, 20, 9};
+    CMLServingStats stats;
+
+    int ok = run_forward_loop(&cfg, 5, &model, lens, 3, 30, &stats);
+    return ok && stats.num_swaps > 0;
+}
+
+static int test_forward_eos_and_latency_stats(void) {
+    CMLPagedKVCache* cache = cml_paged_kv_cache_create(16, 8, 1, 2);
+    CMLServingConfig cfg = cml_serving_default_config();
+    int prompt[5];
+    fake_prompt(prompt, 5, 3);
+    /* The third generated token ends the request */
+    int t1 = fake_next_token(prompt[4], 4);
+    int t2 = fake_next_token(t1, 5);
+    cfg.eos_token_id = fake_next_token(t2, 6);
+
+    CMLServingContext* ctx = cml_serving_create(&cfg);
+    FakeModel model = {.budget = ctx->config.max_batch_tokens};
+    cml_serving_set_kv_cache(ctx, cache);
+    cml_serving_set_forward(ctx, fake_forward, &model);
+    int id = cml_serving_submit(ctx, prompt, 5, 50);
+    for (int i = 0; i < 10; i++) cml_serving_step(ctx);
+
+    int count = 0;
+    cml_serving_get_tokens(ctx, id, &count);
+    CMLServingStats s = cml_serving_get_stats(ctx);
+    int ok = cml_serving_get_status(ctx, id) == CML_SEQ_STATUS_FINISHED && count == 3 &&
+             s.num_steps == 3 && s.prefill_tokens == 5 && s.decode_tokens == 2 &&
+             s.p50_time_to_first_token_ms > 0.0 &&
+             s.p99_time_to_first_token_ms >= s.p50_time_to_first_token_ms &&
+             s.p99_inter_token_latency_ms >= s.p50_inter_token_latency_ms &&
+             s.avg_inter_token_latency_ms >= 0.0 && cache->free_count == 16;
+
+    cml_serving_free(ctx);
+    cml_paged_kv_cache_free(cache);
+    return ok;
+}
+
+
 int main(void) {
     printf("test_serving\n\n");
 
@@ -553,6 +793,14 @@ int main(void) {
     /* Multi-step lifecycle */
     TEST(step_finish_step);
 
+    /* Forward loop */
+    TEST(forward_chunked_prefill);
+    TEST(forward_mixes_prefill_and_decode);
+    TEST(forward_admission_waits_for_blocks);
+    TEST(forward_preempt_recompute);
+    TEST(forward_preempt_swap);
+    TEST(forward_eos_and_latency_stats);
+
     printf("\n%d/%d passed\n", tests_passed, tests_run);
     return (tests_passed == tests_run) ? 0 : 1;
 }
@@ -0,0 +1,188 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "backend/threadpool.h"
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define RUN_TEST(test) do { \
+    tests_run++; \
+    printf("  [%d] %-50s ", tests_run, #test); \
+    if (test()) { tests_passed++; printf("PASS\n"); } \
+    else { printf("FAIL\n"); } \
+} while(0)
+
+typedef struct {
+    atomic_int* hits;
+} HitData;
+
+static void hit_task(void* data, size_t start, size_t end) {
+    HitData* d = (HitData*)data;
+    for (size_t i = start; i < end; i++)
+        atomic_fetch_add(&d->hits[i], 1);
+}
+
+static int check_each_once(ThreadPool* pool, size_t n, size_t grain) {
+    atomic_int* hits = calloc(n, sizeof(atomic_int));
+    HitData d = {hits};
+    if (grain)
+        threadpool_parallel_for_grain(pool, hit_task, &d, n, grain);
+    else
+        threadpool_parallel_for(pool, hit_task, &d, n);
+    int ok = 1;
+    for (size_t i = 0; i < n; i++)
+        if (atomic_load(&hits[i]) != 1)
+            ok = 0;
+    free(hits);
+    return ok;
+}
+
+static int test_create_destroy(void)
+{
+    ThreadPool* pool = threadpool_create(4);
+    if (!pool) return 0;
+    int ok = threadpool_get_num_threads(pool) == 4;
+    threadpool_destroy(pool);
+    return ok;
+}
+
+static int test_parallel_for_covers_range(void)
+{
+    ThreadPool* pool = threadpool_create(4);
+    int ok = check_each_once(pool, 100003, 0) && check_each_once(pool, 3, 0) &&
+             check_each_once(pool, 1, 0);
+    threadpool_destroy(pool);
+    return ok;
+}
+
+static int test_parallel_for_grain(void)
+{
+    ThreadPool* pool = threadpool_create(4);
+    int ok = check_each_once(pool, 5000, 1) && check_each_once(pool, 5000, 777) &&
+             check_each_once(pool, 5000, 100000);
+    threadpool_destroy(pool);
+    return ok;
+}
+
+static int test_single_thread_pool(void)
+{
+    ThreadPool* pool = threadpool_create(1);
+    int ok = check_each_once(pool, 4096, 0);
+    threadpool_destroy(pool);
+    return ok;
+}
+
+typedef struct {
+    ThreadPool* pool;
+    atomic_int* hits;
+    size_t inner;
+} NestedData;
+
+static void nested_outer_task(void* data, size_t start, size_t end) {
+    NestedData* d = (NestedData*)data;
+    for (size_t i = start; i < end; i++) {
+        HitData inner = {d->hits + i * d->inner};
+        threadpool_parallel_for_grain(d->pool, hit_task, &inner, d->inner, 16);
+    }
+}
+
+static int test_nested_parallel_for(void)
+{
+    ThreadPool* pool = threadpool_create(4);
+    size_t outer = 64, inner = 512;
+    atomic_int* hits = calloc(outer * inner, sizeof(atomic_int));
+    NestedData d = {pool, hits, inner};
+    threadpool_parallel_for_grain(pool, nested_outer_task, &d, outer, 1);
+    int ok = 1;
+    for (size_t i = 0; i < outer * inner; i++)
+        if (atomic_load(&hits[i]) != 1)
+            ok = 0;
+    free(hits);
+    threadpool_destroy(pool);
+    return ok;
+}
+
+static int test_submit_wait(void)
+{
+    ThreadPool* pool = threadpool_create(4);
+    size_t n = 2000;
+    atomic_int* hits = calloc(n, sizeof(atomic_int));
+    HitData d = {hits};
+    for (int r = 0; r < 10; r++) {
+        Task task = {.func = hit_task, .data = &d, .total_size = n};
+        if (threadpool_submit(pool, &task) != 0) { free(hits); return 0; }
+    }
+    threadpool_wait(pool);
+    int ok = 1;
+    for (size_t i = 0; i < n; i++)
+        if (atomic_load(&hits[i]) != 10)
+            ok = 0;
+    free(hits);
+    threadpool_destroy(pool);
+    return ok;
+}
+
+typedef struct {
+    ThreadPool* pool;
+    int ok;
+} CallerArg;
+
+static void* concurrent_caller(void* arg) {
+    CallerArg* a = (CallerArg*)arg;
+    a->ok = 1;
+    for (int i = 0; i < 50 && a->ok; i++)
+        a->ok = check_each_once(a->pool, 10000, 0);
+    return NULL;
+}
+
+static int test_concurrent_callers(void)
+{
+    ThreadPool* pool = threadpool_create(4);
+    pthread_t threads[3];
+    CallerArg args[3];
+    for (int i = 0; i < 3; i++) {
+        args[i].pool = pool;
+        pthread_create(&threads[i], NULL, concurrent_caller, &args[i]);
+    }
+    int ok = 1;
+    for (int i = 0; i < 3; i++) {
+        pthread_join(threads[i], NULL);
+        ok &= args[i].ok;
+    }
+    threadpool_destroy(pool);
+    return ok;
+}
+
+static int test_pinned_pool(void)
+{
+    ThreadPoolConfig cfg = {.num_threads = 3, .pin_threads = true, .spin_iterations = 16};
+    ThreadPool* pool = threadpool_create_ex(&cfg);
+    if (!pool) return 0;
+    int ok = check_each_once(pool, 50000, 0);
+    threadpool_destroy(pool);
+    return ok;
+}
+
+int main(void)
+{
+    printf("Thread Pool Tests\n\n");
+
+    printf("[Work-stealing pool]\n");
+    RUN_TEST(test_create_destroy);
+    RUN_TEST(test_parallel_for_covers_range);
+    RUN_TEST(test_parallel_for_grain);
+    RUN_TEST(test_single_thread_pool);
+    RUN_TEST(test_nested_parallel_for);
+    RUN_TEST(test_submit_wait);
+    RUN_TEST(test_concurrent_callers);
+    RUN_TEST(test_pinned_pool);
+
+    printf("\nResults: %d/%d tests passed\n", tests_passed, tests_run);
+
+    return (tests_passed == tests_run) ? 0 : 1;
+}
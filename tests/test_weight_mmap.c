@@ -0,0 +1,241 @@
+/*
+ * Tests for mmap-backed GGUF / safetensors reading: zero-copy aliasing,
+ * parity with the buffered path, and hashed name lookup over many tensors.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "cml.h"
+#include "core/gguf.h"
+#include "core/safetensors.h"
+#include "core/weight_file.h"
+#include "nn/layers/conv2d.h"
+
+static int tests_run    = 0;
+static int tests_passed = 0;
+
+#define RUN_TEST(test) do { \
+    tests_run++; \
+    printf("  [%d] %-55s ", tests_run, #test); \
+    if (test()) { tests_passed++; printf("PASS\n"); } \
+    else { printf("FAIL\n"); } \
+} while(0)
+
+#define NUM_WEIGHTS 300
+
+static char gguf_path[256];
+static char st_path[256];
+static const TensorConfig cpu_f32 = {.dtype = DTYPE_FLOAT32, .device = DEVICE_CPU,
+                                     .has_dtype = true, .has_device = true};
+
+static float weight_value(int tensor, int i) { return (float)tensor * 0.5f + (float)i; }
+
+static void write_fixtures(void) {
+    GGUFContext* g        = gguf_open_write(gguf_path);
+    SafeTensorsContext* s = safetensors_open_write(st_path);
+    for (int k = 0; k < NUM_WEIGHTS; k++) {
+        int shape[2] = {3, 5};
+        float data[15];
+        for (int i = 0; i < 15; i++)
+            data[i] = weight_value(k, i);
+        Tensor* t = tensor_from_data(data, shape, 2, &cpu_f32);
+        char name[64];
+        snprintf(name, sizeof(name), "blk.%d.attn_q.weight", k);
+        gguf_write_tensor(g, name, t);
+        safetensors_write_tensor(s, name, t);
+        tensor_free(t);
+    }
+    gguf_close(g);
+    safetensors_close(s);
+}
+
+static int check_weight(Tensor* t, int k) {
+    if (!t || t->numel != 15 || !t->data)
+        return 0;
+    for (int i = 0; i < 15; i++) {
+        if (((float*)t->data)[i] != weight_value(k, i))
+            return 0;
+    }
+    return 1;
+}
+
+static int test_mapped_file_and_advice(void) {
+    CMLMappedFile* map = cml_mapped_file_open(gguf_path);
+    if (!map)
+        return 0;
+    uint32_t magic = 0;
+    if (map->size >= 4)
+        memcpy(&magic, map->base, 4);
+    int ok = magic == GGUF_MAGIC;
+    cml_mapped_file_advise(map, 3, map->size, CML_MAP_ADVICE_SEQUENTIAL);
+    cml_mapped_file_advise(map, 0, map->size, CML_MAP_ADVICE_WILLNEED);
+    cml_mapped_file_close(map);
+    return ok && cml_mapped_file_open("/nonexistent/weights.gguf") == NULL;
+}
+
+static int test_name_index(void) {
+    CMLNameIndex index;
+    if (cml_name_index_init(&index, 3) != 0)
+        return 0;
+    cml_name_index_insert(&index, "a", 0);
+    cml_name_index_insert(&index, "b", 1);
+    cml_name_index_insert(&index, "a", 2); /* Duplicate keeps the first */
+    int ok = cml_name_index_find(&index, "a") == 0 && cml_name_index_find(&index, "b") == 1 &&
+             cml_name_index_find(&index, "c") == -1;
+    cml_name_index_free(&index);
+    return ok;
+}
+
+static int test_gguf_mmap_zero_copy(void) {
+    CMLWeightLoadOptions opts = {.use_mmap = true, .prefetch = true};
+    GGUFContext* ctx = gguf_open_read_ex(gguf_path, &opts);
+    if (!ctx)
+        return 0;
+
+    int ok = gguf_get_num_tensors(ctx) == NUM_WEIGHTS;
+    /* Walk in reverse so lookups can't ride on scan order */
+    for (int k = NUM_WEIGHTS - 1; ok && k >= 0; k--) {
+        char name[64];
+        snprintf(name, sizeof(name), "blk.%d.attn_q.weight", k);
+        Tensor* t = gguf_read_tensor(ctx, name);
+        ok = check_weight(t, k) && !t->owns_data;
+        tensor_free(t);
+    }
+    ok = ok && gguf_read_tensor(ctx, "missing.weight") == NULL;
+    gguf_close(ctx);
+    return ok;
+}
+
+static int test_gguf_mmap_matches_buffered(void) {
+    CMLWeightLoadOptions opts = {.use_mmap = true};
+    GGUFContext* mapped   = gguf_open_read_ex(gguf_path, &opts);
+    GGUFContext* buffered = gguf_open_read(gguf_path);
+    if (!mapped || !buffered) {
+        gguf_close(mapped);
+        gguf_close(buffered);
+        return 0;
+    }
+    Tensor* a = gguf_read_tensor(mapped, "blk.7.attn_q.weight");
+    Tensor* b = gguf_read_tensor(buffered, "blk.7.attn_q.weight");
+    int ok = a && b && b->owns_data && memcmp(a->data, b->data, 15 * sizeof(float)) == 0;
+    tensor_free(a);
+    tensor_free(b);
+    gguf_close(mapped);
+    gguf_close(buffered);
+    return ok;
+}
+
+static int test_mapped_tensor_is_private(void) {
+    /* Copy-on-write: writing through a mapped tensor must not touch the file */
+    CMLWeightLoadOptions opts = {.use_mmap = true};
+    GGUFContext* ctx = gguf_open_read_ex(gguf_path, &opts);
+    if (!ctx)
+        return 0;
+    Tensor* t = gguf_read_tensor(ctx, "blk.0.attn_q.weight");
+    if (t && t->data)
+        ((float*)t->data)[0] = -1.0f;
+    tensor_free(t);
+    gguf_close(ctx);
+
+    GGUFContext* again = gguf_open_read(gguf_path);
+    Tensor* u = gguf_read_tensor(again, "blk.0.attn_q.weight");
+    int ok = check_weight(u, 0);
+    tensor_free(u);
+    gguf_close(again);
+    return ok;
+}
+
+static int test_safetensors_mmap(void) {
+    CMLWeightLoadOptions opts = {.use_mmap = true, .advice = CML_MAP_ADVICE_RANDOM};
+    SafeTensorsContext* ctx = safetensors_open_read_ex(st_path, &opts);
+    if (!ctx)
+        return 0;
+    int ok = safetensors_get_num_tensors(ctx) == NUM_WEIGHTS;
+    for (int k = NUM_WEIGHTS - 1; ok && k >= 0; k -= 7) {
+        char name[64];
+        snprintf(name, sizeof(name), "blk.%d.attn_q.weight", k);
+        Tensor* t = safetensors_read_tensor(ctx, name);
+        ok = check_weight(t, k);
+        tensor_free(t);
+    }
+    safetensors_close(ctx);
+    return ok;
+}
+
+/* Conv output of a module for a fixed input, copied out */
+static float* conv_output(Conv2d* conv, Tensor* x, size_t* n) {
+    Tensor* y = module_forward((Module*)conv, x);
+    if (!y || !tensor_data_ptr(y))
+        return NULL;
+    *n         = y->numel;
+    float* out = malloc(y->numel * sizeof(float));
+    if (out)
+        memcpy(out, y->data, y->numel * sizeof(float));
+    tensor_free(y);
+    return out;
+}
+
+/* Loading weights into a conv that already ran must not reuse the
+ * transformed (Winograd, 16 channels) or packed (blocked, 8) old weights */
+static int test_module_load_refreshes_conv(void) {
+    int ok = 1;
+    for (int gguf = 0; gguf < 2 && ok; gguf++) {
+        for (int ic = 8; ic <= 16 && ok; ic += 8) {
+            Conv2d* a = nn_conv2d(ic, 16, 3, 1, 1, 1, true, DTYPE_FLOAT32, DEVICE_CPU);
+            Conv2d* b = nn_conv2d(ic, 16, 3, 1, 1, 1, true, DTYPE_FLOAT32, DEVICE_CPU);
+            int shape[4] = {1, ic, 8, 8};
+            Tensor* x    = tensor_empty(shape, 4, &cpu_f32);
+            float* xd    = tensor_data_ptr(x);
+            for (int i = 0; i < ic * 64; i++)
+                xd[i] = (float)(i % 13) * 0.1f - 0.6f;
+            const char* path = gguf ? gguf_path : st_path;
+
+            size_t n_old = 0, n_new = 0, n_ref = 0;
+            float* old = conv_output(a, x, &n_old);
+            ok = ok && (gguf ? module_save_gguf((Module*)b, path)
+                             : module_save_safetensors((Module*)b, path)) == 0;
+            ok = ok && (gguf ? module_load_gguf((Module*)a, path)
+                             : module_load_safetensors((Module*)a, path)) == 0;
+            float* got = conv_output(a, x, &n_new);
+            float* ref = conv_output(b, x, &n_ref);
+            ok = ok && old && got && ref && n_new == n_ref;
+            float diff = 0.0f, moved = 0.0f;
+            for (size_t i = 0; ok && i < n_ref; i++) {
+                diff  = fmaxf(diff, fabsf(got[i] - ref[i]));
+                moved = fmaxf(moved, fabsf(old[i] - ref[i]));
+            }
+            ok = ok && diff < 1e-4f && moved > 1e-3f;
+            free(old); free(got); free(ref);
+            tensor_free(x);
+            module_free((Module*)a);
+            module_free((Module*)b);
+        }
+    }
+    write_fixtures(); /* The saves replaced them */
+    return ok;
+}
+
+int main(void) {
+    snprintf(gguf_path, sizeof(gguf_path), "/tmp/cml_test_mmap_%d.gguf", getpid());
+    snprintf(st_path, sizeof(st_path), "/tmp/cml_test_mmap_%d.safetensors", getpid());
+    write_fixtures();
+
+    printf("=== Weight mmap Tests ===\n\n");
+
+    RUN_TEST(test_mapped_file_and_advice);
+    RUN_TEST(test_name_index);
+    RUN_TEST(test_gguf_mmap_zero_copy);
+    RUN_TEST(test_gguf_mmap_matches_buffered);
+    RUN_TEST(test_mapped_tensor_is_private);
+    RUN_TEST(test_safetensors_mmap);
+    RUN_TEST(test_module_load_refreshes_conv);
+
+    remove(gguf_path);
+    remove(st_path);
+
+    printf("\n%d/%d tests passed\n", tests_passed, tests_run);
+    return (tests_passed == tests_run) ? 0 : 1;
+}
@@ -118,6 +118,113 @@ static void test_winograd_conv2d_basic(void) {
     printf(" PASS\n");
 }
 
+static void fill(float* p, size_t n, float phase) {
+    for (size_t i = 0; i < n; i++)
+        p[i] = sinf(0.37f * (float)i + phase);
+}
+
+/* Direct 3x3 stride-1 convolution */
+static void conv3x3_reference(const float* in, const float* w, const float* bias, float* out,
+                              int batch, int in_c, int out_c, int H, int W, int pad, int groups) {
+    int out_h = H + 2 * pad - 2, out_w = W + 2 * pad - 2;
+    int icg = in_c / groups, ocg = out_c / groups;
+    for (int b = 0; b < batch; b++)
+        for (int oc = 0; oc < out_c; oc++)
+            for (int y = 0; y < out_h; y++)
+                for (int x = 0; x < out_w; x++) {
+                    float sum = bias ? bias[oc] : 0.0f;
+                    for (int i = 0; i < icg; i++) {
+                        int ic = oc / ocg * icg + i;
+                        for (int ky = 0; ky < 3; ky++)
+                            for (int kx = 0; kx < 3; kx++) {
+                                int iy = y + ky - pad, ix = x + kx - pad;
+                                if (iy < 0 || iy >= H || ix < 0 || ix >= W)
+                                    continue;
+                                sum += in[((size_t)(b * in_c + ic) * H + iy) * W + ix] *
+                                       w[((size_t)(oc * icg + i) * 3 + ky) * 3 + kx];
+                            }
+                    }
+                    out[((size_t)(b * out_c + oc) * out_h + y) * out_w + x] = sum;
+                }
+}
+
+static void check_gemm(WinogradVariant variant, int batch, int in_c, int out_c, int H, int W,
+                       int pad, int groups) {
+    WinogradConfig cfg = winograd_select_variant(variant == WINOGRAD_F2x2_3x3 ? 4 : 64, 64);
+    assert(cfg.variant == variant);
+    int out_h = H + 2 * pad - 2, out_w = W + 2 * pad - 2;
+    size_t in_n = (size_t)batch * in_c * H * W, w_n = (size_t)out_c * (in_c / groups) * 9;
+    size_t out_n = (size_t)batch * out_c * out_h * out_w;
+    float *in = malloc(in_n * sizeof(float)), *w = malloc(w_n * sizeof(float));
+    float *bias = malloc((size_t)out_c * sizeof(float)), *out = malloc(out_n * sizeof(float));
+    float* ref = malloc(out_n * sizeof(float));
+    fill(in, in_n, 0.3f);
+    fill(w, w_n, 1.1f);
+    fill(bias, (size_t)out_c, 2.5f);
+
+    assert(winograd_conv2d_gemm(in, w, NULL, bias, out, batch, in_c, out_c, H, W, pad, pad,
+                                groups, &cfg) == 0);
+    conv3x3_reference(in, w, bias, ref, batch, in_c, out_c, H, W, pad, groups);
+    for (size_t i = 0; i < out_n; i++)
+        assert(fabsf(out[i] - ref[i]) < 1e-3f * (1.0f + fabsf(ref[i])));
+    free(in); free(w); free(bias); free(out); free(ref);
+}
+
+static void test_winograd_gemm_variants(void) {
+    printf("  test_winograd_gemm_variants...");
+    check_gemm(WINOGRAD_F2x2_3x3, 2, 16, 24, 9, 7, 1, 1);   /* Ragged tiles */
+    check_gemm(WINOGRAD_F4x4_3x3, 2, 16, 24, 13, 18, 1, 1); /* Ragged tiles */
+    check_gemm(WINOGRAD_F4x4_3x3, 1, 32, 32, 20, 20, 0, 1); /* Unpadded */
+    check_gemm(WINOGRAD_F4x4_3x3, 1, 32, 16, 12, 12, 1, 2); /* Grouped */
+    check_gemm(WINOGRAD_F4x4_3x3, 2, 16, 24, 130, 130, 1, 1); /* Several chunks */
+    printf(" PASS\n");
+}
+
+/* The transform is reused until the key's version changes */
+static void test_winograd_weight_cache(void) {
+    printf("  test_winograd_weight_cache...");
+    WinogradConfig cfg = winograd_select_variant(32, 32);
+    int out_c = 8, in_c = 4;
+    size_t n = winograd_gemm_weight_size(out_c, in_c, 1, &cfg);
+    float w[8 * 4 * 9];
+    float* expect = malloc(n * sizeof(float));
+    fill(w, sizeof(w) / sizeof(w[0]), 0.7f);
+    int key;
+
+    assert(winograd_weight_cached(&key, 0, w, out_c, in_c, 1, &cfg) == NULL);
+    const float* u1 = winograd_weight_cached(&key, 1, w, out_c, in_c, 1, &cfg);
+    assert(u1 != NULL);
+    assert(winograd_transform_weight_gemm(w, out_c, in_c, 1, &cfg, expect) == 0);
+    assert(memcmp(u1, expect, n * sizeof(float)) == 0);
+
+    /* Same version: the stale transform is kept even though w changed */
+    w[0] += 1.0f;
+    const float* u2 = winograd_weight_cached(&key, 1, w, out_c, in_c, 1, &cfg);
+    assert(u2 == u1 && memcmp(u2, expect, n * sizeof(float)) == 0);
+
+    /* New version: rebuilt, but not over the old one while it is pinned */
+    float* old = malloc(n * sizeof(float));
+    memcpy(old, expect, n * sizeof(float));
+    const float* u3 = winograd_weight_cached(&key, 2, w, out_c, in_c, 1, &cfg);
+    assert(winograd_transform_weight_gemm(w, out_c, in_c, 1, &cfg, expect) == 0);
+    assert(u3 != u1 && memcmp(u3, expect, n * sizeof(float)) == 0);
+    assert(memcmp(u1, old, n * sizeof(float)) == 0);
+    winograd_weight_release(u1);
+    winograd_weight_release(u2);
+    winograd_weight_release(u3);
+
+    /* Once released, the detached slot can be reused */
+    int key2;
+    const float* u4 = winograd_weight_cached(&key2, 1, w, out_c, in_c, 1, &cfg);
+    assert(u4 == u1);
+    winograd_weight_release(u4);
+
+    free(old);
+    free(expect);
+    winograd_cleanup();
+    printf(" PASS\n");
+}
+
 int main(void) {
     printf("Winograd Convolution Tests\n");
 
@@ -125,6 +232,8 @@ int main(void) {
     test_winograd_applicable_false();
     test_select_variant();
     test_winograd_conv2d_basic();
+    test_winograd_gemm_variants();
+    test_winograd_weight_cache();
 
     printf("All Winograd tests passed.\n");
     return 0;